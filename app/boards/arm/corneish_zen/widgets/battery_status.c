@@ -6,28 +6,16 @@
  */
 
 #include <kernel.h>
-#include <bluetooth/services/bas.h>
 
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include "battery_status.h"
 #include <src/lv_themes/lv_theme.h>
-#include <zmk/usb.h>
-#include <zmk/events/usb_conn_state_changed.h>
-#include <zmk/event_manager.h>
-#include <zmk/events/battery_state_changed.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct battery_status_state {
-    uint8_t level;
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-    bool usb_present;
-#endif
-};
-
 LV_IMG_DECLARE(batt_100);
 LV_IMG_DECLARE(batt_100_chg);
 LV_IMG_DECLARE(batt_75);
@@ -41,53 +29,43 @@ LV_IMG_DECLARE(batt_5_chg);
 LV_IMG_DECLARE(batt_0);
 LV_IMG_DECLARE(batt_0_chg);
 
-static void set_battery_symbol(lv_obj_t *icon, struct battery_status_state state) {
-    uint8_t level = state.level;
+static void set_battery_symbol(lv_obj_t *icon, const struct zmk_display_status *status) {
+    uint8_t level = status->battery_level;
 
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
     if (level > 95) {
-        lv_img_set_src(icon, state.usb_present ? &batt_100_chg : &batt_100);
+        lv_img_set_src(icon, status->usb_powered ? &batt_100_chg : &batt_100);
     } else if (level > 74) {
-        lv_img_set_src(icon, state.usb_present ? &batt_75_chg : &batt_75);
+        lv_img_set_src(icon, status->usb_powered ? &batt_75_chg : &batt_75);
     } else if (level > 49) {
-        lv_img_set_src(icon, state.usb_present ? &batt_50_chg : &batt_50);
+        lv_img_set_src(icon, status->usb_powered ? &batt_50_chg : &batt_50);
     } else if (level > 24) {
-        lv_img_set_src(icon, state.usb_present ? &batt_25_chg : &batt_25);
+        lv_img_set_src(icon, status->usb_powered ? &batt_25_chg : &batt_25);
     } else if (level > 5) {
-        lv_img_set_src(icon, state.usb_present ? &batt_5_chg : &batt_5);
+        lv_img_set_src(icon, status->usb_powered ? &batt_5_chg : &batt_5);
     } else {
-        lv_img_set_src(icon, state.usb_present ? &batt_0_chg : &batt_0);
+        lv_img_set_src(icon, status->usb_powered ? &batt_0_chg : &batt_0);
     }
 #endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
 }
 
-void battery_status_update_cb(struct battery_status_state state) {
+static void battery_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_battery_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_battery_symbol(widget->obj, state); }
-}
-
-static struct battery_status_state battery_status_get_state(const zmk_event_t *eh) {
-    return (struct battery_status_state) {
-        .level = bt_bas_get_battery_level(),
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-        .usb_present = zmk_usb_is_powered(),
-#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
-    };
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        set_battery_symbol(widget->obj, status);
+    }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_battery_status, struct battery_status_state,
-                            battery_status_update_cb, battery_status_get_state)
-
-ZMK_SUBSCRIPTION(widget_battery_status, zmk_battery_state_changed);
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-ZMK_SUBSCRIPTION(widget_battery_status, zmk_usb_conn_state_changed);
-#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
+static struct zmk_display_status_listener battery_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_BATTERY | ZMK_DISPLAY_STATUS_USB,
+    .update = battery_status_update_cb,
+};
 
 int zmk_widget_battery_status_init(struct zmk_widget_battery_status *widget, lv_obj_t *parent) {
     widget->obj = lv_img_create(parent, NULL);
 
     sys_slist_append(&widgets, &widget->node);
-    widget_battery_status_init();
+    zmk_display_status_subscribe(&battery_status_listener);
 
     return 0;
 }
@@ -5,37 +5,20 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_USB_CONNECTED
-#define LV_ATTRIBUTE_IMG_USB_CONNECTED
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_IMG_USB_CONNECTED uint8_t USB_connected_map[] = {
-    0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-    0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0xff, 0xff, 0xc0, 0x00, 0x3f,
-    0xff, 0xff, 0xc0, 0x00, 0xff, 0xff, 0xff, 0xc0, 0x01, 0xff, 0xff, 0xff, 0x80, 0x03, 0xff, 0xff,
-    0xff, 0xfe, 0x07, 0xff, 0xff, 0xff, 0xff, 0x07, 0x1e, 0x30, 0x38, 0x07, 0x0f, 0x1c, 0x20, 0x38,
-    0x07, 0x0f, 0x1c, 0x47, 0x10, 0xc3, 0x3e, 0x1c, 0x43, 0xf1, 0xc7, 0x7e, 0x3c, 0x60, 0x70, 0x0e,
-    0x7e, 0x3c, 0x70, 0x30, 0x0e, 0x7e, 0x38, 0xfc, 0x33, 0xc7, 0xfe, 0x18, 0x8f, 0x23, 0x87, 0x0e,
-    0x00, 0xc6, 0x20, 0x07, 0x0f, 0x01, 0xe0, 0x60, 0x0e, 0x0f, 0x87, 0xf0, 0xe0, 0x3e, 0x07, 0xff,
-    0xff, 0xff, 0xfc, 0x07, 0xff, 0xff, 0xff, 0xf0, 0x03, 0xff, 0xff, 0xfe, 0x00, 0x01, 0xff, 0xff,
-    0xfc, 0x00, 0x00, 0x7f, 0xff, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t USB_connected_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0x2f, 0x07, 0xf0, 0x1f, 0x09, 0xef, 0x0b, 0xdf, 0x0b, 0xdf,
+    0x0f, 0x03, 0x6f, 0x0f, 0x05, 0x53, 0x34, 0x32, 0x63, 0x83, 0x44, 0x33,
+    0x41, 0x73, 0x83, 0x44, 0x33, 0x31, 0x33, 0x31, 0x42, 0x42, 0x25, 0x43,
+    0x31, 0x46, 0x33, 0x33, 0x16, 0x34, 0x32, 0x63, 0x83, 0x26, 0x34, 0x33,
+    0x62, 0x83, 0x26, 0x33, 0x36, 0x42, 0x24, 0x3a, 0x42, 0x31, 0x34, 0x21,
+    0x33, 0x43, 0x43, 0x92, 0x32, 0x31, 0xa3, 0x44, 0x74, 0x62, 0x93, 0x55,
+    0x47, 0x43, 0x75, 0x6f, 0x0f, 0x03, 0x7f, 0x0f, 0x01, 0xaf, 0x0a, 0xf0,
+    0x1f, 0x08, 0xf0, 0x4f, 0x06, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t USB_connected = {
-    .header.always_zero = 0,
-    .header.w = 40,
-    .header.h = 31,
-    .data_size = 164,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = USB_connected_map,
-};
+const lv_img_dsc_t USB_connected = ZMK_RLE_IMAGE(USB_connected_map, 40, 31);
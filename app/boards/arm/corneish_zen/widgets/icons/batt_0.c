@@ -5,39 +5,17 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BATT_0
-#define LV_ATTRIBUTE_IMG_BATT_0
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BATT_0 uint8_t
-    batt_0_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x00, 0x7c, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00,
-        0x00, 0x01, 0xff, 0x00, 0x00, 0x00, 0x01, 0xff, 0x00, 0x00, 0x7f, 0xfd, 0xff, 0x7f, 0xf8,
-        0xff, 0xfd, 0xff, 0x7f, 0xfc, 0xff, 0xfd, 0xff, 0x7f, 0xfc, 0xff, 0xfc, 0xfe, 0x7f, 0xfc,
-        0xf0, 0x00, 0xfe, 0x00, 0x3f, 0xf0, 0x00, 0xfe, 0x00, 0x3f, 0xf0, 0x00, 0xfe, 0x00, 0x3f,
-        0xf0, 0x00, 0xfe, 0x00, 0x3f, 0xf0, 0x00, 0xfe, 0x00, 0x0f, 0xf0, 0x00, 0x7c, 0x00, 0x0f,
-        0xf0, 0x00, 0x7c, 0x00, 0x0f, 0xf0, 0x00, 0x7c, 0x00, 0x0f, 0xf0, 0x00, 0x7c, 0x00, 0x3f,
-        0xf0, 0x00, 0x7c, 0x00, 0x3f, 0xf0, 0x00, 0x7c, 0x00, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x3f,
-        0xff, 0xff, 0x01, 0xff, 0xfc, 0xff, 0xff, 0x01, 0xff, 0xfc, 0xff, 0xfe, 0x7c, 0xff, 0xfc,
-        0x7f, 0xfc, 0xfe, 0x7f, 0xf8, 0x00, 0x01, 0xff, 0x00, 0x00, 0x00, 0x01, 0xff, 0x00, 0x00,
-        0x00, 0x01, 0xff, 0x00, 0x00, 0x00, 0x01, 0xff, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x00, 0x00,
-        0x00, 0x00, 0x7c, 0x00, 0x00,
+static const uint8_t batt_0_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xf0, 0x25, 0xf0, 0xf0, 0x47, 0xf0, 0xf0, 0x38, 0xf0, 0xf0, 0x19, 0xf0,
+    0xf0, 0x19, 0xf0, 0x2d, 0x19, 0x1c, 0x3e, 0x19, 0x1d, 0x2e, 0x19, 0x1d,
+    0x2e, 0x27, 0x2d, 0x24, 0xc7, 0xba, 0xc7, 0xba, 0xc7, 0xba, 0xc7, 0xba,
+    0xc7, 0xd8, 0xd5, 0xe8, 0xd5, 0xe8, 0xd5, 0xe8, 0xd5, 0xca, 0xd5, 0xca,
+    0xd5, 0xca, 0xf0, 0xff, 0x07, 0x7f, 0x2f, 0x01, 0x7f, 0x2f, 0x25, 0x2e,
+    0x3d, 0x27, 0x2c, 0xf0, 0x39, 0xf0, 0xf0, 0x19, 0xf0, 0xf0, 0x19, 0xf0,
+    0xf0, 0x19, 0xf0, 0xf0, 0x27, 0xf0, 0xf0, 0x45, 0xf0,
 };
 
-const lv_img_dsc_t batt_0 = {
-    .header.always_zero = 0,
-    .header.w = 40,
-    .header.h = 31,
-    .data_size = 163,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = batt_0_map,
-};
+const lv_img_dsc_t batt_0 = ZMK_RLE_IMAGE(batt_0_map, 40, 31);
@@ -5,39 +5,15 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BATT_100
-#define LV_ATTRIBUTE_IMG_BATT_100
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BATT_100 uint8_t
-    batt_100_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0xff, 0xff, 0xff, 0xf8,
-        0xff, 0xff, 0xff, 0xff, 0xfc, 0xff, 0xff, 0xff, 0xff, 0xfc, 0xff, 0xff, 0xff, 0xff, 0xfc,
-        0xf0, 0x00, 0x00, 0x00, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x3f, 0xf3, 0xff, 0xff, 0xff, 0x3f,
-        0xf3, 0xff, 0xff, 0xff, 0x3f, 0xf3, 0xff, 0xff, 0xff, 0x0f, 0xf3, 0xff, 0xff, 0xff, 0x0f,
-        0xf3, 0xff, 0xff, 0xff, 0x0f, 0xf3, 0xff, 0xff, 0xff, 0x0f, 0xf3, 0xff, 0xff, 0xff, 0x3f,
-        0xf3, 0xff, 0xff, 0xff, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x3f,
-        0xff, 0xff, 0xff, 0xff, 0xfc, 0xff, 0xff, 0xff, 0xff, 0xfc, 0xff, 0xff, 0xff, 0xff, 0xfc,
-        0x7f, 0xff, 0xff, 0xff, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t batt_100_map[] = {
+    ZMK_RLE_IMAGE_RUNS_8,
+    0xc9, 0x24, 0x03, 0x26, 0x02, 0x26, 0x02, 0x26, 0x02, 0x04, 0x1e, 0x0a,
+    0x1e, 0x0a, 0x02, 0x1a, 0x02, 0x0a, 0x02, 0x1a, 0x02, 0x0a, 0x02, 0x1a,
+    0x04, 0x08, 0x02, 0x1a, 0x04, 0x08, 0x02, 0x1a, 0x04, 0x08, 0x02, 0x1a,
+    0x04, 0x08, 0x02, 0x1a, 0x02, 0x0a, 0x02, 0x1a, 0x02, 0x0a, 0x1e, 0x0a,
+    0x1e, 0x2c, 0x02, 0x26, 0x02, 0x26, 0x03, 0x24,
 };
 
-const lv_img_dsc_t batt_100 = {
-    .header.always_zero = 0,
-    .header.w = 40,
-    .header.h = 31,
-    .data_size = 163,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = batt_100_map,
-};
+const lv_img_dsc_t batt_100 = ZMK_RLE_IMAGE(batt_100_map, 40, 31);
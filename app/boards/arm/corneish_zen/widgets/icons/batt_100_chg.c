@@ -5,39 +5,19 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BATT_100_CHG
-#define LV_ATTRIBUTE_IMG_BATT_100_CHG
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BATT_100_CHG uint8_t
-    batt_100_chg_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00,
-        0x00, 0x00, 0x01, 0xc0, 0x00, 0x00, 0x00, 0x03, 0x80, 0x00, 0x7f, 0xff, 0xf7, 0xbf, 0xf8,
-        0xff, 0xff, 0xef, 0xbf, 0xfc, 0xff, 0xff, 0xdf, 0x7f, 0xfc, 0xff, 0xff, 0xbf, 0x7f, 0xfc,
-        0xf0, 0x00, 0x7e, 0x00, 0x3f, 0xf0, 0x00, 0xfe, 0x00, 0x3f, 0xf3, 0xfd, 0xfe, 0xff, 0x3f,
-        0xf3, 0xfb, 0xfd, 0xff, 0x3f, 0xf3, 0xf7, 0xfc, 0x07, 0x0f, 0xf3, 0xef, 0xff, 0xef, 0x0f,
-        0xf3, 0xdf, 0xff, 0xdf, 0x0f, 0xf3, 0x80, 0x7f, 0xbf, 0x0f, 0xf3, 0xff, 0x7f, 0x7f, 0x3f,
-        0xf3, 0xfe, 0xfe, 0xff, 0x3f, 0xf0, 0x00, 0xfc, 0x00, 0x3f, 0xf0, 0x01, 0xf8, 0x00, 0x3f,
-        0xff, 0xfd, 0xf7, 0xff, 0xfc, 0xff, 0xfb, 0xef, 0xff, 0xfc, 0xff, 0xfb, 0xdf, 0xff, 0xfc,
-        0x7f, 0xfb, 0xbf, 0xff, 0xf8, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
-        0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
-        0x00, 0x10, 0x00, 0x00, 0x00,
+static const uint8_t batt_100_chg_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xf0, 0xb1, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0x72, 0xf0, 0xf0, 0x73, 0xf0,
+    0xf0, 0x63, 0xf0, 0x1f, 0x04, 0x14, 0x1b, 0x3f, 0x04, 0x15, 0x1c, 0x2f,
+    0x03, 0x15, 0x1d, 0x2f, 0x02, 0x16, 0x1d, 0x24, 0xd6, 0xba, 0xc7, 0xba,
+    0x28, 0x18, 0x18, 0x2a, 0x27, 0x18, 0x19, 0x2a, 0x26, 0x19, 0x73, 0x48,
+    0x25, 0x1f, 0x14, 0x48, 0x24, 0x1f, 0x15, 0x48, 0x23, 0x88, 0x16, 0x48,
+    0x2a, 0x17, 0x17, 0x2a, 0x29, 0x17, 0x18, 0x2a, 0xc6, 0xca, 0xb6, 0xdf,
+    0x05, 0x15, 0x1f, 0x02, 0x2d, 0x15, 0x1f, 0x03, 0x2d, 0x14, 0x1f, 0x04,
+    0x3c, 0x13, 0x1f, 0x04, 0xf0, 0x13, 0xf0, 0xf0, 0x73, 0xf0, 0xf0, 0x63,
+    0xf0, 0xf0, 0x72, 0xf0, 0xf0, 0x72, 0xf0, 0xf0, 0x81, 0xf0,
 };
 
-const lv_img_dsc_t batt_100_chg = {
-    .header.always_zero = 0,
-    .header.w = 40,
-    .header.h = 31,
-    .data_size = 163,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = batt_100_chg_map,
-};
+const lv_img_dsc_t batt_100_chg = ZMK_RLE_IMAGE(batt_100_chg_map, 40, 31);
@@ -5,38 +5,19 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING uint8_t
-    bluetooth_advertising_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x40, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x70, 0x00, 0x00, 0x00, 0x78,
-        0x00, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x00, 0x7f, 0x00, 0x00,
-        0x20, 0x7f, 0x80, 0x00, 0x70, 0x77, 0xc0, 0x00, 0xf8, 0x73, 0xe0, 0xc0, 0x7c, 0x71,
-        0xe0, 0xe0, 0x3e, 0x73, 0xc0, 0x70, 0x1f, 0x77, 0x86, 0x30, 0x0f, 0xff, 0x07, 0x30,
-        0x07, 0xfe, 0x07, 0x38, 0x03, 0xfc, 0x23, 0x38, 0x01, 0xf8, 0x63, 0x18, 0x01, 0xf8,
-        0x63, 0x18, 0x03, 0xfc, 0x23, 0x38, 0x07, 0xfe, 0x07, 0x38, 0x0f, 0xff, 0x07, 0x30,
-        0x1f, 0x77, 0x86, 0x70, 0x3e, 0x73, 0xc0, 0x70, 0x7c, 0x71, 0xe0, 0xe0, 0xf8, 0x73,
-        0xe0, 0xc0, 0x70, 0x77, 0xc0, 0x00, 0x20, 0x7f, 0x80, 0x00, 0x00, 0x7f, 0x00, 0x00,
-        0x00, 0x7e, 0x00, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0x70,
-        0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_advertising_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0x91, 0xf0, 0xd2, 0xf0, 0xc3, 0xf0, 0xb4, 0xf0, 0xa5, 0xf0, 0x96, 0xf0,
+    0x87, 0xf1, 0x68, 0xd3, 0x53, 0x15, 0xb5, 0x43, 0x25, 0x52, 0x45, 0x33,
+    0x34, 0x53, 0x45, 0x23, 0x24, 0x73, 0x45, 0x13, 0x14, 0x42, 0x32, 0x5c,
+    0x53, 0x22, 0x6a, 0x63, 0x23, 0x68, 0x41, 0x32, 0x23, 0x76, 0x42, 0x32,
+    0x32, 0x76, 0x42, 0x32, 0x32, 0x68, 0x41, 0x32, 0x23, 0x5a, 0x63, 0x23,
+    0x4c, 0x53, 0x22, 0x45, 0x13, 0x14, 0x42, 0x23, 0x35, 0x23, 0x24, 0x73,
+    0x25, 0x33, 0x34, 0x53, 0x25, 0x43, 0x25, 0x52, 0x43, 0x53, 0x15, 0xd1,
+    0x68, 0xf0, 0x67, 0xf0, 0x76, 0xf0, 0x85, 0xf0, 0x94, 0xf0, 0xa3, 0xf0,
+    0xb2, 0xf0, 0xc1, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t bluetooth_advertising = {
-    .header.always_zero = 0,
-    .header.w = 29,
-    .header.h = 35,
-    .data_size = 148,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_advertising_map,
-};
+const lv_img_dsc_t bluetooth_advertising = ZMK_RLE_IMAGE(bluetooth_advertising_map, 29, 35);
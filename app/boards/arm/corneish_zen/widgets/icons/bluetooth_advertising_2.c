@@ -5,43 +5,24 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_2
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_2
-#endif
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_2 uint8_t
-    bluetooth_advertising_2_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x00, 0x00, 0x03, 0xfc, 0x00, 0x00, 0xff, 0x00,
-        0x00, 0x0f, 0xff, 0x00, 0x60, 0xff, 0x80, 0x00, 0x1f, 0xff, 0xc0, 0xf0, 0xf7, 0xc0, 0x80,
-        0x7f, 0xff, 0xe0, 0x78, 0xf3, 0xe1, 0xc0, 0x7f, 0xff, 0xf0, 0x3c, 0xf3, 0xc0, 0xe0, 0xff,
-        0x0f, 0xf0, 0x1e, 0xf7, 0x84, 0xe1, 0xfe, 0x07, 0xf8, 0x0f, 0xff, 0x0e, 0x71, 0xfc, 0x63,
-        0xf8, 0x07, 0xfe, 0x0e, 0x71, 0xff, 0xf3, 0xfc, 0x03, 0xfc, 0x06, 0x33, 0xff, 0xe3, 0xfc,
-        0x01, 0xf8, 0x67, 0x33, 0xff, 0xe7, 0xfc, 0x01, 0xf8, 0xe7, 0x33, 0xff, 0xc7, 0xfc, 0x01,
-        0xfc, 0x67, 0x33, 0xff, 0x8f, 0xfc, 0x03, 0xfe, 0x06, 0x33, 0xff, 0x1f, 0xfc, 0x07, 0xff,
-        0x0e, 0x71, 0xfe, 0x3f, 0xfc, 0x0f, 0xff, 0x8e, 0x61, 0xfc, 0x03, 0xf8, 0x1e, 0xf7, 0xc0,
-        0xe1, 0xfc, 0x03, 0xf8, 0x3c, 0xf3, 0xe0, 0xc0, 0xff, 0xff, 0xf0, 0x78, 0xf3, 0xe1, 0xc0,
-        0x7f, 0xff, 0xf0, 0xf0, 0xf7, 0xc0, 0x80, 0x7f, 0xff, 0xe0, 0x60, 0xff, 0x80, 0x00, 0x1f,
-        0xff, 0xc0, 0x00, 0xff, 0x00, 0x00, 0x0f, 0xff, 0x00, 0x00, 0xfe, 0x00, 0x00, 0x03, 0xfc,
-        0x00, 0x00, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_advertising_2_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0x81, 0xf0, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0xf0, 0x74, 0xf0, 0xf0, 0xf0,
+    0x55, 0xf0, 0xf0, 0xf0, 0x46, 0xf0, 0xf0, 0xf0, 0x37, 0xf0, 0x88, 0xf0,
+    0x18, 0xf0, 0x5c, 0x72, 0x59, 0xf0, 0x3f, 0x44, 0x44, 0x15, 0x61, 0x8f,
+    0x03, 0x44, 0x34, 0x25, 0x43, 0x7f, 0x04, 0x44, 0x24, 0x24, 0x63, 0x58,
+    0x48, 0x54, 0x14, 0x14, 0x41, 0x23, 0x48, 0x68, 0x5c, 0x43, 0x23, 0x37,
+    0x32, 0x37, 0x6a, 0x53, 0x23, 0x3d, 0x28, 0x68, 0x72, 0x32, 0x2d, 0x38,
+    0x76, 0x42, 0x23, 0x22, 0x2d, 0x29, 0x76, 0x33, 0x23, 0x22, 0x2c, 0x39,
+    0x77, 0x32, 0x23, 0x22, 0x2b, 0x3a, 0x69, 0x62, 0x32, 0x2a, 0x3b, 0x5b,
+    0x43, 0x23, 0x38, 0x3c, 0x4d, 0x33, 0x22, 0x47, 0x87, 0x44, 0x14, 0x15,
+    0x63, 0x47, 0x87, 0x34, 0x24, 0x25, 0x52, 0x6f, 0x05, 0x34, 0x34, 0x25,
+    0x43, 0x7f, 0x04, 0x24, 0x44, 0x15, 0x61, 0x8f, 0x03, 0x42, 0x59, 0xf0,
+    0x3f, 0xc8, 0xf0, 0x5c, 0xe7, 0xf0, 0x88, 0xf0, 0x16, 0xf0, 0xf0, 0xf0,
+    0x35, 0xf0, 0xf0, 0xf0, 0x44, 0xf0, 0xf0, 0xf0, 0x52, 0xf0, 0xf0, 0xf0,
+    0x71, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t bluetooth_advertising_2 = {
-    .header.always_zero = 0,
-    .header.w = 54,
-    .header.h = 35,
-    .data_size = 254,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_advertising_2_map,
-};
+const lv_img_dsc_t bluetooth_advertising_2 = ZMK_RLE_IMAGE(bluetooth_advertising_2_map, 54, 35);
@@ -5,43 +5,25 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_5
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_5
-#endif
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_IMG_BLUETOOTH_ADVERTISING_5 uint8_t
-    bluetooth_advertising_5_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0xe0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0x00, 0x00, 0x01, 0xfc, 0x00, 0x00, 0xfe, 0x00,
-        0x00, 0x0f, 0xff, 0x00, 0x20, 0xff, 0x00, 0x00, 0x1f, 0xff, 0x80, 0x70, 0xf7, 0x80, 0x00,
-        0x3f, 0xff, 0xe0, 0xf8, 0xf3, 0xc0, 0xc0, 0x7f, 0xff, 0xe0, 0x7c, 0xf3, 0xe0, 0xe0, 0xff,
-        0xff, 0xf0, 0x3e, 0xf7, 0xc0, 0xe1, 0xfe, 0x07, 0xf8, 0x1f, 0xff, 0x84, 0x61, 0xfe, 0x07,
-        0xf8, 0x0f, 0xff, 0x0e, 0x71, 0xfc, 0x7f, 0xf8, 0x07, 0xfe, 0x06, 0x33, 0xfc, 0x7f, 0xfc,
-        0x03, 0xfc, 0x27, 0x33, 0xfc, 0x07, 0xfc, 0x01, 0xf8, 0x67, 0x33, 0xfc, 0x03, 0xfc, 0x01,
-        0xf8, 0x67, 0x33, 0xff, 0x63, 0xfc, 0x03, 0xfc, 0x27, 0x33, 0xff, 0xf3, 0xfc, 0x07, 0xfe,
-        0x06, 0x33, 0xfe, 0xf3, 0xfc, 0x0f, 0xff, 0x0e, 0x71, 0xfc, 0x63, 0xf8, 0x1f, 0xff, 0x84,
-        0x61, 0xfe, 0x07, 0xf8, 0x3e, 0xf7, 0xc0, 0xe0, 0xff, 0x0f, 0xf8, 0x7c, 0xf3, 0xe1, 0xc0,
-        0xff, 0xff, 0xf0, 0xf8, 0xf3, 0xc0, 0xc0, 0x7f, 0xff, 0xe0, 0x70, 0xf7, 0x80, 0x00, 0x3f,
-        0xff, 0xc0, 0x20, 0xff, 0x00, 0x00, 0x1f, 0xff, 0x80, 0x00, 0xfe, 0x00, 0x00, 0x0f, 0xff,
-        0x00, 0x00, 0xfc, 0x00, 0x00, 0x01, 0xf8, 0x00, 0x00, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_advertising_5_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0x81, 0xf0, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0xf0, 0x73, 0xf0, 0xf0, 0xf0,
+    0x64, 0xf0, 0xf0, 0xf0, 0x55, 0xf0, 0xf0, 0xf0, 0x46, 0xf0, 0xa7, 0xf0,
+    0x17, 0xf0, 0x6c, 0x81, 0x58, 0xf0, 0x4e, 0x63, 0x44, 0x14, 0xf0, 0x2f,
+    0x02, 0x35, 0x34, 0x24, 0x62, 0x7f, 0x03, 0x45, 0x24, 0x25, 0x53, 0x5f,
+    0x05, 0x45, 0x14, 0x15, 0x63, 0x48, 0x68, 0x4e, 0x41, 0x32, 0x48, 0x68,
+    0x5c, 0x43, 0x23, 0x37, 0x3c, 0x6a, 0x62, 0x32, 0x28, 0x3d, 0x68, 0x41,
+    0x23, 0x22, 0x28, 0x79, 0x76, 0x42, 0x23, 0x22, 0x28, 0x88, 0x76, 0x42,
+    0x23, 0x22, 0x2a, 0x12, 0x38, 0x68, 0x41, 0x23, 0x22, 0x2e, 0x28, 0x5a,
+    0x62, 0x32, 0x29, 0x14, 0x28, 0x4c, 0x43, 0x23, 0x37, 0x32, 0x37, 0x4e,
+    0x41, 0x32, 0x48, 0x68, 0x35, 0x14, 0x15, 0x63, 0x58, 0x49, 0x25, 0x24,
+    0x25, 0x43, 0x6f, 0x05, 0x25, 0x34, 0x24, 0x62, 0x7f, 0x03, 0x43, 0x44,
+    0x14, 0xf0, 0x2f, 0x01, 0x61, 0x58, 0xf0, 0x4e, 0xd7, 0xf0, 0x6c, 0xe6,
+    0xf0, 0xa6, 0xf0, 0x25, 0xf0, 0xf0, 0xf0, 0x44, 0xf0, 0xf0, 0xf0, 0x53,
+    0xf0, 0xf0, 0xf0, 0x62, 0xf0, 0xf0, 0xf0, 0x71, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0,
 };
 
-const lv_img_dsc_t bluetooth_advertising_5 = {
-    .header.always_zero = 0,
-    .header.w = 54,
-    .header.h = 35,
-    .data_size = 254,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_advertising_5_map,
-};
+const lv_img_dsc_t bluetooth_advertising_5 = ZMK_RLE_IMAGE(bluetooth_advertising_5_map, 54, 35);
@@ -5,43 +5,23 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_5
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_5
-#endif
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_5 uint8_t
-    bluetooth_connected_5_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x01, 0xfc, 0x00, 0x00, 0x7f, 0x00,
-        0x00, 0x0f, 0xff, 0x00, 0x30, 0x7f, 0x80, 0x00, 0x1f, 0xff, 0x80, 0x78, 0x77, 0xc0, 0x00,
-        0x3f, 0xff, 0xe0, 0x7c, 0x73, 0xe0, 0x00, 0x7f, 0xff, 0xe0, 0x3e, 0x71, 0xe0, 0x00, 0xff,
-        0xff, 0xf0, 0x1f, 0x73, 0xc0, 0x01, 0xfe, 0x07, 0xf8, 0x0f, 0xff, 0x80, 0x01, 0xfe, 0x07,
-        0xf8, 0x87, 0xff, 0x08, 0x01, 0xfc, 0x7f, 0xf8, 0xc3, 0xfe, 0x18, 0x03, 0xfc, 0x7f, 0xfc,
-        0xe1, 0xfc, 0x38, 0x03, 0xfc, 0x07, 0xfc, 0xf0, 0xf8, 0x78, 0x03, 0xfc, 0x03, 0xfc, 0xf0,
-        0xfc, 0x78, 0x03, 0xff, 0x63, 0xfc, 0xe1, 0xfe, 0x38, 0x03, 0xff, 0xf3, 0xfc, 0xc3, 0xff,
-        0x18, 0x03, 0xfe, 0xf3, 0xfc, 0x87, 0xff, 0x88, 0x01, 0xfc, 0x63, 0xf8, 0x0f, 0xf7, 0xc0,
-        0x01, 0xfe, 0x07, 0xf8, 0x1e, 0x73, 0xc0, 0x00, 0xff, 0x0f, 0xf8, 0x3c, 0x71, 0xe0, 0x00,
-        0xff, 0xff, 0xf0, 0x7c, 0x73, 0xe0, 0x00, 0x7f, 0xff, 0xe0, 0x78, 0x77, 0xc0, 0x00, 0x3f,
-        0xff, 0xc0, 0x30, 0x7f, 0x80, 0x00, 0x1f, 0xff, 0x80, 0x00, 0x7f, 0x00, 0x00, 0x0f, 0xff,
-        0x00, 0x00, 0x7e, 0x00, 0x00, 0x01, 0xf8, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_connected_5_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0x91, 0xf0, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0xf0, 0x73, 0xf0, 0xf0, 0xf0,
+    0x64, 0xf0, 0xf0, 0xf0, 0x55, 0xf0, 0xf0, 0xf0, 0x46, 0xf0, 0x97, 0xf0,
+    0x27, 0xf0, 0x5c, 0x82, 0x58, 0xf0, 0x3e, 0x64, 0x43, 0x15, 0xf0, 0x1f,
+    0x02, 0x45, 0x33, 0x25, 0xef, 0x03, 0x55, 0x23, 0x34, 0xdf, 0x05, 0x55,
+    0x13, 0x24, 0xd8, 0x68, 0x5d, 0xe8, 0x68, 0x11, 0x4b, 0x41, 0xa7, 0x3c,
+    0x12, 0x49, 0x42, 0x98, 0x3f, 0x01, 0x47, 0x43, 0x98, 0x7d, 0x45, 0x44,
+    0x98, 0x8c, 0x46, 0x34, 0x9a, 0x12, 0x3b, 0x48, 0x33, 0x9e, 0x2a, 0x4a,
+    0x32, 0x99, 0x14, 0x29, 0x4c, 0x31, 0xa7, 0x32, 0x37, 0x58, 0x15, 0xd8,
+    0x68, 0x44, 0x23, 0x24, 0xe8, 0x49, 0x34, 0x33, 0x34, 0xdf, 0x05, 0x35,
+    0x33, 0x25, 0xef, 0x03, 0x44, 0x43, 0x15, 0xf0, 0x1f, 0x01, 0x62, 0x58,
+    0xf0, 0x3e, 0xe7, 0xf0, 0x5c, 0xf6, 0xf0, 0x96, 0xf0, 0x35, 0xf0, 0xf0,
+    0xf0, 0x44, 0xf0, 0xf0, 0xf0, 0x53, 0xf0, 0xf0, 0xf0, 0x62, 0xf0, 0xf0,
+    0xf0, 0x71, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t bluetooth_connected_5 = {
-    .header.always_zero = 0,
-    .header.w = 54,
-    .header.h = 35,
-    .data_size = 254,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_connected_5_map,
-};
+const lv_img_dsc_t bluetooth_connected_5 = ZMK_RLE_IMAGE(bluetooth_connected_5_map, 54, 35);
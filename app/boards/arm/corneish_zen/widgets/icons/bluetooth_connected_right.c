@@ -5,45 +5,23 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_RIGHT
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_RIGHT
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BLUETOOTH_CONNECTED_RIGHT
-    uint8_t bluetooth_connected_right_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x03, 0xf8, 0x00, 0x00, 0x3f, 0x80,
-        0x00, 0x0f, 0xfe, 0x00, 0x10, 0x3f, 0xc0, 0x00, 0x3f, 0xff, 0x80, 0x38, 0x3b, 0xe0, 0x00,
-        0x7f, 0xff, 0xc0, 0x7c, 0x39, 0xf0, 0x00, 0xff, 0xff, 0xe0, 0x3e, 0x38, 0xf0, 0x01, 0xff,
-        0xff, 0xf0, 0x1f, 0x39, 0xe0, 0x01, 0xff, 0xfe, 0x30, 0x0f, 0xbb, 0xc0, 0x03, 0xff, 0xfc,
-        0x38, 0x87, 0xff, 0x84, 0x03, 0xff, 0xf8, 0x38, 0xc3, 0xff, 0x0c, 0x07, 0xff, 0xf0, 0x3c,
-        0xe1, 0xfe, 0x1c, 0x07, 0xcf, 0xe0, 0x7c, 0xf0, 0xfc, 0x3c, 0x07, 0x87, 0xc0, 0xfc, 0xf0,
-        0xfc, 0x3c, 0x07, 0x83, 0x81, 0xfc, 0xe1, 0xfe, 0x1c, 0x07, 0x81, 0x03, 0xfc, 0xc3, 0xff,
-        0x0c, 0x07, 0xc0, 0x07, 0xfc, 0x87, 0xff, 0x84, 0x07, 0xe0, 0x0f, 0xfc, 0x0f, 0xbb, 0xc0,
-        0x03, 0xf0, 0x1f, 0xf8, 0x1f, 0x39, 0xe0, 0x03, 0xf8, 0x3f, 0xf8, 0x3e, 0x38, 0xf0, 0x01,
-        0xfc, 0xff, 0xf0, 0x7c, 0x39, 0xf0, 0x01, 0xff, 0xff, 0xf0, 0x38, 0x3b, 0xe0, 0x00, 0xff,
-        0xff, 0xe0, 0x10, 0x3f, 0xc0, 0x00, 0x7f, 0xff, 0xc0, 0x00, 0x3f, 0x80, 0x00, 0x3f, 0xff,
-        0x80, 0x00, 0x3f, 0x00, 0x00, 0x0f, 0xfe, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x03, 0xf8, 0x00,
-        0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_connected_right_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xa1, 0xf0, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0xf0, 0x73, 0xf0, 0xf0, 0xf0,
+    0x64, 0xf0, 0xf0, 0xf0, 0x55, 0xf0, 0xf0, 0xf0, 0x46, 0xf0, 0x77, 0xf0,
+    0x47, 0xf0, 0x4b, 0xa1, 0x68, 0xf0, 0x1f, 0x73, 0x53, 0x15, 0xef, 0x02,
+    0x55, 0x43, 0x25, 0xcf, 0x04, 0x55, 0x33, 0x34, 0xbf, 0x06, 0x55, 0x23,
+    0x24, 0xcf, 0x01, 0x32, 0x65, 0x13, 0x14, 0xcf, 0x01, 0x43, 0x11, 0x4c,
+    0x41, 0x8f, 0x53, 0x12, 0x4a, 0x42, 0x7f, 0x67, 0x48, 0x43, 0x75, 0x27,
+    0x69, 0x46, 0x44, 0x74, 0x45, 0x6a, 0x46, 0x44, 0x74, 0x53, 0x6a, 0x48,
+    0x43, 0x74, 0x61, 0x6a, 0x4a, 0x42, 0x75, 0xba, 0x4c, 0x41, 0x76, 0x9a,
+    0x45, 0x13, 0x14, 0xc6, 0x7a, 0x45, 0x23, 0x24, 0xb7, 0x5b, 0x35, 0x33,
+    0x34, 0xb7, 0x2c, 0x35, 0x43, 0x25, 0xbf, 0x06, 0x43, 0x53, 0x15, 0xdf,
+    0x04, 0x61, 0x68, 0xff, 0x02, 0xe7, 0xf0, 0x2f, 0xf6, 0xf0, 0x5b, 0xf0,
+    0x25, 0xf0, 0x87, 0xf0, 0x44, 0xf0, 0xf0, 0xf0, 0x53, 0xf0, 0xf0, 0xf0,
+    0x62, 0xf0, 0xf0, 0xf0, 0x71, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t bluetooth_connected_right = {
-    .header.always_zero = 0,
-    .header.w = 54,
-    .header.h = 35,
-    .data_size = 253,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_connected_right_map,
-};
+const lv_img_dsc_t bluetooth_connected_right = ZMK_RLE_IMAGE(bluetooth_connected_right_map, 54, 35);
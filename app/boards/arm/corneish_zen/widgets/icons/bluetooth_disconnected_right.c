@@ -5,45 +5,23 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_BLUETOOTH_DISCONNECTED_RIGHT
-#define LV_ATTRIBUTE_IMG_BLUETOOTH_DISCONNECTED_RIGHT
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_BLUETOOTH_DISCONNECTED_RIGHT
-    uint8_t bluetooth_disconnected_right_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x03, 0xf8, 0x00, 0x00, 0x3f, 0x80,
-        0x00, 0x0f, 0xfe, 0x00, 0x10, 0x3f, 0xc0, 0x00, 0x3f, 0xff, 0x80, 0x38, 0x3b, 0xe0, 0x00,
-        0x7f, 0xff, 0xc0, 0x7c, 0x39, 0xf0, 0x00, 0xff, 0xff, 0xe0, 0x3e, 0x38, 0xf0, 0x01, 0xff,
-        0xff, 0xf0, 0x1f, 0x39, 0xe0, 0x01, 0xe3, 0xf8, 0xf0, 0x0f, 0xbb, 0xc0, 0x03, 0xe1, 0xf0,
-        0xf8, 0x07, 0xff, 0x80, 0x03, 0xe0, 0xe0, 0xf8, 0x03, 0xff, 0x00, 0x07, 0xf0, 0x01, 0xfc,
-        0x01, 0xfe, 0x00, 0x07, 0xf8, 0x03, 0xfc, 0x00, 0xfc, 0x00, 0x07, 0xfc, 0x07, 0xfc, 0x00,
-        0xfc, 0x00, 0x07, 0xfc, 0x07, 0xfc, 0x01, 0xfe, 0x00, 0x07, 0xfc, 0x07, 0xfc, 0x03, 0xff,
-        0x00, 0x07, 0xf8, 0x03, 0xfc, 0x07, 0xff, 0x80, 0x07, 0xf0, 0x01, 0xfc, 0x0f, 0xbb, 0xc0,
-        0x03, 0xe0, 0xe0, 0xf8, 0x1f, 0x39, 0xe0, 0x03, 0xe1, 0xf0, 0xf8, 0x3e, 0x38, 0xf0, 0x01,
-        0xe3, 0xf8, 0xf0, 0x7c, 0x39, 0xf0, 0x01, 0xff, 0xff, 0xf0, 0x38, 0x3b, 0xe0, 0x00, 0xff,
-        0xff, 0xe0, 0x10, 0x3f, 0xc0, 0x00, 0x7f, 0xff, 0xc0, 0x00, 0x3f, 0x80, 0x00, 0x3f, 0xff,
-        0x80, 0x00, 0x3f, 0x00, 0x00, 0x0f, 0xfe, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x03, 0xf8, 0x00,
-        0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t bluetooth_disconnected_right_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xa1, 0xf0, 0xf0, 0xf0, 0x82, 0xf0, 0xf0, 0xf0, 0x73, 0xf0, 0xf0, 0xf0,
+    0x64, 0xf0, 0xf0, 0xf0, 0x55, 0xf0, 0xf0, 0xf0, 0x46, 0xf0, 0x77, 0xf0,
+    0x47, 0xf0, 0x4b, 0xa1, 0x68, 0xf0, 0x1f, 0x73, 0x53, 0x15, 0xef, 0x02,
+    0x55, 0x43, 0x25, 0xcf, 0x04, 0x55, 0x33, 0x34, 0xbf, 0x06, 0x55, 0x23,
+    0x24, 0xc4, 0x37, 0x34, 0x65, 0x13, 0x14, 0xc5, 0x45, 0x45, 0x6c, 0xd5,
+    0x53, 0x55, 0x7a, 0xd7, 0xb7, 0x78, 0xe8, 0x98, 0x86, 0xf9, 0x79, 0x86,
+    0xf9, 0x79, 0x78, 0xe9, 0x79, 0x6a, 0xd8, 0x98, 0x5c, 0xc7, 0xb7, 0x45,
+    0x13, 0x14, 0xc5, 0x53, 0x55, 0x45, 0x23, 0x24, 0xb5, 0x45, 0x45, 0x35,
+    0x33, 0x34, 0xb4, 0x37, 0x34, 0x35, 0x43, 0x25, 0xbf, 0x06, 0x43, 0x53,
+    0x15, 0xdf, 0x04, 0x61, 0x68, 0xff, 0x02, 0xe7, 0xf0, 0x2f, 0xf6, 0xf0,
+    0x5b, 0xf0, 0x25, 0xf0, 0x87, 0xf0, 0x44, 0xf0, 0xf0, 0xf0, 0x53, 0xf0,
+    0xf0, 0xf0, 0x62, 0xf0, 0xf0, 0xf0, 0x71, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0,
 };
 
-const lv_img_dsc_t bluetooth_disconnected_right = {
-    .header.always_zero = 0,
-    .header.w = 54,
-    .header.h = 35,
-    .data_size = 253,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = bluetooth_disconnected_right_map,
-};
+const lv_img_dsc_t bluetooth_disconnected_right = ZMK_RLE_IMAGE(bluetooth_disconnected_right_map, 54, 35);
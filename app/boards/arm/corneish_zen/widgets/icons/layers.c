@@ -5,40 +5,17 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_LAYERS
-#define LV_ATTRIBUTE_IMG_LAYERS
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_LAYERS uint8_t
-    layers_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe0, 0x00, 0x00,
-        0x00, 0x07, 0xfc, 0x00, 0x00, 0x00, 0x1f, 0xff, 0x00, 0x00, 0x00, 0x7f, 0xff, 0xc0, 0x00,
-        0x01, 0xff, 0xff, 0xf0, 0x00, 0x07, 0xff, 0xff, 0xfc, 0x00, 0x1f, 0xff, 0xff, 0xff, 0x00,
-        0x3f, 0xff, 0xff, 0xff, 0x80, 0x1f, 0xff, 0xff, 0xff, 0x00, 0x0f, 0xff, 0xff, 0xfe, 0x00,
-        0x01, 0xff, 0xff, 0xf0, 0x00, 0x00, 0xff, 0xff, 0xe0, 0x00, 0x07, 0x9f, 0xff, 0x3c, 0x00,
-        0x1e, 0x07, 0xfc, 0x0f, 0x00, 0x38, 0x01, 0xe0, 0x03, 0x80, 0x30, 0x00, 0x00, 0x01, 0x80,
-        0x38, 0x00, 0x00, 0x03, 0x80, 0x0e, 0x00, 0x00, 0x0e, 0x00, 0x03, 0xc0, 0x00, 0x78, 0x00,
-        0x01, 0xf0, 0x01, 0xf0, 0x00, 0x07, 0xfc, 0x07, 0xfc, 0x00, 0x1f, 0xff, 0x1f, 0xff, 0x00,
-        0x3f, 0xff, 0xff, 0xff, 0x80, 0x3f, 0xff, 0xff, 0xff, 0x80, 0x1f, 0xff, 0xff, 0xff, 0x00,
-        0x07, 0xff, 0xff, 0xfc, 0x00, 0x00, 0xff, 0xff, 0xf0, 0x00, 0x00, 0x3f, 0xff, 0x80, 0x00,
-        0x00, 0x0f, 0xfe, 0x00, 0x00, 0x00, 0x03, 0xf8, 0x00, 0x00, 0x00, 0x00, 0xe0, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t layers_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xb3, 0xf0, 0xe9, 0xf0, 0x9d, 0xf0, 0x5f,
+    0x02, 0xf0, 0x1f, 0x06, 0xcf, 0x0a, 0x8f, 0x0e, 0x5f, 0x0f, 0x01, 0x5f,
+    0x0e, 0x7f, 0x0c, 0xbf, 0x06, 0xff, 0x04, 0xd4, 0x2d, 0x24, 0x84, 0x69,
+    0x64, 0x53, 0xa4, 0xb3, 0x42, 0xf0, 0xc2, 0x43, 0xf0, 0xa3, 0x63, 0xf0,
+    0x63, 0xa4, 0xf4, 0xd5, 0xb5, 0xc9, 0x79, 0x8d, 0x3d, 0x5f, 0x0f, 0x01,
+    0x4f, 0x0f, 0x01, 0x5f, 0x0e, 0x8f, 0x0a, 0xdf, 0x05, 0xf0, 0x2f, 0xf0,
+    0x7b, 0xf0, 0xb7, 0xf0, 0xf3, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
 };
 
-const lv_img_dsc_t layers = {
-    .header.always_zero = 0,
-    .header.w = 35,
-    .header.h = 35,
-    .data_size = 183,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = layers_map,
-};
+const lv_img_dsc_t layers = ZMK_RLE_IMAGE(layers_map, 35, 35);
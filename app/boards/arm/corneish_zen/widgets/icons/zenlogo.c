@@ -5,54 +5,34 @@
  *
  */
 
-#include <lvgl.h>
+#include <zmk/display/rle_image.h>
 
-#ifndef LV_ATTRIBUTE_MEM_ALIGN
-#define LV_ATTRIBUTE_MEM_ALIGN
-#endif
-
-#ifndef LV_ATTRIBUTE_IMG_ZENLOGO
-#define LV_ATTRIBUTE_IMG_ZENLOGO
-#endif
-
-const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_ZENLOGO uint8_t
-    zenlogo_map[] = {
-        0xff, 0xff, 0xff, 0xff, /*Color of index 0*/
-        0x00, 0x00, 0x00, 0xff, /*Color of index 1*/
-
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x02, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0xe3, 0xe3, 0x9e,
-        0x3e, 0x02, 0x72, 0xe0, 0x00, 0x00, 0x06, 0x36, 0x36, 0x33, 0x63, 0x02, 0x8b, 0x10, 0x00,
-        0x00, 0x04, 0x14, 0x14, 0x21, 0x41, 0x02, 0x82, 0x10, 0x00, 0x00, 0x04, 0x04, 0x14, 0x21,
-        0x7f, 0x7a, 0x72, 0x10, 0x00, 0x00, 0x04, 0x04, 0x14, 0x21, 0x40, 0x02, 0x0a, 0x10, 0x00,
-        0x00, 0x04, 0x14, 0x14, 0x21, 0x41, 0x02, 0x0a, 0x10, 0x00, 0x00, 0x06, 0x36, 0x34, 0x21,
-        0x63, 0x02, 0x8a, 0x10, 0x00, 0x00, 0x03, 0xe3, 0xe4, 0x21, 0x3e, 0x02, 0x72, 0x10, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x03, 0xfc,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x07, 0xe0, 0x00, 0x00, 0x00, 0xff, 0xf1,
-        0xf8, 0x00, 0x60, 0x0f, 0xc0, 0x00, 0x00, 0x0f, 0xff, 0xfb, 0xff, 0xe0, 0xf8, 0x1f, 0x80,
-        0x00, 0x03, 0xff, 0xff, 0xff, 0xff, 0xc1, 0xfc, 0x1f, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
-        0xff, 0xc1, 0xfc, 0x1f, 0x00, 0x7f, 0xc0, 0x1f, 0xff, 0xff, 0xe0, 0x01, 0xfc, 0x3e, 0x00,
-        0x40, 0x1f, 0xff, 0xe0, 0xff, 0xc0, 0x07, 0xfc, 0xfc, 0x00, 0xdf, 0xff, 0x80, 0x01, 0xff,
-        0xc0, 0x0f, 0xdc, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x0f, 0xff, 0x8f, 0x1f, 0x9f, 0xf8, 0x00,
-        0x00, 0x00, 0x00, 0x1f, 0xef, 0xff, 0x1f, 0x9f, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x8f,
-        0xff, 0x3f, 0x1f, 0xf0, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x1f, 0xfe, 0x3f, 0x0f, 0xf0, 0x00,
-        0x00, 0x00, 0x03, 0xf8, 0x1f, 0x80, 0x7e, 0x0f, 0xe0, 0x00, 0x00, 0x00, 0x07, 0xe0, 0x3e,
-        0x00, 0x7e, 0x0f, 0xe0, 0x00, 0x00, 0x00, 0x0f, 0xc0, 0x3c, 0x00, 0x7e, 0x0f, 0xc0, 0x00,
-        0x00, 0x00, 0x1f, 0xf8, 0x3c, 0x00, 0x78, 0x0f, 0xc0, 0x00, 0x00, 0x00, 0x1f, 0xff, 0xbc,
-        0x00, 0x78, 0x0f, 0xc0, 0x00, 0x00, 0x00, 0x1f, 0xff, 0xfc, 0x00, 0xf8, 0x0f, 0xc0, 0x00,
-        0x00, 0x00, 0x1f, 0xff, 0xfc, 0x0f, 0xf0, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xff, 0xff,
-        0xff, 0xf8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0f, 0xff, 0x0f, 0xff, 0xa0, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00,
+static const uint8_t zenlogo_map[] = {
+    ZMK_RLE_IMAGE_RUNS_4,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xe1, 0x71, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xb1, 0x71, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0x41, 0xf0, 0xf0,
+    0x15, 0x35, 0x33, 0x24, 0x35, 0x71, 0x23, 0x21, 0x13, 0xf0, 0xb2, 0x32,
+    0x12, 0x32, 0x12, 0x32, 0x22, 0x12, 0x32, 0x61, 0x11, 0x31, 0x12, 0x31,
+    0xf0, 0xa1, 0x51, 0x11, 0x51, 0x11, 0x41, 0x41, 0x11, 0x51, 0x61, 0x11,
+    0x51, 0x41, 0xf0, 0xa1, 0x71, 0x51, 0x11, 0x41, 0x41, 0x17, 0x14, 0x11,
+    0x23, 0x21, 0x41, 0xf0, 0xa1, 0x71, 0x51, 0x11, 0x41, 0x41, 0x11, 0xc1,
+    0x51, 0x11, 0x41, 0xf0, 0xa1, 0x51, 0x11, 0x51, 0x11, 0x41, 0x41, 0x11,
+    0x51, 0x61, 0x51, 0x11, 0x41, 0xf0, 0xa2, 0x32, 0x12, 0x32, 0x11, 0x41,
+    0x41, 0x12, 0x32, 0x61, 0x11, 0x31, 0x11, 0x41, 0xf0, 0xb5, 0x35, 0x21,
+    0x41, 0x41, 0x25, 0x71, 0x23, 0x21, 0x41, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0x16, 0xf0, 0xf0, 0xd1, 0xf0, 0xb8,
+    0xf0, 0xf0, 0xd5, 0xf0, 0x86, 0xf0, 0xec, 0x36, 0xc2, 0x96, 0xf0, 0xbf,
+    0x02, 0x1d, 0x55, 0x66, 0xf0, 0x6f, 0x0f, 0x06, 0x57, 0x55, 0xf0, 0x1f,
+    0x0f, 0x0c, 0x57, 0x55, 0x99, 0x9f, 0x09, 0xc7, 0x45, 0xa1, 0x9f, 0x01,
+    0x5a, 0xb9, 0x26, 0xa2, 0x1e, 0xeb, 0xa6, 0x13, 0x25, 0xf0, 0xf0, 0x9d,
+    0x34, 0x36, 0x2a, 0xf0, 0xf0, 0x88, 0x1c, 0x36, 0x29, 0xf0, 0xf0, 0x78,
+    0x3c, 0x26, 0x39, 0xf0, 0xf0, 0x67, 0x4c, 0x36, 0x48, 0xf0, 0xf0, 0x47,
+    0x66, 0x86, 0x57, 0xf0, 0xf0, 0x46, 0x75, 0xa6, 0x57, 0xf0, 0xf0, 0x36,
+    0x84, 0xb6, 0x56, 0xf0, 0xf0, 0x3a, 0x54, 0xb4, 0x76, 0xf0, 0xf0, 0x3e,
+    0x14, 0xb4, 0x76, 0xf0, 0xf0, 0x3f, 0x04, 0xa5, 0x76, 0xf0, 0xf0, 0x3f,
+    0x04, 0x68, 0x84, 0xf0, 0xf0, 0x5f, 0x0f, 0x04, 0x92, 0xf0, 0xf0, 0x6c,
+    0x4d, 0x11, 0xf0, 0xf0, 0xf0, 0xf0, 0x68, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0,
 };
 
-const lv_img_dsc_t zenlogo = {
-    .header.always_zero = 0,
-    .header.w = 80,
-    .header.h = 38,
-    .data_size = 388,
-    .header.cf = LV_IMG_CF_INDEXED_1BIT,
-    .data = zenlogo_map,
-};
+const lv_img_dsc_t zenlogo = ZMK_RLE_IMAGE(zenlogo_map, 80, 38);
@@ -9,56 +9,42 @@
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include "layer_status.h"
-#include <zmk/events/layer_state_changed.h>
-#include <zmk/event_manager.h>
-#include <zmk/endpoints.h>
-#include <zmk/keymap.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct layer_status_state {
-    uint8_t index;
-    const char *label;
-};
-
-static void set_layer_symbol(lv_obj_t *label, struct layer_status_state state) {
-    const char *layer_label = state.label;
-    uint8_t active_layer_index = state.index;
+static void set_layer_symbol(struct zmk_widget_layer_status *widget,
+                             const struct zmk_display_status *status) {
+    const char *layer_label = status->layer_label;
+    uint8_t active_layer_index = status->layer_index;
 
     if (layer_label == NULL) {
-        char text[6] = {};
+        snprintf(widget->text, sizeof(widget->text), " %i", active_layer_index);
 
-        sprintf(text, " %i", active_layer_index);
-
-        lv_label_set_text(label, text);
+        lv_label_set_text_static(widget->obj, widget->text);
     } else {
-        lv_label_set_text(label, layer_label);
+        // Layer labels come from the devicetree, so they outlive the label.
+        lv_label_set_text_static(widget->obj, layer_label);
     }
 }
 
-static void layer_status_update_cb(struct layer_status_state state) {
+static void layer_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_layer_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_layer_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_layer_symbol(widget, status); }
 }
 
-static struct layer_status_state layer_status_get_state(const zmk_event_t *eh) {
-    uint8_t index = zmk_keymap_highest_layer_active();
-    return (struct layer_status_state){.index = index, .label = zmk_keymap_layer_label(index)};
-}
-
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layer_status, struct layer_status_state, layer_status_update_cb,
-                            layer_status_get_state)
-
-ZMK_SUBSCRIPTION(widget_layer_status, zmk_layer_state_changed);
+static struct zmk_display_status_listener layer_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_LAYER,
+    .update = layer_status_update_cb,
+};
 
 int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_t *parent) {
     widget->obj = lv_label_create(parent, NULL);
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_layer_status_init();
+    zmk_display_status_subscribe(&layer_status_listener);
     return 0;
 }
 
@@ -13,6 +13,8 @@
 struct zmk_widget_layer_status {
     sys_snode_t node;
     lv_obj_t *obj;
+    // Shown for layers without a label, instead of a copy in the LVGL heap.
+    char text[6];
 };
 
 int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_t *parent);
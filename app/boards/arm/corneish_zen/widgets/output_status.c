@@ -6,20 +6,12 @@
  */
 
 #include <kernel.h>
-#include <bluetooth/services/bas.h>
 
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include "output_status.h"
-#include <zmk/event_manager.h>
-#include <zmk/events/usb_conn_state_changed.h>
-#include <zmk/events/ble_active_profile_changed.h>
-#include <zmk/events/endpoint_selection_changed.h>
-#include <zmk/usb.h>
-#include <zmk/ble.h>
-#include <zmk/endpoints.h>
 
 LV_IMG_DECLARE(bluetooth_advertising);
 LV_IMG_DECLARE(bluetooth_connected_right);
@@ -38,32 +30,16 @@ LV_IMG_DECLARE(USB_connected);
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct output_status_state {
-    enum zmk_endpoint selected_endpoint;
-    bool active_profile_connected;
-    bool active_profile_bonded;
-    uint8_t active_profile_index;
-};
-
-static struct output_status_state get_state(const zmk_event_t *_eh) {
-    return (struct output_status_state){.selected_endpoint = zmk_endpoints_selected(),
-                                        .active_profile_connected =
-                                            zmk_ble_active_profile_is_connected(),
-                                        .active_profile_bonded = !zmk_ble_active_profile_is_open(),
-                                        .active_profile_index = zmk_ble_active_profile_index()};
-    ;
-}
-
-static void set_status_symbol(lv_obj_t *icon, struct output_status_state state) {
-    switch (state.selected_endpoint) {
+static void set_status_symbol(lv_obj_t *icon, const struct zmk_display_status *status) {
+    switch (status->selected_endpoint) {
     case ZMK_ENDPOINT_USB:
         lv_img_set_src(icon, &USB_connected);
         break;
     case ZMK_ENDPOINT_BLE:
-        if (state.active_profile_bonded) {
-            if (state.active_profile_connected) {
+        if (status->active_profile_bonded) {
+            if (status->active_profile_connected) {
                 // sprintf(text, LV_SYMBOL_BLUETOOTH "%i " LV_SYMBOL_OK, active_profile_index);
-                switch (state.active_profile_index) {
+                switch (status->active_profile_index) {
                 case 0:
                     lv_img_set_src(icon, &bluetooth_connected_1);
                     break;
@@ -84,7 +60,7 @@ static void set_status_symbol(lv_obj_t *icon, struct output_status_state state)
                 lv_img_set_src(icon, &bluetooth_disconnected_right);
             }
         } else {
-            switch (state.active_profile_index) {
+            switch (status->active_profile_index) {
             case 0:
                 lv_img_set_src(icon, &bluetooth_advertising_1);
                 break;
@@ -106,21 +82,15 @@ static void set_status_symbol(lv_obj_t *icon, struct output_status_state state)
     }
 }
 
-static void output_status_update_cb(struct output_status_state state) {
+static void output_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_output_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, status); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_output_status, struct output_status_state,
-                            output_status_update_cb, get_state)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_endpoint_selection_changed);
-
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_usb_conn_state_changed);
-#endif
-#if defined(CONFIG_ZMK_BLE)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_ble_active_profile_changed);
-#endif
+static struct zmk_display_status_listener output_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_OUTPUT,
+    .update = output_status_update_cb,
+};
 
 int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_obj_t *parent) {
     widget->obj = lv_img_create(parent, NULL);
@@ -129,7 +99,7 @@ int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_ob
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_output_status_init();
+    zmk_display_status_subscribe(&output_status_listener);
     return 0;
 }
 
@@ -17,6 +17,9 @@
 #include "il0323_regs.h"
 
 #include <logging/log.h>
+
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_REGISTER(il0323, CONFIG_DISPLAY_LOG_LEVEL);
 
 /**
@@ -51,7 +54,17 @@ LOG_MODULE_REGISTER(il0323, CONFIG_DISPLAY_LOG_LEVEL);
 #define IL0323_PANEL_LAST_GATE (EPD_PANEL_HEIGHT - 1)
 #define IL0323_PANEL_FIRST_PAGE 0U
 #define IL0323_PANEL_LAST_PAGE (IL0323_NUMOF_PAGES - 1)
-#define IL0323_BUFFER_SIZE 1280
+#define IL0323_BUFFER_SIZE (IL0323_NUMOF_PAGES * EPD_PANEL_HEIGHT)
+
+enum il0323_state {
+    IL0323_STATE_IDLE,
+    /* Sending what the window shows now */
+    IL0323_STATE_OLD_DATA,
+    /* Sending what the window should show */
+    IL0323_STATE_NEW_DATA,
+    /* Waiting for the panel to finish refreshing */
+    IL0323_STATE_REFRESH,
+};
 
 struct il0323_data {
     const struct device *reset;
@@ -62,12 +75,41 @@ struct il0323_data {
 #if defined(IL0323_CS_CNTRL)
     struct spi_cs_control cs_ctrl;
 #endif
+    struct gpio_callback busy_cb;
+    /* Starts sending the pending frame */
+    struct k_work frame_work;
+    /* Waits for BUSY to be released after a refresh */
+    struct k_work_delayable busy_work;
+#if defined(CONFIG_SPI_ASYNC)
+    /* Continues the refresh sequence once a data transfer is done */
+    struct k_work_poll spi_work;
+    struct k_poll_signal spi_signal;
+    struct k_poll_event spi_event;
+    struct spi_buf spi_buf;
+    struct spi_buf_set spi_buf_set;
+#endif
+    enum il0323_state state;
+    /* Window being sent, in pages and gates */
+    uint16_t window_page;
+    uint16_t window_pages;
+    uint16_t window_gate;
+    uint16_t window_gates;
 };
 
 static uint8_t il0323_pwr[] = DT_INST_PROP(0, pwr);
 
+/* What the panel currently shows, one row of IL0323_NUMOF_PAGES bytes per gate */
 static uint8_t last_buffer[IL0323_BUFFER_SIZE];
+/* The latest frame written by the caller, waiting to be sent to the panel */
+static uint8_t next_buffer[IL0323_BUFFER_SIZE];
+/* Window data is gathered here so each of DTM1 and DTM2 is one transfer */
+static uint8_t window_buffer[IL0323_BUFFER_SIZE];
+/* Protects next_buffer */
+static struct k_spinlock next_buffer_lock;
 static bool blanking_on = true;
+#if CONFIG_IL0323_FULL_REFRESH_INTERVAL > 0
+static uint16_t partial_refresh_count;
+#endif
 
 static inline int il0323_write_cmd(struct il0323_data *driver, uint8_t cmd, uint8_t *data,
                                    size_t len) {
@@ -91,6 +133,44 @@ static inline int il0323_write_cmd(struct il0323_data *driver, uint8_t cmd, uint
     return 0;
 }
 
+/*
+ * Send a command with a large amount of data. Returns 1 if the data is still being sent, in which
+ * case the refresh sequence continues from spi_work once it is done.
+ */
+static int il0323_write_cmd_start(struct il0323_data *driver, uint8_t cmd, uint8_t *data,
+                                  size_t len) {
+#if defined(CONFIG_SPI_ASYNC)
+    if (il0323_write_cmd(driver, cmd, NULL, 0)) {
+        return -EIO;
+    }
+
+    driver->spi_buf.buf = data;
+    driver->spi_buf.len = len;
+    gpio_pin_set(driver->dc, IL0323_DC_PIN, 0);
+    k_poll_signal_reset(&driver->spi_signal);
+
+    int err = spi_write_async(driver->spi_dev, &driver->spi_config, &driver->spi_buf_set,
+                              &driver->spi_signal);
+    if (err == -ENOTSUP) {
+        /* Not every SPI controller can transfer asynchronously */
+        return spi_write(driver->spi_dev, &driver->spi_config, &driver->spi_buf_set) ? -EIO : 0;
+    }
+
+    if (err) {
+        return -EIO;
+    }
+
+    err = k_work_poll_submit(&driver->spi_work, &driver->spi_event, 1, K_FOREVER);
+    if (err) {
+        return err;
+    }
+
+    return 1;
+#else
+    return il0323_write_cmd(driver, cmd, data, len);
+#endif
+}
+
 static inline void il0323_busy_wait(struct il0323_data *driver) {
     int pin = gpio_pin_get(driver->busy, IL0323_BUSY_PIN);
 
@@ -102,36 +182,267 @@ static inline void il0323_busy_wait(struct il0323_data *driver) {
     }
 }
 
-static int il0323_update_display(const struct device *dev) {
-    struct il0323_data *driver = dev->data;
+/* Setup Partial Window and enable Partial Mode */
+static int il0323_window_begin(struct il0323_data *driver) {
+    uint8_t ptl[IL0323_PTL_REG_LENGTH] = {0};
 
-    LOG_DBG("Trigger update sequence");
-    if (il0323_write_cmd(driver, IL0323_CMD_DRF, NULL, 0)) {
+    ptl[IL0323_PTL_HRST_IDX] = driver->window_page * IL0323_PIXELS_PER_BYTE;
+    ptl[IL0323_PTL_HRED_IDX] =
+        (driver->window_page + driver->window_pages) * IL0323_PIXELS_PER_BYTE - 1;
+    ptl[IL0323_PTL_VRST_IDX] = driver->window_gate;
+    ptl[IL0323_PTL_VRED_IDX] = driver->window_gate + driver->window_gates - 1;
+    ptl[sizeof(ptl) - 1] = IL0323_PTL_PT_SCAN;
+    LOG_HEXDUMP_DBG(ptl, sizeof(ptl), "ptl");
+
+    if (il0323_write_cmd(driver, IL0323_CMD_PIN, NULL, 0)) {
         return -EIO;
     }
 
-    k_msleep(IL0323_BUSY_DELAY);
+    if (il0323_write_cmd(driver, IL0323_CMD_PTL, ptl, sizeof(ptl))) {
+        return -EIO;
+    }
 
     return 0;
 }
 
+/*
+ * Update partial window and disable Partial Mode. Returns 1 if the panel is refreshing, in which
+ * case the refresh sequence continues from busy_work once it is done.
+ */
+static int il0323_window_end(struct il0323_data *driver) {
+    bool refresh = blanking_on == false;
+
+    if (refresh) {
+        LOG_DBG("Trigger update sequence");
+        if (il0323_write_cmd(driver, IL0323_CMD_DRF, NULL, 0)) {
+            return -EIO;
+        }
+    }
+
+    if (il0323_write_cmd(driver, IL0323_CMD_POUT, NULL, 0)) {
+        return -EIO;
+    }
+
+    if (!refresh) {
+        return 0;
+    }
+
+    /* Give the panel time to raise BUSY before checking it */
+    k_work_schedule(&driver->busy_work, K_MSEC(IL0323_BUSY_DELAY));
+
+    return 1;
+}
+
+/* Copy a window of full-width rows into window_buffer */
+static void il0323_gather_window(struct il0323_data *driver, const uint8_t *frame) {
+    for (uint16_t r = 0; r < driver->window_gates; r++) {
+        memcpy(&window_buffer[r * driver->window_pages],
+               &frame[(driver->window_gate + r) * IL0323_NUMOF_PAGES + driver->window_page],
+               driver->window_pages);
+    }
+}
+
+/*
+ * Take the pending frame, if anything in it changed, and put what the changed window shows now into
+ * window_buffer.
+ */
+static bool il0323_take_frame(struct il0323_data *driver) {
+    uint16_t row_start = UINT16_MAX, row_end = 0;
+    uint16_t page_start = UINT16_MAX, page_end = 0;
+    k_spinlock_key_t key = k_spin_lock(&next_buffer_lock);
+
+    /* Find the rows and pages that differ from what the panel shows */
+    for (uint16_t r = 0; r < EPD_PANEL_HEIGHT; r++) {
+        for (uint16_t p = 0; p < IL0323_NUMOF_PAGES; p++) {
+            const size_t i = r * IL0323_NUMOF_PAGES + p;
+
+            if (last_buffer[i] != next_buffer[i]) {
+                row_start = MIN(row_start, r);
+                row_end = r;
+                page_start = MIN(page_start, p);
+                page_end = MAX(page_end, p);
+            }
+        }
+    }
+
+    if (row_start == UINT16_MAX) {
+        k_spin_unlock(&next_buffer_lock, key);
+        return false;
+    }
+
+#if CONFIG_IL0323_FULL_REFRESH_INTERVAL > 0
+    /*
+     * Partial refreshes only drive the pixels that changed, which slowly leaves ghosts of earlier
+     * images. Claiming every pixel was the opposite of what it is drives all of them once.
+     */
+    if (blanking_on == false && ++partial_refresh_count >= CONFIG_IL0323_FULL_REFRESH_INTERVAL) {
+        LOG_DBG("Full refresh to clear ghosting");
+        partial_refresh_count = 0;
+
+        memcpy(last_buffer, next_buffer, IL0323_BUFFER_SIZE);
+        k_spin_unlock(&next_buffer_lock, key);
+
+        for (size_t i = 0; i < IL0323_BUFFER_SIZE; i++) {
+            window_buffer[i] = ~last_buffer[i];
+        }
+
+        driver->window_page = 0;
+        driver->window_pages = IL0323_NUMOF_PAGES;
+        driver->window_gate = 0;
+        driver->window_gates = EPD_PANEL_HEIGHT;
+        return true;
+    }
+#endif
+
+    driver->window_page = page_start;
+    driver->window_pages = page_end - page_start + 1;
+    driver->window_gate = row_start;
+    driver->window_gates = row_end - row_start + 1;
+
+    il0323_gather_window(driver, last_buffer);
+
+    for (uint16_t r = row_start; r <= row_end; r++) {
+        memcpy(&last_buffer[r * IL0323_NUMOF_PAGES + page_start],
+               &next_buffer[r * IL0323_NUMOF_PAGES + page_start], driver->window_pages);
+    }
+
+    k_spin_unlock(&next_buffer_lock, key);
+
+    return true;
+}
+
+/*
+ * Run the refresh sequence until it has to wait for the SPI bus or the panel. Each step returns 0
+ * if it finished right away, or 1 if something calls this again once it is done.
+ */
+static void il0323_run(struct il0323_data *driver) {
+    int ret;
+
+    do {
+        switch (driver->state) {
+        case IL0323_STATE_IDLE:
+            if (!il0323_take_frame(driver)) {
+                return;
+            }
+
+            LOG_DBG("Sending window at page %u, gate %u, %u pages by %u gates",
+                    driver->window_page, driver->window_gate, driver->window_pages,
+                    driver->window_gates);
+
+            /* Send what the changed window shows now, then what it should show */
+            driver->state = IL0323_STATE_OLD_DATA;
+            ret = il0323_window_begin(driver);
+            if (ret == 0) {
+                ret = il0323_write_cmd_start(driver, IL0323_CMD_DTM1, window_buffer,
+                                             driver->window_pages * driver->window_gates);
+            }
+            break;
+        case IL0323_STATE_OLD_DATA:
+            driver->state = IL0323_STATE_NEW_DATA;
+            il0323_gather_window(driver, last_buffer);
+            ret = il0323_write_cmd_start(driver, IL0323_CMD_DTM2, window_buffer,
+                                         driver->window_pages * driver->window_gates);
+            break;
+        case IL0323_STATE_NEW_DATA:
+            driver->state = IL0323_STATE_REFRESH;
+            ret = il0323_window_end(driver);
+            break;
+        case IL0323_STATE_REFRESH:
+            /* Send the frame that was written while the panel was busy, if any */
+            driver->state = IL0323_STATE_IDLE;
+            ret = 0;
+            break;
+        default:
+            ret = -EINVAL;
+            break;
+        }
+    } while (ret == 0);
+
+    if (ret < 0) {
+        LOG_ERR("Failed to update the display: %d", ret);
+        driver->state = IL0323_STATE_IDLE;
+    }
+}
+
+static void il0323_frame_work_handler(struct k_work *work) {
+    struct il0323_data *driver = CONTAINER_OF(work, struct il0323_data, frame_work);
+
+    /* A frame written mid-refresh is sent once the refresh sequence gets back to idle */
+    if (driver->state == IL0323_STATE_IDLE) {
+        il0323_run(driver);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(il0323_frame_work_handler)
+
+#if defined(CONFIG_SPI_ASYNC)
+static void il0323_spi_work_handler(struct k_work *work) {
+    struct k_work_poll *pwork = CONTAINER_OF(work, struct k_work_poll, work);
+    struct il0323_data *driver = CONTAINER_OF(pwork, struct il0323_data, spi_work);
+    unsigned int signaled;
+    int result;
+
+    k_poll_signal_check(&driver->spi_signal, &signaled, &result);
+    if (result) {
+        LOG_ERR("Failed to send display data: %d", result);
+        driver->state = IL0323_STATE_IDLE;
+        return;
+    }
+
+    il0323_run(driver);
+}
+#endif
+
+static void il0323_busy_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct il0323_data *driver = CONTAINER_OF(dwork, struct il0323_data, busy_work);
+
+    if (driver->state != IL0323_STATE_REFRESH) {
+        return;
+    }
+
+    if (gpio_pin_get(driver->busy, IL0323_BUSY_PIN) > 0) {
+        gpio_pin_interrupt_configure(driver->busy, IL0323_BUSY_PIN, GPIO_INT_EDGE_TO_INACTIVE);
+
+        /* BUSY may have been released before the interrupt was enabled */
+        if (gpio_pin_get(driver->busy, IL0323_BUSY_PIN) > 0) {
+            return;
+        }
+
+        gpio_pin_interrupt_configure(driver->busy, IL0323_BUSY_PIN, GPIO_INT_DISABLE);
+    }
+
+    il0323_run(driver);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(il0323_busy_work_handler)
+
+static void il0323_busy_callback(const struct device *port, struct gpio_callback *cb,
+                                 gpio_port_pins_t pins) {
+    struct il0323_data *driver = CONTAINER_OF(cb, struct il0323_data, busy_cb);
+
+    gpio_pin_interrupt_configure(driver->busy, IL0323_BUSY_PIN, GPIO_INT_DISABLE);
+    k_work_reschedule(&driver->busy_work, K_NO_WAIT);
+}
+
 static int il0323_write(const struct device *dev, const uint16_t x, const uint16_t y,
                         const struct display_buffer_descriptor *desc, const void *buf) {
     struct il0323_data *driver = dev->data;
     uint16_t x_end_idx = x + desc->width - 1;
     uint16_t y_end_idx = y + desc->height - 1;
-    uint8_t ptl[IL0323_PTL_REG_LENGTH] = {0};
+    const uint8_t *data = buf;
     size_t buf_len;
 
     LOG_DBG("x %u, y %u, height %u, width %u, pitch %u", x, y, desc->height, desc->width,
             desc->pitch);
 
-    buf_len = MIN(desc->buf_size, desc->height * desc->width / IL0323_PIXELS_PER_BYTE);
+    buf_len = MIN(desc->buf_size, desc->height * desc->pitch / IL0323_PIXELS_PER_BYTE);
     __ASSERT(desc->width <= desc->pitch, "Pitch is smaller then width");
     __ASSERT(buf != NULL, "Buffer is not available");
     __ASSERT(buf_len != 0U, "Buffer of length zero");
     __ASSERT(!(desc->width % IL0323_PIXELS_PER_BYTE), "Buffer width not multiple of %d",
              IL0323_PIXELS_PER_BYTE);
+    __ASSERT(!(x % IL0323_PIXELS_PER_BYTE), "X not multiple of %d", IL0323_PIXELS_PER_BYTE);
 
     LOG_DBG("buf_len %d", buf_len);
     if ((y_end_idx > (EPD_PANEL_HEIGHT - 1)) || (x_end_idx > (EPD_PANEL_WIDTH - 1))) {
@@ -139,43 +450,24 @@ static int il0323_write(const struct device *dev, const uint16_t x, const uint16
         return -EINVAL;
     }
 
-    /* Setup Partial Window and enable Partial Mode */
-    ptl[IL0323_PTL_HRST_IDX] = x;
-    ptl[IL0323_PTL_HRED_IDX] = x_end_idx;
-    ptl[IL0323_PTL_VRST_IDX] = y;
-    ptl[IL0323_PTL_VRED_IDX] = y_end_idx;
-    ptl[sizeof(ptl) - 1] = IL0323_PTL_PT_SCAN;
-    LOG_HEXDUMP_DBG(ptl, sizeof(ptl), "ptl");
+    const uint16_t pitch = desc->pitch / IL0323_PIXELS_PER_BYTE;
+    const uint16_t pages = desc->width / IL0323_PIXELS_PER_BYTE;
+    const uint16_t rows = MIN(desc->height, buf_len / pitch);
+    uint8_t *const next = &next_buffer[y * IL0323_NUMOF_PAGES + x / IL0323_PIXELS_PER_BYTE];
 
-    il0323_busy_wait(driver);
-    if (il0323_write_cmd(driver, IL0323_CMD_PIN, NULL, 0)) {
-        return -EIO;
-    }
+    /*
+     * Only the latest frame is kept. Writes made while the panel is busy are merged into it and
+     * sent together once the current refresh is done.
+     */
+    k_spinlock_key_t key = k_spin_lock(&next_buffer_lock);
 
-    if (il0323_write_cmd(driver, IL0323_CMD_PTL, ptl, sizeof(ptl))) {
-        return -EIO;
-    }
-
-    if (il0323_write_cmd(driver, IL0323_CMD_DTM1, last_buffer, IL0323_BUFFER_SIZE)) {
-        return -EIO;
+    for (uint16_t r = 0; r < rows; r++) {
+        memcpy(&next[r * IL0323_NUMOF_PAGES], &data[r * pitch], pages);
     }
 
-    if (il0323_write_cmd(driver, IL0323_CMD_DTM2, (uint8_t *)buf, buf_len)) {
-        return -EIO;
-    }
-
-    memcpy(last_buffer, (uint8_t *)buf, IL0323_BUFFER_SIZE);
-
-    /* Update partial window and disable Partial Mode */
-    if (blanking_on == false) {
-        if (il0323_update_display(dev)) {
-            return -EIO;
-        }
-    }
+    k_spin_unlock(&next_buffer_lock, key);
 
-    if (il0323_write_cmd(driver, IL0323_CMD_POUT, NULL, 0)) {
-        return -EIO;
-    }
+    k_work_submit(&driver->frame_work);
 
     return 0;
 }
@@ -186,48 +478,18 @@ static int il0323_read(const struct device *dev, const uint16_t x, const uint16_
     return -ENOTSUP;
 }
 
-static int il0323_clear_and_write_buffer(const struct device *dev, uint8_t pattern, bool update) {
-    struct display_buffer_descriptor desc = {
-        .buf_size = IL0323_NUMOF_PAGES,
-        .width = EPD_PANEL_WIDTH,
-        .height = 1,
-        .pitch = EPD_PANEL_WIDTH,
-    };
-    uint8_t *line;
-
-    line = k_malloc(IL0323_NUMOF_PAGES);
-    if (line == NULL) {
-        return -ENOMEM;
-    }
-
-    memset(line, pattern, IL0323_NUMOF_PAGES);
-    for (int i = 0; i < EPD_PANEL_HEIGHT; i++) {
-        il0323_write(dev, 0, i, &desc, line);
-    }
-
-    k_free(line);
-
-    if (update == true) {
-        if (il0323_update_display(dev)) {
-            return -EIO;
-        }
-    }
-
-    return 0;
-}
-
 static int il0323_blanking_off(const struct device *dev) {
     struct il0323_data *driver = dev->data;
 
     if (blanking_on) {
         /* Update EPD pannel in normal mode */
-        il0323_busy_wait(driver);
-        if (il0323_clear_and_write_buffer(dev, 0xff, true)) {
-            return -EIO;
-        }
+        k_spinlock_key_t key = k_spin_lock(&next_buffer_lock);
+        memset(next_buffer, 0xff, IL0323_BUFFER_SIZE);
+        k_spin_unlock(&next_buffer_lock, key);
     }
 
     blanking_on = false;
+    k_work_submit(&driver->frame_work);
 
     return 0;
 }
@@ -393,6 +655,24 @@ static int il0323_init(const struct device *dev) {
 
     gpio_pin_configure(driver->busy, IL0323_BUSY_PIN, GPIO_INPUT | IL0323_BUSY_FLAGS);
 
+    gpio_init_callback(&driver->busy_cb, il0323_busy_callback, BIT(IL0323_BUSY_PIN));
+    if (gpio_add_callback(driver->busy, &driver->busy_cb)) {
+        LOG_ERR("Could not set IL0323 busy callback");
+        return -EIO;
+    }
+
+    k_work_init(&driver->frame_work, ZMK_WORK_WATCHED(il0323_frame_work_handler));
+    k_work_init_delayable(&driver->busy_work, ZMK_WORK_WATCHED(il0323_busy_work_handler));
+
+#if defined(CONFIG_SPI_ASYNC)
+    k_work_poll_init(&driver->spi_work, il0323_spi_work_handler);
+    k_poll_signal_init(&driver->spi_signal);
+    k_poll_event_init(&driver->spi_event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+                      &driver->spi_signal);
+    driver->spi_buf_set.buffers = &driver->spi_buf;
+    driver->spi_buf_set.count = 1;
+#endif
+
 #if defined(IL0323_CS_CNTRL)
     driver->cs_ctrl.gpio_dev = device_get_binding(IL0323_CS_CNTRL);
     if (!driver->cs_ctrl.gpio_dev) {
@@ -126,7 +126,8 @@ static int reg_595_port_set_masked_raw(const struct device *dev, uint32_t mask,
     buf = drv_data->gpio_cache;
     buf = (buf & ~mask) | (mask & value);
 
-    ret = reg_595_write_registers(dev, buf);
+    /* The registers can't be read back, so the cache is always current */
+    ret = buf == drv_data->gpio_cache ? 0 : reg_595_write_registers(dev, buf);
 
     k_sem_give(&drv_data->lock);
     return ret;
@@ -187,7 +188,8 @@ static int reg_595_init(const struct device *dev) {
 
     k_sem_init(&drv_data->lock, 1, 1);
 
-    return 0;
+    /* Clear the outputs, so they match the cache and unchanged writes can be skipped */
+    return reg_595_write_registers(dev, 0);
 }
 
 #define GPIO_PORT_PIN_MASK_FROM_NGPIOS(ngpios) ((gpio_port_pins_t)(((uint64_t)1 << (ngpios)) - 1U))
@@ -17,12 +17,15 @@
 #include <init.h>
 #include <sys/byteorder.h>
 #include <drivers/gpio.h>
+#include <drivers/gpio/gpio_utils.h>
 #include <drivers/i2c.h>
 #include <drivers/ext_power.h>
 
 #define LOG_LEVEL CONFIG_GPIO_LOG_LEVEL
 #include <logging/log.h>
 
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_REGISTER(gpio_max7318);
 
 // Register definitions
@@ -41,6 +44,9 @@ struct max7318_config {
 
     struct i2c_dt_spec i2c_bus;
     uint8_t ngpios;
+
+    // Controller GPIO connected to INT, if any
+    struct gpio_dt_spec int_gpio;
 };
 
 // Runtime driver data
@@ -55,6 +61,20 @@ struct max7318_drv_data {
         uint16_t config;
         uint16_t output;
     } reg_cache;
+
+    const struct device *dev;
+    struct gpio_callback int_gpio_cb;
+    // Reads the inputs after an interrupt, which can't be done from the ISR
+    struct k_work int_work;
+    sys_slist_t callbacks;
+    // Inputs as of the last interrupt, to find which pins changed
+    uint16_t int_input;
+    // Pins with level interrupts enabled
+    uint16_t int_level;
+    // Pins which should interrupt while high or on a rising edge
+    uint16_t int_high;
+    // Pins which should interrupt while low or on a falling edge
+    uint16_t int_low;
 };
 
 /**
@@ -121,8 +141,8 @@ static int write_registers(const struct device *dev, uint8_t reg, uint16_t value
  */
 static int set_pin_direction(const struct device *dev, uint32_t pin, int flags) {
     struct max7318_drv_data *const drv_data = (struct max7318_drv_data *const)dev->data;
-    uint16_t *dir = &drv_data->reg_cache.config;
-    uint16_t *output = &drv_data->reg_cache.output;
+    uint16_t dir = drv_data->reg_cache.config;
+    uint16_t output = drv_data->reg_cache.output;
 
     /*
         The output register is 1=high, 0=low; the direction (config) register
@@ -130,21 +150,33 @@ static int set_pin_direction(const struct device *dev, uint32_t pin, int flags)
     */
     if ((flags & GPIO_OUTPUT) != 0U) {
         if ((flags & GPIO_OUTPUT_INIT_HIGH) != 0U) {
-            *output |= BIT(pin);
+            output |= BIT(pin);
         } else if ((flags & GPIO_OUTPUT_INIT_LOW) != 0U) {
-            *output &= ~BIT(pin);
+            output &= ~BIT(pin);
         }
-        *dir &= ~BIT(pin);
+        dir &= ~BIT(pin);
     } else {
-        *dir |= BIT(pin);
+        dir |= BIT(pin);
     }
 
-    int ret = write_registers(dev, REG_OUTPUT_PORTA, *output);
-    if (ret != 0) {
-        return ret;
+    // The registers are cached, so skip writes that wouldn't change anything
+    if (output != drv_data->reg_cache.output) {
+        int ret = write_registers(dev, REG_OUTPUT_PORTA, output);
+        if (ret != 0) {
+            return ret;
+        }
+        drv_data->reg_cache.output = output;
     }
 
-    return write_registers(dev, REG_CONFIG_PORTA, *dir);
+    if (dir != drv_data->reg_cache.config) {
+        int ret = write_registers(dev, REG_CONFIG_PORTA, dir);
+        if (ret != 0) {
+            return ret;
+        }
+        drv_data->reg_cache.config = dir;
+    }
+
+    return 0;
 }
 
 /**
@@ -237,9 +269,12 @@ static int max7318_port_set_masked_raw(const struct device *dev, uint32_t mask,
     uint16_t buf = drv_data->reg_cache.output;
     buf = (buf & ~mask) | (mask & value);
 
-    int ret = write_registers(dev, REG_OUTPUT_PORTA, buf);
-    if (ret == 0) {
-        drv_data->reg_cache.output = buf;
+    int ret = 0;
+    if (buf != drv_data->reg_cache.output) {
+        ret = write_registers(dev, REG_OUTPUT_PORTA, buf);
+        if (ret == 0) {
+            drv_data->reg_cache.output = buf;
+        }
     }
 
     k_sem_give(&drv_data->lock);
@@ -278,7 +313,118 @@ static int max7318_port_toggle_bits(const struct device *dev, uint32_t mask) {
 
 static int max7318_pin_interrupt_configure(const struct device *dev, gpio_pin_t pin,
                                            enum gpio_int_mode mode, enum gpio_int_trig trig) {
-    return -ENOTSUP;
+    const struct max7318_config *config = dev->config;
+    struct max7318_drv_data *const drv_data = (struct max7318_drv_data *const)dev->data;
+
+    if (!config->int_gpio.port) {
+        return -ENOTSUP;
+    }
+
+    if (mode == GPIO_INT_MODE_LEVEL && trig == GPIO_INT_TRIG_BOTH) {
+        return -ENOTSUP;
+    }
+
+    const bool enable = mode != GPIO_INT_MODE_DISABLED;
+
+    // INT asserts on any input change, so there are no registers to set. Which pins and edges
+    // fire is filtered when the interrupt is handled.
+    k_sem_take(&drv_data->lock, K_FOREVER);
+
+    WRITE_BIT(drv_data->int_level, pin, mode == GPIO_INT_MODE_LEVEL);
+    WRITE_BIT(drv_data->int_high, pin, enable && (trig & GPIO_INT_HIGH_1));
+    WRITE_BIT(drv_data->int_low, pin, enable && (trig & GPIO_INT_LOW_0));
+
+    k_sem_give(&drv_data->lock);
+
+    // INT only asserts on changes, so check whether a level interrupt is already active.
+    if (mode == GPIO_INT_MODE_LEVEL) {
+        k_work_submit(&drv_data->int_work);
+    }
+
+    return 0;
+}
+
+static int max7318_manage_callback(const struct device *dev, struct gpio_callback *callback,
+                                   bool set) {
+    struct max7318_drv_data *const drv_data = (struct max7318_drv_data *const)dev->data;
+
+    return gpio_manage_callback(&drv_data->callbacks, callback, set);
+}
+
+static void max7318_int_work_handler(struct k_work *work) {
+    struct max7318_drv_data *const drv_data =
+        CONTAINER_OF(work, struct max7318_drv_data, int_work);
+    const struct device *dev = drv_data->dev;
+
+    k_sem_take(&drv_data->lock, K_FOREVER);
+
+    uint16_t input = 0;
+    uint32_t fired = 0;
+
+    // Reading the inputs also clears INT
+    int ret = read_registers(dev, REG_INPUT_PORTA, &input);
+    if (ret == 0) {
+        const uint16_t edge = (input ^ drv_data->int_input) & ~drv_data->int_level;
+        const uint16_t level = drv_data->int_level;
+
+        fired = (edge & input & drv_data->int_high) | (edge & ~input & drv_data->int_low) |
+                (level & input & drv_data->int_high) | (level & ~input & drv_data->int_low);
+        drv_data->int_input = input;
+    } else {
+        LOG_ERR("failed to read inputs after an interrupt (%d)", ret);
+    }
+
+    k_sem_give(&drv_data->lock);
+
+    if (fired) {
+        gpio_fire_callbacks(&drv_data->callbacks, dev, fired);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(max7318_int_work_handler)
+
+static void max7318_int_gpio_handler(const struct device *port, struct gpio_callback *cb,
+                                     gpio_port_pins_t pins) {
+    struct max7318_drv_data *const drv_data =
+        CONTAINER_OF(cb, struct max7318_drv_data, int_gpio_cb);
+
+    k_work_submit(&drv_data->int_work);
+}
+
+static int max7318_init_interrupts(const struct device *dev) {
+    const struct max7318_config *const config = dev->config;
+    struct max7318_drv_data *const drv_data = (struct max7318_drv_data *const)dev->data;
+
+    if (!device_is_ready(config->int_gpio.port)) {
+        LOG_ERR("interrupt GPIO is not ready");
+        return -ENODEV;
+    }
+
+    int ret = gpio_pin_configure_dt(&config->int_gpio, GPIO_INPUT);
+    if (ret != 0) {
+        LOG_ERR("failed to configure the interrupt GPIO (%d)", ret);
+        return ret;
+    }
+
+    // Reading the inputs releases INT in case it was asserted before reset
+    ret = read_registers(dev, REG_INPUT_PORTA, &drv_data->int_input);
+    if (ret != 0) {
+        LOG_ERR("failed to read inputs (%d)", ret);
+        return ret;
+    }
+
+    k_work_init(&drv_data->int_work, ZMK_WORK_WATCHED(max7318_int_work_handler));
+    gpio_init_callback(&drv_data->int_gpio_cb, max7318_int_gpio_handler,
+                       BIT(config->int_gpio.pin));
+
+    ret = gpio_add_callback(config->int_gpio.port, &drv_data->int_gpio_cb);
+    if (ret != 0) {
+        LOG_ERR("failed to add the interrupt callback (%d)", ret);
+        return ret;
+    }
+
+    // INT stays asserted until the inputs are read, so each change is one edge
+    return gpio_pin_interrupt_configure_dt(&config->int_gpio, GPIO_INT_EDGE_TO_ACTIVE);
 }
 
 static const struct gpio_driver_api api_table = {
@@ -289,6 +435,7 @@ static const struct gpio_driver_api api_table = {
     .port_clear_bits_raw = max7318_port_clear_bits_raw,
     .port_toggle_bits = max7318_port_toggle_bits,
     .pin_interrupt_configure = max7318_pin_interrupt_configure,
+    .manage_callback = max7318_manage_callback,
 };
 
 /**
@@ -309,6 +456,13 @@ static int max7318_init(const struct device *dev) {
     LOG_INF("device initialised at 0x%x", config->i2c_bus.addr);
 
     k_sem_init(&drv_data->lock, 1, 1);
+
+    drv_data->dev = dev;
+
+    if (config->int_gpio.port) {
+        return max7318_init_interrupts(dev);
+    }
+
     return 0;
 }
 
@@ -320,7 +474,9 @@ static int max7318_init(const struct device *dev) {
 #define MAX7318_INIT(inst)                                                                         \
     static struct max7318_config max7318_##inst##_config = {                                       \
         .common = {.port_pin_mask = GPIO_PORT_PIN_MASK_FROM_DT_INST(inst)},                        \
-        .i2c_bus = I2C_DT_SPEC_INST_GET(inst)};                                                    \
+        .i2c_bus = I2C_DT_SPEC_INST_GET(inst),                                                     \
+        .int_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, int_gpios, {0}),                                \
+    };                                                                                             \
                                                                                                    \
     static struct max7318_drv_data max7318_##inst##_drvdata = {                                    \
         /* Default for registers according to datasheet */                                         \
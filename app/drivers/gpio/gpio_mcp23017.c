@@ -17,12 +17,16 @@
 #include <init.h>
 #include <sys/byteorder.h>
 #include <drivers/gpio.h>
+#include <drivers/gpio/gpio_utils.h>
 #include <drivers/i2c.h>
 
 #include "gpio_mcp23017.h"
 
 #define LOG_LEVEL CONFIG_GPIO_LOG_LEVEL
 #include <logging/log.h>
+
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_REGISTER(gpio_mcp23017);
 
 /**
@@ -101,29 +105,39 @@ static int write_port_regs(const struct device *dev, uint8_t reg, uint16_t value
  */
 static int setup_pin_dir(const struct device *dev, uint32_t pin, int flags) {
     struct mcp23017_drv_data *const drv_data = (struct mcp23017_drv_data *const)dev->data;
-    uint16_t *dir = &drv_data->reg_cache.iodir;
-    uint16_t *output = &drv_data->reg_cache.gpio;
+    uint16_t dir = drv_data->reg_cache.iodir;
+    uint16_t output = drv_data->reg_cache.gpio;
     int ret;
 
     if ((flags & GPIO_OUTPUT) != 0U) {
         if ((flags & GPIO_OUTPUT_INIT_HIGH) != 0U) {
-            *output |= BIT(pin);
+            output |= BIT(pin);
         } else if ((flags & GPIO_OUTPUT_INIT_LOW) != 0U) {
-            *output &= ~BIT(pin);
+            output &= ~BIT(pin);
         }
-        *dir &= ~BIT(pin);
+        dir &= ~BIT(pin);
     } else {
-        *dir |= BIT(pin);
+        dir |= BIT(pin);
     }
 
-    ret = write_port_regs(dev, REG_GPIO_PORTA, *output);
-    if (ret != 0) {
-        return ret;
+    /* The registers are cached, so skip writes that wouldn't change anything */
+    if (output != drv_data->reg_cache.gpio) {
+        ret = write_port_regs(dev, REG_GPIO_PORTA, output);
+        if (ret != 0) {
+            return ret;
+        }
+        drv_data->reg_cache.gpio = output;
     }
 
-    ret = write_port_regs(dev, REG_IODIR_PORTA, *dir);
+    if (dir != drv_data->reg_cache.iodir) {
+        ret = write_port_regs(dev, REG_IODIR_PORTA, dir);
+        if (ret != 0) {
+            return ret;
+        }
+        drv_data->reg_cache.iodir = dir;
+    }
 
-    return ret;
+    return 0;
 }
 
 /**
@@ -150,6 +164,10 @@ static int setup_pin_pullupdown(const struct device *dev, uint32_t pin, int flag
 
     WRITE_BIT(port, pin, (flags & GPIO_PULL_UP) != 0U);
 
+    if (port == drv_data->reg_cache.gppu) {
+        return 0;
+    }
+
     ret = write_port_regs(dev, REG_GPPU_PORTA, port);
     if (ret == 0) {
         drv_data->reg_cache.gppu = port;
@@ -230,9 +248,12 @@ static int mcp23017_port_set_masked_raw(const struct device *dev, uint32_t mask,
     buf = drv_data->reg_cache.gpio;
     buf = (buf & ~mask) | (mask & value);
 
-    ret = write_port_regs(dev, REG_GPIO_PORTA, buf);
-    if (ret == 0) {
-        drv_data->reg_cache.gpio = buf;
+    ret = 0;
+    if (buf != drv_data->reg_cache.gpio) {
+        ret = write_port_regs(dev, REG_GPIO_PORTA, buf);
+        if (ret == 0) {
+            drv_data->reg_cache.gpio = buf;
+        }
     }
 
     k_sem_give(&drv_data->lock);
@@ -275,7 +296,171 @@ static int mcp23017_port_toggle_bits(const struct device *dev, uint32_t mask) {
 
 static int mcp23017_pin_interrupt_configure(const struct device *dev, gpio_pin_t pin,
                                             enum gpio_int_mode mode, enum gpio_int_trig trig) {
-    return -ENOTSUP;
+    const struct mcp23017_config *const config = dev->config;
+    struct mcp23017_drv_data *const drv_data = (struct mcp23017_drv_data *const)dev->data;
+    uint16_t gpinten = drv_data->reg_cache.gpinten;
+    uint16_t intcon = drv_data->reg_cache.intcon;
+    uint16_t defval = drv_data->reg_cache.defval;
+    int ret = 0;
+
+    if (!config->int_gpio.port) {
+        return -ENOTSUP;
+    }
+
+    if (mode == GPIO_INT_MODE_LEVEL && trig == GPIO_INT_TRIG_BOTH) {
+        return -ENOTSUP;
+    }
+
+    /* Can't do I2C bus operations from an ISR */
+    if (k_is_in_isr()) {
+        return -EWOULDBLOCK;
+    }
+
+    k_sem_take(&drv_data->lock, K_FOREVER);
+
+    WRITE_BIT(gpinten, pin, mode != GPIO_INT_MODE_DISABLED);
+    WRITE_BIT(drv_data->int_level, pin, mode == GPIO_INT_MODE_LEVEL);
+    WRITE_BIT(drv_data->int_high, pin, mode != GPIO_INT_MODE_DISABLED && (trig & GPIO_INT_HIGH_1));
+    WRITE_BIT(drv_data->int_low, pin, mode != GPIO_INT_MODE_DISABLED && (trig & GPIO_INT_LOW_0));
+
+    if (mode == GPIO_INT_MODE_LEVEL) {
+        /* Interrupt while the pin differs from DEFVAL */
+        intcon |= BIT(pin);
+        WRITE_BIT(defval, pin, trig == GPIO_INT_TRIG_LOW);
+    } else {
+        /* Interrupt on any change. Edges in the wrong direction are filtered when handled. */
+        intcon &= ~BIT(pin);
+    }
+
+    if (defval != drv_data->reg_cache.defval) {
+        ret = write_port_regs(dev, REG_DEFVAL_PORTA, defval);
+        if (ret != 0) {
+            goto done;
+        }
+        drv_data->reg_cache.defval = defval;
+    }
+
+    if (intcon != drv_data->reg_cache.intcon) {
+        ret = write_port_regs(dev, REG_INTCON_PORTA, intcon);
+        if (ret != 0) {
+            goto done;
+        }
+        drv_data->reg_cache.intcon = intcon;
+    }
+
+    if (gpinten != drv_data->reg_cache.gpinten) {
+        ret = write_port_regs(dev, REG_GPINTEN_PORTA, gpinten);
+        if (ret != 0) {
+            goto done;
+        }
+        drv_data->reg_cache.gpinten = gpinten;
+    }
+
+done:
+    k_sem_give(&drv_data->lock);
+    return ret;
+}
+
+static int mcp23017_manage_callback(const struct device *dev, struct gpio_callback *callback,
+                                    bool set) {
+    struct mcp23017_drv_data *const drv_data = (struct mcp23017_drv_data *const)dev->data;
+
+    return gpio_manage_callback(&drv_data->callbacks, callback, set);
+}
+
+static void mcp23017_int_work_handler(struct k_work *work) {
+    struct mcp23017_drv_data *const drv_data =
+        CONTAINER_OF(work, struct mcp23017_drv_data, int_work);
+    const struct device *dev = drv_data->dev;
+    const struct mcp23017_config *const config = dev->config;
+    uint16_t regs[3];
+    uint32_t fired = 0;
+    int ret;
+
+    k_sem_take(&drv_data->lock, K_FOREVER);
+
+    /*
+     * INTF, INTCAP and GPIO are consecutive, so one read gets which pins changed, their levels
+     * when the interrupt happened and their levels now. Reading INTCAP and GPIO also clears the
+     * interrupt.
+     */
+    ret = i2c_burst_read(drv_data->i2c, config->slave, REG_INTF_PORTA, (uint8_t *)regs,
+                         sizeof(regs));
+    if (ret == 0) {
+        const uint16_t intf = sys_le16_to_cpu(regs[0]);
+        const uint16_t intcap = sys_le16_to_cpu(regs[1]);
+        const uint16_t gpio = sys_le16_to_cpu(regs[2]);
+        const uint16_t edge = intf & ~drv_data->int_level;
+        const uint16_t level = drv_data->int_level;
+
+        fired = (edge & intcap & drv_data->int_high) | (edge & ~intcap & drv_data->int_low) |
+                (level & gpio & drv_data->int_high) | (level & ~gpio & drv_data->int_low);
+    } else {
+        LOG_ERR("MCP23017: failed to read interrupt flags (%d)", ret);
+    }
+
+    k_sem_give(&drv_data->lock);
+
+    if (fired) {
+        gpio_fire_callbacks(&drv_data->callbacks, dev, fired);
+    }
+
+    /* A level interrupt that is still active asserts INTA/INTB again right away */
+    ret = gpio_pin_interrupt_configure_dt(&config->int_gpio, GPIO_INT_LEVEL_ACTIVE);
+    if (ret != 0) {
+        LOG_ERR("MCP23017: failed to re-enable the interrupt line (%d)", ret);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(mcp23017_int_work_handler)
+
+static void mcp23017_int_gpio_handler(const struct device *port, struct gpio_callback *cb,
+                                      gpio_port_pins_t pins) {
+    struct mcp23017_drv_data *const drv_data =
+        CONTAINER_OF(cb, struct mcp23017_drv_data, int_gpio_cb);
+    const struct mcp23017_config *const config = drv_data->dev->config;
+
+    /* The line stays active until the flags are read over I2C, so mask it until then */
+    gpio_pin_interrupt_configure_dt(&config->int_gpio, GPIO_INT_DISABLE);
+    k_work_submit(&drv_data->int_work);
+}
+
+static int mcp23017_init_interrupts(const struct device *dev) {
+    const struct mcp23017_config *const config = dev->config;
+    struct mcp23017_drv_data *const drv_data = (struct mcp23017_drv_data *const)dev->data;
+    int ret;
+
+    if (!device_is_ready(config->int_gpio.port)) {
+        LOG_ERR("MCP23017: interrupt GPIO is not ready");
+        return -ENODEV;
+    }
+
+    /* Mirror INTA and INTB, so one controller pin covers both ports */
+    uint8_t iocon = IOCON_MIRROR;
+    ret = i2c_reg_write_byte(drv_data->i2c, config->slave, REG_IOCON, iocon);
+    if (ret != 0) {
+        LOG_ERR("MCP23017: failed to configure IOCON (%d)", ret);
+        return ret;
+    }
+    drv_data->reg_cache.iocon = iocon;
+
+    ret = gpio_pin_configure_dt(&config->int_gpio, GPIO_INPUT);
+    if (ret != 0) {
+        LOG_ERR("MCP23017: failed to configure the interrupt GPIO (%d)", ret);
+        return ret;
+    }
+
+    k_work_init(&drv_data->int_work, ZMK_WORK_WATCHED(mcp23017_int_work_handler));
+    gpio_init_callback(&drv_data->int_gpio_cb, mcp23017_int_gpio_handler,
+                       BIT(config->int_gpio.pin));
+
+    ret = gpio_add_callback(config->int_gpio.port, &drv_data->int_gpio_cb);
+    if (ret != 0) {
+        LOG_ERR("MCP23017: failed to add the interrupt callback (%d)", ret);
+        return ret;
+    }
+
+    return gpio_pin_interrupt_configure_dt(&config->int_gpio, GPIO_INT_LEVEL_ACTIVE);
 }
 
 static const struct gpio_driver_api api_table = {
@@ -286,6 +471,7 @@ static const struct gpio_driver_api api_table = {
     .port_clear_bits_raw = mcp23017_port_clear_bits_raw,
     .port_toggle_bits = mcp23017_port_toggle_bits,
     .pin_interrupt_configure = mcp23017_pin_interrupt_configure,
+    .manage_callback = mcp23017_manage_callback,
 };
 
 /**
@@ -306,6 +492,12 @@ static int mcp23017_init(const struct device *dev) {
 
     k_sem_init(&drv_data->lock, 1, 1);
 
+    drv_data->dev = dev;
+
+    if (config->int_gpio.port) {
+        return mcp23017_init_interrupts(dev);
+    }
+
     return 0;
 }
 
@@ -313,7 +505,7 @@ static int mcp23017_init(const struct device *dev) {
     static struct mcp23017_config mcp23017_##inst##_config = {                                     \
         .i2c_dev_name = DT_INST_BUS_LABEL(inst),                                                   \
         .slave = DT_INST_REG_ADDR(inst),                                                           \
-                                                                                                   \
+        .int_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, int_gpios, {0}),                                \
     };                                                                                             \
                                                                                                    \
     static struct mcp23017_drv_data mcp23017_##inst##_drvdata = {                                  \
@@ -31,6 +31,7 @@ extern "C" {
 #define REG_DEFVAL_PORTB 0x07
 #define REG_INTCON_PORTA 0x08
 #define REG_INTCON_PORTB 0x09
+#define REG_IOCON 0x0A
 #define REG_GPPU_PORTA 0x0C
 #define REG_GPPU_PORTB 0x0D
 #define REG_INTF_PORTA 0x0E
@@ -45,6 +46,9 @@ extern "C" {
 #define MCP23017_ADDR 0x40
 #define MCP23017_READBIT 0x01
 
+/* IOCON bits */
+#define IOCON_MIRROR BIT(6)
+
 /** Configuration data */
 struct mcp23017_config {
     /* gpio_driver_data needs to be first */
@@ -52,6 +56,9 @@ struct mcp23017_config {
 
     const char *const i2c_dev_name;
     const uint16_t slave;
+
+    /** Controller GPIO connected to INTA/INTB, if any. */
+    const struct gpio_dt_spec int_gpio;
 };
 
 /** Runtime driver data */
@@ -64,6 +71,18 @@ struct mcp23017_drv_data {
 
     struct k_sem lock;
 
+    const struct device *dev;
+    struct gpio_callback int_gpio_cb;
+    /** Reads the pin changes after an interrupt, which can't be done from the ISR. */
+    struct k_work int_work;
+    sys_slist_t callbacks;
+    /** Pins with level interrupts enabled. */
+    uint16_t int_level;
+    /** Pins which should interrupt while high or on a rising edge. */
+    uint16_t int_high;
+    /** Pins which should interrupt while low or on a falling edge. */
+    uint16_t int_low;
+
     struct {
         uint16_t iodir;
         uint16_t ipol;
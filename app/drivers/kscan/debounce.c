@@ -59,4 +59,101 @@ bool debounce_is_active(const struct debounce_state *state) {
 
 bool debounce_is_pressed(const struct debounce_state *state) { return state->pressed; }
 
-bool debounce_get_changed(const struct debounce_state *state) { return state->changed; }
\ No newline at end of file
+bool debounce_get_changed(const struct debounce_state *state) { return state->changed; }
+
+void debounce_word_config_init(struct debounce_word_config *word_config,
+                               const struct debounce_config *config, const int scan_period_ms) {
+    // The per-switch counter only ever holds multiples of the scan period below the threshold,
+    // so counting scans and flipping at the threshold rounded up gives the same result.
+    word_config->press_scans = DIV_ROUND_UP(config->debounce_press_ms, scan_period_ms);
+    word_config->release_scans = DIV_ROUND_UP(config->debounce_release_ms, scan_period_ms);
+    word_config->override_press_scans = word_config->press_scans;
+    word_config->override_release_scans = word_config->release_scans;
+
+    const uint32_t max_scans = MAX(word_config->press_scans, word_config->release_scans);
+    word_config->counter_bits = 32 - __builtin_clz(max_scans | 1);
+}
+
+void debounce_word_config_set_override(struct debounce_word_config *word_config,
+                                       const struct debounce_config *config,
+                                       const int scan_period_ms) {
+    word_config->override_press_scans = DIV_ROUND_UP(config->debounce_press_ms, scan_period_ms);
+    word_config->override_release_scans =
+        DIV_ROUND_UP(config->debounce_release_ms, scan_period_ms);
+
+    const uint32_t max_scans =
+        MAX(MAX(word_config->press_scans, word_config->release_scans),
+            MAX(word_config->override_press_scans, word_config->override_release_scans));
+    word_config->counter_bits = 32 - __builtin_clz(max_scans | 1);
+}
+
+/**
+ * @returns a bitmap of the switches whose counter is at least threshold.
+ */
+static uint32_t counter_at_least(const struct debounce_word_state *state, const uint32_t threshold,
+                                 const int bits) {
+    uint32_t greater = 0;
+    uint32_t equal = UINT32_MAX;
+
+    // Compare from the most significant bit down, like a comparator for each switch.
+    for (int b = bits - 1; b >= 0; b--) {
+        if (threshold & BIT(b)) {
+            equal &= state->counter[b];
+        } else {
+            greater |= equal & state->counter[b];
+            equal &= ~state->counter[b];
+        }
+    }
+
+    return greater | equal;
+}
+
+static uint32_t counter_nonzero(const struct debounce_word_state *state) {
+    uint32_t nonzero = 0;
+
+    for (int b = 0; b < DEBOUNCE_COUNTER_BITS; b++) {
+        nonzero |= state->counter[b];
+    }
+
+    return nonzero;
+}
+
+void debounce_word_update(struct debounce_word_state *state, const uint32_t active,
+                          const struct debounce_word_config *config) {
+    // Same integrator as debounce_update, applied to every switch at once.
+    const int bits = config->counter_bits;
+    const uint32_t mismatch = active ^ state->pressed;
+    uint32_t at_threshold =
+        (counter_at_least(state, config->press_scans, bits) & ~state->pressed) |
+        (counter_at_least(state, config->release_scans, bits) & state->pressed);
+
+    // Words without overridden switches, which is most of them, skip the second comparison.
+    if (state->override) {
+        const uint32_t override_at_threshold =
+            (counter_at_least(state, config->override_press_scans, bits) & ~state->pressed) |
+            (counter_at_least(state, config->override_release_scans, bits) & state->pressed);
+
+        at_threshold =
+            (at_threshold & ~state->override) | (override_at_threshold & state->override);
+    }
+
+    const uint32_t flip = mismatch & at_threshold;
+    uint32_t carry = mismatch & ~at_threshold;
+    uint32_t borrow = ~mismatch & counter_nonzero(state);
+
+    // Counters below the threshold never overflow their bits, and only nonzero ones count down.
+    for (int b = 0; b < bits; b++) {
+        const uint32_t counter = state->counter[b];
+
+        state->counter[b] = (counter ^ carry ^ borrow) & ~flip;
+        carry &= counter;
+        borrow &= ~counter;
+    }
+
+    state->pressed ^= flip;
+    state->changed = flip;
+}
+
+uint32_t debounce_word_active(const struct debounce_word_state *state) {
+    return state->pressed | counter_nonzero(state);
+}
\ No newline at end of file
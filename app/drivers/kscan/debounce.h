@@ -54,3 +54,76 @@ bool debounce_is_pressed(const struct debounce_state *state);
  * debounce_update.
  */
 bool debounce_get_changed(const struct debounce_state *state);
+
+/** Number of switches debounced together by a debounce_word_state. */
+#define DEBOUNCE_WORD_BITS 32
+
+/** Number of debounce_word_state needed for len switches. */
+#define DEBOUNCE_WORDS(len) DIV_ROUND_UP(len, DEBOUNCE_WORD_BITS)
+
+/**
+ * Debounce state for up to 32 switches at once. Bit N of each field belongs to switch N.
+ *
+ * Each switch's counter is stored vertically: bit N of counter[b] is bit b of switch N's
+ * counter, so one pass of bitwise operations updates all 32 counters.
+ */
+struct debounce_word_state {
+    uint32_t pressed;
+    uint32_t changed;
+    /** Switches debounced with the override thresholds. Set by the driver, never changed here. */
+    uint32_t override;
+    uint32_t counter[DEBOUNCE_COUNTER_BITS];
+};
+
+/**
+ * debounce_config converted to scans, for a driver that updates every switch once per scan.
+ */
+struct debounce_word_config {
+    /** Consecutive scans a switch must be pressed to latch as pressed. */
+    uint16_t press_scans;
+    /** Consecutive scans a switch must be released to latch as released. */
+    uint16_t release_scans;
+    /** Thresholds of the switches in debounce_word_state.override. */
+    uint16_t override_press_scans;
+    uint16_t override_release_scans;
+    /** Number of counter bits needed to count up to the largest threshold. */
+    uint8_t counter_bits;
+};
+
+/**
+ * Converts debounce settings for use with debounce_word_update. The override thresholds start out
+ * the same as the others.
+ *
+ * @param word_config The settings to initialize.
+ * @param config Debounce settings.
+ * @param scan_period_ms Time between updates in milliseconds.
+ */
+void debounce_word_config_init(struct debounce_word_config *word_config,
+                               const struct debounce_config *config, const int scan_period_ms);
+
+/**
+ * Sets the thresholds used for the switches in debounce_word_state.override.
+ *
+ * @param word_config Settings initialized by debounce_word_config_init.
+ * @param config Debounce settings for the overridden switches.
+ * @param scan_period_ms Time between updates in milliseconds.
+ */
+void debounce_word_config_set_override(struct debounce_word_config *word_config,
+                                       const struct debounce_config *config,
+                                       const int scan_period_ms);
+
+/**
+ * Debounces up to 32 switches. This behaves the same as calling debounce_update for each switch
+ * with elapsed_ms equal to the scan period.
+ *
+ * @param state The state for the switches to debounce.
+ * @param active Bitmap of the switches that are currently pressed.
+ * @param config Debounce settings.
+ */
+void debounce_word_update(struct debounce_word_state *state, const uint32_t active,
+                          const struct debounce_word_config *config);
+
+/**
+ * @returns a bitmap of the switches for which debounce_is_active would return true.
+ */
+uint32_t debounce_word_active(const struct debounce_word_state *state);
\ No newline at end of file
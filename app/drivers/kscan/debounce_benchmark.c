@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zmk/micro_benchmark.h>
+
+#include "debounce.h"
+
+#define SWITCHES DEBOUNCE_WORD_BITS
+#define SCAN_PERIOD_MS 1
+
+static const struct debounce_config config = {
+    .debounce_press_ms = 5,
+    .debounce_release_ms = 5,
+};
+
+static struct debounce_state states[SWITCHES];
+static struct debounce_word_state word_state;
+static struct debounce_word_config word_config;
+
+// Summed over every update, so the updates can't be optimized away.
+static volatile uint32_t changed;
+
+// All switches are pressed and released every 32 scans, with every other switch bouncing on
+// each third scan, so both the counting and the flipping paths are timed.
+static uint32_t active_switches(uint32_t i) {
+    return ((i / 16) % 2 ? UINT32_MAX : 0) ^ (i % 3 == 0 ? 0x55555555 : 0);
+}
+
+// One operation is a whole scan of 32 switches, which debounce_word_update does in one call.
+static void debounce_update_scan(uint32_t i) {
+    const uint32_t active = active_switches(i);
+
+    for (int n = 0; n < SWITCHES; n++) {
+        debounce_update(&states[n], active & BIT(n), SCAN_PERIOD_MS, &config);
+        changed += debounce_get_changed(&states[n]);
+    }
+}
+
+static void debounce_word_update_scan(uint32_t i) {
+    debounce_word_update(&word_state, active_switches(i), &word_config);
+    changed += word_state.changed != 0;
+}
+
+void zmk_micro_benchmark_debounce(uint32_t iterations) {
+    debounce_word_config_init(&word_config, &config, SCAN_PERIOD_MS);
+
+    zmk_micro_benchmark_run("debounce_update", debounce_update_scan, iterations);
+    zmk_micro_benchmark_run("debounce_word_update", debounce_word_update_scan, iterations);
+}
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/adc.h>
+#include <drivers/gpio.h>
+#include <drivers/kscan.h>
+#include <drivers/kscan_frame.h>
+#include <kernel.h>
+#include <logging/log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include <zmk/energy_stats.h>
+#include <zmk/work_watchdog.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#define DT_DRV_COMPAT zmk_kscan_analog_mux
+
+#define INST_ROWS_LEN(n) DT_INST_PROP_LEN(n, io_channels)
+#define INST_COLS_LEN(n) DT_INST_PROP(n, mux_channels)
+#define INST_KEYS_LEN(n) (INST_ROWS_LEN(n) * INST_COLS_LEN(n))
+#define INST_WORDS_LEN(n) DIV_ROUND_UP(INST_KEYS_LEN(n), 32)
+
+#define KSCAN_ANALOG_INPUT_CFG_INIT(idx, inst_idx)                                                 \
+    DT_IO_CHANNELS_INPUT_BY_IDX(DT_DRV_INST(inst_idx), idx),
+#define KSCAN_ANALOG_MUX_CFG_INIT(idx, inst_idx)                                                   \
+    GPIO_DT_SPEC_GET_BY_IDX(DT_DRV_INST(inst_idx), mux_gpios, idx),
+
+#define ADC_RESOLUTION 12
+
+// Number of scans averaged at boot to find the resting reading of each key.
+#define CALIBRATION_SCANS 16
+
+// The resting reading moves 1/2^REST_FILTER_SHIFT of the way to each new reading of a key at rest.
+#define REST_FILTER_SHIFT 4
+
+BUILD_ASSERT(BIT(REST_FILTER_SHIFT) == CALIBRATION_SCANS,
+             "The calibration sum must be the resting reading scaled for the filter");
+
+/** Full travel, in the units of the travel properties. */
+#define TRAVEL_MAX 1000
+
+struct kscan_analog_key {
+    /** Reading at rest, scaled by 2^REST_FILTER_SHIFT. */
+    int32_t rest;
+    /** Largest distance from rest seen so far, and at least config->travel_range. */
+    uint16_t range;
+    /** Deepest travel since the press while pressed, else the shallowest since the release. */
+    uint16_t extreme;
+    bool pressed;
+    /** Set from the first actuation until the key returns above the release point. */
+    bool engaged;
+};
+
+struct kscan_analog_data {
+    const struct device *dev;
+    kscan_callback_t callback;
+    kscan_frame_callback_t frame_callback;
+    struct k_work_delayable work;
+    /** Timestamp of the current or scheduled scan. */
+    int64_t scan_time;
+    /** State of each key, at index (column * rows + row). Array of length rows * columns. */
+    struct kscan_analog_key *keys;
+    /** Samples of the last ADC read, in ascending order of ADC input. Array of length rows. */
+    int16_t *samples;
+    /** Array of length rows: the index into samples of each row's input. */
+    uint8_t *sample_index;
+    /** Changed and pressed keys of the last scan, with bit N holding key N. */
+    uint32_t *frame_changed;
+    uint32_t *frame_pressed;
+    struct adc_sequence sequence;
+};
+
+struct kscan_gpio_list {
+    const struct gpio_dt_spec *gpios;
+    size_t len;
+};
+
+/** Define a kscan_gpio_list from a compile-time GPIO array. */
+#define KSCAN_GPIO_LIST(gpio_array)                                                                \
+    ((struct kscan_gpio_list){.gpios = gpio_array, .len = ARRAY_SIZE(gpio_array)})
+
+struct kscan_analog_config {
+    const struct device *adc;
+    /** ADC input of each row. */
+    const uint8_t *inputs;
+    size_t rows_len;
+    struct kscan_gpio_list mux_gpios;
+    size_t cols_len;
+    uint32_t settle_us;
+    int32_t scan_period_ms;
+    uint16_t travel_range;
+    uint16_t actuation_point;
+    uint16_t release_hysteresis;
+    uint16_t rapid_trigger_sensitivity;
+    bool rapid_trigger;
+};
+
+static int kscan_analog_select(const struct device *dev, const int column) {
+    const struct kscan_analog_config *config = dev->config;
+
+    for (int i = 0; i < config->mux_gpios.len; i++) {
+        int err = gpio_pin_set_dt(&config->mux_gpios.gpios[i], (column >> i) & 1);
+        if (err) {
+            LOG_ERR("Failed to set multiplexer select line %i: %i", i, err);
+            return err;
+        }
+    }
+
+    if (config->settle_us > 0) {
+        k_busy_wait(config->settle_us);
+    }
+
+    return 0;
+}
+
+/**
+ * Sample every multiplexer output for one column with a single ADC sequence.
+ */
+static int kscan_analog_read_column(const struct device *dev, const int column) {
+    const struct kscan_analog_config *config = dev->config;
+    struct kscan_analog_data *data = dev->data;
+
+    int err = kscan_analog_select(dev, column);
+    if (err) {
+        return err;
+    }
+
+    err = adc_read(config->adc, &data->sequence);
+    if (err) {
+        LOG_ERR("Failed to read the ADC: %i", err);
+        return err;
+    }
+
+    return 0;
+}
+
+/**
+ * Update a key with a new reading.
+ *
+ * @returns whether the pressed state of the key changed.
+ */
+static bool kscan_analog_update_key(const struct kscan_analog_config *config,
+                                    struct kscan_analog_key *key, const int16_t value) {
+    const uint16_t distance = abs(value - (key->rest >> REST_FILTER_SHIFT));
+    const uint16_t release_point = config->actuation_point > config->release_hysteresis
+                                       ? config->actuation_point - config->release_hysteresis
+                                       : 0;
+    const uint16_t sensitivity = config->rapid_trigger_sensitivity;
+    const bool was_pressed = key->pressed;
+
+    key->range = MAX(key->range, distance);
+
+    const uint16_t travel = (uint32_t)distance * TRAVEL_MAX / key->range;
+
+    if (key->pressed) {
+        key->extreme = MAX(key->extreme, travel);
+
+        if (travel < release_point) {
+            key->pressed = false;
+            key->engaged = false;
+        } else if (config->rapid_trigger && travel + sensitivity <= key->extreme) {
+            // Released on the way up, but pressed again as soon as it turns back down.
+            key->pressed = false;
+        }
+    } else {
+        if (travel < release_point) {
+            key->engaged = false;
+        }
+
+        key->extreme = MIN(key->extreme, travel);
+
+        if (travel >= config->actuation_point ||
+            (config->rapid_trigger && key->engaged && travel >= key->extreme + sensitivity)) {
+            key->pressed = true;
+            key->engaged = true;
+        }
+    }
+
+    if (key->pressed != was_pressed) {
+        key->extreme = travel;
+    }
+
+    // Follow slow drift of the resting reading, such as from temperature, while the key is up.
+    if (!key->engaged && travel < config->release_hysteresis) {
+        key->rest += value - (key->rest >> REST_FILTER_SHIFT);
+    }
+
+    return key->pressed != was_pressed;
+}
+
+static int kscan_analog_read(const struct device *dev) {
+    struct kscan_analog_data *data = dev->data;
+    const struct kscan_analog_config *config = dev->config;
+    const int keys_len = config->rows_len * config->cols_len;
+    const int words = DIV_ROUND_UP(keys_len, 32);
+    const int64_t timestamp = k_uptime_get();
+    bool frame_changed = false;
+
+    zmk_energy_stats_count(ZMK_ENERGY_KSCAN_SCAN);
+
+    if (data->frame_callback) {
+        memset(data->frame_changed, 0, words * sizeof(data->frame_changed[0]));
+    }
+
+    for (int c = 0; c < config->cols_len; c++) {
+        int err = kscan_analog_read_column(dev, c);
+        if (err) {
+            return err;
+        }
+
+        for (int r = 0; r < config->rows_len; r++) {
+            const int index = c * config->rows_len + r;
+            struct kscan_analog_key *key = &data->keys[index];
+
+            if (!kscan_analog_update_key(config, key, data->samples[data->sample_index[r]])) {
+                continue;
+            }
+
+            if (data->frame_callback) {
+                data->frame_changed[index / 32] |= BIT(index % 32);
+                WRITE_BIT(data->frame_pressed[index / 32], index % 32, key->pressed);
+                frame_changed = true;
+                continue;
+            }
+
+            LOG_DBG("Sending event at %i,%i state %s", r, c, key->pressed ? "on" : "off");
+            data->callback(dev, r, c, key->pressed);
+        }
+    }
+
+    if (frame_changed) {
+        const struct kscan_frame frame = {
+            .changed = data->frame_changed,
+            .pressed = data->frame_pressed,
+            .words = words,
+            .rows = config->rows_len,
+            .timestamp = timestamp,
+        };
+
+        data->frame_callback(dev, &frame);
+    }
+
+    return 0;
+}
+
+static void kscan_analog_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct kscan_analog_data *data = CONTAINER_OF(dwork, struct kscan_analog_data, work);
+    const struct kscan_analog_config *config = data->dev->config;
+
+    kscan_analog_read(data->dev);
+
+    // Analog switches can't interrupt, so keep scanning at the same rate.
+    data->scan_time += config->scan_period_ms;
+    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+}
+
+ZMK_WORK_WATCHDOG_WRAP(kscan_analog_work_handler)
+
+static int kscan_analog_configure(const struct device *dev, const kscan_callback_t callback) {
+    struct kscan_analog_data *data = dev->data;
+
+    if (!callback) {
+        return -EINVAL;
+    }
+
+    data->callback = callback;
+    return 0;
+}
+
+static int kscan_analog_configure_frame(const struct device *dev,
+                                        const kscan_frame_callback_t callback) {
+    struct kscan_analog_data *data = dev->data;
+
+    if (!callback) {
+        return -EINVAL;
+    }
+
+    data->frame_callback = callback;
+    return 0;
+}
+
+static int kscan_analog_enable(const struct device *dev) {
+    struct kscan_analog_data *data = dev->data;
+
+    data->scan_time = k_uptime_get();
+
+    return k_work_reschedule(&data->work, K_NO_WAIT) < 0 ? -EIO : 0;
+}
+
+static int kscan_analog_disable(const struct device *dev) {
+    struct kscan_analog_data *data = dev->data;
+
+    k_work_cancel_delayable(&data->work);
+    return 0;
+}
+
+static int kscan_analog_init_adc(const struct device *dev) {
+    const struct kscan_analog_config *config = dev->config;
+    struct kscan_analog_data *data = dev->data;
+    uint32_t channels = 0;
+
+    if (!device_is_ready(config->adc)) {
+        LOG_ERR("ADC is not ready: %s", config->adc->name);
+        return -ENODEV;
+    }
+
+    for (int r = 0; r < config->rows_len; r++) {
+        const uint8_t input = config->inputs[r];
+        const struct adc_channel_cfg channel_cfg = {
+            .channel_id = input,
+#ifdef CONFIG_ADC_NRFX_SAADC
+            .gain = ADC_GAIN_1_6,
+            .reference = ADC_REF_INTERNAL,
+            .acquisition_time = ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 3),
+            .input_positive = SAADC_CH_PSELP_PSELP_AnalogInput0 + input,
+#else
+            .gain = ADC_GAIN_1,
+            .reference = ADC_REF_INTERNAL,
+            .acquisition_time = ADC_ACQ_TIME_DEFAULT,
+#endif
+        };
+
+        if (channels & BIT(input)) {
+            LOG_ERR("ADC input %u is used by more than one row", input);
+            return -EINVAL;
+        }
+
+        int err = adc_channel_setup(config->adc, &channel_cfg);
+        if (err) {
+            LOG_ERR("Unable to configure ADC input %u: %i", input, err);
+            return err;
+        }
+
+        channels |= BIT(input);
+    }
+
+    // The ADC stores the samples of a sequence in ascending order of input.
+    for (int r = 0; r < config->rows_len; r++) {
+        data->sample_index[r] = __builtin_popcount(channels & BIT_MASK(config->inputs[r]));
+    }
+
+    data->sequence = (struct adc_sequence){
+        .channels = channels,
+        .buffer = data->samples,
+        .buffer_size = config->rows_len * sizeof(data->samples[0]),
+        .resolution = ADC_RESOLUTION,
+        .calibrate = true,
+    };
+
+    return 0;
+}
+
+static int kscan_analog_init_mux(const struct device *dev) {
+    const struct kscan_analog_config *config = dev->config;
+
+    for (int i = 0; i < config->mux_gpios.len; i++) {
+        const struct gpio_dt_spec *gpio = &config->mux_gpios.gpios[i];
+
+        if (!device_is_ready(gpio->port)) {
+            LOG_ERR("GPIO is not ready: %s", gpio->port->name);
+            return -ENODEV;
+        }
+
+        int err = gpio_pin_configure_dt(gpio, GPIO_OUTPUT_INACTIVE);
+        if (err) {
+            LOG_ERR("Unable to configure pin %u on %s for output", gpio->pin, gpio->port->name);
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Average a few scans to find the resting reading of each key, so keys must not be held at boot.
+ */
+static int kscan_analog_calibrate(const struct device *dev) {
+    const struct kscan_analog_config *config = dev->config;
+    struct kscan_analog_data *data = dev->data;
+
+    for (int i = 0; i < config->rows_len * config->cols_len; i++) {
+        data->keys[i] = (struct kscan_analog_key){.range = config->travel_range};
+    }
+
+    for (int s = 0; s < CALIBRATION_SCANS; s++) {
+        for (int c = 0; c < config->cols_len; c++) {
+            int err = kscan_analog_read_column(dev, c);
+            if (err) {
+                return err;
+            }
+
+            // Calibrate the ADC with the first read only.
+            data->sequence.calibrate = false;
+
+            for (int r = 0; r < config->rows_len; r++) {
+                data->keys[c * config->rows_len + r].rest += data->samples[data->sample_index[r]];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int kscan_analog_init(const struct device *dev) {
+    struct kscan_analog_data *data = dev->data;
+
+    data->dev = dev;
+
+    int err = kscan_analog_init_mux(dev);
+    if (err) {
+        return err;
+    }
+
+    err = kscan_analog_init_adc(dev);
+    if (err) {
+        return err;
+    }
+
+    err = kscan_analog_calibrate(dev);
+    if (err) {
+        return err;
+    }
+
+    k_work_init_delayable(&data->work, ZMK_WORK_WATCHED(kscan_analog_work_handler));
+
+    return 0;
+}
+
+static const struct kscan_frame_driver_api kscan_analog_api = {
+    .kscan =
+        {
+            .config = kscan_analog_configure,
+            .enable_callback = kscan_analog_enable,
+            .disable_callback = kscan_analog_disable,
+        },
+    .config_frame = kscan_analog_configure_frame,
+};
+
+#define KSCAN_ANALOG_INIT(n)                                                                       \
+    BUILD_ASSERT(INST_COLS_LEN(n) <= BIT(DT_INST_PROP_LEN(n, mux_gpios)),                          \
+                 "mux-channels needs more mux-gpios select lines");                                \
+    BUILD_ASSERT(DT_INST_PROP(n, actuation_point) <= TRAVEL_MAX,                                   \
+                 "actuation-point must be at most 1000");                                          \
+    BUILD_ASSERT(DT_INST_PROP(n, travel_range) > 0, "travel-range must be positive");              \
+                                                                                                   \
+    static const uint8_t kscan_analog_inputs_##n[] = {                                             \
+        UTIL_LISTIFY(INST_ROWS_LEN(n), KSCAN_ANALOG_INPUT_CFG_INIT, n)};                           \
+                                                                                                   \
+    static const struct gpio_dt_spec kscan_analog_mux_##n[] = {                                    \
+        UTIL_LISTIFY(DT_INST_PROP_LEN(n, mux_gpios), KSCAN_ANALOG_MUX_CFG_INIT, n)};               \
+                                                                                                   \
+    static struct kscan_analog_key kscan_analog_keys_##n[INST_KEYS_LEN(n)];                        \
+    static int16_t kscan_analog_samples_##n[INST_ROWS_LEN(n)];                                     \
+    static uint8_t kscan_analog_sample_index_##n[INST_ROWS_LEN(n)];                                \
+    static uint32_t kscan_analog_frame_changed_##n[INST_WORDS_LEN(n)];                             \
+    static uint32_t kscan_analog_frame_pressed_##n[INST_WORDS_LEN(n)];                             \
+                                                                                                   \
+    static struct kscan_analog_data kscan_analog_data_##n = {                                      \
+        .keys = kscan_analog_keys_##n,                                                             \
+        .samples = kscan_analog_samples_##n,                                                       \
+        .sample_index = kscan_analog_sample_index_##n,                                             \
+        .frame_changed = kscan_analog_frame_changed_##n,                                           \
+        .frame_pressed = kscan_analog_frame_pressed_##n,                                           \
+    };                                                                                             \
+                                                                                                   \
+    static const struct kscan_analog_config kscan_analog_config_##n = {                            \
+        .adc = DEVICE_DT_GET(DT_INST_IO_CHANNELS_CTLR_BY_IDX(n, 0)),                               \
+        .inputs = kscan_analog_inputs_##n,                                                         \
+        .rows_len = INST_ROWS_LEN(n),                                                              \
+        .mux_gpios = KSCAN_GPIO_LIST(kscan_analog_mux_##n),                                        \
+        .cols_len = INST_COLS_LEN(n),                                                              \
+        .settle_us = DT_INST_PROP(n, settle_us),                                                   \
+        .scan_period_ms = DT_INST_PROP(n, scan_period_ms),                                         \
+        .travel_range = DT_INST_PROP(n, travel_range),                                             \
+        .actuation_point = DT_INST_PROP(n, actuation_point),                                       \
+        .release_hysteresis = DT_INST_PROP(n, release_hysteresis),                                 \
+        .rapid_trigger_sensitivity = DT_INST_PROP(n, rapid_trigger_sensitivity),                   \
+        .rapid_trigger = DT_INST_PROP(n, rapid_trigger),                                           \
+    };                                                                                             \
+                                                                                                   \
+    DEVICE_DT_INST_DEFINE(n, &kscan_analog_init, NULL, &kscan_analog_data_##n,                     \
+                          &kscan_analog_config_##n, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY, \
+                          &kscan_analog_api);
+
+DT_INST_FOREACH_STATUS_OKAY(KSCAN_ANALOG_INIT);
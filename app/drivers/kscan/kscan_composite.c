@@ -8,77 +8,120 @@
 
 #include <device.h>
 #include <drivers/kscan.h>
+#include <kernel.h>
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_COMPOSITE_MERGE_EVENTS)
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+#endif
+
 #define MATRIX_NODE_ID DT_DRV_INST(0)
 #define MATRIX_ROWS DT_PROP(MATRIX_NODE_ID, rows)
 #define MATRIX_COLS DT_PROP(MATRIX_NODE_ID, columns)
 
+#define USE_MERGE_EVENTS IS_ENABLED(CONFIG_ZMK_KSCAN_COMPOSITE_MERGE_EVENTS)
+
 struct kscan_composite_child_config {
-    char *label;
+    const struct device *dev;
     uint8_t row_offset;
     uint8_t column_offset;
 };
 
 #define CHILD_CONFIG(inst)                                                                         \
-    {.label = DT_LABEL(DT_PHANDLE(inst, kscan)),                                                   \
+    {.dev = DEVICE_DT_GET(DT_PHANDLE(inst, kscan)),                                                \
      .row_offset = DT_PROP(inst, row_offset),                                                      \
      .column_offset = DT_PROP(inst, column_offset)},
 
-const struct kscan_composite_child_config kscan_composite_children[] = {
+static const struct kscan_composite_child_config kscan_composite_children[] = {
     DT_FOREACH_CHILD(MATRIX_NODE_ID, CHILD_CONFIG)};
 
 struct kscan_composite_config {};
 
+#if USE_MERGE_EVENTS
+/** A key change from a child, already offset into the composite matrix. */
+struct kscan_composite_event {
+    uint16_t row;
+    uint16_t column;
+    bool pressed;
+};
+
+K_MSGQ_DEFINE(kscan_composite_msgq, sizeof(struct kscan_composite_event),
+              CONFIG_ZMK_KSCAN_EVENT_QUEUE_SIZE, 4);
+#endif
+
 struct kscan_composite_data {
     kscan_callback_t callback;
 
     const struct device *dev;
+#if USE_MERGE_EVENTS
+    /** Reports every queued child event upward at once. */
+    struct k_work_delayable merge_work;
+#endif
 };
 
+static struct kscan_composite_data kscan_composite_data;
+
 static int kscan_composite_enable_callback(const struct device *dev) {
     for (int i = 0; i < ARRAY_SIZE(kscan_composite_children); i++) {
-        const struct kscan_composite_child_config *cfg = &kscan_composite_children[i];
-
-        const struct device *dev = device_get_binding(cfg->label);
-        if (!dev) {
-            LOG_WRN("Failed to load child kscan device %s", log_strdup(cfg->label));
-            continue;
-        }
-        kscan_enable_callback(dev);
+        kscan_enable_callback(kscan_composite_children[i].dev);
     }
     return 0;
 }
 
 static int kscan_composite_disable_callback(const struct device *dev) {
     for (int i = 0; i < ARRAY_SIZE(kscan_composite_children); i++) {
-        const struct kscan_composite_child_config *cfg = &kscan_composite_children[i];
-
-        const struct device *dev = device_get_binding(cfg->label);
-        if (!dev) {
-            LOG_WRN("Failed to load child kscan device %s", log_strdup(cfg->label));
-            continue;
-        }
-        kscan_disable_callback(dev);
+        kscan_disable_callback(kscan_composite_children[i].dev);
     }
     return 0;
 }
 
+#if USE_MERGE_EVENTS
+// Runs on the input work queue, so the callback queues the whole frame before the events are
+// processed and frame batching sees every child's changes from the window as one scan.
+static void kscan_composite_merge_work_handler(struct k_work *work) {
+    struct kscan_composite_data *data = &kscan_composite_data;
+    struct kscan_composite_event ev;
+
+    while (k_msgq_get(&kscan_composite_msgq, &ev, K_NO_WAIT) == 0) {
+        data->callback(data->dev, ev.row, ev.column, ev.pressed);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(kscan_composite_merge_work_handler)
+#endif
+
 static void kscan_composite_child_callback(const struct device *child_dev, uint32_t row,
                                            uint32_t column, bool pressed) {
-    // TODO: Ideally we can get this passed into our callback!
-    const struct device *dev = device_get_binding(DT_INST_LABEL(0));
-    struct kscan_composite_data *data = dev->data;
+    struct kscan_composite_data *data = &kscan_composite_data;
 
     for (int i = 0; i < ARRAY_SIZE(kscan_composite_children); i++) {
         const struct kscan_composite_child_config *cfg = &kscan_composite_children[i];
 
-        if (device_get_binding(cfg->label) != child_dev) {
+        if (cfg->dev != child_dev) {
+            continue;
+        }
+
+#if USE_MERGE_EVENTS
+        struct kscan_composite_event ev = {
+            .row = row + cfg->row_offset,
+            .column = column + cfg->column_offset,
+            .pressed = pressed,
+        };
+
+        if (k_msgq_put(&kscan_composite_msgq, &ev, K_NO_WAIT) != 0) {
+            LOG_WRN("Composite kscan event queue full, dropping event");
             continue;
         }
 
-        data->callback(dev, row + cfg->row_offset, column + cfg->column_offset, pressed);
+        // Schedule rather than reschedule so a steady stream of changes can't hold back the
+        // first one for longer than the merge window.
+        k_work_schedule_for_queue(zmk_input_work_q(), &data->merge_work,
+                                  K_MSEC(CONFIG_ZMK_KSCAN_COMPOSITE_MERGE_WINDOW_MS));
+#else
+        data->callback(data->dev, row + cfg->row_offset, column + cfg->column_offset, pressed);
+#endif
     }
 }
 
@@ -89,10 +132,16 @@ static int kscan_composite_configure(const struct device *dev, kscan_callback_t
         return -EINVAL;
     }
 
+    // The children initialize after this device, so check them here instead of in init.
     for (int i = 0; i < ARRAY_SIZE(kscan_composite_children); i++) {
-        const struct kscan_composite_child_config *cfg = &kscan_composite_children[i];
+        const struct device *child = kscan_composite_children[i].dev;
+
+        if (!device_is_ready(child)) {
+            LOG_ERR("Child kscan device %s is not ready", child->name);
+            return -ENODEV;
+        }
 
-        kscan_config(device_get_binding(cfg->label), &kscan_composite_child_callback);
+        kscan_config(child, &kscan_composite_child_callback);
     }
 
     data->callback = callback;
@@ -105,6 +154,11 @@ static int kscan_composite_init(const struct device *dev) {
 
     data->dev = dev;
 
+#if USE_MERGE_EVENTS
+    k_work_init_delayable(&data->merge_work,
+                          ZMK_WORK_WATCHED(kscan_composite_merge_work_handler));
+#endif
+
     return 0;
 }
 
@@ -116,7 +170,5 @@ static const struct kscan_driver_api mock_driver_api = {
 
 static const struct kscan_composite_config kscan_composite_config = {};
 
-static struct kscan_composite_data kscan_composite_data;
-
 DEVICE_DT_INST_DEFINE(0, kscan_composite_init, NULL, &kscan_composite_data, &kscan_composite_config,
                       APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &mock_driver_api);
@@ -4,248 +4,415 @@
  * SPDX-License-Identifier: MIT
  */
 
-#define DT_DRV_COMPAT zmk_kscan_gpio_demux
+#include "debounce.h"
 
 #include <device.h>
-#include <drivers/kscan.h>
+#include <devicetree.h>
 #include <drivers/gpio.h>
+#include <drivers/kscan.h>
+#include <kernel.h>
 #include <logging/log.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include <zmk/energy_stats.h>
+#include <zmk/work_watchdog.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-struct kscan_gpio_item_config {
-    char *label;
-    gpio_pin_t pin;
-    gpio_flags_t flags;
+#define DT_DRV_COMPAT zmk_kscan_gpio_demux
+
+#define INST_INPUTS_LEN(n) DT_INST_PROP_LEN(n, input_gpios)
+#define INST_SELECT_LEN(n) DT_INST_PROP_LEN(n, output_gpios)
+#define INST_OUTPUTS_LEN(n) BIT(INST_SELECT_LEN(n))
+#define INST_MATRIX_LEN(n) (INST_INPUTS_LEN(n) * INST_OUTPUTS_LEN(n))
+
+#if CONFIG_ZMK_KSCAN_DEBOUNCE_PRESS_MS >= 0
+#define INST_DEBOUNCE_PRESS_MS(n) CONFIG_ZMK_KSCAN_DEBOUNCE_PRESS_MS
+#else
+#define INST_DEBOUNCE_PRESS_MS(n)                                                                  \
+    DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_press_ms))
+#endif
+
+#if CONFIG_ZMK_KSCAN_DEBOUNCE_RELEASE_MS >= 0
+#define INST_DEBOUNCE_RELEASE_MS(n) CONFIG_ZMK_KSCAN_DEBOUNCE_RELEASE_MS
+#else
+#define INST_DEBOUNCE_RELEASE_MS(n)                                                                \
+    DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_release_ms))
+#endif
+
+#define KSCAN_GPIO_INPUT_CFG_INIT(idx, inst_idx)                                                   \
+    GPIO_DT_SPEC_GET_BY_IDX(DT_DRV_INST(inst_idx), input_gpios, idx),
+#define KSCAN_GPIO_SELECT_CFG_INIT(idx, inst_idx)                                                  \
+    GPIO_DT_SPEC_GET_BY_IDX(DT_DRV_INST(inst_idx), output_gpios, idx),
+
+/** Pins of one GPIO port, which are all read or set at once. */
+struct kscan_demux_port {
+    const struct device *port;
+    /** Pins used on this port. */
+    gpio_port_pins_t mask;
+    /** Input pins read as active while scanning the current output. */
+    gpio_port_value_t active;
 };
 
-// Helper macro
-#define PWR_TWO(x) (1 << (x))
-
-// Define GPIO cfg
-#define _KSCAN_GPIO_ITEM_CFG_INIT(n, prop, idx)                                                    \
-    {                                                                                              \
-        .label = DT_INST_GPIO_LABEL_BY_IDX(n, prop, idx),                                          \
-        .pin = DT_INST_GPIO_PIN_BY_IDX(n, prop, idx),                                              \
-        .flags = DT_INST_GPIO_FLAGS_BY_IDX(n, prop, idx),                                          \
-    },
-
-// Define row and col cfg
-#define _KSCAN_GPIO_INPUT_CFG_INIT(idx, n) _KSCAN_GPIO_ITEM_CFG_INIT(n, input_gpios, idx)
-#define _KSCAN_GPIO_OUTPUT_CFG_INIT(idx, n) _KSCAN_GPIO_ITEM_CFG_INIT(n, output_gpios, idx)
-
-// Check debounce config
-#define CHECK_DEBOUNCE_CFG(n, a, b) COND_CODE_0(DT_INST_PROP(n, debounce_period), a, b)
-
-// Define the row and column lengths
-#define INST_MATRIX_INPUTS(n) DT_INST_PROP_LEN(n, input_gpios)
-#define INST_DEMUX_GPIOS(n) DT_INST_PROP_LEN(n, output_gpios)
-#define INST_MATRIX_OUTPUTS(n) PWR_TWO(INST_DEMUX_GPIOS(n))
-#define POLL_INTERVAL(n) DT_INST_PROP(n, polling_interval_msec)
-
-#define GPIO_INST_INIT(n)                                                                          \
-    struct kscan_gpio_irq_callback_##n {                                                           \
-        struct CHECK_DEBOUNCE_CFG(n, (k_work), (k_work_delayable)) * work;                         \
-        struct gpio_callback callback;                                                             \
-        const struct device *dev;                                                                  \
-    };                                                                                             \
-                                                                                                   \
-    struct kscan_gpio_config_##n {                                                                 \
-        struct kscan_gpio_item_config rows[INST_MATRIX_INPUTS(n)];                                 \
-        struct kscan_gpio_item_config cols[INST_DEMUX_GPIOS(n)];                                   \
-    };                                                                                             \
-                                                                                                   \
-    struct kscan_gpio_data_##n {                                                                   \
-        kscan_callback_t callback;                                                                 \
-        struct k_timer poll_timer;                                                                 \
-        struct CHECK_DEBOUNCE_CFG(n, (k_work), (k_work_delayable)) work;                           \
-        bool matrix_state[INST_MATRIX_INPUTS(n)][INST_MATRIX_OUTPUTS(n)];                          \
-        const struct device *rows[INST_MATRIX_INPUTS(n)];                                          \
-        const struct device *cols[INST_MATRIX_OUTPUTS(n)];                                         \
-        const struct device *dev;                                                                  \
-    };                                                                                             \
-    /* IO/GPIO SETUP */                                                                            \
-    /* gpio_input_devices are PHYSICAL IO devices */                                               \
-    static const struct device **kscan_gpio_input_devices_##n(const struct device *dev) {          \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        return data->rows;                                                                         \
-    }                                                                                              \
-                                                                                                   \
-    static const struct kscan_gpio_item_config *kscan_gpio_input_configs_##n(                      \
-        const struct device *dev) {                                                                \
-        const struct kscan_gpio_config_##n *cfg = dev->config;                                     \
-        return cfg->rows;                                                                          \
-    }                                                                                              \
-                                                                                                   \
-    /* gpio_output_devices are PHYSICAL IO devices */                                              \
-    static const struct device **kscan_gpio_output_devices_##n(const struct device *dev) {         \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        return data->cols;                                                                         \
-    }                                                                                              \
-                                                                                                   \
-    static const struct kscan_gpio_item_config *kscan_gpio_output_configs_##n(                     \
-        const struct device *dev) {                                                                \
-        const struct kscan_gpio_config_##n *cfg = dev->config;                                     \
-        /* If row2col, rows = outputs & cols = inputs */                                           \
-        return cfg->cols;                                                                          \
-    }                                                                                              \
-    /* POLLING SETUP */                                                                            \
-    static void kscan_gpio_timer_handler(struct k_timer *timer) {                                  \
-        struct kscan_gpio_data_##n *data =                                                         \
-            CONTAINER_OF(timer, struct kscan_gpio_data_##n, poll_timer);                           \
-        k_work_submit(&data->work.work);                                                           \
-    }                                                                                              \
-                                                                                                   \
-    /* Read the state of the input GPIOs */                                                        \
-    /* This is the core matrix_scan func */                                                        \
-    static int kscan_gpio_read_##n(const struct device *dev) {                                     \
-        bool submit_follow_up_read = false;                                                        \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        static bool read_state[INST_MATRIX_INPUTS(n)][INST_MATRIX_OUTPUTS(n)];                     \
-        for (int o = 0; o < INST_MATRIX_OUTPUTS(n); o++) {                                         \
-            /* Iterate over bits and set GPIOs accordingly */                                      \
-            for (uint8_t bit = 0; bit < INST_DEMUX_GPIOS(n); bit++) {                              \
-                uint8_t state = (o & (0b1 << bit)) >> bit;                                         \
-                const struct device *out_dev = kscan_gpio_output_devices_##n(dev)[bit];            \
-                const struct kscan_gpio_item_config *out_cfg =                                     \
-                    &kscan_gpio_output_configs_##n(dev)[bit];                                      \
-                gpio_pin_set(out_dev, out_cfg->pin, state);                                        \
-            }                                                                                      \
-            /* Let the col settle before reading the rows */                                       \
-            k_usleep(1);                                                                           \
-                                                                                                   \
-            for (int i = 0; i < INST_MATRIX_INPUTS(n); i++) {                                      \
-                /* Get the input device (port) */                                                  \
-                const struct device *in_dev = kscan_gpio_input_devices_##n(dev)[i];                \
-                /* Get the input device config (pin) */                                            \
-                const struct kscan_gpio_item_config *in_cfg =                                      \
-                    &kscan_gpio_input_configs_##n(dev)[i];                                         \
-                read_state[i][o] = gpio_pin_get(in_dev, in_cfg->pin) > 0;                          \
-            }                                                                                      \
-        }                                                                                          \
-        for (int r = 0; r < INST_MATRIX_INPUTS(n); r++) {                                          \
-            for (int c = 0; c < INST_MATRIX_OUTPUTS(n); c++) {                                     \
-                bool pressed = read_state[r][c];                                                   \
-                submit_follow_up_read = (submit_follow_up_read || pressed);                        \
-                if (pressed != data->matrix_state[r][c]) {                                         \
-                    LOG_DBG("Sending event at %d,%d state %s", r, c, (pressed ? "on" : "off"));    \
-                    data->matrix_state[r][c] = pressed;                                            \
-                    data->callback(dev, r, c, pressed);                                            \
-                }                                                                                  \
-            }                                                                                      \
-        }                                                                                          \
-        if (submit_follow_up_read) {                                                               \
-            CHECK_DEBOUNCE_CFG(n, ({ k_work_submit(&data->work); }),                               \
-                               ({ k_work_reschedule(&data->work, K_MSEC(5)); }))                   \
-        }                                                                                          \
-        return 0;                                                                                  \
-    }                                                                                              \
-                                                                                                   \
-    static void kscan_gpio_work_handler_##n(struct k_work *work) {                                 \
-        struct kscan_gpio_data_##n *data = CONTAINER_OF(work, struct kscan_gpio_data_##n, work);   \
-        kscan_gpio_read_##n(data->dev);                                                            \
-    }                                                                                              \
-                                                                                                   \
-    static struct kscan_gpio_data_##n kscan_gpio_data_##n = {                                      \
-        .rows = {[INST_MATRIX_INPUTS(n) - 1] = NULL}, .cols = {[INST_DEMUX_GPIOS(n) - 1] = NULL}}; \
-                                                                                                   \
-    /* KSCAN API configure function */                                                             \
-    static int kscan_gpio_configure_##n(const struct device *dev, kscan_callback_t callback) {     \
-        LOG_DBG("KSCAN API configure");                                                            \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        if (!callback) {                                                                           \
-            return -EINVAL;                                                                        \
-        }                                                                                          \
-        data->callback = callback;                                                                 \
-        LOG_DBG("Configured GPIO %d", n);                                                          \
-        return 0;                                                                                  \
-    };                                                                                             \
-                                                                                                   \
-    /* KSCAN API enable function */                                                                \
-    static int kscan_gpio_enable_##n(const struct device *dev) {                                   \
-        LOG_DBG("KSCAN API enable");                                                               \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        /* TODO: we might want a follow up to hook into the sleep state hooks in Zephyr, */        \
-        /* and disable this timer when we enter a sleep state */                                   \
-        k_timer_start(&data->poll_timer, K_MSEC(POLL_INTERVAL(n)), K_MSEC(POLL_INTERVAL(n)));      \
-        return 0;                                                                                  \
-    };                                                                                             \
+struct kscan_demux_data {
+    const struct device *dev;
+    kscan_callback_t callback;
+    struct k_work_delayable work;
+    /**
+     * Ports with inputs on them. Array of length config->inputs.len, of which the first
+     * input_ports_len are used.
+     */
+    struct kscan_demux_port *input_ports;
+    size_t input_ports_len;
+    /** Array of length config->inputs.len: the index into input_ports of each input's port. */
+    uint8_t *input_port_index;
+    /**
+     * Ports with demultiplexer select lines on them. Array of length config->select.len, of
+     * which the first select_ports_len are used.
+     */
+    struct kscan_demux_port *select_ports;
+    size_t select_ports_len;
+    /** Array of length config->select.len: the index into select_ports of each line's port. */
+    uint8_t *select_port_index;
+    /** Timestamp of the current or scheduled scan. */
+    int64_t scan_time;
+    /**
+     * Current state of the matrix, 32 keys per word, with bit (index % 32) of word (index / 32)
+     * holding the key at input (index % config->inputs.len) and output
+     * (index / config->inputs.len). Array of length
+     * DEBOUNCE_WORDS(config->inputs.len << config->select.len)
+     */
+    struct debounce_word_state *matrix_state;
+    /** Raw input state from the last scan, with the same layout as matrix_state. */
+    uint32_t *active;
+    /** config->debounce_config converted to scans. */
+    struct debounce_word_config debounce_config;
+};
+
+struct kscan_gpio_list {
+    const struct gpio_dt_spec *gpios;
+    size_t len;
+};
+
+/** Define a kscan_gpio_list from a compile-time GPIO array. */
+#define KSCAN_GPIO_LIST(gpio_array)                                                                \
+    ((struct kscan_gpio_list){.gpios = gpio_array, .len = ARRAY_SIZE(gpio_array)})
+
+struct kscan_demux_config {
+    struct kscan_gpio_list inputs;
+    /** Demultiplexer address lines, least significant bit first. */
+    struct kscan_gpio_list select;
+    struct debounce_config debounce_config;
+    int32_t debounce_scan_period_ms;
+    int32_t poll_period_ms;
+};
+
+/**
+ * Set the demultiplexer address lines to select an output, one port at a time.
+ */
+static int kscan_demux_select_output(const struct device *dev, const int output) {
+    const struct kscan_demux_config *config = dev->config;
+    struct kscan_demux_data *data = dev->data;
+
+    for (int p = 0; p < data->select_ports_len; p++) {
+        data->select_ports[p].active = 0;
+    }
+
+    for (int bit = 0; bit < config->select.len; bit++) {
+        if (output & BIT(bit)) {
+            const struct gpio_dt_spec *gpio = &config->select.gpios[bit];
+
+            data->select_ports[data->select_port_index[bit]].active |= BIT(gpio->pin);
+        }
+    }
+
+    for (int p = 0; p < data->select_ports_len; p++) {
+        const struct kscan_demux_port *port = &data->select_ports[p];
+
+        int err = gpio_port_set_masked(port->port, port->mask, port->active);
+        if (err) {
+            LOG_ERR("Failed to select output %i on %s: %i", output, port->port->name, err);
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Read every input port once, rather than each input pin separately.
+ */
+static int kscan_demux_read_ports(const struct device *dev) {
+    struct kscan_demux_data *data = dev->data;
+
+    for (int p = 0; p < data->input_ports_len; p++) {
+        struct kscan_demux_port *port = &data->input_ports[p];
+        gpio_port_value_t value;
+
+        int err = gpio_port_get(port->port, &value);
+        if (err) {
+            LOG_ERR("Failed to read inputs on %s: %i", port->port->name, err);
+            return err;
+        }
+
+        port->active = value & port->mask;
+    }
+
+    return 0;
+}
+
+static void kscan_demux_read_continue(const struct device *dev) {
+    const struct kscan_demux_config *config = dev->config;
+    struct kscan_demux_data *data = dev->data;
+
+    data->scan_time += config->debounce_scan_period_ms;
+
+    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+}
+
+static void kscan_demux_read_end(const struct device *dev) {
+    const struct kscan_demux_config *config = dev->config;
+    struct kscan_demux_data *data = dev->data;
+
+    // Only one output can be selected at a time, so there is no way to wake on any key press
+    // with interrupts. Return to polling slowly instead.
+    data->scan_time += config->poll_period_ms;
+
+    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+}
+
+static int kscan_demux_read(const struct device *dev) {
+    struct kscan_demux_data *data = dev->data;
+    const struct kscan_demux_config *config = dev->config;
+    const int outputs = BIT(config->select.len);
+    const int words = DEBOUNCE_WORDS(config->inputs.len * outputs);
+
+    zmk_energy_stats_count(ZMK_ENERGY_KSCAN_SCAN);
+
+    memset(data->active, 0, words * sizeof(data->active[0]));
+
+    // Scan the matrix.
+    for (int o = 0; o < outputs; o++) {
+        int err = kscan_demux_select_output(dev, o);
+        if (err) {
+            return err;
+        }
+
+        // Let the output settle before reading the inputs.
+        k_busy_wait(1);
+
+        err = kscan_demux_read_ports(dev);
+        if (err) {
+            return err;
+        }
+
+        for (int i = 0; i < config->inputs.len; i++) {
+            const struct gpio_dt_spec *in_gpio = &config->inputs.gpios[i];
+
+            if (data->input_ports[data->input_port_index[i]].active & BIT(in_gpio->pin)) {
+                const int index = o * config->inputs.len + i;
+
+                data->active[index / DEBOUNCE_WORD_BITS] |= BIT(index % DEBOUNCE_WORD_BITS);
+            }
+        }
+    }
+
+    // Debounce and process the new state a word at a time.
+    bool continue_scan = false;
+
+    for (int w = 0; w < words; w++) {
+        struct debounce_word_state *state = &data->matrix_state[w];
+
+        debounce_word_update(state, data->active[w], &data->debounce_config);
+
+        for (uint32_t changed = state->changed; changed; changed &= changed - 1) {
+            const int bit = __builtin_ctz(changed);
+            const int index = w * DEBOUNCE_WORD_BITS + bit;
+            const int r = index % config->inputs.len;
+            const int c = index / config->inputs.len;
+            const bool pressed = state->pressed & BIT(bit);
+
+            LOG_DBG("Sending event at %i,%i state %s", r, c, pressed ? "on" : "off");
+            data->callback(dev, r, c, pressed);
+        }
+
+        continue_scan = continue_scan || debounce_word_active(state);
+    }
+
+    if (continue_scan) {
+        // At least one key is pressed or the debouncer has not yet decided if
+        // it is pressed. Poll quickly until everything is released.
+        kscan_demux_read_continue(dev);
+    } else {
+        // All keys are released. Return to normal.
+        kscan_demux_read_end(dev);
+    }
+
+    return 0;
+}
+
+static void kscan_demux_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct kscan_demux_data *data = CONTAINER_OF(dwork, struct kscan_demux_data, work);
+    kscan_demux_read(data->dev);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(kscan_demux_work_handler)
+
+static int kscan_demux_configure(const struct device *dev, const kscan_callback_t callback) {
+    struct kscan_demux_data *data = dev->data;
+
+    if (!callback) {
+        return -EINVAL;
+    }
+
+    data->callback = callback;
+    return 0;
+}
+
+static int kscan_demux_enable(const struct device *dev) {
+    struct kscan_demux_data *data = dev->data;
+
+    data->scan_time = k_uptime_get();
+
+    // Read will automatically schedule the next scan once done.
+    return kscan_demux_read(dev);
+}
+
+static int kscan_demux_disable(const struct device *dev) {
+    struct kscan_demux_data *data = dev->data;
+
+    k_work_cancel_delayable(&data->work);
+    return 0;
+}
+
+/**
+ * Group GPIOs by port, so each port can be read or set at once.
+ */
+static size_t kscan_demux_init_ports(const struct kscan_gpio_list *list,
+                                     struct kscan_demux_port *ports, uint8_t *port_index) {
+    size_t ports_len = 0;
+
+    for (int i = 0; i < list->len; i++) {
+        const struct gpio_dt_spec *gpio = &list->gpios[i];
+        int p = 0;
+
+        while (p < ports_len && ports[p].port != gpio->port) {
+            p++;
+        }
+
+        if (p == ports_len) {
+            ports[p] = (struct kscan_demux_port){.port = gpio->port};
+            ports_len++;
+        }
+
+        ports[p].mask |= BIT(gpio->pin);
+        port_index[i] = p;
+    }
+
+    return ports_len;
+}
+
+static int kscan_demux_init_inst(const struct gpio_dt_spec *gpio, const gpio_flags_t flags) {
+    if (!device_is_ready(gpio->port)) {
+        LOG_ERR("GPIO is not ready: %s", gpio->port->name);
+        return -ENODEV;
+    }
+
+    int err = gpio_pin_configure_dt(gpio, flags);
+    if (err) {
+        LOG_ERR("Unable to configure pin %u on %s: %i", gpio->pin, gpio->port->name, err);
+        return err;
+    }
+
+    LOG_DBG("Configured pin %u on %s", gpio->pin, gpio->port->name);
+
+    return 0;
+}
+
+static int kscan_demux_init(const struct device *dev) {
+    struct kscan_demux_data *data = dev->data;
+    const struct kscan_demux_config *config = dev->config;
+
+    data->dev = dev;
+
+    for (int i = 0; i < config->inputs.len; i++) {
+        int err = kscan_demux_init_inst(&config->inputs.gpios[i], GPIO_INPUT);
+        if (err) {
+            return err;
+        }
+    }
+
+    for (int i = 0; i < config->select.len; i++) {
+        int err = kscan_demux_init_inst(&config->select.gpios[i], GPIO_OUTPUT_INACTIVE);
+        if (err) {
+            return err;
+        }
+    }
+
+    data->input_ports_len =
+        kscan_demux_init_ports(&config->inputs, data->input_ports, data->input_port_index);
+    data->select_ports_len =
+        kscan_demux_init_ports(&config->select, data->select_ports, data->select_port_index);
+
+    debounce_word_config_init(&data->debounce_config, &config->debounce_config,
+                              config->debounce_scan_period_ms);
+
+    k_work_init_delayable(&data->work, ZMK_WORK_WATCHED(kscan_demux_work_handler));
+
+    return 0;
+}
+
+static const struct kscan_driver_api kscan_demux_api = {
+    .config = kscan_demux_configure,
+    .enable_callback = kscan_demux_enable,
+    .disable_callback = kscan_demux_disable,
+};
+
+#define KSCAN_DEMUX_INIT(n)                                                                        \
+    BUILD_ASSERT(INST_DEBOUNCE_PRESS_MS(n) <= DEBOUNCE_COUNTER_MAX,                                \
+                 "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
+    BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
+                 "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
                                                                                                    \
-    /* KSCAN API disable function */                                                               \
-    static int kscan_gpio_disable_##n(const struct device *dev) {                                  \
-        LOG_DBG("KSCAN API disable");                                                              \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        k_timer_stop(&data->poll_timer);                                                           \
-        return 0;                                                                                  \
-    };                                                                                             \
+    static const struct gpio_dt_spec kscan_demux_inputs_##n[] = {                                  \
+        UTIL_LISTIFY(INST_INPUTS_LEN(n), KSCAN_GPIO_INPUT_CFG_INIT, n)};                           \
                                                                                                    \
-    /* GPIO init function*/                                                                        \
-    static int kscan_gpio_init_##n(const struct device *dev) {                                     \
-        LOG_DBG("KSCAN GPIO init");                                                                \
-        struct kscan_gpio_data_##n *data = dev->data;                                              \
-        int err;                                                                                   \
-        /* configure input devices*/                                                               \
-        const struct device **input_devices = kscan_gpio_input_devices_##n(dev);                   \
-        for (int i = 0; i < INST_MATRIX_INPUTS(n); i++) {                                          \
-            const struct kscan_gpio_item_config *in_cfg = &kscan_gpio_input_configs_##n(dev)[i];   \
-            input_devices[i] = device_get_binding(in_cfg->label);                                  \
-            if (!input_devices[i]) {                                                               \
-                LOG_ERR("Unable to find input GPIO device");                                       \
-                return -EINVAL;                                                                    \
-            }                                                                                      \
-            err = gpio_pin_configure(input_devices[i], in_cfg->pin, GPIO_INPUT | in_cfg->flags);   \
-            if (err) {                                                                             \
-                LOG_ERR("Unable to configure pin %d on %s for input", in_cfg->pin, in_cfg->label); \
-                return err;                                                                        \
-            } else {                                                                               \
-                LOG_DBG("Configured pin %d on %s for input", in_cfg->pin, in_cfg->label);          \
-            }                                                                                      \
-            if (err) {                                                                             \
-                LOG_ERR("Error adding the callback to the column device");                         \
-                return err;                                                                        \
-            }                                                                                      \
-        }                                                                                          \
-        /* configure output devices*/                                                              \
-        const struct device **output_devices = kscan_gpio_output_devices_##n(dev);                 \
-        for (int o = 0; o < INST_DEMUX_GPIOS(n); o++) {                                            \
-            const struct kscan_gpio_item_config *out_cfg = &kscan_gpio_output_configs_##n(dev)[o]; \
-            output_devices[o] = device_get_binding(out_cfg->label);                                \
-            if (!output_devices[o]) {                                                              \
-                LOG_ERR("Unable to find output GPIO device");                                      \
-                return -EINVAL;                                                                    \
-            }                                                                                      \
-            err = gpio_pin_configure(output_devices[o], out_cfg->pin,                              \
-                                     GPIO_OUTPUT_ACTIVE | out_cfg->flags);                         \
-            if (err) {                                                                             \
-                LOG_ERR("Unable to configure pin %d on %s for output", out_cfg->pin,               \
-                        out_cfg->label);                                                           \
-                return err;                                                                        \
-            } else {                                                                               \
-                LOG_DBG("Configured pin %d on %s for output", out_cfg->pin, out_cfg->label);       \
-            }                                                                                      \
-        }                                                                                          \
-        data->dev = dev;                                                                           \
+    static const struct gpio_dt_spec kscan_demux_select_##n[] = {                                  \
+        UTIL_LISTIFY(INST_SELECT_LEN(n), KSCAN_GPIO_SELECT_CFG_INIT, n)};                          \
                                                                                                    \
-        k_timer_init(&data->poll_timer, kscan_gpio_timer_handler, NULL);                           \
+    static struct debounce_word_state kscan_demux_state_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];   \
+    static uint32_t kscan_demux_active_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];                    \
                                                                                                    \
-        (CHECK_DEBOUNCE_CFG(n, (k_work_init), (k_work_init_delayable)))(                           \
-            &data->work, kscan_gpio_work_handler_##n);                                             \
-        return 0;                                                                                  \
-    }                                                                                              \
+    static struct kscan_demux_port kscan_demux_input_ports_##n[INST_INPUTS_LEN(n)];                \
+    static uint8_t kscan_demux_input_port_index_##n[INST_INPUTS_LEN(n)];                           \
+    static struct kscan_demux_port kscan_demux_select_ports_##n[INST_SELECT_LEN(n)];               \
+    static uint8_t kscan_demux_select_port_index_##n[INST_SELECT_LEN(n)];                          \
                                                                                                    \
-    static const struct kscan_driver_api gpio_driver_api_##n = {                                   \
-        .config = kscan_gpio_configure_##n,                                                        \
-        .enable_callback = kscan_gpio_enable_##n,                                                  \
-        .disable_callback = kscan_gpio_disable_##n,                                                \
+    static struct kscan_demux_data kscan_demux_data_##n = {                                        \
+        .matrix_state = kscan_demux_state_##n,                                                     \
+        .active = kscan_demux_active_##n,                                                          \
+        .input_ports = kscan_demux_input_ports_##n,                                                \
+        .input_port_index = kscan_demux_input_port_index_##n,                                      \
+        .select_ports = kscan_demux_select_ports_##n,                                              \
+        .select_port_index = kscan_demux_select_port_index_##n,                                    \
     };                                                                                             \
                                                                                                    \
-    static const struct kscan_gpio_config_##n kscan_gpio_config_##n = {                            \
-        .rows = {UTIL_LISTIFY(INST_MATRIX_INPUTS(n), _KSCAN_GPIO_INPUT_CFG_INIT, n)},              \
-        .cols = {UTIL_LISTIFY(INST_DEMUX_GPIOS(n), _KSCAN_GPIO_OUTPUT_CFG_INIT, n)},               \
+    static const struct kscan_demux_config kscan_demux_config_##n = {                              \
+        .inputs = KSCAN_GPIO_LIST(kscan_demux_inputs_##n),                                         \
+        .select = KSCAN_GPIO_LIST(kscan_demux_select_##n),                                         \
+        .debounce_config =                                                                         \
+            {                                                                                      \
+                .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
+                .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
+            },                                                                                     \
+        .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
+        .poll_period_ms = DT_INST_PROP(n, polling_interval_msec),                                  \
     };                                                                                             \
                                                                                                    \
-    DEVICE_DT_INST_DEFINE(n, kscan_gpio_init_##n, NULL, &kscan_gpio_data_##n,                      \
-                          &kscan_gpio_config_##n, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY,   \
-                          &gpio_driver_api_##n);
+    DEVICE_DT_INST_DEFINE(n, &kscan_demux_init, NULL, &kscan_demux_data_##n,                       \
+                          &kscan_demux_config_##n, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY,  \
+                          &kscan_demux_api);
 
-DT_INST_FOREACH_STATUS_OKAY(GPIO_INST_INIT)
+DT_INST_FOREACH_STATUS_OKAY(KSCAN_DEMUX_INIT);
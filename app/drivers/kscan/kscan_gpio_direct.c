@@ -14,6 +14,9 @@
 #include <logging/log.h>
 #include <sys/util.h>
 
+#include <zmk/energy_stats.h>
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #define DT_DRV_COMPAT zmk_kscan_gpio_direct
@@ -32,6 +35,12 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_release_ms))
 #endif
 
+#define INST_OVERRIDE_KEYS_LEN(n) DT_INST_PROP_LEN_OR(n, debounce_override_keys, 0)
+#define INST_OVERRIDE_PRESS_MS(n)                                                                  \
+    DT_INST_PROP_OR(n, debounce_override_press_ms, INST_DEBOUNCE_PRESS_MS(n))
+#define INST_OVERRIDE_RELEASE_MS(n)                                                                \
+    DT_INST_PROP_OR(n, debounce_override_release_ms, INST_DEBOUNCE_RELEASE_MS(n))
+
 #define USE_POLLING IS_ENABLED(CONFIG_ZMK_KSCAN_DIRECT_POLLING)
 #define USE_INTERRUPTS (!USE_POLLING)
 
@@ -48,18 +57,45 @@ struct kscan_direct_irq_callback {
     struct gpio_callback callback;
 };
 
+/** Inputs on one GPIO port, which are all read at once. */
+struct kscan_direct_port {
+    const struct device *port;
+    /** Input pins on this port. */
+    gpio_port_pins_t pins;
+    /** Input pins on this port which are active low. */
+    gpio_port_pins_t invert_mask;
+    /** Pins read as active by the current scan. */
+    gpio_port_value_t active;
+};
+
 struct kscan_direct_data {
     const struct device *dev;
     kscan_callback_t callback;
     struct k_work_delayable work;
 #if USE_INTERRUPTS
-    /** Array of length config->inputs.len */
+    /**
+     * One callback per port, so edges on several pins of a port trigger a single scan. Array of
+     * length config->inputs.len, of which the first ports_len are used.
+     */
     struct kscan_direct_irq_callback *irqs;
 #endif
+    /**
+     * Ports with inputs on them. Array of length config->inputs.len, of which the first ports_len
+     * are used.
+     */
+    struct kscan_direct_port *ports;
+    size_t ports_len;
+    /** Array of length config->inputs.len: the index into ports of each input's port. */
+    uint8_t *input_ports;
     /** Timestamp of the current or scheduled scan. */
     int64_t scan_time;
-    /** Current state of the inputs as an array of length config->inputs.len */
-    struct debounce_state *pin_state;
+    /**
+     * Current state of the inputs, 32 per word, with bit (i % 32) of word (i / 32) holding
+     * input i. Array of length DEBOUNCE_WORDS(config->inputs.len)
+     */
+    struct debounce_word_state *pin_state;
+    /** config->debounce_config converted to scans. */
+    struct debounce_word_config debounce_config;
 };
 
 struct kscan_gpio_list {
@@ -74,6 +110,10 @@ struct kscan_gpio_list {
 struct kscan_direct_config {
     struct kscan_gpio_list inputs;
     struct debounce_config debounce_config;
+    /** Debounce settings of the keys in debounce_override_keys. */
+    struct debounce_config debounce_override_config;
+    const uint32_t *debounce_override_keys;
+    size_t debounce_override_keys_len;
     int32_t debounce_scan_period_ms;
     int32_t poll_period_ms;
     bool toggle_mode;
@@ -116,7 +156,8 @@ static void kscan_direct_irq_callback_handler(const struct device *port, struct
         CONTAINER_OF(cb, struct kscan_direct_irq_callback, callback);
     struct kscan_direct_data *data = irq_data->dev->data;
 
-    // Disable our interrupts temporarily to avoid re-entry while we scan.
+    // Disable our interrupts temporarily to avoid re-entry while we scan. Edges on other pins
+    // until then are picked up by the same scan.
     kscan_direct_interrupt_disable(data->dev);
 
     data->scan_time = k_uptime_get();
@@ -174,28 +215,60 @@ static void kscan_direct_read_end(const struct device *dev) {
 #endif
 }
 
+/**
+ * Read every input port once, rather than each input pin separately.
+ */
+static int kscan_direct_read_ports(const struct device *dev) {
+    struct kscan_direct_data *data = dev->data;
+
+    for (int p = 0; p < data->ports_len; p++) {
+        struct kscan_direct_port *port = &data->ports[p];
+        gpio_port_value_t value;
+
+        int err = gpio_port_get_raw(port->port, &value);
+        if (err) {
+            LOG_ERR("Failed to read inputs on %s: %i", port->port->name, err);
+            return err;
+        }
+
+        port->active = value ^ port->invert_mask;
+    }
+
+    return 0;
+}
+
 static int kscan_direct_read(const struct device *dev) {
     struct kscan_direct_data *data = dev->data;
     const struct kscan_direct_config *config = dev->config;
 
-    // Read the inputs.
-    for (int i = 0; i < config->inputs.len; i++) {
-        const struct gpio_dt_spec *gpio = &config->inputs.gpios[i];
-
-        const bool active = gpio_pin_get_dt(gpio);
+    zmk_energy_stats_count(ZMK_ENERGY_KSCAN_SCAN);
 
-        debounce_update(&data->pin_state[i], active, config->debounce_scan_period_ms,
-                        &config->debounce_config);
+    int err = kscan_direct_read_ports(dev);
+    if (err) {
+        return err;
     }
 
-    // Process the new state.
     bool continue_scan = false;
 
-    for (int i = 0; i < config->inputs.len; i++) {
-        struct debounce_state *state = &data->pin_state[i];
+    for (int w = 0; w < DEBOUNCE_WORDS(config->inputs.len); w++) {
+        struct debounce_word_state *state = &data->pin_state[w];
+        const int start = w * DEBOUNCE_WORD_BITS;
+        const int end = MIN(start + DEBOUNCE_WORD_BITS, config->inputs.len);
+        uint32_t active = 0;
+
+        for (int i = start; i < end; i++) {
+            if (data->ports[data->input_ports[i]].active & BIT(config->inputs.gpios[i].pin)) {
+                active |= BIT(i - start);
+            }
+        }
+
+        // Process the new state.
+        debounce_word_update(state, active, &data->debounce_config);
 
-        if (debounce_get_changed(state)) {
-            const bool pressed = debounce_is_pressed(state);
+        for (uint32_t changed = state->changed; changed; changed &= changed - 1) {
+            const int bit = __builtin_ctz(changed);
+            const int i = start + bit;
+            const bool pressed = state->pressed & BIT(bit);
 
             LOG_DBG("Sending event at 0,%i state %s", i, pressed ? "on" : "off");
             data->callback(dev, 0, i, pressed);
@@ -204,7 +277,7 @@ static int kscan_direct_read(const struct device *dev) {
             }
         }
 
-        continue_scan = continue_scan || debounce_is_active(state);
+        continue_scan = continue_scan || debounce_word_active(state);
     }
 
     if (continue_scan) {
@@ -225,6 +298,8 @@ static void kscan_direct_work_handler(struct k_work *work) {
     kscan_direct_read(data->dev);
 }
 
+ZMK_WORK_WATCHDOG_WRAP(kscan_direct_work_handler)
+
 static int kscan_direct_configure(const struct device *dev, kscan_callback_t callback) {
     struct kscan_direct_data *data = dev->data;
 
@@ -258,7 +333,7 @@ static int kscan_direct_disable(const struct device *dev) {
 }
 
 static int kscan_direct_init_input_inst(const struct device *dev, const struct gpio_dt_spec *gpio,
-                                        const int index, bool toggle_mode) {
+                                        bool toggle_mode) {
     if (!device_is_ready(gpio->port)) {
         LOG_ERR("GPIO is not ready: %s", gpio->port->name);
         return -ENODEV;
@@ -272,44 +347,107 @@ static int kscan_direct_init_input_inst(const struct device *dev, const struct g
 
     LOG_DBG("Configured pin %u on %s for input", gpio->pin, gpio->port->name);
 
-#if USE_INTERRUPTS
-    struct kscan_direct_data *data = dev->data;
-    struct kscan_direct_irq_callback *irq = &data->irqs[index];
+    return 0;
+}
 
-    irq->dev = dev;
-    gpio_init_callback(&irq->callback, kscan_direct_irq_callback_handler, BIT(gpio->pin));
-    err = gpio_add_callback(gpio->port, &irq->callback);
-    if (err) {
-        LOG_ERR("Error adding the callback to the input device: %i", err);
-        return err;
+static int kscan_direct_init_inputs(const struct device *dev) {
+    const struct kscan_direct_config *config = dev->config;
+
+    for (int i = 0; i < config->inputs.len; i++) {
+        const struct gpio_dt_spec *gpio = &config->inputs.gpios[i];
+        int err = kscan_direct_init_input_inst(dev, gpio, config->toggle_mode);
+        if (err) {
+            return err;
+        }
     }
-#endif
 
     return 0;
 }
 
-static int kscan_direct_init_inputs(const struct device *dev) {
+/**
+ * Group the inputs by the GPIO port they are on.
+ */
+static int kscan_direct_init_ports(const struct device *dev) {
     const struct kscan_direct_config *config = dev->config;
+    struct kscan_direct_data *data = dev->data;
+
+    data->ports_len = 0;
 
     for (int i = 0; i < config->inputs.len; i++) {
         const struct gpio_dt_spec *gpio = &config->inputs.gpios[i];
-        int err = kscan_direct_init_input_inst(dev, gpio, i, config->toggle_mode);
+        int p = 0;
+
+        while (p < data->ports_len && data->ports[p].port != gpio->port) {
+            p++;
+        }
+
+        if (p == data->ports_len) {
+            data->ports[p] = (struct kscan_direct_port){.port = gpio->port};
+            data->ports_len++;
+        }
+
+        data->ports[p].pins |= BIT(gpio->pin);
+        if (gpio->dt_flags & GPIO_ACTIVE_LOW) {
+            data->ports[p].invert_mask |= BIT(gpio->pin);
+        }
+
+        data->input_ports[i] = p;
+    }
+
+#if USE_INTERRUPTS
+    for (int p = 0; p < data->ports_len; p++) {
+        struct kscan_direct_irq_callback *irq = &data->irqs[p];
+
+        irq->dev = dev;
+        gpio_init_callback(&irq->callback, kscan_direct_irq_callback_handler, data->ports[p].pins);
+        int err = gpio_add_callback(data->ports[p].port, &irq->callback);
         if (err) {
+            LOG_ERR("Error adding the callback to the input device: %i", err);
             return err;
         }
     }
+#endif
 
     return 0;
 }
 
+static void kscan_direct_init_debounce(const struct device *dev) {
+    struct kscan_direct_data *data = dev->data;
+    const struct kscan_direct_config *config = dev->config;
+
+    debounce_word_config_init(&data->debounce_config, &config->debounce_config,
+                              config->debounce_scan_period_ms);
+
+    if (config->debounce_override_keys_len == 0) {
+        return;
+    }
+
+    debounce_word_config_set_override(&data->debounce_config, &config->debounce_override_config,
+                                      config->debounce_scan_period_ms);
+
+    for (int i = 0; i < config->debounce_override_keys_len; i++) {
+        const uint32_t input = config->debounce_override_keys[i];
+
+        if (input >= config->inputs.len) {
+            LOG_WRN("Ignoring debounce override for missing input %u", input);
+            continue;
+        }
+
+        data->pin_state[input / DEBOUNCE_WORD_BITS].override |= BIT(input % DEBOUNCE_WORD_BITS);
+    }
+}
+
 static int kscan_direct_init(const struct device *dev) {
     struct kscan_direct_data *data = dev->data;
 
     data->dev = dev;
 
+    kscan_direct_init_debounce(dev);
+
     kscan_direct_init_inputs(dev);
+    kscan_direct_init_ports(dev);
 
-    k_work_init_delayable(&data->work, kscan_direct_work_handler);
+    k_work_init_delayable(&data->work, ZMK_WORK_WATCHED(kscan_direct_work_handler));
 
     return 0;
 }
@@ -325,17 +463,33 @@ static const struct kscan_driver_api kscan_direct_api = {
                  "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
     BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
                  "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
+    BUILD_ASSERT(INST_OVERRIDE_PRESS_MS(n) <= DEBOUNCE_COUNTER_MAX,                                \
+                 "debounce-override-press-ms is too large");                                       \
+    BUILD_ASSERT(INST_OVERRIDE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
+                 "debounce-override-release-ms is too large");                                     \
+                                                                                                   \
+    COND_CODE_1(DT_INST_NODE_HAS_PROP(n, debounce_override_keys),                                  \
+                (static const uint32_t kscan_direct_override_keys_##n[] =                          \
+                     DT_INST_PROP(n, debounce_override_keys);),                                    \
+                ())                                                                                \
                                                                                                    \
     static const struct gpio_dt_spec kscan_direct_inputs_##n[] = {                                 \
         UTIL_LISTIFY(INST_INPUTS_LEN(n), KSCAN_DIRECT_INPUT_CFG_INIT, n)};                         \
                                                                                                    \
-    static struct debounce_state kscan_direct_state_##n[INST_INPUTS_LEN(n)];                       \
+    static struct debounce_word_state                                                              \
+        kscan_direct_state_##n[DEBOUNCE_WORDS(INST_INPUTS_LEN(n))];                                \
+                                                                                                   \
+    static struct kscan_direct_port kscan_direct_ports_##n[INST_INPUTS_LEN(n)];                    \
+    static uint8_t kscan_direct_input_ports_##n[INST_INPUTS_LEN(n)];                               \
                                                                                                    \
     COND_INTERRUPTS(                                                                               \
         (static struct kscan_direct_irq_callback kscan_direct_irqs_##n[INST_INPUTS_LEN(n)];))      \
                                                                                                    \
     static struct kscan_direct_data kscan_direct_data_##n = {                                      \
-        .pin_state = kscan_direct_state_##n, COND_INTERRUPTS((.irqs = kscan_direct_irqs_##n, ))};  \
+        .pin_state = kscan_direct_state_##n,                                                       \
+        .ports = kscan_direct_ports_##n,                                                           \
+        .input_ports = kscan_direct_input_ports_##n,                                               \
+        COND_INTERRUPTS((.irqs = kscan_direct_irqs_##n, ))};                                       \
                                                                                                    \
     static struct kscan_direct_config kscan_direct_config_##n = {                                  \
         .inputs = KSCAN_GPIO_LIST(kscan_direct_inputs_##n),                                        \
@@ -344,6 +498,14 @@ static const struct kscan_driver_api kscan_direct_api = {
                 .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
                 .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
             },                                                                                     \
+        .debounce_override_config =                                                                \
+            {                                                                                      \
+                .debounce_press_ms = INST_OVERRIDE_PRESS_MS(n),                                    \
+                .debounce_release_ms = INST_OVERRIDE_RELEASE_MS(n),                                \
+            },                                                                                     \
+        .debounce_override_keys = COND_CODE_1(DT_INST_NODE_HAS_PROP(n, debounce_override_keys),    \
+                                              (kscan_direct_override_keys_##n), (NULL)),           \
+        .debounce_override_keys_len = INST_OVERRIDE_KEYS_LEN(n),                                   \
         .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
         .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
         .toggle_mode = DT_INST_PROP(n, toggle_mode),                                               \
@@ -10,11 +10,17 @@
 #include <devicetree.h>
 #include <drivers/gpio.h>
 #include <drivers/kscan.h>
+#include <drivers/kscan_frame.h>
 #include <kernel.h>
 #include <logging/log.h>
+#include <string.h>
 #include <sys/__assert.h>
 #include <sys/util.h>
 
+#include <dt-bindings/zmk/matrix_transform.h>
+#include <zmk/energy_stats.h>
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #define DT_DRV_COMPAT zmk_kscan_gpio_matrix
@@ -42,10 +48,20 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_release_ms))
 #endif
 
+#define INST_OVERRIDE_KEYS_LEN(n) DT_INST_PROP_LEN_OR(n, debounce_override_keys, 0)
+#define INST_OVERRIDE_PRESS_MS(n)                                                                  \
+    DT_INST_PROP_OR(n, debounce_override_press_ms, INST_DEBOUNCE_PRESS_MS(n))
+#define INST_OVERRIDE_RELEASE_MS(n)                                                                \
+    DT_INST_PROP_OR(n, debounce_override_release_ms, INST_DEBOUNCE_RELEASE_MS(n))
+
 #define USE_POLLING IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_POLLING)
 #define USE_INTERRUPTS (!USE_POLLING)
 
-#define COND_INTERRUPTS(code) COND_CODE_1(CONFIG_ZMK_KSCAN_MATRIX_POLLING, (), code)
+#define USE_TIMER_SCAN IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_TIMER_SCAN)
+#define USE_ADAPTIVE_SCAN IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_ADAPTIVE_SCAN)
+#define USE_CALIBRATION IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_CALIBRATION)
+
+#define COND_CALIBRATION(code) COND_CODE_1(CONFIG_ZMK_KSCAN_MATRIX_CALIBRATION, code, ())
 #define COND_POLL_OR_INTERRUPTS(pollcode, intcode)                                                 \
     COND_CODE_1(CONFIG_ZMK_KSCAN_MATRIX_POLLING, pollcode, intcode)
 
@@ -59,9 +75,29 @@ enum kscan_diode_direction {
     KSCAN_COL2ROW,
 };
 
-struct kscan_matrix_irq_callback {
+/** Inputs on one GPIO port, which are all read at once. */
+struct kscan_matrix_port {
+    const struct device *port;
+    /** Input pins on this port which are active low. */
+    gpio_port_pins_t invert_mask;
+    /** Pins read as active while scanning the current output. */
+    gpio_port_value_t active;
+#if USE_INTERRUPTS
+    /** Input pins on this port which interrupted since the last scan. */
+    gpio_port_pins_t fired;
+    /** The kscan device, for callback. */
     const struct device *dev;
+    /** Called for every input on this port, so a wake-up is handled once per port. */
     struct gpio_callback callback;
+#endif
+};
+
+/** Times in microseconds for the inputs to settle after changing an output. */
+struct kscan_matrix_settle {
+    /** Wait after setting an output active, before reading the inputs. */
+    uint32_t before_inputs_us;
+    /** Wait after setting an output inactive, before setting the next one active. */
+    uint32_t between_outputs_us;
 };
 
 struct kscan_matrix_data {
@@ -69,16 +105,56 @@ struct kscan_matrix_data {
     kscan_callback_t callback;
     struct k_work_delayable work;
 #if USE_INTERRUPTS
-    /** Array of length config->inputs.len */
-    struct kscan_matrix_irq_callback *irqs;
+    /** Set by an interrupt, so the next scan only reads the inputs which fired. */
+    bool targeted_scan;
 #endif
+    /**
+     * Ports with inputs on them. Array of length config->inputs.len, of which the first ports_len
+     * are used.
+     */
+    struct kscan_matrix_port *ports;
+    size_t ports_len;
+    /** Array of length config->inputs.len: the index into ports of each input's port. */
+    uint8_t *input_ports;
     /** Timestamp of the current or scheduled scan. */
     int64_t scan_time;
+#if USE_ADAPTIVE_SCAN
+    /** Time between the current and the next scan in milliseconds. */
+    int32_t scan_period_ms;
+    /** Number of scans since the driver was initialized. */
+    uint32_t scan_count;
+    /** Number of those scans made while a key was active. */
+    uint32_t active_scan_count;
+#endif
+#if USE_CALIBRATION
+    /** Settle times from Kconfig, or from the last calibration. */
+    struct kscan_matrix_settle settle;
+    /** Duration of the last, fastest and slowest scans in hardware cycles. */
+    uint32_t scan_cycles_last;
+    uint32_t scan_cycles_min;
+    uint32_t scan_cycles_max;
+#endif
     /**
-     * Current state of the matrix as a flattened 2D array of length
-     * (config->rows.len * config->cols.len)
+     * Current state of the matrix, 32 keys per word, with bit (index % 32) of word (index / 32)
+     * holding the key at state_index_rc(). Array of length
+     * DEBOUNCE_WORDS(config->rows.len * config->cols.len)
      */
-    struct debounce_state *matrix_state;
+    struct debounce_word_state *matrix_state;
+    /** Raw input state from the last scan, with the same layout as matrix_state. */
+    uint32_t *active;
+    /** config->debounce_config converted to scans. */
+    struct debounce_word_config debounce_config;
+    /** If set, whole scans are reported to this instead of each key to callback. */
+    kscan_frame_callback_t frame_callback;
+    /** Changed and pressed keys of the last scan, with the same layout as active. */
+    uint32_t *frame_changed;
+    uint32_t *frame_pressed;
+#if USE_TIMER_SCAN
+    /** Periodically submits scan_work while any key is pressed. */
+    struct k_timer timer;
+    /** Scans the matrix on the scan work queue. */
+    struct k_work scan_work;
+#endif
 };
 
 struct kscan_gpio_list {
@@ -96,6 +172,10 @@ struct kscan_matrix_config {
     struct kscan_gpio_list inputs;
     struct kscan_gpio_list outputs;
     struct debounce_config debounce_config;
+    /** Debounce settings of the keys in debounce_override_keys. */
+    struct debounce_config debounce_override_config;
+    const uint32_t *debounce_override_keys;
+    size_t debounce_override_keys_len;
     int32_t debounce_scan_period_ms;
     int32_t poll_period_ms;
     enum kscan_diode_direction diode_direction;
@@ -138,6 +218,11 @@ static int kscan_matrix_set_all_outputs(const struct device *dev, const int valu
 }
 
 #if USE_INTERRUPTS
+/**
+ * Level interrupts, unlike edge ones, are detected by the GPIO port itself on nRF SoCs (with the
+ * SENSE mechanism), so waiting for one costs no GPIOTE channel and next to no idle current however
+ * many inputs the matrix has.
+ */
 static int kscan_matrix_interrupt_configure(const struct device *dev, const gpio_flags_t flags) {
     const struct kscan_matrix_config *config = dev->config;
 
@@ -184,16 +269,24 @@ static int kscan_matrix_interrupt_disable(const struct device *dev) {
 #if USE_INTERRUPTS
 static void kscan_matrix_irq_callback_handler(const struct device *port, struct gpio_callback *cb,
                                               const gpio_port_pins_t pin) {
-    struct kscan_matrix_irq_callback *irq_data =
-        CONTAINER_OF(cb, struct kscan_matrix_irq_callback, callback);
-    struct kscan_matrix_data *data = irq_data->dev->data;
+    struct kscan_matrix_port *matrix_port = CONTAINER_OF(cb, struct kscan_matrix_port, callback);
+    struct kscan_matrix_data *data = matrix_port->dev->data;
 
     // Disable our interrupts temporarily to avoid re-entry while we scan.
     kscan_matrix_interrupt_disable(data->dev);
 
+    matrix_port->fired |= pin;
+    data->targeted_scan = true;
+
     data->scan_time = k_uptime_get();
 
+#if USE_TIMER_SCAN
+    const struct kscan_matrix_config *config = data->dev->config;
+
+    k_timer_start(&data->timer, K_NO_WAIT, K_MSEC(config->debounce_scan_period_ms));
+#else
     k_work_reschedule(&data->work, K_NO_WAIT);
+#endif
 }
 #endif
 
@@ -201,12 +294,31 @@ static void kscan_matrix_read_continue(const struct device *dev) {
     const struct kscan_matrix_config *config = dev->config;
     struct kscan_matrix_data *data = dev->data;
 
+#if USE_TIMER_SCAN
+    // The periodic timer keeps running until every key is released.
+    if (k_timer_remaining_ticks(&data->timer) == 0) {
+        k_timer_start(&data->timer, K_MSEC(config->debounce_scan_period_ms),
+                      K_MSEC(config->debounce_scan_period_ms));
+    }
+#else
+#if USE_ADAPTIVE_SCAN
+    data->scan_period_ms = config->debounce_scan_period_ms;
+    data->active_scan_count++;
+#endif
+
     data->scan_time += config->debounce_scan_period_ms;
 
     k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+#endif
 }
 
 static void kscan_matrix_read_end(const struct device *dev) {
+#if USE_TIMER_SCAN
+    struct kscan_matrix_data *data = dev->data;
+
+    k_timer_stop(&data->timer);
+#endif
+
 #if USE_INTERRUPTS
     // Return to waiting for an interrupt.
     kscan_matrix_interrupt_enable(dev);
@@ -214,71 +326,218 @@ static void kscan_matrix_read_end(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
     const struct kscan_matrix_config *config = dev->config;
 
+#if USE_ADAPTIVE_SCAN
+    // Another key is likely to follow soon after the last one was released, so slow down
+    // gradually, doubling the interval until it reaches the poll period.
+    data->scan_period_ms = MIN(data->scan_period_ms * 2, config->poll_period_ms);
+    data->scan_time += data->scan_period_ms;
+#else
     data->scan_time += config->poll_period_ms;
+#endif
 
     // Return to polling slowly.
     k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
 #endif
 }
 
+/**
+ * Read every input port once, rather than each input pin separately.
+ */
+static int kscan_matrix_read_ports(const struct device *dev) {
+    struct kscan_matrix_data *data = dev->data;
+
+    for (int p = 0; p < data->ports_len; p++) {
+        struct kscan_matrix_port *port = &data->ports[p];
+        gpio_port_value_t value;
+
+#if USE_INTERRUPTS
+        // Every key was released before the interrupt, so the inputs which didn't fire can be
+        // left as released until the next scan.
+        if (data->targeted_scan && port->fired == 0) {
+            port->active = 0;
+            continue;
+        }
+#endif
+
+        int err = gpio_port_get_raw(port->port, &value);
+        if (err) {
+            LOG_ERR("Failed to read inputs on %s: %i", port->port->name, err);
+            return err;
+        }
+
+        port->active = value ^ port->invert_mask;
+
+#if USE_INTERRUPTS
+        if (data->targeted_scan) {
+            port->active &= port->fired;
+        }
+#endif
+    }
+
+    return 0;
+}
+
+/**
+ * Get how long to wait after setting an output inactive, before setting the next one active.
+ */
+static uint32_t kscan_matrix_between_outputs_us(const struct device *dev) {
+#if USE_CALIBRATION
+    const struct kscan_matrix_data *data = dev->data;
+
+    return data->settle.between_outputs_us;
+#else
+    return CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS;
+#endif
+}
+
 static int kscan_matrix_read(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
     const struct kscan_matrix_config *config = dev->config;
 
+    zmk_energy_stats_count(ZMK_ENERGY_KSCAN_SCAN);
+
+    const int words = DEBOUNCE_WORDS(config->rows.len * config->cols.len);
+
+#if USE_ADAPTIVE_SCAN
+    data->scan_count++;
+#endif
+
+#if USE_CALIBRATION
+    const uint32_t start_cycles = k_cycle_get_32();
+#endif
+
+    memset(data->active, 0, words * sizeof(data->active[0]));
+
+    // Whether the current output was already set active along with the previous one.
+    bool output_active = false;
+
     // Scan the matrix.
     for (int o = 0; o < config->outputs.len; o++) {
         const struct gpio_dt_spec *out_gpio = &config->outputs.gpios[o];
-
-        int err = gpio_pin_set_dt(out_gpio, 1);
-        if (err) {
-            LOG_ERR("Failed to set output %i active: %i", o, err);
-            return err;
+        const struct gpio_dt_spec *next_gpio =
+            o + 1 < config->outputs.len ? &config->outputs.gpios[o + 1] : NULL;
+        int err;
+
+        if (!output_active) {
+            err = gpio_pin_set_dt(out_gpio, 1);
+            if (err) {
+                LOG_ERR("Failed to set output %i active: %i", o, err);
+                return err;
+            }
         }
 
-#if CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS > 0
+#if USE_CALIBRATION
+        if (data->settle.before_inputs_us > 0) {
+            k_busy_wait(data->settle.before_inputs_us);
+        }
+#elif CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS > 0
         k_busy_wait(CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS);
 #endif
 
+        err = kscan_matrix_read_ports(dev);
+        if (err) {
+            return err;
+        }
+
         for (int i = 0; i < config->inputs.len; i++) {
             const struct gpio_dt_spec *in_gpio = &config->inputs.gpios[i];
 
-            const int index = state_index_io(config, i, o);
-            const bool active = gpio_pin_get_dt(in_gpio);
+            if (data->ports[data->input_ports[i]].active & BIT(in_gpio->pin)) {
+                const int index = state_index_io(config, i, o);
+
+                data->active[index / DEBOUNCE_WORD_BITS] |= BIT(index % DEBOUNCE_WORD_BITS);
+            }
+        }
 
-            debounce_update(&data->matrix_state[index], active, config->debounce_scan_period_ms,
-                            &config->debounce_config);
+        // Without a wait between outputs, hand over to the next output with a single port write.
+        // For outputs on a shift register or I/O expander, that halves the bus transfers.
+        if (next_gpio && next_gpio->port == out_gpio->port &&
+            kscan_matrix_between_outputs_us(dev) == 0) {
+            err = gpio_port_set_masked(out_gpio->port, BIT(out_gpio->pin) | BIT(next_gpio->pin),
+                                       BIT(next_gpio->pin));
+            if (err) {
+                LOG_ERR("Failed to switch from output %i to %i: %i", o, o + 1, err);
+                return err;
+            }
+
+            output_active = true;
+            continue;
         }
 
+        output_active = false;
+
         err = gpio_pin_set_dt(out_gpio, 0);
         if (err) {
             LOG_ERR("Failed to set output %i inactive: %i", o, err);
             return err;
         }
 
-#if CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS > 0
-        k_busy_wait(CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS);
-#endif
+        const uint32_t between_outputs_us = kscan_matrix_between_outputs_us(dev);
+        if (between_outputs_us > 0) {
+            k_busy_wait(between_outputs_us);
+        }
     }
 
-    // Process the new state.
+#if USE_INTERRUPTS
+    // Once the keys which woke the matrix are found, go back to scanning everything.
+    if (data->targeted_scan) {
+        for (int p = 0; p < data->ports_len; p++) {
+            data->ports[p].fired = 0;
+        }
+        data->targeted_scan = false;
+    }
+#endif
+
+    // Debounce and process the new state a word at a time.
     bool continue_scan = false;
+    bool frame_changed = false;
 
-    for (int r = 0; r < config->rows.len; r++) {
-        for (int c = 0; c < config->cols.len; c++) {
-            const int index = state_index_rc(config, r, c);
-            struct debounce_state *state = &data->matrix_state[index];
+    for (int w = 0; w < words; w++) {
+        struct debounce_word_state *state = &data->matrix_state[w];
 
-            if (debounce_get_changed(state)) {
-                const bool pressed = debounce_is_pressed(state);
+        debounce_word_update(state, data->active[w], &data->debounce_config);
 
-                LOG_DBG("Sending event at %i,%i state %s", r, c, pressed ? "on" : "off");
-                data->callback(dev, r, c, pressed);
-            }
+        continue_scan = continue_scan || debounce_word_active(state);
+
+        if (data->frame_callback) {
+            data->frame_changed[w] = state->changed;
+            data->frame_pressed[w] = state->pressed;
+            frame_changed = frame_changed || state->changed;
+            continue;
+        }
+
+        for (uint32_t changed = state->changed; changed; changed &= changed - 1) {
+            const int bit = __builtin_ctz(changed);
+            const int index = w * DEBOUNCE_WORD_BITS + bit;
+            const bool pressed = state->pressed & BIT(bit);
+            const int r = index % config->rows.len;
+            const int c = index / config->rows.len;
 
-            continue_scan = continue_scan || debounce_is_active(state);
+            LOG_DBG("Sending event at %i,%i state %s", r, c, pressed ? "on" : "off");
+            data->callback(dev, r, c, pressed);
         }
     }
 
+    if (frame_changed) {
+        const struct kscan_frame frame = {
+            .changed = data->frame_changed,
+            .pressed = data->frame_pressed,
+            .words = words,
+            .rows = config->rows.len,
+            .timestamp = k_uptime_get(),
+        };
+
+        data->frame_callback(dev, &frame);
+    }
+
+#if USE_CALIBRATION
+    const uint32_t scan_cycles = k_cycle_get_32() - start_cycles;
+
+    data->scan_cycles_last = scan_cycles;
+    data->scan_cycles_min = MIN(data->scan_cycles_min, scan_cycles);
+    data->scan_cycles_max = MAX(data->scan_cycles_max, scan_cycles);
+#endif
+
     if (continue_scan) {
         // At least one key is pressed or the debouncer has not yet decided if
         // it is pressed. Poll quickly until everything is released.
@@ -297,6 +556,44 @@ static void kscan_matrix_work_handler(struct k_work *work) {
     kscan_matrix_read(data->dev);
 }
 
+ZMK_WORK_WATCHDOG_WRAP(kscan_matrix_work_handler)
+
+#if USE_TIMER_SCAN
+K_THREAD_STACK_DEFINE(kscan_matrix_scan_q_stack, CONFIG_ZMK_KSCAN_MATRIX_TIMER_SCAN_STACK_SIZE);
+
+// Shared by every instance. Reading the inputs may go through an I2C or SPI GPIO expander, which
+// can't be done from the timer interrupt.
+static struct k_work_q kscan_matrix_scan_q;
+
+static void kscan_matrix_scan_work_handler(struct k_work *work) {
+    struct kscan_matrix_data *data = CONTAINER_OF(work, struct kscan_matrix_data, scan_work);
+    kscan_matrix_read(data->dev);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(kscan_matrix_scan_work_handler)
+
+static void kscan_matrix_timer_handler(struct k_timer *timer) {
+    struct kscan_matrix_data *data = CONTAINER_OF(timer, struct kscan_matrix_data, timer);
+
+    // If the previous scan is still queued, this is a no-op rather than a second scan.
+    k_work_submit_to_queue(&kscan_matrix_scan_q, &data->scan_work);
+}
+
+static void kscan_matrix_start_scan_q(void) {
+    static bool started;
+
+    if (started) {
+        return;
+    }
+
+    static const struct k_work_queue_config queue_config = {.name = "ZMK KScan Matrix Scan"};
+    k_work_queue_start(&kscan_matrix_scan_q, kscan_matrix_scan_q_stack,
+                       K_THREAD_STACK_SIZEOF(kscan_matrix_scan_q_stack),
+                       CONFIG_ZMK_KSCAN_MATRIX_TIMER_SCAN_PRIORITY, &queue_config);
+    started = true;
+}
+#endif
+
 static int kscan_matrix_configure(const struct device *dev, const kscan_callback_t callback) {
     struct kscan_matrix_data *data = dev->data;
 
@@ -308,10 +605,28 @@ static int kscan_matrix_configure(const struct device *dev, const kscan_callback
     return 0;
 }
 
+static int kscan_matrix_configure_frame(const struct device *dev,
+                                        const kscan_frame_callback_t callback) {
+    struct kscan_matrix_data *data = dev->data;
+
+    if (!callback) {
+        return -EINVAL;
+    }
+
+    data->frame_callback = callback;
+    return 0;
+}
+
 static int kscan_matrix_enable(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
+#if USE_ADAPTIVE_SCAN
+    const struct kscan_matrix_config *config = dev->config;
+#endif
 
     data->scan_time = k_uptime_get();
+#if USE_ADAPTIVE_SCAN
+    data->scan_period_ms = config->poll_period_ms;
+#endif
 
     // Read will automatically start interrupts/polling once done.
     return kscan_matrix_read(dev);
@@ -322,6 +637,11 @@ static int kscan_matrix_disable(const struct device *dev) {
 
     k_work_cancel_delayable(&data->work);
 
+#if USE_TIMER_SCAN
+    k_timer_stop(&data->timer);
+    k_work_cancel(&data->scan_work);
+#endif
+
 #if USE_INTERRUPTS
     return kscan_matrix_interrupt_disable(dev);
 #else
@@ -329,8 +649,8 @@ static int kscan_matrix_disable(const struct device *dev) {
 #endif
 }
 
-static int kscan_matrix_init_input_inst(const struct device *dev, const struct gpio_dt_spec *gpio,
-                                        const int index) {
+static int kscan_matrix_init_input_inst(const struct device *dev,
+                                        const struct gpio_dt_spec *gpio) {
     if (!device_is_ready(gpio->port)) {
         LOG_ERR("GPIO is not ready: %s", gpio->port->name);
         return -ENODEV;
@@ -344,32 +664,69 @@ static int kscan_matrix_init_input_inst(const struct device *dev, const struct g
 
     LOG_DBG("Configured pin %u on %s for input", gpio->pin, gpio->port->name);
 
-#if USE_INTERRUPTS
-    struct kscan_matrix_data *data = dev->data;
-    struct kscan_matrix_irq_callback *irq = &data->irqs[index];
+    return 0;
+}
 
-    irq->dev = dev;
-    gpio_init_callback(&irq->callback, kscan_matrix_irq_callback_handler, BIT(gpio->pin));
-    err = gpio_add_callback(gpio->port, &irq->callback);
-    if (err) {
-        LOG_ERR("Error adding the callback to the input device: %i", err);
-        return err;
+static int kscan_matrix_init_inputs(const struct device *dev) {
+    const struct kscan_matrix_config *config = dev->config;
+
+    for (int i = 0; i < config->inputs.len; i++) {
+        const struct gpio_dt_spec *gpio = &config->inputs.gpios[i];
+        int err = kscan_matrix_init_input_inst(dev, gpio);
+        if (err) {
+            return err;
+        }
     }
-#endif
 
     return 0;
 }
 
-static int kscan_matrix_init_inputs(const struct device *dev) {
+/**
+ * Group the inputs by the GPIO port they are on, with one interrupt callback for each port.
+ */
+static int kscan_matrix_init_ports(const struct device *dev) {
     const struct kscan_matrix_config *config = dev->config;
+    struct kscan_matrix_data *data = dev->data;
+
+    data->ports_len = 0;
 
     for (int i = 0; i < config->inputs.len; i++) {
         const struct gpio_dt_spec *gpio = &config->inputs.gpios[i];
-        int err = kscan_matrix_init_input_inst(dev, gpio, i);
+        int p = 0;
+
+        while (p < data->ports_len && data->ports[p].port != gpio->port) {
+            p++;
+        }
+
+        if (p == data->ports_len) {
+            data->ports[p] = (struct kscan_matrix_port){.port = gpio->port};
+#if USE_INTERRUPTS
+            data->ports[p].dev = dev;
+            gpio_init_callback(&data->ports[p].callback, kscan_matrix_irq_callback_handler, 0);
+#endif
+            data->ports_len++;
+        }
+
+        if (gpio->dt_flags & GPIO_ACTIVE_LOW) {
+            data->ports[p].invert_mask |= BIT(gpio->pin);
+        }
+
+#if USE_INTERRUPTS
+        data->ports[p].callback.pin_mask |= BIT(gpio->pin);
+#endif
+
+        data->input_ports[i] = p;
+    }
+
+#if USE_INTERRUPTS
+    for (int p = 0; p < data->ports_len; p++) {
+        int err = gpio_add_callback(data->ports[p].port, &data->ports[p].callback);
         if (err) {
+            LOG_ERR("Error adding the callback to %s: %i", data->ports[p].port->name, err);
             return err;
         }
     }
+#endif
 
     return 0;
 }
@@ -406,24 +763,67 @@ static int kscan_matrix_init_outputs(const struct device *dev) {
     return 0;
 }
 
+static void kscan_matrix_init_debounce(const struct device *dev) {
+    struct kscan_matrix_data *data = dev->data;
+    const struct kscan_matrix_config *config = dev->config;
+
+    debounce_word_config_init(&data->debounce_config, &config->debounce_config,
+                              config->debounce_scan_period_ms);
+
+    if (config->debounce_override_keys_len == 0) {
+        return;
+    }
+
+    debounce_word_config_set_override(&data->debounce_config, &config->debounce_override_config,
+                                      config->debounce_scan_period_ms);
+
+    for (int i = 0; i < config->debounce_override_keys_len; i++) {
+        const uint32_t key = config->debounce_override_keys[i];
+        const int row = KT_ROW(key);
+        const int col = KT_COL(key);
+
+        if (row >= config->rows.len || col >= config->cols.len) {
+            LOG_WRN("Ignoring debounce override for row %d column %d outside the matrix", row,
+                    col);
+            continue;
+        }
+
+        const int index = state_index_rc(config, row, col);
+        data->matrix_state[index / DEBOUNCE_WORD_BITS].override |= BIT(index % DEBOUNCE_WORD_BITS);
+    }
+}
+
 static int kscan_matrix_init(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
 
     data->dev = dev;
 
+    kscan_matrix_init_debounce(dev);
+
     kscan_matrix_init_inputs(dev);
+    kscan_matrix_init_ports(dev);
     kscan_matrix_init_outputs(dev);
     kscan_matrix_set_all_outputs(dev, 0);
 
-    k_work_init_delayable(&data->work, kscan_matrix_work_handler);
+    k_work_init_delayable(&data->work, ZMK_WORK_WATCHED(kscan_matrix_work_handler));
+
+#if USE_TIMER_SCAN
+    kscan_matrix_start_scan_q();
+    k_timer_init(&data->timer, kscan_matrix_timer_handler, NULL);
+    k_work_init(&data->scan_work, ZMK_WORK_WATCHED(kscan_matrix_scan_work_handler));
+#endif
 
     return 0;
 }
 
-static const struct kscan_driver_api kscan_matrix_api = {
-    .config = kscan_matrix_configure,
-    .enable_callback = kscan_matrix_enable,
-    .disable_callback = kscan_matrix_disable,
+static const struct kscan_frame_driver_api kscan_matrix_api = {
+    .kscan =
+        {
+            .config = kscan_matrix_configure,
+            .enable_callback = kscan_matrix_enable,
+            .disable_callback = kscan_matrix_disable,
+        },
+    .config_frame = kscan_matrix_configure_frame,
 };
 
 #define KSCAN_MATRIX_INIT(n)                                                                       \
@@ -431,6 +831,15 @@ static const struct kscan_driver_api kscan_matrix_api = {
                  "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
     BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
                  "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
+    BUILD_ASSERT(INST_OVERRIDE_PRESS_MS(n) <= DEBOUNCE_COUNTER_MAX,                                \
+                 "debounce-override-press-ms is too large");                                       \
+    BUILD_ASSERT(INST_OVERRIDE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
+                 "debounce-override-release-ms is too large");                                     \
+                                                                                                   \
+    COND_CODE_1(DT_INST_NODE_HAS_PROP(n, debounce_override_keys),                                  \
+                (static const uint32_t kscan_matrix_override_keys_##n[] =                          \
+                     DT_INST_PROP(n, debounce_override_keys);),                                    \
+                ())                                                                                \
                                                                                                    \
     static const struct gpio_dt_spec kscan_matrix_rows_##n[] = {                                   \
         UTIL_LISTIFY(INST_ROWS_LEN(n), KSCAN_GPIO_ROW_CFG_INIT, n)};                               \
@@ -438,14 +847,30 @@ static const struct kscan_driver_api kscan_matrix_api = {
     static const struct gpio_dt_spec kscan_matrix_cols_##n[] = {                                   \
         UTIL_LISTIFY(INST_COLS_LEN(n), KSCAN_GPIO_COL_CFG_INIT, n)};                               \
                                                                                                    \
-    static struct debounce_state kscan_matrix_state_##n[INST_MATRIX_LEN(n)];                       \
+    static struct debounce_word_state                                                              \
+        kscan_matrix_state_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];                                \
+    static uint32_t kscan_matrix_active_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];                   \
+                                                                                                   \
+    static struct kscan_matrix_port kscan_matrix_ports_##n[INST_INPUTS_LEN(n)];                    \
+    static uint8_t kscan_matrix_input_ports_##n[INST_INPUTS_LEN(n)];                               \
                                                                                                    \
-    COND_INTERRUPTS(                                                                               \
-        (static struct kscan_matrix_irq_callback kscan_matrix_irqs_##n[INST_INPUTS_LEN(n)];))      \
+    static uint32_t kscan_matrix_frame_changed_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];            \
+    static uint32_t kscan_matrix_frame_pressed_##n[DEBOUNCE_WORDS(INST_MATRIX_LEN(n))];            \
                                                                                                    \
     static struct kscan_matrix_data kscan_matrix_data_##n = {                                      \
         .matrix_state = kscan_matrix_state_##n,                                                    \
-        COND_INTERRUPTS((.irqs = kscan_matrix_irqs_##n, ))};                                       \
+        .active = kscan_matrix_active_##n,                                                         \
+        .ports = kscan_matrix_ports_##n,                                                           \
+        .input_ports = kscan_matrix_input_ports_##n,                                               \
+        .frame_changed = kscan_matrix_frame_changed_##n,                                           \
+        .frame_pressed = kscan_matrix_frame_pressed_##n,                                           \
+        COND_CALIBRATION((.settle =                                                                \
+                              {                                                                    \
+                                  .before_inputs_us = CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS,  \
+                                  .between_outputs_us =                                            \
+                                      CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS,                \
+                              },                                                                   \
+                          .scan_cycles_min = UINT32_MAX, ))};                                      \
                                                                                                    \
     static struct kscan_matrix_config kscan_matrix_config_##n = {                                  \
         .rows = KSCAN_GPIO_LIST(kscan_matrix_rows_##n),                                            \
@@ -459,6 +884,14 @@ static const struct kscan_driver_api kscan_matrix_api = {
                 .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
                 .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
             },                                                                                     \
+        .debounce_override_config =                                                                \
+            {                                                                                      \
+                .debounce_press_ms = INST_OVERRIDE_PRESS_MS(n),                                    \
+                .debounce_release_ms = INST_OVERRIDE_RELEASE_MS(n),                                \
+            },                                                                                     \
+        .debounce_override_keys = COND_CODE_1(DT_INST_NODE_HAS_PROP(n, debounce_override_keys),    \
+                                              (kscan_matrix_override_keys_##n), (NULL)),           \
+        .debounce_override_keys_len = INST_OVERRIDE_KEYS_LEN(n),                                   \
         .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
         .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
         .diode_direction = INST_DIODE_DIR(n),                                                      \
@@ -469,3 +902,298 @@ static const struct kscan_driver_api kscan_matrix_api = {
                           &kscan_matrix_api);
 
 DT_INST_FOREACH_STATUS_OKAY(KSCAN_MATRIX_INIT);
+
+#define USE_SHELL ((USE_ADAPTIVE_SCAN || USE_CALIBRATION) && IS_ENABLED(CONFIG_SHELL))
+
+#if USE_SHELL || USE_CALIBRATION
+
+#define KSCAN_MATRIX_DEVICE(n) DEVICE_DT_INST_GET(n),
+
+static const struct device *const kscan_matrix_devices[] = {
+    DT_INST_FOREACH_STATUS_OKAY(KSCAN_MATRIX_DEVICE)};
+
+#endif /* USE_SHELL || USE_CALIBRATION */
+
+#if USE_CALIBRATION && IS_ENABLED(CONFIG_SETTINGS)
+
+#include <settings/settings.h>
+
+static int kscan_matrix_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                     void *cb_arg) {
+    for (int i = 0; i < ARRAY_SIZE(kscan_matrix_devices); i++) {
+        struct kscan_matrix_data *data = kscan_matrix_devices[i]->data;
+        struct kscan_matrix_settle settle;
+        const char *next;
+
+        if (!settings_name_steq(name, kscan_matrix_devices[i]->name, &next) || next) {
+            continue;
+        }
+
+        if (len != sizeof(settle)) {
+            return -EINVAL;
+        }
+
+        int rc = read_cb(cb_arg, &settle, sizeof(settle));
+        if (rc < 0) {
+            return rc;
+        }
+
+        data->settle = settle;
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+static struct settings_handler kscan_matrix_settings_handler = {
+    .name = "kscan_matrix",
+    .h_set = kscan_matrix_settings_set,
+};
+
+static int kscan_matrix_settings_init(const struct device *_arg) {
+    settings_subsys_init();
+
+    int err = settings_register(&kscan_matrix_settings_handler);
+    if (err) {
+        LOG_ERR("Failed to register the kscan matrix settings handler (err %d)", err);
+        return err;
+    }
+
+    settings_load_subtree("kscan_matrix");
+
+    return 0;
+}
+
+SYS_INIT(kscan_matrix_settings_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif /* USE_CALIBRATION && IS_ENABLED(CONFIG_SETTINGS) */
+
+#if USE_SHELL
+
+#include <shell/shell.h>
+
+#if USE_CALIBRATION
+
+#define CALIBRATION_SAMPLES 16
+#define CALIBRATION_TIMEOUT_US 1000
+
+/**
+ * Set an output and measure how long the input takes to follow it.
+ */
+static int kscan_matrix_measure_settle(const struct gpio_dt_spec *out_gpio,
+                                       const struct gpio_dt_spec *in_gpio, const int value,
+                                       uint32_t *cycles) {
+    const uint32_t timeout = k_us_to_cyc_ceil32(CALIBRATION_TIMEOUT_US);
+    const uint32_t start = k_cycle_get_32();
+
+    int err = gpio_pin_set_dt(out_gpio, value);
+    if (err) {
+        return err;
+    }
+
+    while (true) {
+        const uint32_t elapsed = k_cycle_get_32() - start;
+        const int active = gpio_pin_get_dt(in_gpio);
+
+        if (active < 0) {
+            return active;
+        }
+
+        if (active == value) {
+            *cycles = elapsed;
+            return 0;
+        }
+
+        if (elapsed > timeout) {
+            return -ETIMEDOUT;
+        }
+    }
+}
+
+/**
+ * Find the output and input of a key being held, waiting generously for each output to settle.
+ */
+static int kscan_matrix_find_held_key(const struct device *dev, int *output, int *input) {
+    const struct kscan_matrix_config *config = dev->config;
+
+    for (int o = 0; o < config->outputs.len; o++) {
+        const struct gpio_dt_spec *out_gpio = &config->outputs.gpios[o];
+
+        int err = gpio_pin_set_dt(out_gpio, 1);
+        if (err) {
+            return err;
+        }
+
+        k_busy_wait(CALIBRATION_TIMEOUT_US);
+
+        for (int i = 0; i < config->inputs.len; i++) {
+            if (gpio_pin_get_dt(&config->inputs.gpios[i]) > 0) {
+                *output = o;
+                *input = i;
+            }
+        }
+
+        err = gpio_pin_set_dt(out_gpio, 0);
+        if (err) {
+            return err;
+        }
+
+        k_busy_wait(CALIBRATION_TIMEOUT_US);
+
+        if (*output == o) {
+            return 0;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static int kscan_matrix_calibrate(const struct device *dev, struct kscan_matrix_settle *settle) {
+    const struct kscan_matrix_config *config = dev->config;
+    uint32_t rise_max = 0;
+    uint32_t fall_max = 0;
+    int output = -1;
+    int input = -1;
+
+    int err = kscan_matrix_find_held_key(dev, &output, &input);
+    if (err) {
+        return err;
+    }
+
+    const struct gpio_dt_spec *out_gpio = &config->outputs.gpios[output];
+    const struct gpio_dt_spec *in_gpio = &config->inputs.gpios[input];
+
+    for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
+        uint32_t rise;
+        uint32_t fall;
+
+        err = kscan_matrix_measure_settle(out_gpio, in_gpio, 1, &rise);
+        if (err) {
+            break;
+        }
+
+        err = kscan_matrix_measure_settle(out_gpio, in_gpio, 0, &fall);
+        if (err) {
+            break;
+        }
+
+        rise_max = MAX(rise_max, rise);
+        fall_max = MAX(fall_max, fall);
+    }
+
+    gpio_pin_set_dt(out_gpio, 0);
+
+    if (err) {
+        return err;
+    }
+
+    *settle = (struct kscan_matrix_settle){
+        .before_inputs_us = k_cyc_to_us_ceil32(rise_max),
+        .between_outputs_us = k_cyc_to_us_ceil32(fall_max),
+    };
+
+    return 0;
+}
+
+static int cmd_calibrate(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ARRAY_SIZE(kscan_matrix_devices); i++) {
+        const struct device *dev = kscan_matrix_devices[i];
+        struct kscan_matrix_data *data = dev->data;
+        struct kscan_matrix_settle settle;
+        struct k_work_sync sync;
+
+        // Stop scanning so nothing else drives the outputs while measuring. A scan that was
+        // already running may have re-enabled interrupts, so disable again once it is done.
+        kscan_matrix_disable(dev);
+        k_work_cancel_delayable_sync(&data->work, &sync);
+        kscan_matrix_disable(dev);
+
+        int err = kscan_matrix_calibrate(dev, &settle);
+
+        kscan_matrix_enable(dev);
+
+        if (err == -ENOENT) {
+            shell_error(sh, "%s: hold down any key while calibrating", dev->name);
+            return err;
+        } else if (err) {
+            shell_error(sh, "%s: calibration failed (err %d)", dev->name, err);
+            return err;
+        }
+
+        data->settle = settle;
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+        char setting_name[32];
+        snprintk(setting_name, sizeof(setting_name), "kscan_matrix/%s", dev->name);
+
+        err = settings_save_one(setting_name, &settle, sizeof(settle));
+        if (err) {
+            shell_warn(sh, "%s: failed to save the settle times (err %d)", dev->name, err);
+        }
+#endif
+
+        shell_print(sh, "%s: %u us before inputs, %u us between outputs", dev->name,
+                    settle.before_inputs_us, settle.between_outputs_us);
+    }
+    return 0;
+}
+
+#endif /* USE_CALIBRATION */
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ARRAY_SIZE(kscan_matrix_devices); i++) {
+        const struct kscan_matrix_data *data = kscan_matrix_devices[i]->data;
+
+        shell_print(sh, "%s:", kscan_matrix_devices[i]->name);
+#if USE_ADAPTIVE_SCAN
+        shell_print(sh, "  %-16s %6d ms", "scan period", data->scan_period_ms);
+        shell_print(sh, "  %-16s %6u", "scans", data->scan_count);
+        shell_print(sh, "  %-16s %6u", "active scans", data->active_scan_count);
+#endif
+#if USE_CALIBRATION
+        const uint32_t min = data->scan_cycles_min == UINT32_MAX ? 0 : data->scan_cycles_min;
+
+        shell_print(sh, "  %-16s %6u us", "settle before", data->settle.before_inputs_us);
+        shell_print(sh, "  %-16s %6u us", "settle between", data->settle.between_outputs_us);
+        shell_print(sh, "  %-16s %6u us", "last scan", k_cyc_to_us_ceil32(data->scan_cycles_last));
+        shell_print(sh, "  %-16s %6u us", "fastest scan", k_cyc_to_us_ceil32(min));
+        shell_print(sh, "  %-16s %6u us", "slowest scan",
+                    k_cyc_to_us_ceil32(data->scan_cycles_max));
+#endif
+    }
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ARRAY_SIZE(kscan_matrix_devices); i++) {
+        struct kscan_matrix_data *data = kscan_matrix_devices[i]->data;
+
+#if USE_ADAPTIVE_SCAN
+        data->scan_count = 0;
+        data->active_scan_count = 0;
+#endif
+#if USE_CALIBRATION
+        data->scan_cycles_min = UINT32_MAX;
+        data->scan_cycles_max = 0;
+#endif
+    }
+    shell_print(sh, "Matrix scan statistics reset");
+    return 0;
+}
+
+#if USE_CALIBRATION
+#define CMD_CALIBRATE                                                                              \
+    SHELL_CMD(calibrate, NULL, "Measure and save the settle times while a key is held",            \
+              cmd_calibrate),
+#else
+#define CMD_CALIBRATE
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_kscan_matrix,
+                               SHELL_CMD(stats, NULL, "Show matrix scan statistics", cmd_stats),
+                               SHELL_CMD(reset, NULL, "Reset matrix scan statistics", cmd_reset),
+                               CMD_CALIBRATE SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(kscan_matrix, &sub_kscan_matrix, "ZMK matrix kscan commands", NULL);
+
+#endif /* USE_SHELL */
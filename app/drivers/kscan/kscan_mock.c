@@ -10,19 +10,30 @@
 #include <device.h>
 #include <drivers/kscan.h>
 #include <logging/log.h>
+#include <logging/log_ctrl.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <dt-bindings/zmk/kscan_mock.h>
+#include <zmk/pipeline_stats.h>
 
 struct kscan_mock_data {
     kscan_callback_t callback;
 
     uint32_t event_index;
+    // Stress transitions sent so far, and the state of the generator picking their keys.
+    uint32_t stress_sent;
+    uint32_t stress_seed;
     struct k_work_delayable work;
     const struct device *dev;
 };
 
+// A linear congruential generator, so every stress run sends the same transitions.
+static uint32_t kscan_mock_stress_random(struct kscan_mock_data *data) {
+    data->stress_seed = data->stress_seed * 1103515245 + 12345;
+    return data->stress_seed >> 16;
+}
+
 static int kscan_mock_disable_callback(const struct device *dev) {
     struct kscan_mock_data *data = dev->data;
 
@@ -38,31 +49,80 @@ static int kscan_mock_configure(const struct device *dev, kscan_callback_t callb
     }
 
     data->event_index = 0;
+    data->stress_sent = 0;
     data->callback = callback;
 
     return 0;
 }
 
+#define MOCK_KEYS(n) (DT_INST_PROP(n, rows) * DT_INST_PROP(n, columns))
+
 #define MOCK_INST_INIT(n)                                                                          \
     struct kscan_mock_config_##n {                                                                 \
         uint32_t events[DT_INST_PROP_LEN(n, events)];                                              \
         bool exit_after;                                                                           \
     };                                                                                             \
+    static uint8_t kscan_mock_stress_pressed_##n[DIV_ROUND_UP(MOCK_KEYS(n), 8)];                   \
     static void kscan_mock_schedule_next_event_##n(const struct device *dev) {                     \
         struct kscan_mock_data *data = dev->data;                                                  \
         const struct kscan_mock_config_##n *cfg = dev->config;                                     \
         if (data->event_index < DT_INST_PROP_LEN(n, events)) {                                     \
             uint32_t ev = cfg->events[data->event_index];                                          \
-            LOG_DBG("delaying next keypress: %d", ZMK_MOCK_MSEC(ev));                              \
-            k_work_schedule(&data->work, K_MSEC(ZMK_MOCK_MSEC(ev)));                               \
+            uint32_t delay = ZMK_MOCK_MSEC(ev) / DT_INST_PROP(n, time_divisor);                    \
+            LOG_DBG("delaying next keypress: %d", delay);                                          \
+            k_work_schedule(&data->work, K_MSEC(delay));                                           \
         } else if (cfg->exit_after) {                                                              \
             LOG_DBG("Exiting");                                                                    \
             exit(0);                                                                               \
         }                                                                                          \
     }                                                                                              \
+    /* Toggles random keys until every stress transition is sent, then releases the keys left      \
+     * pressed. Returns false once there is nothing left to send. */                               \
+    static bool kscan_mock_stress_burst_##n(const struct device *dev) {                            \
+        struct kscan_mock_data *data = dev->data;                                                  \
+        uint8_t *pressed = kscan_mock_stress_pressed_##n;                                          \
+        const uint32_t columns = DT_INST_PROP(n, columns);                                         \
+        int sent = 0;                                                                              \
+        while (data->stress_sent < DT_INST_PROP(n, stress_transitions) &&                          \
+               sent < DT_INST_PROP(n, stress_burst)) {                                             \
+            uint32_t key = kscan_mock_stress_random(data) % MOCK_KEYS(n);                          \
+            bool press = !(pressed[key / 8] & BIT(key % 8));                                       \
+            WRITE_BIT(pressed[key / 8], key % 8, press);                                           \
+            data->callback(dev, key / columns, key % columns, press);                              \
+            data->stress_sent++;                                                                   \
+            sent++;                                                                                \
+        }                                                                                          \
+        for (uint32_t key = 0; key < MOCK_KEYS(n) && sent < DT_INST_PROP(n, stress_burst);         \
+             key++) {                                                                              \
+            if (pressed[key / 8] & BIT(key % 8)) {                                                 \
+                WRITE_BIT(pressed[key / 8], key % 8, false);                                       \
+                data->callback(dev, key / columns, key % columns, false);                          \
+                sent++;                                                                            \
+            }                                                                                      \
+        }                                                                                          \
+        return sent > 0;                                                                           \
+    }                                                                                              \
+    static void kscan_mock_stress_##n(const struct device *dev) {                                  \
+        struct kscan_mock_data *data = dev->data;                                                  \
+        if (kscan_mock_stress_burst_##n(dev)) {                                                    \
+            k_work_schedule(&data->work, K_MSEC(DT_INST_PROP_OR(n, event_period, 1)));             \
+            return;                                                                                \
+        }                                                                                          \
+        if (DT_INST_PROP(n, stress_transitions) > 0) {                                             \
+            /* Flush the log, so the stats aren't lost when exiting. */                            \
+            zmk_pipeline_stats_log();                                                              \
+            LOG_PANIC();                                                                           \
+        }                                                                                          \
+        kscan_mock_schedule_next_event_##n(dev);                                                   \
+    }                                                                                              \
     static void kscan_mock_work_handler_##n(struct k_work *work) {                                 \
         struct kscan_mock_data *data = CONTAINER_OF(work, struct kscan_mock_data, work);           \
         const struct kscan_mock_config_##n *cfg = data->dev->config;                               \
+        if (data->event_index >= DT_INST_PROP_LEN(n, events)) {                                    \
+            /* The scripted events are done. */                                                    \
+            kscan_mock_stress_##n(data->dev);                                                      \
+            return;                                                                                \
+        }                                                                                          \
         uint32_t ev = cfg->events[data->event_index];                                              \
         LOG_DBG("ev %u row %d column %d state %d\n", ev, ZMK_MOCK_ROW(ev), ZMK_MOCK_COL(ev),       \
                 ZMK_MOCK_IS_PRESS(ev));                                                            \
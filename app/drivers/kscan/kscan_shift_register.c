@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "debounce.h"
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <drivers/kscan.h>
+#include <drivers/spi.h>
+#include <kernel.h>
+#include <logging/log.h>
+#include <sys/byteorder.h>
+#include <sys/util.h>
+
+#include <zmk/energy_stats.h>
+#include <zmk/work_watchdog.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#define DT_DRV_COMPAT zmk_kscan_shift_register
+
+#define INST_ROWS_LEN(n) DT_INST_PROP_LEN_OR(n, row_gpios, 0)
+#define INST_SCANS_LEN(n) MAX(INST_ROWS_LEN(n), 1)
+
+#if CONFIG_ZMK_KSCAN_DEBOUNCE_PRESS_MS >= 0
+#define INST_DEBOUNCE_PRESS_MS(n) CONFIG_ZMK_KSCAN_DEBOUNCE_PRESS_MS
+#else
+#define INST_DEBOUNCE_PRESS_MS(n) DT_INST_PROP(n, debounce_press_ms)
+#endif
+
+#if CONFIG_ZMK_KSCAN_DEBOUNCE_RELEASE_MS >= 0
+#define INST_DEBOUNCE_RELEASE_MS(n) CONFIG_ZMK_KSCAN_DEBOUNCE_RELEASE_MS
+#else
+#define INST_DEBOUNCE_RELEASE_MS(n) DT_INST_PROP(n, debounce_release_ms)
+#endif
+
+#define KSCAN_GPIO_ROW_CFG_INIT(idx, inst_idx)                                                     \
+    GPIO_DT_SPEC_GET_BY_IDX(DT_DRV_INST(inst_idx), row_gpios, idx),
+
+struct kscan_sr_data {
+    const struct device *dev;
+    kscan_callback_t callback;
+    struct k_work_delayable work;
+    /** Timestamp of the current or scheduled scan. */
+    int64_t scan_time;
+    /**
+     * Current state of the keys, one word per row with bit N holding column N. Array of length
+     * MAX(config->rows.len, 1)
+     */
+    struct debounce_word_state *matrix_state;
+    /** config->debounce_config converted to scans. */
+    struct debounce_word_config debounce_config;
+};
+
+struct kscan_gpio_list {
+    const struct gpio_dt_spec *gpios;
+    size_t len;
+};
+
+/** Define a kscan_gpio_list from a compile-time GPIO array. */
+#define KSCAN_GPIO_LIST(gpio_array)                                                                \
+    ((struct kscan_gpio_list){.gpios = gpio_array, .len = ARRAY_SIZE(gpio_array)})
+
+struct kscan_sr_config {
+    struct spi_dt_spec bus;
+    /** Shift register parallel load (SH/LD) line. */
+    struct gpio_dt_spec load_gpio;
+    /** Rows driven one at a time. If empty, every shift register input is a key. */
+    struct kscan_gpio_list rows;
+    /** Number of shift register inputs, a multiple of 8. */
+    uint8_t cols_len;
+    bool active_low;
+    struct debounce_config debounce_config;
+    int32_t debounce_scan_period_ms;
+    int32_t poll_period_ms;
+};
+
+/**
+ * Latch every shift register input and clock them all in with one SPI transfer.
+ *
+ * @param active Set to a bitmap with bit N set if column N is active.
+ */
+static int kscan_sr_read_cols(const struct device *dev, uint32_t *active) {
+    const struct kscan_sr_config *config = dev->config;
+    uint8_t rx_data[sizeof(uint32_t)] = {0};
+    const uint8_t len = config->cols_len / 8;
+
+    int err = gpio_pin_set_dt(&config->load_gpio, 1);
+    if (err) {
+        LOG_ERR("Failed to latch the shift register inputs: %i", err);
+        return err;
+    }
+
+    err = gpio_pin_set_dt(&config->load_gpio, 0);
+    if (err) {
+        LOG_ERR("Failed to release the shift register load line: %i", err);
+        return err;
+    }
+
+    // Each byte is one register, starting with the one nearest the controller, and its most
+    // significant bit is input H. That makes input A of the first register column 0.
+    const struct spi_buf rx_buf = {.buf = rx_data, .len = len};
+    const struct spi_buf_set rx = {.buffers = &rx_buf, .count = 1};
+
+    err = spi_read_dt(&config->bus, &rx);
+    if (err) {
+        LOG_ERR("Failed to read the shift registers: %i", err);
+        return err;
+    }
+
+    *active = sys_get_le32(rx_data);
+
+    if (config->active_low) {
+        *active = ~*active & BIT64_MASK(config->cols_len);
+    }
+
+    return 0;
+}
+
+static void kscan_sr_schedule(const struct device *dev, const int32_t period_ms) {
+    struct kscan_sr_data *data = dev->data;
+
+    data->scan_time += period_ms;
+
+    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+}
+
+static int kscan_sr_read(const struct device *dev) {
+    struct kscan_sr_data *data = dev->data;
+    const struct kscan_sr_config *config = dev->config;
+    bool continue_scan = false;
+
+    zmk_energy_stats_count(ZMK_ENERGY_KSCAN_SCAN);
+
+    for (int r = 0; r < MAX(config->rows.len, 1); r++) {
+        const struct gpio_dt_spec *row_gpio = config->rows.len ? &config->rows.gpios[r] : NULL;
+        struct debounce_word_state *state = &data->matrix_state[r];
+        uint32_t active;
+
+        if (row_gpio) {
+            int err = gpio_pin_set_dt(row_gpio, 1);
+            if (err) {
+                LOG_ERR("Failed to set row %i active: %i", r, err);
+                return err;
+            }
+        }
+
+        int err = kscan_sr_read_cols(dev, &active);
+
+        if (row_gpio) {
+            int row_err = gpio_pin_set_dt(row_gpio, 0);
+            if (row_err) {
+                LOG_ERR("Failed to set row %i inactive: %i", r, row_err);
+                return row_err;
+            }
+        }
+
+        if (err) {
+            return err;
+        }
+
+        debounce_word_update(state, active, &data->debounce_config);
+
+        for (uint32_t changed = state->changed; changed; changed &= changed - 1) {
+            const int c = __builtin_ctz(changed);
+            const bool pressed = state->pressed & BIT(c);
+
+            LOG_DBG("Sending event at %i,%i state %s", r, c, pressed ? "on" : "off");
+            data->callback(dev, r, c, pressed);
+        }
+
+        continue_scan = continue_scan || debounce_word_active(state);
+    }
+
+    if (continue_scan) {
+        // At least one key is pressed or the debouncer has not yet decided if
+        // it is pressed. Poll quickly until everything is released.
+        kscan_sr_schedule(dev, config->debounce_scan_period_ms);
+    } else {
+        // All keys are released. Shift registers can't interrupt, so return to polling slowly.
+        kscan_sr_schedule(dev, config->poll_period_ms);
+    }
+
+    return 0;
+}
+
+static void kscan_sr_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct kscan_sr_data *data = CONTAINER_OF(dwork, struct kscan_sr_data, work);
+    kscan_sr_read(data->dev);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(kscan_sr_work_handler)
+
+static int kscan_sr_configure(const struct device *dev, const kscan_callback_t callback) {
+    struct kscan_sr_data *data = dev->data;
+
+    if (!callback) {
+        return -EINVAL;
+    }
+
+    data->callback = callback;
+    return 0;
+}
+
+static int kscan_sr_enable(const struct device *dev) {
+    struct kscan_sr_data *data = dev->data;
+
+    data->scan_time = k_uptime_get();
+
+    // Read will automatically schedule the next scan once done.
+    return kscan_sr_read(dev);
+}
+
+static int kscan_sr_disable(const struct device *dev) {
+    struct kscan_sr_data *data = dev->data;
+
+    k_work_cancel_delayable(&data->work);
+    return 0;
+}
+
+static int kscan_sr_init_output(const struct gpio_dt_spec *gpio) {
+    if (!device_is_ready(gpio->port)) {
+        LOG_ERR("GPIO is not ready: %s", gpio->port->name);
+        return -ENODEV;
+    }
+
+    int err = gpio_pin_configure_dt(gpio, GPIO_OUTPUT_INACTIVE);
+    if (err) {
+        LOG_ERR("Unable to configure pin %u on %s for output", gpio->pin, gpio->port->name);
+        return err;
+    }
+
+    LOG_DBG("Configured pin %u on %s for output", gpio->pin, gpio->port->name);
+
+    return 0;
+}
+
+static int kscan_sr_init(const struct device *dev) {
+    struct kscan_sr_data *data = dev->data;
+    const struct kscan_sr_config *config = dev->config;
+
+    data->dev = dev;
+
+    if (!spi_is_ready(&config->bus)) {
+        LOG_ERR("SPI bus is not ready: %s", config->bus.bus->name);
+        return -ENODEV;
+    }
+
+    int err = kscan_sr_init_output(&config->load_gpio);
+    if (err) {
+        return err;
+    }
+
+    for (int i = 0; i < config->rows.len; i++) {
+        err = kscan_sr_init_output(&config->rows.gpios[i]);
+        if (err) {
+            return err;
+        }
+    }
+
+    debounce_word_config_init(&data->debounce_config, &config->debounce_config,
+                              config->debounce_scan_period_ms);
+
+    k_work_init_delayable(&data->work, ZMK_WORK_WATCHED(kscan_sr_work_handler));
+
+    return 0;
+}
+
+static const struct kscan_driver_api kscan_sr_api = {
+    .config = kscan_sr_configure,
+    .enable_callback = kscan_sr_enable,
+    .disable_callback = kscan_sr_disable,
+};
+
+#define KSCAN_SR_INIT(n)                                                                           \
+    BUILD_ASSERT(INST_DEBOUNCE_PRESS_MS(n) <= DEBOUNCE_COUNTER_MAX,                                \
+                 "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
+    BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
+                 "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
+                                                                                                   \
+    static const struct gpio_dt_spec kscan_sr_rows_##n[] = {                                       \
+        UTIL_LISTIFY(INST_ROWS_LEN(n), KSCAN_GPIO_ROW_CFG_INIT, n)};                               \
+                                                                                                   \
+    static struct debounce_word_state kscan_sr_state_##n[INST_SCANS_LEN(n)];                       \
+                                                                                                   \
+    static struct kscan_sr_data kscan_sr_data_##n = {                                              \
+        .matrix_state = kscan_sr_state_##n,                                                        \
+    };                                                                                             \
+                                                                                                   \
+    static const struct kscan_sr_config kscan_sr_config_##n = {                                    \
+        .bus = SPI_DT_SPEC_INST_GET(n, SPI_OP_MODE_MASTER | SPI_TRANSFER_MSB | SPI_WORD_SET(8),    \
+                                    0),                                                            \
+        .load_gpio = GPIO_DT_SPEC_INST_GET(n, load_gpios),                                         \
+        .rows = KSCAN_GPIO_LIST(kscan_sr_rows_##n),                                                \
+        .cols_len = DT_INST_PROP(n, ngpios),                                                       \
+        .active_low = DT_INST_PROP(n, active_low),                                                 \
+        .debounce_config =                                                                         \
+            {                                                                                      \
+                .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
+                .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
+            },                                                                                     \
+        .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
+        .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
+    };                                                                                             \
+                                                                                                   \
+    DEVICE_DT_INST_DEFINE(n, &kscan_sr_init, NULL, &kscan_sr_data_##n, &kscan_sr_config_##n,       \
+                          APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY, &kscan_sr_api);
+
+DT_INST_FOREACH_STATUS_OKAY(KSCAN_SR_INIT);
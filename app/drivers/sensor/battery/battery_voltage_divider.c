@@ -11,10 +11,14 @@
 #include <drivers/gpio.h>
 #include <drivers/adc.h>
 #include <drivers/sensor.h>
+#include <kernel.h>
 #include <logging/log.h>
+#include <sys/atomic.h>
 
 #include "battery_common.h"
 
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 struct io_channel_config {
@@ -34,18 +38,115 @@ struct bvd_config {
     uint32_t full_ohm;
 };
 
+// Settling time for any capacitance on the divider after enabling its power GPIO
+#define BVD_SETTLE_TIME K_MSEC(10)
+
+// Each measurement moves the filtered voltage 1/2^BVD_FILTER_SHIFT of the way to the new one.
+#define BVD_FILTER_SHIFT 2
+
 struct bvd_data {
     const struct device *adc;
     const struct device *gpio;
+    const struct device *dev;
     struct adc_channel_cfg acc;
     struct adc_sequence as;
+    struct adc_sequence_options as_options;
     struct battery_value value;
+    // Filtered battery voltage in millivolts, scaled by 2^BVD_FILTER_SHIFT
+    uint32_t filter_mv;
+    // Set while a measurement is in progress
+    atomic_t busy;
+    // Starts the ADC once the divider has settled
+    struct k_work_delayable start_work;
+    // Converts the reading once the ADC is done, outside its interrupt
+    struct k_work done_work;
 };
 
-static int bvd_sample_fetch(const struct device *dev, enum sensor_channel chan) {
+static int bvd_set_power(const struct device *dev, int value) {
+    struct bvd_data *drv_data = dev->data;
+    const struct bvd_config *drv_cfg = dev->config;
+
+    if (!drv_data->gpio) {
+        return 0;
+    }
+
+    int rc = gpio_pin_set(drv_data->gpio, drv_cfg->power_gpios.pin, value);
+    if (rc != 0) {
+        LOG_DBG("Failed to %s ADC power GPIO: %d", value ? "enable" : "disable", rc);
+    }
+
+    return rc;
+}
+
+static void bvd_update_value(const struct device *dev, bool first) {
     struct bvd_data *drv_data = dev->data;
     const struct bvd_config *drv_cfg = dev->config;
     struct adc_sequence *as = &drv_data->as;
+    int32_t val = drv_data->value.adc_raw;
+
+    as->calibrate = false;
+
+    adc_raw_to_millivolts(adc_ref_internal(drv_data->adc), drv_data->acc.gain, as->resolution,
+                          &val);
+
+    uint16_t millivolts = val * (uint64_t)drv_cfg->full_ohm / drv_cfg->output_ohm;
+
+    // A cheap low-pass filter, so one noisy reading doesn't move the state of charge.
+    if (first) {
+        drv_data->filter_mv = millivolts << BVD_FILTER_SHIFT;
+    } else {
+        drv_data->filter_mv += millivolts - (drv_data->filter_mv >> BVD_FILTER_SHIFT);
+    }
+
+    uint16_t filtered = drv_data->filter_mv >> BVD_FILTER_SHIFT;
+    LOG_DBG("ADC raw %d ~ %d mV => %d mV, filtered %d mV", drv_data->value.adc_raw, val,
+            millivolts, filtered);
+    uint8_t percent = lithium_ion_mv_to_pct(filtered);
+    LOG_DBG("Percent: %d", percent);
+
+    drv_data->value.millivolts = filtered;
+    drv_data->value.state_of_charge = percent;
+}
+
+static void bvd_done_work(struct k_work *work) {
+    struct bvd_data *drv_data = CONTAINER_OF(work, struct bvd_data, done_work);
+
+    bvd_update_value(drv_data->dev, false);
+    bvd_set_power(drv_data->dev, 0);
+    atomic_set(&drv_data->busy, false);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(bvd_done_work)
+
+static enum adc_action bvd_adc_callback(const struct device *adc,
+                                        const struct adc_sequence *sequence,
+                                        uint16_t sampling_index) {
+    const struct device *dev = sequence->options->user_data;
+    struct bvd_data *drv_data = dev->data;
+
+    k_work_submit(&drv_data->done_work);
+
+    return ADC_ACTION_FINISH;
+}
+
+static void bvd_start_work(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct bvd_data *drv_data = CONTAINER_OF(dwork, struct bvd_data, start_work);
+
+    int rc = adc_read_async(drv_data->adc, &drv_data->as, NULL);
+    if (rc != 0) {
+        LOG_DBG("Failed to start ADC read: %d", rc);
+        bvd_set_power(drv_data->dev, 0);
+        atomic_set(&drv_data->busy, false);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(bvd_start_work)
+
+// Returns the last measurement and starts the next one, so the caller never waits for the
+// divider to settle or the ADC to sample. The new value is ready by the following fetch.
+static int bvd_sample_fetch(const struct device *dev, enum sensor_channel chan) {
+    struct bvd_data *drv_data = dev->data;
 
     // Make sure selected channel is supported
     if (chan != SENSOR_CHAN_GAUGE_VOLTAGE && chan != SENSOR_CHAN_GAUGE_STATE_OF_CHARGE &&
@@ -54,53 +155,48 @@ static int bvd_sample_fetch(const struct device *dev, enum sensor_channel chan)
         return -ENOTSUP;
     }
 
-    int rc = 0;
+    if (!atomic_cas(&drv_data->busy, false, true)) {
+        // The measurement in progress will update the value.
+        return 0;
+    }
 
-    // Enable power GPIO if present
-    if (drv_data->gpio) {
-        rc = gpio_pin_set(drv_data->gpio, drv_cfg->power_gpios.pin, 1);
+    int rc = bvd_set_power(dev, 1);
+    if (rc != 0) {
+        atomic_set(&drv_data->busy, false);
+        return rc;
+    }
 
-        if (rc != 0) {
-            LOG_DBG("Failed to enable ADC power GPIO: %d", rc);
-            return rc;
-        }
+    k_work_schedule(&drv_data->start_work, drv_data->gpio ? BVD_SETTLE_TIME : K_NO_WAIT);
 
-        // wait for any capacitance to charge up
-        k_sleep(K_MSEC(10));
-    }
+    return 0;
+}
 
-    // Read ADC
-    rc = adc_read(drv_data->adc, as);
-    as->calibrate = false;
+// Takes the first measurement synchronously, so there is a value before the first fetch.
+static int bvd_measure_initial(const struct device *dev) {
+    struct bvd_data *drv_data = dev->data;
 
-    if (rc == 0) {
-        int32_t val = drv_data->value.adc_raw;
+    int rc = bvd_set_power(dev, 1);
+    if (rc != 0) {
+        return rc;
+    }
 
-        adc_raw_to_millivolts(adc_ref_internal(drv_data->adc), drv_data->acc.gain, as->resolution,
-                              &val);
+    if (drv_data->gpio) {
+        k_sleep(BVD_SETTLE_TIME);
+    }
 
-        uint16_t millivolts = val * (uint64_t)drv_cfg->full_ohm / drv_cfg->output_ohm;
-        LOG_DBG("ADC raw %d ~ %d mV => %d mV", drv_data->value.adc_raw, val, millivolts);
-        uint8_t percent = lithium_ion_mv_to_pct(millivolts);
-        LOG_DBG("Percent: %d", percent);
+    drv_data->as.options = NULL;
+    rc = adc_read(drv_data->adc, &drv_data->as);
+    drv_data->as.options = &drv_data->as_options;
 
-        drv_data->value.millivolts = millivolts;
-        drv_data->value.state_of_charge = percent;
+    if (rc == 0) {
+        bvd_update_value(dev, true);
     } else {
         LOG_DBG("Failed to read ADC: %d", rc);
     }
 
-    // Disable power GPIO if present
-    if (drv_data->gpio) {
-        int rc2 = gpio_pin_set(drv_data->gpio, drv_cfg->power_gpios.pin, 0);
-
-        if (rc2 != 0) {
-            LOG_DBG("Failed to disable ADC power GPIO: %d", rc2);
-            return rc2;
-        }
-    }
+    int rc2 = bvd_set_power(dev, 0);
 
-    return rc;
+    return rc != 0 ? rc : rc2;
 }
 
 static int bvd_channel_get(const struct device *dev, enum sensor_channel chan,
@@ -163,8 +259,19 @@ static int bvd_init(const struct device *dev) {
 
     rc = adc_channel_setup(drv_data->adc, &drv_data->acc);
     LOG_DBG("AIN%u setup returned %d", drv_cfg->io_channel.channel, rc);
+    if (rc != 0) {
+        return rc;
+    }
 
-    return rc;
+    drv_data->dev = dev;
+    drv_data->as_options = (struct adc_sequence_options){
+        .callback = bvd_adc_callback,
+        .user_data = (void *)dev,
+    };
+    k_work_init_delayable(&drv_data->start_work, ZMK_WORK_WATCHED(bvd_start_work));
+    k_work_init(&drv_data->done_work, ZMK_WORK_WATCHED(bvd_done_work));
+
+    return bvd_measure_initial(dev);
 }
 
 static struct bvd_data bvd_data = {.adc = DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(DT_DRV_INST(0)))};
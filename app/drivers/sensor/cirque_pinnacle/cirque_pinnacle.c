@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT cirque_pinnacle
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <drivers/sensor.h>
+#include <kernel.h>
+#include <string.h>
+#include <sys/__assert.h>
+#include <sys/util.h>
+
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(spi)
+#include <drivers/spi.h>
+#endif
+
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(i2c)
+#include <drivers/i2c.h>
+#endif
+
+#include <logging/log.h>
+
+#include <zmk/work_watchdog.h>
+
+LOG_MODULE_REGISTER(CIRQUE_PINNACLE, CONFIG_SENSOR_LOG_LEVEL);
+
+// Register addresses are ORed into the command byte.
+#define PINNACLE_READ 0xA0
+#define PINNACLE_WRITE 0x80
+
+#define PINNACLE_FW_ID 0x00
+#define PINNACLE_FW_ID_VALUE 0x07
+#define PINNACLE_STATUS1 0x02
+#define PINNACLE_FEED_CFG1 0x04
+#define PINNACLE_FEED_CFG1_FEED_ENABLE BIT(0)
+#define PINNACLE_FEED_CFG2 0x05
+#define PINNACLE_FEED_CFG2_ALL_TAPS_DISABLE BIT(1)
+#define PINNACLE_FEED_CFG2_SCROLL_DISABLE BIT(3)
+#define PINNACLE_FEED_CFG2_GLIDE_EXTEND_DISABLE BIT(4)
+#define PINNACLE_SAMPLE_RATE 0x09
+#define PINNACLE_PACKET_BYTE0 0x12
+
+// Relative mode packets hold the sign bits of each delta in the first byte, and the low eight bits
+// of the X and Y deltas in the next two.
+#define PINNACLE_PACKET_LEN 3
+#define PINNACLE_PACKET_X_SIGN BIT(4)
+#define PINNACLE_PACKET_Y_SIGN BIT(5)
+
+// SPI reads clock out the command and two filler bytes before the first data byte.
+#define PINNACLE_SPI_READ_HEADER_LEN 3
+#define PINNACLE_SPI_FILLER 0xFC
+
+struct pinnacle_config {
+    union {
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(spi)
+        struct spi_dt_spec spi;
+#endif
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(i2c)
+        struct i2c_dt_spec i2c;
+#endif
+    } bus;
+    bool (*bus_ready)(const struct device *dev);
+    int (*read)(const struct device *dev, uint8_t addr, uint8_t *buf, size_t len);
+    int (*write)(const struct device *dev, uint8_t addr, uint8_t value);
+    struct gpio_dt_spec dr;
+    uint8_t sample_rate;
+};
+
+struct pinnacle_data {
+    const struct device *dev;
+    int16_t dx;
+    int16_t dy;
+
+    struct gpio_callback dr_cb;
+    struct k_work work;
+    sensor_trigger_handler_t handler;
+    const struct sensor_trigger *trigger;
+};
+
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(spi)
+static bool pinnacle_spi_ready(const struct device *dev) {
+    const struct pinnacle_config *config = dev->config;
+
+    return spi_is_ready(&config->bus.spi);
+}
+
+static int pinnacle_spi_read(const struct device *dev, uint8_t addr, uint8_t *buf, size_t len) {
+    const struct pinnacle_config *config = dev->config;
+    uint8_t tx_data[PINNACLE_SPI_READ_HEADER_LEN + PINNACLE_PACKET_LEN];
+    uint8_t rx_data[PINNACLE_SPI_READ_HEADER_LEN + PINNACLE_PACKET_LEN];
+
+    __ASSERT_NO_MSG(len <= PINNACLE_PACKET_LEN);
+
+    memset(tx_data, PINNACLE_SPI_FILLER, sizeof(tx_data));
+    tx_data[0] = PINNACLE_READ | addr;
+
+    const struct spi_buf tx_buf = {.buf = tx_data, .len = PINNACLE_SPI_READ_HEADER_LEN + len};
+    const struct spi_buf rx_buf = {.buf = rx_data, .len = PINNACLE_SPI_READ_HEADER_LEN + len};
+    const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+    const struct spi_buf_set rx = {.buffers = &rx_buf, .count = 1};
+
+    int err = spi_transceive_dt(&config->bus.spi, &tx, &rx);
+    if (err) {
+        return err;
+    }
+
+    memcpy(buf, &rx_data[PINNACLE_SPI_READ_HEADER_LEN], len);
+
+    return 0;
+}
+
+static int pinnacle_spi_write(const struct device *dev, uint8_t addr, uint8_t value) {
+    const struct pinnacle_config *config = dev->config;
+    uint8_t tx_data[] = {PINNACLE_WRITE | addr, value};
+
+    const struct spi_buf tx_buf = {.buf = tx_data, .len = sizeof(tx_data)};
+    const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+
+    return spi_write_dt(&config->bus.spi, &tx);
+}
+#endif
+
+#if DT_ANY_INST_ON_BUS_STATUS_OKAY(i2c)
+static bool pinnacle_i2c_ready(const struct device *dev) {
+    const struct pinnacle_config *config = dev->config;
+
+    return device_is_ready(config->bus.i2c.bus);
+}
+
+static int pinnacle_i2c_read(const struct device *dev, uint8_t addr, uint8_t *buf, size_t len) {
+    const struct pinnacle_config *config = dev->config;
+
+    return i2c_burst_read_dt(&config->bus.i2c, PINNACLE_READ | addr, buf, len);
+}
+
+static int pinnacle_i2c_write(const struct device *dev, uint8_t addr, uint8_t value) {
+    const struct pinnacle_config *config = dev->config;
+
+    return i2c_reg_write_byte_dt(&config->bus.i2c, PINNACLE_WRITE | addr, value);
+}
+#endif
+
+// Reads the whole packet in one burst. Each packet holds the motion since the one before it.
+static int pinnacle_sample_fetch(const struct device *dev, enum sensor_channel chan) {
+    struct pinnacle_data *data = dev->data;
+    const struct pinnacle_config *config = dev->config;
+    uint8_t packet[PINNACLE_PACKET_LEN];
+
+    __ASSERT_NO_MSG(chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_POS_DX ||
+                    chan == SENSOR_CHAN_POS_DY);
+
+    // DR stays active from a new packet until the data ready flag is cleared.
+    if (gpio_pin_get_dt(&config->dr) <= 0) {
+        data->dx = 0;
+        data->dy = 0;
+        return 0;
+    }
+
+    int err = config->read(dev, PINNACLE_PACKET_BYTE0, packet, sizeof(packet));
+    if (err) {
+        LOG_ERR("Failed to read the trackpad packet: %d", err);
+        return err;
+    }
+
+    err = config->write(dev, PINNACLE_STATUS1, 0);
+    if (err) {
+        LOG_ERR("Failed to clear the trackpad data ready flag: %d", err);
+        return err;
+    }
+
+    data->dx = packet[1] - ((packet[0] & PINNACLE_PACKET_X_SIGN) ? 256 : 0);
+    data->dy = packet[2] - ((packet[0] & PINNACLE_PACKET_Y_SIGN) ? 256 : 0);
+
+    LOG_DBG("dx %d dy %d", data->dx, data->dy);
+
+    return 0;
+}
+
+static int pinnacle_channel_get(const struct device *dev, enum sensor_channel chan,
+                                struct sensor_value *val) {
+    struct pinnacle_data *data = dev->data;
+
+    switch (chan) {
+    case SENSOR_CHAN_POS_DX:
+        val->val1 = data->dx;
+        break;
+    case SENSOR_CHAN_POS_DY:
+        val->val1 = data->dy;
+        break;
+    default:
+        return -ENOTSUP;
+    }
+
+    val->val2 = 0;
+
+    return 0;
+}
+
+static void pinnacle_dr_callback(const struct device *port, struct gpio_callback *cb,
+                                 uint32_t pins) {
+    struct pinnacle_data *data = CONTAINER_OF(cb, struct pinnacle_data, dr_cb);
+
+    k_work_submit(&data->work);
+}
+
+static void pinnacle_work_cb(struct k_work *work) {
+    struct pinnacle_data *data = CONTAINER_OF(work, struct pinnacle_data, work);
+
+    if (data->handler) {
+        data->handler(data->dev, data->trigger);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(pinnacle_work_cb)
+
+static int pinnacle_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+                                sensor_trigger_handler_t handler) {
+    struct pinnacle_data *data = dev->data;
+    const struct pinnacle_config *config = dev->config;
+
+    if (trig->type != SENSOR_TRIG_DATA_READY) {
+        return -ENOTSUP;
+    }
+
+    data->trigger = trig;
+    data->handler = handler;
+
+    // The interrupt is on the edge, so a packet which arrived before now would never trigger.
+    if (handler && gpio_pin_get_dt(&config->dr) > 0) {
+        k_work_submit(&data->work);
+    }
+
+    return 0;
+}
+
+static const struct sensor_driver_api pinnacle_driver_api = {
+    .trigger_set = pinnacle_trigger_set,
+    .sample_fetch = pinnacle_sample_fetch,
+    .channel_get = pinnacle_channel_get,
+};
+
+static int pinnacle_init(const struct device *dev) {
+    struct pinnacle_data *data = dev->data;
+    const struct pinnacle_config *config = dev->config;
+    uint8_t fw_id;
+
+    data->dev = dev;
+
+    if (!config->bus_ready(dev)) {
+        LOG_ERR("Trackpad bus is not ready");
+        return -ENODEV;
+    }
+
+    if (!device_is_ready(config->dr.port)) {
+        LOG_ERR("GPIO is not ready: %s", config->dr.port->name);
+        return -ENODEV;
+    }
+
+    int err = config->read(dev, PINNACLE_FW_ID, &fw_id, sizeof(fw_id));
+    if (err) {
+        LOG_ERR("Failed to read the trackpad firmware ID: %d", err);
+        return err;
+    }
+
+    if (fw_id != PINNACLE_FW_ID_VALUE) {
+        LOG_ERR("Unexpected trackpad firmware ID 0x%02x", fw_id);
+        return -ENODEV;
+    }
+
+    // Clear the command complete flag left from power on, and any data ready flag.
+    err = config->write(dev, PINNACLE_STATUS1, 0);
+    if (err) {
+        return err;
+    }
+
+    err = config->write(dev, PINNACLE_SAMPLE_RATE, config->sample_rate);
+    if (err) {
+        return err;
+    }
+
+    // Report plain relative motion. Taps, scrolling and glides are left to the keymap.
+    err = config->write(dev, PINNACLE_FEED_CFG2,
+                        PINNACLE_FEED_CFG2_ALL_TAPS_DISABLE | PINNACLE_FEED_CFG2_SCROLL_DISABLE |
+                            PINNACLE_FEED_CFG2_GLIDE_EXTEND_DISABLE);
+    if (err) {
+        return err;
+    }
+
+    err = config->write(dev, PINNACLE_FEED_CFG1, PINNACLE_FEED_CFG1_FEED_ENABLE);
+    if (err) {
+        LOG_ERR("Failed to enable the trackpad feed: %d", err);
+        return err;
+    }
+
+    err = gpio_pin_configure_dt(&config->dr, GPIO_INPUT);
+    if (err) {
+        LOG_ERR("Unable to configure DR pin %u on %s", config->dr.pin, config->dr.port->name);
+        return err;
+    }
+
+    k_work_init(&data->work, ZMK_WORK_WATCHED(pinnacle_work_cb));
+
+    gpio_init_callback(&data->dr_cb, pinnacle_dr_callback, BIT(config->dr.pin));
+
+    err = gpio_add_callback(config->dr.port, &data->dr_cb);
+    if (err) {
+        LOG_ERR("Failed to set DR callback: %d", err);
+        return err;
+    }
+
+    return gpio_pin_interrupt_configure_dt(&config->dr, GPIO_INT_EDGE_TO_ACTIVE);
+}
+
+#define PINNACLE_SPI_BUS(n)                                                                        \
+    .bus = {.spi = SPI_DT_SPEC_INST_GET(                                                           \
+                n, SPI_OP_MODE_MASTER | SPI_TRANSFER_MSB | SPI_MODE_CPHA | SPI_WORD_SET(8), 0)},   \
+    .bus_ready = pinnacle_spi_ready, .read = pinnacle_spi_read, .write = pinnacle_spi_write,
+
+#define PINNACLE_I2C_BUS(n)                                                                        \
+    .bus = {.i2c = I2C_DT_SPEC_INST_GET(n)}, .bus_ready = pinnacle_i2c_ready,                      \
+    .read = pinnacle_i2c_read, .write = pinnacle_i2c_write,
+
+#define PINNACLE_INST(n)                                                                           \
+    static struct pinnacle_data pinnacle_data_##n;                                                 \
+    static const struct pinnacle_config pinnacle_config_##n = {                                    \
+        .dr = GPIO_DT_SPEC_INST_GET(n, dr_gpios),                                                  \
+        .sample_rate = DT_INST_PROP(n, sample_rate),                                               \
+        COND_CODE_1(DT_INST_ON_BUS(n, spi), (PINNACLE_SPI_BUS(n)), (PINNACLE_I2C_BUS(n)))};        \
+    DEVICE_DT_INST_DEFINE(n, pinnacle_init, NULL, &pinnacle_data_##n, &pinnacle_config_##n,        \
+                          POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY, &pinnacle_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PINNACLE_INST)
@@ -18,7 +18,7 @@
 
 LOG_MODULE_REGISTER(EC11, CONFIG_SENSOR_LOG_LEVEL);
 
-static int ec11_get_ab_state(const struct device *dev) {
+int ec11_get_ab_state(const struct device *dev) {
     struct ec11_data *drv_data = dev->data;
     const struct ec11_config *drv_cfg = dev->config;
 
@@ -26,6 +26,45 @@ static int ec11_get_ab_state(const struct device *dev) {
            gpio_pin_get(drv_data->b, drv_cfg->b_pin);
 }
 
+int8_t ec11_decode(uint8_t prev_ab_state, uint8_t ab_state) {
+    switch (ab_state | (prev_ab_state << 2)) {
+    case 0b0010:
+    case 0b0100:
+    case 0b1101:
+    case 0b1011:
+        return -1;
+    case 0b0001:
+    case 0b0111:
+    case 0b1110:
+    case 0b1000:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+#ifdef CONFIG_EC11_TRIGGER_ACCUMULATE
+// The interrupt already decoded the pulses, so take as many whole steps as were accumulated.
+static int ec11_sample_fetch(const struct device *dev, enum sensor_channel chan) {
+    struct ec11_data *drv_data = dev->data;
+    const struct ec11_config *drv_cfg = dev->config;
+
+    __ASSERT_NO_MSG(chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_ROTATION);
+
+    const int32_t pulses = atomic_get(&drv_data->pending_pulses);
+    const int32_t ticks = CLAMP(pulses / drv_cfg->resolution, INT8_MIN, INT8_MAX);
+
+    // Leave partial steps, and any beyond what ticks can hold, for the next fetch.
+    atomic_sub(&drv_data->pending_pulses, ticks * drv_cfg->resolution);
+
+    LOG_DBG("Pulses: %d, ticks: %d", pulses, ticks);
+
+    drv_data->ticks = ticks;
+    drv_data->delta = CLAMP(pulses, -1, 1);
+
+    return 0;
+}
+#else
 static int ec11_sample_fetch(const struct device *dev, enum sensor_channel chan) {
     struct ec11_data *drv_data = dev->data;
     const struct ec11_config *drv_cfg = dev->config;
@@ -38,23 +77,7 @@ static int ec11_sample_fetch(const struct device *dev, enum sensor_channel chan)
 
     LOG_DBG("prev: %d, new: %d", drv_data->ab_state, val);
 
-    switch (val | (drv_data->ab_state << 2)) {
-    case 0b0010:
-    case 0b0100:
-    case 0b1101:
-    case 0b1011:
-        delta = -1;
-        break;
-    case 0b0001:
-    case 0b0111:
-    case 0b1110:
-    case 0b1000:
-        delta = 1;
-        break;
-    default:
-        delta = 0;
-        break;
-    }
+    delta = ec11_decode(drv_data->ab_state, val);
 
     LOG_DBG("Delta: %d", delta);
 
@@ -67,6 +90,7 @@ static int ec11_sample_fetch(const struct device *dev, enum sensor_channel chan)
 
     return 0;
 }
+#endif
 
 static int ec11_channel_get(const struct device *dev, enum sensor_channel chan,
                             struct sensor_value *val) {
@@ -119,6 +143,8 @@ int ec11_init(const struct device *dev) {
         return -EIO;
     }
 
+    drv_data->ab_state = ec11_get_ab_state(dev);
+
 #ifdef CONFIG_EC11_TRIGGER
     if (ec11_init_interrupt(dev) < 0) {
         LOG_DBG("Failed to initialize interrupt!");
@@ -126,8 +152,6 @@ int ec11_init(const struct device *dev) {
     }
 #endif
 
-    drv_data->ab_state = ec11_get_ab_state(dev);
-
     return 0;
 }
 
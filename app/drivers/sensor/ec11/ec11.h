@@ -8,6 +8,7 @@
 
 #include <device.h>
 #include <drivers/gpio.h>
+#include <sys/atomic.h>
 #include <sys/util.h>
 
 struct ec11_config {
@@ -44,6 +45,13 @@ struct ec11_data {
     struct k_thread thread;
 #elif defined(CONFIG_EC11_TRIGGER_GLOBAL_THREAD)
     struct k_work work;
+#elif defined(CONFIG_EC11_TRIGGER_SHARED_THREAD)
+    // Bit of this encoder in the pending bitmap of the shared thread
+    uint8_t index;
+#elif defined(CONFIG_EC11_TRIGGER_ACCUMULATE)
+    // Pulses decoded by the interrupt which haven't been fetched yet
+    atomic_t pending_pulses;
+    struct k_work_delayable work;
 #endif
 
 #endif /* CONFIG_EC11_TRIGGER */
@@ -56,3 +64,7 @@ int ec11_trigger_set(const struct device *dev, const struct sensor_trigger *trig
 
 int ec11_init_interrupt(const struct device *dev);
 #endif
+
+int ec11_get_ab_state(const struct device *dev);
+
+int8_t ec11_decode(uint8_t prev_ab_state, uint8_t ab_state);
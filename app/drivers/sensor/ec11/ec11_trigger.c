@@ -11,12 +11,16 @@
 #include <sys/util.h>
 #include <kernel.h>
 #include <drivers/sensor.h>
+#include <stdlib.h>
 
 #include "ec11.h"
 
 extern struct ec11_data ec11_driver;
 
 #include <logging/log.h>
+
+#include <zmk/work_watchdog.h>
+
 LOG_MODULE_DECLARE(EC11, CONFIG_SENSOR_LOG_LEVEL);
 
 static inline void setup_int(const struct device *dev, bool enable) {
@@ -36,6 +40,61 @@ static inline void setup_int(const struct device *dev, bool enable) {
     }
 }
 
+#ifdef CONFIG_EC11_TRIGGER_ACCUMULATE
+// Decode every edge as it happens, leaving the interrupts enabled, so no step is missed while the
+// handler runs. The work item reports whatever accumulated once the interval has passed.
+static void ec11_decode_edge(struct ec11_data *drv_data) {
+    const uint8_t ab_state = ec11_get_ab_state(drv_data->dev);
+    const int8_t delta = ec11_decode(drv_data->ab_state, ab_state);
+
+    drv_data->ab_state = ab_state;
+
+    if (delta != 0) {
+        atomic_add(&drv_data->pending_pulses, delta);
+        k_work_schedule(&drv_data->work, K_MSEC(CONFIG_EC11_REPORT_INTERVAL_MS));
+    }
+}
+
+static void ec11_a_gpio_callback(const struct device *dev, struct gpio_callback *cb,
+                                 uint32_t pins) {
+    ec11_decode_edge(CONTAINER_OF(cb, struct ec11_data, a_gpio_cb));
+}
+
+static void ec11_b_gpio_callback(const struct device *dev, struct gpio_callback *cb,
+                                 uint32_t pins) {
+    ec11_decode_edge(CONTAINER_OF(cb, struct ec11_data, b_gpio_cb));
+}
+
+static void ec11_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
+    struct ec11_data *drv_data = CONTAINER_OF(dwork, struct ec11_data, work);
+    const struct ec11_config *drv_cfg = drv_data->dev->config;
+
+    // Wait for a whole step, since the handler fetches only whole steps.
+    if (abs(atomic_get(&drv_data->pending_pulses)) < drv_cfg->resolution) {
+        return;
+    }
+
+    drv_data->handler(drv_data->dev, drv_data->trigger);
+
+    // Any steps the fetch had no room for are reported after another interval.
+    if (abs(atomic_get(&drv_data->pending_pulses)) >= drv_cfg->resolution) {
+        k_work_schedule(&drv_data->work, K_MSEC(CONFIG_EC11_REPORT_INTERVAL_MS));
+    }
+}
+#else
+#ifdef CONFIG_EC11_TRIGGER_SHARED_THREAD
+// One thread and work item for every encoder, instead of a thread and stack for each.
+K_THREAD_STACK_DEFINE(ec11_stack_area, CONFIG_EC11_THREAD_STACK_SIZE);
+static struct k_work_q ec11_work_q;
+static struct k_work ec11_shared_work;
+
+static const struct device *shared_devices[DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT)];
+static uint8_t shared_devices_len;
+// Encoders whose interrupt fired since their handler last ran, by index into shared_devices.
+static ATOMIC_DEFINE(pending_devices, DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT));
+#endif
+
 static void ec11_a_gpio_callback(const struct device *dev, struct gpio_callback *cb,
                                  uint32_t pins) {
     struct ec11_data *drv_data = CONTAINER_OF(cb, struct ec11_data, a_gpio_cb);
@@ -48,6 +107,9 @@ static void ec11_a_gpio_callback(const struct device *dev, struct gpio_callback
     k_sem_give(&drv_data->gpio_sem);
 #elif defined(CONFIG_EC11_TRIGGER_GLOBAL_THREAD)
     k_work_submit(&drv_data->work);
+#elif defined(CONFIG_EC11_TRIGGER_SHARED_THREAD)
+    atomic_set_bit(pending_devices, drv_data->index);
+    k_work_submit_to_queue(&ec11_work_q, &ec11_shared_work);
 #endif
 }
 
@@ -63,6 +125,9 @@ static void ec11_b_gpio_callback(const struct device *dev, struct gpio_callback
     k_sem_give(&drv_data->gpio_sem);
 #elif defined(CONFIG_EC11_TRIGGER_GLOBAL_THREAD)
     k_work_submit(&drv_data->work);
+#elif defined(CONFIG_EC11_TRIGGER_SHARED_THREAD)
+    atomic_set_bit(pending_devices, drv_data->index);
+    k_work_submit_to_queue(&ec11_work_q, &ec11_shared_work);
 #endif
 }
 
@@ -96,7 +161,23 @@ static void ec11_work_cb(struct k_work *work) {
 
     ec11_thread_cb(drv_data->dev);
 }
+
+ZMK_WORK_WATCHDOG_WRAP(ec11_work_cb)
+#endif
+
+#ifdef CONFIG_EC11_TRIGGER_SHARED_THREAD
+// An interrupt during a handler sets its bit again and resubmits, so no edge is left waiting.
+static void ec11_shared_work_cb(struct k_work *work) {
+    for (int i = 0; i < shared_devices_len; i++) {
+        if (atomic_test_and_clear_bit(pending_devices, i)) {
+            ec11_thread_cb(shared_devices[i]);
+        }
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(ec11_shared_work_cb)
 #endif
+#endif /* CONFIG_EC11_TRIGGER_ACCUMULATE */
 
 int ec11_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
                      sensor_trigger_handler_t handler) {
@@ -142,7 +223,19 @@ int ec11_init_interrupt(const struct device *dev) {
                     (k_thread_entry_t)ec11_thread, dev, 0, NULL,
                     K_PRIO_COOP(CONFIG_EC11_THREAD_PRIORITY), 0, K_NO_WAIT);
 #elif defined(CONFIG_EC11_TRIGGER_GLOBAL_THREAD)
-    k_work_init(&drv_data->work, ec11_work_cb);
+    k_work_init(&drv_data->work, ZMK_WORK_WATCHED(ec11_work_cb));
+#elif defined(CONFIG_EC11_TRIGGER_SHARED_THREAD)
+    if (shared_devices_len == 0) {
+        static const struct k_work_queue_config queue_config = {.name = "EC11 Work"};
+        k_work_queue_start(&ec11_work_q, ec11_stack_area, K_THREAD_STACK_SIZEOF(ec11_stack_area),
+                           K_PRIO_COOP(CONFIG_EC11_THREAD_PRIORITY), &queue_config);
+        k_work_init(&ec11_shared_work, ZMK_WORK_WATCHED(ec11_shared_work_cb));
+    }
+
+    drv_data->index = shared_devices_len;
+    shared_devices[shared_devices_len++] = dev;
+#elif defined(CONFIG_EC11_TRIGGER_ACCUMULATE)
+    k_work_init_delayable(&drv_data->work, ZMK_WORK_WATCHED(ec11_work_cb));
 #endif
 
     return 0;
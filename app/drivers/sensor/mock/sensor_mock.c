@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_sensor_mock
+
+#include <device.h>
+#include <drivers/sensor.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(sensor_mock, CONFIG_SENSOR_LOG_LEVEL);
+
+struct sensor_mock_config {
+    const int32_t *events;
+    size_t events_len;
+};
+
+struct sensor_mock_data {
+    const struct device *dev;
+    sensor_trigger_handler_t handler;
+    const struct sensor_trigger *trigger;
+    struct k_work_delayable work;
+    size_t event_index;
+    int32_t steps;
+};
+
+static void sensor_mock_schedule_next_event(const struct device *dev) {
+    struct sensor_mock_data *data = dev->data;
+    const struct sensor_mock_config *cfg = dev->config;
+
+    if (data->event_index < cfg->events_len) {
+        k_work_schedule(&data->work, K_MSEC(cfg->events[data->event_index]));
+    }
+}
+
+static void sensor_mock_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct sensor_mock_data *data = CONTAINER_OF(dwork, struct sensor_mock_data, work);
+    const struct sensor_mock_config *cfg = data->dev->config;
+
+    data->steps = cfg->events[data->event_index + 1];
+    data->event_index += 2;
+
+    LOG_DBG("steps %d", data->steps);
+    if (data->handler) {
+        data->handler(data->dev, data->trigger);
+    }
+
+    sensor_mock_schedule_next_event(data->dev);
+}
+
+static int sensor_mock_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+                                   sensor_trigger_handler_t handler) {
+    struct sensor_mock_data *data = dev->data;
+
+    data->handler = handler;
+    data->trigger = trig;
+    data->event_index = 0;
+    sensor_mock_schedule_next_event(dev);
+
+    return 0;
+}
+
+static int sensor_mock_sample_fetch(const struct device *dev, enum sensor_channel chan) {
+    return 0;
+}
+
+static int sensor_mock_channel_get(const struct device *dev, enum sensor_channel chan,
+                                   struct sensor_value *val) {
+    struct sensor_mock_data *data = dev->data;
+
+    if (chan != SENSOR_CHAN_ROTATION) {
+        return -ENOTSUP;
+    }
+
+    val->val1 = data->steps;
+    val->val2 = 0;
+
+    return 0;
+}
+
+static const struct sensor_driver_api sensor_mock_driver_api = {
+    .trigger_set = sensor_mock_trigger_set,
+    .sample_fetch = sensor_mock_sample_fetch,
+    .channel_get = sensor_mock_channel_get,
+};
+
+static int sensor_mock_init(const struct device *dev) {
+    struct sensor_mock_data *data = dev->data;
+
+    data->dev = dev;
+    k_work_init_delayable(&data->work, sensor_mock_work_handler);
+
+    return 0;
+}
+
+#define SENSOR_MOCK_INST(n)                                                                        \
+    BUILD_ASSERT(DT_INST_PROP_LEN(n, events) % 2 == 0,                                             \
+                 "Mock sensor events are pairs of a delay and steps");                             \
+    static const int32_t sensor_mock_events_##n[] = DT_INST_PROP(n, events);                       \
+    static struct sensor_mock_data sensor_mock_data_##n;                                           \
+    static const struct sensor_mock_config sensor_mock_config_##n = {                              \
+        .events = sensor_mock_events_##n,                                                          \
+        .events_len = ARRAY_SIZE(sensor_mock_events_##n),                                          \
+    };                                                                                             \
+    DEVICE_DT_INST_DEFINE(n, sensor_mock_init, NULL, &sensor_mock_data_##n,                        \
+                          &sensor_mock_config_##n, POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,       \
+                          &sensor_mock_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(SENSOR_MOCK_INST)
@@ -11,6 +11,7 @@
 #include <sys/util.h>
 #include <string.h>
 #include <device.h>
+#include <drivers/sensor.h>
 #include <zmk/keys.h>
 #include <zmk/behavior.h>
 
@@ -25,7 +26,9 @@
 typedef int (*behavior_keymap_binding_callback_t)(struct zmk_behavior_binding *binding,
                                                   struct zmk_behavior_binding_event event);
 typedef int (*behavior_sensor_keymap_binding_callback_t)(struct zmk_behavior_binding *binding,
+                                                         uint8_t sensor_number,
                                                          const struct device *sensor,
+                                                         struct sensor_value value,
                                                          int64_t timestamp);
 
 enum behavior_locality {
@@ -45,6 +48,24 @@ __subsystem struct behavior_driver_api {
  * @endcond
  */
 
+/**
+ * @brief Get the behavior device of a binding
+ * @param binding Pointer to the binding
+ *
+ * The device is looked up by label the first time and cached in the binding, so later calls
+ * don't walk the device list again.
+ *
+ * @retval Pointer to the device, or NULL if no behavior with that label exists.
+ */
+static inline const struct device *
+behavior_get_binding_device(struct zmk_behavior_binding *binding) {
+    if (binding->behavior == NULL && binding->behavior_dev != NULL) {
+        binding->behavior = device_get_binding(binding->behavior_dev);
+    }
+
+    return binding->behavior;
+}
+
 /**
  * @brief Handle the keymap binding which needs to be converted from relative "toggle" to absolute
  * "turn on"
@@ -59,7 +80,7 @@ __syscall int behavior_keymap_binding_convert_central_state_dependent_params(
 
 static inline int z_impl_behavior_keymap_binding_convert_central_state_dependent_params(
     struct zmk_behavior_binding *binding, struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     const struct behavior_driver_api *api = (const struct behavior_driver_api *)dev->api;
 
     if (api->binding_convert_central_state_dependent_params == NULL) {
@@ -105,7 +126,7 @@ __syscall int behavior_keymap_binding_pressed(struct zmk_behavior_binding *bindi
 
 static inline int z_impl_behavior_keymap_binding_pressed(struct zmk_behavior_binding *binding,
                                                          struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
 
     if (dev == NULL) {
         return -EINVAL;
@@ -133,7 +154,7 @@ __syscall int behavior_keymap_binding_released(struct zmk_behavior_binding *bind
 
 static inline int z_impl_behavior_keymap_binding_released(struct zmk_behavior_binding *binding,
                                                           struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
 
     if (dev == NULL) {
         return -EINVAL;
@@ -151,7 +172,10 @@ static inline int z_impl_behavior_keymap_binding_released(struct zmk_behavior_bi
 /**
  * @brief Handle the a sensor keymap binding being triggered
  * @param dev Pointer to the device structure for the driver instance.
- * @param sensor Pointer to the sensor device structure for the sensor driver instance.
+ * @param sensor_number Index of the sensor in the zmk,keymap-sensors node.
+ * @param sensor Pointer to the sensor device structure for the sensor driver instance, or NULL
+ * for a sensor on a split peripheral. Use sensor_number to tell sensors apart.
+ * @param value Value of the triggered sensor channel, already fetched from the sensor.
  * @param param1 User parameter specified at time of behavior binding.
  * @param param2 User parameter specified at time of behavior binding.
  *
@@ -159,13 +183,16 @@ static inline int z_impl_behavior_keymap_binding_released(struct zmk_behavior_bi
  * @retval Negative errno code if failure.
  */
 __syscall int behavior_sensor_keymap_binding_triggered(struct zmk_behavior_binding *binding,
+                                                       uint8_t sensor_number,
                                                        const struct device *sensor,
+                                                       struct sensor_value value,
                                                        int64_t timestamp);
 
 static inline int
 z_impl_behavior_sensor_keymap_binding_triggered(struct zmk_behavior_binding *binding,
-                                                const struct device *sensor, int64_t timestamp) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+                                                uint8_t sensor_number, const struct device *sensor,
+                                                struct sensor_value value, int64_t timestamp) {
+    const struct device *dev = behavior_get_binding_device(binding);
 
     if (dev == NULL) {
         return -EINVAL;
@@ -177,7 +204,7 @@ z_impl_behavior_sensor_keymap_binding_triggered(struct zmk_behavior_binding *bin
         return -ENOTSUP;
     }
 
-    return api->sensor_binding_triggered(binding, sensor, timestamp);
+    return api->sensor_binding_triggered(binding, sensor_number, sensor, value, timestamp);
 }
 
 /**
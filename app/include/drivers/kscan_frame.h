@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/kscan.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Whether the kscan driver of a node reports whole scans, so its API is a
+ * kscan_frame_driver_api. List a driver's compatible here once it implements config_frame.
+ */
+#define KSCAN_FRAME_SUPPORTED(node_id)                                                             \
+    (DT_NODE_HAS_COMPAT(node_id, zmk_kscan_gpio_matrix) ||                                         \
+     DT_NODE_HAS_COMPAT(node_id, zmk_kscan_analog_mux))
+
+/**
+ * Every key change found by one scan. Bit (i % 32) of word (i / 32) belongs to the key at row
+ * (i % rows), column (i / rows).
+ */
+struct kscan_frame {
+    /** Keys whose pressed state changed in this scan. */
+    const uint32_t *changed;
+    /** Pressed state of every key after this scan. */
+    const uint32_t *pressed;
+    /** Length of changed and pressed. */
+    uint16_t words;
+    uint16_t rows;
+    /** Uptime of the scan in milliseconds. */
+    int64_t timestamp;
+};
+
+/**
+ * Called once for each scan that changed at least one key. The frame is only valid during the
+ * call.
+ */
+typedef void (*kscan_frame_callback_t)(const struct device *dev, const struct kscan_frame *frame);
+
+/**
+ * @cond INTERNAL_HIDDEN
+ *
+ * Kscan frame driver API definition.
+ *
+ * (Internal use only.)
+ */
+
+typedef int (*kscan_frame_config_t)(const struct device *dev, kscan_frame_callback_t callback);
+
+struct kscan_frame_driver_api {
+    /** Must be first, so the device still works with the Zephyr kscan API. */
+    struct kscan_driver_api kscan;
+    kscan_frame_config_t config_frame;
+};
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Report whole scans to a frame callback instead of each key to a kscan callback.
+ *
+ * Only valid for devices whose node passes KSCAN_FRAME_SUPPORTED().
+ *
+ * @param dev Pointer to the device structure for the driver instance.
+ * @param callback Called with the changes of each scan.
+ *
+ * @retval 0 If successful.
+ * @retval -ENOTSUP If the driver can't report frames in its current configuration.
+ * @retval Negative errno code if failure.
+ */
+static inline int kscan_frame_config(const struct device *dev, kscan_frame_callback_t callback) {
+    const struct kscan_frame_driver_api *api = (const struct kscan_frame_driver_api *)dev->api;
+
+    if (api->config_frame == NULL) {
+        return -ENOTSUP;
+    }
+
+    return api->config_frame(dev, callback);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,6 +11,8 @@
 #define BL_DEC_CMD 4
 #define BL_CYCLE_CMD 5
 #define BL_SET_CMD 6
+// Sent to split peripherals with the central's whole state, not meant for keymaps.
+#define BL_STATE_CMD 7
 
 #define BL_ON BL_ON_CMD 0
 #define BL_OFF BL_OFF_CMD 0
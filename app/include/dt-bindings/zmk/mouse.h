@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Mouse buttons, for the mouse key press behavior */
+#define MB1 0
+#define MB2 1
+#define MB3 2
+#define MB4 3
+#define MB5 4
+
+#define LCLK MB1
+#define RCLK MB2
+#define MCLK MB3
+
+/*
+ * Packs the X and Y speeds of the mouse move and scroll behaviors into one parameter. Each is a
+ * signed 16 bit value, in pixels per second for moving and wheel detents per second for scrolling.
+ */
+#define MOUSE_XY(x, y) ((((x)&0xFFFF) << 16) | ((y)&0xFFFF))
+
+#ifndef ZMK_MOUSE_DEFAULT_MOVE_SPEED
+#define ZMK_MOUSE_DEFAULT_MOVE_SPEED 600
+#endif
+
+#ifndef ZMK_MOUSE_DEFAULT_SCROLL_SPEED
+#define ZMK_MOUSE_DEFAULT_SCROLL_SPEED 10
+#endif
+
+#define MOVE_UP MOUSE_XY(0, -ZMK_MOUSE_DEFAULT_MOVE_SPEED)
+#define MOVE_DOWN MOUSE_XY(0, ZMK_MOUSE_DEFAULT_MOVE_SPEED)
+#define MOVE_LEFT MOUSE_XY(-ZMK_MOUSE_DEFAULT_MOVE_SPEED, 0)
+#define MOVE_RIGHT MOUSE_XY(ZMK_MOUSE_DEFAULT_MOVE_SPEED, 0)
+
+#define SCRL_UP MOUSE_XY(0, ZMK_MOUSE_DEFAULT_SCROLL_SPEED)
+#define SCRL_DOWN MOUSE_XY(0, -ZMK_MOUSE_DEFAULT_SCROLL_SPEED)
+#define SCRL_LEFT MOUSE_XY(-ZMK_MOUSE_DEFAULT_SCROLL_SPEED, 0)
+#define SCRL_RIGHT MOUSE_XY(ZMK_MOUSE_DEFAULT_SCROLL_SPEED, 0)
@@ -8,4 +8,10 @@
 
 enum zmk_activity_state { ZMK_ACTIVITY_ACTIVE, ZMK_ACTIVITY_IDLE, ZMK_ACTIVITY_SLEEP };
 
-enum zmk_activity_state zmk_activity_get_state();
\ No newline at end of file
+enum zmk_activity_state zmk_activity_get_state();
+
+/**
+ * Follow the activity state of the split central. A peripheral stays active while the central is,
+ * and sleeps when it does.
+ */
+void zmk_activity_set_central_state(enum zmk_activity_state state);
\ No newline at end of file
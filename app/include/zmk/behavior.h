@@ -9,7 +9,12 @@
 #define ZMK_BEHAVIOR_OPAQUE 0
 #define ZMK_BEHAVIOR_TRANSPARENT 1
 
+struct device;
+
 struct zmk_behavior_binding {
+    // Resolved from behavior_dev on first use, see behavior_get_binding_device(). The label is
+    // kept for logging and for sending bindings to split peripherals.
+    const struct device *behavior;
     char *behavior_dev;
     uint32_t param1;
     uint32_t param2;
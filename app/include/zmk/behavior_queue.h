@@ -10,5 +10,39 @@
 #include <stdint.h>
 #include <zmk/behavior.h>
 
-int zmk_behavior_queue_add(uint32_t position, const struct zmk_behavior_binding behavior,
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+/**
+ * Added to a wait or tap time, moves on as soon as the reports sent so far reached the host, and
+ * only waits the full time if they didn't.
+ */
+#define ZMK_BEHAVIOR_QUEUE_PACED BIT(31)
+
+/**
+ * Called by the endpoints whenever a transport delivered reports, to wake up the streams waiting
+ * for them. Safe to call from interrupts.
+ */
+void zmk_behavior_queue_reports_delivered();
+#endif
+
+/**
+ * Queues a press or release of the binding. Bindings are queued by reference rather than copied,
+ * so they must stay valid until they have been invoked. The queue may resolve their devices.
+ */
+int zmk_behavior_queue_add(uint32_t position, const struct zmk_behavior_binding *binding,
                            bool press, uint32_t wait);
+
+/**
+ * Queues a press of the binding, followed by its release `tap_ms` later. This is the same as
+ * queueing the press and the release separately, but only takes up one queue entry.
+ */
+int zmk_behavior_queue_add_tap(uint32_t position, const struct zmk_behavior_binding *binding,
+                               uint32_t tap_ms, uint32_t wait);
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+/**
+ * Queues a tap of `count` bindings at once: they are all pressed in one HID report, and all
+ * released in one report `tap_ms` later.
+ */
+int zmk_behavior_queue_add_burst(uint32_t position, const struct zmk_behavior_binding *bindings,
+                                 uint8_t count, uint32_t tap_ms, uint32_t wait);
+#endif
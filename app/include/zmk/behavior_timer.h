@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/dlist.h>
+
+struct zmk_behavior_timer;
+
+typedef void (*zmk_behavior_timer_handler_t)(struct zmk_behavior_timer *timer);
+
+/**
+ * A timeout for a behavior. All pending behavior timers share a single kernel timeout on the
+ * input work queue, so scheduling and cancelling them doesn't touch the kernel unless the earliest
+ * deadline moves forward.
+ */
+struct zmk_behavior_timer {
+    sys_dnode_t node;
+    // Uptime in milliseconds at which the handler runs.
+    int64_t deadline;
+    zmk_behavior_timer_handler_t handler;
+};
+
+#define ZMK_BEHAVIOR_TIMER_INITIALIZER(_handler) {.handler = _handler}
+
+void zmk_behavior_timer_init(struct zmk_behavior_timer *timer,
+                             zmk_behavior_timer_handler_t handler);
+
+/**
+ * Runs the timer's handler on the input work queue once the uptime reaches `deadline`. A timer
+ * that is already pending is moved to the new deadline. Deadlines in the past run right away.
+ */
+void zmk_behavior_timer_schedule(struct zmk_behavior_timer *timer, int64_t deadline);
+
+/**
+ * Stops a pending timer. Returns -EINPROGRESS if its handler is running on another thread and
+ * can no longer be stopped, 0 otherwise.
+ */
+int zmk_behavior_timer_cancel(struct zmk_behavior_timer *timer);
+
+/**
+ * Returns whether the timer is scheduled or its handler is running.
+ */
+bool zmk_behavior_timer_is_pending(const struct zmk_behavior_timer *timer);
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/gap.h>
+
+// Undirected advertising starts at the fastest tier after a disconnect or wake, and moves to the
+// next one each time a tier's duration passes without a connection.
+enum zmk_ble_adv_tier {
+    ZMK_BLE_ADV_TIER_FAST,
+    ZMK_BLE_ADV_TIER_MEDIUM,
+    ZMK_BLE_ADV_TIER_SLOW,
+};
+
+/**
+ * Set the advertising interval of `param` to the one of `tier`.
+ *
+ * @return How long to advertise in the tier before moving on, or K_FOREVER for the slowest one.
+ */
+static inline k_timeout_t zmk_ble_adv_tier_param(enum zmk_ble_adv_tier tier,
+                                                 struct bt_le_adv_param *param) {
+    switch (tier) {
+    case ZMK_BLE_ADV_TIER_FAST:
+        param->interval_min = BT_GAP_ADV_FAST_INT_MIN_1;
+        param->interval_max = BT_GAP_ADV_FAST_INT_MAX_1;
+        return K_MSEC(CONFIG_ZMK_BLE_ADV_FAST_DURATION_MS);
+    case ZMK_BLE_ADV_TIER_MEDIUM:
+        param->interval_min = BT_GAP_ADV_FAST_INT_MIN_2;
+        param->interval_max = BT_GAP_ADV_FAST_INT_MAX_2;
+        return K_MSEC(CONFIG_ZMK_BLE_ADV_MEDIUM_DURATION_MS);
+    default:
+        param->interval_min = BT_GAP_ADV_SLOW_INT_MIN;
+        param->interval_max = BT_GAP_ADV_SLOW_INT_MAX;
+        return K_FOREVER;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <init.h>
+#include <kernel.h>
+
+#if IS_ENABLED(CONFIG_ZMK_BOOT_PROFILE)
+
+/** Start timing a boot stage. Pass the result to zmk_boot_profile_record() once it's done. */
+static inline uint32_t zmk_boot_profile_start() { return k_cycle_get_32(); }
+
+/** Record a boot stage that started at `start` and returned `ret`. */
+void zmk_boot_profile_record(const char *name, uint32_t start, int ret);
+
+/** Note that a HID report was sent. Only the first one after boot is recorded. */
+void zmk_boot_profile_report_sent();
+
+/** Log every recorded boot stage. */
+void zmk_boot_profile_log();
+
+/**
+ * SYS_INIT that also records how long `init_fn` took, so it shows up in the boot profile.
+ */
+#define ZMK_SYS_INIT(init_fn, level, prio)                                                         \
+    static int init_fn##_profiled(const struct device *dev) {                                      \
+        uint32_t start = zmk_boot_profile_start();                                                 \
+        int ret = init_fn(dev);                                                                    \
+        zmk_boot_profile_record(#init_fn, start, ret);                                             \
+        return ret;                                                                                \
+    }                                                                                              \
+    SYS_INIT(init_fn##_profiled, level, prio)
+
+#else
+
+static inline uint32_t zmk_boot_profile_start() { return 0; }
+static inline void zmk_boot_profile_record(const char *name, uint32_t start, int ret) {}
+static inline void zmk_boot_profile_report_sent() {}
+static inline void zmk_boot_profile_log() {}
+
+#define ZMK_SYS_INIT(init_fn, level, prio) SYS_INIT(init_fn, level, prio)
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BOOT_PROFILE) */
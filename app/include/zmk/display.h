@@ -15,6 +15,18 @@ struct k_work_q *zmk_display_work_q();
 bool zmk_display_is_initialized();
 int zmk_display_init();
 
+/**
+ * @brief Run LVGL until it has drawn any pending changes. Must be called after changing any LVGL
+ * objects, since LVGL is not ticked while there is nothing to draw.
+ */
+void zmk_display_request_refresh();
+
+/**
+ * @brief Time until the next frame may be drawn, based on CONFIG_ZMK_DISPLAY_MIN_FRAME_INTERVAL_MS.
+ * Work that changes LVGL objects should be scheduled with this delay so it is drawn in one frame.
+ */
+k_timeout_t zmk_display_frame_delay();
+
 /**
  * @brief Macro to define a ZMK event listener that handles the thread safety of fetching
  * the necessary state from the system work queue context, invoking a work callback
@@ -39,7 +51,10 @@ int zmk_display_init();
         k_mutex_unlock(&listener##_mutex);                                                         \
         return copy;                                                                               \
     };                                                                                             \
-    static void listener##_work_cb(struct k_work *work) { cb(listener##_get_local_state()); };     \
+    static void listener##_work_cb(struct k_work *work) {                                          \
+        cb(listener##_get_local_state());                                                          \
+        zmk_display_request_refresh();                                                             \
+    };                                                                                             \
     K_WORK_DEFINE(listener##_work, listener##_work_cb);                                            \
     static void listener##_refresh_state(const zmk_event_t *eh) {                                  \
         k_mutex_lock(&listener##_mutex, K_FOREVER);                                                \
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file rle_image.h
+ *  @brief Run-length encoded 1-bit images drawn straight from flash.
+ *
+ * The data starts with ZMK_RLE_IMAGE_RUNS_4 or ZMK_RLE_IMAGE_RUNS_8, the size of each run length
+ * in bits. The run lengths follow, most significant nibble first for 4-bit runs. Runs alternate
+ * between white and black pixels, starting with white, and continue from one row to the next. A
+ * zero-length run only switches the color, which lets runs longer than the maximum length be split.
+ * Pixels after the last run are white.
+ *
+ * app/scripts/rle_image.py converts LVGL 1-bit indexed images to this format.
+ */
+
+#pragma once
+
+#include <lvgl.h>
+
+#define ZMK_RLE_IMAGE_CF LV_IMG_CF_USER_ENCODED_0
+
+#define ZMK_RLE_IMAGE_RUNS_4 4
+#define ZMK_RLE_IMAGE_RUNS_8 8
+
+/** Initializer for the lv_img_dsc_t of a run-length encoded image. */
+#define ZMK_RLE_IMAGE(map, width, height)                                                          \
+    {                                                                                              \
+        .header.always_zero = 0, .header.w = width, .header.h = height,                            \
+        .header.cf = ZMK_RLE_IMAGE_CF, .data_size = sizeof(map), .data = map,                      \
+    }
+
+/**
+ * @brief Register the LVGL image decoder for run-length encoded images. Called by the display
+ * initialization before the status screen is created.
+ */
+int zmk_display_rle_image_init();
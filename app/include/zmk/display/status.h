@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/** @file status.h
+ *  @brief Keyboard status shared by the display widgets.
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <zmk/endpoints_types.h>
+
+#define ZMK_DISPLAY_STATUS_BATTERY BIT(0)
+#define ZMK_DISPLAY_STATUS_USB BIT(1)
+#define ZMK_DISPLAY_STATUS_OUTPUT BIT(2)
+#define ZMK_DISPLAY_STATUS_LAYER BIT(3)
+#define ZMK_DISPLAY_STATUS_WPM BIT(4)
+#define ZMK_DISPLAY_STATUS_PERIPHERAL BIT(5)
+#define ZMK_DISPLAY_STATUS_SPLIT_LATENCY BIT(6)
+#define ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY BIT(7)
+
+/**
+ * @brief Everything the widgets show. Each field is only kept up to date while a listener is
+ * interested in its ZMK_DISPLAY_STATUS_* bit.
+ */
+struct zmk_display_status {
+    /** ZMK_DISPLAY_STATUS_BATTERY */
+    uint8_t battery_level;
+    /** ZMK_DISPLAY_STATUS_USB */
+    bool usb_powered;
+    /** ZMK_DISPLAY_STATUS_OUTPUT */
+    enum zmk_endpoint selected_endpoint;
+    bool active_profile_connected;
+    bool active_profile_bonded;
+    uint8_t active_profile_index;
+    /** ZMK_DISPLAY_STATUS_LAYER */
+    uint8_t layer_index;
+    const char *layer_label;
+    /** ZMK_DISPLAY_STATUS_WPM */
+    uint8_t wpm;
+    /** ZMK_DISPLAY_STATUS_PERIPHERAL */
+    bool peripheral_connected;
+    /** ZMK_DISPLAY_STATUS_SPLIT_LATENCY. 0 until the first measurement. */
+    uint32_t split_rtt_us;
+    /** ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY. 0 while the peripheral is disconnected. */
+    uint8_t peripheral_battery_level;
+};
+
+struct zmk_display_status_listener {
+    sys_snode_t node;
+    /** ZMK_DISPLAY_STATUS_* bits the listener shows. */
+    uint32_t fields;
+    /**
+     * Called in the display queue context with the ZMK_DISPLAY_STATUS_* bits of fields that
+     * changed, only ever ones in fields.
+     */
+    void (*update)(const struct zmk_display_status *status, uint32_t changed);
+};
+
+/**
+ * @brief Start calling a listener when any of its fields change. Must be called in the display
+ * queue context. The listener is called right away with every one of its fields marked changed.
+ * Subscribing a listener that is already subscribed only calls it again.
+ */
+void zmk_display_status_subscribe(struct zmk_display_status_listener *listener);
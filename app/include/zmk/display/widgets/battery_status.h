@@ -12,6 +12,8 @@
 struct zmk_widget_battery_status {
     sys_snode_t node;
     lv_obj_t *obj;
+    // The label shows this buffer instead of a copy in the LVGL heap.
+    char text[9];
 };
 
 int zmk_widget_battery_status_init(struct zmk_widget_battery_status *widget, lv_obj_t *parent);
@@ -12,6 +12,8 @@
 struct zmk_widget_output_status {
     sys_snode_t node;
     lv_obj_t *obj;
+    // The label shows this buffer instead of a copy in the LVGL heap.
+    char text[10];
 };
 
 int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_obj_t *parent);
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <kernel.h>
+
+struct zmk_widget_split_latency_status {
+    sys_snode_t node;
+    lv_obj_t *obj;
+    // The label shows this buffer instead of a copy in the LVGL heap.
+    char text[10];
+};
+
+int zmk_widget_split_latency_status_init(struct zmk_widget_split_latency_status *widget,
+                                         lv_obj_t *parent);
+lv_obj_t *zmk_widget_split_latency_status_obj(struct zmk_widget_split_latency_status *widget);
\ No newline at end of file
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <kernel.h>
+
+struct zmk_widget_wpm_graph {
+    sys_snode_t node;
+    lv_obj_t *obj;
+    struct k_work_delayable sample_work;
+    // The WPM from the last state change, taken as the next sample.
+    uint8_t wpm;
+    // One sample per column. The graph sweeps across rather than scrolling, so each sample only
+    // redraws its own column.
+    uint8_t samples[CONFIG_ZMK_WIDGET_WPM_GRAPH_WIDTH];
+    // The column the next sample goes in, left blank to show where the graph is.
+    uint16_t next;
+    // Columns at 0 in a row. Sampling stops once the whole graph is.
+    uint16_t zero_samples;
+};
+
+int zmk_widget_wpm_graph_init(struct zmk_widget_wpm_graph *widget, lv_obj_t *parent);
+lv_obj_t *zmk_widget_wpm_graph_obj(struct zmk_widget_wpm_graph *widget);
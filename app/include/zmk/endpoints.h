@@ -6,10 +6,73 @@
 
 #pragma once
 
+#include <sys/util.h>
 #include <zmk/endpoints_types.h>
 
+#define ZMK_ENDPOINTS_REPORT_KEYBOARD BIT(0)
+#define ZMK_ENDPOINTS_REPORT_CONSUMER BIT(1)
+
 int zmk_endpoints_select(enum zmk_endpoint endpoint);
 int zmk_endpoints_toggle();
 enum zmk_endpoint zmk_endpoints_selected();
 
 int zmk_endpoints_send_report(uint16_t usage_page);
+
+/**
+ * Send several reports back to back, given as ZMK_ENDPOINTS_REPORT_* flags. The keyboard report
+ * goes first, so modifiers are in place before the consumer usage they apply to, and both are
+ * queued before either transport starts sending.
+ */
+int zmk_endpoints_send_reports(uint8_t reports);
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+/**
+ * Send the mouse buttons and the motion accumulated with zmk_hid_mouse_movement_add() and
+ * zmk_hid_mouse_scroll_add(). Mouse reports only go to the current endpoint, even when mirroring.
+ */
+int zmk_endpoints_send_mouse_report();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+/**
+ * The number of reports skipped so far because the endpoint already had the same report.
+ */
+uint32_t zmk_endpoints_suppressed_reports();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+/**
+ * Whether keyboard or consumer reports are still queued or on their way to the host.
+ */
+bool zmk_endpoints_reports_pending();
+
+/**
+ * Called by the transports when reports reached the host, or will never get there. Safe to call
+ * from interrupts.
+ */
+void zmk_endpoints_reports_delivered();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+// The number of usage changes tracked per batch. Further changes flush the batch first.
+#define ZMK_ENDPOINTS_BATCH_MAX_USAGES 16
+
+/**
+ * Start deferring reports until the matching zmk_endpoints_batch_end(). Batches may nest; reports
+ * are only flushed when the outermost batch ends.
+ */
+void zmk_endpoints_batch_begin();
+int zmk_endpoints_batch_end();
+
+/**
+ * Send any reports deferred by the current batch right away.
+ */
+int zmk_endpoints_batch_flush();
+
+/**
+ * Called before the state of `usage` changes. If the usage already changed in the current batch,
+ * or the change carries implicit modifiers, the pending reports are flushed first so the host
+ * still sees every transition.
+ */
+void zmk_endpoints_batch_prepare_change(uint32_t usage, bool implicit_mods);
+#endif
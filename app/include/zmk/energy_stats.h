@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <sys/util.h>
+
+/** Things that wake the CPU or the radio, counted to see what uses the battery. */
+enum zmk_energy_counter {
+    /** One pass over the keys by a kscan driver. */
+    ZMK_ENERGY_KSCAN_SCAN,
+    /** A HID report notification sent to a BLE host. */
+    ZMK_ENERGY_HID_NOTIFY,
+    /** A notification sent from a split peripheral to the central. */
+    ZMK_ENERGY_SPLIT_NOTIFY,
+    /** A frame sent to the underglow LED strip. */
+    ZMK_ENERGY_LED_STRIP_UPDATE,
+    /** A run of the LVGL task handler. */
+    ZMK_ENERGY_DISPLAY_REFRESH,
+    ZMK_ENERGY_COUNTER_COUNT,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_ENERGY_STATS)
+
+void zmk_energy_stats_count(enum zmk_energy_counter counter);
+
+/** Start all counters and work queue active times over from zero. */
+void zmk_energy_stats_reset();
+
+#else
+
+static inline void zmk_energy_stats_count(enum zmk_energy_counter counter) {}
+static inline void zmk_energy_stats_reset() {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_ENERGY_STATS) */
@@ -10,13 +10,40 @@
 #include <kernel.h>
 #include <zephyr/types.h>
 
+struct zmk_event_subscription;
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+struct zmk_event_pool {
+    struct k_mem_slab *slab;
+    // Most blocks of the slab ever in use at the same time.
+    uint32_t high_water_mark;
+    // Number of allocations that did not fit the slab and used the heap instead.
+    uint32_t heap_fallbacks;
+};
+#endif
+
 struct zmk_event_type {
     const char *name;
+    // Subscriptions are sorted by event type at link time, this points at the
+    // first subscription for this event type.
+    const struct zmk_event_subscription *subscriptions;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+    struct zmk_event_pool *pool;
+#endif
+    // Size of an allocated event, so heap usage can be tracked when it is freed and events can be
+    // copied for deferred listeners.
+    size_t size;
 };
 
+#define ZMK_EVENT_FLAG_POOLED BIT(0)
+// Set for events raised with raise_<event>(), which live on the stack of the raising caller.
+#define ZMK_EVENT_FLAG_STACK BIT(1)
+
 typedef struct {
     const struct zmk_event_type *event;
+    // Index of the last listener called, relative to the subscriptions of the event type.
     uint8_t last_listener_index;
+    uint8_t flags;
 } zmk_event_t;
 
 #define ZMK_EV_EVENT_BUBBLE 0
@@ -26,11 +53,30 @@ typedef struct {
 typedef int (*zmk_listener_callback_t)(const zmk_event_t *eh);
 struct zmk_listener {
     zmk_listener_callback_t callback;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+    const char *name;
+#endif
+};
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+struct zmk_listener_stats {
+    uint32_t calls;
+    uint32_t captures;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
 };
+#endif
 
 struct zmk_event_subscription {
     const struct zmk_event_type *event_type;
     const struct zmk_listener *listener;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+    struct zmk_listener_stats *stats;
+#endif
+    // Whether the listener may return ZMK_EV_EVENT_CAPTURED for this event type.
+    bool may_capture;
+    // Whether the listener is called later from the system work queue, with a copy of the event.
+    bool deferred;
 };
 
 #define ZMK_EVENT_DECLARE(event_type)                                                              \
@@ -39,35 +85,99 @@ struct zmk_event_subscription {
         struct event_type data;                                                                    \
     };                                                                                             \
     struct event_type##_event *new_##event_type(struct event_type);                                \
+    int raise_##event_type(struct event_type);                                                     \
     struct event_type *as_##event_type(const zmk_event_t *eh);                                     \
     extern const struct zmk_event_type zmk_event_##event_type;
 
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+#define ZMK_EVENT_POOL_DEFINE(event_type)                                                          \
+    K_MEM_SLAB_DEFINE(zmk_event_slab_##event_type, ROUND_UP(sizeof(struct event_type##_event), 8), \
+                      CONFIG_ZMK_EVENT_MANAGER_POOL_SIZE, 8);                                      \
+    static struct zmk_event_pool zmk_event_pool_##event_type = {                                   \
+        .slab = &zmk_event_slab_##event_type,                                                      \
+    };
+#define ZMK_EVENT_POOL_REF(event_type) .pool = &zmk_event_pool_##event_type,
+#else
+#define ZMK_EVENT_POOL_DEFINE(event_type)
+#define ZMK_EVENT_POOL_REF(event_type)
+#endif
+
+// Each event type places an empty marker subscription in front of its own subscriptions, which
+// gives the event type a link time reference to the start of its slice of the sorted
+// subscription section.
 #define ZMK_EVENT_IMPL(event_type)                                                                 \
-    const struct zmk_event_type zmk_event_##event_type = {.name = STRINGIFY(event_type)};          \
+    ZMK_EVENT_POOL_DEFINE(event_type)                                                              \
+    const Z_DECL_ALIGN(struct zmk_event_subscription) zmk_event_subs_##event_type __used           \
+        __attribute__((__section__(".event_subscription." STRINGIFY(event_type) ".0"))) = {0};     \
+    const struct zmk_event_type zmk_event_##event_type = {                                         \
+        .name = STRINGIFY(event_type),                                                             \
+        .subscriptions = &zmk_event_subs_##event_type + 1,                                         \
+        ZMK_EVENT_POOL_REF(event_type)                                                             \
+        .size = sizeof(struct event_type##_event),                                                 \
+    };                                                                                             \
     const struct zmk_event_type *zmk_event_ref_##event_type __used                                 \
         __attribute__((__section__(".event_type"))) = &zmk_event_##event_type;                     \
     struct event_type##_event *new_##event_type(struct event_type data) {                          \
-        struct event_type##_event *ev =                                                            \
-            (struct event_type##_event *)k_malloc(sizeof(struct event_type##_event));              \
-        ev->header.event = &zmk_event_##event_type;                                                \
+        struct event_type##_event *ev = (struct event_type##_event *)zmk_event_manager_alloc(      \
+            &zmk_event_##event_type, sizeof(struct event_type##_event));                           \
+        if (ev == NULL) {                                                                          \
+            return NULL;                                                                           \
+        }                                                                                          \
         ev->data = data;                                                                           \
         return ev;                                                                                 \
     };                                                                                             \
+    int raise_##event_type(struct event_type data) {                                               \
+        struct event_type##_event ev = {                                                           \
+            .header = {.event = &zmk_event_##event_type, .flags = ZMK_EVENT_FLAG_STACK},           \
+            .data = data,                                                                          \
+        };                                                                                         \
+        return zmk_event_manager_raise_on_stack(&ev.header, sizeof(ev));                           \
+    };                                                                                             \
     struct event_type *as_##event_type(const zmk_event_t *eh) {                                    \
         return (eh->event == &zmk_event_##event_type) ? &((struct event_type##_event *)eh)->data   \
                                                       : NULL;                                      \
     };
 
-#define ZMK_LISTENER(mod, cb) const struct zmk_listener zmk_listener_##mod = {.callback = cb};
-
-#define ZMK_SUBSCRIPTION(mod, ev_type)                                                             \
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+#define ZMK_LISTENER_NAME(mod) .name = STRINGIFY(mod),
+#define ZMK_SUBSCRIPTION_STATS_DEFINE(mod, ev_type)                                                \
+    static struct zmk_listener_stats _CONCAT(_CONCAT(zmk_event_sub_stats_, mod), ev_type);
+#define ZMK_SUBSCRIPTION_STATS_REF(mod, ev_type)                                                   \
+    .stats = &_CONCAT(_CONCAT(zmk_event_sub_stats_, mod), ev_type),
+#else
+#define ZMK_LISTENER_NAME(mod)
+#define ZMK_SUBSCRIPTION_STATS_DEFINE(mod, ev_type)
+#define ZMK_SUBSCRIPTION_STATS_REF(mod, ev_type)
+#endif
+
+#define ZMK_LISTENER(mod, cb)                                                                      \
+    const struct zmk_listener zmk_listener_##mod = {.callback = cb, ZMK_LISTENER_NAME(mod)};
+
+#define Z_ZMK_SUBSCRIPTION(mod, ev_type, capture, defer)                                           \
+    ZMK_SUBSCRIPTION_STATS_DEFINE(mod, ev_type)                                                    \
     const Z_DECL_ALIGN(struct zmk_event_subscription)                                              \
         _CONCAT(_CONCAT(zmk_event_sub_, mod), ev_type) __used                                      \
-        __attribute__((__section__(".event_subscription"))) = {                                    \
+        __attribute__((__section__(".event_subscription." STRINGIFY(ev_type) ".1"))) = {           \
             .event_type = &zmk_event_##ev_type,                                                    \
             .listener = &zmk_listener_##mod,                                                       \
+            .may_capture = capture,                                                                \
+            .deferred = defer,                                                                     \
+            ZMK_SUBSCRIPTION_STATS_REF(mod, ev_type)                                               \
     };
 
+#define ZMK_SUBSCRIPTION(mod, ev_type) Z_ZMK_SUBSCRIPTION(mod, ev_type, false, false)
+
+// Subscriptions of listeners that may return ZMK_EV_EVENT_CAPTURED must be declared with this,
+// so events of that type are never raised from the stack.
+#define ZMK_SUBSCRIPTION_CAPTURING(mod, ev_type) Z_ZMK_SUBSCRIPTION(mod, ev_type, true, false)
+
+// Subscriptions of listeners that nothing on the key path waits for, such as statistics and
+// indicators. With CONFIG_ZMK_EVENT_MANAGER_DEFERRED_LISTENERS, they are called later from the
+// system work queue with a copy of the event, and their return value is ignored.
+#define ZMK_SUBSCRIPTION_DEFERRED(mod, ev_type)                                                    \
+    Z_ZMK_SUBSCRIPTION(mod, ev_type, false, IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_DEFERRED_LISTENERS))
+
+// The raise functions return -ENOMEM for a NULL event, so a failed new_<event>() is dropped.
 #define ZMK_EVENT_RAISE(ev) zmk_event_manager_raise((zmk_event_t *)ev);
 
 #define ZMK_EVENT_RAISE_AFTER(ev, mod)                                                             \
@@ -78,9 +188,67 @@ struct zmk_event_subscription {
 
 #define ZMK_EVENT_RELEASE(ev) zmk_event_manager_release((zmk_event_t *)ev);
 
-#define ZMK_EVENT_FREE(ev) k_free((void *)ev);
+#define ZMK_EVENT_FREE(ev) zmk_event_manager_free((zmk_event_t *)ev);
+
+zmk_event_t *zmk_event_manager_alloc(const struct zmk_event_type *event_type, size_t size);
+void zmk_event_manager_free(zmk_event_t *event);
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+void zmk_event_manager_log_pool_stats();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+void zmk_event_manager_log_listener_stats();
+void zmk_event_manager_reset_listener_stats();
+#endif
+
+// A ring buffer for events captured by a listener, which are later replayed in capture order,
+// usually with ZMK_EVENT_RAISE_AT() for that listener. Events are captured in groups, e.g. one per
+// undecided hold-tap. Replaying a group can start a new one, whose events are appended after it,
+// so nested captures share the buffer without copying.
+struct zmk_event_capture_queue {
+    const zmk_event_t **events;
+    uint32_t size;
+    // Free-running counters, slot (i % size) holds event i. Replayed slots are set to NULL.
+    uint32_t head;
+    uint32_t tail;
+    // The first event of the group being captured.
+    uint32_t group_start;
+    // Number of events that could not be captured because the buffer was full.
+    uint32_t overflows;
+};
+
+// The range of a group taken out of the queue for replay.
+struct zmk_event_capture_group {
+    uint32_t next;
+    uint32_t end;
+};
+
+#define ZMK_EVENT_CAPTURE_QUEUE_DEFINE(name, len)                                                  \
+    static const zmk_event_t *name##_events[len];                                                  \
+    static struct zmk_event_capture_queue name = {                                                 \
+        .events = name##_events,                                                                   \
+        .size = len,                                                                               \
+    };
+
+static inline const zmk_event_t *
+zmk_event_capture_queue_at(const struct zmk_event_capture_queue *queue, uint32_t i) {
+    return queue->events[i % queue->size];
+}
+
+// Events pushed from now on belong to a new group.
+static inline void zmk_event_capture_queue_start_group(struct zmk_event_capture_queue *queue) {
+    queue->group_start = queue->tail;
+}
+
+int zmk_event_capture_queue_push(struct zmk_event_capture_queue *queue, const zmk_event_t *event);
+struct zmk_event_capture_group
+zmk_event_capture_queue_take_group(struct zmk_event_capture_queue *queue);
+const zmk_event_t *zmk_event_capture_queue_next(struct zmk_event_capture_queue *queue,
+                                                struct zmk_event_capture_group *group);
 
 int zmk_event_manager_raise(zmk_event_t *event);
+int zmk_event_manager_raise_on_stack(zmk_event_t *event, size_t size);
 int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener);
 int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener);
 int zmk_event_manager_release(zmk_event_t *event);
\ No newline at end of file
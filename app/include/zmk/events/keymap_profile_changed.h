@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr.h>
+#include <zmk/event_manager.h>
+
+struct zmk_keymap_profile_changed {
+    uint8_t profile;
+    int64_t timestamp;
+};
+
+ZMK_EVENT_DECLARE(zmk_keymap_profile_changed);
+
+static inline int raise_keymap_profile_changed(uint8_t profile) {
+    return raise_zmk_keymap_profile_changed(
+        (struct zmk_keymap_profile_changed){.profile = profile, .timestamp = k_uptime_get()});
+}
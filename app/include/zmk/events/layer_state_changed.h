@@ -8,17 +8,39 @@
 
 #include <zephyr.h>
 #include <zmk/event_manager.h>
+#include <zmk/keymap.h>
 
 struct zmk_layer_state_changed {
+    // The layer that changed. When several layers change at once, such as for &to, this is the
+    // layer that caused it, and the masks below describe the full change.
     uint8_t layer;
     bool state;
+    zmk_keymap_layers_state_t previous_layer_state;
+    zmk_keymap_layers_state_t layer_state;
     int64_t timestamp;
 };
 
 ZMK_EVENT_DECLARE(zmk_layer_state_changed);
 
-static inline struct zmk_layer_state_changed_event *create_layer_state_changed(uint8_t layer,
-                                                                               bool state) {
-    return new_zmk_layer_state_changed((struct zmk_layer_state_changed){
-        .layer = layer, .state = state, .timestamp = k_uptime_get()});
+static inline struct zmk_layer_state_changed_event *
+create_layer_state_changed(uint8_t layer, bool state,
+                           zmk_keymap_layers_state_t previous_layer_state,
+                           zmk_keymap_layers_state_t layer_state) {
+    return new_zmk_layer_state_changed(
+        (struct zmk_layer_state_changed){.layer = layer,
+                                         .state = state,
+                                         .previous_layer_state = previous_layer_state,
+                                         .layer_state = layer_state,
+                                         .timestamp = k_uptime_get()});
+}
+
+static inline int raise_layer_state_changed(uint8_t layer, bool state,
+                                            zmk_keymap_layers_state_t previous_layer_state,
+                                            zmk_keymap_layers_state_t layer_state) {
+    return raise_zmk_layer_state_changed(
+        (struct zmk_layer_state_changed){.layer = layer,
+                                         .state = state,
+                                         .previous_layer_state = previous_layer_state,
+                                         .layer_state = layer_state,
+                                         .timestamp = k_uptime_get()});
 }
@@ -10,9 +10,11 @@
 #include <zmk/keys.h>
 #include <zmk/event_manager.h>
 
+// Raised once for each change of the reported modifiers, with every bit that changed at once.
+// Only raised with CONFIG_ZMK_HID_MODIFIERS_EVENTS, which listeners for it should select.
 struct zmk_modifiers_state_changed {
+    zmk_mod_flags_t previous_modifiers;
     zmk_mod_flags_t modifiers;
-    bool state;
 };
 
-ZMK_EVENT_DECLARE(zmk_modifiers_state_changed);
\ No newline at end of file
+ZMK_EVENT_DECLARE(zmk_modifiers_state_changed);
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr.h>
+#include <zmk/event_manager.h>
+
+// Raised on the central when a peripheral sends a new battery level.
+struct zmk_peripheral_battery_state_changed {
+    uint8_t source;
+    uint8_t state_of_charge;
+};
+
+ZMK_EVENT_DECLARE(zmk_peripheral_battery_state_changed);
@@ -9,9 +9,12 @@
 #include <zephyr.h>
 #include <zmk/event_manager.h>
 #include <device.h>
+#include <drivers/sensor.h>
 struct zmk_sensor_event {
     uint8_t sensor_number;
     const struct device *sensor;
+    // Value of the triggered channel, fetched when the event was raised
+    struct sensor_value value;
     int64_t timestamp;
 };
 
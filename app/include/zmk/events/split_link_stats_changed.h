@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr.h>
+#include <zmk/event_manager.h>
+
+// Raised on the central after each round-trip time measurement of a split link.
+struct zmk_split_link_stats_changed {
+    uint8_t source;
+    uint32_t rtt_us;
+};
+
+ZMK_EVENT_DECLARE(zmk_split_link_stats_changed);
\ No newline at end of file
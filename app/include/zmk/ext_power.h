@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <devicetree.h>
+#include <stdbool.h>
+
+// Users of the external power rail that tell it when they need power.
+enum zmk_ext_power_consumer {
+    ZMK_EXT_POWER_CONSUMER_DISPLAY,
+    ZMK_EXT_POWER_CONSUMER_UNDERGLOW,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE) && DT_HAS_COMPAT_STATUS_OKAY(zmk_ext_power_generic)
+
+/**
+ * Tell the external power rail whether `consumer` needs it. The rail is cut while no consumer
+ * needs it, and is only ever on while the user has external power turned on.
+ */
+void zmk_ext_power_claim(enum zmk_ext_power_consumer consumer, bool needed);
+
+#else
+
+#define zmk_ext_power_claim(consumer, needed)
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/util.h>
+
+/** Kinds of flight recorder records. */
+enum zmk_flight_record_type {
+    /** The firmware started. arg is the number of boots the recording spans. */
+    ZMK_FLIGHT_BOOT,
+    /** A transition read by the key scan. arg is the position, state whether it's pressed. */
+    ZMK_FLIGHT_POSITION,
+    /** A layer turned on or off. arg is the layer, state whether it's active. */
+    ZMK_FLIGHT_LAYER,
+    /** A keyboard report sent. arg is the negated error, state the endpoint. */
+    ZMK_FLIGHT_HID_KEYBOARD,
+    /** A consumer report sent. arg is the negated error, state the endpoint. */
+    ZMK_FLIGHT_HID_CONSUMER,
+    /** A BLE host connected, or failed to. arg is the HCI error. */
+    ZMK_FLIGHT_BLE_CONNECTED,
+    /** A BLE host disconnected. arg is the HCI reason. */
+    ZMK_FLIGHT_BLE_DISCONNECTED,
+    /** A work handler ran past the work watchdog's threshold. arg is the run time in ms. */
+    ZMK_FLIGHT_WORK_STALL,
+    ZMK_FLIGHT_RECORD_TYPE_COUNT,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_FLIGHT_RECORDER)
+
+/**
+ * Add a record with the current time to the flight recorder. Records are 8 bytes, written without
+ * formatting, and kept across warm resets.
+ */
+void zmk_flight_record(enum zmk_flight_record_type type, uint16_t arg, uint8_t state);
+
+#else
+
+static inline void zmk_flight_record(enum zmk_flight_record_type type, uint16_t arg,
+                                     uint8_t state) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_FLIGHT_RECORDER) */
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <sys/util.h>
 #include <usb/usb_device.h>
 #include <usb/class/usb_hid.h>
 
@@ -13,15 +14,34 @@
 #include <dt-bindings/zmk/hid_usage.h>
 #include <dt-bindings/zmk/hid_usage_pages.h>
 
-#define ZMK_HID_KEYBOARD_NKRO_MAX_USAGE HID_USAGE_KEY_KEYPAD_EQUAL
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_NKRO)
+#define ZMK_HID_KEYBOARD_NKRO_MAX_USAGE CONFIG_ZMK_HID_KEYBOARD_NKRO_MAX_USAGE
+// Constant bits filling the last byte of the NKRO bitmap.
+#define ZMK_HID_KEYBOARD_NKRO_PADDING ((8 - (ZMK_HID_KEYBOARD_NKRO_MAX_USAGE + 1) % 8) % 8)
+#endif
 
 #define COLLECTION_REPORT 0x03
+#define COLLECTION_LOGICAL 0x02
+
+#define ZMK_HID_REPORT_ID_KEYBOARD 0x01
+#define ZMK_HID_REPORT_ID_CONSUMER 0x02
+#define ZMK_HID_REPORT_ID_MOUSE 0x03
+
+#define ZMK_HID_MOUSE_BUTTONS 5
+/** Scroll units per wheel detent once the host enabled high resolution scrolling. */
+#define ZMK_HID_MOUSE_SCROLL_RESOLUTION 16
+
+// Items the Zephyr HID macros don't cover.
+#define ZMK_HID_USAGE16(usage) 0x0A, ((usage)&0xFF), (((usage) >> 8) & 0xFF)
+#define ZMK_HID_USAGE_PAGE16(page) 0x06, ((page)&0xFF), (((page) >> 8) & 0xFF)
+#define ZMK_HID_PHYSICAL_MIN8(a) 0x35, a
+#define ZMK_HID_PHYSICAL_MAX8(a) 0x45, a
 
 static const uint8_t zmk_hid_report_desc[] = {
     HID_USAGE_PAGE(HID_USAGE_GEN_DESKTOP),
     HID_USAGE(HID_USAGE_GD_KEYBOARD),
     HID_COLLECTION(HID_COLLECTION_APPLICATION),
-    HID_REPORT_ID(0x01),
+    HID_REPORT_ID(ZMK_HID_REPORT_ID_KEYBOARD),
     HID_USAGE_PAGE(HID_USAGE_KEY),
     HID_USAGE_MIN8(HID_USAGE_KEY_KEYBOARD_LEFTCONTROL),
     HID_USAGE_MAX8(HID_USAGE_KEY_KEYBOARD_RIGHT_GUI),
@@ -50,6 +70,11 @@ static const uint8_t zmk_hid_report_desc[] = {
     HID_REPORT_COUNT(ZMK_HID_KEYBOARD_NKRO_MAX_USAGE + 1),
     /* INPUT (Data,Ary,Abs) */
     HID_INPUT(0x02),
+#if ZMK_HID_KEYBOARD_NKRO_PADDING
+    HID_REPORT_COUNT(ZMK_HID_KEYBOARD_NKRO_PADDING),
+    /* INPUT (Cnst,Var,Abs) */
+    HID_INPUT(0x03),
+#endif
 #elif IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO)
     HID_LOGICAL_MIN8(0x00),
     HID_LOGICAL_MAX16(0xFF, 0x00),
@@ -67,7 +92,7 @@ static const uint8_t zmk_hid_report_desc[] = {
     HID_USAGE_PAGE(HID_USAGE_CONSUMER),
     HID_USAGE(HID_USAGE_CONSUMER_CONSUMER_CONTROL),
     HID_COLLECTION(HID_COLLECTION_APPLICATION),
-    HID_REPORT_ID(0x02),
+    HID_REPORT_ID(ZMK_HID_REPORT_ID_CONSUMER),
     HID_USAGE_PAGE(HID_USAGE_CONSUMER),
 
 #if IS_ENABLED(CONFIG_ZMK_HID_CONSUMER_REPORT_USAGES_BASIC)
@@ -89,20 +114,107 @@ static const uint8_t zmk_hid_report_desc[] = {
     /* INPUT (Data,Ary,Abs) */
     HID_INPUT(0x00),
     HID_END_COLLECTION,
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    HID_USAGE_PAGE(HID_USAGE_GD),
+    HID_USAGE(HID_USAGE_GD_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+    HID_REPORT_ID(ZMK_HID_REPORT_ID_MOUSE),
+    HID_USAGE(HID_USAGE_GD_POINTER),
+    HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+
+    HID_USAGE_PAGE(HID_USAGE_BUTTON),
+    HID_USAGE_MIN8(0x01),
+    HID_USAGE_MAX8(ZMK_HID_MOUSE_BUTTONS),
+    HID_LOGICAL_MIN8(0x00),
+    HID_LOGICAL_MAX8(0x01),
+    HID_REPORT_SIZE(0x01),
+    HID_REPORT_COUNT(ZMK_HID_MOUSE_BUTTONS),
+    /* INPUT (Data,Var,Abs) */
+    HID_INPUT(0x02),
+    HID_REPORT_SIZE(8 - ZMK_HID_MOUSE_BUTTONS),
+    HID_REPORT_COUNT(0x01),
+    /* INPUT (Cnst,Var,Abs) */
+    HID_INPUT(0x03),
+
+    HID_USAGE_PAGE(HID_USAGE_GD),
+    HID_USAGE(HID_USAGE_GD_X),
+    HID_USAGE(HID_USAGE_GD_Y),
+    HID_LOGICAL_MIN16(0x01, 0x80),
+    HID_LOGICAL_MAX16(0xFF, 0x7F),
+    HID_REPORT_SIZE(0x10),
+    HID_REPORT_COUNT(0x02),
+    /* INPUT (Data,Var,Rel) */
+    HID_INPUT(0x06),
+
+    // Each wheel has a resolution multiplier feature, which hosts that support high resolution
+    // scrolling set to ZMK_HID_MOUSE_SCROLL_RESOLUTION.
+    HID_COLLECTION(COLLECTION_LOGICAL),
+    HID_USAGE(HID_USAGE_GD_RESOLUTION_MULTIPLIER),
+    HID_LOGICAL_MIN8(0x00),
+    HID_LOGICAL_MAX8(0x01),
+    ZMK_HID_PHYSICAL_MIN8(0x01),
+    ZMK_HID_PHYSICAL_MAX8(ZMK_HID_MOUSE_SCROLL_RESOLUTION),
+    HID_REPORT_SIZE(0x02),
+    HID_REPORT_COUNT(0x01),
+    /* FEATURE (Data,Var,Abs) */
+    HID_FEATURE(0x02),
+    HID_USAGE(HID_USAGE_GD_WHEEL),
+    ZMK_HID_PHYSICAL_MIN8(0x00),
+    ZMK_HID_PHYSICAL_MAX8(0x00),
+    HID_LOGICAL_MIN16(0x01, 0x80),
+    HID_LOGICAL_MAX16(0xFF, 0x7F),
+    HID_REPORT_SIZE(0x10),
+    HID_REPORT_COUNT(0x01),
+    /* INPUT (Data,Var,Rel) */
+    HID_INPUT(0x06),
+    HID_END_COLLECTION,
+
+    HID_COLLECTION(COLLECTION_LOGICAL),
+    HID_USAGE(HID_USAGE_GD_RESOLUTION_MULTIPLIER),
+    HID_LOGICAL_MIN8(0x00),
+    HID_LOGICAL_MAX8(0x01),
+    ZMK_HID_PHYSICAL_MIN8(0x01),
+    ZMK_HID_PHYSICAL_MAX8(ZMK_HID_MOUSE_SCROLL_RESOLUTION),
+    HID_REPORT_SIZE(0x02),
+    HID_REPORT_COUNT(0x01),
+    /* FEATURE (Data,Var,Abs) */
+    HID_FEATURE(0x02),
+    HID_USAGE_PAGE(HID_USAGE_CONSUMER),
+    ZMK_HID_USAGE16(HID_USAGE_CONSUMER_AC_PAN),
+    ZMK_HID_PHYSICAL_MIN8(0x00),
+    ZMK_HID_PHYSICAL_MAX8(0x00),
+    HID_LOGICAL_MIN16(0x01, 0x80),
+    HID_LOGICAL_MAX16(0xFF, 0x7F),
+    HID_REPORT_SIZE(0x10),
+    HID_REPORT_COUNT(0x01),
+    /* INPUT (Data,Var,Rel) */
+    HID_INPUT(0x06),
+    HID_END_COLLECTION,
+
+    HID_REPORT_SIZE(0x04),
+    HID_REPORT_COUNT(0x01),
+    /* FEATURE (Cnst,Var,Abs) */
+    HID_FEATURE(0x03),
+
+    HID_END_COLLECTION,
+    HID_END_COLLECTION,
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
 };
 
-// struct zmk_hid_boot_report
-// {
-//     uint8_t modifiers;
-//     uint8_t _unused;
-//     uint8_t keys[6];
-// } __packed;
+#define ZMK_HID_BOOT_KEYS_LEN 6
+
+struct zmk_hid_boot_report {
+    zmk_mod_flags_t modifiers;
+    uint8_t _reserved;
+    uint8_t keys[ZMK_HID_BOOT_KEYS_LEN];
+} __packed;
 
 struct zmk_hid_keyboard_report_body {
     zmk_mod_flags_t modifiers;
     uint8_t _reserved;
 #if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_NKRO)
-    uint8_t keys[(ZMK_HID_KEYBOARD_NKRO_MAX_USAGE + 1) / 8];
+    uint8_t keys[DIV_ROUND_UP(ZMK_HID_KEYBOARD_NKRO_MAX_USAGE + 1, 8)];
 #elif IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO)
     uint8_t keys[CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE];
 #endif
@@ -126,6 +238,41 @@ struct zmk_hid_consumer_report {
     struct zmk_hid_consumer_report_body body;
 } __packed;
 
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+struct zmk_hid_mouse_report_body {
+    uint8_t buttons;
+    int16_t d_x;
+    int16_t d_y;
+    int16_t d_scroll_y;
+    int16_t d_scroll_x;
+} __packed;
+
+struct zmk_hid_mouse_report {
+    uint8_t report_id;
+    struct zmk_hid_mouse_report_body body;
+} __packed;
+
+/** Bits of the resolution multiplier feature report, one field per wheel. */
+#define ZMK_HID_MOUSE_MULTIPLIER_SCROLL_Y BIT(0)
+#define ZMK_HID_MOUSE_MULTIPLIER_SCROLL_X BIT(2)
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
+
+#if IS_ENABLED(CONFIG_ZMK_HID_MODIFIERS_EVENTS)
+/**
+ * Changes to the modifiers until the matching zmk_hid_modifiers_batch_end() raise a single
+ * zmk_modifiers_state_changed, instead of one for each call. Batches may nest.
+ */
+void zmk_hid_modifiers_batch_begin();
+/**
+ * @retval 1 if the outermost batch ended with different modifiers than it started with.
+ */
+int zmk_hid_modifiers_batch_end();
+#else
+// Nothing is raised without a listener, so there is nothing to batch.
+static inline void zmk_hid_modifiers_batch_begin() {}
+static inline int zmk_hid_modifiers_batch_end() { return 0; }
+#endif
+
 zmk_mod_flags_t zmk_hid_get_explicit_mods();
 int zmk_hid_register_mod(zmk_mod_t modifier);
 int zmk_hid_unregister_mod(zmk_mod_t modifier);
@@ -133,8 +280,12 @@ bool zmk_hid_mod_is_pressed(zmk_mod_t modifier);
 
 int zmk_hid_register_mods(zmk_mod_flags_t explicit_modifiers);
 int zmk_hid_unregister_mods(zmk_mod_flags_t explicit_modifiers);
-int zmk_hid_implicit_modifiers_press(zmk_mod_flags_t implicit_modifiers);
-int zmk_hid_implicit_modifiers_release();
+/**
+ * Applies the implicit modifiers of a newly pressed usage, replacing those of any key pressed
+ * before it. Only the release of that same usage clears them again.
+ */
+int zmk_hid_implicit_modifiers_press(uint32_t usage, zmk_mod_flags_t implicit_modifiers);
+int zmk_hid_implicit_modifiers_release(uint32_t usage);
 int zmk_hid_masked_modifiers_set(zmk_mod_flags_t masked_modifiers);
 int zmk_hid_masked_modifiers_clear();
 
@@ -154,3 +305,54 @@ bool zmk_hid_is_pressed(uint32_t usage);
 
 struct zmk_hid_keyboard_report *zmk_hid_get_keyboard_report();
 struct zmk_hid_consumer_report *zmk_hid_get_consumer_report();
+
+/**
+ * Whether going from `before` straight to `next` tells the host the same as going through
+ * `queued`, so a queue of reports waiting for the host can replace `queued` with `next`.
+ */
+bool zmk_hid_keyboard_report_can_skip(const struct zmk_hid_keyboard_report_body *before,
+                                      const struct zmk_hid_keyboard_report_body *queued,
+                                      const struct zmk_hid_keyboard_report_body *next);
+
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+/**
+ * The keyboard state in the boot protocol layout. If more keys are pressed than it holds, every key
+ * reports HID_USAGE_KEY_KEYBOARD_ERRORROLLOVER, as the boot protocol requires.
+ */
+struct zmk_hid_boot_report *zmk_hid_get_boot_report();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+/** Press mouse button `button`, counting from 0 for the left button. */
+int zmk_hid_mouse_button_press(uint8_t button);
+int zmk_hid_mouse_button_release(uint8_t button);
+
+/**
+ * Add motion to the accumulator. Motion is only taken from it when a report is sent, so calls
+ * between two reports are combined into one.
+ */
+void zmk_hid_mouse_movement_add(int32_t x, int32_t y);
+
+/**
+ * Add scrolling to the accumulator, in 1/ZMK_HID_MOUSE_SCROLL_RESOLUTION of a wheel detent. Hosts
+ * without high resolution scrolling get whole detents, with the rest kept for later reports.
+ */
+void zmk_hid_mouse_scroll_add(int32_t vertical, int32_t horizontal);
+
+uint8_t zmk_hid_mouse_get_buttons();
+
+/** Release every button and drop the accumulated motion. */
+void zmk_hid_mouse_clear();
+
+/**
+ * Fill `report` with the buttons and as much of the accumulated motion as fits, removing that
+ * motion from the accumulator.
+ *
+ * @retval true if the report changes anything for the host and should be sent.
+ */
+bool zmk_hid_mouse_take_report(struct zmk_hid_mouse_report *report);
+
+/** The resolution multiplier feature report, as last set by the host. */
+uint8_t zmk_hid_mouse_get_resolution_multipliers();
+void zmk_hid_mouse_set_resolution_multipliers(uint8_t multipliers);
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zmk/events/keycode_state_changed.h>
+
+/**
+ * Applies a keycode press or release and its modifiers to the HID reports and sends them, the
+ * same way the HID listener handles a keycode_state_changed event, so behaviors can send a key
+ * without raising an event for it.
+ *
+ * @returns 0 on success, or a negative error code.
+ */
+int zmk_hid_listener_apply(const struct zmk_keycode_state_changed *ev);
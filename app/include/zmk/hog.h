@@ -13,3 +13,18 @@ int zmk_hog_init();
 
 int zmk_hog_send_keyboard_report(struct zmk_hid_keyboard_report_body *body);
 int zmk_hog_send_consumer_report(struct zmk_hid_consumer_report_body *body);
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+/**
+ * Whether keyboard or consumer reports are queued, or a keyboard notification hasn't been sent yet.
+ */
+bool zmk_hog_reports_pending();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+/**
+ * Notifies the host of the motion accumulated so far. While a notification is in flight, motion
+ * is accumulated and sent once it completes, so at most one report goes out per connection event.
+ */
+int zmk_hog_send_mouse_report();
+#endif
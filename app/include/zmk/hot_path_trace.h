@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/atomic.h>
+#include <sys/util.h>
+
+struct device;
+
+/** Events on the key path that can be traced. */
+enum zmk_hot_path_id {
+    /** A transition read by the key scan. arg is the position, state whether it's pressed. */
+    ZMK_HOT_PATH_KSCAN,
+    /**
+     * A keymap binding invoked for a position. arg is the layer in the upper 16 bits and the
+     * position in the lower ones, state whether it's pressed.
+     */
+    ZMK_HOT_PATH_KEYMAP_BINDING,
+    /** A queued behavior invoked, e.g. by a macro. arg is the position, state whether pressed. */
+    ZMK_HOT_PATH_BEHAVIOR_QUEUE,
+    /**
+     * A HID report notified over BLE. arg is the error, state 0 for keyboard, 1 for consumer and 2
+     * for mouse.
+     */
+    ZMK_HOT_PATH_HOG_SEND,
+    /** Data sent over the split link. arg is the error or length, state the message type. */
+    ZMK_HOT_PATH_SPLIT_SEND,
+    ZMK_HOT_PATH_ID_COUNT,
+};
+
+/** Message types recorded for ZMK_HOT_PATH_SPLIT_SEND. These match the wired split types. */
+enum zmk_hot_path_split_msg {
+    ZMK_HOT_PATH_SPLIT_POSITION_EVENT = 1,
+    ZMK_HOT_PATH_SPLIT_POSITION_STATE = 2,
+    ZMK_HOT_PATH_SPLIT_RUN_BEHAVIOR = 3,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_HOT_PATH_TRACE)
+
+extern atomic_t zmk_hot_path_trace_enabled;
+
+void zmk_hot_path_trace_write(enum zmk_hot_path_id id, const struct device *dev, uint32_t arg,
+                              uint8_t state);
+
+/**
+ * Record a fixed size entry for a key path event, if tracing was turned on with the "hotpath"
+ * shell command. Devices are stored as indexes and only looked up when the trace is dumped.
+ */
+static inline void zmk_hot_path_trace(enum zmk_hot_path_id id, const struct device *dev,
+                                      uint32_t arg, uint8_t state) {
+    if (atomic_get(&zmk_hot_path_trace_enabled)) {
+        zmk_hot_path_trace_write(id, dev, arg, state);
+    }
+}
+
+#else
+
+static inline void zmk_hot_path_trace(enum zmk_hot_path_id id, const struct device *dev,
+                                      uint32_t arg, uint8_t state) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_HOT_PATH_TRACE) */
@@ -6,9 +6,56 @@
 
 #pragma once
 
+#include <devicetree.h>
 #include <zmk/events/position_state_changed.h>
 
+#if DT_HAS_COMPAT_STATUS_OKAY(zmk_keymap)
+#define ZMK_KEYMAP_LAYER_CHILD_LEN(node) 1 +
+#define ZMK_KEYMAP_LAYERS_LEN                                                                      \
+    (DT_FOREACH_CHILD(DT_INST(0, zmk_keymap), ZMK_KEYMAP_LAYER_CHILD_LEN) 0)
+// The keymap itself, followed by the other keymaps listed in its `profiles` property.
+#define ZMK_KEYMAP_PROFILES_LEN (1 + DT_PROP_LEN_OR(DT_INST(0, zmk_keymap), profiles, 0))
+#endif
+
+// Keymaps with more than 32 layers get a 64 bit layer mask, which still fits in a register pair so
+// the mask operations stay word-parallel.
+#if defined(ZMK_KEYMAP_LAYERS_LEN) && ZMK_KEYMAP_LAYERS_LEN > 32
+#if ZMK_KEYMAP_LAYERS_LEN > 64
+#error "ZMK supports at most 64 keymap layers"
+#endif
+typedef uint64_t zmk_keymap_layers_state_t;
+#else
 typedef uint32_t zmk_keymap_layers_state_t;
+#endif
+
+#define ZMK_KEYMAP_LAYER_BIT(layer) ((zmk_keymap_layers_state_t)1 << (layer))
+
+/**
+ * Get the highest layer set in a non-zero layer mask.
+ */
+static inline uint8_t zmk_keymap_layers_state_highest(zmk_keymap_layers_state_t state) {
+    if (sizeof(state) > sizeof(unsigned int)) {
+        return 63 - __builtin_clzll(state);
+    }
+    return 31 - __builtin_clz(state);
+}
+
+/**
+ * Get the lowest layer set in a non-zero layer mask.
+ */
+static inline uint8_t zmk_keymap_layers_state_lowest(zmk_keymap_layers_state_t state) {
+    if (sizeof(state) > sizeof(unsigned int)) {
+        return __builtin_ctzll(state);
+    }
+    return __builtin_ctz(state);
+}
+
+/**
+ * Get the mask of all layers at or below `layer`.
+ */
+static inline zmk_keymap_layers_state_t zmk_keymap_layers_at_or_below(uint8_t layer) {
+    return (ZMK_KEYMAP_LAYER_BIT(layer) - 1) | ZMK_KEYMAP_LAYER_BIT(layer);
+}
 
 uint8_t zmk_keymap_layer_default();
 zmk_keymap_layers_state_t zmk_keymap_layer_state();
@@ -18,8 +65,71 @@ int zmk_keymap_layer_activate(uint8_t layer);
 int zmk_keymap_layer_deactivate(uint8_t layer);
 int zmk_keymap_layer_toggle(uint8_t layer);
 int zmk_keymap_layer_to(uint8_t layer);
+/**
+ * Set the state of every layer at once. Only a single layer state changed event is raised, no
+ * matter how many layers change.
+ */
+int zmk_keymap_layer_state_set(zmk_keymap_layers_state_t layer_state);
 const char *zmk_keymap_layer_label(uint8_t layer);
 
+/**
+ * Get the index of the active keymap profile. Profile 0 is the keymap node itself.
+ */
+uint8_t zmk_keymap_profile();
+/**
+ * Switch every layer's bindings to those of another keymap profile. The layer state is kept and
+ * held keys are released from the profile they were pressed on. The choice is persisted to
+ * settings.
+ */
+int zmk_keymap_profile_select(uint8_t profile);
+
+struct zmk_behavior_binding;
+
+/** Longest behavior name a runtime edit can refer to, including the terminator. */
+#define ZMK_KEYMAP_BEHAVIOR_NAME_MAX 32
+
+/**
+ * Replace the binding at `position` on `layer` of the active profile until it is reset. The
+ * behavior is looked up by `binding->behavior_dev`. Changes are persisted to settings within
+ * CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE milliseconds, so a batch of edits is written once.
+ */
+int zmk_keymap_set_binding(uint8_t layer, uint32_t position,
+                           const struct zmk_behavior_binding *binding);
+/**
+ * Restore the devicetree binding at `position` on `layer` of the active profile.
+ */
+int zmk_keymap_reset_binding(uint8_t layer, uint32_t position);
+/**
+ * Restore every devicetree binding.
+ */
+int zmk_keymap_reset_bindings();
+
+/**
+ * Start staging whole layers of the active profile, dropping anything staged before. Nothing
+ * changes in the keymap until zmk_keymap_stage_commit(). Staging and committing must happen on the
+ * input work queue.
+ */
+void zmk_keymap_stage_begin();
+/**
+ * Stage the binding at `position` on `layer`. Bindings equal to the devicetree ones take no room.
+ *
+ * @retval -ENOMEM if more bindings differ from the keymap than CONFIG_ZMK_KEYMAP_RUNTIME_EDITS_MAX.
+ */
+int zmk_keymap_stage_binding(uint8_t layer, uint32_t position,
+                             const struct zmk_behavior_binding *binding);
+/**
+ * Replace every layer with a staged binding by the staged bindings in one step, and persist them
+ * with a single settings write. Every position of those layers must have been staged.
+ *
+ * @retval -ESTALE if the active profile changed since staging began.
+ * @retval -ENOMEM if the overlay has no room for the staged layers.
+ */
+int zmk_keymap_stage_commit();
+/**
+ * Drop everything staged.
+ */
+void zmk_keymap_stage_abort();
+
 int zmk_keymap_position_state_changed(uint8_t source, uint32_t position, bool pressed,
                                       int64_t timestamp);
 
@@ -6,4 +6,18 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 int zmk_kscan_init(char *name);
+
+/**
+ * Queue a position change from a split peripheral, to be raised in order with the local key
+ * transitions, with the timestamp given here. Each peripheral has a queue of its own, so one
+ * can't crowd out another. Safe to call from the Bluetooth receive thread.
+ */
+void zmk_kscan_queue_peripheral_position(uint8_t source, uint32_t position, bool pressed,
+                                         int64_t timestamp);
+
+// Number of position changes from the given peripheral waiting to be raised.
+uint32_t zmk_kscan_queued_peripheral_positions(uint8_t source);
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#if IS_ENABLED(CONFIG_ZMK_LATENCY_BENCHMARK)
+
+/** Start measuring from a position event read by the local key scan. */
+void zmk_latency_benchmark_position(uint32_t position, bool pressed);
+
+/** Count an event dispatched to its listeners. */
+void zmk_latency_benchmark_dispatch();
+
+/** Count an event allocation. `heap` is set if it didn't come from an event pool. */
+void zmk_latency_benchmark_alloc(bool heap);
+
+/** Log the measurements for a HID report that is about to be sent. */
+void zmk_latency_benchmark_report(uint16_t usage_page);
+
+#else
+
+static inline void zmk_latency_benchmark_position(uint32_t position, bool pressed) {}
+static inline void zmk_latency_benchmark_dispatch() {}
+static inline void zmk_latency_benchmark_alloc(bool heap) {}
+static inline void zmk_latency_benchmark_report(uint16_t usage_page) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_LATENCY_BENCHMARK) */
@@ -6,4 +6,16 @@
 
 #pragma once
 
-uint32_t zmk_matrix_transform_row_column_to_position(uint32_t row, uint32_t column);
\ No newline at end of file
+#include <stdint.h>
+
+uint32_t zmk_matrix_transform_row_column_to_position(uint32_t row, uint32_t column);
+
+/**
+ * Find the row and column this side's kscan reports for a keymap position, i.e. the reverse of
+ * zmk_matrix_transform_row_column_to_position().
+ *
+ * @retval -EINVAL if the position is past the keymap, or in the part of the matrix before the
+ * transform's row or column offset, such as keys on the other half of a split keyboard.
+ */
+int zmk_matrix_transform_position_to_row_column(uint32_t position, uint32_t *row,
+                                                uint32_t *column);
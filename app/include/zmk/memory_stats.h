@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+/** Fixed size queues whose peak usage is tracked, so their Kconfig sizes can be tuned. */
+enum zmk_memory_queue {
+    ZMK_MEMORY_QUEUE_KSCAN,
+    ZMK_MEMORY_QUEUE_BEHAVIORS,
+    ZMK_MEMORY_QUEUE_HOG_KEYBOARD,
+    ZMK_MEMORY_QUEUE_HOG_CONSUMER,
+    ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_POSITION,
+    ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_RUN,
+    ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_STATE,
+    ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_EVENT,
+    ZMK_MEMORY_QUEUE_SPLIT_WIRED_TX,
+    ZMK_MEMORY_QUEUE_SPLIT_WIRED_RX,
+    ZMK_MEMORY_QUEUE_DEFERRED_EVENTS,
+    ZMK_MEMORY_QUEUE_COUNT,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_MEMORY_STATS)
+
+/** Note that `used` of the `capacity` entries of a queue are in use. */
+void zmk_memory_stats_queue_used(enum zmk_memory_queue queue, uint32_t used, uint32_t capacity);
+
+/** Note that `size` bytes were allocated from the heap. */
+void zmk_memory_stats_heap_allocated(size_t size);
+
+/** Note that `size` bytes allocated with zmk_memory_stats_heap_allocated() were freed. */
+void zmk_memory_stats_heap_freed(size_t size);
+
+/** Note the current usage of a message queue, after putting a message in it. */
+static inline void zmk_memory_stats_msgq(enum zmk_memory_queue queue, struct k_msgq *msgq) {
+    zmk_memory_stats_queue_used(queue, k_msgq_num_used_get(msgq), msgq->max_msgs);
+}
+
+/** Note the current usage of a memory slab, after allocating from it. */
+static inline void zmk_memory_stats_slab(enum zmk_memory_queue queue, struct k_mem_slab *slab) {
+    zmk_memory_stats_queue_used(queue, k_mem_slab_num_used_get(slab), slab->num_blocks);
+}
+
+#else
+
+static inline void zmk_memory_stats_queue_used(enum zmk_memory_queue queue, uint32_t used,
+                                               uint32_t capacity) {}
+static inline void zmk_memory_stats_heap_allocated(size_t size) {}
+static inline void zmk_memory_stats_heap_freed(size_t size) {}
+static inline void zmk_memory_stats_msgq(enum zmk_memory_queue queue, struct k_msgq *msgq) {}
+static inline void zmk_memory_stats_slab(enum zmk_memory_queue queue, struct k_mem_slab *slab) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_MEMORY_STATS) */
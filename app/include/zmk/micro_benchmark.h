@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/util.h>
+
+#if IS_ENABLED(CONFIG_ZMK_MICRO_BENCHMARK)
+
+/** Count an event allocation against the benchmark that is running, if any. */
+void zmk_micro_benchmark_alloc();
+
+/**
+ * Times `iterations` calls of `op`, passing the iteration number, and logs the time and event
+ * allocations per call.
+ */
+void zmk_micro_benchmark_run(const char *name, void (*op)(uint32_t i), uint32_t iterations);
+
+/** Runs the debounce_update and debounce_word_update benchmarks. */
+void zmk_micro_benchmark_debounce(uint32_t iterations);
+
+#else
+
+static inline void zmk_micro_benchmark_alloc() {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_MICRO_BENCHMARK) */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/types.h>
+
+/** How a held mouse key speeds up. */
+struct zmk_mouse_keys_curve {
+    /** Milliseconds from the press until the key reaches its full speed. */
+    uint16_t time_to_max_speed_ms;
+    /**
+     * The speed follows the held time to this power. 0 goes straight to full speed, 1 speeds up
+     * evenly and higher values start slower.
+     */
+    uint8_t acceleration_exponent;
+};
+
+enum zmk_mouse_keys_type {
+    ZMK_MOUSE_KEYS_MOVE,
+    ZMK_MOUSE_KEYS_SCROLL,
+};
+
+/**
+ * Start moving the pointer, or scrolling, for the mouse key held at `position`. `x` and `y` are the
+ * full speed in pixels or wheel detents per second. Every held mouse key is applied on one shared
+ * tick, which sends a single mouse report with their combined motion.
+ */
+int zmk_mouse_keys_start(uint32_t position, enum zmk_mouse_keys_type type, int16_t x, int16_t y,
+                         const struct zmk_mouse_keys_curve *curve, int64_t timestamp);
+
+/** Stop the motion started by the mouse key held at `position`. */
+int zmk_mouse_keys_stop(uint32_t position, enum zmk_mouse_keys_type type);
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+/** Queues between the key scan and the keymap that drop events when they are full. */
+enum zmk_pipeline_queue {
+    /** Transitions read by the key scan, waiting to be processed. */
+    ZMK_PIPELINE_KSCAN_QUEUE,
+    /** Events received from split peripherals, waiting to be processed by the central. */
+    ZMK_PIPELINE_SPLIT_QUEUE,
+    /** Events captured by hold-taps, combos and other behaviors that delay them. */
+    ZMK_PIPELINE_CAPTURE_QUEUE,
+    ZMK_PIPELINE_QUEUE_COUNT,
+};
+
+/** Peaks and totals since boot. */
+struct zmk_pipeline_stats {
+    uint32_t peak_depth[ZMK_PIPELINE_QUEUE_COUNT];
+    uint32_t dropped[ZMK_PIPELINE_QUEUE_COUNT];
+    uint32_t peak_heap_events;
+    uint32_t alloc_failures;
+    uint32_t worst_latency_ms;
+};
+
+#if IS_ENABLED(CONFIG_ZMK_PIPELINE_STATS)
+
+/** Note that an event was queued, leaving `depth` events in the queue. */
+void zmk_pipeline_stats_queued(enum zmk_pipeline_queue queue, uint32_t depth);
+
+/** Note that an event was dropped because the queue was full. */
+void zmk_pipeline_stats_dropped(enum zmk_pipeline_queue queue);
+
+/** Note that an event was allocated. `heap` is set if it didn't come from an event pool. */
+void zmk_pipeline_stats_event_allocated(bool heap);
+
+/** Note that an event allocated with zmk_pipeline_stats_event_allocated() was freed. */
+void zmk_pipeline_stats_event_freed(bool heap);
+
+/** Note that an event could not be allocated. */
+void zmk_pipeline_stats_event_alloc_failed();
+
+/** Note that a key transition read at `timestamp` is done being processed. */
+void zmk_pipeline_stats_processed(int64_t timestamp);
+
+/** Note that a keycode was pressed or released in the reports sent to the host. */
+void zmk_pipeline_stats_keycode(uint16_t usage_page, uint32_t keycode, bool pressed);
+
+/** Copy the current stats. Each value is read atomically, but not all of them at once. */
+void zmk_pipeline_stats_get(struct zmk_pipeline_stats *stats);
+
+/**
+ * Log the peak queue depths, dropped events, peak heap usage, worst processing latency, and the
+ * keycodes that weren't released or were released without being pressed.
+ */
+void zmk_pipeline_stats_log();
+
+#else
+
+static inline void zmk_pipeline_stats_queued(enum zmk_pipeline_queue queue, uint32_t depth) {}
+static inline void zmk_pipeline_stats_dropped(enum zmk_pipeline_queue queue) {}
+static inline void zmk_pipeline_stats_event_allocated(bool heap) {}
+static inline void zmk_pipeline_stats_event_freed(bool heap) {}
+static inline void zmk_pipeline_stats_event_alloc_failed() {}
+static inline void zmk_pipeline_stats_processed(int64_t timestamp) {}
+static inline void zmk_pipeline_stats_keycode(uint16_t usage_page, uint32_t keycode,
+                                              bool pressed) {}
+static inline void zmk_pipeline_stats_log() {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_PIPELINE_STATS) */
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/types.h>
+
+/**
+ * Add motion from a pointing device, already scaled for that device, to the mouse report. The
+ * current layers decide whether it moves the pointer, scrolls or moves the pointer slowly. Safe to
+ * call from any thread; motion is applied on the input work queue.
+ */
+void zmk_pointing_motion_received(int16_t dx, int16_t dy);
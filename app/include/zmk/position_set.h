@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <zmk/matrix.h>
+
+#define ZMK_POSITION_SET_WORDS DIV_ROUND_UP(ZMK_KEYMAP_LEN, 32)
+
+// A set of key positions, one bit per position in the keymap. Positions outside the keymap (e.g.
+// combo virtual key positions) are never members.
+struct zmk_position_set {
+    uint32_t words[ZMK_POSITION_SET_WORDS];
+};
+
+static inline bool zmk_position_set_test(const struct zmk_position_set *set, uint32_t position) {
+    return position < ZMK_KEYMAP_LEN && (set->words[position / 32] & BIT(position % 32)) != 0;
+}
+
+static inline void zmk_position_set_add(struct zmk_position_set *set, uint32_t position) {
+    if (position < ZMK_KEYMAP_LEN) {
+        set->words[position / 32] |= BIT(position % 32);
+    }
+}
+
+static inline void zmk_position_set_remove(struct zmk_position_set *set, uint32_t position) {
+    if (position < ZMK_KEYMAP_LEN) {
+        set->words[position / 32] &= ~BIT(position % 32);
+    }
+}
+
+static inline void zmk_position_set_clear(struct zmk_position_set *set) {
+    for (int i = 0; i < ZMK_POSITION_SET_WORDS; i++) {
+        set->words[i] = 0;
+    }
+}
+
+// Returns true if every position in `subset` is also in `set`.
+static inline bool zmk_position_set_contains(const struct zmk_position_set *set,
+                                             const struct zmk_position_set *subset) {
+    for (int i = 0; i < ZMK_POSITION_SET_WORDS; i++) {
+        if ((set->words[i] & subset->words[i]) != subset->words[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds each position of a devicetree position list, e.g. the combo key-positions property.
+static inline void zmk_position_set_add_list(struct zmk_position_set *set, const int32_t *positions,
+                                             size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (positions[i] >= 0) {
+            zmk_position_set_add(set, positions[i]);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <devicetree.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <zmk/matrix.h>
+
+#define ZMK_COMBOS_NODE DT_INST(0, zmk_combos)
+
+#if DT_NODE_HAS_STATUS(ZMK_COMBOS_NODE, okay)
+#define Z_ZMK_COMBO_COUNT(n) +1
+#define ZMK_COMBOS_LEN (0 DT_FOREACH_CHILD(ZMK_COMBOS_NODE, Z_ZMK_COMBO_COUNT))
+#else
+#define ZMK_COMBOS_LEN 0
+#endif
+
+// Key positions, followed by one combo virtual key position per combo.
+#define ZMK_POSITION_SLOTS_LEN (ZMK_KEYMAP_LEN + ZMK_COMBOS_LEN)
+
+// Maps each position to the slot of the active behavior instance on it, so behaviors with a small
+// array of active instances can find the one on a position without scanning the array.
+struct zmk_position_slots {
+    // The slot + 1 of each position, or 0 if nothing is active on it.
+    uint8_t slots[ZMK_POSITION_SLOTS_LEN];
+};
+
+/**
+ * Get the slot active on `position`.
+ *
+ * @retval -ENOENT if nothing is active on the position.
+ * @retval -ERANGE if the position is past the map, in which case the caller has to search itself.
+ */
+static inline int zmk_position_slots_get(const struct zmk_position_slots *map, uint32_t position) {
+    if (position >= ZMK_POSITION_SLOTS_LEN) {
+        return -ERANGE;
+    }
+    return map->slots[position] == 0 ? -ENOENT : map->slots[position] - 1;
+}
+
+static inline void zmk_position_slots_set(struct zmk_position_slots *map, uint32_t position,
+                                          uint8_t slot) {
+    if (position < ZMK_POSITION_SLOTS_LEN) {
+        map->slots[position] = slot + 1;
+    }
+}
+
+// Clears `position` if `slot` is still the one mapped to it. A newer instance on the same position
+// keeps its entry when an older one finishes.
+static inline void zmk_position_slots_clear(struct zmk_position_slots *map, uint32_t position,
+                                            uint8_t slot) {
+    if (position < ZMK_POSITION_SLOTS_LEN && map->slots[position] == slot + 1) {
+        map->slots[position] = 0;
+    }
+}
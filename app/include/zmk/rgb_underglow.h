@@ -26,4 +26,9 @@ int zmk_rgb_underglow_change_hue(int direction);
 int zmk_rgb_underglow_change_sat(int direction);
 int zmk_rgb_underglow_change_brt(int direction);
 int zmk_rgb_underglow_change_spd(int direction);
-int zmk_rgb_underglow_set_hsb(struct zmk_led_hsb color);
\ No newline at end of file
+int zmk_rgb_underglow_set_hsb(struct zmk_led_hsb color);
+
+// The color, effect and speed packed into the low 30 bits of a behavior parameter, so split
+// peripherals can be brought up to date with one invocation.
+uint32_t zmk_rgb_underglow_get_sync_state();
+int zmk_rgb_underglow_apply_sync_state(uint32_t sync_state);
\ No newline at end of file
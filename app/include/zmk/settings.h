@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <settings/settings.h>
+#include <sys/slist.h>
+
+/**
+ * A group of settings that is written to storage by a single function. Define one with
+ * ZMK_SETTINGS_SAVE_DEFINE and pass it to zmk_settings_save() whenever its values change.
+ */
+struct zmk_settings_save {
+    sys_snode_t node;
+    /** Writes the current values with settings_save_one() or settings_delete(). */
+    void (*save)();
+    /** Set while the entry is waiting for the next write. */
+    bool pending;
+};
+
+#define ZMK_SETTINGS_SAVE_DEFINE(name, save_fn)                                                    \
+    static struct zmk_settings_save name = {.save = save_fn}
+
+/**
+ * Mark an entry as changed. Every pending entry is written in one pass on a low priority thread,
+ * at most CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE milliseconds after the first of them changed. With
+ * CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE, a pass that would start while typing waits for the keyboard
+ * to go idle or to sleep instead.
+ */
+int zmk_settings_save(struct zmk_settings_save *entry);
+
+/**
+ * A settings subtree that isn't needed to start typing, such as lighting state. Define one with
+ * ZMK_SETTINGS_DEFERRED_LOAD_DEFINE and pass it to zmk_settings_load_deferred() during init.
+ */
+struct zmk_settings_deferred_load {
+    sys_snode_t node;
+    const char *subtree;
+    /** Called for each value in the subtree, with the name relative to it. */
+    settings_load_direct_cb set;
+    /** Called once the subtree is loaded, even if it was empty, to apply the values. */
+    void (*loaded)();
+};
+
+#define ZMK_SETTINGS_DEFERRED_LOAD_DEFINE(name, _subtree, set_fn, loaded_fn)                       \
+    static struct zmk_settings_deferred_load name = {                                              \
+        .subtree = _subtree, .set = set_fn, .loaded = loaded_fn}
+
+/**
+ * Load every statically registered settings handler in a single pass. Subtrees queued with
+ * zmk_settings_load_deferred() are loaded afterwards on the low priority settings thread.
+ *
+ * This is called once Bluetooth is enabled, or during init if Bluetooth isn't used. Later calls
+ * do nothing.
+ */
+int zmk_settings_load();
+
+/**
+ * Load a subtree on the low priority settings thread once the settings needed at boot are loaded.
+ */
+void zmk_settings_load_deferred(struct zmk_settings_deferred_load *entry);
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/types.h>
+
+// Returned by zmk_split_bt_behavior_id() for behaviors that aren't in the table.
+#define ZMK_SPLIT_BEHAVIOR_ID_NONE UINT8_MAX
+
+// Both halves number the behaviors in the devicetree `behaviors` and `macros` nodes in the same
+// order. Run behavior writes can then name a behavior with one byte, as long as both halves agree
+// on the table, which the central checks by comparing table hashes.
+uint8_t zmk_split_bt_behavior_id(const char *label);
+const char *zmk_split_bt_behavior_label(uint8_t id);
+uint32_t zmk_split_bt_behavior_table_hash();
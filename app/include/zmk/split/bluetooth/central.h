@@ -5,4 +5,37 @@
 #include <zmk/behavior.h>
 
 int zmk_split_bt_invoke_behavior(uint8_t source, struct zmk_behavior_binding *binding,
-                                 struct zmk_behavior_binding_event event, bool state);
\ No newline at end of file
+                                 struct zmk_behavior_binding_event event, bool state);
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY)
+
+/**
+ * The last battery state of charge the peripheral in `source` sent, or 0 if it hasn't sent one
+ * since it connected.
+ */
+uint8_t zmk_split_bt_peripheral_battery_level(uint8_t source);
+
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+
+// Latency of the link to one peripheral, since it was first connected or the stats were reset.
+struct zmk_split_bt_link_stats {
+    // Round trips of a GATT read of the position state, measured periodically.
+    uint32_t rtt_count;
+    uint32_t rtt_last_us;
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+    uint64_t rtt_total_us;
+    // Milliseconds from a key changing on the peripheral until its position event is raised.
+    uint32_t event_count;
+    uint32_t event_age_max_ms;
+    uint64_t event_age_total_ms;
+    // Most transitions waiting to be raised at once, counting the local ones sharing the queue.
+    uint32_t queue_depth_max;
+};
+
+const struct zmk_split_bt_link_stats *zmk_split_bt_link_stats(uint8_t source);
+void zmk_split_bt_link_stats_reset();
+
+#endif
@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <zephyr/types.h>
+#include <sys/util.h>
+
 #define ZMK_SPLIT_RUN_BEHAVIOR_DEV_LEN 9
 
 struct zmk_split_run_behavior_data {
@@ -20,5 +23,70 @@ struct zmk_split_run_behavior_payload {
     char behavior_dev[ZMK_SPLIT_RUN_BEHAVIOR_DEV_LEN];
 } __packed;
 
+// A run behavior invocation that names the behavior by its id from
+// <zmk/split/bluetooth/behavior_ids.h>. One write can carry several of these back to back.
+struct zmk_split_run_behavior_id_data {
+    uint8_t behavior_id;
+    struct zmk_split_run_behavior_data data;
+} __packed;
+
+// The most invocations the central puts in one write, if the ATT MTU allows.
+#define ZMK_SPLIT_RUN_BEHAVIOR_IDS_PER_WRITE 5
+
+#define ZMK_SPLIT_POSITION_EVENT_PRESSED BIT(0)
+// The peripheral dropped events, so the central should read the position state to catch up.
+#define ZMK_SPLIT_POSITION_EVENT_RESYNC BIT(1)
+
+// Position events notifications carry up to this many events, which fits the default ATT MTU.
+#define ZMK_SPLIT_POSITION_EVENTS_PER_NOTIFY 5
+
+// Used as the position of a sensor event, so centrals that predate sensor events drop it as an
+// invalid position. The flags then hold the sensor number above the low two bits, which stay clear
+// so such a central doesn't take it for a resync either.
+#define ZMK_SPLIT_POSITION_EVENT_SENSOR 0xFF
+#define ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT 2
+#define ZMK_SPLIT_SENSOR_EVENT_MAX_NUMBER ((UINT8_MAX >> ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT) - 1)
+// The last sensor number carries the peripheral's battery state of charge in val1. No keymap has
+// that many sensors, so centrals that predate it drop it as an invalid sensor.
+#define ZMK_SPLIT_SENSOR_EVENT_BATTERY (ZMK_SPLIT_SENSOR_EVENT_MAX_NUMBER + 1)
+
+// One key position change or sensor trigger, in the order they happened.
+struct zmk_split_position_event {
+    uint8_t position;
+    uint8_t flags;
+    union {
+        // Milliseconds from the change until the notification was sent, saturated at UINT16_MAX.
+        uint16_t age;
+        // The sensor's value for sensor events, each part saturated to fit.
+        struct {
+            int8_t val1;
+            int8_t val2;
+        } sensor_value;
+    };
+} __packed;
+
+// Pointing device motion the peripheral gathered since its last notification, saturated to fit.
+struct zmk_split_pointing_motion {
+    int16_t dx;
+    int16_t dy;
+} __packed;
+
 int zmk_split_bt_position_pressed(uint8_t position);
-int zmk_split_bt_position_released(uint8_t position);
\ No newline at end of file
+int zmk_split_bt_position_released(uint8_t position);
+
+struct sensor_value;
+
+int zmk_split_bt_sensor_triggered(uint8_t sensor_number, const struct sensor_value *value);
+
+/**
+ * Send the peripheral's battery state of charge to the central. It goes out with the next position
+ * events notification, or on its own once CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY_MAX_DELAY has
+ * passed without one.
+ */
+int zmk_split_bt_battery_level(uint8_t state_of_charge);
+
+/**
+ * Add pointing device motion to send to the central. Motion added while a notification is in
+ * flight is sent together in the next one.
+ */
+int zmk_split_bt_pointing_motion(int16_t dx, int16_t dy);
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Whether the peripheral that owns `position` runs the event source behaviors bound to it itself,
+ * so the central must not send them back. False for positions used by combos, since the central
+ * may turn those presses into something else.
+ */
+bool zmk_split_event_source_runs_on_peripheral(uint32_t position);
+
+/** Set the central's layer state, including its default layer, on a peripheral. */
+void zmk_split_event_source_set_layer_state(uint32_t layer_state);
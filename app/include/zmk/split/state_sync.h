@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+
+/**
+ * Mirrors a behavior's state on the split peripherals. Instead of every invocation being replayed
+ * on them, the central sends its whole state as one invocation of the behavior, with `command` as
+ * the first parameter and the packed state from `get_state` as the second. Changes are coalesced
+ * to at most one invocation every CONFIG_ZMK_SPLIT_STATE_SYNC_INTERVAL_MS.
+ */
+struct zmk_split_state_sync {
+    struct k_work_delayable work;
+    const char *behavior_dev;
+    uint32_t command;
+    uint32_t (*get_state)();
+    int64_t last_sync;
+};
+
+void zmk_split_state_sync_work_handler(struct k_work *work);
+
+#define ZMK_SPLIT_STATE_SYNC_DEFINE(name, dev, cmd, get_state_fn)                                  \
+    static struct zmk_split_state_sync name = {                                                    \
+        .work = Z_WORK_DELAYABLE_INITIALIZER(zmk_split_state_sync_work_handler),                   \
+        .behavior_dev = dev,                                                                       \
+        .command = cmd,                                                                            \
+        .get_state = get_state_fn,                                                                 \
+    }
+
+/** Schedule sending the behavior's state to every peripheral. */
+void zmk_split_state_sync_changed(struct zmk_split_state_sync *sync);
+
+/** Send the behavior's state to every peripheral without waiting out the interval. */
+void zmk_split_state_sync_now(struct zmk_split_state_sync *sync);
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zmk/behavior.h>
+
+// A wired split has a single peripheral, at source 0.
+#define ZMK_SPLIT_WIRED_PERIPHERAL_COUNT 1
+
+int zmk_split_wired_invoke_behavior(uint8_t source, struct zmk_behavior_binding *binding,
+                                    struct zmk_behavior_binding_event event, bool state);
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <zephyr/types.h>
+
+// Messages between the halves of a wired split. Each goes over the UART as one frame: a sync
+// byte, the type, the payload length, the payload and a CRC-16/CCITT of everything after the sync
+// byte, so a receiver that lost bytes drops the damaged frame and finds the next sync byte.
+enum zmk_split_wired_msg_type {
+    // Peripheral to central: one key position change, a struct zmk_split_wired_position_event.
+    ZMK_SPLIT_WIRED_MSG_POSITION_EVENT = 1,
+    // Peripheral to central: the whole position state bitmap, sent periodically so the central
+    // can catch up on lost events and knows the peripheral is still there.
+    ZMK_SPLIT_WIRED_MSG_POSITION_STATE = 2,
+    // Central to peripheral: a struct zmk_split_wired_run_behavior.
+    ZMK_SPLIT_WIRED_MSG_RUN_BEHAVIOR = 3,
+};
+
+#define ZMK_SPLIT_WIRED_MAX_PAYLOAD 32
+
+#define ZMK_SPLIT_WIRED_BEHAVIOR_DEV_LEN 16
+
+struct zmk_split_wired_position_event {
+    uint8_t position;
+    uint8_t pressed;
+} __packed;
+
+struct zmk_split_wired_run_behavior {
+    uint8_t position;
+    uint8_t state;
+    uint32_t param1;
+    uint32_t param2;
+    char behavior_dev[ZMK_SPLIT_WIRED_BEHAVIOR_DEV_LEN];
+} __packed;
+
+struct zmk_split_wired_msg {
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[ZMK_SPLIT_WIRED_MAX_PAYLOAD];
+};
+
+typedef void (*zmk_split_wired_rx_cb)(const struct zmk_split_wired_msg *msg);
+
+// Starts receiving on the split UART. Each valid message is passed to rx_cb on rx_queue.
+int zmk_split_wired_link_init(struct k_work_q *rx_queue, zmk_split_wired_rx_cb rx_cb);
+
+// Queues a message to send. Never blocks, returns -ENOMSG if the transmit queue is full.
+int zmk_split_wired_send(uint8_t type, const void *payload, uint8_t len);
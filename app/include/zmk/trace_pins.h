@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <sys/util.h>
+
+/** Points on the key path with a GPIO in the zmk,trace-pins node. */
+enum zmk_trace_pin {
+    ZMK_TRACE_PIN_KSCAN,
+    ZMK_TRACE_PIN_POSITION,
+    ZMK_TRACE_PIN_REPORT,
+    ZMK_TRACE_PIN_NOTIFY,
+    ZMK_TRACE_PIN_COUNT,
+};
+
+#if IS_ENABLED(CONFIG_ZMK_TRACE_PINS)
+
+/** Toggle the GPIO for a point on the key path, if the devicetree assigned one. */
+void zmk_trace_pin_toggle(enum zmk_trace_pin pin);
+
+#else
+
+static inline void zmk_trace_pin_toggle(enum zmk_trace_pin pin) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_TRACE_PINS) */
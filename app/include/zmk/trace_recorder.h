@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#if IS_ENABLED(CONFIG_ZMK_TRACE_RECORDER)
+
+/** Record a key transition read by the key scan, if recording is started. */
+void zmk_trace_recorder_record(uint32_t row, uint32_t column, bool pressed, int64_t timestamp);
+
+#else
+
+static inline void zmk_trace_recorder_record(uint32_t row, uint32_t column, bool pressed,
+                                             int64_t timestamp) {}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_TRACE_RECORDER) */
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+#include <sys/atomic.h>
+
+typedef int (*zmk_tx_queue_start_t)(const void *msg);
+
+/**
+ * Sends the messages of a queue one at a time, through a driver that only takes one transfer at a
+ * time, such as a UART or a HID endpoint. Messages can be queued and sent from any context.
+ */
+struct zmk_tx_queue {
+    struct k_msgq *msgq;
+    // The message being sent. The driver reads from it until the transfer is done.
+    void *msg;
+    // Starts the transfer of msg. A message it fails to start is dropped.
+    zmk_tx_queue_start_t start;
+    atomic_t busy;
+};
+
+#define ZMK_TX_QUEUE_INITIALIZER(_msgq, _msg, _start)                                              \
+    {.msgq = _msgq, .msg = _msg, .start = _start}
+
+/**
+ * Starts sending the next queued message, unless a transfer is already in progress.
+ */
+void zmk_tx_queue_send_next(struct zmk_tx_queue *queue);
+
+/**
+ * Marks the transfer in progress as done, and starts sending the next queued message.
+ */
+void zmk_tx_queue_done(struct zmk_tx_queue *queue);
@@ -6,4 +6,48 @@
 
 #pragma once
 
-int zmk_usb_hid_send_report(const uint8_t *report, size_t len);
\ No newline at end of file
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <zmk/hid.h>
+
+/**
+ * Sends the report, or queues it if the host hasn't picked up the previous report yet. Never blocks
+ * the caller.
+ */
+int zmk_usb_hid_send_report(const uint8_t *report, size_t len);
+
+/**
+ * Sends the keyboard report like zmk_usb_hid_send_report, or the boot report built from the same
+ * state while the host uses the boot protocol.
+ */
+int zmk_usb_hid_send_keyboard_report(const struct zmk_hid_keyboard_report *report);
+
+/**
+ * Drops the queued reports, for when the host resets or reconfigures the device and the transfer in
+ * flight will never complete. The device returns to the report protocol, as a reset requires.
+ */
+void zmk_usb_hid_reset_queue();
+
+/**
+ * Tracks the host suspending and resuming the bus. Reports sent while suspended ask the host to
+ * wake up and are queued, then sent once it resumes.
+ */
+void zmk_usb_hid_set_suspended(bool suspended);
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+/**
+ * Whether keyboard or consumer reports are queued or waiting for the host to pick them up.
+ */
+bool zmk_usb_hid_reports_pending();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+/**
+ * Sends a mouse report with the motion accumulated so far once the host picked up the previous
+ * report. Motion added before then goes out in the same report.
+ */
+int zmk_usb_hid_send_mouse_report();
+#endif
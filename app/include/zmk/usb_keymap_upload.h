@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <zmk/keymap.h>
+
+#define ZMK_USB_KEYMAP_UPLOAD_USAGE_PAGE 0xFF60
+#define ZMK_USB_KEYMAP_UPLOAD_USAGE 0x62
+
+/** Size of every request, sent as an output report with SET_REPORT. */
+#define ZMK_USB_KEYMAP_UPLOAD_REQUEST_SIZE 64
+
+enum zmk_usb_keymap_upload_command {
+    /** Drop anything staged and start staging layers of the active profile. */
+    ZMK_USB_KEYMAP_UPLOAD_BEGIN = 1,
+    /** Give the behavior that later bindings refer to by an index its name. */
+    ZMK_USB_KEYMAP_UPLOAD_BEHAVIOR = 2,
+    /** Stage consecutive bindings of a layer. */
+    ZMK_USB_KEYMAP_UPLOAD_BINDINGS = 3,
+    /** Replace the staged layers in the keymap, and write them to flash once. */
+    ZMK_USB_KEYMAP_UPLOAD_COMMIT = 4,
+    /** Drop anything staged. */
+    ZMK_USB_KEYMAP_UPLOAD_ABORT = 5,
+};
+
+struct zmk_usb_keymap_upload_binding {
+    /** Index given with ZMK_USB_KEYMAP_UPLOAD_BEHAVIOR. */
+    uint8_t behavior;
+    uint32_t param1;
+    uint32_t param2;
+} __packed;
+
+#define ZMK_USB_KEYMAP_UPLOAD_BINDINGS_MAX 6
+
+/**
+ * One request. Fields are little endian. Any failed request aborts the upload, so the host has to
+ * start over with ZMK_USB_KEYMAP_UPLOAD_BEGIN.
+ */
+struct zmk_usb_keymap_upload_request {
+    /** An enum zmk_usb_keymap_upload_command. */
+    uint8_t command;
+    /** Echoed in the response, so the host can match them up. */
+    uint8_t sequence;
+    union {
+        struct {
+            uint8_t index;
+            /** NUL terminated, at most ZMK_KEYMAP_BEHAVIOR_NAME_MAX - 1 characters. */
+            char name[ZMK_USB_KEYMAP_UPLOAD_REQUEST_SIZE - 3];
+        } behavior;
+        struct {
+            uint8_t layer;
+            /** Position of the first binding. */
+            uint16_t position;
+            uint8_t count;
+            struct zmk_usb_keymap_upload_binding bindings[ZMK_USB_KEYMAP_UPLOAD_BINDINGS_MAX];
+        } bindings;
+    };
+} __packed;
+
+BUILD_ASSERT(sizeof(struct zmk_usb_keymap_upload_request) == ZMK_USB_KEYMAP_UPLOAD_REQUEST_SIZE,
+             "Keymap upload requests must fill the output report");
+
+/** Sent as an input report for every request. */
+struct zmk_usb_keymap_upload_response {
+    uint8_t command;
+    uint8_t sequence;
+    /** 0, or a negative errno. */
+    int16_t status;
+} __packed;
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/util.h>
+
+#include <zmk/pipeline_stats.h>
+
+#define ZMK_USB_TELEMETRY_USAGE_PAGE 0xFF60
+#define ZMK_USB_TELEMETRY_USAGE 0x61
+
+/** Bumped whenever the layout of the record changes. */
+#define ZMK_USB_TELEMETRY_VERSION 1
+
+/**
+ * One input report of the telemetry interface. Fields are little endian, and the pipeline stats
+ * are peaks and totals since boot, saturating at UINT16_MAX.
+ */
+struct zmk_usb_telemetry_record {
+    uint8_t version;
+    /** Battery state of charge in percent, or UINT8_MAX without a battery. */
+    uint8_t battery;
+    /** Counts up with each record, so the host can tell records were skipped. */
+    uint16_t sequence;
+    uint32_t uptime_ms;
+    uint16_t worst_latency_ms;
+    uint16_t peak_heap_events;
+    uint16_t alloc_failures;
+    /** Indexed by enum zmk_pipeline_queue. */
+    uint16_t peak_depth[ZMK_PIPELINE_QUEUE_COUNT];
+    uint16_t dropped[ZMK_PIPELINE_QUEUE_COUNT];
+} __packed;
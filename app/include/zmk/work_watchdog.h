@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+
+#if IS_ENABLED(CONFIG_ZMK_WORK_WATCHDOG)
+
+/**
+ * Runs a work handler, and reports it if the run takes longer than
+ * CONFIG_ZMK_WORK_WATCHDOG_THRESHOLD_MS.
+ */
+void zmk_work_watchdog_run(k_work_handler_t handler, struct k_work *work);
+
+/**
+ * Defines the timed version of a work handler. Place it at file scope once the handler is declared,
+ * without a trailing semicolon.
+ */
+#define ZMK_WORK_WATCHDOG_WRAP(handler)                                                            \
+    static void handler##_watched(struct k_work *work) { zmk_work_watchdog_run(handler, work); }
+
+/** The handler to set up work with, so its runs are timed by the watchdog. */
+#define ZMK_WORK_WATCHED(handler) handler##_watched
+
+#else
+
+#define ZMK_WORK_WATCHDOG_WRAP(handler)
+#define ZMK_WORK_WATCHED(handler) handler
+
+#endif /* IS_ENABLED(CONFIG_ZMK_WORK_WATCHDOG) */
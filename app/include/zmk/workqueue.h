@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <kernel.h>
+
+/**
+ * The work queue that runs the input path: kscan processing, behavior timers and queued
+ * behaviors. This is the system work queue unless CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED is set.
+ */
+struct k_work_q *zmk_input_work_q();
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
+/**
+ * The work queue shared by the HID over GATT notifications and the split central and peripheral
+ * transmit work, in place of a thread for each.
+ */
+struct k_work_q *zmk_ble_tx_work_q();
+#endif
@@ -26,13 +26,34 @@ fi
 testcase="$path"
 echo "Running $testcase:"
 
-west build -d build/$testcase -b native_posix_64 -- -DZMK_CONFIG="$(pwd)/$testcase" > /dev/null 2>&1
+# Test cases can share a Kconfig fragment and log patterns with the other cases in their
+# directory, in shared.conf and shared.patterns.
+shared_dir=$(dirname $testcase)
+shared_conf=""
+if [ -f $shared_dir/shared.conf ]; then
+	shared_conf="-DOVERLAY_CONFIG=$(pwd)/$shared_dir/shared.conf"
+fi
+patterns=""
+for p in $shared_dir/shared.patterns $testcase/events.patterns; do
+	if [ -f $p ]; then
+		patterns="$patterns -f $p"
+	fi
+done
+
+west build -d build/$testcase -b native_posix_64 -- -DZMK_CONFIG="$(pwd)/$testcase" $shared_conf > /dev/null 2>&1
 if [ $? -gt 0 ]; then
 	echo "FAILED: $testcase did not build" | tee -a ./build/tests/pass-fail.log
 	exit 1
 fi
 
-./build/$testcase/zephyr/zmk.exe | sed -e "s/.*> //" | tee build/$testcase/keycode_events_full.log | sed -n -f $testcase/events.patterns > build/$testcase/keycode_events.log
+# Tests run in virtual time: the simulated clock skips straight to the next timeout instead of
+# waiting for it, so long timeouts don't slow the tests down.
+./build/$testcase/zephyr/zmk.exe --no-rt | sed -e "s/.*> //" | tee build/$testcase/keycode_events_full.log | sed -n $patterns > build/$testcase/keycode_events.log
+
+# The exact latency and micro benchmark results, kept next to the other logs that CI archives.
+grep "latency: " build/$testcase/keycode_events_full.log > build/$testcase/latency.log || rm build/$testcase/latency.log
+grep "bench: " build/$testcase/keycode_events_full.log > build/$testcase/bench.log || rm build/$testcase/bench.log
+
 diff -au $testcase/keycode_events.snapshot build/$testcase/keycode_events.log
 if [ $? -gt 0 ]; then
 	if [ -f $testcase/pending ]; then
@@ -0,0 +1,113 @@
+# Copyright (c) 2022 The ZMK Contributors
+# SPDX-License-Identifier: MIT
+
+"""
+Convert LVGL 1-bit indexed C images to ZMK run-length encoded images, in place.
+
+See app/include/zmk/display/rle_image.h for the format. Each image gets whichever
+run length size makes it smaller.
+"""
+
+import argparse
+import re
+from pathlib import Path
+
+MAP_RE = re.compile(r"(\w+)_map\[\]\s*=\s*\{(.*?)\};", re.S)
+HEADER_RE = re.compile(r"^(/\*.*?\*/\n)", re.S)
+
+
+def parse(text: str):
+    """Return the name, pixels (True for black), width and height of an image."""
+    name, body = MAP_RE.search(text).groups()
+    body = re.sub(r"/\*.*?\*/", "", body)
+    values = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", body)]
+
+    width = int(re.search(r"\.header\.w\s*=\s*(\d+)", text).group(1))
+    height = int(re.search(r"\.header\.h\s*=\s*(\d+)", text).group(1))
+
+    if "LV_IMG_CF_INDEXED_1BIT" not in text:
+        raise ValueError("only LV_IMG_CF_INDEXED_1BIT images can be converted")
+
+    # The palette is two BGRA colors. Pixels are black where their color is darker.
+    palette, data = values[:8], values[8:]
+    black = [sum(palette[i * 4 : i * 4 + 3]) < 384 for i in range(2)]
+
+    stride = (width + 7) // 8
+    pixels = [
+        black[(data[row * stride + col // 8] >> (7 - col % 8)) & 1]
+        for row in range(height)
+        for col in range(width)
+    ]
+
+    return name, pixels, width, height
+
+
+def runs(pixels, max_run: int):
+    """Alternating white and black run lengths, split to fit in max_run."""
+    result = []
+    color = False
+    length = 0
+
+    for pixel in pixels + [None]:
+        if pixel == color:
+            length += 1
+            continue
+
+        while length > max_run:
+            result += [max_run, 0]
+            length -= max_run
+        result.append(length)
+
+        color = not color
+        length = 1
+
+    # Trailing white pixels are implied. color now follows the last run.
+    if color:
+        result.pop()
+
+    return result
+
+
+def encode(pixels):
+    runs8 = runs(pixels, 255)
+    runs4 = runs(pixels, 15)
+
+    if (len(runs4) + 1) // 2 < len(runs8):
+        if len(runs4) % 2:
+            runs4.append(0)
+        return "ZMK_RLE_IMAGE_RUNS_4", [
+            runs4[i] << 4 | runs4[i + 1] for i in range(0, len(runs4), 2)
+        ]
+
+    return "ZMK_RLE_IMAGE_RUNS_8", runs8
+
+
+def convert(path: Path):
+    text = path.read_text()
+    name, pixels, width, height = parse(text)
+    kind, data = encode(pixels)
+
+    header = HEADER_RE.match(text)
+    lines = [header.group(1) if header else "", "#include <zmk/display/rle_image.h>", ""]
+    lines.append(f"static const uint8_t {name}_map[] = {{")
+    lines.append(f"    {kind},")
+    for i in range(0, len(data), 12):
+        lines.append("    " + " ".join(f"0x{v:02x}," for v in data[i : i + 12]))
+    lines.append("};")
+    lines.append("")
+    lines.append(f"const lv_img_dsc_t {name} = ZMK_RLE_IMAGE({name}_map, {width}, {height});")
+
+    path.write_text("\n".join(lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("files", nargs="+", type=Path, help="LVGL image C files")
+    args = parser.parse_args()
+
+    for path in args.files:
+        convert(path)
+
+
+if __name__ == "__main__":
+    main()
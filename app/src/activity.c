@@ -8,20 +8,31 @@
 #include <init.h>
 #include <kernel.h>
 #include <pm/pm.h>
+#include <sys/atomic.h>
 
 #include <logging/log.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/activity_state_changed.h>
 #include <zmk/events/position_state_changed.h>
 #include <zmk/events/sensor_event.h>
 
 #include <zmk/activity.h>
+#include <zmk/work_watchdog.h>
 
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
 #include <zmk/usb.h>
+#include <zmk/events/usb_conn_state_changed.h>
+#endif
+
+#define FOLLOW_CENTRAL                                                                             \
+    (IS_ENABLED(CONFIG_ZMK_SPLIT_SYNC_ACTIVITY) && !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL))
+
+#if FOLLOW_CENTRAL
+#include <zmk/events/split_peripheral_status_changed.h>
 #endif
 
 bool is_usb_power_present() {
@@ -42,9 +53,22 @@ static uint32_t activity_last_uptime;
 #define MAX_SLEEP_MS CONFIG_ZMK_IDLE_SLEEP_TIMEOUT
 #endif
 
+#if FOLLOW_CENTRAL
+#define CENTRAL_STATE_UNKNOWN -1
+
+// The central's state while it is connected, or CENTRAL_STATE_UNKNOWN.
+static atomic_t central_state = ATOMIC_INIT(CENTRAL_STATE_UNKNOWN);
+
+static inline bool central_connected() {
+    return atomic_get(&central_state) != CENTRAL_STATE_UNKNOWN;
+}
+#else
+static inline bool central_connected() { return false; }
+#endif
+
 int raise_event() {
-    return ZMK_EVENT_RAISE(new_zmk_activity_state_changed(
-        (struct zmk_activity_state_changed){.state = activity_state}));
+    return raise_zmk_activity_state_changed(
+        (struct zmk_activity_state_changed){.state = activity_state});
 }
 
 int set_state(enum zmk_activity_state state) {
@@ -57,37 +81,108 @@ int set_state(enum zmk_activity_state state) {
 
 enum zmk_activity_state zmk_activity_get_state() { return activity_state; }
 
+void activity_work_handler(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(activity_work_handler)
+static K_WORK_DELAYABLE_DEFINE(activity_work, ZMK_WORK_WATCHED(activity_work_handler));
+
+#if IS_ENABLED(CONFIG_ZMK_SLEEP)
+static void power_off() {
+    pm_power_state_force(0U, (struct pm_state_info){PM_STATE_SOFT_OFF, 0, 0});
+}
+
+#if defined(CONFIG_ZMK_SPLIT_SYNC_ACTIVITY_SLEEP_DELAY_MS)
+static void sleep_work_handler(struct k_work *work) { power_off(); }
+
+ZMK_WORK_WATCHDOG_WRAP(sleep_work_handler)
+static K_WORK_DELAYABLE_DEFINE(sleep_work, ZMK_WORK_WATCHED(sleep_work_handler));
+#endif
+
+static void enter_sleep() {
+    // Put devices in suspend power mode before sleeping
+    set_state(ZMK_ACTIVITY_SLEEP);
+
+#if defined(CONFIG_ZMK_SPLIT_SYNC_ACTIVITY_SLEEP_DELAY_MS)
+    // The peripherals sleep when they hear the central does, which needs the link for a while.
+    k_work_schedule(&sleep_work, K_MSEC(CONFIG_ZMK_SPLIT_SYNC_ACTIVITY_SLEEP_DELAY_MS));
+#else
+    power_off();
+#endif
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_SLEEP) */
+
 int activity_event_listener(const zmk_event_t *eh) {
-    activity_last_uptime = k_uptime_get();
+    activity_last_uptime = k_uptime_get_32();
 
+    // While active, the deadline is only pushed back once it expires, so keystrokes just record
+    // the time.
+    if (activity_state == ZMK_ACTIVITY_ACTIVE) {
+        return 0;
+    }
+
+#if defined(CONFIG_ZMK_SPLIT_SYNC_ACTIVITY_SLEEP_DELAY_MS)
+    k_work_cancel_delayable(&sleep_work);
+#endif
+
+    k_work_reschedule(&activity_work, K_MSEC(MAX_IDLE_MS));
     return set_state(ZMK_ACTIVITY_ACTIVE);
 }
 
+// Runs at the next idle or sleep threshold, measured from the last activity seen when it was
+// scheduled. If there was activity since, it just waits for the new threshold.
 void activity_work_handler(struct k_work *work) {
-    int32_t current = k_uptime_get();
-    int32_t inactive_time = current - activity_last_uptime;
+    uint32_t inactive_time = k_uptime_get_32() - activity_last_uptime;
+    uint32_t next_threshold = UINT32_MAX;
+
+#if FOLLOW_CENTRAL
+    atomic_val_t central = atomic_get(&central_state);
+
+    // The central's state already covers the keys of this half. It only sends changes, which run
+    // this again, so nothing is scheduled while following it.
+    if (central == ZMK_ACTIVITY_ACTIVE) {
+        set_state(ZMK_ACTIVITY_ACTIVE);
+        return;
+    }
+
 #if IS_ENABLED(CONFIG_ZMK_SLEEP)
-    if (inactive_time > MAX_SLEEP_MS && !is_usb_power_present()) {
-        // Put devices in suspend power mode before sleeping
-        set_state(ZMK_ACTIVITY_SLEEP);
-        pm_power_state_force(0U, (struct pm_state_info){PM_STATE_SOFT_OFF, 0, 0});
-    } else
-#endif /* IS_ENABLED(CONFIG_ZMK_SLEEP) */
-        if (inactive_time > MAX_IDLE_MS) {
-        set_state(ZMK_ACTIVITY_IDLE);
+    if (central == ZMK_ACTIVITY_SLEEP && !is_usb_power_present()) {
+        enter_sleep();
+        return;
     }
-}
+#endif
+#endif /* FOLLOW_CENTRAL */
 
-K_WORK_DEFINE(activity_work, activity_work_handler);
+#if IS_ENABLED(CONFIG_ZMK_SLEEP)
+    // While connected, only the central decides when to sleep.
+    bool own_sleep = !central_connected();
 
-void activity_expiry_function() { k_work_submit(&activity_work); }
+    if (own_sleep && inactive_time >= MAX_SLEEP_MS && !is_usb_power_present()) {
+        enter_sleep();
+        return;
+    }
 
-K_TIMER_DEFINE(activity_timer, activity_expiry_function, NULL);
+    if (own_sleep && inactive_time < MAX_SLEEP_MS) {
+        next_threshold = MAX_SLEEP_MS;
+    }
+#endif /* IS_ENABLED(CONFIG_ZMK_SLEEP) */
+
+    if (inactive_time >= MAX_IDLE_MS) {
+        set_state(ZMK_ACTIVITY_IDLE);
+    } else {
+        next_threshold = MIN(next_threshold, MAX_IDLE_MS);
+    }
+
+    // Past every threshold, only activity or USB power going away can change the state, and both
+    // reschedule this.
+    if (next_threshold != UINT32_MAX) {
+        k_work_schedule(&activity_work, K_MSEC(next_threshold - inactive_time));
+    }
+}
 
 int activity_init() {
-    activity_last_uptime = k_uptime_get();
+    activity_last_uptime = k_uptime_get_32();
 
-    k_timer_start(&activity_timer, K_SECONDS(1), K_SECONDS(1));
+    k_work_schedule(&activity_work, K_MSEC(MAX_IDLE_MS));
     return 0;
 }
 
@@ -95,4 +190,40 @@ ZMK_LISTENER(activity, activity_event_listener);
 ZMK_SUBSCRIPTION(activity, zmk_position_state_changed);
 ZMK_SUBSCRIPTION(activity, zmk_sensor_event);
 
-SYS_INIT(activity_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#if IS_ENABLED(CONFIG_ZMK_SLEEP) && IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+// Sleep is skipped while on USB power, so check again once it goes away.
+static int activity_usb_listener(const zmk_event_t *eh) {
+    if (activity_state != ZMK_ACTIVITY_ACTIVE) {
+        k_work_reschedule(&activity_work, K_NO_WAIT);
+    }
+
+    return 0;
+}
+
+ZMK_LISTENER(activity_usb, activity_usb_listener);
+ZMK_SUBSCRIPTION(activity_usb, zmk_usb_conn_state_changed);
+#endif
+
+#if FOLLOW_CENTRAL
+void zmk_activity_set_central_state(enum zmk_activity_state state) {
+    atomic_set(&central_state, state);
+    k_work_reschedule(&activity_work, K_NO_WAIT);
+}
+
+// A central that just connected is taken to be active until it says otherwise. Connecting usually
+// follows a key press on one of the halves, and the central only sends its state when it changes.
+static int activity_split_listener(const zmk_event_t *eh) {
+    const struct zmk_split_peripheral_status_changed *ev =
+        as_zmk_split_peripheral_status_changed(eh);
+
+    atomic_set(&central_state, ev->connected ? ZMK_ACTIVITY_ACTIVE : CENTRAL_STATE_UNKNOWN);
+    k_work_reschedule(&activity_work, K_NO_WAIT);
+
+    return 0;
+}
+
+ZMK_LISTENER(activity_split, activity_split_listener);
+ZMK_SUBSCRIPTION(activity_split, zmk_split_peripheral_status_changed);
+#endif /* FOLLOW_CENTRAL */
+
+ZMK_SYS_INIT(activity_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
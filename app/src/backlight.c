@@ -8,17 +8,21 @@
 #include <devicetree.h>
 #include <init.h>
 #include <kernel.h>
+#include <stdlib.h>
 
 #include <drivers/led.h>
 #include <logging/log.h>
 #include <settings/settings.h>
 
+#include <zmk/boot_profile.h>
 #include <zmk/activity.h>
 #include <zmk/backlight.h>
+#include <zmk/settings.h>
 #include <zmk/usb.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/activity_state_changed.h>
 #include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/work_watchdog.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -42,10 +46,7 @@ struct backlight_state {
 static struct backlight_state state = {.brightness = CONFIG_ZMK_BACKLIGHT_BRT_START,
                                        .on = IS_ENABLED(CONFIG_ZMK_BACKLIGHT_ON_START)};
 
-static int zmk_backlight_update() {
-    uint8_t brt = zmk_backlight_get_brt();
-    LOG_DBG("Update backlight brightness: %d%%", brt);
-
+static int zmk_backlight_set_leds(uint8_t brt) {
     for (int i = 0; i < BACKLIGHT_NUM_LEDS; i++) {
         int rc = led_set_brightness(backlight_dev, i, brt);
         if (rc != 0) {
@@ -56,6 +57,61 @@ static int zmk_backlight_update() {
     return 0;
 }
 
+#if CONFIG_ZMK_BACKLIGHT_FADE_MS > 0
+// What the LEDs show, and where the current fade started.
+static uint8_t fade_brt;
+static uint8_t fade_from;
+static int64_t fade_start;
+
+static void backlight_fade_work_handler(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(backlight_fade_work_handler)
+static K_WORK_DELAYABLE_DEFINE(backlight_fade_work, ZMK_WORK_WATCHED(backlight_fade_work_handler));
+
+// Steps through the fade on a timer, waking once per percent of brightness it covers.
+static void backlight_fade_work_handler(struct k_work *work) {
+    const uint8_t target = zmk_backlight_get_brt();
+    const int64_t elapsed = k_uptime_get() - fade_start;
+    const int distance = abs(target - fade_from);
+    uint8_t brt = target;
+
+    if (elapsed < CONFIG_ZMK_BACKLIGHT_FADE_MS) {
+        brt = fade_from + (target - fade_from) * (int)elapsed / CONFIG_ZMK_BACKLIGHT_FADE_MS;
+    }
+
+    // fade_brt only follows the steps that reach the LEDs, so a failed one is retried on the next
+    // wake, including past the end of the fade, and a later change fades from the real level.
+    if (brt != fade_brt) {
+        int rc = zmk_backlight_set_leds(brt);
+        if (rc != 0) {
+            LOG_ERR("Failed to fade backlight to %d%%: %d", brt, rc);
+        } else {
+            fade_brt = brt;
+        }
+    }
+
+    if (fade_brt != target) {
+        k_work_schedule(&backlight_fade_work,
+                        K_MSEC(MAX(CONFIG_ZMK_BACKLIGHT_FADE_MS / MAX(distance, 1), 1)));
+    }
+}
+#endif
+
+static int zmk_backlight_update() {
+    uint8_t brt = zmk_backlight_get_brt();
+    LOG_DBG("Update backlight brightness: %d%%", brt);
+
+#if CONFIG_ZMK_BACKLIGHT_FADE_MS > 0
+    // A change during a fade continues from whatever the LEDs show now.
+    fade_from = fade_brt;
+    fade_start = k_uptime_get();
+    k_work_reschedule(&backlight_fade_work, K_NO_WAIT);
+    return 0;
+#else
+    return zmk_backlight_set_leds(brt);
+#endif
+}
+
 #if IS_ENABLED(CONFIG_SETTINGS)
 static int backlight_settings_load_cb(const char *name, size_t len, settings_read_cb read_cb,
                                       void *cb_arg, void *param) {
@@ -71,11 +127,23 @@ static int backlight_settings_load_cb(const char *name, size_t len, settings_rea
     return -ENOENT;
 }
 
-static void backlight_save_work_handler(struct k_work *work) {
+static void backlight_save_work_handler() {
     settings_save_one("backlight/state", &state, sizeof(state));
 }
 
-static struct k_work_delayable backlight_save_work;
+ZMK_SETTINGS_SAVE_DEFINE(backlight_save, backlight_save_work_handler);
+#endif
+
+static void backlight_apply_loaded_state() {
+#if IS_ENABLED(CONFIG_ZMK_BACKLIGHT_AUTO_OFF_USB)
+    state.on = zmk_usb_is_powered();
+#endif
+    zmk_backlight_update();
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+ZMK_SETTINGS_DEFERRED_LOAD_DEFINE(backlight_load, "backlight", backlight_settings_load_cb,
+                                  backlight_apply_loaded_state);
 #endif
 
 static int zmk_backlight_init(const struct device *_arg) {
@@ -85,17 +153,12 @@ static int zmk_backlight_init(const struct device *_arg) {
     }
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-    settings_subsys_init();
-    int rc = settings_load_subtree_direct("backlight", backlight_settings_load_cb, NULL);
-    if (rc != 0) {
-        LOG_ERR("Failed to load backlight settings: %d", rc);
-    }
-    k_work_init_delayable(&backlight_save_work, backlight_save_work_handler);
-#endif
-#if IS_ENABLED(CONFIG_ZMK_BACKLIGHT_AUTO_OFF_USB)
-    state.on = zmk_usb_is_powered();
+    // The backlight stays off until its saved state is loaded, after everything needed to type.
+    zmk_settings_load_deferred(&backlight_load);
+#else
+    backlight_apply_loaded_state();
 #endif
-    return zmk_backlight_update();
+    return 0;
 }
 
 static int zmk_backlight_update_and_save() {
@@ -105,8 +168,7 @@ static int zmk_backlight_update_and_save() {
     }
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-    int ret = k_work_reschedule(&backlight_save_work, K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
-    return MIN(ret, 0);
+    return zmk_settings_save(&backlight_save);
 #else
     return 0;
 #endif
@@ -189,4 +251,4 @@ ZMK_SUBSCRIPTION(backlight, zmk_activity_state_changed);
 ZMK_SUBSCRIPTION(backlight, zmk_usb_conn_state_changed);
 #endif
 
-SYS_INIT(zmk_backlight_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_backlight_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
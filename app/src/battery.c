@@ -10,17 +10,33 @@
 #include <kernel.h>
 #include <drivers/sensor.h>
 #include <bluetooth/services/bas.h>
+#include <stdlib.h>
 
 #include <logging/log.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
+#include <zmk/activity.h>
 #include <zmk/event_manager.h>
 #include <zmk/battery.h>
+#include <zmk/events/activity_state_changed.h>
 #include <zmk/events/battery_state_changed.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+#include <zmk/usb.h>
+#endif
 
 static uint8_t last_state_of_charge = 0;
 
+#if IS_ENABLED(CONFIG_ZMK_BATTERY_ADAPTIVE_INTERVAL)
+// State of charge from the previous sample, whether or not it was reported
+static uint8_t last_sample_state_of_charge;
+// Whether the last sample dropped at least CONFIG_ZMK_BATTERY_FAST_DROP_PERCENT
+static bool dropping_fast;
+#endif
+
 uint8_t zmk_battery_state_of_charge() { return last_state_of_charge; }
 
 #if DT_HAS_CHOSEN(zmk_battery)
@@ -48,7 +64,18 @@ static int zmk_battery_update(const struct device *battery) {
         return rc;
     }
 
-    if (last_state_of_charge != state_of_charge.val1) {
+#if IS_ENABLED(CONFIG_ZMK_BATTERY_ADAPTIVE_INTERVAL)
+    dropping_fast = last_sample_state_of_charge - state_of_charge.val1 >=
+                    CONFIG_ZMK_BATTERY_FAST_DROP_PERCENT;
+    last_sample_state_of_charge = state_of_charge.val1;
+#endif
+
+    // Small changes are mostly measurement noise, so only report steps of at least the threshold,
+    // and reaching fully charged or empty.
+    int change = abs(state_of_charge.val1 - last_state_of_charge);
+    bool at_limit = state_of_charge.val1 == 0 || state_of_charge.val1 == 100;
+
+    if (change >= CONFIG_ZMK_BATTERY_REPORT_THRESHOLD || (change > 0 && at_limit)) {
         last_state_of_charge = state_of_charge.val1;
 
         LOG_DBG("Setting BAS GATT battery level to %d.", last_state_of_charge);
@@ -60,26 +87,72 @@ static int zmk_battery_update(const struct device *battery) {
             return rc;
         }
 
-        rc = ZMK_EVENT_RAISE(new_zmk_battery_state_changed(
-            (struct zmk_battery_state_changed){.state_of_charge = last_state_of_charge}));
+        rc = raise_zmk_battery_state_changed(
+            (struct zmk_battery_state_changed){.state_of_charge = last_state_of_charge});
     }
 
     return rc;
 }
 
+// How long to wait before the next sample. Changes in activity or USB power take effect from the
+// next sample on, so frequent changes can't keep postponing it.
+static k_timeout_t zmk_battery_interval() {
+#if IS_ENABLED(CONFIG_ZMK_BATTERY_ADAPTIVE_INTERVAL)
+    if (dropping_fast) {
+        return K_SECONDS(CONFIG_ZMK_BATTERY_REPORT_INTERVAL_FAST);
+    }
+
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+    // The battery is charging, or at least not draining.
+    if (zmk_usb_is_powered()) {
+        return K_SECONDS(CONFIG_ZMK_BATTERY_REPORT_INTERVAL_IDLE);
+    }
+#endif
+
+    if (zmk_activity_get_state() != ZMK_ACTIVITY_ACTIVE) {
+        return K_SECONDS(CONFIG_ZMK_BATTERY_REPORT_INTERVAL_IDLE);
+    }
+#endif
+
+    return K_SECONDS(CONFIG_ZMK_BATTERY_REPORT_INTERVAL);
+}
+
+static void zmk_battery_work(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(zmk_battery_work)
+static K_WORK_DELAYABLE_DEFINE(battery_work, ZMK_WORK_WATCHED(zmk_battery_work));
+
 static void zmk_battery_work(struct k_work *work) {
     int rc = zmk_battery_update(battery);
 
     if (rc != 0) {
         LOG_DBG("Failed to update battery value: %d.", rc);
     }
+
+    k_work_schedule(&battery_work, zmk_battery_interval());
 }
 
-K_WORK_DEFINE(battery_work, zmk_battery_work);
+// Stop sampling while asleep, and take a fresh sample on waking up.
+static int battery_listener(const zmk_event_t *eh) {
+    static bool sleeping;
 
-static void zmk_battery_timer(struct k_timer *timer) { k_work_submit(&battery_work); }
+    if (as_zmk_activity_state_changed(eh) == NULL) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
 
-K_TIMER_DEFINE(battery_timer, zmk_battery_timer, NULL);
+    if (zmk_activity_get_state() == ZMK_ACTIVITY_SLEEP) {
+        sleeping = true;
+        k_work_cancel_delayable(&battery_work);
+    } else if (sleeping) {
+        sleeping = false;
+        k_work_reschedule(&battery_work, K_NO_WAIT);
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(battery, battery_listener);
+ZMK_SUBSCRIPTION(battery, zmk_activity_state_changed);
 
 static int zmk_battery_init(const struct device *_arg) {
 #if !DT_HAS_CHOSEN(zmk_battery)
@@ -104,9 +177,13 @@ static int zmk_battery_init(const struct device *_arg) {
         return rc;
     }
 
-    k_timer_start(&battery_timer, K_MINUTES(1), K_SECONDS(CONFIG_ZMK_BATTERY_REPORT_INTERVAL));
+#if IS_ENABLED(CONFIG_ZMK_BATTERY_ADAPTIVE_INTERVAL)
+    last_sample_state_of_charge = last_state_of_charge;
+#endif
+
+    k_work_schedule(&battery_work, K_MINUTES(1));
 
     return 0;
 }
 
-SYS_INIT(zmk_battery_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_battery_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -5,62 +5,268 @@
  */
 
 #include <zmk/behavior_queue.h>
+#include <zmk/behavior_timer.h>
 
 #include <kernel.h>
 #include <logging/log.h>
+#include <sys/atomic.h>
+#include <sys/slist.h>
 #include <drivers/behavior.h>
 
+#include <zmk/hot_path_trace.h>
+#include <zmk/memory_stats.h>
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST) || IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+#include <zmk/endpoints.h>
+#endif
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 struct q_item {
+    sys_snode_t node;
     uint32_t position;
-    struct zmk_behavior_binding binding;
+    // The queueing behavior owns the bindings and keeps them in RAM, so only a reference is
+    // queued. Bursts invoke several bindings together.
+    struct zmk_behavior_binding *bindings;
+    uint8_t bindings_len;
     bool press : 1;
-    uint32_t wait : 31;
+    bool tap : 1;
+    // Whether the wait and the tap time only last until the reports reached the host.
+    bool wait_paced : 1;
+    bool tap_paced : 1;
+    uint32_t wait : 28;
+    // For taps, the time between the press and the release.
+    uint32_t tap_ms;
 };
 
-K_MSGQ_DEFINE(zmk_behavior_queue_msgq, sizeof(struct q_item), CONFIG_ZMK_BEHAVIORS_QUEUE_SIZE, 4);
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+#define IS_PACED(time) (((time)&ZMK_BEHAVIOR_QUEUE_PACED) != 0)
+#define PACED_TIME(time) ((time) & ~ZMK_BEHAVIOR_QUEUE_PACED)
+#else
+#define IS_PACED(time) false
+#define PACED_TIME(time) (time)
+#endif
+
+// The items of all streams share one pool, so a single long macro can still use the whole queue.
+K_MEM_SLAB_DEFINE(zmk_behavior_queue_slab, sizeof(struct q_item), CONFIG_ZMK_BEHAVIORS_QUEUE_SIZE,
+                  4);
+
+// Items queued by the same key run in order, each waiting for the one before it. Keys mapped to
+// different streams don't wait on each other.
+struct behavior_queue_stream {
+    sys_slist_t items;
+    // Schedules the next item of the stream. All streams share the one behavior timer timeout.
+    struct zmk_behavior_timer timer;
+    // A tap that was pressed and still has to be released.
+    struct q_item tap_item;
+    bool tap_release_pending;
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    // Set while the stream waits for its reports to reach the host, which it does until the
+    // deadline at most.
+    atomic_t awaiting_delivery;
+    int64_t delivery_deadline;
+#endif
+};
+
+static void behavior_queue_process_next(struct zmk_behavior_timer *timer);
+
+#define STREAM_INIT(i, _) {.timer = ZMK_BEHAVIOR_TIMER_INITIALIZER(behavior_queue_process_next)},
+
+static struct behavior_queue_stream streams[] = {
+    UTIL_LISTIFY(CONFIG_ZMK_BEHAVIORS_QUEUE_STREAMS, STREAM_INIT, _)};
+
+static struct k_spinlock lock;
+
+static struct behavior_queue_stream *stream_for(uint32_t position) {
+    return &streams[position % CONFIG_ZMK_BEHAVIORS_QUEUE_STREAMS];
+}
+
+static bool take_item(struct behavior_queue_stream *stream, struct q_item *item) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    sys_snode_t *node = sys_slist_get(&stream->items);
+    k_spin_unlock(&lock, key);
+
+    if (node == NULL) {
+        return false;
+    }
+
+    struct q_item *queued = CONTAINER_OF(node, struct q_item, node);
+    *item = *queued;
+    k_mem_slab_free(&zmk_behavior_queue_slab, (void **)&queued);
+    return true;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+// Schedules the stream at the deadline, unless a transport reports delivering everything before
+// then. A delivery found right away still goes through the timer, so steps never run recursively.
+static void wait_for_delivery(struct behavior_queue_stream *stream, int64_t deadline) {
+    stream->delivery_deadline = deadline;
+    zmk_behavior_timer_schedule(&stream->timer, deadline);
+
+    // Set before checking the endpoints, so a delivery in between still wakes the stream.
+    atomic_set(&stream->awaiting_delivery, true);
+    if (!zmk_endpoints_reports_pending() && atomic_cas(&stream->awaiting_delivery, true, false)) {
+        zmk_behavior_timer_schedule(&stream->timer, k_uptime_get());
+    }
+}
+
+void zmk_behavior_queue_reports_delivered() {
+    for (int i = 0; i < ARRAY_SIZE(streams); i++) {
+        if (atomic_cas(&streams[i].awaiting_delivery, true, false)) {
+            zmk_behavior_timer_schedule(&streams[i].timer, k_uptime_get());
+        }
+    }
+}
+
+// Returns whether the stream has to keep waiting, because it was woken up by a transport while
+// reports from another one are still on their way.
+static bool keep_waiting_for_delivery(struct behavior_queue_stream *stream) {
+    int64_t deadline = stream->delivery_deadline;
+    if (deadline == 0) {
+        return false;
+    }
+
+    stream->delivery_deadline = 0;
+    if (k_uptime_get() >= deadline || !zmk_endpoints_reports_pending()) {
+        atomic_set(&stream->awaiting_delivery, false);
+        return false;
+    }
 
-static void behavior_queue_process_next(struct k_work *work);
-static K_WORK_DELAYABLE_DEFINE(queue_work, behavior_queue_process_next);
+    wait_for_delivery(stream, deadline);
+    return true;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MACRO_PACING) */
 
-static void behavior_queue_process_next(struct k_work *work) {
+static void behavior_queue_process_next(struct zmk_behavior_timer *timer) {
+    struct behavior_queue_stream *stream = CONTAINER_OF(timer, struct behavior_queue_stream, timer);
     struct q_item item = {.wait = 0};
 
-    while (k_msgq_get(&zmk_behavior_queue_msgq, &item, K_NO_WAIT) == 0) {
-        LOG_DBG("Invoking %s: 0x%02x 0x%02x", log_strdup(item.binding.behavior_dev),
-                item.binding.param1, item.binding.param2);
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    if (keep_waiting_for_delivery(stream)) {
+        return;
+    }
+#endif
+
+    while (stream->tap_release_pending || take_item(stream, &item)) {
+        bool press;
+        uint32_t wait;
+        if (stream->tap_release_pending) {
+            item = stream->tap_item;
+            stream->tap_release_pending = false;
+            press = false;
+            wait = item.wait;
+        } else if (item.tap) {
+            stream->tap_item = item;
+            stream->tap_release_pending = true;
+            press = true;
+            wait = item.tap_ms;
+        } else {
+            press = item.press;
+            wait = item.wait;
+        }
 
         struct zmk_behavior_binding_event event = {.position = item.position,
                                                    .timestamp = k_uptime_get()};
 
-        if (item.press) {
-            behavior_keymap_binding_pressed(&item.binding, event);
-        } else {
-            behavior_keymap_binding_released(&item.binding, event);
+        struct zmk_behavior_binding *bindings = item.bindings;
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+        if (item.bindings_len > 1) {
+            zmk_endpoints_batch_begin();
         }
+#endif
+
+        for (int i = 0; i < item.bindings_len; i++) {
+            LOG_DBG("Invoking %s: 0x%02x 0x%02x", log_strdup(bindings[i].behavior_dev),
+                    bindings[i].param1, bindings[i].param2);
 
-        LOG_DBG("Processing next queued behavior in %dms", item.wait);
+            if (press) {
+                behavior_keymap_binding_pressed(&bindings[i], event);
+            } else {
+                behavior_keymap_binding_released(&bindings[i], event);
+            }
 
-        if (item.wait > 0) {
-            k_work_schedule(&queue_work, K_MSEC(item.wait));
+            // Invoking the binding resolved its device.
+            zmk_hot_path_trace(ZMK_HOT_PATH_BEHAVIOR_QUEUE, bindings[i].behavior, item.position,
+                               press);
+        }
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+        if (item.bindings_len > 1) {
+            zmk_endpoints_batch_end();
+        }
+#endif
+
+        LOG_DBG("Processing next queued behavior in %dms", wait);
+
+        if (wait > 0) {
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+            // The press of a tap waits for its tap time, everything else for its wait.
+            if (press && item.tap ? item.tap_paced : item.wait_paced) {
+                wait_for_delivery(stream, k_uptime_get() + wait);
+                break;
+            }
+#endif
+            zmk_behavior_timer_schedule(&stream->timer, k_uptime_get() + wait);
             break;
         }
     }
 }
 
-int zmk_behavior_queue_add(uint32_t position, const struct zmk_behavior_binding binding, bool press,
-                           uint32_t wait) {
-    struct q_item item = {.press = press, .binding = binding, .wait = wait};
-
-    const int ret = k_msgq_put(&zmk_behavior_queue_msgq, &item, K_NO_WAIT);
+static int queue_item(uint32_t position, const struct q_item *item) {
+    struct q_item *queued;
+    const int ret = k_mem_slab_alloc(&zmk_behavior_queue_slab, (void **)&queued, K_NO_WAIT);
     if (ret < 0) {
         return ret;
     }
 
-    if (!k_work_delayable_is_pending(&queue_work)) {
-        behavior_queue_process_next(&queue_work.work);
+    zmk_memory_stats_slab(ZMK_MEMORY_QUEUE_BEHAVIORS, &zmk_behavior_queue_slab);
+
+    *queued = *item;
+
+    struct behavior_queue_stream *stream = stream_for(position);
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    sys_slist_append(&stream->items, &queued->node);
+    k_spin_unlock(&lock, key);
+
+    if (!zmk_behavior_timer_is_pending(&stream->timer)) {
+        behavior_queue_process_next(&stream->timer);
     }
 
     return 0;
 }
+
+int zmk_behavior_queue_add(uint32_t position, const struct zmk_behavior_binding *binding,
+                           bool press, uint32_t wait) {
+    struct q_item item = {.press = press,
+                          .bindings = (struct zmk_behavior_binding *)binding,
+                          .bindings_len = 1,
+                          .wait_paced = IS_PACED(wait),
+                          .wait = PACED_TIME(wait)};
+    return queue_item(position, &item);
+}
+
+int zmk_behavior_queue_add_tap(uint32_t position, const struct zmk_behavior_binding *binding,
+                               uint32_t tap_ms, uint32_t wait) {
+    struct q_item item = {.tap = true,
+                          .bindings = (struct zmk_behavior_binding *)binding,
+                          .bindings_len = 1,
+                          .wait_paced = IS_PACED(wait),
+                          .tap_paced = IS_PACED(tap_ms),
+                          .wait = PACED_TIME(wait),
+                          .tap_ms = PACED_TIME(tap_ms)};
+    return queue_item(position, &item);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+int zmk_behavior_queue_add_burst(uint32_t position, const struct zmk_behavior_binding *bindings,
+                                 uint8_t count, uint32_t tap_ms, uint32_t wait) {
+    struct q_item item = {.tap = true,
+                          .bindings = (struct zmk_behavior_binding *)bindings,
+                          .bindings_len = count,
+                          .wait_paced = IS_PACED(wait),
+                          .tap_paced = IS_PACED(tap_ms),
+                          .wait = PACED_TIME(wait),
+                          .tap_ms = PACED_TIME(tap_ms)};
+    return queue_item(position, &item);
+}
+#endif
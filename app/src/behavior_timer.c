@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <logging/log.h>
+#include <sys/dlist.h>
+
+#include <zmk/behavior_timer.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+static struct k_spinlock lock;
+
+// Pending timers, sorted by deadline. Timers with the same deadline run in the order they were
+// scheduled. Only a handful of behaviors wait on a timer at once, so a sorted list is enough.
+static sys_dlist_t pending = SYS_DLIST_STATIC_INIT(&pending);
+
+// The deadline the kernel timeout is set for, or INT64_MAX if it isn't.
+static int64_t armed_deadline = INT64_MAX;
+
+static struct zmk_behavior_timer *running_timer;
+static k_tid_t running_thread;
+
+static void behavior_timer_work_handler(struct k_work *work);
+ZMK_WORK_WATCHDOG_WRAP(behavior_timer_work_handler)
+static K_WORK_DELAYABLE_DEFINE(timer_work, ZMK_WORK_WATCHED(behavior_timer_work_handler));
+
+// Cancelled timers leave the kernel timeout alone. If it fires early, the handler just arms it
+// again for the next deadline.
+static void arm(int64_t deadline) {
+    if (deadline >= armed_deadline) {
+        return;
+    }
+
+    armed_deadline = deadline;
+    k_work_reschedule_for_queue(zmk_input_work_q(), &timer_work,
+                                K_MSEC(MAX(deadline - k_uptime_get(), 0)));
+}
+
+static void behavior_timer_work_handler(struct k_work *work) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    armed_deadline = INT64_MAX;
+
+    sys_dnode_t *node;
+    while ((node = sys_dlist_peek_head(&pending)) != NULL) {
+        struct zmk_behavior_timer *timer = CONTAINER_OF(node, struct zmk_behavior_timer, node);
+        if (timer->deadline > k_uptime_get()) {
+            arm(timer->deadline);
+            break;
+        }
+
+        sys_dlist_remove(node);
+        running_timer = timer;
+        running_thread = k_current_get();
+        k_spin_unlock(&lock, key);
+
+        // The handler may schedule or cancel timers, including its own.
+        timer->handler(timer);
+
+        key = k_spin_lock(&lock);
+        running_timer = NULL;
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+void zmk_behavior_timer_init(struct zmk_behavior_timer *timer,
+                             zmk_behavior_timer_handler_t handler) {
+    sys_dnode_init(&timer->node);
+    timer->deadline = 0;
+    timer->handler = handler;
+}
+
+void zmk_behavior_timer_schedule(struct zmk_behavior_timer *timer, int64_t deadline) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (sys_dnode_is_linked(&timer->node)) {
+        sys_dlist_remove(&timer->node);
+    }
+    timer->deadline = deadline;
+
+    struct zmk_behavior_timer *next;
+    SYS_DLIST_FOR_EACH_CONTAINER(&pending, next, node) {
+        if (next->deadline > deadline) {
+            sys_dlist_insert(&next->node, &timer->node);
+            break;
+        }
+    }
+    if (!sys_dnode_is_linked(&timer->node)) {
+        sys_dlist_append(&pending, &timer->node);
+    }
+
+    arm(deadline);
+    k_spin_unlock(&lock, key);
+}
+
+int zmk_behavior_timer_cancel(struct zmk_behavior_timer *timer) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    int ret = 0;
+
+    if (sys_dnode_is_linked(&timer->node)) {
+        sys_dlist_remove(&timer->node);
+    } else if (timer == running_timer && running_thread != k_current_get()) {
+        ret = -EINPROGRESS;
+    }
+
+    k_spin_unlock(&lock, key);
+    return ret;
+}
+
+bool zmk_behavior_timer_is_pending(const struct zmk_behavior_timer *timer) {
+    return sys_dnode_is_linked(&timer->node) || timer == running_timer;
+}
@@ -13,6 +13,7 @@
 #include <dt-bindings/zmk/backlight.h>
 #include <zmk/backlight.h>
 #include <zmk/keymap.h>
+#include <zmk/split/state_sync.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -20,6 +21,17 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static int behavior_backlight_init(const struct device *dev) { return 0; }
 
+// Split peripherals get the central's state with BL_STATE_CMD, the brightness in the low byte.
+#define SYNC_ON BIT(8)
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+static uint32_t get_sync_state() {
+    return zmk_backlight_get_brt() | (zmk_backlight_is_on() ? SYNC_ON : 0);
+}
+
+ZMK_SPLIT_STATE_SYNC_DEFINE(backlight_sync, DT_INST_LABEL(0), BL_STATE_CMD, get_sync_state);
+#endif
+
 static int
 on_keymap_binding_convert_central_state_dependent_params(struct zmk_behavior_binding *binding,
                                                          struct zmk_behavior_binding_event event) {
@@ -48,8 +60,7 @@ on_keymap_binding_convert_central_state_dependent_params(struct zmk_behavior_bin
     return 0;
 }
 
-static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
-                                     struct zmk_behavior_binding_event event) {
+static int run_command(struct zmk_behavior_binding *binding) {
     switch (binding->param1) {
     case BL_ON_CMD:
         return zmk_backlight_on();
@@ -71,6 +82,11 @@ static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
     }
     case BL_SET_CMD:
         return zmk_backlight_set_brt(binding->param2);
+    case BL_STATE_CMD:
+        if (!(binding->param2 & SYNC_ON)) {
+            return zmk_backlight_off();
+        }
+        return zmk_backlight_set_brt(binding->param2 & 0xFF);
     default:
         LOG_ERR("Unknown backlight command: %d", binding->param1);
     }
@@ -78,6 +94,19 @@ static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
     return -ENOTSUP;
 }
 
+static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    int err = run_command(binding);
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+    if (err >= 0) {
+        zmk_split_state_sync_changed(&backlight_sync);
+    }
+#endif
+
+    return err;
+}
+
 static int on_keymap_binding_released(struct zmk_behavior_binding *binding,
                                       struct zmk_behavior_binding_event event) {
     return ZMK_BEHAVIOR_OPAQUE;
@@ -88,7 +117,8 @@ static const struct behavior_driver_api behavior_backlight_driver_api = {
         on_keymap_binding_convert_central_state_dependent_params,
     .binding_pressed = on_keymap_binding_pressed,
     .binding_released = on_keymap_binding_released,
-    .locality = BEHAVIOR_LOCALITY_GLOBAL,
+    // The central syncs its state to the peripherals, rather than them running every invocation.
+    .locality = BEHAVIOR_LOCALITY_CENTRAL,
 };
 
 DEVICE_DT_INST_DEFINE(0, behavior_backlight_init, NULL, NULL, NULL, APPLICATION,
@@ -30,9 +30,15 @@ struct caps_word_continue_item {
     uint8_t implicit_modifiers;
 };
 
+#define CAPS_WORD_KEY_WORDS ((UINT8_MAX + 1) / 32)
+
 struct behavior_caps_word_config {
     zmk_mod_flags_t mods;
     uint8_t index;
+    // Keyboard usages in continuations, one bit per usage. Usages listed without implicit
+    // modifiers always continue, so only the modded ones need the continuations to be searched.
+    uint32_t continue_keys[CAPS_WORD_KEY_WORDS];
+    uint32_t modded_continue_keys[CAPS_WORD_KEY_WORDS];
     uint8_t continuations_count;
     struct caps_word_continue_item continuations[];
 };
@@ -41,21 +47,32 @@ struct behavior_caps_word_data {
     bool active;
 };
 
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= 32,
+             "Too many caps word instances for active_caps_words");
+
+// Bit i is set while the caps word with index i is active, so the listener can return right away
+// while typing normally.
+static uint32_t active_caps_words;
+
 static void activate_caps_word(const struct device *dev) {
     struct behavior_caps_word_data *data = dev->data;
+    const struct behavior_caps_word_config *config = dev->config;
 
     data->active = true;
+    active_caps_words |= BIT(config->index);
 }
 
 static void deactivate_caps_word(const struct device *dev) {
     struct behavior_caps_word_data *data = dev->data;
+    const struct behavior_caps_word_config *config = dev->config;
 
     data->active = false;
+    active_caps_words &= ~BIT(config->index);
 }
 
 static int on_caps_word_binding_pressed(struct zmk_behavior_binding *binding,
                                         struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     struct behavior_caps_word_data *data = dev->data;
 
     if (data->active) {
@@ -87,6 +104,17 @@ static const struct device *devs[DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT)];
 static bool caps_word_is_caps_includelist(const struct behavior_caps_word_config *config,
                                           uint16_t usage_page, uint8_t usage_id,
                                           uint8_t implicit_modifiers) {
+    if (usage_page == HID_USAGE_KEY) {
+        if (config->continue_keys[usage_id / 32] & BIT(usage_id % 32)) {
+            LOG_DBG("Continuing capsword, found included usage: 0x%02X - 0x%02X", usage_page,
+                    usage_id);
+            return true;
+        }
+        if (!(config->modded_continue_keys[usage_id / 32] & BIT(usage_id % 32))) {
+            return false;
+        }
+    }
+
     for (int i = 0; i < config->continuations_count; i++) {
         const struct caps_word_continue_item *continuation = &config->continuations[i];
         LOG_DBG("Comparing with 0x%02X - 0x%02X (with implicit mods: 0x%02X)", continuation->page,
@@ -126,20 +154,12 @@ static void caps_word_enhance_usage(const struct behavior_caps_word_config *conf
 
 static int caps_word_keycode_state_changed_listener(const zmk_event_t *eh) {
     struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
-    if (ev == NULL || !ev->state) {
+    if (active_caps_words == 0 || ev == NULL || !ev->state) {
         return ZMK_EV_EVENT_BUBBLE;
     }
 
-    for (int i = 0; i < DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT); i++) {
-        const struct device *dev = devs[i];
-        if (dev == NULL) {
-            continue;
-        }
-
-        struct behavior_caps_word_data *data = dev->data;
-        if (!data->active) {
-            continue;
-        }
+    for (uint32_t pending = active_caps_words; pending != 0; pending &= pending - 1) {
+        const struct device *dev = devs[__builtin_ctz(pending)];
 
         const struct behavior_caps_word_config *config = dev->config;
 
@@ -172,11 +192,33 @@ static int behavior_caps_word_init(const struct device *dev) {
 
 #define BREAK_ITEM(i, n) PARSE_BREAK(DT_INST_PROP_BY_IDX(n, continue_list, i))
 
+#define CONTINUE_KEY_BIT(usage, word, modded)                                                      \
+    ((ZMK_HID_USAGE_PAGE(usage) == HID_USAGE_KEY && ZMK_HID_USAGE_ID(usage) / 32 == (word) &&      \
+      (SELECT_MODS(usage) != 0) == (modded))                                                       \
+         ? BIT(ZMK_HID_USAGE_ID(usage) % 32)                                                       \
+         : 0)
+
+#define CONTINUE_KEY_ITEM(i, n, word, modded)                                                      \
+    | CONTINUE_KEY_BIT(DT_INST_PROP_BY_IDX(n, continue_list, i), word, modded)
+
+#define CONTINUE_KEY_WORD(n, word, modded)                                                         \
+    (0 UTIL_LISTIFY(DT_INST_PROP_LEN(n, continue_list), CONTINUE_KEY_ITEM, n, word, modded))
+
+#define CONTINUE_KEYS(n, modded)                                                                   \
+    {                                                                                              \
+        CONTINUE_KEY_WORD(n, 0, modded), CONTINUE_KEY_WORD(n, 1, modded),                          \
+            CONTINUE_KEY_WORD(n, 2, modded), CONTINUE_KEY_WORD(n, 3, modded),                      \
+            CONTINUE_KEY_WORD(n, 4, modded), CONTINUE_KEY_WORD(n, 5, modded),                      \
+            CONTINUE_KEY_WORD(n, 6, modded), CONTINUE_KEY_WORD(n, 7, modded),                      \
+    }
+
 #define KP_INST(n)                                                                                 \
     static struct behavior_caps_word_data behavior_caps_word_data_##n = {.active = false};         \
     static struct behavior_caps_word_config behavior_caps_word_config_##n = {                      \
         .index = n,                                                                                \
         .mods = DT_INST_PROP_OR(n, mods, MOD_LSFT),                                                \
+        .continue_keys = CONTINUE_KEYS(n, false),                                                  \
+        .modded_continue_keys = CONTINUE_KEYS(n, true),                                            \
         .continuations = {UTIL_LISTIFY(DT_INST_PROP_LEN(n, continue_list), BREAK_ITEM, n)},        \
         .continuations_count = DT_INST_PROP_LEN(n, continue_list),                                 \
     };                                                                                             \
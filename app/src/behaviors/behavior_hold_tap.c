@@ -11,7 +11,9 @@
 #include <zmk/keys.h>
 #include <dt-bindings/zmk/keys.h>
 #include <logging/log.h>
+#include <settings/settings.h>
 #include <zmk/behavior.h>
+#include <zmk/behavior_timer.h>
 #include <zmk/matrix.h>
 #include <zmk/endpoints.h>
 #include <zmk/event_manager.h>
@@ -19,13 +21,16 @@
 #include <zmk/events/keycode_state_changed.h>
 #include <zmk/behavior.h>
 #include <zmk/keymap.h>
+#include <zmk/position_set.h>
+#include <zmk/position_slots.h>
+#include <zmk/settings.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
 
 #define ZMK_BHV_HOLD_TAP_MAX_HELD 10
-#define ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS 40
+#define ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS CONFIG_ZMK_BEHAVIOR_HOLD_TAP_MAX_CAPTURED_EVENTS
 
 // increase if you have keyboard with more keys.
 #define ZMK_BHV_HOLD_TAP_POSITION_NOT_USED 9999
@@ -52,14 +57,40 @@ enum decision_moment {
     HT_QUICK_TAP,
 };
 
+#define ZMK_BHV_HOLD_TAP_DECISION_MOMENTS (HT_QUICK_TAP + 1)
+
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS)
+// Each histogram bucket i > 0 counts values in [2^(i-1), 2^i), bucket 0 counts zeroes and the
+// last bucket also counts everything above it.
+#define ZMK_BHV_HOLD_TAP_STATS_BUCKETS 16
+
+struct behavior_hold_tap_stats {
+    uint32_t decisions[ZMK_BHV_HOLD_TAP_DECISION_MOMENTS];
+    // Time from the hold-tap press until it was decided, in milliseconds.
+    uint32_t decision_ms[ZMK_BHV_HOLD_TAP_STATS_BUCKETS];
+    // Number of captured events replayed after the decision.
+    uint32_t replayed_events[ZMK_BHV_HOLD_TAP_STATS_BUCKETS];
+    // Time spent replaying them, in microseconds.
+    uint32_t replay_us[ZMK_BHV_HOLD_TAP_STATS_BUCKETS];
+};
+#endif
+
 struct behavior_hold_tap_config {
     int tapping_term_ms;
-    char *hold_behavior_dev;
-    char *tap_behavior_dev;
+    int adaptive_tapping_term_min_ms;
+    struct zmk_behavior_binding hold_binding;
+    struct zmk_behavior_binding tap_binding;
     int quick_tap_ms;
     bool global_quick_tap;
+    int require_prior_idle_ms;
     enum flavor flavor;
     bool retro_tap;
+    bool hold_while_undecided;
+    // hold_trigger_key_positions as a set, filled in by behavior_hold_tap_init.
+    struct zmk_position_set hold_trigger_key_position_set;
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS)
+    struct behavior_hold_tap_stats *stats;
+#endif
     int32_t hold_trigger_key_positions_len;
     int32_t hold_trigger_key_positions[];
 };
@@ -70,10 +101,14 @@ struct active_hold_tap {
     uint32_t param_hold;
     uint32_t param_tap;
     int64_t timestamp;
+    // config->tapping_term_ms, or the learned tapping term for this position.
+    int32_t tapping_term_ms;
     enum status status;
     const struct behavior_hold_tap_config *config;
-    struct k_work_delayable work;
+    struct zmk_behavior_timer timer;
     bool work_is_cancelled;
+    // Set while the hold binding is pressed before the hold-tap is decided.
+    bool speculative_hold;
 
     // initialized to -1, which is to be interpreted as "no other key has been pressed yet"
     int32_t position_of_first_other_key_pressed;
@@ -86,8 +121,19 @@ struct active_hold_tap {
 // its key-up has been processed and the delayed work is cleaned up.
 struct active_hold_tap *undecided_hold_tap = NULL;
 struct active_hold_tap active_hold_taps[ZMK_BHV_HOLD_TAP_MAX_HELD] = {};
+
+BUILD_ASSERT(ZMK_BHV_HOLD_TAP_MAX_HELD <= 32, "Too many hold-taps for active_hold_taps_mask");
+
+// Bit i is set while active_hold_taps[i] is in use, so the position listener can return right away
+// while no hold-tap is active.
+static uint32_t active_hold_taps_mask;
+static struct zmk_position_slots active_hold_tap_slots;
+
 // We capture most position_state_changed events and some modifiers_state_changed events.
-const zmk_event_t *captured_events[ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS] = {};
+// Each undecided hold-tap captures its events into a group of captured_events.
+ZMK_EVENT_CAPTURE_QUEUE_DEFINE(captured_events, ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS);
+// Positions with a key down event captured by undecided_hold_tap.
+static struct zmk_position_set undecided_captured_keydowns;
 
 // Keep track of which key was tapped most recently for the standard, if it is a hold-tap
 // a position, will be given, if not it will just be INT32_MIN
@@ -110,7 +156,123 @@ static void store_last_hold_tapped(struct active_hold_tap *hold_tap) {
     last_tapped.timestamp = hold_tap->timestamp;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_ADAPTIVE_TAPPING_TERM)
+
+// Taps per position to see before the learned tapping term is used.
+#define ZMK_BHV_HOLD_TAP_ADAPTIVE_MIN_SAMPLES 8
+
+// Step sizes of the quantile estimate. It settles where taps are longer than the estimate
+// DOWN / (UP + DOWN) of the time, i.e. around the 94th percentile of tap durations.
+#define ZMK_BHV_HOLD_TAP_ADAPTIVE_STEP_UP_MS 16
+#define ZMK_BHV_HOLD_TAP_ADAPTIVE_STEP_DOWN_MS 1
+
+// Streaming estimate of how long a key position is held when tapped. This is also the format
+// persisted to settings.
+struct tap_duration_estimate {
+    uint16_t quantile_ms;
+    uint8_t samples;
+    uint8_t reserved;
+};
+
+static struct tap_duration_estimate tap_durations[ZMK_KEYMAP_LEN];
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static void tap_durations_save_work() {
+    int err = settings_save_one("hold_tap/tap_durations", tap_durations, sizeof(tap_durations));
+    if (err) {
+        LOG_ERR("Failed to save hold-tap tap durations (err %d)", err);
+    }
+}
+
+ZMK_SETTINGS_SAVE_DEFINE(tap_durations_save, tap_durations_save_work);
+
+static int tap_durations_handle_set(const char *name, size_t len, settings_read_cb read_cb,
+                                    void *cb_arg) {
+    if (!settings_name_steq(name, "tap_durations", NULL)) {
+        return 0;
+    }
+
+    // Statistics for a different key count don't map to these positions, so start over.
+    if (len != sizeof(tap_durations)) {
+        LOG_WRN("Ignoring saved tap durations for a different keymap size (got %d)", len);
+        return 0;
+    }
+
+    int err = read_cb(cb_arg, tap_durations, len);
+    if (err <= 0) {
+        LOG_ERR("Failed to read hold-tap tap durations from settings (err %d)", err);
+        memset(tap_durations, 0, sizeof(tap_durations));
+        return err;
+    }
+
+    return 0;
+}
+
+// Without saved statistics, hold-taps just start learning from scratch.
+SETTINGS_STATIC_HANDLER_DEFINE(tap_durations, "hold_tap", NULL, tap_durations_handle_set, NULL,
+                               NULL);
+#endif /* IS_ENABLED(CONFIG_SETTINGS) */
+
+static void record_tap_duration(uint32_t position, int64_t duration) {
+    if (position >= ZMK_KEYMAP_LEN || duration < 0 || duration > UINT16_MAX) {
+        return;
+    }
+
+    struct tap_duration_estimate *estimate = &tap_durations[position];
+    uint16_t previous = estimate->quantile_ms;
+
+    if (estimate->samples == 0) {
+        estimate->quantile_ms = duration;
+    } else if (duration > estimate->quantile_ms) {
+        estimate->quantile_ms =
+            MIN(estimate->quantile_ms + ZMK_BHV_HOLD_TAP_ADAPTIVE_STEP_UP_MS, duration);
+    } else if (duration < estimate->quantile_ms) {
+        estimate->quantile_ms -= ZMK_BHV_HOLD_TAP_ADAPTIVE_STEP_DOWN_MS;
+    }
+
+    if (estimate->samples < ZMK_BHV_HOLD_TAP_ADAPTIVE_MIN_SAMPLES) {
+        estimate->samples++;
+    } else if (estimate->quantile_ms == previous) {
+        return;
+    }
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+    zmk_settings_save(&tap_durations_save);
+#endif
+}
+
+static int32_t learned_tapping_term_ms(uint32_t position,
+                                       const struct behavior_hold_tap_config *config) {
+    if (config->adaptive_tapping_term_min_ms < 0 || position >= ZMK_KEYMAP_LEN ||
+        tap_durations[position].samples < ZMK_BHV_HOLD_TAP_ADAPTIVE_MIN_SAMPLES) {
+        return config->tapping_term_ms;
+    }
+
+    // Leave some headroom above the estimate, since taps slower than the tapping term become
+    // holds and are never measured.
+    int32_t quantile_ms = tap_durations[position].quantile_ms;
+    return CLAMP(quantile_ms + quantile_ms / 4, config->adaptive_tapping_term_min_ms,
+                 config->tapping_term_ms);
+}
+
+#else
+
+static inline void record_tap_duration(uint32_t position, int64_t duration) {}
+
+static inline int32_t learned_tapping_term_ms(uint32_t position,
+                                              const struct behavior_hold_tap_config *config) {
+    return config->tapping_term_ms;
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_ADAPTIVE_TAPPING_TERM) */
+
 static bool is_quick_tap(struct active_hold_tap *hold_tap) {
+    // While typing, any key pressed shortly before the hold-tap makes it a tap right away.
+    if (hold_tap->config->require_prior_idle_ms >= 0 &&
+        (last_tapped.timestamp + hold_tap->config->require_prior_idle_ms) > hold_tap->timestamp) {
+        return true;
+    }
+
     if (hold_tap->config->global_quick_tap || last_tapped.position == hold_tap->position) {
         return (last_tapped.timestamp + hold_tap->config->quick_tap_ms) > hold_tap->timestamp;
     } else {
@@ -119,72 +281,70 @@ static bool is_quick_tap(struct active_hold_tap *hold_tap) {
 }
 
 static int capture_event(const zmk_event_t *event) {
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        if (captured_events[i] == NULL) {
-            captured_events[i] = event;
-            return 0;
-        }
+    int err = zmk_event_capture_queue_push(&captured_events, event);
+    if (err) {
+        return err;
+    }
+
+    struct zmk_position_state_changed *position_event = as_zmk_position_state_changed(event);
+    if (position_event != NULL && position_event->state) {
+        zmk_position_set_add(&undecided_captured_keydowns, position_event->position);
     }
-    return -ENOMEM;
+
+    return 0;
 }
 
-static struct zmk_position_state_changed *find_captured_keydown_event(uint32_t position) {
-    struct zmk_position_state_changed *last_match = NULL;
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        const zmk_event_t *eh = captured_events[i];
-        if (eh == NULL) {
-            return last_match;
-        }
-        struct zmk_position_state_changed *position_event = as_zmk_position_state_changed(eh);
-        if (position_event == NULL) {
-            continue;
-        }
+static bool is_keydown_captured(uint32_t position) {
+    if (position < ZMK_KEYMAP_LEN) {
+        return zmk_position_set_test(&undecided_captured_keydowns, position);
+    }
 
-        if (position_event->position == position && position_event->state) {
-            last_match = position_event;
+    for (uint32_t i = captured_events.group_start; i != captured_events.tail; i++) {
+        struct zmk_position_state_changed *position_event =
+            as_zmk_position_state_changed(zmk_event_capture_queue_at(&captured_events, i));
+        if (position_event != NULL && position_event->position == position &&
+            position_event->state) {
+            return true;
         }
     }
-    return last_match;
+    return false;
 }
 
 const struct zmk_listener zmk_listener_behavior_hold_tap;
 
-static void release_captured_events() {
+// Returns the number of events released.
+static int release_captured_events() {
     if (undecided_hold_tap != NULL) {
-        return;
+        return 0;
     }
 
-    // We use a trick to prevent copying the captured_events array.
+    // Only the group captured by the hold-tap that was just decided is released here.
     //
-    // Events for different mod-tap instances are separated by a NULL pointer.
-    //
-    // The first event popped will never be catched by the next active hold-tap
-    // because to start capturing a mod-tap-key-down event must first completely
-    // go through the events queue.
+    // Releasing an event can make another hold-tap undecided, which then captures some of the
+    // following events again into a new group after this one. If that hold-tap is decided before
+    // this loop finishes, it releases its own group first.
     //
     // Example of this release process;
-    // [mt2_down, k1_down, k1_up, mt2_up, null, ...]
+    // [mt2_down, k1_down, k1_up, mt2_up]
     //  ^
     // mt2_down position event isn't captured because no hold-tap is active.
     // mt2_down behavior event is handled, now we have an undecided hold-tap
-    // [null, k1_down, k1_up, mt2_up, null, ...]
+    // [null, k1_down, k1_up, mt2_up]
     //        ^
-    // k1_down  is captured by the mt2 mod-tap
-    // !note that searches for find_captured_keydown_event by the mt2 behavior will stop at the
-    // first null encountered [mt1_down, null, k1_up, mt2_up, null, ...]
-    //                  ^
+    // k1_down is captured by the mt2 mod-tap
+    // [null, null, k1_up, mt2_up, k1_down]
+    //              ^
     // k1_up event is captured by the new hold-tap:
-    // [k1_down, k1_up, null, mt2_up, null, ...]
-    //                        ^
+    // [null, null, null, mt2_up, k1_down, k1_up]
+    //                    ^
     // mt2_up event is not captured but causes release of mt2 behavior
-    // [k1_down, k1_up, null, null, null, ...]
     // now mt2 will start releasing it's own captured positions.
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        const zmk_event_t *captured_event = captured_events[i];
-        if (captured_event == NULL) {
-            return;
-        }
-        captured_events[i] = NULL;
+    struct zmk_event_capture_group group = zmk_event_capture_queue_take_group(&captured_events);
+    zmk_position_set_clear(&undecided_captured_keydowns);
+
+    const zmk_event_t *captured_event;
+    int released = 0;
+    while ((captured_event = zmk_event_capture_queue_next(&captured_events, &group)) != NULL) {
         if (undecided_hold_tap != NULL) {
             k_msleep(10);
         }
@@ -199,10 +359,18 @@ static void release_captured_events() {
                     (modifier_event->state ? "pressed" : "released"));
         }
         ZMK_EVENT_RAISE_AT(captured_event, behavior_hold_tap);
+        released++;
     }
+
+    return released;
 }
 
 static struct active_hold_tap *find_hold_tap(uint32_t position) {
+    int slot = zmk_position_slots_get(&active_hold_tap_slots, position);
+    if (slot != -ERANGE) {
+        return slot >= 0 ? &active_hold_taps[slot] : NULL;
+    }
+
     for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_HELD; i++) {
         if (active_hold_taps[i].position == position) {
             return &active_hold_taps[i];
@@ -224,16 +392,24 @@ static struct active_hold_tap *store_hold_tap(uint32_t position, uint32_t param_
         active_hold_taps[i].param_hold = param_hold;
         active_hold_taps[i].param_tap = param_tap;
         active_hold_taps[i].timestamp = timestamp;
+        active_hold_taps[i].tapping_term_ms = learned_tapping_term_ms(position, config);
         active_hold_taps[i].position_of_first_other_key_pressed = -1;
+        active_hold_taps_mask |= BIT(i);
+        zmk_position_slots_set(&active_hold_tap_slots, position, i);
         return &active_hold_taps[i];
     }
     return NULL;
 }
 
 static void clear_hold_tap(struct active_hold_tap *hold_tap) {
+    const int slot = hold_tap - active_hold_taps;
+
+    active_hold_taps_mask &= ~BIT(slot);
+    zmk_position_slots_clear(&active_hold_tap_slots, hold_tap->position, slot);
     hold_tap->position = ZMK_BHV_HOLD_TAP_POSITION_NOT_USED;
     hold_tap->status = STATUS_UNDECIDED;
     hold_tap->work_is_cancelled = false;
+    hold_tap->speculative_hold = false;
 }
 
 static void decide_balanced(struct active_hold_tap *hold_tap, enum decision_moment event) {
@@ -357,6 +533,41 @@ static inline const char *decision_moment_str(enum decision_moment decision_mome
     }
 }
 
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS)
+static void stats_histogram_add(uint32_t *histogram, uint32_t value) {
+    int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    histogram[MIN(bucket, ZMK_BHV_HOLD_TAP_STATS_BUCKETS - 1)]++;
+}
+
+static void record_decision_stats(const struct behavior_hold_tap_config *config,
+                                  enum decision_moment decision_moment, int64_t decision_ms,
+                                  int replayed_events, uint32_t replay_cycles) {
+    struct behavior_hold_tap_stats *stats = config->stats;
+
+    stats->decisions[decision_moment]++;
+    stats_histogram_add(stats->decision_ms, CLAMP(decision_ms, 0, UINT32_MAX));
+    stats_histogram_add(stats->replayed_events, replayed_events);
+    stats_histogram_add(stats->replay_us, k_cyc_to_us_floor32(replay_cycles));
+}
+#else
+static inline void record_decision_stats(const struct behavior_hold_tap_config *config,
+                                         enum decision_moment decision_moment,
+                                         int64_t decision_ms, int replayed_events,
+                                         uint32_t replay_cycles) {}
+#endif /* IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS) */
+
+// The config lives in RAM, so the hold and tap bindings cache their resolved device in place.
+static struct zmk_behavior_binding resolved_binding(const struct zmk_behavior_binding *binding) {
+    behavior_get_binding_device((struct zmk_behavior_binding *)binding);
+    return *binding;
+}
+
+static struct zmk_behavior_binding hold_binding(struct active_hold_tap *hold_tap) {
+    struct zmk_behavior_binding binding = resolved_binding(&hold_tap->config->hold_binding);
+    binding.param1 = hold_tap->param_hold;
+    return binding;
+}
+
 static int press_binding(struct active_hold_tap *hold_tap) {
     if (hold_tap->config->retro_tap && hold_tap->status == STATUS_HOLD_TIMER) {
         return 0;
@@ -367,12 +578,22 @@ static int press_binding(struct active_hold_tap *hold_tap) {
         .timestamp = hold_tap->timestamp,
     };
 
-    struct zmk_behavior_binding binding = {0};
+    struct zmk_behavior_binding binding;
     if (hold_tap->status == STATUS_HOLD_TIMER || hold_tap->status == STATUS_HOLD_INTERRUPT) {
-        binding.behavior_dev = hold_tap->config->hold_behavior_dev;
-        binding.param1 = hold_tap->param_hold;
+        if (hold_tap->speculative_hold) {
+            // Pressed since the hold-tap itself was, so the hold just stays.
+            hold_tap->speculative_hold = false;
+            return 0;
+        }
+        binding = hold_binding(hold_tap);
     } else {
-        binding.behavior_dev = hold_tap->config->tap_behavior_dev;
+        if (hold_tap->speculative_hold) {
+            LOG_DBG("%d releasing the hold pressed while undecided", hold_tap->position);
+            hold_tap->speculative_hold = false;
+            binding = hold_binding(hold_tap);
+            behavior_keymap_binding_released(&binding, event);
+        }
+        binding = resolved_binding(&hold_tap->config->tap_binding);
         binding.param1 = hold_tap->param_tap;
         store_last_hold_tapped(hold_tap);
     }
@@ -389,21 +610,24 @@ static int release_binding(struct active_hold_tap *hold_tap) {
         .timestamp = hold_tap->timestamp,
     };
 
-    struct zmk_behavior_binding binding = {0};
+    struct zmk_behavior_binding binding;
     if (hold_tap->status == STATUS_HOLD_TIMER || hold_tap->status == STATUS_HOLD_INTERRUPT) {
-        binding.behavior_dev = hold_tap->config->hold_behavior_dev;
-        binding.param1 = hold_tap->param_hold;
+        binding = hold_binding(hold_tap);
     } else {
-        binding.behavior_dev = hold_tap->config->tap_behavior_dev;
+        binding = resolved_binding(&hold_tap->config->tap_binding);
         binding.param1 = hold_tap->param_tap;
     }
     return behavior_keymap_binding_released(&binding, event);
 }
 
 static bool is_first_other_key_pressed_trigger_key(struct active_hold_tap *hold_tap) {
+    int32_t position = hold_tap->position_of_first_other_key_pressed;
+    if (position < ZMK_KEYMAP_LEN) {
+        return zmk_position_set_test(&hold_tap->config->hold_trigger_key_position_set, position);
+    }
+
     for (int i = 0; i < hold_tap->config->hold_trigger_key_positions_len; i++) {
-        if (hold_tap->config->hold_trigger_key_positions[i] ==
-            hold_tap->position_of_first_other_key_pressed) {
+        if (hold_tap->config->hold_trigger_key_positions[i] == position) {
             return true;
         }
     }
@@ -473,7 +697,14 @@ static void decide_hold_tap(struct active_hold_tap *hold_tap,
             decision_moment_str(decision_moment));
     undecided_hold_tap = NULL;
     press_binding(hold_tap);
-    release_captured_events();
+
+    // Replaying can press and decide other hold-taps, so take what the stats need beforehand.
+    const struct behavior_hold_tap_config *config = hold_tap->config;
+    int64_t decision_ms = k_uptime_get() - hold_tap->timestamp;
+    uint32_t replay_start = k_cycle_get_32();
+    int replayed_events = release_captured_events();
+    record_decision_stats(config, decision_moment, decision_ms, replayed_events,
+                          k_cycle_get_32() - replay_start);
 }
 
 static void decide_retro_tap(struct active_hold_tap *hold_tap) {
@@ -490,8 +721,8 @@ static void decide_retro_tap(struct active_hold_tap *hold_tap) {
 }
 
 static void update_hold_status_for_retro_tap(uint32_t ignore_position) {
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_HELD; i++) {
-        struct active_hold_tap *hold_tap = &active_hold_taps[i];
+    for (uint32_t pending = active_hold_taps_mask; pending != 0; pending &= pending - 1) {
+        struct active_hold_tap *hold_tap = &active_hold_taps[__builtin_ctz(pending)];
         if (hold_tap->position == ignore_position ||
             hold_tap->position == ZMK_BHV_HOLD_TAP_POSITION_NOT_USED ||
             hold_tap->config->retro_tap == false) {
@@ -507,7 +738,7 @@ static void update_hold_status_for_retro_tap(uint32_t ignore_position) {
 
 static int on_hold_tap_binding_pressed(struct zmk_behavior_binding *binding,
                                        struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     const struct behavior_hold_tap_config *cfg = dev->config;
 
     if (undecided_hold_tap != NULL) {
@@ -525,16 +756,28 @@ static int on_hold_tap_binding_pressed(struct zmk_behavior_binding *binding,
     }
 
     LOG_DBG("%d new undecided hold_tap", event.position);
+    const bool quick_tap = is_quick_tap(hold_tap);
+
+    // Pressed before the hold-tap becomes undecided, so the modifier it sends isn't captured and
+    // reaches the host right away. A tap decision releases it again before pressing the tap.
+    if (cfg->hold_while_undecided && !quick_tap) {
+        struct zmk_behavior_binding hold = hold_binding(hold_tap);
+        hold_tap->speculative_hold = true;
+        behavior_keymap_binding_pressed(&hold, event);
+    }
+
     undecided_hold_tap = hold_tap;
+    zmk_event_capture_queue_start_group(&captured_events);
 
-    if (is_quick_tap(hold_tap)) {
+    if (quick_tap) {
         decide_hold_tap(hold_tap, HT_QUICK_TAP);
+        // Decided already, so there is nothing for the timer to do.
+        return ZMK_BEHAVIOR_OPAQUE;
     }
 
-    // if this behavior was queued we have to adjust the timer to only
-    // wait for the remaining time.
-    int32_t tapping_term_ms_left = (hold_tap->timestamp + cfg->tapping_term_ms) - k_uptime_get();
-    k_work_schedule(&hold_tap->work, K_MSEC(tapping_term_ms_left));
+    // The deadline is relative to the press, so a queued behavior only waits for the remaining
+    // time.
+    zmk_behavior_timer_schedule(&hold_tap->timer, hold_tap->timestamp + hold_tap->tapping_term_ms);
 
     return ZMK_BEHAVIOR_OPAQUE;
 }
@@ -549,12 +792,20 @@ static int on_hold_tap_binding_released(struct zmk_behavior_binding *binding,
 
     // If these events were queued, the timer event may be queued too late or not at all.
     // We insert a timer event before the TH_KEY_UP event to verify.
-    int work_cancel_result = k_work_cancel_delayable(&hold_tap->work);
-    if (event.timestamp > (hold_tap->timestamp + hold_tap->config->tapping_term_ms)) {
+    int work_cancel_result = zmk_behavior_timer_cancel(&hold_tap->timer);
+    if (event.timestamp > (hold_tap->timestamp + hold_tap->tapping_term_ms)) {
         decide_hold_tap(hold_tap, HT_TIMER_EVENT);
     }
 
     decide_hold_tap(hold_tap, HT_KEY_UP);
+
+    // Only taps released within the tapping term are real taps. Quick-taps can be held and retro
+    // taps are, by definition, longer than the tapping term.
+    if (hold_tap->status == STATUS_TAP &&
+        event.timestamp <= (hold_tap->timestamp + hold_tap->tapping_term_ms)) {
+        record_tap_duration(hold_tap->position, event.timestamp - hold_tap->timestamp);
+    }
+
     decide_retro_tap(hold_tap);
     release_binding(hold_tap);
 
@@ -579,6 +830,10 @@ static const struct behavior_driver_api behavior_hold_tap_driver_api = {
 static int position_state_changed_listener(const zmk_event_t *eh) {
     struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
 
+    if (active_hold_taps_mask == 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
     update_hold_status_for_retro_tap(ev->position);
 
     if (undecided_hold_tap == NULL) {
@@ -608,7 +863,7 @@ static int position_state_changed_listener(const zmk_event_t *eh) {
     // We make a timer decision before the other key events are handled if the timer would
     // have run out.
     if (ev->timestamp >
-        (undecided_hold_tap->timestamp + undecided_hold_tap->config->tapping_term_ms)) {
+        (undecided_hold_tap->timestamp + undecided_hold_tap->tapping_term_ms)) {
         decide_hold_tap(undecided_hold_tap, HT_TIMER_EVENT);
     }
 
@@ -616,7 +871,7 @@ static int position_state_changed_listener(const zmk_event_t *eh) {
         return ZMK_EV_EVENT_BUBBLE;
     }
 
-    if (!ev->state && find_captured_keydown_event(ev->position) == NULL) {
+    if (!ev->state && !is_keydown_captured(ev->position)) {
         // no keydown event has been captured, let it bubble.
         // we'll catch modifiers later in modifier_state_changed_listener
         LOG_DBG("%d bubbling %d %s event", undecided_hold_tap->position, ev->position,
@@ -626,7 +881,9 @@ static int position_state_changed_listener(const zmk_event_t *eh) {
 
     LOG_DBG("%d capturing %d %s event", undecided_hold_tap->position, ev->position,
             ev->state ? "down" : "up");
-    capture_event(eh);
+    if (capture_event(eh) < 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
     decide_hold_tap(undecided_hold_tap, ev->state ? HT_OTHER_KEY_DOWN : HT_OTHER_KEY_UP);
     return ZMK_EV_EVENT_CAPTURED;
 }
@@ -653,7 +910,9 @@ static int keycode_state_changed_listener(const zmk_event_t *eh) {
     // if a undecided_hold_tap is active.
     LOG_DBG("%d capturing 0x%02X %s event", undecided_hold_tap->position, ev->keycode,
             ev->state ? "down" : "up");
-    capture_event(eh);
+    if (capture_event(eh) < 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
     return ZMK_EV_EVENT_CAPTURED;
 }
 
@@ -667,12 +926,12 @@ int behavior_hold_tap_listener(const zmk_event_t *eh) {
 }
 
 ZMK_LISTENER(behavior_hold_tap, behavior_hold_tap_listener);
-ZMK_SUBSCRIPTION(behavior_hold_tap, zmk_position_state_changed);
+ZMK_SUBSCRIPTION_CAPTURING(behavior_hold_tap, zmk_position_state_changed);
 // this should be modifiers_state_changed, but unfrotunately that's not implemented yet.
-ZMK_SUBSCRIPTION(behavior_hold_tap, zmk_keycode_state_changed);
+ZMK_SUBSCRIPTION_CAPTURING(behavior_hold_tap, zmk_keycode_state_changed);
 
-void behavior_hold_tap_timer_work_handler(struct k_work *item) {
-    struct active_hold_tap *hold_tap = CONTAINER_OF(item, struct active_hold_tap, work);
+void behavior_hold_tap_timer_handler(struct zmk_behavior_timer *timer) {
+    struct active_hold_tap *hold_tap = CONTAINER_OF(timer, struct active_hold_tap, timer);
 
     if (hold_tap->work_is_cancelled) {
         clear_hold_tap(hold_tap);
@@ -683,10 +942,15 @@ void behavior_hold_tap_timer_work_handler(struct k_work *item) {
 
 static int behavior_hold_tap_init(const struct device *dev) {
     static bool init_first_run = true;
+    struct behavior_hold_tap_config *config = (struct behavior_hold_tap_config *)dev->config;
+
+    zmk_position_set_add_list(&config->hold_trigger_key_position_set,
+                              config->hold_trigger_key_positions,
+                              config->hold_trigger_key_positions_len);
 
     if (init_first_run) {
         for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_HELD; i++) {
-            k_work_init_delayable(&active_hold_taps[i].work, behavior_hold_tap_timer_work_handler);
+            zmk_behavior_timer_init(&active_hold_taps[i].timer, behavior_hold_tap_timer_handler);
             active_hold_taps[i].position = ZMK_BHV_HOLD_TAP_POSITION_NOT_USED;
         }
     }
@@ -694,17 +958,30 @@ static int behavior_hold_tap_init(const struct device *dev) {
     return 0;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS)
+#define KP_STATS_DEFINE(n) static struct behavior_hold_tap_stats behavior_hold_tap_stats_##n;
+#define KP_STATS_INIT(n) .stats = &behavior_hold_tap_stats_##n,
+#else
+#define KP_STATS_DEFINE(n)
+#define KP_STATS_INIT(n)
+#endif
+
 #define KP_INST(n)                                                                                 \
+    KP_STATS_DEFINE(n)                                                                             \
     static struct behavior_hold_tap_config behavior_hold_tap_config_##n = {                        \
         .tapping_term_ms = DT_INST_PROP(n, tapping_term_ms),                                       \
-        .hold_behavior_dev = DT_LABEL(DT_INST_PHANDLE_BY_IDX(n, bindings, 0)),                     \
-        .tap_behavior_dev = DT_LABEL(DT_INST_PHANDLE_BY_IDX(n, bindings, 1)),                      \
+        .adaptive_tapping_term_min_ms = DT_INST_PROP(n, adaptive_tapping_term_min_ms),             \
+        .hold_binding = {.behavior_dev = DT_LABEL(DT_INST_PHANDLE_BY_IDX(n, bindings, 0))},        \
+        .tap_binding = {.behavior_dev = DT_LABEL(DT_INST_PHANDLE_BY_IDX(n, bindings, 1))},         \
         .quick_tap_ms = DT_INST_PROP(n, quick_tap_ms),                                             \
         .global_quick_tap = DT_INST_PROP(n, global_quick_tap),                                     \
+        .require_prior_idle_ms = DT_INST_PROP(n, require_prior_idle_ms),                           \
         .flavor = DT_ENUM_IDX(DT_DRV_INST(n), flavor),                                             \
         .retro_tap = DT_INST_PROP(n, retro_tap),                                                   \
+        .hold_while_undecided = DT_INST_PROP(n, hold_while_undecided),                             \
         .hold_trigger_key_positions = DT_INST_PROP(n, hold_trigger_key_positions),                 \
         .hold_trigger_key_positions_len = DT_INST_PROP_LEN(n, hold_trigger_key_positions),         \
+        KP_STATS_INIT(n)                                                                           \
     };                                                                                             \
     DEVICE_DT_INST_DEFINE(n, behavior_hold_tap_init, NULL, NULL, &behavior_hold_tap_config_##n,    \
                           APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,                        \
@@ -712,4 +989,65 @@ static int behavior_hold_tap_init(const struct device *dev) {
 
 DT_INST_FOREACH_STATUS_OKAY(KP_INST)
 
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS) && IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+#define KP_DEVICE(n) DEVICE_DT_INST_GET(n),
+
+static const struct device *const hold_tap_devices[] = {DT_INST_FOREACH_STATUS_OKAY(KP_DEVICE)};
+
+static void print_histogram(const struct shell *sh, const char *name, const uint32_t *histogram) {
+    char line[ZMK_BHV_HOLD_TAP_STATS_BUCKETS * 7 + 1];
+    int len = 0;
+    for (int i = 0; i < ZMK_BHV_HOLD_TAP_STATS_BUCKETS; i++) {
+        len += snprintk(line + len, sizeof(line) - len, " %6u", histogram[i]);
+    }
+    shell_print(sh, "  %-16s%s", name, line);
+}
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv) {
+    char header[ZMK_BHV_HOLD_TAP_STATS_BUCKETS * 7 + 1];
+    int len = 0;
+    for (int i = 0; i < ZMK_BHV_HOLD_TAP_STATS_BUCKETS; i++) {
+        uint32_t from = i == 0 ? 0 : BIT(i - 1);
+        len += snprintk(header + len, sizeof(header) - len, " %5u%c", from,
+                        i == ZMK_BHV_HOLD_TAP_STATS_BUCKETS - 1 ? '+' : ' ');
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(hold_tap_devices); i++) {
+        const struct behavior_hold_tap_config *config = hold_tap_devices[i]->config;
+        const struct behavior_hold_tap_stats *stats = config->stats;
+
+        shell_print(sh, "%s:", hold_tap_devices[i]->name);
+        for (int moment = 0; moment < ZMK_BHV_HOLD_TAP_DECISION_MOMENTS; moment++) {
+            shell_print(sh, "  %-16s %6u", decision_moment_str(moment), stats->decisions[moment]);
+        }
+        shell_print(sh, "  %-16s%s", "from", header);
+        print_histogram(sh, "decision ms", stats->decision_ms);
+        print_histogram(sh, "replayed events", stats->replayed_events);
+        print_histogram(sh, "replay us", stats->replay_us);
+    }
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ARRAY_SIZE(hold_tap_devices); i++) {
+        const struct behavior_hold_tap_config *config = hold_tap_devices[i]->config;
+        *config->stats = (struct behavior_hold_tap_stats){0};
+    }
+    shell_print(sh, "Hold-tap statistics reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_hold_tap,
+                               SHELL_CMD(stats, NULL, "Show hold-tap decision statistics",
+                                         cmd_stats),
+                               SHELL_CMD(reset, NULL, "Reset hold-tap statistics", cmd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(hold_tap, &sub_hold_tap, "ZMK hold-tap commands", NULL);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP_STATS) && IS_ENABLED(CONFIG_SHELL) */
+
 #endif /* DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) */
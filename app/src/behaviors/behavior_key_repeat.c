@@ -11,6 +11,7 @@
 #include <logging/log.h>
 #include <zmk/behavior.h>
 #include <zmk/hid.h>
+#include <zmk/hid_listener.h>
 
 #include <zmk/event_manager.h>
 #include <zmk/events/keycode_state_changed.h>
@@ -21,6 +22,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 struct behavior_key_repeat_config {
     uint8_t index;
+    bool direct_replay;
     uint8_t usage_pages_count;
     uint16_t usage_pages[];
 };
@@ -30,9 +32,18 @@ struct behavior_key_repeat_data {
     struct zmk_keycode_state_changed current_keycode_pressed;
 };
 
+// Sends the captured key the way the HID listener would for the event, without the other
+// listeners seeing it first.
+static void key_repeat_replay(const struct zmk_keycode_state_changed *ev) {
+    int err = zmk_hid_listener_apply(ev);
+    if (err < 0) {
+        LOG_ERR("Failed to replay keycode 0x%02X (err %d)", ev->keycode, err);
+    }
+}
+
 static int on_key_repeat_binding_pressed(struct zmk_behavior_binding *binding,
                                          struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     struct behavior_key_repeat_data *data = dev->data;
 
     if (data->last_keycode_pressed.usage_page == 0) {
@@ -43,6 +54,12 @@ static int on_key_repeat_binding_pressed(struct zmk_behavior_binding *binding,
            sizeof(struct zmk_keycode_state_changed));
     data->current_keycode_pressed.timestamp = k_uptime_get();
 
+    const struct behavior_key_repeat_config *config = dev->config;
+    if (config->direct_replay) {
+        key_repeat_replay(&data->current_keycode_pressed);
+        return ZMK_BEHAVIOR_OPAQUE;
+    }
+
     ZMK_EVENT_RAISE(new_zmk_keycode_state_changed(data->current_keycode_pressed));
 
     return ZMK_BEHAVIOR_OPAQUE;
@@ -50,7 +67,7 @@ static int on_key_repeat_binding_pressed(struct zmk_behavior_binding *binding,
 
 static int on_key_repeat_binding_released(struct zmk_behavior_binding *binding,
                                           struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     struct behavior_key_repeat_data *data = dev->data;
 
     if (data->current_keycode_pressed.usage_page == 0) {
@@ -60,6 +77,12 @@ static int on_key_repeat_binding_released(struct zmk_behavior_binding *binding,
     data->current_keycode_pressed.timestamp = k_uptime_get();
     data->current_keycode_pressed.state = false;
 
+    const struct behavior_key_repeat_config *config = dev->config;
+    if (config->direct_replay) {
+        key_repeat_replay(&data->current_keycode_pressed);
+        return ZMK_BEHAVIOR_OPAQUE;
+    }
+
     ZMK_EVENT_RAISE(new_zmk_keycode_state_changed(data->current_keycode_pressed));
     return ZMK_BEHAVIOR_OPAQUE;
 }
@@ -113,6 +136,7 @@ static int behavior_key_repeat_init(const struct device *dev) {
     static struct behavior_key_repeat_data behavior_key_repeat_data_##n = {};                      \
     static struct behavior_key_repeat_config behavior_key_repeat_config_##n = {                    \
         .index = n,                                                                                \
+        .direct_replay = DT_INST_PROP(n, direct_replay),                                           \
         .usage_pages = DT_INST_PROP(n, usage_pages),                                               \
         .usage_pages_count = DT_INST_PROP_LEN(n, usage_pages),                                     \
     };                                                                                             \
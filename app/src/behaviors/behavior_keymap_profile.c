@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_keymap_profile
+
+#include <device.h>
+#include <drivers/behavior.h>
+#include <logging/log.h>
+
+#include <zmk/keymap.h>
+#include <zmk/behavior.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+static int behavior_keymap_profile_init(const struct device *dev) { return 0; };
+
+static int keymap_profile_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                                 struct zmk_behavior_binding_event event) {
+    LOG_DBG("position %d profile %d", event.position, binding->param1);
+    int err = zmk_keymap_profile_select(binding->param1);
+    if (err < 0) {
+        LOG_ERR("Failed to select keymap profile %d (err %d)", binding->param1, err);
+    }
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static int keymap_profile_keymap_binding_released(struct zmk_behavior_binding *binding,
+                                                  struct zmk_behavior_binding_event event) {
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static const struct behavior_driver_api behavior_keymap_profile_driver_api = {
+    .binding_pressed = keymap_profile_keymap_binding_pressed,
+    .binding_released = keymap_profile_keymap_binding_released,
+};
+
+DEVICE_DT_INST_DEFINE(0, behavior_keymap_profile_init, NULL, NULL, NULL, APPLICATION,
+                      CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &behavior_keymap_profile_driver_api);
+
+#endif /* DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) */
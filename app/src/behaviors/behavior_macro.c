@@ -13,6 +13,13 @@
 #include <zmk/behavior_queue.h>
 #include <zmk/keymap.h>
 
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+#include <dt-bindings/zmk/hid_usage_pages.h>
+#include <dt-bindings/zmk/modifiers.h>
+#include <zmk/endpoints.h>
+#include <zmk/keys.h>
+#endif
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
@@ -27,19 +34,40 @@ struct behavior_macro_trigger_state {
     uint32_t wait_ms;
     uint32_t tap_ms;
     enum behavior_macro_mode mode;
+};
+
+// A regular binding of the macro, with the mode and timing set by the control bindings before it.
+// The binding itself is kept at the same index of the state's bindings.
+struct behavior_macro_op {
+    enum behavior_macro_mode mode;
+    uint32_t tap_ms;
+    uint32_t wait_ms;
+    // Number of bindings, starting with this one, tapped together in one report.
+    uint8_t burst;
+};
+
+// The ops run when the macro is pressed or released. The binding range is kept for logging.
+struct behavior_macro_section {
     uint16_t start_index;
     uint16_t count;
+    uint16_t ops_start;
+    uint16_t ops_count;
 };
 
+// Only the regular bindings are copied to RAM, where their devices get resolved. The program with
+// its control bindings stays in the const config.
 struct behavior_macro_state {
-    struct behavior_macro_trigger_state release_state;
-
-    uint32_t press_bindings_count;
+    struct behavior_macro_section press;
+    struct behavior_macro_section release;
+    struct behavior_macro_op *ops;
+    struct zmk_behavior_binding *bindings;
 };
 
 struct behavior_macro_config {
     uint32_t default_wait_ms;
     uint32_t default_tap_ms;
+    bool burst;
+    bool paced;
     uint32_t count;
     struct zmk_behavior_binding bindings[];
 };
@@ -85,78 +113,193 @@ static bool handle_control_binding(struct behavior_macro_trigger_state *state,
     return true;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+#define KEY_PRESS DT_LABEL(DT_INST(0, zmk_behavior_key_press))
+
+// HKRO reports leave room for keys held while the macro runs, since a burst presses all of its keys
+// before releasing any. NKRO reports hold every key, so only the batch size limits a burst.
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO)
+#define BURST_MAX_LEN                                                                              \
+    MAX(1, MIN(CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE / 2, ZMK_ENDPOINTS_BATCH_MAX_USAGES))
+#else
+#define BURST_MAX_LEN ZMK_ENDPOINTS_BATCH_MAX_USAGES
+#endif
+
+// Returns the keyboard usage a binding taps, or 0 if it can't be part of a burst: only plain key
+// presses without implicit modifiers qualify, and modifiers are left out since they would apply to
+// the other keys of the report.
+static uint16_t burst_usage(const struct zmk_behavior_binding *binding) {
+    if (!ZM_IS_NODE_MATCH(binding->behavior_dev, KEY_PRESS)) {
+        return 0;
+    }
+
+    uint8_t page = ZMK_HID_USAGE_PAGE(binding->param1);
+    uint16_t id = ZMK_HID_USAGE_ID(binding->param1);
+    if ((page != 0 && page != HID_USAGE_KEY) || SELECT_MODS(binding->param1) != 0 ||
+        is_mod(HID_USAGE_KEY, id)) {
+        return 0;
+    }
+
+    return id;
+}
+
+// Groups runs of taps which can share a report. Hosts handle the keys of a report in usage order,
+// so a run only continues while the usages increase, which also keeps repeated keys apart.
+static void compile_bursts(struct behavior_macro_state *state,
+                           const struct behavior_macro_section *section) {
+    int end = section->ops_start + section->ops_count;
+
+    for (int i = section->ops_start; i < end; i += state->ops[i].burst) {
+        struct behavior_macro_op *op = &state->ops[i];
+        uint16_t usage = burst_usage(&state->bindings[i]);
+        if (op->mode != MACRO_MODE_TAP || usage == 0) {
+            continue;
+        }
+
+        while (i + op->burst < end && op->burst < BURST_MAX_LEN) {
+            const struct behavior_macro_op *next = &state->ops[i + op->burst];
+            uint16_t next_usage = burst_usage(&state->bindings[i + op->burst]);
+            if (next->mode != MACRO_MODE_TAP || next_usage <= usage) {
+                break;
+            }
+
+            // The run takes the timing of its last tap.
+            op->tap_ms = next->tap_ms;
+            op->wait_ms = next->wait_ms;
+            op->burst++;
+            usage = next_usage;
+        }
+
+        if (op->burst > 1) {
+            LOG_DBG("Burst of %d taps at %d", op->burst, i);
+        }
+    }
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MACRO_BURST) */
+
+// Turns the bindings of a section into ops starting at section->ops_start, so triggering the macro
+// doesn't have to look at the control bindings again.
+static void compile_section(const struct behavior_macro_config *cfg,
+                            struct behavior_macro_state *state,
+                            struct behavior_macro_section *section,
+                            struct behavior_macro_trigger_state trigger) {
+    section->ops_count = 0;
+
+    for (int i = section->start_index; i < section->start_index + section->count; i++) {
+        if (handle_control_binding(&trigger, &cfg->bindings[i])) {
+            continue;
+        }
+
+        int index = section->ops_start + section->ops_count++;
+        struct behavior_macro_op *op = &state->ops[index];
+        state->bindings[index] = cfg->bindings[i];
+        op->mode = trigger.mode;
+        op->tap_ms = trigger.tap_ms;
+        op->wait_ms = trigger.wait_ms;
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+        if (cfg->paced) {
+            op->tap_ms |= ZMK_BEHAVIOR_QUEUE_PACED;
+            op->wait_ms |= ZMK_BEHAVIOR_QUEUE_PACED;
+        }
+#endif
+        op->burst = 1;
+        // Behaviors initialized after this macro are resolved on first use instead.
+        behavior_get_binding_device(&state->bindings[index]);
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+    if (cfg->burst) {
+        compile_bursts(state, section);
+    }
+#endif
+}
+
 static int behavior_macro_init(const struct device *dev) {
     const struct behavior_macro_config *cfg = dev->config;
     struct behavior_macro_state *state = dev->data;
-    state->press_bindings_count = cfg->count;
-    state->release_state.start_index = cfg->count;
-    state->release_state.count = 0;
+    state->press.start_index = 0;
+    state->press.count = cfg->count;
+    state->release.start_index = cfg->count;
+    state->release.count = 0;
 
-    LOG_DBG("Precalculate initial release state:");
     for (int i = 0; i < cfg->count; i++) {
-        if (handle_control_binding(&state->release_state, &cfg->bindings[i])) {
-            // Updated state used for initial state on release.
-        } else if (IS_PAUSE(cfg->bindings[i].behavior_dev)) {
-            state->release_state.start_index = i + 1;
-            state->release_state.count = cfg->count - state->release_state.start_index;
-            state->press_bindings_count = i;
-            LOG_DBG("Release will resume at %d", state->release_state.start_index);
+        if (IS_PAUSE(cfg->bindings[i].behavior_dev)) {
+            state->press.count = i;
+            state->release.start_index = i + 1;
+            state->release.count = cfg->count - state->release.start_index;
+            LOG_DBG("Release will resume at %d", state->release.start_index);
             break;
-        } else {
-            // Ignore regular invokable bindings
         }
     }
 
+    struct behavior_macro_trigger_state press_trigger = {.mode = MACRO_MODE_TAP,
+                                                         .tap_ms = cfg->default_tap_ms,
+                                                         .wait_ms = cfg->default_wait_ms};
+    state->press.ops_start = 0;
+    compile_section(cfg, state, &state->press, press_trigger);
+
+    // The release part starts out with the mode and timing set by the control bindings of the
+    // press part, on top of zero timings rather than the macro defaults.
+    LOG_DBG("Precalculate initial release state:");
+    struct behavior_macro_trigger_state release_trigger = {.mode = MACRO_MODE_TAP};
+    for (int i = 0; i < state->press.count; i++) {
+        handle_control_binding(&release_trigger, &cfg->bindings[i]);
+    }
+    state->release.ops_start = state->press.ops_count;
+    compile_section(cfg, state, &state->release, release_trigger);
+
     return 0;
 };
 
-static void queue_macro(uint32_t position, const struct zmk_behavior_binding bindings[],
-                        struct behavior_macro_trigger_state state) {
-    LOG_DBG("Iterating macro bindings - starting: %d, count: %d", state.start_index, state.count);
-    for (int i = state.start_index; i < state.start_index + state.count; i++) {
-        if (!handle_control_binding(&state, &bindings[i])) {
-            switch (state.mode) {
-            case MACRO_MODE_TAP:
-                zmk_behavior_queue_add(position, bindings[i], true, state.tap_ms);
-                zmk_behavior_queue_add(position, bindings[i], false, state.wait_ms);
-                break;
-            case MACRO_MODE_PRESS:
-                zmk_behavior_queue_add(position, bindings[i], true, state.wait_ms);
-                break;
-            case MACRO_MODE_RELEASE:
-                zmk_behavior_queue_add(position, bindings[i], false, state.wait_ms);
-                break;
-            default:
-                LOG_ERR("Unknown macro mode: %d", state.mode);
+static void queue_macro(uint32_t position, struct behavior_macro_state *state,
+                        const struct behavior_macro_section *section) {
+    LOG_DBG("Iterating macro bindings - starting: %d, count: %d", section->start_index,
+            section->count);
+    for (int i = section->ops_start; i < section->ops_start + section->ops_count;
+         i += state->ops[i].burst) {
+        struct behavior_macro_op *op = &state->ops[i];
+        struct zmk_behavior_binding *binding = &state->bindings[i];
+        switch (op->mode) {
+        case MACRO_MODE_TAP:
+#if IS_ENABLED(CONFIG_ZMK_MACRO_BURST)
+            if (op->burst > 1) {
+                // The queue resolves the devices of the rest of the run as it invokes them.
+                zmk_behavior_queue_add_burst(position, binding, op->burst, op->tap_ms,
+                                             op->wait_ms);
                 break;
             }
+#endif
+            zmk_behavior_queue_add_tap(position, binding, op->tap_ms, op->wait_ms);
+            break;
+        case MACRO_MODE_PRESS:
+            zmk_behavior_queue_add(position, binding, true, op->wait_ms);
+            break;
+        case MACRO_MODE_RELEASE:
+            zmk_behavior_queue_add(position, binding, false, op->wait_ms);
+            break;
+        default:
+            LOG_ERR("Unknown macro mode: %d", op->mode);
+            break;
         }
     }
 }
 
 static int on_macro_binding_pressed(struct zmk_behavior_binding *binding,
                                     struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
-    const struct behavior_macro_config *cfg = dev->config;
+    const struct device *dev = behavior_get_binding_device(binding);
     struct behavior_macro_state *state = dev->data;
-    struct behavior_macro_trigger_state trigger_state = {.mode = MACRO_MODE_TAP,
-                                                         .tap_ms = cfg->default_tap_ms,
-                                                         .wait_ms = cfg->default_wait_ms,
-                                                         .start_index = 0,
-                                                         .count = state->press_bindings_count};
 
-    queue_macro(event.position, cfg->bindings, trigger_state);
+    queue_macro(event.position, state, &state->press);
 
     return ZMK_BEHAVIOR_OPAQUE;
 }
 
 static int on_macro_binding_released(struct zmk_behavior_binding *binding,
                                      struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
-    const struct behavior_macro_config *cfg = dev->config;
+    const struct device *dev = behavior_get_binding_device(binding);
     struct behavior_macro_state *state = dev->data;
 
-    queue_macro(event.position, cfg->bindings, state->release_state);
+    queue_macro(event.position, state, &state->release);
 
     return ZMK_BEHAVIOR_OPAQUE;
 }
@@ -172,10 +315,15 @@ static const struct behavior_driver_api behavior_macro_driver_api = {
     {UTIL_LISTIFY(DT_PROP_LEN(DT_DRV_INST(n), bindings), BINDING_WITH_COMMA, n)},
 
 #define MACRO_INST(n)                                                                              \
-    static struct behavior_macro_state behavior_macro_state_##n = {};                              \
-    static struct behavior_macro_config behavior_macro_config_##n = {                              \
+    static struct behavior_macro_op behavior_macro_ops_##n[DT_INST_PROP_LEN(n, bindings)];         \
+    static struct zmk_behavior_binding behavior_macro_bindings_##n[DT_INST_PROP_LEN(n, bindings)]; \
+    static struct behavior_macro_state behavior_macro_state_##n = {                                \
+        .ops = behavior_macro_ops_##n, .bindings = behavior_macro_bindings_##n};                   \
+    static const struct behavior_macro_config behavior_macro_config_##n = {                        \
         .default_wait_ms = DT_INST_PROP_OR(n, wait_ms, CONFIG_ZMK_MACRO_DEFAULT_WAIT_MS),          \
         .default_tap_ms = DT_INST_PROP_OR(n, tap_ms, CONFIG_ZMK_MACRO_DEFAULT_TAP_MS),             \
+        .burst = DT_INST_PROP(n, burst),                                                           \
+        .paced = DT_INST_PROP(n, paced),                                                           \
         .count = DT_INST_PROP_LEN(n, bindings),                                                    \
         .bindings = TRANSFORMED_BEHAVIORS(n)};                                                     \
     DEVICE_DT_INST_DEFINE(n, behavior_macro_init, NULL, &behavior_macro_state_##n,                 \
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_mouse_move
+
+#include <device.h>
+#include <drivers/behavior.h>
+#include <logging/log.h>
+
+#include <zmk/behavior.h>
+#include <zmk/mouse_keys.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+struct behavior_mouse_move_config {
+    struct zmk_mouse_keys_curve curve;
+};
+
+static int behavior_mouse_move_init(const struct device *dev) { return 0; };
+
+// The parameter holds the X speed in its upper and the Y speed in its lower 16 bits.
+static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    const struct device *dev = behavior_get_binding_device(binding);
+    const struct behavior_mouse_move_config *config = dev->config;
+    const int16_t x = binding->param1 >> 16;
+    const int16_t y = binding->param1 & 0xFFFF;
+
+    LOG_DBG("position %d x %d y %d", event.position, x, y);
+
+    return zmk_mouse_keys_start(event.position, ZMK_MOUSE_KEYS_MOVE, x, y, &config->curve,
+                                event.timestamp);
+}
+
+static int on_keymap_binding_released(struct zmk_behavior_binding *binding,
+                                      struct zmk_behavior_binding_event event) {
+    LOG_DBG("position %d", event.position);
+
+    return zmk_mouse_keys_stop(event.position, ZMK_MOUSE_KEYS_MOVE);
+}
+
+static const struct behavior_driver_api behavior_mouse_move_driver_api = {
+    .binding_pressed = on_keymap_binding_pressed, .binding_released = on_keymap_binding_released};
+
+#define MMV_INST(n)                                                                                \
+    static const struct behavior_mouse_move_config behavior_mouse_move_config_##n = {              \
+        .curve =                                                                                   \
+            {                                                                                      \
+                .time_to_max_speed_ms = DT_INST_PROP(n, time_to_max_speed_ms),                     \
+                .acceleration_exponent = DT_INST_PROP(n, acceleration_exponent),                   \
+            },                                                                                     \
+    };                                                                                             \
+    DEVICE_DT_INST_DEFINE(n, behavior_mouse_move_init, NULL, NULL,                                 \
+                          &behavior_mouse_move_config_##n, APPLICATION,                            \
+                          CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &behavior_mouse_move_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(MMV_INST)
+
+#endif
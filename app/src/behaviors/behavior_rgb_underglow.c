@@ -9,10 +9,12 @@
 #include <device.h>
 #include <drivers/behavior.h>
 #include <logging/log.h>
+#include <sys/atomic.h>
 
 #include <dt-bindings/zmk/rgb.h>
 #include <zmk/rgb_underglow.h>
 #include <zmk/keymap.h>
+#include <zmk/split/state_sync.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -20,6 +22,22 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static int behavior_rgb_underglow_init(const struct device *dev) { return 0; }
 
+// Split peripherals get the central's state with RGB_STATE_CMD. On/off is only included after it
+// was changed here, so a peripheral that turned its underglow off by itself, e.g. for
+// CONFIG_ZMK_RGB_UNDERGLOW_AUTO_OFF_USB, keeps it off on color changes.
+#define SYNC_POWER_ON BIT(30)
+#define SYNC_POWER_OFF BIT(31)
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+static atomic_t sync_power;
+
+static uint32_t get_sync_state() {
+    return zmk_rgb_underglow_get_sync_state() | atomic_clear(&sync_power);
+}
+
+ZMK_SPLIT_STATE_SYNC_DEFINE(rgb_underglow_sync, DT_INST_LABEL(0), RGB_STATE_CMD, get_sync_state);
+#endif
+
 static int
 on_keymap_binding_convert_central_state_dependent_params(struct zmk_behavior_binding *binding,
                                                          struct zmk_behavior_binding_event event) {
@@ -96,8 +114,24 @@ on_keymap_binding_convert_central_state_dependent_params(struct zmk_behavior_bin
     return 0;
 };
 
-static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
-                                     struct zmk_behavior_binding_event event) {
+static int apply_sync_state(uint32_t sync_state) {
+    int err = zmk_rgb_underglow_apply_sync_state(sync_state & ~(SYNC_POWER_ON | SYNC_POWER_OFF));
+    if (err) {
+        return err;
+    }
+
+    if (sync_state & SYNC_POWER_ON) {
+        return zmk_rgb_underglow_on();
+    }
+
+    if (sync_state & SYNC_POWER_OFF) {
+        return zmk_rgb_underglow_off();
+    }
+
+    return 0;
+}
+
+static int run_command(struct zmk_behavior_binding *binding) {
     switch (binding->param1) {
     case RGB_TOG_CMD:
         return zmk_rgb_underglow_toggle();
@@ -131,11 +165,33 @@ static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
         return zmk_rgb_underglow_set_hsb((struct zmk_led_hsb){.h = (binding->param2 >> 16) & 0xFFFF,
                                                               .s = (binding->param2 >> 8) & 0xFF,
                                                               .b = binding->param2 & 0xFF});
+    case RGB_STATE_CMD:
+        return apply_sync_state(binding->param2);
     }
 
     return -ENOTSUP;
 }
 
+static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    int err = run_command(binding);
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+    if (err >= 0) {
+        bool on;
+        if ((binding->param1 == RGB_ON_CMD || binding->param1 == RGB_OFF_CMD ||
+             binding->param1 == RGB_TOG_CMD) &&
+            zmk_rgb_underglow_get_state(&on) == 0) {
+            atomic_set(&sync_power, on ? SYNC_POWER_ON : SYNC_POWER_OFF);
+        }
+
+        zmk_split_state_sync_changed(&rgb_underglow_sync);
+    }
+#endif
+
+    return err;
+}
+
 static int on_keymap_binding_released(struct zmk_behavior_binding *binding,
                                       struct zmk_behavior_binding_event event) {
     return ZMK_BEHAVIOR_OPAQUE;
@@ -146,7 +202,8 @@ static const struct behavior_driver_api behavior_rgb_underglow_driver_api = {
         on_keymap_binding_convert_central_state_dependent_params,
     .binding_pressed = on_keymap_binding_pressed,
     .binding_released = on_keymap_binding_released,
-    .locality = BEHAVIOR_LOCALITY_GLOBAL,
+    // The central syncs its state to the peripherals, rather than them running every invocation.
+    .locality = BEHAVIOR_LOCALITY_CENTRAL,
 };
 
 DEVICE_DT_INST_DEFINE(0, behavior_rgb_underglow_init, NULL, NULL, NULL, APPLICATION,
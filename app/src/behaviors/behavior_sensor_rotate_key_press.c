@@ -11,48 +11,119 @@
 #include <logging/log.h>
 
 #include <drivers/sensor.h>
+#include <zmk/behavior_timer.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/keycode_state_changed.h>
+#include <zmk/sensors.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
 
-static int behavior_sensor_rotate_key_press_init(const struct device *dev) { return 0; };
-
-static int on_sensor_binding_triggered(struct zmk_behavior_binding *binding,
-                                       const struct device *sensor, int64_t timestamp) {
-    struct sensor_value value;
-    int err;
+// Without an interval, taps are still sent from the timer, 5ms apart, rather than by sleeping on
+// the thread that dispatched the sensor event.
+#if CONFIG_ZMK_BEHAVIOR_SENSOR_ROTATE_TAP_INTERVAL_MS > 0
+#define TAP_INTERVAL_MS CONFIG_ZMK_BEHAVIOR_SENSOR_ROTATE_TAP_INTERVAL_MS
+#else
+#define TAP_INTERVAL_MS 5
+#endif
+
+#define PENDING_TAPS_LEN COND_CODE_1(ZMK_KEYMAP_HAS_SENSORS, (ZMK_KEYMAP_SENSORS_LEN), (1))
+
+// The taps one sensor still has to send. Positive steps tap the increment keycode, negative ones
+// the decrement keycode, so turning back cancels steps that weren't sent yet.
+struct pending_taps {
+    uint32_t inc_keycode;
+    uint32_t dec_keycode;
+    int32_t steps;
+    // The keycode of the tap whose press was sent, or 0.
+    uint32_t pressed_keycode;
+    // Set while the timer sends taps, until there is nothing left to send.
+    bool sending;
+    struct zmk_behavior_timer timer;
+};
+
+// Indexed by sensor number, since sensors on split peripherals have no local device.
+static struct pending_taps pending_taps[PENDING_TAPS_LEN];
+
+// Sensors trigger on their own threads, while the taps are sent from the behavior timer.
+static struct k_spinlock pending_taps_lock;
+
+static void pending_taps_timer_handler(struct zmk_behavior_timer *timer) {
+    struct pending_taps *taps = CONTAINER_OF(timer, struct pending_taps, timer);
     uint32_t keycode;
-    LOG_DBG("inc keycode 0x%02X dec keycode 0x%02X", binding->param1, binding->param2);
+    bool pressed;
+
+    k_spinlock_key_t key = k_spin_lock(&pending_taps_lock);
+    if (taps->pressed_keycode != 0) {
+        keycode = taps->pressed_keycode;
+        pressed = false;
+        taps->pressed_keycode = 0;
+    } else if (taps->steps != 0) {
+        keycode = taps->steps > 0 ? taps->inc_keycode : taps->dec_keycode;
+        pressed = true;
+        taps->pressed_keycode = keycode;
+        taps->steps += taps->steps > 0 ? -1 : 1;
+    } else {
+        taps->sending = false;
+        k_spin_unlock(&pending_taps_lock, key);
+        return;
+    }
+    k_spin_unlock(&pending_taps_lock, key);
 
-    err = sensor_channel_get(sensor, SENSOR_CHAN_ROTATION, &value);
+    int64_t now = k_uptime_get();
+    ZMK_EVENT_RAISE(zmk_keycode_state_changed_from_encoded(keycode, pressed, now));
+    zmk_behavior_timer_schedule(timer, now + TAP_INTERVAL_MS);
+}
 
-    if (err) {
-        LOG_WRN("Failed to ge sensor rotation value: %d", err);
-        return err;
+static int queue_taps(struct zmk_behavior_binding *binding, uint8_t sensor_number,
+                      int32_t steps) {
+    if (sensor_number >= ARRAY_SIZE(pending_taps)) {
+        return -EINVAL;
     }
 
-    switch (value.val1) {
-    case 1:
-        keycode = binding->param1;
-        break;
-    case -1:
-        keycode = binding->param2;
-        break;
-    default:
-        return -ENOTSUP;
+    struct pending_taps *taps = &pending_taps[sensor_number];
+    k_spinlock_key_t key = k_spin_lock(&pending_taps_lock);
+
+    // The binding may change with the layer, so the keycodes of the latest step are used.
+    taps->inc_keycode = binding->param1;
+    taps->dec_keycode = binding->param2;
+    taps->steps = CLAMP(taps->steps + steps, -CONFIG_ZMK_BEHAVIOR_SENSOR_ROTATE_MAX_PENDING_TAPS,
+                        CONFIG_ZMK_BEHAVIOR_SENSOR_ROTATE_MAX_PENDING_TAPS);
+
+    bool start = !taps->sending;
+    taps->sending = true;
+    k_spin_unlock(&pending_taps_lock, key);
+
+    if (start) {
+        zmk_behavior_timer_schedule(&taps->timer, k_uptime_get());
     }
 
-    LOG_DBG("SEND %d", keycode);
+    return 0;
+}
+
+static int behavior_sensor_rotate_key_press_init(const struct device *dev) {
+    static bool init_first_run = true;
+    if (init_first_run) {
+        for (int i = 0; i < ARRAY_SIZE(pending_taps); i++) {
+            zmk_behavior_timer_init(&pending_taps[i].timer, pending_taps_timer_handler);
+        }
+    }
+    init_first_run = false;
+    return 0;
+};
 
-    ZMK_EVENT_RAISE(zmk_keycode_state_changed_from_encoded(keycode, true, timestamp));
+static int on_sensor_binding_triggered(struct zmk_behavior_binding *binding,
+                                       uint8_t sensor_number, const struct device *sensor,
+                                       struct sensor_value value, int64_t timestamp) {
+    LOG_DBG("inc keycode 0x%02X dec keycode 0x%02X", binding->param1, binding->param2);
 
-    // TODO: Better way to do this?
-    k_msleep(5);
+    if (value.val1 == 0) {
+        return -ENOTSUP;
+    }
 
-    return ZMK_EVENT_RAISE(zmk_keycode_state_changed_from_encoded(keycode, false, timestamp));
+    // Encoders which accumulate steps can report several at once. They are tapped one by one.
+    return queue_taps(binding, sensor_number, value.val1);
 }
 
 static const struct behavior_driver_api behavior_sensor_rotate_key_press_driver_api = {
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_split_activity
+
+#include <device.h>
+#include <drivers/behavior.h>
+#include <logging/log.h>
+
+#include <zmk/activity.h>
+#include <zmk/behavior.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+// The central sends its activity state as the second parameter, with this as the first.
+#define ACTIVITY_STATE_CMD 0
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+#include <zmk/split/state_sync.h>
+
+static uint32_t get_sync_state() { return zmk_activity_get_state(); }
+
+ZMK_SPLIT_STATE_SYNC_DEFINE(activity_sync, DT_INST_LABEL(0), ACTIVITY_STATE_CMD, get_sync_state);
+
+// Sent right away, so the peripherals switch their connection parameters along with the central
+// and hear about sleep before it powers off.
+static int activity_state_listener(const zmk_event_t *eh) {
+    zmk_split_state_sync_now(&activity_sync);
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(behavior_split_activity, activity_state_listener);
+ZMK_SUBSCRIPTION(behavior_split_activity, zmk_activity_state_changed);
+
+// The central only needs the device's label, for the state sync.
+static const struct behavior_driver_api behavior_split_activity_driver_api = {};
+
+#else
+
+static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    if (binding->param1 != ACTIVITY_STATE_CMD || binding->param2 > ZMK_ACTIVITY_SLEEP) {
+        return -ENOTSUP;
+    }
+
+    LOG_DBG("Central activity state %d", binding->param2);
+    zmk_activity_set_central_state(binding->param2);
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static const struct behavior_driver_api behavior_split_activity_driver_api = {
+    .binding_pressed = on_keymap_binding_pressed,
+};
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) */
+
+static int behavior_split_activity_init(const struct device *dev) { return 0; }
+
+DEVICE_DT_INST_DEFINE(0, behavior_split_activity_init, NULL, NULL, NULL, APPLICATION,
+                      CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &behavior_split_activity_driver_api);
+
+#endif /* DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_behavior_split_layer_state
+
+#include <device.h>
+#include <drivers/behavior.h>
+#include <logging/log.h>
+
+#include <zmk/behavior.h>
+#include <zmk/keymap.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
+
+// The central sends its layer state as the second parameter, with this as the first.
+#define LAYER_STATE_CMD 0
+
+BUILD_ASSERT(ZMK_KEYMAP_LAYERS_LEN <= 32, "The layer state sent to peripherals has 32 layers");
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+
+#include <zmk/event_manager.h>
+#include <zmk/events/layer_state_changed.h>
+#include <zmk/split/state_sync.h>
+
+static uint32_t get_sync_state() {
+    return zmk_keymap_layer_state() | ZMK_KEYMAP_LAYER_BIT(zmk_keymap_layer_default());
+}
+
+ZMK_SPLIT_STATE_SYNC_DEFINE(layer_state_sync, DT_INST_LABEL(0), LAYER_STATE_CMD, get_sync_state);
+
+// Sent right away rather than coalesced, since a key pressed on the peripheral before the update
+// arrives is looked up on the old layers.
+static int layer_state_listener(const zmk_event_t *eh) {
+    zmk_split_state_sync_now(&layer_state_sync);
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(behavior_split_layer_state, layer_state_listener);
+ZMK_SUBSCRIPTION(behavior_split_layer_state, zmk_layer_state_changed);
+
+// The central only needs the device's label, for the state sync.
+static const struct behavior_driver_api behavior_split_layer_state_driver_api = {};
+
+#else
+
+#include <zmk/split/event_source.h>
+
+static int on_keymap_binding_pressed(struct zmk_behavior_binding *binding,
+                                     struct zmk_behavior_binding_event event) {
+    if (binding->param1 != LAYER_STATE_CMD) {
+        return -ENOTSUP;
+    }
+
+    zmk_split_event_source_set_layer_state(binding->param2);
+    return ZMK_BEHAVIOR_OPAQUE;
+}
+
+static const struct behavior_driver_api behavior_split_layer_state_driver_api = {
+    .binding_pressed = on_keymap_binding_pressed,
+};
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) */
+
+static int behavior_split_layer_state_init(const struct device *dev) { return 0; }
+
+DEVICE_DT_INST_DEFINE(0, behavior_split_layer_state_init, NULL, NULL, NULL, APPLICATION,
+                      CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &behavior_split_layer_state_driver_api);
+
+#endif /* DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) */
@@ -10,6 +10,7 @@
 #include <drivers/behavior.h>
 #include <logging/log.h>
 #include <zmk/behavior.h>
+#include <zmk/behavior_timer.h>
 
 #include <zmk/matrix.h>
 #include <zmk/endpoints.h>
@@ -19,6 +20,7 @@
 #include <zmk/events/modifiers_state_changed.h>
 #include <zmk/hid.h>
 #include <zmk/keymap.h>
+#include <zmk/position_slots.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -44,7 +46,7 @@ struct active_sticky_key {
     bool timer_started;
     bool timer_cancelled;
     int64_t release_at;
-    struct k_work_delayable release_timer;
+    struct zmk_behavior_timer release_timer;
     // usage page and keycode for the key that is being modified by this sticky key
     uint8_t modified_key_usage_page;
     uint32_t modified_key_keycode;
@@ -52,6 +54,13 @@ struct active_sticky_key {
 
 struct active_sticky_key active_sticky_keys[ZMK_BHV_STICKY_KEY_MAX_HELD] = {};
 
+BUILD_ASSERT(ZMK_BHV_STICKY_KEY_MAX_HELD <= 32, "Too many sticky keys for active_sticky_keys_mask");
+
+// Bit i is set while active_sticky_keys[i] is in use, so the listener can return right away while
+// no sticky key is active.
+static uint32_t active_sticky_keys_mask;
+static struct zmk_position_slots active_sticky_key_slots;
+
 static struct active_sticky_key *store_sticky_key(uint32_t position, uint32_t param1,
                                                   uint32_t param2,
                                                   const struct behavior_sticky_key_config *config) {
@@ -70,16 +79,30 @@ static struct active_sticky_key *store_sticky_key(uint32_t position, uint32_t pa
         sticky_key->timer_started = false;
         sticky_key->modified_key_usage_page = 0;
         sticky_key->modified_key_keycode = 0;
+        active_sticky_keys_mask |= BIT(i);
+        zmk_position_slots_set(&active_sticky_key_slots, position, i);
         return sticky_key;
     }
     return NULL;
 }
 
 static void clear_sticky_key(struct active_sticky_key *sticky_key) {
+    const int slot = sticky_key - active_sticky_keys;
+
+    zmk_position_slots_clear(&active_sticky_key_slots, sticky_key->position, slot);
     sticky_key->position = ZMK_BHV_STICKY_KEY_POSITION_FREE;
+    active_sticky_keys_mask &= ~BIT(slot);
 }
 
 static struct active_sticky_key *find_sticky_key(uint32_t position) {
+    int slot = zmk_position_slots_get(&active_sticky_key_slots, position);
+    if (slot != -ERANGE) {
+        // A sticky key whose timer couldn't be cancelled is on its way out, and a newer one on the
+        // same position replaced it in the map.
+        return slot >= 0 && !active_sticky_keys[slot].timer_cancelled ? &active_sticky_keys[slot]
+                                                                       : NULL;
+    }
+
     for (int i = 0; i < ZMK_BHV_STICKY_KEY_MAX_HELD; i++) {
         if (active_sticky_keys[i].position == position && !active_sticky_keys[i].timer_cancelled) {
             return &active_sticky_keys[i];
@@ -91,6 +114,7 @@ static struct active_sticky_key *find_sticky_key(uint32_t position) {
 static inline int press_sticky_key_behavior(struct active_sticky_key *sticky_key,
                                             int64_t timestamp) {
     struct zmk_behavior_binding binding = {
+        .behavior = sticky_key->config->behavior.behavior,
         .behavior_dev = sticky_key->config->behavior.behavior_dev,
         .param1 = sticky_key->param1,
         .param2 = sticky_key->param2,
@@ -105,6 +129,7 @@ static inline int press_sticky_key_behavior(struct active_sticky_key *sticky_key
 static inline int release_sticky_key_behavior(struct active_sticky_key *sticky_key,
                                               int64_t timestamp) {
     struct zmk_behavior_binding binding = {
+        .behavior = sticky_key->config->behavior.behavior,
         .behavior_dev = sticky_key->config->behavior.behavior_dev,
         .param1 = sticky_key->param1,
         .param2 = sticky_key->param2,
@@ -119,7 +144,7 @@ static inline int release_sticky_key_behavior(struct active_sticky_key *sticky_k
 }
 
 static int stop_timer(struct active_sticky_key *sticky_key) {
-    int timer_cancel_result = k_work_cancel_delayable(&sticky_key->release_timer);
+    int timer_cancel_result = zmk_behavior_timer_cancel(&sticky_key->release_timer);
     if (timer_cancel_result == -EINPROGRESS) {
         // too late to cancel, we'll let the timer handler clear up.
         sticky_key->timer_cancelled = true;
@@ -129,9 +154,11 @@ static int stop_timer(struct active_sticky_key *sticky_key) {
 
 static int on_sticky_key_binding_pressed(struct zmk_behavior_binding *binding,
                                          struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     const struct behavior_sticky_key_config *cfg = dev->config;
     struct active_sticky_key *sticky_key;
+    // The config lives in RAM, so the wrapped binding caches its resolved device in place.
+    behavior_get_binding_device((struct zmk_behavior_binding *)&cfg->behavior);
     sticky_key = find_sticky_key(event.position);
     if (sticky_key != NULL) {
         stop_timer(sticky_key);
@@ -168,7 +195,7 @@ static int on_sticky_key_binding_released(struct zmk_behavior_binding *binding,
     // adjust timer in case this behavior was queued by a hold-tap
     int32_t ms_left = sticky_key->release_at - k_uptime_get();
     if (ms_left > 0) {
-        k_work_schedule(&sticky_key->release_timer, K_MSEC(ms_left));
+        zmk_behavior_timer_schedule(&sticky_key->release_timer, sticky_key->release_at);
     }
     return ZMK_BEHAVIOR_OPAQUE;
 }
@@ -181,9 +208,13 @@ static const struct behavior_driver_api behavior_sticky_key_driver_api = {
 static int sticky_key_keycode_state_changed_listener(const zmk_event_t *eh);
 
 ZMK_LISTENER(behavior_sticky_key, sticky_key_keycode_state_changed_listener);
-ZMK_SUBSCRIPTION(behavior_sticky_key, zmk_keycode_state_changed);
+ZMK_SUBSCRIPTION_CAPTURING(behavior_sticky_key, zmk_keycode_state_changed);
 
 static int sticky_key_keycode_state_changed_listener(const zmk_event_t *eh) {
+    if (active_sticky_keys_mask == 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
     struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
     if (ev == NULL) {
         return ZMK_EV_EVENT_BUBBLE;
@@ -191,8 +222,11 @@ static int sticky_key_keycode_state_changed_listener(const zmk_event_t *eh) {
 
     // keep track whether the event has been reraised, so we only reraise it once
     bool event_reraised = false;
-    for (int i = 0; i < ZMK_BHV_STICKY_KEY_MAX_HELD; i++) {
-        struct active_sticky_key *sticky_key = &active_sticky_keys[i];
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_STICKY_KEY_SINGLE_RELEASE_REPORT)
+    bool batch_started = false;
+#endif
+    for (uint32_t pending = active_sticky_keys_mask; pending != 0; pending &= pending - 1) {
+        struct active_sticky_key *sticky_key = &active_sticky_keys[__builtin_ctz(pending)];
         if (sticky_key->position == ZMK_BHV_STICKY_KEY_POSITION_FREE) {
             continue;
         }
@@ -241,19 +275,34 @@ static int sticky_key_keycode_state_changed_listener(const zmk_event_t *eh) {
                 sticky_key->modified_key_usage_page == ev->usage_page &&
                 sticky_key->modified_key_keycode == ev->keycode) {
                 stop_timer(sticky_key);
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_STICKY_KEY_SINGLE_RELEASE_REPORT)
+                // Handle the key release first, inside the batch, so both releases end up in the
+                // report sent when the batch ends.
+                if (!event_reraised) {
+                    zmk_endpoints_batch_begin();
+                    batch_started = true;
+                    ZMK_EVENT_RAISE_AFTER(eh, behavior_sticky_key);
+                    event_reraised = true;
+                }
+#endif
                 release_sticky_key_behavior(sticky_key, ev->timestamp);
             }
         }
     }
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_STICKY_KEY_SINGLE_RELEASE_REPORT)
+    if (batch_started) {
+        zmk_endpoints_batch_end();
+    }
+#endif
     if (event_reraised) {
         return ZMK_EV_EVENT_CAPTURED;
     }
     return ZMK_EV_EVENT_BUBBLE;
 }
 
-void behavior_sticky_key_timer_handler(struct k_work *item) {
+void behavior_sticky_key_timer_handler(struct zmk_behavior_timer *timer) {
     struct active_sticky_key *sticky_key =
-        CONTAINER_OF(item, struct active_sticky_key, release_timer);
+        CONTAINER_OF(timer, struct active_sticky_key, release_timer);
     if (sticky_key->position == ZMK_BHV_STICKY_KEY_POSITION_FREE) {
         return;
     }
@@ -268,8 +317,8 @@ static int behavior_sticky_key_init(const struct device *dev) {
     static bool init_first_run = true;
     if (init_first_run) {
         for (int i = 0; i < ZMK_BHV_STICKY_KEY_MAX_HELD; i++) {
-            k_work_init_delayable(&active_sticky_keys[i].release_timer,
-                                  behavior_sticky_key_timer_handler);
+            zmk_behavior_timer_init(&active_sticky_keys[i].release_timer,
+                                    behavior_sticky_key_timer_handler);
             active_sticky_keys[i].position = ZMK_BHV_STICKY_KEY_POSITION_FREE;
         }
     }
@@ -10,12 +10,14 @@
 #include <drivers/behavior.h>
 #include <logging/log.h>
 #include <zmk/behavior.h>
+#include <zmk/behavior_timer.h>
 #include <zmk/keymap.h>
 #include <zmk/matrix.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/position_state_changed.h>
 #include <zmk/events/keycode_state_changed.h>
 #include <zmk/hid.h>
+#include <zmk/position_slots.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -45,12 +47,27 @@ struct active_tap_dance {
     bool timer_cancelled;
     bool tap_dance_decided;
     int64_t release_at;
-    struct k_work_delayable release_timer;
+    struct zmk_behavior_timer release_timer;
 };
 
 struct active_tap_dance active_tap_dances[ZMK_BHV_TAP_DANCE_MAX_HELD] = {};
 
+BUILD_ASSERT(ZMK_BHV_TAP_DANCE_MAX_HELD <= 32, "Too many tap dances for active_tap_dances_mask");
+
+// Bit i is set while active_tap_dances[i] is in use, so the listener can return right away while
+// no tap dance is active.
+static uint32_t active_tap_dances_mask;
+static struct zmk_position_slots active_tap_dance_slots;
+
 static struct active_tap_dance *find_tap_dance(uint32_t position) {
+    int slot = zmk_position_slots_get(&active_tap_dance_slots, position);
+    if (slot != -ERANGE) {
+        // A tap dance whose timer couldn't be cancelled is on its way out, and a newer one on the
+        // same position replaced it in the map.
+        return slot >= 0 && !active_tap_dances[slot].timer_cancelled ? &active_tap_dances[slot]
+                                                                      : NULL;
+    }
+
     for (int i = 0; i < ZMK_BHV_TAP_DANCE_MAX_HELD; i++) {
         if (active_tap_dances[i].position == position && !active_tap_dances[i].timer_cancelled) {
             return &active_tap_dances[i];
@@ -72,6 +89,8 @@ static int new_tap_dance(uint32_t position, const struct behavior_tap_dance_conf
             ref_dance->timer_started = true;
             ref_dance->timer_cancelled = false;
             ref_dance->tap_dance_decided = false;
+            active_tap_dances_mask |= BIT(i);
+            zmk_position_slots_set(&active_tap_dance_slots, position, i);
             *tap_dance = ref_dance;
             return 0;
         }
@@ -80,11 +99,15 @@ static int new_tap_dance(uint32_t position, const struct behavior_tap_dance_conf
 }
 
 static void clear_tap_dance(struct active_tap_dance *tap_dance) {
+    const int slot = tap_dance - active_tap_dances;
+
+    zmk_position_slots_clear(&active_tap_dance_slots, tap_dance->position, slot);
     tap_dance->position = ZMK_BHV_TAP_DANCE_POSITION_FREE;
+    active_tap_dances_mask &= ~BIT(slot);
 }
 
 static int stop_timer(struct active_tap_dance *tap_dance) {
-    int timer_cancel_result = k_work_cancel_delayable(&tap_dance->release_timer);
+    int timer_cancel_result = zmk_behavior_timer_cancel(&tap_dance->release_timer);
     if (timer_cancel_result == -EINPROGRESS) {
         // too late to cancel, we'll let the timer handler clear up.
         tap_dance->timer_cancelled = true;
@@ -97,13 +120,14 @@ static void reset_timer(struct active_tap_dance *tap_dance,
     tap_dance->release_at = event.timestamp + tap_dance->config->tapping_term_ms;
     int32_t ms_left = tap_dance->release_at - k_uptime_get();
     if (ms_left > 0) {
-        k_work_schedule(&tap_dance->release_timer, K_MSEC(ms_left));
+        zmk_behavior_timer_schedule(&tap_dance->release_timer, tap_dance->release_at);
         LOG_DBG("Successfully reset timer at position %d", tap_dance->position);
     }
 }
 
 static inline int press_tap_dance_behavior(struct active_tap_dance *tap_dance, int64_t timestamp) {
     tap_dance->tap_dance_decided = true;
+    behavior_get_binding_device(&tap_dance->config->behaviors[tap_dance->counter - 1]);
     struct zmk_behavior_binding binding = tap_dance->config->behaviors[tap_dance->counter - 1];
     struct zmk_behavior_binding_event event = {
         .position = tap_dance->position,
@@ -114,6 +138,7 @@ static inline int press_tap_dance_behavior(struct active_tap_dance *tap_dance, i
 
 static inline int release_tap_dance_behavior(struct active_tap_dance *tap_dance,
                                              int64_t timestamp) {
+    behavior_get_binding_device(&tap_dance->config->behaviors[tap_dance->counter - 1]);
     struct zmk_behavior_binding binding = tap_dance->config->behaviors[tap_dance->counter - 1];
     struct zmk_behavior_binding_event event = {
         .position = tap_dance->position,
@@ -125,7 +150,7 @@ static inline int release_tap_dance_behavior(struct active_tap_dance *tap_dance,
 
 static int on_tap_dance_binding_pressed(struct zmk_behavior_binding *binding,
                                         struct zmk_behavior_binding_event event) {
-    const struct device *dev = device_get_binding(binding->behavior_dev);
+    const struct device *dev = behavior_get_binding_device(binding);
     const struct behavior_tap_dance_config *cfg = dev->config;
     struct active_tap_dance *tap_dance;
     tap_dance = find_tap_dance(event.position);
@@ -168,8 +193,9 @@ static int on_tap_dance_binding_released(struct zmk_behavior_binding *binding,
     return ZMK_BEHAVIOR_OPAQUE;
 }
 
-void behavior_tap_dance_timer_handler(struct k_work *item) {
-    struct active_tap_dance *tap_dance = CONTAINER_OF(item, struct active_tap_dance, release_timer);
+void behavior_tap_dance_timer_handler(struct zmk_behavior_timer *timer) {
+    struct active_tap_dance *tap_dance =
+        CONTAINER_OF(timer, struct active_tap_dance, release_timer);
     if (tap_dance->position == ZMK_BHV_TAP_DANCE_POSITION_FREE) {
         return;
     }
@@ -195,6 +221,10 @@ ZMK_LISTENER(behavior_tap_dance, tap_dance_position_state_changed_listener);
 ZMK_SUBSCRIPTION(behavior_tap_dance, zmk_position_state_changed);
 
 static int tap_dance_position_state_changed_listener(const zmk_event_t *eh) {
+    if (active_tap_dances_mask == 0) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
     struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
     if (ev == NULL) {
         return ZMK_EV_EVENT_BUBBLE;
@@ -203,8 +233,8 @@ static int tap_dance_position_state_changed_listener(const zmk_event_t *eh) {
         LOG_DBG("Ignore upstroke at position %d.", ev->position);
         return ZMK_EV_EVENT_BUBBLE;
     }
-    for (int i = 0; i < ZMK_BHV_TAP_DANCE_MAX_HELD; i++) {
-        struct active_tap_dance *tap_dance = &active_tap_dances[i];
+    for (uint32_t pending = active_tap_dances_mask; pending != 0; pending &= pending - 1) {
+        struct active_tap_dance *tap_dance = &active_tap_dances[__builtin_ctz(pending)];
         if (tap_dance->position == ZMK_BHV_TAP_DANCE_POSITION_FREE) {
             continue;
         }
@@ -213,12 +243,14 @@ static int tap_dance_position_state_changed_listener(const zmk_event_t *eh) {
         }
         stop_timer(tap_dance);
         LOG_DBG("Tap dance interrupted, activating tap-dance at %d", tap_dance->position);
+        // Every undecided tap dance is resolved, not just the first one. One left waiting, e.g. a
+        // combo's tap dance pressed while a key's tap dance was undecided, would otherwise only
+        // fire at the end of its tapping term, after the interrupting key.
         if (!tap_dance->tap_dance_decided) {
             press_tap_dance_behavior(tap_dance, ev->timestamp);
             if (!tap_dance->is_pressed) {
                 release_tap_dance_behavior(tap_dance, ev->timestamp);
             }
-            return ZMK_EV_EVENT_BUBBLE;
         }
     }
     return ZMK_EV_EVENT_BUBBLE;
@@ -228,8 +260,8 @@ static int behavior_tap_dance_init(const struct device *dev) {
     static bool init_first_run = true;
     if (init_first_run) {
         for (int i = 0; i < ZMK_BHV_TAP_DANCE_MAX_HELD; i++) {
-            k_work_init_delayable(&active_tap_dances[i].release_timer,
-                                  behavior_tap_dance_timer_handler);
+            zmk_behavior_timer_init(&active_tap_dances[i].release_timer,
+                                    behavior_tap_dance_timer_handler);
             clear_tap_dance(&active_tap_dances[i]);
         }
     }
@@ -30,11 +30,21 @@
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/ble.h>
+#include <zmk/ble/adv_tiers.h>
+#include <zmk/flight_recorder.h>
 #include <zmk/keys.h>
+#include <zmk/settings.h>
 #include <zmk/split/bluetooth/uuid.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/ble_active_profile_changed.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS) || IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+#include <zmk/activity.h>
+#include <zmk/events/activity_state_changed.h>
+#endif
 
 #if IS_ENABLED(CONFIG_ZMK_BLE_PASSKEY_ENTRY)
 #include <zmk/events/keycode_state_changed.h>
@@ -57,17 +67,58 @@ enum advertising_type {
     ZMK_ADV_NONE,
     ZMK_ADV_DIR,
     ZMK_ADV_CONN,
+    ZMK_ADV_BACKGROUND,
 } advertising_status;
 
 #define CURR_ADV(adv) (adv << 4)
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+
+static enum zmk_ble_adv_tier adv_tier;
+
+static void adv_tier_timeout(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(adv_tier_timeout)
+static K_WORK_DELAYABLE_DEFINE(adv_tier_work, ZMK_WORK_WATCHED(adv_tier_timeout));
+
+// A tier's duration counts from when undirected advertising first started in it, so restarting it
+// after a failed connection doesn't make the tier last longer.
+static const struct bt_le_adv_param *open_adv_param() {
+    static struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(
+        BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_ONE_TIME, 0, 0, NULL);
+    k_timeout_t duration = zmk_ble_adv_tier_param(adv_tier, &param);
+
+    if (!K_TIMEOUT_EQ(duration, K_FOREVER)) {
+        k_work_schedule(&adv_tier_work, duration);
+    }
+
+    return &param;
+}
+
+#define ZMK_ADV_CONN_NAME open_adv_param()
+
+#else
+
 #define ZMK_ADV_CONN_NAME                                                                          \
     BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_ONE_TIME, BT_GAP_ADV_FAST_INT_MIN_2, \
                     BT_GAP_ADV_FAST_INT_MAX_2, NULL)
 
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS) */
+
+// Lets the bonded hosts of inactive profiles reconnect while the active one is connected.
+#define ZMK_ADV_CONN_BACKGROUND                                                                    \
+    BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_ONE_TIME, BT_GAP_ADV_SLOW_INT_MIN,   \
+                    BT_GAP_ADV_SLOW_INT_MAX, NULL)
+
 static struct zmk_ble_profile profiles[ZMK_BLE_PROFILE_COUNT];
 static uint8_t active_profile;
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_FAST_RECONNECT)
+// Set once the burst of directed advertising to the active profile's host times out without a
+// connection. Advertising then stays undirected until the next disconnect or profile change.
+static bool directed_adv_timed_out;
+#endif
+
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
 
@@ -89,15 +140,17 @@ static bt_addr_le_t peripheral_addr;
 #endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) */
 
 static void raise_profile_changed_event() {
-    ZMK_EVENT_RAISE(new_zmk_ble_active_profile_changed((struct zmk_ble_active_profile_changed){
-        .index = active_profile, .profile = &profiles[active_profile]}));
+    raise_zmk_ble_active_profile_changed((struct zmk_ble_active_profile_changed){
+        .index = active_profile, .profile = &profiles[active_profile]});
 }
 
 static void raise_profile_changed_event_callback(struct k_work *work) {
     raise_profile_changed_event();
 }
 
-K_WORK_DEFINE(raise_profile_changed_event_work, raise_profile_changed_event_callback);
+ZMK_WORK_WATCHDOG_WRAP(raise_profile_changed_event_callback)
+K_WORK_DEFINE(raise_profile_changed_event_work,
+              ZMK_WORK_WATCHED(raise_profile_changed_event_callback));
 
 bool zmk_ble_active_profile_is_open() {
     return !bt_addr_le_cmp(&profiles[active_profile].peer, BT_ADDR_LE_ANY);
@@ -146,8 +199,7 @@ bool zmk_ble_active_profile_is_connected() {
         bt_conn_unref(conn);                                                                       \
         return 0;                                                                                  \
     }                                                                                              \
-    err = bt_le_adv_start(BT_LE_ADV_CONN_DIR_LOW_DUTY(addr), zmk_ble_ad, ARRAY_SIZE(zmk_ble_ad),   \
-                          NULL, 0);                                                                \
+    err = bt_le_adv_start(BT_LE_ADV_CONN_DIR(addr), zmk_ble_ad, ARRAY_SIZE(zmk_ble_ad), NULL, 0);  \
     if (err) {                                                                                     \
         LOG_ERR("Advertising failed to start (err %d)", err);                                      \
         return err;                                                                                \
@@ -162,6 +214,33 @@ bool zmk_ble_active_profile_is_connected() {
     }                                                                                              \
     advertising_status = ZMK_ADV_CONN;
 
+#define CHECKED_BACKGROUND_ADV()                                                                   \
+    err = bt_le_adv_start(ZMK_ADV_CONN_BACKGROUND, zmk_ble_ad, ARRAY_SIZE(zmk_ble_ad), NULL, 0);   \
+    if (err) {                                                                                     \
+        LOG_ERR("Background advertising failed to start (err %d)", err);                           \
+        return err;                                                                                \
+    }                                                                                              \
+    advertising_status = ZMK_ADV_BACKGROUND;
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED)
+static bool has_disconnected_profile() {
+    for (int i = 0; i < ZMK_BLE_PROFILE_COUNT; i++) {
+        if (!bt_addr_le_cmp(&profiles[i].peer, BT_ADDR_LE_ANY)) {
+            continue;
+        }
+
+        struct bt_conn *conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, &profiles[i].peer);
+        if (conn == NULL) {
+            return true;
+        }
+
+        bt_conn_unref(conn);
+    }
+
+    return false;
+}
+#endif
+
 int update_advertising() {
     int err = 0;
     bt_addr_le_t *addr;
@@ -179,16 +258,32 @@ int update_advertising() {
 
         // LOG_DBG("Directed advertising to %s", log_strdup(addr_str));
         // desired_adv = ZMK_ADV_DIR;
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_FAST_RECONNECT)
+        // High duty cycle directed advertising lasts at most 1.28s, after which the controller
+        // reports a timeout and we fall back to undirected advertising. A host that uses a private
+        // address may not answer it, so this only ever delays such hosts by that long.
+        if (!directed_adv_timed_out) {
+            desired_adv = ZMK_ADV_DIR;
+        }
+#endif
     }
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED)
+    else if (has_disconnected_profile()) {
+        desired_adv = ZMK_ADV_BACKGROUND;
+    }
+#endif
     LOG_DBG("advertising from %d to %d", advertising_status, desired_adv);
 
     switch (desired_adv + CURR_ADV(advertising_status)) {
     case ZMK_ADV_NONE + CURR_ADV(ZMK_ADV_DIR):
     case ZMK_ADV_NONE + CURR_ADV(ZMK_ADV_CONN):
+    case ZMK_ADV_NONE + CURR_ADV(ZMK_ADV_BACKGROUND):
         CHECKED_ADV_STOP();
         break;
     case ZMK_ADV_DIR + CURR_ADV(ZMK_ADV_DIR):
     case ZMK_ADV_DIR + CURR_ADV(ZMK_ADV_CONN):
+    case ZMK_ADV_DIR + CURR_ADV(ZMK_ADV_BACKGROUND):
         CHECKED_ADV_STOP();
         CHECKED_DIR_ADV();
         break;
@@ -196,12 +291,21 @@ int update_advertising() {
         CHECKED_DIR_ADV();
         break;
     case ZMK_ADV_CONN + CURR_ADV(ZMK_ADV_DIR):
+    case ZMK_ADV_CONN + CURR_ADV(ZMK_ADV_BACKGROUND):
         CHECKED_ADV_STOP();
         CHECKED_OPEN_ADV();
         break;
     case ZMK_ADV_CONN + CURR_ADV(ZMK_ADV_NONE):
         CHECKED_OPEN_ADV();
         break;
+    case ZMK_ADV_BACKGROUND + CURR_ADV(ZMK_ADV_DIR):
+    case ZMK_ADV_BACKGROUND + CURR_ADV(ZMK_ADV_CONN):
+        CHECKED_ADV_STOP();
+        CHECKED_BACKGROUND_ADV();
+        break;
+    case ZMK_ADV_BACKGROUND + CURR_ADV(ZMK_ADV_NONE):
+        CHECKED_BACKGROUND_ADV();
+        break;
     }
 
     return 0;
@@ -209,7 +313,68 @@ int update_advertising() {
 
 static void update_advertising_callback(struct k_work *work) { update_advertising(); }
 
-K_WORK_DEFINE(update_advertising_work, update_advertising_callback);
+ZMK_WORK_WATCHDOG_WRAP(update_advertising_callback)
+K_WORK_DEFINE(update_advertising_work, ZMK_WORK_WATCHED(update_advertising_callback));
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+
+// Undirected advertising keeps its parameters until stopped, so a new tier needs a restart.
+static void restart_open_adv() {
+    int err = bt_le_adv_stop();
+
+    advertising_status = ZMK_ADV_NONE;
+    if (err) {
+        LOG_ERR("Failed to stop advertising (err %d)", err);
+        return;
+    }
+
+    update_advertising();
+}
+
+static void adv_tier_timeout(struct k_work *work) {
+    // The tier only moves on while undirected advertising is what's waiting for a connection.
+    if (advertising_status != ZMK_ADV_CONN || adv_tier == ZMK_BLE_ADV_TIER_SLOW) {
+        return;
+    }
+
+    adv_tier++;
+    LOG_DBG("Nothing connected, slowing advertising down to tier %d", adv_tier);
+    restart_open_adv();
+}
+
+// Goes back to the fastest tier after a disconnect, a wake or a profile change.
+static void reset_adv_tier() {
+    bool slowed = adv_tier != ZMK_BLE_ADV_TIER_FAST;
+
+    k_work_cancel_delayable(&adv_tier_work);
+    adv_tier = ZMK_BLE_ADV_TIER_FAST;
+
+    if (slowed && advertising_status == ZMK_ADV_CONN) {
+        restart_open_adv();
+    }
+}
+
+static void reset_adv_tier_callback(struct k_work *work) { reset_adv_tier(); }
+
+ZMK_WORK_WATCHDOG_WRAP(reset_adv_tier_callback)
+K_WORK_DEFINE(reset_adv_tier_work, ZMK_WORK_WATCHED(reset_adv_tier_callback));
+
+static int zmk_ble_adv_tiers_listener(const zmk_event_t *eh) {
+    if (zmk_activity_get_state() == ZMK_ACTIVITY_ACTIVE) {
+        reset_adv_tier();
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(zmk_ble_adv_tiers, zmk_ble_adv_tiers_listener);
+ZMK_SUBSCRIPTION(zmk_ble_adv_tiers, zmk_activity_state_changed);
+
+#else
+
+#define reset_adv_tier()
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS) */
 
 int zmk_ble_clear_bonds() {
     LOG_DBG("");
@@ -228,16 +393,16 @@ int zmk_ble_clear_bonds() {
 int zmk_ble_active_profile_index() { return active_profile; }
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-static void ble_save_profile_work(struct k_work *work) {
+static void ble_save_profile_work() {
     settings_save_one("ble/active_profile", &active_profile, sizeof(active_profile));
 }
 
-static struct k_work_delayable ble_save_work;
+ZMK_SETTINGS_SAVE_DEFINE(ble_save, ble_save_profile_work);
 #endif
 
 static int ble_save_profile() {
 #if IS_ENABLED(CONFIG_SETTINGS)
-    return k_work_reschedule(&ble_save_work, K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
+    return zmk_settings_save(&ble_save);
 #else
     return 0;
 #endif
@@ -256,6 +421,11 @@ int zmk_ble_prof_select(uint8_t index) {
     active_profile = index;
     ble_save_profile();
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_FAST_RECONNECT)
+    directed_adv_timed_out = false;
+#endif
+    reset_adv_tier();
+
     update_advertising();
 
     raise_profile_changed_event();
@@ -285,6 +455,8 @@ void zmk_ble_set_peripheral_addr(bt_addr_le_t *addr) {
     settings_save_one("ble/peripheral_address", addr, sizeof(bt_addr_le_t));
 }
 
+bt_addr_le_t *zmk_ble_peripheral_addr() { return &peripheral_addr; }
+
 #endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) */
 
 #if IS_ENABLED(CONFIG_SETTINGS)
@@ -353,13 +525,74 @@ static int ble_profiles_handle_set(const char *name, size_t len, settings_read_c
     return 0;
 };
 
-struct settings_handler profiles_handler = {.name = "ble", .h_set = ble_profiles_handle_set};
+SETTINGS_STATIC_HANDLER_DEFINE(ble_profiles, "ble", NULL, ble_profiles_handle_set, NULL, NULL);
 #endif /* IS_ENABLED(CONFIG_SETTINGS) */
 
 static bool is_conn_active_profile(const struct bt_conn *conn) {
     return bt_addr_le_cmp(bt_conn_get_dst(conn), &profiles[active_profile].peer) == 0;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED)
+
+static bool is_conn_bonded_profile(const struct bt_conn *conn) {
+    for (int i = 0; i < ZMK_BLE_PROFILE_COUNT; i++) {
+        if (bt_addr_le_cmp(bt_conn_get_dst(conn), &profiles[i].peer) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+BUILD_ASSERT(CONFIG_ZMK_BLE_INACTIVE_CONN_TIMEOUT * 4 >
+                 (1 + CONFIG_ZMK_BLE_INACTIVE_CONN_LATENCY) * CONFIG_ZMK_BLE_INACTIVE_CONN_INTERVAL,
+             "CONFIG_ZMK_BLE_INACTIVE_CONN_TIMEOUT is too short for the inactive connection");
+
+// Inactive hosts get no reports, so their links only have to stay up until they are selected.
+static const struct bt_le_conn_param inactive_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ZMK_BLE_INACTIVE_CONN_INTERVAL, CONFIG_ZMK_BLE_INACTIVE_CONN_INTERVAL,
+    CONFIG_ZMK_BLE_INACTIVE_CONN_LATENCY, CONFIG_ZMK_BLE_INACTIVE_CONN_TIMEOUT);
+
+#if !IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+static const struct bt_le_conn_param active_host_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_BT_PERIPHERAL_PREF_MIN_INT, CONFIG_BT_PERIPHERAL_PREF_MAX_INT,
+    CONFIG_BT_PERIPHERAL_PREF_LATENCY, CONFIG_BT_PERIPHERAL_PREF_TIMEOUT);
+#endif
+
+static void update_host_conn_params(struct bt_conn *conn, void *data) {
+    const struct bt_le_conn_param *param = &inactive_conn_param;
+    struct bt_conn_info info;
+
+    bt_conn_get_info(conn, &info);
+    if (info.role != BT_CONN_ROLE_PERIPHERAL) {
+        return;
+    }
+
+    if (is_conn_active_profile(conn)) {
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+        // The activity based parameters cover the active profile.
+        return;
+#else
+        param = &active_host_conn_param;
+#endif
+    }
+
+    int err = bt_conn_le_param_update(conn, param);
+    if (err && err != -EALREADY) {
+        LOG_WRN("Failed to request host connection parameters (err %d)", err);
+    }
+}
+
+static int zmk_ble_hosts_listener(const zmk_event_t *eh) {
+    bt_conn_foreach(BT_CONN_TYPE_LE, update_host_conn_params, NULL);
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(zmk_ble_hosts, zmk_ble_hosts_listener);
+ZMK_SUBSCRIPTION(zmk_ble_hosts, zmk_ble_active_profile_changed);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED) */
+
 static void connected(struct bt_conn *conn, uint8_t err) {
     char addr[BT_ADDR_LE_STR_LEN];
     struct bt_conn_info info;
@@ -373,9 +606,22 @@ static void connected(struct bt_conn *conn, uint8_t err) {
     }
 
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED)
+    bool from_background = advertising_status == ZMK_ADV_BACKGROUND;
+#endif
     advertising_status = ZMK_ADV_NONE;
+    zmk_flight_record(ZMK_FLIGHT_BLE_CONNECTED, err, 0);
 
     if (err) {
+#if IS_ENABLED(CONFIG_ZMK_BLE_FAST_RECONNECT)
+        if (err == BT_HCI_ERR_ADV_TIMEOUT) {
+            LOG_DBG("Directed advertising timed out, falling back to undirected");
+            directed_adv_timed_out = true;
+            update_advertising();
+            return;
+        }
+#endif
+
         LOG_WRN("Failed to connect to %s (%u)", log_strdup(addr), err);
         update_advertising();
         return;
@@ -383,6 +629,19 @@ static void connected(struct bt_conn *conn, uint8_t err) {
 
     LOG_DBG("Connected %s", log_strdup(addr));
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEEP_HOSTS_CONNECTED)
+    // Background advertising is only meant for bonded hosts, and pairing is closed meanwhile.
+    if (from_background && !is_conn_bonded_profile(conn)) {
+        LOG_DBG("Disconnecting %s, not a bonded host", log_strdup(addr));
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        return;
+    }
+
+    if (!is_conn_active_profile(conn)) {
+        update_host_conn_params(conn, NULL);
+    }
+#endif
+
     if (bt_conn_set_security(conn, BT_SECURITY_L2)) {
         LOG_ERR("Failed to set security");
     }
@@ -410,6 +669,16 @@ static void disconnected(struct bt_conn *conn, uint8_t reason) {
         return;
     }
 
+    zmk_flight_record(ZMK_FLIGHT_BLE_DISCONNECTED, reason, 0);
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_FAST_RECONNECT)
+    directed_adv_timed_out = false;
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+    k_work_submit(&reset_adv_tier_work);
+#endif
+
     // We need to do this in a work callback, otherwise the advertising update will still see the
     // connection for a profile as active, and not start advertising yet.
     k_work_submit(&update_advertising_work);
@@ -556,19 +825,7 @@ static int zmk_ble_init(const struct device *_arg) {
     }
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-    settings_subsys_init();
-
-    err = settings_register(&profiles_handler);
-    if (err) {
-        LOG_ERR("Failed to setup the profile settings handler (err %d)", err);
-        return err;
-    }
-
-    k_work_init_delayable(&ble_save_work, ble_save_profile_work);
-
-    settings_load_subtree("ble");
-    settings_load_subtree("bt");
-
+    zmk_settings_load();
 #endif
 
 #if IS_ENABLED(CONFIG_ZMK_BLE_CLEAR_BONDS_ON_START)
@@ -670,4 +927,72 @@ ZMK_LISTENER(zmk_ble, zmk_ble_listener);
 ZMK_SUBSCRIPTION(zmk_ble, zmk_keycode_state_changed);
 #endif /* IS_ENABLED(CONFIG_ZMK_BLE_PASSKEY_ENTRY) */
 
-SYS_INIT(zmk_ble_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+
+// The supervision timeout must be longer than two effective connection intervals.
+#define CONN_PARAMS_VALID(interval, latency)                                                       \
+    (CONFIG_ZMK_BLE_CONN_TIMEOUT * 4 > (1 + (latency)) * (interval))
+
+BUILD_ASSERT(CONN_PARAMS_VALID(CONFIG_ZMK_BLE_ACTIVE_CONN_INTERVAL,
+                               CONFIG_ZMK_BLE_ACTIVE_CONN_LATENCY),
+             "CONFIG_ZMK_BLE_CONN_TIMEOUT is too short for the active connection parameters");
+BUILD_ASSERT(CONN_PARAMS_VALID(CONFIG_ZMK_BLE_IDLE_CONN_INTERVAL, CONFIG_ZMK_BLE_IDLE_CONN_LATENCY),
+             "CONFIG_ZMK_BLE_CONN_TIMEOUT is too short for the idle connection parameters");
+
+static const struct bt_le_conn_param active_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ZMK_BLE_ACTIVE_CONN_INTERVAL, CONFIG_ZMK_BLE_ACTIVE_CONN_INTERVAL,
+    CONFIG_ZMK_BLE_ACTIVE_CONN_LATENCY, CONFIG_ZMK_BLE_CONN_TIMEOUT);
+
+static const struct bt_le_conn_param idle_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ZMK_BLE_IDLE_CONN_INTERVAL, CONFIG_ZMK_BLE_IDLE_CONN_INTERVAL,
+    CONFIG_ZMK_BLE_IDLE_CONN_LATENCY, CONFIG_ZMK_BLE_CONN_TIMEOUT);
+
+// Asks the active profile's host for the connection parameters matching the activity state. Other
+// profiles don't get any reports, so whatever their hosts chose is left alone.
+static void update_active_profile_conn_params() {
+    const struct bt_le_conn_param *param;
+    struct bt_conn *conn;
+    int err;
+
+    switch (zmk_activity_get_state()) {
+    case ZMK_ACTIVITY_ACTIVE:
+        param = &active_conn_param;
+        break;
+    case ZMK_ACTIVITY_IDLE:
+        param = &idle_conn_param;
+        break;
+    default:
+        return;
+    }
+
+    if (zmk_ble_active_profile_is_open()) {
+        return;
+    }
+
+    conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, zmk_ble_active_profile_addr());
+    if (conn == NULL) {
+        return;
+    }
+
+    // Before the initial update, Zephyr holds on to the request and sends it in place of the
+    // preferred parameters, so this is safe to call as soon as the profile connects.
+    err = bt_conn_le_param_update(conn, param);
+    if (err && err != -EALREADY) {
+        LOG_WRN("Failed to request connection parameters (err %d)", err);
+    }
+
+    bt_conn_unref(conn);
+}
+
+static int zmk_ble_conn_params_listener(const zmk_event_t *eh) {
+    update_active_profile_conn_params();
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(zmk_ble_conn_params, zmk_ble_conn_params_listener);
+ZMK_SUBSCRIPTION(zmk_ble_conn_params, zmk_activity_state_changed);
+ZMK_SUBSCRIPTION(zmk_ble_conn_params, zmk_ble_active_profile_changed);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS) */
+
+ZMK_SYS_INIT(zmk_ble_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <init.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+
+// Upgrades every connection, whether to a host or between split halves, to the 2M PHY and longer
+// data PDUs where both sides support it. If the peer rejects a procedure, the link keeps working
+// with the parameters it already has.
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_DATA_LENGTH_EXTENSION)
+// Air time of an uncoded 1M PDU: 8 us per octet of payload, plus 14 octets of preamble, access
+// address, header and CRC. Requesting the 1M time keeps long PDUs usable if the PHY update fails.
+#define DATA_LEN_TX_TIME(octets) (((octets) + 14) * 8)
+
+static const struct bt_conn_le_data_len_param data_len_param = {
+    .tx_max_len = CONFIG_BT_BUF_ACL_TX_SIZE,
+    .tx_max_time = DATA_LEN_TX_TIME(CONFIG_BT_BUF_ACL_TX_SIZE),
+};
+#endif
+
+static void ble_link_connected(struct bt_conn *conn, uint8_t err) {
+    if (err) {
+        return;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_PHY_2M)
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err) {
+        LOG_WRN("Failed to request 2M PHY, staying on 1M (err %d)", err);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_DATA_LENGTH_EXTENSION)
+    err = bt_conn_le_data_len_update(conn, &data_len_param);
+    if (err) {
+        LOG_WRN("Failed to request data length update (err %d)", err);
+    }
+#endif
+}
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_PHY_2M)
+static void ble_link_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param) {
+    LOG_DBG("PHY updated: tx %u rx %u", param->tx_phy, param->rx_phy);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_DATA_LENGTH_EXTENSION)
+static void ble_link_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info) {
+    LOG_DBG("Data length updated: tx %u bytes (%u us) rx %u bytes (%u us)", info->tx_max_len,
+            info->tx_max_time, info->rx_max_len, info->rx_max_time);
+}
+#endif
+
+static struct bt_conn_cb conn_callbacks = {
+    .connected = ble_link_connected,
+#if IS_ENABLED(CONFIG_ZMK_BLE_PHY_2M)
+    .le_phy_updated = ble_link_phy_updated,
+#endif
+#if IS_ENABLED(CONFIG_ZMK_BLE_DATA_LENGTH_EXTENSION)
+    .le_data_len_updated = ble_link_data_len_updated,
+#endif
+};
+
+static int zmk_ble_link_init(const struct device *_arg) {
+    bt_conn_cb_register(&conn_callbacks);
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_ble_link_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
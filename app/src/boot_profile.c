@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <sys/atomic.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/position_state_changed.h>
+
+struct boot_stage {
+    const char *name;
+    /** Uptime when the stage started. */
+    uint32_t start_us;
+    uint32_t duration_us;
+    int ret;
+};
+
+// Init functions run one at a time on the main thread, so the stages need no locking.
+static struct boot_stage stages[CONFIG_ZMK_BOOT_PROFILE_MAX_STAGES];
+static uint8_t stages_len;
+static uint8_t stages_dropped;
+
+static atomic_t first_position_us;
+static atomic_t first_report_us;
+
+static uint32_t uptime_us() { return k_ticks_to_us_floor64(k_uptime_ticks()); }
+
+void zmk_boot_profile_record(const char *name, uint32_t start, int ret) {
+    uint32_t duration_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    if (stages_len >= ARRAY_SIZE(stages)) {
+        stages_dropped++;
+        return;
+    }
+
+    stages[stages_len++] = (struct boot_stage){
+        .name = name,
+        .start_us = uptime_us() - duration_us,
+        .duration_us = duration_us,
+        .ret = ret,
+    };
+}
+
+// Zero means the milestone hasn't happened yet.
+static void record_milestone(atomic_t *milestone, const char *name) {
+    if (atomic_cas(milestone, 0, MAX(uptime_us(), 1))) {
+        LOG_INF("Boot profile: %s after %u us", name, (uint32_t)atomic_get(milestone));
+    }
+}
+
+void zmk_boot_profile_report_sent() { record_milestone(&first_report_us, "first HID report"); }
+
+void zmk_boot_profile_log() {
+    for (int i = 0; i < stages_len; i++) {
+        LOG_INF("Boot profile: %s started at %u us, took %u us (ret %d)", stages[i].name,
+                stages[i].start_us, stages[i].duration_us, stages[i].ret);
+    }
+
+    if (stages_dropped) {
+        LOG_WRN("Boot profile: %u stages not recorded, increase "
+                "CONFIG_ZMK_BOOT_PROFILE_MAX_STAGES",
+                stages_dropped);
+    }
+}
+
+static int boot_profile_listener(const zmk_event_t *eh) {
+    record_milestone(&first_position_us, "first position event");
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(boot_profile, boot_profile_listener);
+ZMK_SUBSCRIPTION(boot_profile, zmk_position_state_changed);
+
+#if IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+static int cmd_boot(const struct shell *sh, size_t argc, char **argv) {
+    shell_print(sh, "%-36s %10s %10s %6s", "stage", "start us", "took us", "ret");
+    for (int i = 0; i < stages_len; i++) {
+        shell_print(sh, "%-36s %10u %10u %6d", stages[i].name, stages[i].start_us,
+                    stages[i].duration_us, stages[i].ret);
+    }
+
+    if (stages_dropped) {
+        shell_print(sh, "%u stages not recorded", stages_dropped);
+    }
+
+    shell_print(sh, "First position event: %u us", (uint32_t)atomic_get(&first_position_us));
+    shell_print(sh, "First HID report: %u us", (uint32_t)atomic_get(&first_report_us));
+    return 0;
+}
+
+SHELL_CMD_REGISTER(boot_profile, NULL, "Show how long each boot stage took", cmd_boot);
+
+#endif /* IS_ENABLED(CONFIG_SHELL) */
@@ -10,14 +10,19 @@
 #include <drivers/behavior.h>
 #include <logging/log.h>
 #include <sys/dlist.h>
+#include <sys/util.h>
 #include <kernel.h>
 
+#include <zmk/boot_profile.h>
 #include <zmk/behavior.h>
+#include <zmk/behavior_timer.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/position_state_changed.h>
 #include <zmk/hid.h>
 #include <zmk/matrix.h>
 #include <zmk/keymap.h>
+#include <zmk/position_set.h>
+#include <zmk/position_slots.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -26,14 +31,23 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 struct combo_cfg {
     int32_t key_positions[CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO];
     int32_t key_position_len;
+    // key_positions as a set, filled in by initialize_combo.
+    struct zmk_position_set key_position_set;
     struct zmk_behavior_binding behavior;
     int32_t timeout_ms;
     // if slow release is set, the combo releases when the last key is released.
     // otherwise, the combo releases when the first key is released.
     bool slow_release;
+    // if eager is set, the combo triggers as soon as all of its keys are pressed, even if a
+    // longer combo containing them could still be completed.
+    bool eager;
     // the virtual key position is a key position outside the range used by the keyboard.
     // it is necessary so hold-taps can uniquely identify a behavior.
     int32_t virtual_key_position;
+    // keymap profiles the combo is active in, as a mask.
+    uint32_t profile_mask;
+    // layers as a mask, filled in by initialize_combo.
+    zmk_keymap_layers_state_t layer_mask;
     int32_t layers_len;
     int8_t layers[];
 };
@@ -44,190 +58,250 @@ struct active_combo {
     // The keys are removed from this array when they are released.
     // Once this array is empty, the behavior is released.
     const zmk_event_t *key_positions_pressed[CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO];
+    // bit i is set while key_positions_pressed[i] is still held.
+    uint32_t keys_pressed;
 };
 
-struct combo_candidate {
-    struct combo_cfg *combo;
-    // the time after which this behavior should be removed from candidates.
-    // by keeping track of when the candidate should be cleared there is no
-    // possibility of accidental releases.
-    int64_t timeout_at;
-};
+BUILD_ASSERT(CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO < 32, "Too many keys per combo for keys_pressed");
+BUILD_ASSERT(CONFIG_ZMK_COMBO_MAX_PRESSED_COMBOS < UINT8_MAX,
+             "Too many pressed combos for active_combo_slots");
+BUILD_ASSERT(ZMK_KEYMAP_PROFILES_LEN <= 32, "Too many keymap profiles for profile_mask");
+
+// -1 in profiles is every profile. The shift is masked so it stays valid for -1 too.
+#define COMBO_PROFILE_BIT(idx, n)                                                                  \
+    | (DT_PROP_BY_IDX(n, profiles, idx) < 0 ? UINT32_MAX                                           \
+                                            : BIT(DT_PROP_BY_IDX(n, profiles, idx) & 0x1F))
+
+#define COMBO_INST(n)                                                                              \
+    static struct combo_cfg combo_config_##n = {                                                   \
+        .timeout_ms = DT_PROP(n, timeout_ms),                                                      \
+        .key_positions = DT_PROP(n, key_positions),                                                \
+        .key_position_len = DT_PROP_LEN(n, key_positions),                                         \
+        .behavior = ZMK_KEYMAP_EXTRACT_BINDING(0, n),                                              \
+        .virtual_key_position = ZMK_KEYMAP_LEN + __COUNTER__,                                      \
+        .slow_release = DT_PROP(n, slow_release),                                                  \
+        .eager = DT_PROP(n, eager),                                                                \
+        .profile_mask = (0 UTIL_LISTIFY(DT_PROP_LEN(n, profiles), COMBO_PROFILE_BIT, n)),          \
+        .layers = DT_PROP(n, layers),                                                              \
+        .layers_len = DT_PROP_LEN(n, layers),                                                      \
+    };
+
+DT_INST_FOREACH_CHILD(0, COMBO_INST)
+
+#define COMBO_CONFIG_REF(n) &combo_config_##n,
+#define COMBO_KEY_COUNT(n) +DT_PROP_LEN(n, key_positions)
+
+// all combos, in devicetree order (and so by virtual-key-position)
+static struct combo_cfg *const combos[] = {DT_INST_FOREACH_CHILD(0, COMBO_CONFIG_REF)};
+
+#define COMBOS_LEN ARRAY_SIZE(combos)
+#define COMBO_KEYS_LEN (0 DT_INST_FOREACH_CHILD(0, COMBO_KEY_COUNT))
+
+BUILD_ASSERT(COMBO_KEYS_LEN <= UINT16_MAX, "Too many combo key positions");
+
+// a lookup that maps a key position to all combos on that position, as indices into combos.
+// The combos on position p are combo_lookup[combo_lookup_offsets[p]] up to (but not including)
+// combo_lookup[combo_lookup_offsets[p + 1]], sorted shortest-first, then by virtual-key-position.
+static uint16_t combo_lookup_offsets[ZMK_KEYMAP_LEN + 1];
+static uint16_t combo_lookup[COMBO_KEYS_LEN];
 
 // set of keys pressed
 const zmk_event_t *pressed_keys[CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO] = {NULL};
-// the set of candidate combos based on the currently pressed_keys
-struct combo_candidate candidates[CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY];
+// the positions of pressed_keys, kept in sync with it
+struct zmk_position_set pressed_positions;
+// the set of candidate combos based on the currently pressed_keys. Candidates always use the first
+// pressed key, so they are the combos on its position whose bit in candidate_set is still set.
+// Bit i stands for combos[combo_lookup[candidates_start + i]].
+static uint16_t candidates_start;
+static uint16_t candidates_len;
+static int candidates_count;
+static uint32_t candidate_set[DIV_ROUND_UP(COMBOS_LEN, 32)];
+// the time the first key was pressed. by keeping track of when each candidate should be cleared
+// there is no possibility of accidental releases.
+static int64_t candidates_timestamp;
 // the last candidate that was completely pressed
 struct combo_cfg *fully_pressed_combo = NULL;
-// a lookup dict that maps a key position to all combos on that position
-struct combo_cfg *combo_lookup[ZMK_KEYMAP_LEN][CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY] = {NULL};
 // combos that have been activated and still have (some) keys pressed
 // this array is always contiguous from 0.
 struct active_combo active_combos[CONFIG_ZMK_COMBO_MAX_PRESSED_COMBOS] = {NULL};
 int active_combo_count = 0;
+// the index in active_combos of the combo holding each pressed key position.
+static struct zmk_position_slots active_combo_slots;
 
-struct k_work_delayable timeout_task;
-int64_t timeout_task_timeout_at;
+struct zmk_behavior_timer timeout_task;
 
-// Store the combo key pointer in the combos array, one pointer for each key position
-// The combos are sorted shortest-first, then by virtual-key-position.
-static int initialize_combo(struct combo_cfg *new_combo) {
-    for (int i = 0; i < new_combo->key_position_len; i++) {
-        int32_t position = new_combo->key_positions[i];
+static int initialize_combo(struct combo_cfg *combo) {
+    for (int i = 0; i < combo->key_position_len; i++) {
+        int32_t position = combo->key_positions[i];
         if (position >= ZMK_KEYMAP_LEN) {
             LOG_ERR("Unable to initialize combo, key position %d does not exist", position);
+            zmk_position_set_clear(&combo->key_position_set);
             return -EINVAL;
         }
 
-        struct combo_cfg *insert_combo = new_combo;
-        bool set = false;
-        for (int j = 0; j < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; j++) {
-            struct combo_cfg *combo_at_j = combo_lookup[position][j];
-            if (combo_at_j == NULL) {
-                combo_lookup[position][j] = insert_combo;
-                set = true;
-                break;
+        zmk_position_set_add(&combo->key_position_set, position);
+    }
+
+    if (combo->layers[0] == -1) {
+        // -1 in the first layer position is global layer scope
+        combo->layer_mask = ~(zmk_keymap_layers_state_t)0;
+        return 0;
+    }
+    for (int i = 0; i < combo->layers_len; i++) {
+        if (combo->layers[i] >= 0 && combo->layers[i] < ZMK_KEYMAP_LAYERS_LEN) {
+            combo->layer_mask |= ZMK_KEYMAP_LAYER_BIT(combo->layers[i]);
+        }
+    }
+    return 0;
+}
+
+// Returns true if the position at index i should be added to combo_lookup: it exists and isn't
+// already listed earlier in the combo.
+static bool is_indexed_position(struct combo_cfg *combo, int i) {
+    int32_t position = combo->key_positions[i];
+    if (position >= ZMK_KEYMAP_LEN || !zmk_position_set_test(&combo->key_position_set, position)) {
+        return false;
+    }
+    for (int j = 0; j < i; j++) {
+        if (combo->key_positions[j] == position) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Builds combo_lookup from the key position sets with a counting sort, so the number of combos per
+// key position is only limited by the total number of combo keys.
+static void initialize_combo_lookup() {
+    for (int c = 0; c < COMBOS_LEN; c++) {
+        for (int i = 0; i < combos[c]->key_position_len; i++) {
+            if (is_indexed_position(combos[c], i)) {
+                combo_lookup_offsets[combos[c]->key_positions[i] + 1]++;
             }
-            if (combo_at_j->key_position_len < insert_combo->key_position_len ||
-                (combo_at_j->key_position_len == insert_combo->key_position_len &&
-                 combo_at_j->virtual_key_position < insert_combo->virtual_key_position)) {
+        }
+    }
+
+    for (int p = 0; p < ZMK_KEYMAP_LEN; p++) {
+        combo_lookup_offsets[p + 1] += combo_lookup_offsets[p];
+    }
+
+    // Fill each position's range shortest-first. Within a length, combos are already ordered by
+    // virtual-key-position. combo_lookup_offsets[p] advances to the end of the range as it fills.
+    for (int len = 1; len <= CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO; len++) {
+        for (int c = 0; c < COMBOS_LEN; c++) {
+            if (combos[c]->key_position_len != len) {
                 continue;
             }
-            // put insert_combo in this spot, move all other combos up.
-            combo_lookup[position][j] = insert_combo;
-            insert_combo = combo_at_j;
-        }
-        if (!set) {
-            LOG_ERR("Too many combos for key position %d, CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY %d.",
-                    position, CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY);
-            return -ENOMEM;
+            for (int i = 0; i < len; i++) {
+                if (is_indexed_position(combos[c], i)) {
+                    combo_lookup[combo_lookup_offsets[combos[c]->key_positions[i]]++] = c;
+                }
+            }
         }
     }
-    return 0;
-}
 
-static bool combo_active_on_layer(struct combo_cfg *combo, uint8_t layer) {
-    if (combo->layers[0] == -1) {
-        // -1 in the first layer position is global layer scope
-        return true;
+    for (int p = ZMK_KEYMAP_LEN; p > 0; p--) {
+        combo_lookup_offsets[p] = combo_lookup_offsets[p - 1];
     }
-    for (int j = 0; j < combo->layers_len; j++) {
-        if (combo->layers[j] == layer) {
-            return true;
+    combo_lookup_offsets[0] = 0;
+}
+
+static inline struct combo_cfg *get_candidate(int i) {
+    return combos[combo_lookup[candidates_start + i]];
+}
+
+static inline bool is_candidate(int i) { return (candidate_set[i / 32] & BIT(i % 32)) != 0; }
+
+static inline void remove_candidate(int i) {
+    candidate_set[i / 32] &= ~BIT(i % 32);
+    candidates_count--;
+}
+
+// Returns the index of the first (shortest) candidate, or -1 if there are none.
+static int first_candidate() {
+    for (int w = 0; w < DIV_ROUND_UP(candidates_len, 32); w++) {
+        if (candidate_set[w] != 0) {
+            return w * 32 + __builtin_ctz(candidate_set[w]);
         }
     }
-    return false;
+    return -1;
+}
+
+static inline int64_t candidate_timeout(int i) {
+    return candidates_timestamp + get_candidate(i)->timeout_ms;
+}
+
+static inline bool combo_active_on_layer(struct combo_cfg *combo, uint8_t layer) {
+    return (combo->layer_mask & ZMK_KEYMAP_LAYER_BIT(layer)) != 0;
+}
+
+static inline bool combo_active_in_profile(struct combo_cfg *combo, uint8_t profile) {
+    return (combo->profile_mask & BIT(profile)) != 0;
 }
 
 static int setup_candidates_for_first_keypress(int32_t position, int64_t timestamp) {
-    int number_of_combo_candidates = 0;
     uint8_t highest_active_layer = zmk_keymap_highest_layer_active();
-    for (int i = 0; i < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; i++) {
-        struct combo_cfg *combo = combo_lookup[position][i];
-        if (combo == NULL) {
-            return number_of_combo_candidates;
-        }
-        if (combo_active_on_layer(combo, highest_active_layer)) {
-            candidates[number_of_combo_candidates].combo = combo;
-            candidates[number_of_combo_candidates].timeout_at = timestamp + combo->timeout_ms;
-            number_of_combo_candidates++;
+    uint8_t profile = zmk_keymap_profile();
+    candidates_start = combo_lookup_offsets[position];
+    candidates_len = combo_lookup_offsets[position + 1] - candidates_start;
+    candidates_timestamp = timestamp;
+    candidates_count = 0;
+    for (int i = 0; i < candidates_len; i++) {
+        struct combo_cfg *combo = get_candidate(i);
+        if (combo_active_on_layer(combo, highest_active_layer) &&
+            combo_active_in_profile(combo, profile)) {
+            candidate_set[i / 32] |= BIT(i % 32);
+            candidates_count++;
         }
-        // LOG_DBG("combo timeout %d %d %d", position, i, candidates[i].timeout_at);
     }
-    return number_of_combo_candidates;
+    return candidates_count;
 }
 
 static int filter_candidates(int32_t position) {
-    // this code iterates over candidates and the lookup together to filter in O(n)
-    // assuming they are both sorted on key_position_len, virtal_key_position
-    int matches = 0, lookup_idx = 0, candidate_idx = 0;
-    while (lookup_idx < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY &&
-           candidate_idx < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY) {
-        struct combo_cfg *candidate = candidates[candidate_idx].combo;
-        struct combo_cfg *lookup = combo_lookup[position][lookup_idx];
-        if (candidate == NULL || lookup == NULL) {
-            break;
-        }
-        if (candidate->virtual_key_position == lookup->virtual_key_position) {
-            candidates[matches] = candidates[candidate_idx];
-            matches++;
-            candidate_idx++;
-            lookup_idx++;
-        } else if (candidate->key_position_len > lookup->key_position_len) {
-            lookup_idx++;
-        } else if (candidate->key_position_len < lookup->key_position_len) {
-            candidate_idx++;
-        } else if (candidate->virtual_key_position > lookup->virtual_key_position) {
-            lookup_idx++;
-        } else if (candidate->virtual_key_position < lookup->virtual_key_position) {
-            candidate_idx++;
+    for (int i = 0; i < candidates_len; i++) {
+        if (is_candidate(i) &&
+            !zmk_position_set_test(&get_candidate(i)->key_position_set, position)) {
+            remove_candidate(i);
         }
     }
-    // clear unmatched candidates
-    for (int i = matches; i < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; i++) {
-        candidates[i].combo = NULL;
-    }
-    // LOG_DBG("combo matches after filter %d", matches);
-    return matches;
+    // LOG_DBG("combo matches after filter %d", candidates_count);
+    return candidates_count;
 }
 
 static int64_t first_candidate_timeout() {
-    int64_t first_timeout = LONG_MAX;
-    for (int i = 0; i < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; i++) {
-        if (candidates[i].combo == NULL) {
-            break;
-        }
-        if (candidates[i].timeout_at < first_timeout) {
-            first_timeout = candidates[i].timeout_at;
+    int64_t first_timeout = LLONG_MAX;
+    for (int i = 0; i < candidates_len; i++) {
+        if (is_candidate(i) && candidate_timeout(i) < first_timeout) {
+            first_timeout = candidate_timeout(i);
         }
     }
     return first_timeout;
 }
 
 static inline bool candidate_is_completely_pressed(struct combo_cfg *candidate) {
-    // this code assumes set(pressed_keys) <= set(candidate->key_positions)
-    // this invariant is enforced by filter_candidates
     // since events may have been reraised after clearing one or more slots at
     // the start of pressed_keys (see: release_pressed_keys), we have to check
     // that each key needed to trigger the combo was pressed, not just the last.
-    for (int i = 0; i < candidate->key_position_len; i++) {
-        if (pressed_keys[i] == NULL) {
-            return false;
-        }
-    }
-    return true;
+    return zmk_position_set_contains(&pressed_positions, &candidate->key_position_set);
 }
 
 static int cleanup();
 
 static int filter_timed_out_candidates(int64_t timestamp) {
-    int num_candidates = 0;
-    for (int i = 0; i < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; i++) {
-        struct combo_candidate *candidate = &candidates[i];
-        if (candidate->combo == NULL) {
-            break;
-        }
-        if (candidate->timeout_at > timestamp) {
-            // reorder candidates so they're contiguous
-            candidates[num_candidates].combo = candidate->combo;
-            candidates[num_candidates].timeout_at = candidate->timeout_at;
-            num_candidates++;
-        } else {
-            candidate->combo = NULL;
+    for (int i = 0; i < candidates_len; i++) {
+        if (is_candidate(i) && candidate_timeout(i) <= timestamp) {
+            remove_candidate(i);
         }
     }
-    return num_candidates;
+    return candidates_count;
 }
 
 static int clear_candidates() {
-    for (int i = 0; i < CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY; i++) {
-        if (candidates[i].combo == NULL) {
-            return i;
-        }
-        candidates[i].combo = NULL;
-    }
-    return CONFIG_ZMK_COMBO_MAX_COMBOS_PER_KEY;
+    int cleared = candidates_count;
+    memset(candidate_set, 0, sizeof(candidate_set));
+    candidates_count = 0;
+    candidates_len = 0;
+    return cleared;
 }
 
 static int capture_pressed_key(const zmk_event_t *ev) {
@@ -236,6 +310,7 @@ static int capture_pressed_key(const zmk_event_t *ev) {
             continue;
         }
         pressed_keys[i] = ev;
+        zmk_position_set_add(&pressed_positions, as_zmk_position_state_changed(ev)->position);
         return ZMK_EV_EVENT_CAPTURED;
     }
     return 0;
@@ -244,12 +319,18 @@ static int capture_pressed_key(const zmk_event_t *ev) {
 const struct zmk_listener zmk_listener_combo;
 
 static int release_pressed_keys() {
+    // Reraised events may be captured again, so take all of them out of pressed_keys first. This
+    // keeps pressed_positions limited to keys that were captured again.
+    const zmk_event_t *captured_events[CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO];
+    memcpy(captured_events, pressed_keys, sizeof(pressed_keys));
+    memset(pressed_keys, 0, sizeof(pressed_keys));
+    zmk_position_set_clear(&pressed_positions);
+
     for (int i = 0; i < CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO; i++) {
-        const zmk_event_t *captured_event = pressed_keys[i];
-        if (pressed_keys[i] == NULL) {
+        const zmk_event_t *captured_event = captured_events[i];
+        if (captured_event == NULL) {
             return i;
         }
-        pressed_keys[i] = NULL;
         if (i == 0) {
             LOG_DBG("combo: releasing position event %d",
                     as_zmk_position_state_changed(captured_event)->position);
@@ -285,9 +366,14 @@ static inline int release_combo_behavior(struct combo_cfg *combo, int32_t timest
 static void move_pressed_keys_to_active_combo(struct active_combo *active_combo) {
     int combo_length = active_combo->combo->key_position_len;
     for (int i = 0; i < combo_length; i++) {
+        uint32_t position = as_zmk_position_state_changed(pressed_keys[i])->position;
+
         active_combo->key_positions_pressed[i] = pressed_keys[i];
+        zmk_position_set_remove(&pressed_positions, position);
+        zmk_position_slots_set(&active_combo_slots, position, active_combo - active_combos);
         pressed_keys[i] = NULL;
     }
+    active_combo->keys_pressed = BIT_MASK(combo_length);
     // move any other pressed keys up
     for (int i = 0; i + combo_length < CONFIG_ZMK_COMBO_MAX_KEYS_PER_COMBO; i++) {
         if (pressed_keys[i + combo_length] == NULL) {
@@ -327,8 +413,14 @@ static void activate_combo(struct combo_cfg *combo) {
 static void deactivate_combo(int active_combo_index) {
     active_combo_count--;
     if (active_combo_index != active_combo_count) {
-        memcpy(&active_combos[active_combo_index], &active_combos[active_combo_count],
-               sizeof(struct active_combo));
+        struct active_combo *moved = &active_combos[active_combo_index];
+
+        memcpy(moved, &active_combos[active_combo_count], sizeof(struct active_combo));
+        for (uint32_t pressed = moved->keys_pressed; pressed; pressed &= pressed - 1) {
+            const zmk_event_t *ev = moved->key_positions_pressed[__builtin_ctz(pressed)];
+            zmk_position_slots_set(&active_combo_slots, as_zmk_position_state_changed(ev)->position,
+                                   active_combo_index);
+        }
     }
     active_combos[active_combo_count].combo = NULL;
     active_combos[active_combo_count] = (struct active_combo){0};
@@ -336,41 +428,40 @@ static void deactivate_combo(int active_combo_index) {
 
 /* returns true if a key was released. */
 static bool release_combo_key(int32_t position, int64_t timestamp) {
-    for (int combo_idx = 0; combo_idx < active_combo_count; combo_idx++) {
-        struct active_combo *active_combo = &active_combos[combo_idx];
-
-        bool key_released = false;
-        bool all_keys_pressed = true;
-        bool all_keys_released = true;
-        for (int i = 0; i < active_combo->combo->key_position_len; i++) {
-            if (active_combo->key_positions_pressed[i] == NULL) {
-                all_keys_pressed = false;
-            } else if (as_zmk_position_state_changed(active_combo->key_positions_pressed[i])
-                           ->position != position) {
-                all_keys_released = false;
-            } else { // not null and position matches
-                ZMK_EVENT_FREE(active_combo->key_positions_pressed[i]);
-                active_combo->key_positions_pressed[i] = NULL;
-                key_released = true;
-            }
-        }
+    int combo_idx = zmk_position_slots_get(&active_combo_slots, position);
+    if (combo_idx < 0) {
+        return false;
+    }
 
-        if (key_released) {
-            if ((active_combo->combo->slow_release && all_keys_released) ||
-                (!active_combo->combo->slow_release && all_keys_pressed)) {
-                release_combo_behavior(active_combo->combo, timestamp);
-            }
-            if (all_keys_released) {
-                deactivate_combo(combo_idx);
-            }
-            return true;
+    struct active_combo *active_combo = &active_combos[combo_idx];
+    const bool all_keys_pressed =
+        active_combo->keys_pressed == BIT_MASK(active_combo->combo->key_position_len);
+
+    for (uint32_t pressed = active_combo->keys_pressed; pressed; pressed &= pressed - 1) {
+        int i = __builtin_ctz(pressed);
+        if (as_zmk_position_state_changed(active_combo->key_positions_pressed[i])->position ==
+            position) {
+            ZMK_EVENT_FREE(active_combo->key_positions_pressed[i]);
+            active_combo->key_positions_pressed[i] = NULL;
+            active_combo->keys_pressed &= ~BIT(i);
+            break;
         }
     }
-    return false;
+    zmk_position_slots_clear(&active_combo_slots, position, combo_idx);
+
+    const bool all_keys_released = active_combo->keys_pressed == 0;
+    if ((active_combo->combo->slow_release && all_keys_released) ||
+        (!active_combo->combo->slow_release && all_keys_pressed)) {
+        release_combo_behavior(active_combo->combo, timestamp);
+    }
+    if (all_keys_released) {
+        deactivate_combo(combo_idx);
+    }
+    return true;
 }
 
 static int cleanup() {
-    k_work_cancel_delayable(&timeout_task);
+    zmk_behavior_timer_cancel(&timeout_task);
     clear_candidates();
     if (fully_pressed_combo != NULL) {
         activate_combo(fully_pressed_combo);
@@ -381,22 +472,16 @@ static int cleanup() {
 
 static void update_timeout_task() {
     int64_t first_timeout = first_candidate_timeout();
-    if (timeout_task_timeout_at == first_timeout) {
-        return;
-    }
     if (first_timeout == LLONG_MAX) {
-        timeout_task_timeout_at = 0;
-        k_work_cancel_delayable(&timeout_task);
+        zmk_behavior_timer_cancel(&timeout_task);
         return;
     }
-    if (k_work_schedule(&timeout_task, K_MSEC(first_timeout - k_uptime_get())) >= 0) {
-        timeout_task_timeout_at = first_timeout;
-    }
+    zmk_behavior_timer_schedule(&timeout_task, first_timeout);
 }
 
 static int position_state_down(const zmk_event_t *ev, struct zmk_position_state_changed *data) {
     int num_candidates;
-    if (candidates[0].combo == NULL) {
+    if (candidates_count == 0) {
         num_candidates = setup_candidates_for_first_keypress(data->position, data->timestamp);
         if (num_candidates == 0) {
             return 0;
@@ -407,7 +492,10 @@ static int position_state_down(const zmk_event_t *ev, struct zmk_position_state_
     }
     update_timeout_task();
 
-    struct combo_cfg *candidate_combo = candidates[0].combo;
+    struct combo_cfg *candidate_combo = NULL;
+    if (num_candidates > 0) {
+        candidate_combo = get_candidate(first_candidate());
+    }
     LOG_DBG("combo: capturing position event %d", data->position);
     int ret = capture_pressed_key(ev);
     switch (num_candidates) {
@@ -423,6 +511,9 @@ static int position_state_down(const zmk_event_t *ev, struct zmk_position_state_
     default:
         if (candidate_is_completely_pressed(candidate_combo)) {
             fully_pressed_combo = candidate_combo;
+            if (candidate_combo->eager) {
+                cleanup();
+            }
         }
         return ret;
     }
@@ -442,12 +533,8 @@ static int position_state_up(const zmk_event_t *ev, struct zmk_position_state_ch
     return 0;
 }
 
-static void combo_timeout_handler(struct k_work *item) {
-    if (timeout_task_timeout_at == 0 || k_uptime_get() < timeout_task_timeout_at) {
-        // timer was cancelled or rescheduled.
-        return;
-    }
-    if (filter_timed_out_candidates(timeout_task_timeout_at) < 2) {
+static void combo_timeout_handler(struct zmk_behavior_timer *timer) {
+    if (filter_timed_out_candidates(timer->deadline) < 2) {
         cleanup();
     }
     update_timeout_task();
@@ -467,30 +554,17 @@ static int position_state_changed_listener(const zmk_event_t *ev) {
 }
 
 ZMK_LISTENER(combo, position_state_changed_listener);
-ZMK_SUBSCRIPTION(combo, zmk_position_state_changed);
-
-#define COMBO_INST(n)                                                                              \
-    static struct combo_cfg combo_config_##n = {                                                   \
-        .timeout_ms = DT_PROP(n, timeout_ms),                                                      \
-        .key_positions = DT_PROP(n, key_positions),                                                \
-        .key_position_len = DT_PROP_LEN(n, key_positions),                                         \
-        .behavior = ZMK_KEYMAP_EXTRACT_BINDING(0, n),                                              \
-        .virtual_key_position = ZMK_KEYMAP_LEN + __COUNTER__,                                      \
-        .slow_release = DT_PROP(n, slow_release),                                                  \
-        .layers = DT_PROP(n, layers),                                                              \
-        .layers_len = DT_PROP_LEN(n, layers),                                                      \
-    };
-
-#define INITIALIZE_COMBO(n) initialize_combo(&combo_config_##n);
-
-DT_INST_FOREACH_CHILD(0, COMBO_INST)
+ZMK_SUBSCRIPTION_CAPTURING(combo, zmk_position_state_changed);
 
 static int combo_init() {
-    k_work_init_delayable(&timeout_task, combo_timeout_handler);
-    DT_INST_FOREACH_CHILD(0, INITIALIZE_COMBO);
+    zmk_behavior_timer_init(&timeout_task, combo_timeout_handler);
+    for (int i = 0; i < COMBOS_LEN; i++) {
+        initialize_combo(combos[i]);
+    }
+    initialize_combo_lookup();
     return 0;
 }
 
-SYS_INIT(combo_init, APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+ZMK_SYS_INIT(combo_init, APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
 
 #endif
@@ -33,7 +33,7 @@ struct conditional_layer_cfg {
     int8_t then_layer;
 };
 
-#define IF_LAYER_BIT(i, n) BIT(DT_PROP_BY_IDX(n, if_layers, i)) |
+#define IF_LAYER_BIT(i, n) ZMK_KEYMAP_LAYER_BIT(DT_PROP_BY_IDX(n, if_layers, i)) |
 
 // Evaluates to conditional_layer_cfg struct initializer.
 #define CONDITIONAL_LAYER_DECL(n)                                                                  \
@@ -43,6 +43,14 @@ struct conditional_layer_cfg {
         .then_layer = DT_PROP(n, then_layer),                                                      \
     },
 
+#define CONDITIONAL_LAYER_BITS(n)                                                                  \
+    UTIL_LISTIFY(DT_PROP_LEN(n, if_layers), IF_LAYER_BIT, n)                                       \
+    ZMK_KEYMAP_LAYER_BIT(DT_PROP(n, then_layer)) |
+
+// Every layer used as an if-layer or then-layer. Changes to other layers can't affect any config.
+static const zmk_keymap_layers_state_t CONDITIONAL_LAYERS_MASK =
+    DT_INST_FOREACH_CHILD(0, CONDITIONAL_LAYER_BITS) 0;
+
 // All conditional layer configurations in the keymap.
 static const struct conditional_layer_cfg CONDITIONAL_LAYER_CFGS[] = {
     DT_INST_FOREACH_CHILD(0, CONDITIONAL_LAYER_DECL)};
@@ -50,71 +58,107 @@ static const struct conditional_layer_cfg CONDITIONAL_LAYER_CFGS[] = {
 static const int32_t NUM_CONDITIONAL_LAYER_CFGS =
     sizeof(CONDITIONAL_LAYER_CFGS) / sizeof(*CONDITIONAL_LAYER_CFGS);
 
-static void conditional_layer_activate(int8_t layer) {
-    // This may trigger another event that could, in turn, activate additional then-layers. However,
-    // the process will eventually terminate (at worst, when every layer is active).
-    if (!zmk_keymap_layer_active(layer)) {
-        LOG_DBG("layer %d", layer);
-        zmk_keymap_layer_activate(layer);
+// Both update `state`, which is applied as a whole once every then-layer has been resolved.
+static void conditional_layer_activate(zmk_keymap_layers_state_t *state, int8_t layer) {
+    LOG_DBG("layer %d", layer);
+    *state |= ZMK_KEYMAP_LAYER_BIT(layer);
+}
+
+// This may deactivate a then-layer that's already active via another mechanism (e.g., a momentary
+// layer behavior). However, the same problem arises when multiple keys with the same &mo binding
+// are held and then one is released, so it's probably not an issue in practice.
+static void conditional_layer_deactivate(zmk_keymap_layers_state_t *state, int8_t layer) {
+    LOG_DBG("layer %d", layer);
+    *state &= ~ZMK_KEYMAP_LAYER_BIT(layer);
+}
+
+// Returns the then-layers whose configs read any of the `changed` layers, either as an if-layer or
+// as the then-layer itself. Only these then-layers can need an update.
+static zmk_keymap_layers_state_t affected_then_layers(zmk_keymap_layers_state_t changed) {
+    zmk_keymap_layers_state_t affected = 0;
+
+    for (int i = 0; i < NUM_CONDITIONAL_LAYER_CFGS; i++) {
+        const struct conditional_layer_cfg *cfg = CONDITIONAL_LAYER_CFGS + i;
+        zmk_keymap_layers_state_t then_bit = ZMK_KEYMAP_LAYER_BIT(cfg->then_layer);
+
+        if (((cfg->if_layers_state_mask | then_bit) & changed) != 0U) {
+            affected |= then_bit;
+        }
     }
+
+    return affected;
 }
 
-static void conditional_layer_deactivate(int8_t layer) {
-    // This may deactivate a then-layer that's already active via another mechanism (e.g., a
-    // momentary layer behavior). However, the same problem arises when multiple keys with the same
-    // &mo binding are held and then one is released, so it's probably not an issue in practice.
-    if (zmk_keymap_layer_active(layer)) {
-        LOG_DBG("layer %d", layer);
-        zmk_keymap_layer_deactivate(layer);
+// Returns which of the `then_layers` should be active in `layer_state`. A then-layer shared by
+// several configs is active if any one of them has all of its if-layers active.
+static zmk_keymap_layers_state_t desired_then_layers(zmk_keymap_layers_state_t then_layers,
+                                                     zmk_keymap_layers_state_t layer_state) {
+    zmk_keymap_layers_state_t desired = 0;
+
+    for (int i = 0; i < NUM_CONDITIONAL_LAYER_CFGS; i++) {
+        const struct conditional_layer_cfg *cfg = CONDITIONAL_LAYER_CFGS + i;
+        zmk_keymap_layers_state_t mask = cfg->if_layers_state_mask;
+        zmk_keymap_layers_state_t then_bit = ZMK_KEYMAP_LAYER_BIT(cfg->then_layer);
+
+        if ((then_bit & then_layers) != 0U && (layer_state & mask) == mask) {
+            desired |= then_bit;
+        }
     }
+
+    return desired;
 }
 
-static int layer_state_changed_listener(const zmk_event_t *ev) {
-    static bool conditional_layer_updates_needed;
+static int layer_state_changed_listener(const zmk_event_t *eh) {
+    const struct zmk_layer_state_changed *ev = as_zmk_layer_state_changed(eh);
+    if (ev == NULL) {
+        return 0;
+    }
 
-    conditional_layer_updates_needed = true;
+    zmk_keymap_layers_state_t changed =
+        (ev->previous_layer_state ^ ev->layer_state) & CONDITIONAL_LAYERS_MASK;
+    if (changed == 0) {
+        return 0;
+    }
 
-    // Semaphore ensures we don't re-enter the loop in the middle of doing update, and
-    // ensures that "waterfalling layer updates" are all processed to trigger subsequent
-    // nested conditional layers properly.
+    // The state change applied below raises its own event. The semaphore makes us ignore it, since
+    // the loop has already resolved every then-layer that depends on it.
     if (k_sem_take(&conditional_layer_sem, K_NO_WAIT) < 0) {
         return 0;
     }
 
-    while (conditional_layer_updates_needed) {
-        int8_t max_then_layer = -1;
-        uint32_t then_layers = 0;
-        uint32_t then_layer_state = 0;
-
-        conditional_layer_updates_needed = false;
-
-        // On layer state changes, examines each conditional layer config to determine if then-layer
-        // in the config should activate based on the currently active set of if-layers.
-        for (int i = 0; i < NUM_CONDITIONAL_LAYER_CFGS; i++) {
-            const struct conditional_layer_cfg *cfg = CONDITIONAL_LAYER_CFGS + i;
-            zmk_keymap_layers_state_t mask = cfg->if_layers_state_mask;
-            then_layers |= BIT(cfg->then_layer);
-            max_then_layer = MAX(max_then_layer, cfg->then_layer);
-
-            // Activate then-layer if and only if all if-layers are already active. Note that we
-            // reevaluate the current layer state for each config since activation of one layer can
-            // also trigger activation of another.
-            if ((zmk_keymap_layer_state() & mask) == mask) {
-                then_layer_state |= BIT(cfg->then_layer);
-            }
-        }
+    zmk_keymap_layers_state_t initial_state = zmk_keymap_layer_state();
+    zmk_keymap_layers_state_t layer_state = initial_state;
 
-        for (uint8_t layer = 0; layer <= max_then_layer; layer++) {
-            if ((BIT(layer) & then_layers) != 0U) {
-                if ((BIT(layer) & then_layer_state) != 0U) {
-                    conditional_layer_activate(layer);
-                } else {
-                    conditional_layer_deactivate(layer);
-                }
-            }
+    // Settle chained configs (a then-layer used as another config's if-layer) locally, only
+    // re-evaluating configs whose inputs changed in the previous pass. Each pass can only change
+    // then-layers, so this terminates within one pass per layer.
+    for (int pass = 0; changed != 0 && pass < ZMK_KEYMAP_LAYERS_LEN; pass++) {
+        zmk_keymap_layers_state_t affected = affected_then_layers(changed);
+        zmk_keymap_layers_state_t next_state =
+            (layer_state & ~affected) | desired_then_layers(affected, layer_state);
+
+        changed = next_state ^ layer_state;
+        layer_state = next_state;
+    }
+
+    zmk_keymap_layers_state_t new_state = initial_state;
+
+    changed = layer_state ^ initial_state;
+    while (changed) {
+        uint8_t layer = zmk_keymap_layers_state_lowest(changed);
+        changed &= ~ZMK_KEYMAP_LAYER_BIT(layer);
+
+        if ((ZMK_KEYMAP_LAYER_BIT(layer) & layer_state) != 0U) {
+            conditional_layer_activate(&new_state, layer);
+        } else {
+            conditional_layer_deactivate(&new_state, layer);
         }
     }
 
+    // Apply every then-layer change at once, so listeners see a single layer state event instead
+    // of one per then-layer.
+    zmk_keymap_layer_state_set(new_state);
+
     k_sem_give(&conditional_layer_sem);
     return 0;
 }
@@ -6,6 +6,7 @@
 
 #include <kernel.h>
 #include <init.h>
+#include <string.h>
 #include <device.h>
 #include <devicetree.h>
 
@@ -17,7 +18,11 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zmk/event_manager.h>
 #include <zmk/events/activity_state_changed.h>
+#include <zmk/display/rle_image.h>
 #include <zmk/display/status_screen.h>
+#include <zmk/energy_stats.h>
+#include <zmk/ext_power.h>
+#include <zmk/work_watchdog.h>
 
 #define ZMK_DISPLAY_NAME CONFIG_LVGL_DISPLAY_DEV_NAME
 
@@ -28,18 +33,21 @@ static lv_obj_t *screen;
 
 __attribute__((weak)) lv_obj_t *zmk_display_status_screen() { return NULL; }
 
-void display_tick_cb(struct k_work *work) { lv_task_handler(); }
-
-#define TICK_MS 10
-
-K_WORK_DEFINE(display_tick_work, display_tick_cb);
-
 #if IS_ENABLED(CONFIG_ZMK_DISPLAY_WORK_QUEUE_DEDICATED)
 
 K_THREAD_STACK_DEFINE(display_work_stack_area, CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_STACK_SIZE);
 
 static struct k_work_q display_work_q;
 
+#if IS_ENABLED(CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED)
+#define INPUT_THREAD_PRIORITY CONFIG_ZMK_INPUT_DEDICATED_THREAD_PRIORITY
+#else
+#define INPUT_THREAD_PRIORITY CONFIG_SYSTEM_WORKQUEUE_PRIORITY
+#endif
+
+BUILD_ASSERT(CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_PRIORITY > INPUT_THREAD_PRIORITY,
+             "The display work queue must have a lower priority than the input work queue");
+
 #endif
 
 struct k_work_q *zmk_display_work_q() {
@@ -50,18 +58,114 @@ struct k_work_q *zmk_display_work_q() {
 #endif
 }
 
-void display_timer_cb() {
-    lv_tick_inc(TICK_MS);
-    k_work_submit_to_queue(zmk_display_work_q(), &display_tick_work);
+// Longest time between ticks while LVGL is busy.
+#define TICK_MS 10
+
+static bool updates_running = false;
+static int64_t last_tick;
+// Start of the last tick. Refreshes are held back until the frame interval has passed since then.
+static int64_t last_frame = INT64_MIN / 2;
+
+static void display_tick_cb(struct k_work *work);
+
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY_FLUSH_BANDS)
+#define BAND_ROWS CONFIG_ZMK_DISPLAY_FLUSH_BAND_ROWS
+
+// LVGL flushes every invalidated area on its own, and only joins two of them when that doesn't
+// draw more pixels. Each flush costs a whole bus transaction, so instead join all areas whose rows
+// fall into the same or neighboring bands of the controller's row addressing, such as the 8 row
+// pages of an SSD1306, leaving one flush for each run of bands with changes in it.
+static void coalesce_invalid_areas(lv_disp_t *disp) {
+    const lv_coord_t last_row = lv_disp_get_ver_res(disp) - 1;
+    lv_area_t bands[LV_INV_BUF_SIZE];
+    int count = 0;
+
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (disp->inv_area_joined[i]) {
+            continue;
+        }
+
+        lv_area_t area = disp->inv_areas[i];
+        area.y1 -= area.y1 % BAND_ROWS;
+        area.y2 = MIN(area.y2 - area.y2 % BAND_ROWS + BAND_ROWS - 1, last_row);
+
+        // A merged area can reach bands already checked, so start over after each merge.
+        for (int j = 0; j < count;) {
+            if (area.y1 > bands[j].y2 + 1 || bands[j].y1 > area.y2 + 1) {
+                j++;
+                continue;
+            }
+
+            area.x1 = MIN(area.x1, bands[j].x1);
+            area.y1 = MIN(area.y1, bands[j].y1);
+            area.x2 = MAX(area.x2, bands[j].x2);
+            area.y2 = MAX(area.y2, bands[j].y2);
+            bands[j] = bands[--count];
+            j = 0;
+        }
+
+        bands[count++] = area;
+    }
+
+    memcpy(disp->inv_areas, bands, count * sizeof(bands[0]));
+    memset(disp->inv_area_joined, 0, sizeof(disp->inv_area_joined));
+    disp->inv_p = count;
 }
+#endif
+
+ZMK_WORK_WATCHDOG_WRAP(display_tick_cb)
+K_WORK_DELAYABLE_DEFINE(display_tick_work, ZMK_WORK_WATCHED(display_tick_cb));
 
-void blank_display_cb(struct k_work *work) { display_blanking_on(display); }
+// LVGL only has work to do after something is invalidated or while an animation runs, so only
+// keep ticking until it has drawn the last change rather than waking up the CPU periodically.
+static void display_tick_cb(struct k_work *work) {
+    int64_t now = k_uptime_get();
 
-void unblank_display_cb(struct k_work *work) { display_blanking_off(display); }
+    lv_tick_inc(now - last_tick);
+    last_tick = now;
+    last_frame = now;
 
-K_TIMER_DEFINE(display_timer, display_timer_cb, NULL);
-K_WORK_DEFINE(blank_display_work, blank_display_cb);
-K_WORK_DEFINE(unblank_display_work, unblank_display_cb);
+    zmk_energy_stats_count(ZMK_ENERGY_DISPLAY_REFRESH);
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY_FLUSH_BANDS)
+    // Areas invalidated by LVGL's own tasks, such as animations, are flushed as LVGL sees fit.
+    coalesce_invalid_areas(lv_disp_get_default());
+#endif
+    uint32_t delay = MIN(lv_task_handler(), TICK_MS);
+
+    if (updates_running && (lv_anim_count_running() > 0 || lv_disp_get_default()->inv_p > 0)) {
+        k_work_schedule_for_queue(zmk_display_work_q(), &display_tick_work, K_MSEC(delay));
+    }
+}
+
+k_timeout_t zmk_display_frame_delay() {
+    int64_t remaining = last_frame + CONFIG_ZMK_DISPLAY_MIN_FRAME_INTERVAL_MS - k_uptime_get();
+
+    return remaining > 0 ? K_MSEC(remaining) : K_NO_WAIT;
+}
+
+void zmk_display_request_refresh() {
+    if (updates_running) {
+        // Scheduling leaves an earlier pending tick alone, so requests within a frame share it.
+        k_work_schedule_for_queue(zmk_display_work_q(), &display_tick_work,
+                                  zmk_display_frame_delay());
+    }
+}
+
+// Both run on the display queue, so the claims follow the blanking in order.
+void blank_display_cb(struct k_work *work) {
+    display_blanking_on(display);
+    zmk_ext_power_claim(ZMK_EXT_POWER_CONSUMER_DISPLAY, false);
+}
+
+void unblank_display_cb(struct k_work *work) {
+    zmk_ext_power_claim(ZMK_EXT_POWER_CONSUMER_DISPLAY, true);
+    display_blanking_off(display);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(blank_display_cb)
+K_WORK_DEFINE(blank_display_work, ZMK_WORK_WATCHED(blank_display_cb));
+ZMK_WORK_WATCHDOG_WRAP(unblank_display_cb)
+K_WORK_DEFINE(unblank_display_work, ZMK_WORK_WATCHED(unblank_display_cb));
 
 static void start_display_updates() {
     if (display == NULL) {
@@ -70,7 +174,8 @@ static void start_display_updates() {
 
     k_work_submit_to_queue(zmk_display_work_q(), &unblank_display_work);
 
-    k_timer_start(&display_timer, K_MSEC(TICK_MS), K_MSEC(TICK_MS));
+    updates_running = true;
+    zmk_display_request_refresh();
 }
 
 #if IS_ENABLED(CONFIG_ZMK_DISPLAY_BLANK_ON_IDLE)
@@ -82,7 +187,8 @@ static void stop_display_updates() {
 
     k_work_submit_to_queue(zmk_display_work_q(), &blank_display_work);
 
-    k_timer_stop(&display_timer);
+    updates_running = false;
+    k_work_cancel_delayable(&display_tick_work);
 }
 
 #endif
@@ -100,6 +206,10 @@ void initialize_display(struct k_work *work) {
 
     initialized = true;
 
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY_RLE_IMAGES)
+    zmk_display_rle_image_init();
+#endif
+
     screen = zmk_display_status_screen();
 
     if (screen == NULL) {
@@ -112,13 +222,15 @@ void initialize_display(struct k_work *work) {
     start_display_updates();
 }
 
-K_WORK_DEFINE(init_work, initialize_display);
+ZMK_WORK_WATCHDOG_WRAP(initialize_display)
+K_WORK_DEFINE(init_work, ZMK_WORK_WATCHED(initialize_display));
 
 int zmk_display_init() {
 #if IS_ENABLED(CONFIG_ZMK_DISPLAY_WORK_QUEUE_DEDICATED)
+    static const struct k_work_queue_config queue_config = {.name = "ZMK Display Work"};
     k_work_queue_start(&display_work_q, display_work_stack_area,
                        K_THREAD_STACK_SIZEOF(display_work_stack_area),
-                       CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_PRIORITY, NULL);
+                       CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_PRIORITY, &queue_config);
 #endif
 
     k_work_submit_to_queue(zmk_display_work_q(), &init_work);
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display/rle_image.h>
+
+static const lv_img_dsc_t *rle_image_get(const void *src) {
+    if (lv_img_src_get_type(src) != LV_IMG_SRC_VARIABLE) {
+        return NULL;
+    }
+
+    const lv_img_dsc_t *img = src;
+    if (img->header.cf != ZMK_RLE_IMAGE_CF || img->data_size == 0) {
+        return NULL;
+    }
+
+    return img;
+}
+
+static lv_res_t rle_image_info(lv_img_decoder_t *decoder, const void *src,
+                               lv_img_header_t *header) {
+    const lv_img_dsc_t *img = rle_image_get(src);
+    if (img == NULL) {
+        return LV_RES_INV;
+    }
+
+    *header = img->header;
+    return LV_RES_OK;
+}
+
+static lv_res_t rle_image_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc) {
+    if (rle_image_get(dsc->src) == NULL) {
+        return LV_RES_INV;
+    }
+
+    // Leaving img_data unset makes LVGL read the image a line at a time, so nothing is decoded
+    // into RAM ahead of drawing.
+    dsc->img_data = NULL;
+    return LV_RES_OK;
+}
+
+static uint8_t rle_image_run(const uint8_t *runs, bool nibbles, size_t index) {
+    if (!nibbles) {
+        return runs[index];
+    }
+
+    return index % 2 ? runs[index / 2] & 0x0F : runs[index / 2] >> 4;
+}
+
+// Images are only a few hundred bytes, so each line is found by scanning the runs from the start
+// rather than keeping decoder state between lines.
+static lv_res_t rle_image_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc,
+                                    lv_coord_t x, lv_coord_t y, lv_coord_t len, uint8_t *buf) {
+    const lv_img_dsc_t *img = dsc->src;
+    const bool nibbles = img->data[0] == ZMK_RLE_IMAGE_RUNS_4;
+    const size_t count = (img->data_size - 1) * (nibbles ? 2 : 1);
+    const uint32_t start = y * img->header.w + x;
+    const uint32_t end = start + len;
+    lv_color_t *pixels = (lv_color_t *)buf;
+    uint32_t pos = 0;
+    bool black = false;
+
+    for (size_t i = 0; i < count && pos < end; i++, black = !black) {
+        uint32_t run_end = pos + rle_image_run(&img->data[1], nibbles, i);
+
+        for (uint32_t p = MAX(pos, start); p < MIN(run_end, end); p++) {
+            pixels[p - start] = black ? LV_COLOR_BLACK : LV_COLOR_WHITE;
+        }
+
+        pos = run_end;
+    }
+
+    for (uint32_t p = MAX(pos, start); p < end; p++) {
+        pixels[p - start] = LV_COLOR_WHITE;
+    }
+
+    return LV_RES_OK;
+}
+
+int zmk_display_rle_image_init() {
+    lv_img_decoder_t *decoder = lv_img_decoder_create();
+    if (decoder == NULL) {
+        LOG_ERR("Failed to create the run-length encoded image decoder");
+        return -ENOMEM;
+    }
+
+    lv_img_decoder_set_info_cb(decoder, rle_image_info);
+    lv_img_decoder_set_open_cb(decoder, rle_image_open);
+    lv_img_decoder_set_read_line_cb(decoder, rle_image_read_line);
+
+    return 0;
+}
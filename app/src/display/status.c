@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <bluetooth/services/bas.h>
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+#include <zmk/display/status.h>
+#include <zmk/event_manager.h>
+#include <zmk/ble.h>
+#include <zmk/endpoints.h>
+#include <zmk/keymap.h>
+#include <zmk/usb.h>
+#include <zmk/wpm.h>
+#include <zmk/split/bluetooth/central.h>
+#include <zmk/split/bluetooth/peripheral.h>
+#include <zmk/events/battery_state_changed.h>
+#include <zmk/events/ble_active_profile_changed.h>
+#include <zmk/events/endpoint_selection_changed.h>
+#include <zmk/events/layer_state_changed.h>
+#include <zmk/events/keymap_profile_changed.h>
+#include <zmk/events/peripheral_battery_state_changed.h>
+#include <zmk/events/split_link_stats_changed.h>
+#include <zmk/events/split_peripheral_status_changed.h>
+#include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/events/wpm_state_changed.h>
+#include <zmk/work_watchdog.h>
+
+// Only the central, or a keyboard that is not split, knows the endpoint and the layers.
+#define HAS_KEYMAP (!IS_ENABLED(CONFIG_ZMK_SPLIT) || IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL))
+
+static sys_slist_t listeners = SYS_SLIST_STATIC_INIT(&listeners);
+
+// Union of the fields of every listener. Events for other fields are ignored.
+static uint32_t interest;
+
+// Protects status and pending.
+K_MUTEX_DEFINE(status_mutex);
+static struct zmk_display_status status;
+// Fields that changed since the listeners were last called.
+static uint32_t pending;
+
+// What the listeners were last called with. Only used in the display queue context.
+static struct zmk_display_status rendered;
+
+static void status_work_cb(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(status_work_cb)
+K_WORK_DELAYABLE_DEFINE(status_work, ZMK_WORK_WATCHED(status_work_cb));
+
+#define UPDATE_FIELD(field, value, bit, changed)                                                   \
+    do {                                                                                           \
+        __typeof__(status.field) _value = (value);                                                 \
+        if (status.field != _value) {                                                              \
+            status.field = _value;                                                                 \
+            changed |= (bit);                                                                      \
+        }                                                                                          \
+    } while (0)
+
+static uint8_t get_layer_index(const zmk_event_t *eh) {
+#if HAS_KEYMAP
+    const struct zmk_layer_state_changed *ev = eh != NULL ? as_zmk_layer_state_changed(eh) : NULL;
+    if (ev != NULL) {
+        return zmk_keymap_layers_state_highest(ev->layer_state |
+                                               ZMK_KEYMAP_LAYER_BIT(zmk_keymap_layer_default()));
+    }
+
+    return zmk_keymap_highest_layer_active();
+#else
+    return 0;
+#endif
+}
+
+// Fetch the given fields from ZMK core. Must be called with status_mutex held.
+static uint32_t refresh_status(uint32_t fields, const zmk_event_t *eh) {
+    uint32_t changed = 0;
+
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    if (fields & ZMK_DISPLAY_STATUS_BATTERY) {
+        UPDATE_FIELD(battery_level, bt_bas_get_battery_level(), ZMK_DISPLAY_STATUS_BATTERY,
+                     changed);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+    if (fields & ZMK_DISPLAY_STATUS_USB) {
+        UPDATE_FIELD(usb_powered, zmk_usb_is_powered(), ZMK_DISPLAY_STATUS_USB, changed);
+    }
+#endif
+
+#if HAS_KEYMAP
+    if (fields & ZMK_DISPLAY_STATUS_OUTPUT) {
+        UPDATE_FIELD(selected_endpoint, zmk_endpoints_selected(), ZMK_DISPLAY_STATUS_OUTPUT,
+                     changed);
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+        UPDATE_FIELD(active_profile_connected, zmk_ble_active_profile_is_connected(),
+                     ZMK_DISPLAY_STATUS_OUTPUT, changed);
+        UPDATE_FIELD(active_profile_bonded, !zmk_ble_active_profile_is_open(),
+                     ZMK_DISPLAY_STATUS_OUTPUT, changed);
+        UPDATE_FIELD(active_profile_index, zmk_ble_active_profile_index(),
+                     ZMK_DISPLAY_STATUS_OUTPUT, changed);
+#endif
+    }
+
+    if (fields & ZMK_DISPLAY_STATUS_LAYER) {
+        uint8_t index = get_layer_index(eh);
+
+        UPDATE_FIELD(layer_index, index, ZMK_DISPLAY_STATUS_LAYER, changed);
+        UPDATE_FIELD(layer_label, zmk_keymap_layer_label(index), ZMK_DISPLAY_STATUS_LAYER,
+                     changed);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+    if (fields & ZMK_DISPLAY_STATUS_WPM) {
+        UPDATE_FIELD(wpm, zmk_wpm_get_state(), ZMK_DISPLAY_STATUS_WPM, changed);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE) && !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+    if (fields & ZMK_DISPLAY_STATUS_PERIPHERAL) {
+        UPDATE_FIELD(peripheral_connected, zmk_split_bt_peripheral_is_connected(),
+                     ZMK_DISPLAY_STATUS_PERIPHERAL, changed);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+    if (fields & ZMK_DISPLAY_STATUS_SPLIT_LATENCY) {
+        const struct zmk_split_link_stats_changed *ev =
+            eh != NULL ? as_zmk_split_link_stats_changed(eh) : NULL;
+        uint32_t rtt_us = ev != NULL ? ev->rtt_us : zmk_split_bt_link_stats(0)->rtt_last_us;
+
+        UPDATE_FIELD(split_rtt_us, rtt_us, ZMK_DISPLAY_STATUS_SPLIT_LATENCY, changed);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY)
+    if (fields & ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY) {
+        UPDATE_FIELD(peripheral_battery_level, zmk_split_bt_peripheral_battery_level(0),
+                     ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY, changed);
+    }
+#endif
+
+    return changed;
+}
+
+#define STATUS_FIELDS(X)                                                                           \
+    X(battery_level, ZMK_DISPLAY_STATUS_BATTERY)                                                   \
+    X(usb_powered, ZMK_DISPLAY_STATUS_USB)                                                         \
+    X(selected_endpoint, ZMK_DISPLAY_STATUS_OUTPUT)                                                \
+    X(active_profile_connected, ZMK_DISPLAY_STATUS_OUTPUT)                                         \
+    X(active_profile_bonded, ZMK_DISPLAY_STATUS_OUTPUT)                                            \
+    X(active_profile_index, ZMK_DISPLAY_STATUS_OUTPUT)                                             \
+    X(layer_index, ZMK_DISPLAY_STATUS_LAYER)                                                       \
+    X(layer_label, ZMK_DISPLAY_STATUS_LAYER)                                                       \
+    X(wpm, ZMK_DISPLAY_STATUS_WPM)                                                                 \
+    X(peripheral_connected, ZMK_DISPLAY_STATUS_PERIPHERAL)                                         \
+    X(split_rtt_us, ZMK_DISPLAY_STATUS_SPLIT_LATENCY)                                              \
+    X(peripheral_battery_level, ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY)
+
+static uint32_t differing_fields(const struct zmk_display_status *a,
+                                 const struct zmk_display_status *b) {
+    uint32_t fields = 0;
+
+#define DIFFERS(field, bit) fields |= a->field != b->field ? (bit) : 0;
+    STATUS_FIELDS(DIFFERS)
+#undef DIFFERS
+
+    return fields;
+}
+
+static void copy_fields(struct zmk_display_status *dst, const struct zmk_display_status *src,
+                        uint32_t fields) {
+#define COPY(field, bit)                                                                           \
+    if (fields & (bit)) {                                                                          \
+        dst->field = src->field;                                                                   \
+    }
+    STATUS_FIELDS(COPY)
+#undef COPY
+}
+
+// Calls the listeners for everything that changed since the last time. It runs at most once per
+// frame, so a burst of events results in one redraw of each changed field.
+static void status_work_cb(struct k_work *work) {
+    k_mutex_lock(&status_mutex, K_FOREVER);
+    struct zmk_display_status copy = status;
+    uint32_t changed = pending;
+    pending = 0;
+    k_mutex_unlock(&status_mutex);
+
+    // A change undone within the frame, such as a layer held and released again, leaves nothing
+    // to redraw.
+    changed &= differing_fields(&copy, &rendered);
+    rendered = copy;
+    if (changed == 0) {
+        return;
+    }
+
+    struct zmk_display_status_listener *listener;
+    SYS_SLIST_FOR_EACH_CONTAINER(&listeners, listener, node) {
+        if (listener->fields & changed) {
+            listener->update(&copy, listener->fields & changed);
+        }
+    }
+
+    zmk_display_request_refresh();
+}
+
+void zmk_display_status_subscribe(struct zmk_display_status_listener *listener) {
+    sys_snode_t *prev;
+
+    k_mutex_lock(&status_mutex, K_FOREVER);
+
+    if (!sys_slist_find(&listeners, &listener->node, &prev)) {
+        sys_slist_append(&listeners, &listener->node);
+    }
+
+    // Fields nobody was interested in before are out of date.
+    uint32_t new_fields = listener->fields & ~interest;
+    refresh_status(new_fields, NULL);
+    interest |= listener->fields;
+
+    struct zmk_display_status copy = status;
+    k_mutex_unlock(&status_mutex);
+
+    // Other listeners may still have changes of the fields they already had pending.
+    copy_fields(&rendered, &copy, new_fields);
+
+    listener->update(&copy, listener->fields);
+}
+
+static uint32_t event_fields(const zmk_event_t *eh) {
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    if (as_zmk_battery_state_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_BATTERY;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+    if (as_zmk_usb_conn_state_changed(eh)) {
+        // Plugging in USB can also change the selected endpoint.
+        return ZMK_DISPLAY_STATUS_USB | ZMK_DISPLAY_STATUS_OUTPUT;
+    }
+#endif
+
+#if HAS_KEYMAP
+    if (as_zmk_endpoint_selection_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_OUTPUT;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    if (as_zmk_ble_active_profile_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_OUTPUT;
+    }
+#endif
+
+    // Switching profiles can change the layer labels.
+    if (as_zmk_layer_state_changed(eh) || as_zmk_keymap_profile_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_LAYER;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+    if (as_zmk_wpm_state_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_WPM;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT)
+    if (as_zmk_split_peripheral_status_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_PERIPHERAL;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+    if (as_zmk_split_link_stats_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_SPLIT_LATENCY;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY)
+    if (as_zmk_peripheral_battery_state_changed(eh)) {
+        return ZMK_DISPLAY_STATUS_PERIPHERAL_BATTERY;
+    }
+#endif
+
+    return 0;
+}
+
+static int display_status_listener(const zmk_event_t *eh) {
+    uint32_t fields = event_fields(eh) & interest;
+
+    if (fields == 0 || !zmk_display_is_initialized()) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    k_mutex_lock(&status_mutex, K_FOREVER);
+    uint32_t changed = refresh_status(fields, eh);
+    pending |= changed;
+    k_mutex_unlock(&status_mutex);
+
+    if (changed) {
+        k_work_schedule_for_queue(zmk_display_work_q(), &status_work, zmk_display_frame_delay());
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(display_status, display_status_listener);
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+ZMK_SUBSCRIPTION(display_status, zmk_battery_state_changed);
+#endif
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+ZMK_SUBSCRIPTION(display_status, zmk_usb_conn_state_changed);
+#endif
+#if HAS_KEYMAP
+ZMK_SUBSCRIPTION(display_status, zmk_endpoint_selection_changed);
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+ZMK_SUBSCRIPTION(display_status, zmk_ble_active_profile_changed);
+#endif
+// Rendering holds the status mutex, which layer changes on the key path shouldn't wait for.
+ZMK_SUBSCRIPTION_DEFERRED(display_status, zmk_layer_state_changed);
+ZMK_SUBSCRIPTION(display_status, zmk_keymap_profile_changed);
+#endif
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+ZMK_SUBSCRIPTION(display_status, zmk_wpm_state_changed);
+#endif
+#if IS_ENABLED(CONFIG_ZMK_SPLIT)
+ZMK_SUBSCRIPTION(display_status, zmk_split_peripheral_status_changed);
+#endif
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+ZMK_SUBSCRIPTION(display_status, zmk_split_link_stats_changed);
+#endif
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY)
+ZMK_SUBSCRIPTION(display_status, zmk_peripheral_battery_state_changed);
+#endif
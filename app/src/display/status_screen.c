@@ -8,7 +8,9 @@
 #include <zmk/display/widgets/peripheral_status.h>
 #include <zmk/display/widgets/battery_status.h>
 #include <zmk/display/widgets/layer_status.h>
+#include <zmk/display/widgets/split_latency_status.h>
 #include <zmk/display/widgets/wpm_status.h>
+#include <zmk/display/widgets/wpm_graph.h>
 #include <zmk/display/status_screen.h>
 
 #include <logging/log.h>
@@ -30,10 +32,18 @@ static struct zmk_widget_peripheral_status peripheral_status_widget;
 static struct zmk_widget_layer_status layer_status_widget;
 #endif
 
+#if IS_ENABLED(CONFIG_ZMK_WIDGET_SPLIT_LATENCY_STATUS)
+static struct zmk_widget_split_latency_status split_latency_status_widget;
+#endif
+
 #if IS_ENABLED(CONFIG_ZMK_WIDGET_WPM_STATUS)
 static struct zmk_widget_wpm_status wpm_status_widget;
 #endif
 
+#if IS_ENABLED(CONFIG_ZMK_WIDGET_WPM_GRAPH)
+static struct zmk_widget_wpm_graph wpm_graph_widget;
+#endif
+
 lv_obj_t *zmk_display_status_screen() {
     lv_obj_t *screen;
 
@@ -66,10 +76,21 @@ lv_obj_t *zmk_display_status_screen() {
                  0, 0);
 #endif
 
+#if IS_ENABLED(CONFIG_ZMK_WIDGET_SPLIT_LATENCY_STATUS)
+    zmk_widget_split_latency_status_init(&split_latency_status_widget, screen);
+    lv_obj_align(zmk_widget_split_latency_status_obj(&split_latency_status_widget), NULL,
+                 LV_ALIGN_IN_LEFT_MID, 0, 0);
+#endif
+
 #if IS_ENABLED(CONFIG_ZMK_WIDGET_WPM_STATUS)
     zmk_widget_wpm_status_init(&wpm_status_widget, screen);
     lv_obj_align(zmk_widget_wpm_status_obj(&wpm_status_widget), NULL, LV_ALIGN_IN_BOTTOM_RIGHT, 0,
                  0);
 #endif
+
+#if IS_ENABLED(CONFIG_ZMK_WIDGET_WPM_GRAPH)
+    zmk_widget_wpm_graph_init(&wpm_graph_widget, screen);
+    lv_obj_align(zmk_widget_wpm_graph_obj(&wpm_graph_widget), NULL, LV_ALIGN_IN_RIGHT_MID, 0, 0);
+#endif
     return screen;
 }
@@ -5,34 +5,25 @@
  */
 
 #include <kernel.h>
-#include <bluetooth/services/bas.h>
 
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include <zmk/display/widgets/battery_status.h>
-#include <zmk/usb.h>
-#include <zmk/events/usb_conn_state_changed.h>
-#include <zmk/event_manager.h>
-#include <zmk/events/battery_state_changed.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct battery_status_state {
-    uint8_t level;
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-    bool usb_present;
-#endif
-};
+static void set_battery_symbol(struct zmk_widget_battery_status *widget,
+                               const struct zmk_display_status *status) {
+    char *text = widget->text;
 
-static void set_battery_symbol(lv_obj_t *label, struct battery_status_state state) {
-    char text[9] = {};
+    text[0] = '\0';
 
-    uint8_t level = state.level;
+    uint8_t level = status->battery_level;
 
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-    if (state.usb_present) {
+    if (status->usb_powered) {
         strcpy(text, LV_SYMBOL_CHARGE " ");
     }
 #endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
@@ -54,31 +45,21 @@ static void set_battery_symbol(lv_obj_t *label, struct battery_status_state stat
         strcat(text, LV_SYMBOL_BATTERY_EMPTY);
     }
 #endif
-    lv_label_set_text(label, text);
-    lv_obj_align(label, NULL, LV_ALIGN_IN_TOP_RIGHT, 0, 0);
+    lv_label_set_text_static(widget->obj, text);
+    lv_obj_align(widget->obj, NULL, LV_ALIGN_IN_TOP_RIGHT, 0, 0);
 }
 
-void battery_status_update_cb(struct battery_status_state state) {
+static void battery_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_battery_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_battery_symbol(widget->obj, state); }
-}
-
-static struct battery_status_state battery_status_get_state(const zmk_event_t *eh) {
-    return (struct battery_status_state) {
-        .level = bt_bas_get_battery_level(),
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-        .usb_present = zmk_usb_is_powered(),
-#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
-    };
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        set_battery_symbol(widget, status);
+    }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_battery_status, struct battery_status_state,
-                            battery_status_update_cb, battery_status_get_state)
-
-ZMK_SUBSCRIPTION(widget_battery_status, zmk_battery_state_changed);
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-ZMK_SUBSCRIPTION(widget_battery_status, zmk_usb_conn_state_changed);
-#endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
+static struct zmk_display_status_listener battery_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_BATTERY | ZMK_DISPLAY_STATUS_USB,
+    .update = battery_status_update_cb,
+};
 
 int zmk_widget_battery_status_init(struct zmk_widget_battery_status *widget, lv_obj_t *parent) {
     widget->obj = lv_label_create(parent, NULL);
@@ -87,7 +68,7 @@ int zmk_widget_battery_status_init(struct zmk_widget_battery_status *widget, lv_
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_battery_status_init();
+    zmk_display_status_subscribe(&battery_status_listener);
     return 0;
 }
 
@@ -8,50 +8,33 @@
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include <zmk/display/widgets/layer_status.h>
-#include <zmk/events/layer_state_changed.h>
-#include <zmk/event_manager.h>
-#include <zmk/endpoints.h>
-#include <zmk/keymap.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct layer_status_state {
-    uint8_t index;
-    const char *label;
-};
-
-static void set_layer_symbol(lv_obj_t *label, struct layer_status_state state) {
-    if (state.label == NULL) {
-        char text[7] = {};
-
-        sprintf(text, LV_SYMBOL_KEYBOARD " %i", state.index);
-
-        lv_label_set_text(label, text);
+static void set_layer_symbol(struct zmk_widget_layer_status *widget,
+                             const struct zmk_display_status *status) {
+    if (status->layer_label == NULL) {
+        snprintf(widget->text, sizeof(widget->text), LV_SYMBOL_KEYBOARD " %i",
+                 status->layer_index);
     } else {
-        char text[13] = {};
-
-        snprintf(text, sizeof(text), LV_SYMBOL_KEYBOARD " %s", state.label);
-
-        lv_label_set_text(label, text);
+        snprintf(widget->text, sizeof(widget->text), LV_SYMBOL_KEYBOARD " %s",
+                 status->layer_label);
     }
-}
 
-static void layer_status_update_cb(struct layer_status_state state) {
-    struct zmk_widget_layer_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_layer_symbol(widget->obj, state); }
+    lv_label_set_text_static(widget->obj, widget->text);
 }
 
-static struct layer_status_state layer_status_get_state(const zmk_event_t *eh) {
-    uint8_t index = zmk_keymap_highest_layer_active();
-    return (struct layer_status_state){.index = index, .label = zmk_keymap_layer_label(index)};
+static void layer_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
+    struct zmk_widget_layer_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_layer_symbol(widget, status); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layer_status, struct layer_status_state, layer_status_update_cb,
-                            layer_status_get_state)
-
-ZMK_SUBSCRIPTION(widget_layer_status, zmk_layer_state_changed);
+static struct zmk_display_status_listener layer_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_LAYER,
+    .update = layer_status_update_cb,
+};
 
 int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_t *parent) {
     widget->obj = lv_label_create(parent, NULL);
@@ -60,7 +43,7 @@ int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_layer_status_init();
+    zmk_display_status_subscribe(&layer_status_listener);
     return 0;
 }
 
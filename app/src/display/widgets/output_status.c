@@ -5,80 +5,54 @@
  */
 
 #include <kernel.h>
-#include <bluetooth/services/bas.h>
 
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include <zmk/display/widgets/output_status.h>
-#include <zmk/event_manager.h>
-#include <zmk/events/usb_conn_state_changed.h>
-#include <zmk/events/ble_active_profile_changed.h>
-#include <zmk/events/endpoint_selection_changed.h>
-#include <zmk/usb.h>
-#include <zmk/ble.h>
-#include <zmk/endpoints.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct output_status_state {
-    enum zmk_endpoint selected_endpoint;
-    bool active_profile_connected;
-    bool active_profile_bonded;
-    uint8_t active_profile_index;
-};
-
-static struct output_status_state get_state(const zmk_event_t *_eh) {
-    return (struct output_status_state){.selected_endpoint = zmk_endpoints_selected(),
-                                        .active_profile_connected =
-                                            zmk_ble_active_profile_is_connected(),
-                                        .active_profile_bonded = !zmk_ble_active_profile_is_open(),
-                                        .active_profile_index = zmk_ble_active_profile_index()};
-    ;
-}
+static void set_status_symbol(struct zmk_widget_output_status *widget,
+                              const struct zmk_display_status *status) {
+    char *text = widget->text;
+    const size_t len = sizeof(widget->text);
 
-static void set_status_symbol(lv_obj_t *label, struct output_status_state state) {
-    char text[10] = {};
+    text[0] = '\0';
 
-    switch (state.selected_endpoint) {
+    switch (status->selected_endpoint) {
     case ZMK_ENDPOINT_USB:
         strcat(text, LV_SYMBOL_USB);
         break;
     case ZMK_ENDPOINT_BLE:
-        if (state.active_profile_bonded) {
-            if (state.active_profile_connected) {
-                snprintf(text, sizeof(text), LV_SYMBOL_WIFI " %i " LV_SYMBOL_OK,
-                         state.active_profile_index + 1);
+        if (status->active_profile_bonded) {
+            if (status->active_profile_connected) {
+                snprintf(text, len, LV_SYMBOL_WIFI " %i " LV_SYMBOL_OK,
+                         status->active_profile_index + 1);
             } else {
-                snprintf(text, sizeof(text), LV_SYMBOL_WIFI " %i " LV_SYMBOL_CLOSE,
-                         state.active_profile_index + 1);
+                snprintf(text, len, LV_SYMBOL_WIFI " %i " LV_SYMBOL_CLOSE,
+                         status->active_profile_index + 1);
             }
         } else {
-            snprintf(text, sizeof(text), LV_SYMBOL_WIFI " %i " LV_SYMBOL_SETTINGS,
-                     state.active_profile_index + 1);
+            snprintf(text, len, LV_SYMBOL_WIFI " %i " LV_SYMBOL_SETTINGS,
+                     status->active_profile_index + 1);
         }
         break;
     }
 
-    lv_label_set_text(label, text);
+    lv_label_set_text_static(widget->obj, text);
 }
 
-static void output_status_update_cb(struct output_status_state state) {
+static void output_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_output_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget, status); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_output_status, struct output_status_state,
-                            output_status_update_cb, get_state)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_endpoint_selection_changed);
-
-#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_usb_conn_state_changed);
-#endif
-#if defined(CONFIG_ZMK_BLE)
-ZMK_SUBSCRIPTION(widget_output_status, zmk_ble_active_profile_changed);
-#endif
+static struct zmk_display_status_listener output_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_OUTPUT,
+    .update = output_status_update_cb,
+};
 
 int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_obj_t *parent) {
     widget->obj = lv_label_create(parent, NULL);
@@ -87,7 +61,7 @@ int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_ob
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_output_status_init();
+    zmk_display_status_subscribe(&output_status_listener);
     return 0;
 }
 
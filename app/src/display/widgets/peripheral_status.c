@@ -5,43 +5,33 @@
  */
 
 #include <kernel.h>
-#include <bluetooth/services/bas.h>
 
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include <zmk/display/widgets/peripheral_status.h>
-#include <zmk/event_manager.h>
-#include <zmk/split/bluetooth/peripheral.h>
-#include <zmk/events/split_peripheral_status_changed.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct peripheral_status_state {
-    bool connected;
-};
+static void set_status_symbol(lv_obj_t *label, const struct zmk_display_status *status) {
+    const char *text = status->peripheral_connected ? (LV_SYMBOL_WIFI " " LV_SYMBOL_OK)
+                                                    : (LV_SYMBOL_WIFI " " LV_SYMBOL_CLOSE);
 
-static struct peripheral_status_state get_state(const zmk_event_t *_eh) {
-    return (struct peripheral_status_state){.connected = zmk_split_bt_peripheral_is_connected()};
+    LOG_DBG("connected? %s", status->peripheral_connected ? "true" : "false");
+    lv_label_set_text_static(label, text);
 }
 
-static void set_status_symbol(lv_obj_t *label, struct peripheral_status_state state) {
-    const char *text =
-        state.connected ? (LV_SYMBOL_WIFI " " LV_SYMBOL_OK) : (LV_SYMBOL_WIFI " " LV_SYMBOL_CLOSE);
-
-    LOG_DBG("connected? %s", state.connected ? "true" : "false");
-    lv_label_set_text(label, text);
-}
-
-static void output_status_update_cb(struct peripheral_status_state state) {
+static void peripheral_status_update_cb(const struct zmk_display_status *status,
+                                        uint32_t changed) {
     struct zmk_widget_peripheral_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, status); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_peripheral_status, struct peripheral_status_state,
-                            output_status_update_cb, get_state)
-ZMK_SUBSCRIPTION(widget_peripheral_status, zmk_split_peripheral_status_changed);
+static struct zmk_display_status_listener peripheral_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_PERIPHERAL,
+    .update = peripheral_status_update_cb,
+};
 
 int zmk_widget_peripheral_status_init(struct zmk_widget_peripheral_status *widget,
                                       lv_obj_t *parent) {
@@ -51,7 +41,7 @@ int zmk_widget_peripheral_status_init(struct zmk_widget_peripheral_status *widge
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_peripheral_status_init();
+    zmk_display_status_subscribe(&peripheral_status_listener);
     return 0;
 }
 
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display/status.h>
+#include <zmk/display/widgets/split_latency_status.h>
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+static void set_latency_text(struct zmk_widget_split_latency_status *widget,
+                             const struct zmk_display_status *status) {
+    widget->text[0] = '\0';
+
+    // Before the first measurement there is nothing to show.
+    if (status->split_rtt_us > 0) {
+        snprintf(widget->text, sizeof(widget->text), "%ums", status->split_rtt_us / 1000);
+    }
+
+    lv_label_set_text_static(widget->obj, widget->text);
+}
+
+static void split_latency_status_update_cb(const struct zmk_display_status *status,
+                                           uint32_t changed) {
+    struct zmk_widget_split_latency_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_latency_text(widget, status); }
+}
+
+static struct zmk_display_status_listener split_latency_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_SPLIT_LATENCY,
+    .update = split_latency_status_update_cb,
+};
+
+int zmk_widget_split_latency_status_init(struct zmk_widget_split_latency_status *widget,
+                                         lv_obj_t *parent) {
+    widget->obj = lv_label_create(parent, NULL);
+
+    lv_obj_set_size(widget->obj, 40, 15);
+
+    sys_slist_append(&widgets, &widget->node);
+
+    zmk_display_status_subscribe(&split_latency_status_listener);
+    return 0;
+}
+
+lv_obj_t *zmk_widget_split_latency_status_obj(struct zmk_widget_split_latency_status *widget) {
+    return widget->obj;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+#include <zmk/display/status.h>
+#include <zmk/display/widgets/wpm_graph.h>
+#include <zmk/work_watchdog.h>
+
+#define GRAPH_WIDTH CONFIG_ZMK_WIDGET_WPM_GRAPH_WIDTH
+#define GRAPH_HEIGHT CONFIG_ZMK_WIDGET_WPM_GRAPH_HEIGHT
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+static struct zmk_widget_wpm_graph *find_widget(const lv_obj_t *obj) {
+    struct zmk_widget_wpm_graph *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        if (widget->obj == obj) {
+            return widget;
+        }
+    }
+
+    return NULL;
+}
+
+static lv_coord_t bar_height(uint8_t wpm) {
+    return MIN(wpm, CONFIG_ZMK_WIDGET_WPM_GRAPH_MAX_WPM) * GRAPH_HEIGHT /
+           CONFIG_ZMK_WIDGET_WPM_GRAPH_MAX_WPM;
+}
+
+// Draws the bars of the columns in the clip area only. The parent draws the background, so
+// invalidating a column also clears the bar that was in it.
+static lv_design_res_t wpm_graph_design(lv_obj_t *obj, const lv_area_t *clip_area,
+                                        lv_design_mode_t mode) {
+    if (mode == LV_DESIGN_COVER_CHK) {
+        return LV_DESIGN_RES_NOT_COVER;
+    }
+
+    struct zmk_widget_wpm_graph *widget = find_widget(obj);
+    if (mode != LV_DESIGN_DRAW_MAIN || widget == NULL) {
+        return LV_DESIGN_RES_OK;
+    }
+
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.bg_color = lv_obj_get_style_text_color(obj, LV_OBJ_PART_MAIN);
+    dsc.bg_opa = LV_OPA_COVER;
+
+    lv_coord_t first = MAX(clip_area->x1 - obj->coords.x1, 0);
+    lv_coord_t last = MIN(clip_area->x2 - obj->coords.x1, GRAPH_WIDTH - 1);
+
+    for (lv_coord_t col = first; col <= last; col++) {
+        lv_coord_t height = col == widget->next ? 0 : bar_height(widget->samples[col]);
+        if (height == 0) {
+            continue;
+        }
+
+        lv_area_t bar = {
+            .x1 = obj->coords.x1 + col,
+            .x2 = obj->coords.x1 + col,
+            .y1 = obj->coords.y2 - height + 1,
+            .y2 = obj->coords.y2,
+        };
+        lv_draw_rect(&bar, clip_area, &dsc);
+    }
+
+    return LV_DESIGN_RES_OK;
+}
+
+static void invalidate_column(struct zmk_widget_wpm_graph *widget, uint16_t col) {
+    lv_area_t area = {
+        .x1 = widget->obj->coords.x1 + col,
+        .x2 = widget->obj->coords.x1 + col,
+        .y1 = widget->obj->coords.y1,
+        .y2 = widget->obj->coords.y2,
+    };
+
+    lv_obj_invalidate_area(widget->obj, &area);
+}
+
+// Runs in the display queue context, like the status updates.
+static void sample_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct zmk_widget_wpm_graph *widget =
+        CONTAINER_OF(dwork, struct zmk_widget_wpm_graph, sample_work);
+    uint16_t col = widget->next;
+
+    widget->samples[col] = widget->wpm;
+    widget->next = (col + 1) % GRAPH_WIDTH;
+    widget->zero_samples = widget->wpm == 0 ? widget->zero_samples + 1 : 0;
+
+    // Only the new sample and the gap after it change, no matter how wide the graph is.
+    invalidate_column(widget, col);
+    invalidate_column(widget, widget->next);
+    zmk_display_request_refresh();
+
+    if (widget->zero_samples < GRAPH_WIDTH) {
+        k_work_schedule_for_queue(zmk_display_work_q(), &widget->sample_work,
+                                  K_MSEC(CONFIG_ZMK_WIDGET_WPM_GRAPH_SAMPLE_INTERVAL_MS));
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(sample_work_cb)
+
+static void wpm_graph_update_cb(const struct zmk_display_status *status, uint32_t changed) {
+    struct zmk_widget_wpm_graph *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        widget->wpm = status->wpm;
+
+        // Sampling stops while the whole graph is at 0, and picks up again with the next change.
+        if (widget->wpm > 0 && !k_work_delayable_is_pending(&widget->sample_work)) {
+            widget->zero_samples = 0;
+            k_work_schedule_for_queue(zmk_display_work_q(), &widget->sample_work, K_NO_WAIT);
+        }
+    }
+}
+
+static struct zmk_display_status_listener wpm_graph_listener = {
+    .fields = ZMK_DISPLAY_STATUS_WPM,
+    .update = wpm_graph_update_cb,
+};
+
+int zmk_widget_wpm_graph_init(struct zmk_widget_wpm_graph *widget, lv_obj_t *parent) {
+    widget->obj = lv_obj_create(parent, NULL);
+    lv_obj_set_size(widget->obj, GRAPH_WIDTH, GRAPH_HEIGHT);
+    lv_obj_set_design_cb(widget->obj, wpm_graph_design);
+
+    k_work_init_delayable(&widget->sample_work, ZMK_WORK_WATCHED(sample_work_cb));
+
+    sys_slist_append(&widgets, &widget->node);
+
+    zmk_display_status_subscribe(&wpm_graph_listener);
+    return 0;
+}
+
+lv_obj_t *zmk_widget_wpm_graph_obj(struct zmk_widget_wpm_graph *widget) { return widget->obj; }
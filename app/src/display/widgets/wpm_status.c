@@ -7,41 +7,29 @@
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-#include <zmk/display.h>
+#include <zmk/display/status.h>
 #include <zmk/display/widgets/wpm_status.h>
-#include <zmk/events/wpm_state_changed.h>
-#include <zmk/event_manager.h>
-#include <zmk/endpoints.h>
-#include <zmk/wpm.h>
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
-struct wpm_status_state {
-    uint8_t wpm;
-};
-
-struct wpm_status_state wpm_status_get_state(const zmk_event_t *eh) {
-    return (struct wpm_status_state){.wpm = zmk_wpm_get_state()};
-};
+static void set_wpm_symbol(struct zmk_widget_wpm_status *widget,
+                           const struct zmk_display_status *status) {
+    LOG_DBG("WPM changed to %i", status->wpm);
+    snprintf(widget->text, sizeof(widget->text), "%i", status->wpm);
 
-void set_wpm_symbol(lv_obj_t *label, struct wpm_status_state state) {
-    char text[4] = {};
-
-    LOG_DBG("WPM changed to %i", state.wpm);
-    snprintf(text, sizeof(text), "%i", state.wpm);
-
-    lv_label_set_text(label, text);
-    lv_obj_align(label, NULL, LV_ALIGN_IN_BOTTOM_RIGHT, 0, 0);
+    lv_label_set_text_static(widget->obj, widget->text);
+    lv_obj_align(widget->obj, NULL, LV_ALIGN_IN_BOTTOM_RIGHT, 0, 0);
 }
 
-void wpm_status_update_cb(struct wpm_status_state state) {
+static void wpm_status_update_cb(const struct zmk_display_status *status, uint32_t changed) {
     struct zmk_widget_wpm_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_wpm_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_wpm_symbol(widget, status); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_wpm_status, struct wpm_status_state, wpm_status_update_cb,
-                            wpm_status_get_state)
-ZMK_SUBSCRIPTION(widget_wpm_status, zmk_wpm_state_changed);
+static struct zmk_display_status_listener wpm_status_listener = {
+    .fields = ZMK_DISPLAY_STATUS_WPM,
+    .update = wpm_status_update_cb,
+};
 
 int zmk_widget_wpm_status_init(struct zmk_widget_wpm_status *widget, lv_obj_t *parent) {
     widget->obj = lv_label_create(parent, NULL);
@@ -51,7 +39,7 @@ int zmk_widget_wpm_status_init(struct zmk_widget_wpm_status *widget, lv_obj_t *p
 
     sys_slist_append(&widgets, &widget->node);
 
-    widget_wpm_status_init();
+    zmk_display_status_subscribe(&wpm_status_listener);
     return 0;
 }
 
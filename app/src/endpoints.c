@@ -5,14 +5,21 @@
  */
 
 #include <init.h>
+#include <string.h>
 #include <settings/settings.h>
 
 #include <zmk/ble.h>
+#include <zmk/behavior_queue.h>
+#include <zmk/boot_profile.h>
 #include <zmk/endpoints.h>
+#include <zmk/flight_recorder.h>
 #include <zmk/hid.h>
+#include <zmk/latency_benchmark.h>
 #include <dt-bindings/zmk/hid_usage_pages.h>
 #include <zmk/usb_hid.h>
 #include <zmk/hog.h>
+#include <zmk/settings.h>
+#include <zmk/trace_pins.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/ble_active_profile_changed.h>
 #include <zmk/events/usb_conn_state_changed.h>
@@ -29,18 +36,20 @@ static enum zmk_endpoint preferred_endpoint =
     ZMK_ENDPOINT_USB; /* Used if multiple endpoints are ready */
 
 static void update_current_endpoint();
+static bool is_usb_ready();
+static bool is_ble_ready();
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-static void endpoints_save_preferred_work(struct k_work *work) {
+static void endpoints_save_preferred_work() {
     settings_save_one("endpoints/preferred", &preferred_endpoint, sizeof(preferred_endpoint));
 }
 
-static struct k_work_delayable endpoints_save_work;
+ZMK_SETTINGS_SAVE_DEFINE(endpoints_save, endpoints_save_preferred_work);
 #endif
 
 static int endpoints_save_preferred() {
 #if IS_ENABLED(CONFIG_SETTINGS)
-    return k_work_reschedule(&endpoints_save_work, K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
+    return zmk_settings_save(&endpoints_save);
 #else
     return 0;
 #endif
@@ -70,13 +79,37 @@ int zmk_endpoints_toggle() {
     return zmk_endpoints_select(new_endpoint);
 }
 
-static int send_keyboard_report() {
-    struct zmk_hid_keyboard_report *keyboard_report = zmk_hid_get_keyboard_report();
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+// The last reports each endpoint accepted. An endpoint's reports are forgotten whenever a
+// connection changes, so a (re)connected host always gets the current state.
+struct sent_reports {
+    bool keyboard_valid;
+    bool consumer_valid;
+    struct zmk_hid_keyboard_report_body keyboard;
+    struct zmk_hid_consumer_report_body consumer;
+};
+
+static struct sent_reports sent_reports[ZMK_ENDPOINT_BLE + 1];
+static uint32_t suppressed_reports;
+
+uint32_t zmk_endpoints_suppressed_reports() { return suppressed_reports; }
+
+static void forget_sent_reports() {
+    for (int i = 0; i < ARRAY_SIZE(sent_reports); i++) {
+        sent_reports[i].keyboard_valid = false;
+        sent_reports[i].consumer_valid = false;
+    }
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS) */
 
-    switch (current_endpoint) {
+static int write_keyboard_report(enum zmk_endpoint endpoint,
+                                 struct zmk_hid_keyboard_report *keyboard_report) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_REPORT);
+
+    switch (endpoint) {
 #if IS_ENABLED(CONFIG_ZMK_USB)
     case ZMK_ENDPOINT_USB: {
-        int err = zmk_usb_hid_send_report((uint8_t *)keyboard_report, sizeof(*keyboard_report));
+        int err = zmk_usb_hid_send_keyboard_report(keyboard_report);
         if (err) {
             LOG_ERR("FAILED TO SEND OVER USB: %d", err);
         }
@@ -95,15 +128,16 @@ static int send_keyboard_report() {
 #endif /* IS_ENABLED(CONFIG_ZMK_BLE) */
 
     default:
-        LOG_ERR("Unsupported endpoint %d", current_endpoint);
+        LOG_ERR("Unsupported endpoint %d", endpoint);
         return -ENOTSUP;
     }
 }
 
-static int send_consumer_report() {
-    struct zmk_hid_consumer_report *consumer_report = zmk_hid_get_consumer_report();
+static int write_consumer_report(enum zmk_endpoint endpoint,
+                                 struct zmk_hid_consumer_report *consumer_report) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_REPORT);
 
-    switch (current_endpoint) {
+    switch (endpoint) {
 #if IS_ENABLED(CONFIG_ZMK_USB)
     case ZMK_ENDPOINT_USB: {
         int err = zmk_usb_hid_send_report((uint8_t *)consumer_report, sizeof(*consumer_report));
@@ -124,20 +158,257 @@ static int send_consumer_report() {
     }
 #endif /* IS_ENABLED(CONFIG_ZMK_BLE) */
 
+    default:
+        LOG_ERR("Unsupported endpoint %d", endpoint);
+        return -ENOTSUP;
+    }
+}
+
+static int send_keyboard_report_to(enum zmk_endpoint endpoint) {
+    struct zmk_hid_keyboard_report *keyboard_report = zmk_hid_get_keyboard_report();
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+    struct sent_reports *sent = &sent_reports[endpoint];
+    if (sent->keyboard_valid &&
+        memcmp(&sent->keyboard, &keyboard_report->body, sizeof(sent->keyboard)) == 0) {
+        suppressed_reports++;
+        return 0;
+    }
+#endif
+
+    int err = write_keyboard_report(endpoint, keyboard_report);
+    zmk_flight_record(ZMK_FLIGHT_HID_KEYBOARD, -err, endpoint);
+    if (err == 0) {
+        zmk_boot_profile_report_sent();
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+    sent->keyboard_valid = err == 0;
+    sent->keyboard = keyboard_report->body;
+#endif
+
+    return err;
+}
+
+static int send_consumer_report_to(enum zmk_endpoint endpoint) {
+    struct zmk_hid_consumer_report *consumer_report = zmk_hid_get_consumer_report();
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+    struct sent_reports *sent = &sent_reports[endpoint];
+    if (sent->consumer_valid &&
+        memcmp(&sent->consumer, &consumer_report->body, sizeof(sent->consumer)) == 0) {
+        suppressed_reports++;
+        return 0;
+    }
+#endif
+
+    int err = write_consumer_report(endpoint, consumer_report);
+    zmk_flight_record(ZMK_FLIGHT_HID_CONSUMER, -err, endpoint);
+    if (err == 0) {
+        zmk_boot_profile_report_sent();
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+    sent->consumer_valid = err == 0;
+    sent->consumer = consumer_report->body;
+#endif
+
+    return err;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR)
+// Sends to every ready endpoint. Neither waits on the other: USB reports are queued for the next
+// poll and BLE reports for the HOG work queue.
+static int send_mirrored(int (*send_to)(enum zmk_endpoint)) {
+    int ret = 0;
+    bool sent = false;
+
+    if (is_usb_ready()) {
+        ret = send_to(ZMK_ENDPOINT_USB);
+        sent = true;
+    }
+
+    if (is_ble_ready()) {
+        int err = send_to(ZMK_ENDPOINT_BLE);
+        if (err) {
+            ret = err;
+        }
+        sent = true;
+    }
+
+    // With no host connected, the selected endpoint reports the error as usual.
+    return sent ? ret : send_to(current_endpoint);
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR) */
+
+static int send_keyboard_report() {
+    zmk_latency_benchmark_report(HID_USAGE_KEY);
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR)
+    return send_mirrored(send_keyboard_report_to);
+#else
+    return send_keyboard_report_to(current_endpoint);
+#endif
+}
+
+static int send_consumer_report() {
+    zmk_latency_benchmark_report(HID_USAGE_CONSUMER);
+
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR)
+    return send_mirrored(send_consumer_report_to);
+#else
+    return send_consumer_report_to(current_endpoint);
+#endif
+}
+
+static int send_reports(uint8_t reports) {
+    int ret = 0;
+
+    if (reports & ZMK_ENDPOINTS_REPORT_KEYBOARD) {
+        ret = send_keyboard_report();
+    }
+
+    if (reports & ZMK_ENDPOINTS_REPORT_CONSUMER) {
+        int err = send_consumer_report();
+        if (err) {
+            ret = err;
+        }
+    }
+
+    return ret;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+static uint8_t batch_depth;
+static uint8_t batch_pending;
+static uint32_t batch_usages[ZMK_ENDPOINTS_BATCH_MAX_USAGES];
+static uint8_t batch_usages_len;
+
+void zmk_endpoints_batch_begin() { batch_depth++; }
+
+int zmk_endpoints_batch_flush() {
+    uint8_t pending = batch_pending;
+
+    batch_pending = 0;
+    batch_usages_len = 0;
+
+    return send_reports(pending);
+}
+
+int zmk_endpoints_batch_end() {
+    if (batch_depth == 0) {
+        LOG_ERR("Unbalanced end of report batch");
+        return -EINVAL;
+    }
+
+    if (--batch_depth > 0) {
+        return 0;
+    }
+
+    return zmk_endpoints_batch_flush();
+}
+
+void zmk_endpoints_batch_prepare_change(uint32_t usage, bool implicit_mods) {
+    if (batch_depth == 0) {
+        return;
+    }
+
+    bool flush = implicit_mods || batch_usages_len == ZMK_ENDPOINTS_BATCH_MAX_USAGES;
+    for (int i = 0; i < batch_usages_len && !flush; i++) {
+        flush = batch_usages[i] == usage;
+    }
+
+    if (flush) {
+        LOG_DBG("Flushing report batch before change of usage 0x%08X", usage);
+        zmk_endpoints_batch_flush();
+    }
+
+    batch_usages[batch_usages_len++] = usage;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING) */
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+static bool endpoint_reports_pending(enum zmk_endpoint endpoint) {
+    switch (endpoint) {
+#if IS_ENABLED(CONFIG_ZMK_USB)
+    case ZMK_ENDPOINT_USB:
+        return zmk_usb_hid_reports_pending();
+#endif /* IS_ENABLED(CONFIG_ZMK_USB) */
+
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    case ZMK_ENDPOINT_BLE:
+        return zmk_hog_reports_pending();
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE) */
+
+    default:
+        return false;
+    }
+}
+
+bool zmk_endpoints_reports_pending() {
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR)
+    return endpoint_reports_pending(ZMK_ENDPOINT_USB) || endpoint_reports_pending(ZMK_ENDPOINT_BLE);
+#else
+    return endpoint_reports_pending(current_endpoint);
+#endif
+}
+
+void zmk_endpoints_reports_delivered() { zmk_behavior_queue_reports_delivered(); }
+#endif /* IS_ENABLED(CONFIG_ZMK_MACRO_PACING) */
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+// Mouse reports bypass batching and deduplication. The endpoints build them from the accumulated
+// motion once they can send, which already combines the changes of a batch.
+int zmk_endpoints_send_mouse_report() {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_REPORT);
+
+    switch (current_endpoint) {
+#if IS_ENABLED(CONFIG_ZMK_USB)
+    case ZMK_ENDPOINT_USB: {
+        int err = zmk_usb_hid_send_mouse_report();
+        if (err) {
+            LOG_ERR("FAILED TO SEND OVER USB: %d", err);
+        }
+        return err;
+    }
+#endif /* IS_ENABLED(CONFIG_ZMK_USB) */
+
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    case ZMK_ENDPOINT_BLE: {
+        int err = zmk_hog_send_mouse_report();
+        if (err) {
+            LOG_ERR("FAILED TO SEND OVER HOG: %d", err);
+        }
+        return err;
+    }
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE) */
+
     default:
         LOG_ERR("Unsupported endpoint %d", current_endpoint);
         return -ENOTSUP;
     }
 }
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
+
+int zmk_endpoints_send_reports(uint8_t reports) {
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+    if (batch_depth > 0) {
+        batch_pending |= reports;
+        return 0;
+    }
+#endif
+
+    return send_reports(reports);
+}
 
 int zmk_endpoints_send_report(uint16_t usage_page) {
 
     LOG_DBG("usage page 0x%02X", usage_page);
     switch (usage_page) {
     case HID_USAGE_KEY:
-        return send_keyboard_report();
+        return zmk_endpoints_send_reports(ZMK_ENDPOINTS_REPORT_KEYBOARD);
     case HID_USAGE_CONSUMER:
-        return send_consumer_report();
+        return zmk_endpoints_send_reports(ZMK_ENDPOINTS_REPORT_CONSUMER);
     default:
         LOG_ERR("Unsupported usage page %d", usage_page);
         return -ENOTSUP;
@@ -168,27 +439,9 @@ static int endpoints_handle_set(const char *name, size_t len, settings_read_cb r
     return 0;
 }
 
-struct settings_handler endpoints_handler = {.name = "endpoints", .h_set = endpoints_handle_set};
+SETTINGS_STATIC_HANDLER_DEFINE(endpoints, "endpoints", NULL, endpoints_handle_set, NULL, NULL);
 #endif /* IS_ENABLED(CONFIG_SETTINGS) */
 
-static int zmk_endpoints_init(const struct device *_arg) {
-#if IS_ENABLED(CONFIG_SETTINGS)
-    settings_subsys_init();
-
-    int err = settings_register(&endpoints_handler);
-    if (err) {
-        LOG_ERR("Failed to register the endpoints settings handler (err %d)", err);
-        return err;
-    }
-
-    k_work_init_delayable(&endpoints_save_work, endpoints_save_preferred_work);
-
-    settings_load_subtree("endpoints");
-#endif
-
-    return 0;
-}
-
 static bool is_usb_ready() {
 #if IS_ENABLED(CONFIG_ZMK_USB)
     return zmk_usb_is_hid_ready();
@@ -228,27 +481,46 @@ static enum zmk_endpoint get_selected_endpoint() {
 static void disconnect_current_endpoint() {
     zmk_hid_keyboard_clear();
     zmk_hid_consumer_clear();
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    zmk_hid_mouse_clear();
+#endif
 
-    zmk_endpoints_send_report(HID_USAGE_KEY);
-    zmk_endpoints_send_report(HID_USAGE_CONSUMER);
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+    /* The cleared reports must reach the old endpoint, not wait for the end of the batch. */
+    batch_pending = 0;
+    batch_usages_len = 0;
+#endif
+
+    send_keyboard_report();
+    send_consumer_report();
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    zmk_endpoints_send_mouse_report();
+#endif
 }
 
 static void update_current_endpoint() {
     enum zmk_endpoint new_endpoint = get_selected_endpoint();
 
     if (new_endpoint != current_endpoint) {
-        /* Cancel all current keypresses so keys don't stay held on the old endpoint. */
-        disconnect_current_endpoint();
+        /* Cancel all current keypresses so keys don't stay held on the old endpoint. Mirrored
+         * output keeps every ready endpoint up to date, so nothing is left held anywhere. */
+        if (!IS_ENABLED(CONFIG_ZMK_ENDPOINTS_MIRROR)) {
+            disconnect_current_endpoint();
+        }
 
         current_endpoint = new_endpoint;
         LOG_INF("Endpoint changed: %d", current_endpoint);
 
-        ZMK_EVENT_RAISE(new_zmk_endpoint_selection_changed(
-            (struct zmk_endpoint_selection_changed){.endpoint = current_endpoint}));
+        raise_zmk_endpoint_selection_changed(
+            (struct zmk_endpoint_selection_changed){.endpoint = current_endpoint});
     }
 }
 
 static int endpoint_listener(const zmk_event_t *eh) {
+#if IS_ENABLED(CONFIG_ZMK_ENDPOINTS_DEDUPLICATE_REPORTS)
+    forget_sent_reports();
+#endif
+
     update_current_endpoint();
     return 0;
 }
@@ -260,5 +532,3 @@ ZMK_SUBSCRIPTION(endpoint_listener, zmk_usb_conn_state_changed);
 #if IS_ENABLED(CONFIG_ZMK_BLE)
 ZMK_SUBSCRIPTION(endpoint_listener, zmk_ble_active_profile_changed);
 #endif
-
-SYS_INIT(zmk_endpoints_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
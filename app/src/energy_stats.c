@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <init.h>
+#include <kernel.h>
+#include <stdarg.h>
+#include <sys/atomic.h>
+#include <sys/printk.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/energy_stats.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY)
+#include <zmk/display.h>
+#endif
+
+static const char *const counter_names[] = {
+    [ZMK_ENERGY_KSCAN_SCAN] = "kscan scans",
+    [ZMK_ENERGY_HID_NOTIFY] = "HID notifications",
+    [ZMK_ENERGY_SPLIT_NOTIFY] = "split notifications",
+    [ZMK_ENERGY_LED_STRIP_UPDATE] = "LED strip updates",
+    [ZMK_ENERGY_DISPLAY_REFRESH] = "display refreshes",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(counter_names) == ZMK_ENERGY_COUNTER_COUNT,
+             "Every energy counter needs a name");
+
+static atomic_t counters[ZMK_ENERGY_COUNTER_COUNT];
+
+struct work_q_usage {
+    const char *name;
+    struct k_work_q *(*get_queue)();
+    /** Execution cycles of the queue's thread at the last reset. */
+    uint64_t start_cycles;
+};
+
+static struct k_work_q *sys_work_q() { return &k_sys_work_q; }
+
+// Queues that aren't dedicated are the system work queue, so they are only listed once.
+static struct work_q_usage work_queues[] = {
+    {.name = "system", .get_queue = sys_work_q},
+#if IS_ENABLED(CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED)
+    {.name = "input", .get_queue = zmk_input_work_q},
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY_WORK_QUEUE_DEDICATED)
+    {.name = "display", .get_queue = zmk_display_work_q},
+#endif
+};
+
+static int64_t stats_start;
+
+void zmk_energy_stats_count(enum zmk_energy_counter counter) { atomic_inc(&counters[counter]); }
+
+static uint64_t work_q_cycles(struct work_q_usage *usage) {
+    k_thread_runtime_stats_t stats;
+
+    if (k_thread_runtime_stats_get(&usage->get_queue()->thread, &stats) != 0) {
+        return 0;
+    }
+
+    return stats.execution_cycles;
+}
+
+void zmk_energy_stats_reset() {
+    for (int i = 0; i < ZMK_ENERGY_COUNTER_COUNT; i++) {
+        atomic_clear(&counters[i]);
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(work_queues); i++) {
+        work_queues[i].start_cycles = work_q_cycles(&work_queues[i]);
+    }
+
+    stats_start = k_uptime_get();
+}
+
+typedef void (*print_fn)(void *ctx, const char *fmt, ...);
+
+static void print_summary(print_fn print, void *ctx) {
+    uint32_t elapsed_ms = MAX(k_uptime_get() - stats_start, 1);
+
+    print(ctx, "Energy stats over the last %u ms:", elapsed_ms);
+
+    for (int i = 0; i < ZMK_ENERGY_COUNTER_COUNT; i++) {
+        print(ctx, "  %-20s %10u", counter_names[i], (uint32_t)atomic_get(&counters[i]));
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(work_queues); i++) {
+        uint32_t active_us =
+            k_cyc_to_us_floor64(work_q_cycles(&work_queues[i]) - work_queues[i].start_cycles);
+
+        // Per mille, since a well behaved queue is active for well under one percent.
+        print(ctx, "  %-8s work queue %10u us active (%u per mille)", work_queues[i].name,
+              active_us, (uint32_t)((uint64_t)active_us / elapsed_ms));
+    }
+}
+
+#if CONFIG_ZMK_ENERGY_STATS_LOG_INTERVAL > 0
+
+static void log_line(void *ctx, const char *fmt, ...) {
+    char line[80];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintk(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    LOG_INF("%s", log_strdup(line));
+}
+
+static void energy_stats_log_handler(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(energy_stats_log_handler)
+static K_WORK_DELAYABLE_DEFINE(energy_stats_log_work, ZMK_WORK_WATCHED(energy_stats_log_handler));
+
+// Each summary covers the interval since the previous one.
+static void energy_stats_log_handler(struct k_work *work) {
+    print_summary(log_line, NULL);
+    zmk_energy_stats_reset();
+
+    k_work_schedule(&energy_stats_log_work, K_SECONDS(CONFIG_ZMK_ENERGY_STATS_LOG_INTERVAL));
+}
+
+#endif /* CONFIG_ZMK_ENERGY_STATS_LOG_INTERVAL > 0 */
+
+static int zmk_energy_stats_init(const struct device *_arg) {
+    zmk_energy_stats_reset();
+
+#if CONFIG_ZMK_ENERGY_STATS_LOG_INTERVAL > 0
+    k_work_schedule(&energy_stats_log_work, K_SECONDS(CONFIG_ZMK_ENERGY_STATS_LOG_INTERVAL));
+#endif
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_energy_stats_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+static void shell_line(void *ctx, const char *fmt, ...) {
+    const struct shell *sh = ctx;
+    va_list args;
+
+    va_start(args, fmt);
+    shell_vfprintf(sh, SHELL_NORMAL, fmt, args);
+    va_end(args);
+
+    shell_fprintf(sh, SHELL_NORMAL, "\n");
+}
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv) {
+    print_summary(shell_line, (void *)sh);
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    zmk_energy_stats_reset();
+    shell_print(sh, "Energy stats reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_energy,
+                               SHELL_CMD(stats, NULL, "Show energy stats since the last reset",
+                                         cmd_stats),
+                               SHELL_CMD(reset, NULL, "Reset energy stats", cmd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(energy, &sub_energy, "ZMK energy accounting commands", NULL);
+
+#endif /* IS_ENABLED(CONFIG_SHELL) */
@@ -5,11 +5,18 @@
  */
 
 #include <zephyr.h>
+#include <string.h>
 #include <logging/log.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zmk/event_manager.h>
+#include <zmk/latency_benchmark.h>
+#include <zmk/micro_benchmark.h>
+#include <zmk/memory_stats.h>
+#include <zmk/pipeline_stats.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
 
 extern struct zmk_event_type *__event_type_start[];
 extern struct zmk_event_type *__event_type_end[];
@@ -17,16 +24,196 @@ extern struct zmk_event_type *__event_type_end[];
 extern struct zmk_event_subscription __event_subscriptions_start[];
 extern struct zmk_event_subscription __event_subscriptions_end[];
 
-int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
+// The subscriptions for an event type are contiguous, and are terminated either by the
+// marker of the next event type or by the end of the section.
+static inline bool is_subscription_for(const struct zmk_event_subscription *ev_sub,
+                                       const struct zmk_event_type *event_type) {
+    return ev_sub < __event_subscriptions_end && ev_sub->event_type == event_type;
+}
+
+zmk_event_t *zmk_event_manager_alloc(const struct zmk_event_type *event_type, size_t size) {
+    zmk_event_t *event = NULL;
+    uint8_t flags = 0;
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+    struct zmk_event_pool *pool = event_type->pool;
+    if (k_mem_slab_alloc(pool->slab, (void **)&event, K_NO_WAIT) == 0) {
+        uint32_t used = k_mem_slab_num_used_get(pool->slab);
+        if (used > pool->high_water_mark) {
+            pool->high_water_mark = used;
+        }
+        flags |= ZMK_EVENT_FLAG_POOLED;
+    } else {
+        pool->heap_fallbacks++;
+        LOG_DBG("Pool for %s exhausted, allocating from the heap", log_strdup(event_type->name));
+    }
+#endif
+
+    if (event == NULL) {
+        event = k_malloc(size);
+        if (event == NULL) {
+            LOG_ERR("Failed to allocate %s event", log_strdup(event_type->name));
+            zmk_pipeline_stats_event_alloc_failed();
+            return NULL;
+        }
+
+        zmk_memory_stats_heap_allocated(size);
+    }
+
+    zmk_latency_benchmark_alloc(!(flags & ZMK_EVENT_FLAG_POOLED));
+    zmk_micro_benchmark_alloc();
+    zmk_pipeline_stats_event_allocated(!(flags & ZMK_EVENT_FLAG_POOLED));
+
+    event->event = event_type;
+    event->last_listener_index = 0;
+    event->flags = flags;
+    return event;
+}
+
+void zmk_event_manager_free(zmk_event_t *event) {
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+    if (event->flags & ZMK_EVENT_FLAG_POOLED) {
+        k_mem_slab_free(event->event->pool->slab, (void **)&event);
+        return;
+    }
+#endif
+
+    zmk_pipeline_stats_event_freed(true);
+#if IS_ENABLED(CONFIG_ZMK_MEMORY_STATS)
+    zmk_memory_stats_heap_freed(event->event->size);
+#endif
+    k_free(event);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+void zmk_event_manager_log_pool_stats() {
+    for (struct zmk_event_type **type = __event_type_start; type < __event_type_end; type++) {
+        struct zmk_event_pool *pool = (*type)->pool;
+        LOG_INF("%s: %d/%d pool blocks in use, high water mark %d, heap fallbacks %d",
+                log_strdup((*type)->name), k_mem_slab_num_used_get(pool->slab),
+                CONFIG_ZMK_EVENT_MANAGER_POOL_SIZE, pool->high_water_mark, pool->heap_fallbacks);
+    }
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS)
+// Durations include the time spent in any events raised from within the listener.
+static int call_listener(const struct zmk_event_subscription *ev_sub, zmk_event_t *event) {
+    uint32_t start = k_cycle_get_32();
+    int ret = ev_sub->listener->callback(event);
+    uint32_t cycles = k_cycle_get_32() - start;
+
+    struct zmk_listener_stats *stats = ev_sub->stats;
+    stats->calls++;
+    stats->total_cycles += cycles;
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    if (ret == ZMK_EV_EVENT_CAPTURED) {
+        stats->captures++;
+    }
+
+    return ret;
+}
+
+static inline bool is_marker(const struct zmk_event_subscription *ev_sub) {
+    return ev_sub->listener == NULL;
+}
+
+static uint32_t average_us(const struct zmk_listener_stats *stats) {
+    if (stats->calls == 0) {
+        return 0;
+    }
+    return (uint32_t)k_cyc_to_us_floor64(stats->total_cycles / stats->calls);
+}
+
+void zmk_event_manager_log_listener_stats() {
+    for (struct zmk_event_subscription *ev_sub = __event_subscriptions_start;
+         ev_sub < __event_subscriptions_end; ev_sub++) {
+        if (is_marker(ev_sub)) {
+            continue;
+        }
+        struct zmk_listener_stats *stats = ev_sub->stats;
+        LOG_INF("%s/%s: %d calls, %d captures, avg %dus, max %dus",
+                log_strdup(ev_sub->listener->name), log_strdup(ev_sub->event_type->name),
+                stats->calls, stats->captures, average_us(stats),
+                k_cyc_to_us_floor32(stats->max_cycles));
+    }
+}
+
+void zmk_event_manager_reset_listener_stats() {
+    for (struct zmk_event_subscription *ev_sub = __event_subscriptions_start;
+         ev_sub < __event_subscriptions_end; ev_sub++) {
+        if (!is_marker(ev_sub)) {
+            *ev_sub->stats = (struct zmk_listener_stats){0};
+        }
+    }
+}
+#else
+// Listener callbacks are static to the file that subscribes them, so dispatch has to go through the
+// pointer; a generated dispatch function in another file couldn't call them directly.
+static inline int call_listener(const struct zmk_event_subscription *ev_sub, zmk_event_t *event) {
+    return ev_sub->listener->callback(event);
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS) */
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_DEFERRED_LISTENERS)
+// Copies of events waiting for a deferred listener, given by their last listener index.
+K_MSGQ_DEFINE(deferred_msgq, sizeof(zmk_event_t *), CONFIG_ZMK_EVENT_MANAGER_DEFERRED_QUEUE_SIZE,
+              4);
+
+static void deferred_work_callback(struct k_work *work) {
+    zmk_event_t *event;
+
+    while (k_msgq_get(&deferred_msgq, &event, K_NO_WAIT) == 0) {
+        call_listener(event->event->subscriptions + event->last_listener_index, event);
+        zmk_event_manager_free(event);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(deferred_work_callback)
+K_WORK_DEFINE(deferred_work, ZMK_WORK_WATCHED(deferred_work_callback));
+
+static int defer_listener(const zmk_event_t *event, uint8_t index) {
+    zmk_event_t *copy = zmk_event_manager_alloc(event->event, event->event->size);
+    if (copy == NULL) {
+        return -ENOMEM;
+    }
+
+    uint8_t flags = copy->flags;
+    memcpy(copy, event, event->event->size);
+    copy->flags = flags;
+    copy->last_listener_index = index;
+
+    int err = k_msgq_put(&deferred_msgq, &copy, K_NO_WAIT);
+    if (err) {
+        zmk_event_manager_free(copy);
+        return err;
+    }
+
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_DEFERRED_EVENTS, &deferred_msgq);
+
+    k_work_submit(&deferred_work);
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_DEFERRED_LISTENERS) */
+
+static int dispatch(zmk_event_t *event, uint8_t start_index) {
     int ret = 0;
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = start_index; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
-        if (ev_sub->event_type != event->event) {
+    const struct zmk_event_subscription *subs = event->event->subscriptions;
+
+    zmk_latency_benchmark_dispatch();
+
+    for (int i = start_index; is_subscription_for(subs + i, event->event); i++) {
+        const struct zmk_event_subscription *ev_sub = subs + i;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_DEFERRED_LISTENERS)
+        // If the copy can't be queued, the listener is called right away instead.
+        if (ev_sub->deferred && defer_listener(event, i) == 0) {
             continue;
         }
+#endif
         event->last_listener_index = i;
-        ret = ev_sub->listener->callback(event);
+        ret = call_listener(ev_sub, event);
         switch (ret) {
         case ZMK_EV_EVENT_BUBBLE:
             continue;
@@ -35,6 +222,11 @@ int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
             ret = 0;
             goto release;
         case ZMK_EV_EVENT_CAPTURED:
+            if (event->flags & ZMK_EVENT_FLAG_STACK) {
+                LOG_ERR("Listener captured a stack event, its subscription must be declared with "
+                        "ZMK_SUBSCRIPTION_CAPTURING");
+                return -EINVAL;
+            }
             LOG_DBG("Listener captured the event");
             // Listeners are expected to free events they capture
             return 0;
@@ -45,42 +237,279 @@ int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
     }
 
 release:
-    k_free(event);
+    if (!(event->flags & ZMK_EVENT_FLAG_STACK)) {
+        zmk_event_manager_free(event);
+    }
     return ret;
 }
 
-int zmk_event_manager_raise(zmk_event_t *event) { return zmk_event_manager_handle_from(event, 0); }
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_QUEUED_DISPATCH)
+// Events raised on the input work queue while it is already dispatching one, in the order they
+// were raised. Only that thread touches the queue, so it needs no locking.
+static struct {
+    zmk_event_t *event;
+    uint8_t start_index;
+} run_queue[CONFIG_ZMK_EVENT_MANAGER_RUN_QUEUE_SIZE];
+static uint8_t run_queue_head;
+static uint8_t run_queue_len;
+static bool dispatching;
 
-int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener) {
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = 0; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
+static inline bool is_queued_dispatch() {
+    return dispatching && k_current_get() == &zmk_input_work_q()->thread;
+}
 
-        if (ev_sub->event_type == event->event && ev_sub->listener == listener) {
-            return zmk_event_manager_handle_from(event, i + 1);
-        }
+static int run_queue_push(zmk_event_t *event, uint8_t start_index) {
+    if (run_queue_len == ARRAY_SIZE(run_queue)) {
+        return -ENOMEM;
+    }
+
+    uint8_t i = (run_queue_head + run_queue_len++) % ARRAY_SIZE(run_queue);
+    run_queue[i].event = event;
+    run_queue[i].start_index = start_index;
+    return 0;
+}
+
+int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
+    if (is_queued_dispatch()) {
+        // With the queue full, the event is dispatched right away as it would be without queued
+        // dispatch, so it is never lost.
+        return run_queue_push(event, start_index) == 0 ? 0 : dispatch(event, start_index);
+    }
+
+    if (k_current_get() != &zmk_input_work_q()->thread) {
+        return dispatch(event, start_index);
+    }
+
+    dispatching = true;
+    int ret = dispatch(event, start_index);
+
+    while (run_queue_len > 0) {
+        zmk_event_t *next = run_queue[run_queue_head].event;
+        uint8_t next_start_index = run_queue[run_queue_head].start_index;
+
+        run_queue_head = (run_queue_head + 1) % ARRAY_SIZE(run_queue);
+        run_queue_len--;
+        dispatch(next, next_start_index);
     }
 
-    LOG_WRN("Unable to find where to raise this after event");
+    dispatching = false;
+    return ret;
+}
+
+// Captured events are replayed one after the other, and each has to see the effects of the ones
+// before it, e.g. a mod-morph replayed after a modifier. So they are dispatched right away, along
+// with every event their listeners raise, while events queued before them stay queued.
+static int dispatch_depth_first(zmk_event_t *event, uint8_t start_index) {
+    if (!is_queued_dispatch()) {
+        return zmk_event_manager_handle_from(event, start_index);
+    }
+
+    uint8_t keep = run_queue_len;
+    int ret = dispatch(event, start_index);
+
+    // Entries are left in place until the end so nothing queued meanwhile lands before them.
+    for (uint8_t i = keep; i < run_queue_len; i++) {
+        uint8_t slot = (run_queue_head + i) % ARRAY_SIZE(run_queue);
+        dispatch(run_queue[slot].event, run_queue[slot].start_index);
+    }
+
+    run_queue_len = keep;
+    return ret;
+}
+#else
+static inline bool is_queued_dispatch() { return false; }
+
+int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
+    return dispatch(event, start_index);
+}
+
+static inline int dispatch_depth_first(zmk_event_t *event, uint8_t start_index) {
+    return dispatch(event, start_index);
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_QUEUED_DISPATCH) */
+
+static int find_listener_index(zmk_event_t *event, const struct zmk_listener *listener) {
+    const struct zmk_event_subscription *subs = event->event->subscriptions;
+
+    // Events are almost always re-raised by the listener that captured them, which is
+    // still recorded as the last listener of the event.
+    uint8_t last = event->last_listener_index;
+    if (is_subscription_for(subs + last, event->event) && subs[last].listener == listener) {
+        return last;
+    }
+
+    for (int i = 0; is_subscription_for(subs + i, event->event); i++) {
+        if (subs[i].listener == listener) {
+            return i;
+        }
+    }
 
     return -EINVAL;
 }
 
-int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener) {
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = 0; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
+int zmk_event_manager_raise(zmk_event_t *event) {
+    if (event == NULL) {
+        return -ENOMEM;
+    }
+
+    return zmk_event_manager_handle_from(event, 0);
+}
 
-        if (ev_sub->event_type == event->event && ev_sub->listener == listener) {
-            return zmk_event_manager_handle_from(event, i);
+static bool may_be_captured(const struct zmk_event_type *event_type) {
+    const struct zmk_event_subscription *subs = event_type->subscriptions;
+    for (int i = 0; is_subscription_for(subs + i, event_type); i++) {
+        if (subs[i].may_capture) {
+            return true;
         }
     }
+    return false;
+}
 
-    LOG_WRN("Unable to find where to raise this event");
+int zmk_event_manager_raise_on_stack(zmk_event_t *event, size_t size) {
+    if (!may_be_captured(event->event) && !is_queued_dispatch()) {
+        return zmk_event_manager_handle_from(event, 0);
+    }
 
-    return -EINVAL;
+    // A listener might hold on to the event after we return, or it might only be dispatched once
+    // the current event is done, so it needs to be copied.
+    zmk_event_t *copy = zmk_event_manager_alloc(event->event, size);
+    if (copy == NULL) {
+        return -ENOMEM;
+    }
+
+    uint8_t flags = copy->flags;
+    memcpy(copy, event, size);
+    copy->flags = flags;
+
+    return zmk_event_manager_handle_from(copy, 0);
+}
+
+int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener) {
+    if (event == NULL) {
+        return -ENOMEM;
+    }
+
+    int index = find_listener_index(event, listener);
+    if (index < 0) {
+        LOG_WRN("Unable to find where to raise this after event");
+        return index;
+    }
+
+    return dispatch_depth_first(event, index + 1);
+}
+
+int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener) {
+    if (event == NULL) {
+        return -ENOMEM;
+    }
+
+    int index = find_listener_index(event, listener);
+    if (index < 0) {
+        LOG_WRN("Unable to find where to raise this event");
+        return index;
+    }
+
+    return dispatch_depth_first(event, index);
 }
 
 int zmk_event_manager_release(zmk_event_t *event) {
-    return zmk_event_manager_handle_from(event, event->last_listener_index + 1);
+    if (event == NULL) {
+        return -ENOMEM;
+    }
+
+    return dispatch_depth_first(event, event->last_listener_index + 1);
+}
+
+int zmk_event_capture_queue_push(struct zmk_event_capture_queue *queue, const zmk_event_t *event) {
+    if (queue->tail - queue->head >= queue->size) {
+        queue->overflows++;
+        zmk_pipeline_stats_dropped(ZMK_PIPELINE_CAPTURE_QUEUE);
+        LOG_ERR("Unable to capture %s event, %d captured already (%d dropped so far)",
+                log_strdup(event->event->name), queue->size, queue->overflows);
+        return -ENOMEM;
+    }
+
+    queue->events[queue->tail++ % queue->size] = event;
+    zmk_pipeline_stats_queued(ZMK_PIPELINE_CAPTURE_QUEUE, queue->tail - queue->head);
+    return 0;
+}
+
+struct zmk_event_capture_group
+zmk_event_capture_queue_take_group(struct zmk_event_capture_queue *queue) {
+    struct zmk_event_capture_group group = {.next = queue->group_start, .end = queue->tail};
+    queue->group_start = queue->tail;
+    return group;
+}
+
+const zmk_event_t *zmk_event_capture_queue_next(struct zmk_event_capture_queue *queue,
+                                                struct zmk_event_capture_group *group) {
+    if (group->next == group->end) {
+        return NULL;
+    }
+
+    const zmk_event_t **slot = &queue->events[group->next++ % queue->size];
+    const zmk_event_t *event = *slot;
+    *slot = NULL;
+
+    // Free the slots at the head as soon as they're replayed. Events of an enclosing group that
+    // are still being replayed keep the head in place until they are done.
+    while (queue->head != queue->tail && queue->events[queue->head % queue->size] == NULL) {
+        queue->head++;
+    }
+    if (queue->head == queue->tail) {
+        // Every group has been replayed, so no range refers to the counters anymore.
+        queue->head = queue->tail = queue->group_start = 0;
+        group->next = group->end = 0;
+    }
+
+    return event;
 }
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS) && IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+static int cmd_listeners(const struct shell *sh, size_t argc, char **argv) {
+    shell_print(sh, "%-24s %-36s %8s %8s %8s %8s", "listener", "event", "calls", "captures",
+                "avg us", "max us");
+    for (struct zmk_event_subscription *ev_sub = __event_subscriptions_start;
+         ev_sub < __event_subscriptions_end; ev_sub++) {
+        if (is_marker(ev_sub)) {
+            continue;
+        }
+        struct zmk_listener_stats *stats = ev_sub->stats;
+        shell_print(sh, "%-24s %-36s %8u %8u %8u %8u", ev_sub->listener->name,
+                    ev_sub->event_type->name, stats->calls, stats->captures, average_us(stats),
+                    k_cyc_to_us_floor32(stats->max_cycles));
+    }
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    zmk_event_manager_reset_listener_stats();
+    shell_print(sh, "Listener statistics reset");
+    return 0;
+}
+
+static int cmd_pools(const struct shell *sh, size_t argc, char **argv) {
+#if IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_POOLS)
+    shell_print(sh, "%-36s %8s %8s %8s", "event", "in use", "max", "heap");
+    for (struct zmk_event_type **type = __event_type_start; type < __event_type_end; type++) {
+        struct zmk_event_pool *pool = (*type)->pool;
+        shell_print(sh, "%-36s %8u %8u %8u", (*type)->name, k_mem_slab_num_used_get(pool->slab),
+                    pool->high_water_mark, pool->heap_fallbacks);
+    }
+#else
+    shell_print(sh, "Event pools are not enabled");
+#endif
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_events, SHELL_CMD(listeners, NULL, "Show listener call statistics", cmd_listeners),
+    SHELL_CMD(reset, NULL, "Reset listener call statistics", cmd_reset),
+    SHELL_CMD(pools, NULL, "Show event pool usage", cmd_pools), SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(events, &sub_events, "ZMK event manager commands", NULL);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_EVENT_MANAGER_LISTENER_STATS) && IS_ENABLED(CONFIG_SHELL) */
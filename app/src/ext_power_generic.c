@@ -15,6 +15,12 @@
 #include <drivers/gpio.h>
 #include <drivers/ext_power.h>
 
+#include <zmk/ext_power.h>
+#include <zmk/settings.h>
+#include <zmk/work_watchdog.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+
 #if DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT)
 
 #include <logging/log.h>
@@ -36,7 +42,7 @@ struct ext_power_generic_data {
 };
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-static void ext_power_save_state_work(struct k_work *work) {
+static void ext_power_save_state_work() {
     char setting_path[40];
     const struct device *ext_power = device_get_binding(DT_INST_LABEL(0));
     struct ext_power_generic_data *data = ext_power->data;
@@ -45,42 +51,122 @@ static void ext_power_save_state_work(struct k_work *work) {
     settings_save_one(setting_path, &data->status, sizeof(data->status));
 }
 
-static struct k_work_delayable ext_power_save_work;
+ZMK_SETTINGS_SAVE_DEFINE(ext_power_save, ext_power_save_state_work);
 #endif
 
 int ext_power_save_state() {
 #if IS_ENABLED(CONFIG_SETTINGS)
-    int ret = k_work_reschedule(&ext_power_save_work, K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
-    return MIN(ret, 0);
+    return zmk_settings_save(&ext_power_save);
 #else
     return 0;
 #endif
 }
 
-static int ext_power_generic_enable(const struct device *dev) {
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+// Consumers that currently need the rail, one bit per zmk_ext_power_consumer.
+static atomic_t gate_claims;
+// Set for a while after activity resumes, so the rail is up before its consumers come back.
+static atomic_t gate_pre_power;
+static struct k_spinlock gate_lock;
+#endif
+
+// The status is what the user asked for. With gating, the rail is only on while something also
+// needs it.
+static bool ext_power_generic_rail_needed(const struct device *dev) {
+    struct ext_power_generic_data *data = dev->data;
+
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+    return data->status && (atomic_get(&gate_claims) || atomic_get(&gate_pre_power));
+#else
+    return data->status;
+#endif
+}
+
+static int ext_power_generic_update(const struct device *dev) {
     struct ext_power_generic_data *data = dev->data;
     const struct ext_power_generic_config *config = dev->config;
+    int err;
+
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+    // Claims come from several threads, so the pin has to follow the last of them.
+    k_spinlock_key_t key = k_spin_lock(&gate_lock);
+#endif
 
-    if (gpio_pin_set(data->gpio, config->pin, 1)) {
-        LOG_WRN("Failed to set ext-power control pin");
+    err = gpio_pin_set(data->gpio, config->pin, ext_power_generic_rail_needed(dev));
+
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+    k_spin_unlock(&gate_lock, key);
+#endif
+
+    if (err) {
+        LOG_WRN("Failed to update ext-power control pin");
         return -EIO;
     }
+    return 0;
+}
+
+static int ext_power_generic_enable(const struct device *dev) {
+    struct ext_power_generic_data *data = dev->data;
+
     data->status = true;
+    if (ext_power_generic_update(dev)) {
+        return -EIO;
+    }
     return ext_power_save_state();
 }
 
 static int ext_power_generic_disable(const struct device *dev) {
     struct ext_power_generic_data *data = dev->data;
-    const struct ext_power_generic_config *config = dev->config;
 
-    if (gpio_pin_set(data->gpio, config->pin, 0)) {
-        LOG_WRN("Failed to clear ext-power control pin");
+    data->status = false;
+    if (ext_power_generic_update(dev)) {
         return -EIO;
     }
-    data->status = false;
     return ext_power_save_state();
 }
 
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+void zmk_ext_power_claim(enum zmk_ext_power_consumer consumer, bool needed) {
+    bool was_needed = needed ? atomic_test_and_set_bit(&gate_claims, consumer)
+                             : atomic_test_and_clear_bit(&gate_claims, consumer);
+
+    if (was_needed != needed) {
+        ext_power_generic_update(DEVICE_DT_GET(DT_DRV_INST(0)));
+    }
+}
+
+static void gate_pre_power_timeout(struct k_work *work) {
+    atomic_set(&gate_pre_power, false);
+    ext_power_generic_update(DEVICE_DT_GET(DT_DRV_INST(0)));
+}
+
+ZMK_WORK_WATCHDOG_WRAP(gate_pre_power_timeout)
+static K_WORK_DELAYABLE_DEFINE(gate_pre_power_work, ZMK_WORK_WATCHED(gate_pre_power_timeout));
+
+static void gate_start_pre_power() {
+    atomic_set(&gate_pre_power, true);
+    ext_power_generic_update(DEVICE_DT_GET(DT_DRV_INST(0)));
+    k_work_reschedule(&gate_pre_power_work, K_MSEC(CONFIG_ZMK_EXT_POWER_GATE_PRE_POWER_MS));
+}
+
+static int ext_power_gate_listener(const zmk_event_t *eh) {
+    struct zmk_activity_state_changed *ev = as_zmk_activity_state_changed(eh);
+    if (ev == NULL) {
+        return -ENOTSUP;
+    }
+
+    // The first activity powers the rail right away, so the display and underglow don't wait for
+    // their devices to start up once they resume.
+    if (ev->state == ZMK_ACTIVITY_ACTIVE) {
+        gate_start_pre_power();
+    }
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(ext_power_gate, ext_power_gate_listener);
+ZMK_SUBSCRIPTION(ext_power_gate, zmk_activity_state_changed);
+#endif
+
 static int ext_power_generic_get(const struct device *dev) {
     struct ext_power_generic_data *data = dev->data;
     return data->status;
@@ -88,7 +174,7 @@ static int ext_power_generic_get(const struct device *dev) {
 
 #if IS_ENABLED(CONFIG_SETTINGS)
 static int ext_power_settings_set(const char *name, size_t len, settings_read_cb read_cb,
-                                  void *cb_arg) {
+                                  void *cb_arg, void *param) {
     const char *next;
     int rc;
 
@@ -121,9 +207,6 @@ static int ext_power_settings_set(const char *name, size_t len, settings_read_cb
     }
     return -ENOENT;
 }
-
-struct settings_handler ext_power_conf = {.name = "ext_power/state",
-                                          .h_set = ext_power_settings_set};
 #endif
 
 static int ext_power_generic_init(const struct device *dev) {
@@ -141,24 +224,25 @@ static int ext_power_generic_init(const struct device *dev) {
         return -EIO;
     }
 
+#if IS_ENABLED(CONFIG_ZMK_EXT_POWER_GATE)
+    // Keep the rail up while its consumers start and make their first claims.
+    gate_start_pre_power();
+#endif
+
 #if IS_ENABLED(CONFIG_SETTINGS)
     settings_subsys_init();
 
-    int err = settings_register(&ext_power_conf);
+    // Devices powered by ext_power may initialize right after it, so this is loaded here rather
+    // than with the other settings. It isn't registered, so the later full load skips it.
+    int err = settings_load_subtree_direct("ext_power/state", ext_power_settings_set, NULL);
     if (err) {
-        LOG_ERR("Failed to register the ext_power settings handler (err %d)", err);
-        return err;
+        LOG_ERR("Failed to load the ext_power settings (err %d)", err);
     }
 
-    k_work_init_delayable(&ext_power_save_work, ext_power_save_state_work);
-
     // Set default value (on) if settings isn't set
-    settings_load_subtree("ext_power");
     if (!data->settings_init) {
 
         data->status = true;
-        k_work_schedule(&ext_power_save_work, K_NO_WAIT);
-
         ext_power_enable(dev);
     }
 #else
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <init.h>
+#include <kernel.h>
+#include <shell/shell.h>
+#include <spinlock.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/flight_recorder.h>
+
+#define MAGIC 0x464c5431
+
+static const char *const type_names[] = {
+    [ZMK_FLIGHT_BOOT] = "boot",
+    [ZMK_FLIGHT_POSITION] = "position",
+    [ZMK_FLIGHT_LAYER] = "layer",
+    [ZMK_FLIGHT_HID_KEYBOARD] = "hid_keyboard",
+    [ZMK_FLIGHT_HID_CONSUMER] = "hid_consumer",
+    [ZMK_FLIGHT_BLE_CONNECTED] = "ble_connected",
+    [ZMK_FLIGHT_BLE_DISCONNECTED] = "ble_disconnected",
+    [ZMK_FLIGHT_WORK_STALL] = "work_stall",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(type_names) == ZMK_FLIGHT_RECORD_TYPE_COUNT,
+             "Every flight record type needs a name");
+
+struct flight_record {
+    /** Low 32 bits of the uptime in ticks. */
+    uint32_t ticks;
+    uint16_t arg;
+    uint8_t type;
+    uint8_t state;
+};
+
+// Left alone by the C runtime at boot, so the records leading up to a warm reset, such as one
+// after a fatal error, are still there afterwards.
+static __noinit struct {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t boots;
+    // Free-running count of written records, record i is in slot (i % size).
+    uint32_t written;
+    struct flight_record records[CONFIG_ZMK_FLIGHT_RECORDER_SIZE];
+} recorder;
+
+static struct k_spinlock lock;
+
+void zmk_flight_record(enum zmk_flight_record_type type, uint16_t arg, uint8_t state) {
+    struct flight_record record = {
+        .ticks = (uint32_t)k_uptime_ticks(),
+        .arg = arg,
+        .type = type,
+        .state = state,
+    };
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    recorder.records[recorder.written++ % ARRAY_SIZE(recorder.records)] = record;
+    k_spin_unlock(&lock, key);
+}
+
+static void flight_recorder_reset() {
+    recorder.magic = MAGIC;
+    recorder.size = ARRAY_SIZE(recorder.records);
+    recorder.boots = 0;
+    recorder.written = 0;
+}
+
+static int flight_recorder_init(const struct device *_arg) {
+    // After a power cycle, or with firmware of a different size, the RAM holds garbage.
+    if (recorder.magic != MAGIC || recorder.size != ARRAY_SIZE(recorder.records)) {
+        flight_recorder_reset();
+    }
+
+    recorder.boots++;
+    zmk_flight_record(ZMK_FLIGHT_BOOT, recorder.boots, 0);
+
+    return 0;
+}
+
+// Before everything else, so no record comes in before the old ones are checked.
+SYS_INIT(flight_recorder_init, PRE_KERNEL_1, 0);
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    flight_recorder_reset();
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Flight recorder cleared");
+    return 0;
+}
+
+// Times are uptimes, which start over at each boot record.
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t written = recorder.written;
+    k_spin_unlock(&lock, key);
+
+    uint32_t start =
+        written > ARRAY_SIZE(recorder.records) ? written - ARRAY_SIZE(recorder.records) : 0;
+
+    for (uint32_t i = start; i < written; i++) {
+        key = k_spin_lock(&lock);
+        struct flight_record record = recorder.records[i % ARRAY_SIZE(recorder.records)];
+        bool overwritten = recorder.written - i > ARRAY_SIZE(recorder.records);
+        k_spin_unlock(&lock, key);
+
+        // Records written since the dump started have overwritten the rest.
+        if (overwritten) {
+            shell_warn(sh, "Overwritten while dumping");
+            break;
+        }
+
+        uint64_t us = k_ticks_to_us_floor64(record.ticks);
+        shell_print(sh, "t=%u.%03u ms %s arg=%u state=%u", (uint32_t)(us / USEC_PER_MSEC),
+                    (uint32_t)(us % USEC_PER_MSEC),
+                    record.type < ARRAY_SIZE(type_names) ? type_names[record.type] : "?",
+                    record.arg, record.state);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_flight, SHELL_CMD(dump, NULL, "Print the records", cmd_dump),
+                               SHELL_CMD(clear, NULL, "Clear the records", cmd_clear),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(flight, &sub_flight, "ZMK flight recorder commands", NULL);
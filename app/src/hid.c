@@ -8,19 +8,28 @@
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <spinlock.h>
+#include <string.h>
+
 #include <zmk/hid.h>
+#if IS_ENABLED(CONFIG_ZMK_HID_MODIFIERS_EVENTS)
+#include <zmk/events/modifiers_state_changed.h>
+#endif
 #include <dt-bindings/zmk/modifiers.h>
 
 static struct zmk_hid_keyboard_report keyboard_report = {
-    .report_id = 1, .body = {.modifiers = 0, ._reserved = 0, .keys = {0}}};
+    .report_id = ZMK_HID_REPORT_ID_KEYBOARD, .body = {.modifiers = 0, ._reserved = 0, .keys = {0}}};
 
-static struct zmk_hid_consumer_report consumer_report = {.report_id = 2, .body = {.keys = {0}}};
+static struct zmk_hid_consumer_report consumer_report = {.report_id = ZMK_HID_REPORT_ID_CONSUMER,
+                                                          .body = {.keys = {0}}};
 
 // Keep track of how often a modifier was pressed.
 // Only release the modifier if the count is 0.
 static int explicit_modifier_counts[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 static zmk_mod_flags_t explicit_modifiers = 0;
 static zmk_mod_flags_t implicit_modifiers = 0;
+// The usage whose press set the current implicit modifiers. Only its release clears them.
+static uint32_t implicit_modifiers_usage = 0;
 static zmk_mod_flags_t masked_modifiers = 0;
 
 #define SET_MODIFIERS(mods)                                                                        \
@@ -31,18 +40,60 @@ static zmk_mod_flags_t masked_modifiers = 0;
 
 #define GET_MODIFIERS (keyboard_report.body.modifiers)
 
+#if IS_ENABLED(CONFIG_ZMK_HID_MODIFIERS_EVENTS)
+static int modifiers_batch_depth = 0;
+static zmk_mod_flags_t modifiers_batch_previous;
+
+// Raises one event for a whole change of the reported modifiers, however many bits it touched.
+// Returns whether they changed, so callers can report it like they did before.
+static int modifiers_changed(zmk_mod_flags_t previous) {
+    zmk_mod_flags_t current = GET_MODIFIERS;
+    if (current == previous) {
+        return 0;
+    }
+
+    if (modifiers_batch_depth > 0) {
+        // The end of the batch raises the event for it.
+        return 1;
+    }
+
+    raise_zmk_modifiers_state_changed(
+        (struct zmk_modifiers_state_changed){.previous_modifiers = previous, .modifiers = current});
+    return 1;
+}
+
+void zmk_hid_modifiers_batch_begin() {
+    if (modifiers_batch_depth++ == 0) {
+        modifiers_batch_previous = GET_MODIFIERS;
+    }
+}
+
+int zmk_hid_modifiers_batch_end() {
+    if (modifiers_batch_depth <= 0) {
+        LOG_ERR("Modifiers batch ended without being started");
+        return -EINVAL;
+    }
+
+    if (--modifiers_batch_depth > 0) {
+        return 0;
+    }
+    return modifiers_changed(modifiers_batch_previous);
+}
+#else
+static inline int modifiers_changed(zmk_mod_flags_t previous) {
+    return previous == GET_MODIFIERS ? 0 : 1;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_HID_MODIFIERS_EVENTS) */
+
 zmk_mod_flags_t zmk_hid_get_explicit_mods() { return explicit_modifiers; }
 
-int zmk_hid_register_mod(zmk_mod_t modifier) {
+static void register_mod(zmk_mod_t modifier) {
     explicit_modifier_counts[modifier]++;
     LOG_DBG("Modifier %d count %d", modifier, explicit_modifier_counts[modifier]);
     WRITE_BIT(explicit_modifiers, modifier, true);
-    zmk_mod_flags_t current = GET_MODIFIERS;
-    SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
 }
 
-int zmk_hid_unregister_mod(zmk_mod_t modifier) {
+static int unregister_mod(zmk_mod_t modifier) {
     if (explicit_modifier_counts[modifier] <= 0) {
         LOG_ERR("Tried to unregister modifier %d too often", modifier);
         return -EINVAL;
@@ -53,9 +104,24 @@ int zmk_hid_unregister_mod(zmk_mod_t modifier) {
         LOG_DBG("Modifier %d released", modifier);
         WRITE_BIT(explicit_modifiers, modifier, false);
     }
-    zmk_mod_flags_t current = GET_MODIFIERS;
+    return 0;
+}
+
+int zmk_hid_register_mod(zmk_mod_t modifier) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
+    register_mod(modifier);
     SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
+    return modifiers_changed(previous);
+}
+
+int zmk_hid_unregister_mod(zmk_mod_t modifier) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
+    int err = unregister_mod(modifier);
+    if (err) {
+        return err;
+    }
+    SET_MODIFIERS(explicit_modifiers);
+    return modifiers_changed(previous);
 }
 
 bool zmk_hid_mod_is_pressed(zmk_mod_t modifier) {
@@ -63,25 +129,30 @@ bool zmk_hid_mod_is_pressed(zmk_mod_t modifier) {
     return (zmk_hid_get_explicit_mods() & mod_flag) == mod_flag;
 }
 
+// The masks below are applied as a whole, so a hyper key raises a single modifiers event.
 int zmk_hid_register_mods(zmk_mod_flags_t modifiers) {
-    int ret = 0;
+    zmk_mod_flags_t previous = GET_MODIFIERS;
     for (zmk_mod_t i = 0; i < 8; i++) {
         if (modifiers & (1 << i)) {
-            ret += zmk_hid_register_mod(i);
+            register_mod(i);
         }
     }
-    return ret;
+    SET_MODIFIERS(explicit_modifiers);
+    return modifiers_changed(previous);
 }
 
 int zmk_hid_unregister_mods(zmk_mod_flags_t modifiers) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
     int ret = 0;
     for (zmk_mod_t i = 0; i < 8; i++) {
         if (modifiers & (1 << i)) {
-            ret += zmk_hid_unregister_mod(i);
+            ret += unregister_mod(i);
         }
     }
+    SET_MODIFIERS(explicit_modifiers);
+    int changed = modifiers_changed(previous);
 
-    return ret;
+    return ret < 0 ? ret : changed;
 }
 
 #if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_NKRO)
@@ -111,81 +182,167 @@ static inline bool check_keyboard_usage(zmk_key_t usage) {
     return keyboard_report.body.keys[usage / 8] & (1 << (usage % 8));
 }
 
-#elif IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO)
+static inline void reset_keyboard_usages() {}
+
+static inline int copy_boot_keys(uint8_t *keys) {
+    int len = 0;
 
-#define TOGGLE_KEYBOARD(match, val)                                                                \
-    for (int idx = 0; idx < CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE; idx++) {                          \
-        if (keyboard_report.body.keys[idx] != match) {                                             \
-            continue;                                                                              \
-        }                                                                                          \
-        keyboard_report.body.keys[idx] = val;                                                      \
-        if (val) {                                                                                 \
-            break;                                                                                 \
-        }                                                                                          \
+    for (int i = 0; i < sizeof(keyboard_report.body.keys); i++) {
+        for (uint8_t bits = keyboard_report.body.keys[i]; bits != 0; bits &= bits - 1) {
+            if (len == ZMK_HID_BOOT_KEYS_LEN) {
+                return -ENOMEM;
+            }
+            keys[len++] = i * 8 + __builtin_ctz(bits);
+        }
     }
 
+    return len;
+}
+
+#elif IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO)
+
+BUILD_ASSERT(CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE <= 64,
+             "HKRO reports are limited to 64 keys, use NKRO for more");
+
+// The slot + 1 of each usage in the report, or 0 if the usage isn't pressed, along with a bitmap of
+// the free slots. Pressing, releasing and checking a usage then never scans the report.
+static uint8_t keyboard_usage_slots[UINT8_MAX + 1];
+static uint64_t keyboard_free_slots = GENMASK64(CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE - 1, 0);
+
 static inline int select_keyboard_usage(zmk_key_t usage) {
-    TOGGLE_KEYBOARD(0U, usage);
+    if (usage == 0 || usage > UINT8_MAX) {
+        return -EINVAL;
+    }
+    if (keyboard_usage_slots[usage] != 0) {
+        return 0;
+    }
+    if (keyboard_free_slots == 0) {
+        return -ENOMEM;
+    }
+
+    int slot = __builtin_ctzll(keyboard_free_slots);
+    keyboard_free_slots &= ~BIT64(slot);
+    keyboard_report.body.keys[slot] = usage;
+    keyboard_usage_slots[usage] = slot + 1;
     return 0;
 }
 
 static inline int deselect_keyboard_usage(zmk_key_t usage) {
-    TOGGLE_KEYBOARD(usage, 0U);
+    if (usage > UINT8_MAX || keyboard_usage_slots[usage] == 0) {
+        return 0;
+    }
+
+    int slot = keyboard_usage_slots[usage] - 1;
+    keyboard_report.body.keys[slot] = 0;
+    keyboard_free_slots |= BIT64(slot);
+    keyboard_usage_slots[usage] = 0;
     return 0;
 }
 
 static inline int check_keyboard_usage(zmk_key_t usage) {
-    for (int idx = 0; idx < CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE; idx++) {
-        if (keyboard_report.body.keys[idx] == usage) {
-            return true;
+    return usage <= UINT8_MAX && keyboard_usage_slots[usage] != 0;
+}
+
+static inline void reset_keyboard_usages() {
+    memset(keyboard_usage_slots, 0, sizeof(keyboard_usage_slots));
+    keyboard_free_slots = GENMASK64(CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE - 1, 0);
+}
+
+static inline int copy_boot_keys(uint8_t *keys) {
+    uint64_t used = ~keyboard_free_slots & GENMASK64(CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE - 1, 0);
+    int len = 0;
+
+    for (; used != 0; used &= used - 1) {
+        if (len == ZMK_HID_BOOT_KEYS_LEN) {
+            return -ENOMEM;
         }
+        keys[len++] = keyboard_report.body.keys[__builtin_ctzll(used)];
     }
-    return false;
+
+    return len;
 }
 
 #else
 #error "A proper HID report type must be selected"
 #endif
 
-#define TOGGLE_CONSUMER(match, val)                                                                \
-    COND_CODE_1(IS_ENABLED(CONFIG_ZMK_HID_CONSUMER_REPORT_USAGES_BASIC),                           \
-                (if (val > 0xFF) { return -ENOTSUP; }), ())                                        \
-    for (int idx = 0; idx < CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE; idx++) {                          \
-        if (consumer_report.body.keys[idx] != match) {                                             \
-            continue;                                                                              \
-        }                                                                                          \
-        consumer_report.body.keys[idx] = val;                                                      \
-        if (val) {                                                                                 \
-            break;                                                                                 \
-        }                                                                                          \
+BUILD_ASSERT(CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE <= 64, "Consumer reports are limited to 64 keys");
+
+// Consumer usages are too sparse to index, but only the used slots are ever searched, and a free
+// slot is found without a scan.
+static uint64_t consumer_free_slots = GENMASK64(CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE - 1, 0);
+
+static int find_consumer_usage(zmk_key_t usage) {
+    uint64_t used = ~consumer_free_slots & GENMASK64(CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE - 1, 0);
+
+    for (; used != 0; used &= used - 1) {
+        int slot = __builtin_ctzll(used);
+        if (consumer_report.body.keys[slot] == usage) {
+            return slot;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static inline int select_consumer_usage(zmk_key_t usage) {
+    if (IS_ENABLED(CONFIG_ZMK_HID_CONSUMER_REPORT_USAGES_BASIC) && usage > 0xFF) {
+        return -ENOTSUP;
+    }
+    if (usage == 0 || find_consumer_usage(usage) >= 0) {
+        return 0;
     }
+    if (consumer_free_slots == 0) {
+        return -ENOMEM;
+    }
+
+    int slot = __builtin_ctzll(consumer_free_slots);
+    consumer_free_slots &= ~BIT64(slot);
+    consumer_report.body.keys[slot] = usage;
+    return 0;
+}
+
+static inline int deselect_consumer_usage(zmk_key_t usage) {
+    int slot = find_consumer_usage(usage);
+    if (slot < 0) {
+        return 0;
+    }
+
+    consumer_report.body.keys[slot] = 0;
+    consumer_free_slots |= BIT64(slot);
+    return 0;
+}
 
-int zmk_hid_implicit_modifiers_press(zmk_mod_flags_t new_implicit_modifiers) {
+int zmk_hid_implicit_modifiers_press(uint32_t usage, zmk_mod_flags_t new_implicit_modifiers) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
+    implicit_modifiers_usage = usage;
     implicit_modifiers = new_implicit_modifiers;
-    zmk_mod_flags_t current = GET_MODIFIERS;
     SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
+    return modifiers_changed(previous);
 }
 
-int zmk_hid_implicit_modifiers_release() {
-    implicit_modifiers = 0;
-    zmk_mod_flags_t current = GET_MODIFIERS;
+int zmk_hid_implicit_modifiers_release(uint32_t usage) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
+    if (usage == implicit_modifiers_usage) {
+        implicit_modifiers_usage = 0;
+        implicit_modifiers = 0;
+    }
     SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
+    return modifiers_changed(previous);
 }
 
 int zmk_hid_masked_modifiers_set(zmk_mod_flags_t new_masked_modifiers) {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
     masked_modifiers = new_masked_modifiers;
-    zmk_mod_flags_t current = GET_MODIFIERS;
     SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
+    return modifiers_changed(previous);
 }
 
 int zmk_hid_masked_modifiers_clear() {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
     masked_modifiers = 0;
-    zmk_mod_flags_t current = GET_MODIFIERS;
     SET_MODIFIERS(explicit_modifiers);
-    return current == GET_MODIFIERS ? 0 : 1;
+    return modifiers_changed(previous);
 }
 
 int zmk_hid_keyboard_press(zmk_key_t code) {
@@ -211,27 +368,30 @@ bool zmk_hid_keyboard_is_pressed(zmk_key_t code) {
     return check_keyboard_usage(code);
 }
 
-void zmk_hid_keyboard_clear() { memset(&keyboard_report.body, 0, sizeof(keyboard_report.body)); }
+void zmk_hid_keyboard_clear() {
+    zmk_mod_flags_t previous = GET_MODIFIERS;
+    memset(&keyboard_report.body, 0, sizeof(keyboard_report.body));
+    reset_keyboard_usages();
+    modifiers_changed(previous);
+}
 
 int zmk_hid_consumer_press(zmk_key_t code) {
-    TOGGLE_CONSUMER(0U, code);
-    return 0;
+    int err = select_consumer_usage(code);
+    return err == -ENOTSUP ? err : 0;
 };
 
 int zmk_hid_consumer_release(zmk_key_t code) {
-    TOGGLE_CONSUMER(code, 0U);
+    deselect_consumer_usage(code);
     return 0;
 };
 
-void zmk_hid_consumer_clear() { memset(&consumer_report.body, 0, sizeof(consumer_report.body)); }
+void zmk_hid_consumer_clear() {
+    memset(&consumer_report.body, 0, sizeof(consumer_report.body));
+    consumer_free_slots = GENMASK64(CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE - 1, 0);
+}
 
 bool zmk_hid_consumer_is_pressed(zmk_key_t key) {
-    for (int idx = 0; idx < CONFIG_ZMK_HID_CONSUMER_REPORT_SIZE; idx++) {
-        if (consumer_report.body.keys[idx] == key) {
-            return true;
-        }
-    }
-    return false;
+    return key != 0 && find_consumer_usage(key) >= 0;
 }
 
 int zmk_hid_press(uint32_t usage) {
@@ -271,3 +431,187 @@ struct zmk_hid_keyboard_report *zmk_hid_get_keyboard_report() {
 struct zmk_hid_consumer_report *zmk_hid_get_consumer_report() {
     return &consumer_report;
 }
+
+#define KEY_BITMAP_LEN ((UINT8_MAX + 1) / 8)
+
+static void key_bitmap(const struct zmk_hid_keyboard_report_body *report, uint8_t *bitmap) {
+    memset(bitmap, 0, KEY_BITMAP_LEN);
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_NKRO)
+    memcpy(bitmap, report->keys, sizeof(report->keys));
+#else
+    for (int i = 0; i < CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE; i++) {
+        if (report->keys[i] != 0) {
+            WRITE_BIT(bitmap[report->keys[i] / 8], report->keys[i] % 8, 1);
+        }
+    }
+#endif
+}
+
+// No key may change twice, and since hosts handle the keys of one report in usage order, the
+// merged change may press at most one key, and only a key without the modifiers changing with it.
+bool zmk_hid_keyboard_report_can_skip(const struct zmk_hid_keyboard_report_body *before,
+                                      const struct zmk_hid_keyboard_report_body *queued,
+                                      const struct zmk_hid_keyboard_report_body *next) {
+    uint8_t b[KEY_BITMAP_LEN], q[KEY_BITMAP_LEN], n[KEY_BITMAP_LEN];
+    key_bitmap(before, b);
+    key_bitmap(queued, q);
+    key_bitmap(next, n);
+
+    if (((before->modifiers ^ queued->modifiers) & (queued->modifiers ^ next->modifiers)) != 0) {
+        return false;
+    }
+
+    int presses = __builtin_popcount((queued->modifiers & ~before->modifiers) |
+                                     (next->modifiers & ~queued->modifiers));
+    for (int i = 0; i < KEY_BITMAP_LEN; i++) {
+        if (((b[i] ^ q[i]) & (q[i] ^ n[i])) != 0) {
+            return false;
+        }
+        presses += __builtin_popcount((uint8_t)((q[i] & ~b[i]) | (n[i] & ~q[i])));
+    }
+
+    return presses == 0 || (presses == 1 && before->modifiers == next->modifiers);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_HKRO) &&                                                 \
+    CONFIG_ZMK_HID_KEYBOARD_REPORT_SIZE == ZMK_HID_BOOT_KEYS_LEN
+
+BUILD_ASSERT(sizeof(struct zmk_hid_boot_report) == sizeof(struct zmk_hid_keyboard_report_body),
+             "6KRO keyboard reports must have the boot report layout");
+
+// The keyboard report body already is a boot report, so it is sent as is.
+struct zmk_hid_boot_report *zmk_hid_get_boot_report() {
+    return (struct zmk_hid_boot_report *)&keyboard_report.body;
+}
+
+#else
+
+static struct zmk_hid_boot_report boot_report;
+
+struct zmk_hid_boot_report *zmk_hid_get_boot_report() {
+    boot_report.modifiers = keyboard_report.body.modifiers;
+    memset(boot_report.keys, 0, sizeof(boot_report.keys));
+
+    if (copy_boot_keys(boot_report.keys) < 0) {
+        memset(boot_report.keys, HID_USAGE_KEY_KEYBOARD_ERRORROLLOVER, sizeof(boot_report.keys));
+    }
+
+    return &boot_report;
+}
+
+#endif
+#endif /* IS_ENABLED(CONFIG_ZMK_USB_BOOT) */
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+// Reports are taken from the USB and BLE send paths, so everything below is guarded by the lock.
+static struct k_spinlock mouse_lock;
+
+static uint8_t mouse_button_counts[ZMK_HID_MOUSE_BUTTONS];
+static uint8_t mouse_buttons;
+// The buttons of the last report taken, so a report is only needed if they changed since.
+static uint8_t mouse_buttons_sent;
+
+static int32_t mouse_x;
+static int32_t mouse_y;
+static int32_t mouse_scroll_y;
+static int32_t mouse_scroll_x;
+
+static uint8_t mouse_resolution_multipliers;
+
+int zmk_hid_mouse_button_press(uint8_t button) {
+    if (button >= ZMK_HID_MOUSE_BUTTONS) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+    mouse_button_counts[button]++;
+    WRITE_BIT(mouse_buttons, button, true);
+    k_spin_unlock(&mouse_lock, key);
+
+    return 0;
+}
+
+int zmk_hid_mouse_button_release(uint8_t button) {
+    if (button >= ZMK_HID_MOUSE_BUTTONS) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+    if (mouse_button_counts[button] == 0) {
+        k_spin_unlock(&mouse_lock, key);
+        LOG_ERR("Tried to release mouse button %d too often", button);
+        return -EINVAL;
+    }
+
+    if (--mouse_button_counts[button] == 0) {
+        WRITE_BIT(mouse_buttons, button, false);
+    }
+    k_spin_unlock(&mouse_lock, key);
+
+    return 0;
+}
+
+uint8_t zmk_hid_mouse_get_buttons() { return mouse_buttons; }
+
+void zmk_hid_mouse_movement_add(int32_t x, int32_t y) {
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+    mouse_x += x;
+    mouse_y += y;
+    k_spin_unlock(&mouse_lock, key);
+}
+
+void zmk_hid_mouse_scroll_add(int32_t vertical, int32_t horizontal) {
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+    mouse_scroll_y += vertical;
+    mouse_scroll_x += horizontal;
+    k_spin_unlock(&mouse_lock, key);
+}
+
+void zmk_hid_mouse_clear() {
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+    memset(mouse_button_counts, 0, sizeof(mouse_button_counts));
+    mouse_buttons = 0;
+    mouse_x = mouse_y = mouse_scroll_y = mouse_scroll_x = 0;
+    k_spin_unlock(&mouse_lock, key);
+}
+
+// Takes as many whole units of `divisor` as fit the report, leaving the rest accumulated.
+static int16_t take_motion(int32_t *accumulated, int32_t divisor) {
+    int32_t value = CLAMP(*accumulated / divisor, -INT16_MAX, INT16_MAX);
+    *accumulated -= value * divisor;
+    return value;
+}
+
+static int32_t scroll_divisor(uint8_t multiplier) {
+    return (mouse_resolution_multipliers & multiplier) ? 1 : ZMK_HID_MOUSE_SCROLL_RESOLUTION;
+}
+
+bool zmk_hid_mouse_take_report(struct zmk_hid_mouse_report *report) {
+    k_spinlock_key_t key = k_spin_lock(&mouse_lock);
+
+    report->report_id = ZMK_HID_REPORT_ID_MOUSE;
+    report->body.buttons = mouse_buttons;
+    report->body.d_x = take_motion(&mouse_x, 1);
+    report->body.d_y = take_motion(&mouse_y, 1);
+    report->body.d_scroll_y =
+        take_motion(&mouse_scroll_y, scroll_divisor(ZMK_HID_MOUSE_MULTIPLIER_SCROLL_Y));
+    report->body.d_scroll_x =
+        take_motion(&mouse_scroll_x, scroll_divisor(ZMK_HID_MOUSE_MULTIPLIER_SCROLL_X));
+
+    bool changed = mouse_buttons != mouse_buttons_sent || report->body.d_x != 0 ||
+                   report->body.d_y != 0 || report->body.d_scroll_y != 0 ||
+                   report->body.d_scroll_x != 0;
+    mouse_buttons_sent = mouse_buttons;
+
+    k_spin_unlock(&mouse_lock, key);
+    return changed;
+}
+
+uint8_t zmk_hid_mouse_get_resolution_multipliers() { return mouse_resolution_multipliers; }
+
+void zmk_hid_mouse_set_resolution_multipliers(uint8_t multipliers) {
+    LOG_DBG("Mouse resolution multipliers set to 0x%02X", multipliers);
+    mouse_resolution_multipliers = multipliers;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
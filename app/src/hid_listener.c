@@ -13,31 +13,46 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/events/keycode_state_changed.h>
 #include <zmk/events/modifiers_state_changed.h>
 #include <zmk/hid.h>
+#include <zmk/hid_listener.h>
 #include <dt-bindings/zmk/hid_usage_pages.h>
 #include <zmk/endpoints.h>
+#include <zmk/pipeline_stats.h>
+
+// Modifiers changed by a consumer key are only in the keyboard report, so both reports go out
+// together.
+static int send_reports(const struct zmk_keycode_state_changed *ev, bool mods_changed) {
+    if (ev->usage_page == HID_USAGE_CONSUMER && mods_changed) {
+        return zmk_endpoints_send_reports(ZMK_ENDPOINTS_REPORT_KEYBOARD |
+                                          ZMK_ENDPOINTS_REPORT_CONSUMER);
+    }
+
+    return zmk_endpoints_send_report(ev->usage_page);
+}
 
 static int hid_listener_keycode_pressed(const struct zmk_keycode_state_changed *ev) {
     int err, explicit_mods_changed, implicit_mods_changed;
 
     LOG_DBG("usage_page 0x%02X keycode 0x%02X implicit_mods 0x%02X explicit_mods 0x%02X",
             ev->usage_page, ev->keycode, ev->implicit_modifiers, ev->explicit_modifiers);
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+    zmk_endpoints_batch_prepare_change(ZMK_HID_USAGE(ev->usage_page, ev->keycode),
+                                       ev->implicit_modifiers != 0);
+#endif
+    // A modifier keycode and the modifiers that come with it are one change.
+    zmk_hid_modifiers_batch_begin();
     err = zmk_hid_press(ZMK_HID_USAGE(ev->usage_page, ev->keycode));
     if (err < 0) {
+        zmk_hid_modifiers_batch_end();
         LOG_DBG("Unable to press keycode");
         return err;
     }
+    zmk_pipeline_stats_keycode(ev->usage_page, ev->keycode, true);
     explicit_mods_changed = zmk_hid_register_mods(ev->explicit_modifiers);
-    implicit_mods_changed = zmk_hid_implicit_modifiers_press(ev->implicit_modifiers);
-    if (ev->usage_page != HID_USAGE_KEY &&
-        (explicit_mods_changed > 0 || implicit_mods_changed > 0)) {
-        err = zmk_endpoints_send_report(HID_USAGE_KEY);
-        if (err < 0) {
-            LOG_ERR("Failed to send key report for changed mofifiers for consumer page event (%d)",
-                    err);
-        }
-    }
+    implicit_mods_changed = zmk_hid_implicit_modifiers_press(
+        ZMK_HID_USAGE(ev->usage_page, ev->keycode), ev->implicit_modifiers);
+    zmk_hid_modifiers_batch_end();
 
-    return zmk_endpoints_send_report(ev->usage_page);
+    return send_reports(ev, explicit_mods_changed > 0 || implicit_mods_changed > 0);
 }
 
 static int hid_listener_keycode_released(const struct zmk_keycode_state_changed *ev) {
@@ -45,39 +60,39 @@ static int hid_listener_keycode_released(const struct zmk_keycode_state_changed
 
     LOG_DBG("usage_page 0x%02X keycode 0x%02X implicit_mods 0x%02X explicit_mods 0x%02X",
             ev->usage_page, ev->keycode, ev->implicit_modifiers, ev->explicit_modifiers);
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_BATCHING)
+    zmk_endpoints_batch_prepare_change(ZMK_HID_USAGE(ev->usage_page, ev->keycode),
+                                       ev->implicit_modifiers != 0);
+#endif
+    zmk_hid_modifiers_batch_begin();
     err = zmk_hid_release(ZMK_HID_USAGE(ev->usage_page, ev->keycode));
     if (err < 0) {
+        zmk_hid_modifiers_batch_end();
         LOG_DBG("Unable to release keycode");
         return err;
     }
+    zmk_pipeline_stats_keycode(ev->usage_page, ev->keycode, false);
 
     explicit_mods_changed = zmk_hid_unregister_mods(ev->explicit_modifiers);
-    // There is a minor issue with this code.
-    // If LC(A) is pressed, then LS(B), then LC(A) is released, the shift for B will be released
-    // prematurely. This causes if LS(B) to repeat like Bbbbbbbb when pressed for a long time.
-    // Solving this would require keeping track of which key's implicit modifiers are currently
-    // active and only releasing modifiers at that time.
-    implicit_mods_changed = zmk_hid_implicit_modifiers_release();
-    ;
-    if (ev->usage_page != HID_USAGE_KEY &&
-        (explicit_mods_changed > 0 || implicit_mods_changed > 0)) {
-        err = zmk_endpoints_send_report(HID_USAGE_KEY);
-        if (err < 0) {
-            LOG_ERR("Failed to send key report for changed mofifiers for consumer page event (%d)",
-                    err);
-        }
+    implicit_mods_changed =
+        zmk_hid_implicit_modifiers_release(ZMK_HID_USAGE(ev->usage_page, ev->keycode));
+    zmk_hid_modifiers_batch_end();
+
+    return send_reports(ev, explicit_mods_changed > 0 || implicit_mods_changed > 0);
+}
+
+int zmk_hid_listener_apply(const struct zmk_keycode_state_changed *ev) {
+    if (ev->state) {
+        return hid_listener_keycode_pressed(ev);
+    } else {
+        return hid_listener_keycode_released(ev);
     }
-    return zmk_endpoints_send_report(ev->usage_page);
 }
 
 int hid_listener(const zmk_event_t *eh) {
     const struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
     if (ev) {
-        if (ev->state) {
-            hid_listener_keycode_pressed(ev);
-        } else {
-            hid_listener_keycode_released(ev);
-        }
+        zmk_hid_listener_apply(ev);
     }
     return 0;
 }
@@ -6,6 +6,8 @@
 
 #include <settings/settings.h>
 #include <init.h>
+#include <string.h>
+#include <sys/atomic.h>
 
 #include <logging/log.h>
 
@@ -14,9 +16,17 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/gatt.h>
 
+#include <zmk/boot_profile.h>
+#include <zmk/energy_stats.h>
 #include <zmk/ble.h>
+#include <zmk/endpoints.h>
 #include <zmk/hog.h>
 #include <zmk/hid.h>
+#include <zmk/hot_path_trace.h>
+#include <zmk/memory_stats.h>
+#include <zmk/trace_pins.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
 
 enum {
     HIDS_REMOTE_WAKE = BIT(0),
@@ -56,6 +66,18 @@ static struct hids_report consumer_input = {
     .type = HIDS_INPUT,
 };
 
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+static struct hids_report mouse_input = {
+    .id = ZMK_HID_REPORT_ID_MOUSE,
+    .type = HIDS_INPUT,
+};
+
+static struct hids_report mouse_feature = {
+    .id = ZMK_HID_REPORT_ID_MOUSE,
+    .type = HIDS_FEATURE,
+};
+#endif
+
 static bool host_requests_notification = false;
 static uint8_t ctrl_point;
 // static uint8_t proto_mode;
@@ -93,6 +115,37 @@ static ssize_t read_hids_consumer_input_report(struct bt_conn *conn,
                              sizeof(struct zmk_hid_consumer_report_body));
 }
 
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+static ssize_t read_hids_mouse_input_report(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                            void *buf, uint16_t len, uint16_t offset) {
+    // Motion is only taken for notifications, so a read reports the buttons without any.
+    struct zmk_hid_mouse_report_body report_body = {.buttons = zmk_hid_mouse_get_buttons()};
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &report_body, sizeof(report_body));
+}
+
+static ssize_t read_hids_mouse_feature_report(struct bt_conn *conn,
+                                              const struct bt_gatt_attr *attr, void *buf,
+                                              uint16_t len, uint16_t offset) {
+    uint8_t multipliers = zmk_hid_mouse_get_resolution_multipliers();
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &multipliers, sizeof(multipliers));
+}
+
+static ssize_t write_hids_mouse_feature_report(struct bt_conn *conn,
+                                               const struct bt_gatt_attr *attr, const void *buf,
+                                               uint16_t len, uint16_t offset, uint8_t flags) {
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    if (len != sizeof(uint8_t)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    zmk_hid_mouse_set_resolution_multipliers(*(const uint8_t *)buf);
+    return len;
+}
+#endif
+
 // static ssize_t write_proto_mode(struct bt_conn *conn,
 //                                 const struct bt_gatt_attr *attr,
 //                                 const void *buf, uint16_t len, uint16_t offset,
@@ -139,6 +192,18 @@ BT_GATT_SERVICE_DEFINE(
     BT_GATT_CCC(input_ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
     BT_GATT_DESCRIPTOR(BT_UUID_HIDS_REPORT_REF, BT_GATT_PERM_READ_ENCRYPT, read_hids_report_ref,
                        NULL, &consumer_input),
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ_ENCRYPT, read_hids_mouse_input_report, NULL, NULL),
+    BT_GATT_CCC(input_ccc_changed, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+    BT_GATT_DESCRIPTOR(BT_UUID_HIDS_REPORT_REF, BT_GATT_PERM_READ_ENCRYPT, read_hids_report_ref,
+                       NULL, &mouse_input),
+    BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_REPORT, BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT,
+                           read_hids_mouse_feature_report, write_hids_mouse_feature_report, NULL),
+    BT_GATT_DESCRIPTOR(BT_UUID_HIDS_REPORT_REF, BT_GATT_PERM_READ_ENCRYPT, read_hids_report_ref,
+                       NULL, &mouse_feature),
+#endif
     BT_GATT_CHARACTERISTIC(BT_UUID_HIDS_CTRL_POINT, BT_GATT_CHRC_WRITE_WITHOUT_RESP,
                            BT_GATT_PERM_WRITE, NULL, write_ctrl_point, &ctrl_point));
 
@@ -157,19 +222,243 @@ struct bt_conn *destination_connection() {
     return conn;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_HID_REPORT_TYPE_NKRO)
+// The default ATT MTU of 23 leaves 20 bytes for a notification. The NKRO bitmap stops at
+// CONFIG_ZMK_HID_KEYBOARD_NKRO_MAX_USAGE so the whole report still goes out as one notification,
+// which also fits one 27-byte link layer PDU, without waiting for an MTU exchange or a 6KRO
+// fallback.
+BUILD_ASSERT(sizeof(struct zmk_hid_keyboard_report_body) <= 20,
+             "NKRO keyboard reports must fit in a single notification at the default ATT MTU");
+#endif
+
+#if !IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
 K_THREAD_STACK_DEFINE(hog_q_stack, CONFIG_ZMK_BLE_THREAD_STACK_SIZE);
 
-struct k_work_q hog_work_q;
+static struct k_work_q hog_own_work_q;
+#endif
+
+static struct k_work_q *hog_work_q;
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_REPORT_COALESCING)
+
+// Keyboard reports waiting to be notified. A new report replaces the newest queued one whenever the
+// state in between can be skipped without losing a press or release, so a congested link only
+// builds up the reports the host really needs.
+static struct zmk_hid_keyboard_report_body
+    keyboard_queue[CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE];
+static uint16_t keyboard_queue_head;
+static uint16_t keyboard_queue_len;
+// The report taken from the queue last, which the host already has or is about to get.
+static struct zmk_hid_keyboard_report_body keyboard_last_taken;
+static struct k_spinlock keyboard_queue_lock;
+
+static struct zmk_hid_keyboard_report_body *keyboard_queue_at(uint16_t index) {
+    return &keyboard_queue[(keyboard_queue_head + index) %
+                           CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE];
+}
+
+static bool take_keyboard_report(struct zmk_hid_keyboard_report_body *report) {
+    k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+    bool taken = keyboard_queue_len > 0;
+    if (taken) {
+        *report = *keyboard_queue_at(0);
+        keyboard_last_taken = *report;
+        keyboard_queue_head = (keyboard_queue_head + 1) % CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE;
+        keyboard_queue_len--;
+    }
+    k_spin_unlock(&keyboard_queue_lock, key);
+    return taken;
+}
+
+static int queue_keyboard_report(const struct zmk_hid_keyboard_report_body *report) {
+    k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+
+    if (keyboard_queue_len > 0) {
+        struct zmk_hid_keyboard_report_body *queued = keyboard_queue_at(keyboard_queue_len - 1);
+        const struct zmk_hid_keyboard_report_body *before =
+            keyboard_queue_len > 1 ? keyboard_queue_at(keyboard_queue_len - 2)
+                                   : &keyboard_last_taken;
+        if (zmk_hid_keyboard_report_can_skip(before, queued, report)) {
+            *queued = *report;
+            k_spin_unlock(&keyboard_queue_lock, key);
+            return 0;
+        }
+    }
+
+    if (keyboard_queue_len == CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE) {
+        LOG_WRN("Keyboard report queue full, dropping the oldest report");
+        keyboard_last_taken = *keyboard_queue_at(0);
+        keyboard_queue_head = (keyboard_queue_head + 1) % CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE;
+        keyboard_queue_len--;
+    }
+
+    *keyboard_queue_at(keyboard_queue_len++) = *report;
+    zmk_memory_stats_queue_used(ZMK_MEMORY_QUEUE_HOG_KEYBOARD, keyboard_queue_len,
+                                CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE);
+    k_spin_unlock(&keyboard_queue_lock, key);
+    return 0;
+}
+
+#else
 
 K_MSGQ_DEFINE(zmk_hog_keyboard_msgq, sizeof(struct zmk_hid_keyboard_report_body),
               CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE, 4);
 
+static bool take_keyboard_report(struct zmk_hid_keyboard_report_body *report) {
+    return k_msgq_get(&zmk_hog_keyboard_msgq, report, K_NO_WAIT) == 0;
+}
+
+static int queue_keyboard_report(const struct zmk_hid_keyboard_report_body *report) {
+    int err = k_msgq_put(&zmk_hog_keyboard_msgq, report, K_MSEC(100));
+    if (err) {
+        switch (err) {
+        case -EAGAIN: {
+            LOG_WRN("Keyboard message queue full, popping first message and queueing again");
+            struct zmk_hid_keyboard_report_body discarded_report;
+            k_msgq_get(&zmk_hog_keyboard_msgq, &discarded_report, K_NO_WAIT);
+            return queue_keyboard_report(report);
+        }
+        default:
+            LOG_WRN("Failed to queue keyboard report to send (%d)", err);
+            return err;
+        }
+    }
+
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_HOG_KEYBOARD, &zmk_hog_keyboard_msgq);
+
+    return 0;
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_REPORT_COALESCING) */
+
+#if CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS > 0
+// While the active profile's host is reconnecting, the first report that can't be sent is held
+// here and the ones after it stay queued, so the keys that woke the keyboard still reach the host.
+// Reports still waiting when the hold time runs out are dropped, so a host that only comes back
+// much later doesn't receive stale keystrokes. Only touched from the HOG work queue.
+static struct zmk_hid_keyboard_report_body held_keyboard_report;
+static bool keyboard_report_held;
+static struct zmk_hid_consumer_report_body held_consumer_report;
+static bool consumer_report_held;
+static struct k_work_delayable hold_expiry_work;
+
+static struct bt_conn *report_connection() {
+    struct bt_conn *conn = destination_connection();
+
+    // Notifications only reach a bonded host once the link is encrypted again.
+    if (conn != NULL && bt_conn_get_security(conn) < BT_SECURITY_L2) {
+        LOG_DBG("Holding reports until the connection is encrypted");
+        bt_conn_unref(conn);
+        return NULL;
+    }
+
+    return conn;
+}
+
+static void start_holding_reports() {
+    // Doesn't restart a running timer, so the hold time counts from the first held report.
+    k_work_schedule_for_queue(hog_work_q, &hold_expiry_work,
+                              K_MSEC(CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS));
+}
+
+static void stop_holding_reports() { k_work_cancel_delayable(&hold_expiry_work); }
+
+static bool take_held_keyboard_report(struct zmk_hid_keyboard_report_body *report) {
+    if (!keyboard_report_held) {
+        return false;
+    }
+
+    *report = held_keyboard_report;
+    keyboard_report_held = false;
+    return true;
+}
+
+static void hold_keyboard_report(const struct zmk_hid_keyboard_report_body *report) {
+    held_keyboard_report = *report;
+    keyboard_report_held = true;
+    start_holding_reports();
+}
+
+static bool take_held_consumer_report(struct zmk_hid_consumer_report_body *report) {
+    if (!consumer_report_held) {
+        return false;
+    }
+
+    *report = held_consumer_report;
+    consumer_report_held = false;
+    return true;
+}
+
+static void hold_consumer_report(const struct zmk_hid_consumer_report_body *report) {
+    held_consumer_report = *report;
+    consumer_report_held = true;
+    start_holding_reports();
+}
+
+#else
+
+#define report_connection() destination_connection()
+#define stop_holding_reports()
+#define take_held_keyboard_report(report) false
+#define hold_keyboard_report(report)
+#define take_held_consumer_report(report) false
+#define hold_consumer_report(report)
+
+#endif /* CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS > 0 */
+
+// Marks the report leaving the controller. Only registered when trace pins are enabled.
+static void report_notified(struct bt_conn *conn, void *user_data) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_NOTIFY);
+}
+
+void send_keyboard_report_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(send_keyboard_report_callback)
+K_WORK_DEFINE(hog_keyboard_work, ZMK_WORK_WATCHED(send_keyboard_report_callback));
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_NOTIFY_PACING)
+// Set while a keyboard notification waits for the controller to send it, which it does on the
+// next connection event. Reports keep merging in the queue meanwhile.
+static atomic_t keyboard_notify_in_flight;
+
+static void keyboard_report_notified(struct bt_conn *conn, void *user_data) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_NOTIFY);
+    atomic_set(&keyboard_notify_in_flight, false);
+    k_work_submit_to_queue(hog_work_q, &hog_keyboard_work);
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    zmk_endpoints_reports_delivered();
+#endif
+}
+
+// A notification dropped with its connection never completes, so don't wait for it.
+static void pacing_disconnected(struct bt_conn *conn, uint8_t reason) {
+    atomic_set(&keyboard_notify_in_flight, false);
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    zmk_endpoints_reports_delivered();
+#endif
+}
+
+static struct bt_conn_cb pacing_conn_callbacks = {
+    .disconnected = pacing_disconnected,
+};
+
+#define keyboard_notify_allowed() !atomic_get(&keyboard_notify_in_flight)
+#define KEYBOARD_NOTIFIED_FUNC keyboard_report_notified
+#else
+#define keyboard_notify_allowed() true
+#define KEYBOARD_NOTIFIED_FUNC (IS_ENABLED(CONFIG_ZMK_TRACE_PINS) ? report_notified : NULL)
+#endif
+
+// bt_gatt_notify_cb() copies the report into its own buffer before returning, so reports are sent
+// straight from the stack, and the connection is only looked up once for all the queued ones.
 void send_keyboard_report_callback(struct k_work *work) {
     struct zmk_hid_keyboard_report_body report;
+    struct bt_conn *conn = NULL;
 
-    while (k_msgq_get(&zmk_hog_keyboard_msgq, &report, K_NO_WAIT) == 0) {
-        struct bt_conn *conn = destination_connection();
-        if (conn == NULL) {
+    while (keyboard_notify_allowed() &&
+           (take_held_keyboard_report(&report) || take_keyboard_report(&report))) {
+        if (conn == NULL && (conn = report_connection()) == NULL) {
+            hold_keyboard_report(&report);
             return;
         }
 
@@ -177,36 +466,38 @@ void send_keyboard_report_callback(struct k_work *work) {
             .attr = &hog_svc.attrs[5],
             .data = &report,
             .len = sizeof(report),
+            .func = KEYBOARD_NOTIFIED_FUNC,
         };
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_NOTIFY_PACING)
+        atomic_set(&keyboard_notify_in_flight, true);
+#endif
+
+        zmk_energy_stats_count(ZMK_ENERGY_HID_NOTIFY);
         int err = bt_gatt_notify_cb(conn, &notify_params);
+        zmk_hot_path_trace(ZMK_HOT_PATH_HOG_SEND, NULL, err, 0);
         if (err) {
             LOG_ERR("Error notifying %d", err);
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_NOTIFY_PACING)
+            atomic_set(&keyboard_notify_in_flight, false);
+#endif
         }
 
+        stop_holding_reports();
+    }
+
+    if (conn != NULL) {
         bt_conn_unref(conn);
     }
 }
 
-K_WORK_DEFINE(hog_keyboard_work, send_keyboard_report_callback);
-
 int zmk_hog_send_keyboard_report(struct zmk_hid_keyboard_report_body *report) {
-    int err = k_msgq_put(&zmk_hog_keyboard_msgq, report, K_MSEC(100));
+    int err = queue_keyboard_report(report);
     if (err) {
-        switch (err) {
-        case -EAGAIN: {
-            LOG_WRN("Keyboard message queue full, popping first message and queueing again");
-            struct zmk_hid_keyboard_report_body discarded_report;
-            k_msgq_get(&zmk_hog_keyboard_msgq, &discarded_report, K_NO_WAIT);
-            return zmk_hog_send_keyboard_report(report);
-        }
-        default:
-            LOG_WRN("Failed to queue keyboard report to send (%d)", err);
-            return err;
-        }
+        return err;
     }
 
-    k_work_submit_to_queue(&hog_work_q, &hog_keyboard_work);
+    k_work_submit_to_queue(hog_work_q, &hog_keyboard_work);
 
     return 0;
 };
@@ -216,10 +507,12 @@ K_MSGQ_DEFINE(zmk_hog_consumer_msgq, sizeof(struct zmk_hid_consumer_report_body)
 
 void send_consumer_report_callback(struct k_work *work) {
     struct zmk_hid_consumer_report_body report;
+    struct bt_conn *conn = NULL;
 
-    while (k_msgq_get(&zmk_hog_consumer_msgq, &report, K_NO_WAIT) == 0) {
-        struct bt_conn *conn = destination_connection();
-        if (conn == NULL) {
+    while (take_held_consumer_report(&report) ||
+           k_msgq_get(&zmk_hog_consumer_msgq, &report, K_NO_WAIT) == 0) {
+        if (conn == NULL && (conn = report_connection()) == NULL) {
+            hold_consumer_report(&report);
             return;
         }
 
@@ -227,18 +520,31 @@ void send_consumer_report_callback(struct k_work *work) {
             .attr = &hog_svc.attrs[10],
             .data = &report,
             .len = sizeof(report),
+            .func = IS_ENABLED(CONFIG_ZMK_TRACE_PINS) ? report_notified : NULL,
         };
 
+        zmk_energy_stats_count(ZMK_ENERGY_HID_NOTIFY);
         int err = bt_gatt_notify_cb(conn, &notify_params);
+        zmk_hot_path_trace(ZMK_HOT_PATH_HOG_SEND, NULL, err, 1);
         if (err) {
             LOG_DBG("Error notifying %d", err);
         }
 
+        stop_holding_reports();
+    }
+
+    if (conn != NULL) {
         bt_conn_unref(conn);
     }
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    // Consumer reports aren't paced, so they count as delivered once the controller has them.
+    zmk_endpoints_reports_delivered();
+#endif
 };
 
-K_WORK_DEFINE(hog_consumer_work, send_consumer_report_callback);
+ZMK_WORK_WATCHDOG_WRAP(send_consumer_report_callback)
+K_WORK_DEFINE(hog_consumer_work, ZMK_WORK_WATCHED(send_consumer_report_callback));
 
 int zmk_hog_send_consumer_report(struct zmk_hid_consumer_report_body *report) {
     int err = k_msgq_put(&zmk_hog_consumer_msgq, report, K_MSEC(100));
@@ -256,17 +562,138 @@ int zmk_hog_send_consumer_report(struct zmk_hid_consumer_report_body *report) {
         }
     }
 
-    k_work_submit_to_queue(&hog_work_q, &hog_consumer_work);
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_HOG_CONSUMER, &zmk_hog_consumer_msgq);
+
+    k_work_submit_to_queue(hog_work_q, &hog_consumer_work);
 
     return 0;
 };
 
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+bool zmk_hog_reports_pending() {
+    k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+    bool pending = keyboard_queue_len > 0;
+    k_spin_unlock(&keyboard_queue_lock, key);
+
+    return pending || atomic_get(&keyboard_notify_in_flight) ||
+           k_msgq_num_used_get(&zmk_hog_consumer_msgq) > 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+// Set while a mouse notification waits for the controller to send it. Motion keeps accumulating
+// meanwhile and is sent once the notification completes.
+static atomic_t mouse_notify_in_flight;
+
+static void send_mouse_report_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(send_mouse_report_callback)
+K_WORK_DEFINE(hog_mouse_work, ZMK_WORK_WATCHED(send_mouse_report_callback));
+
+static void mouse_report_notified(struct bt_conn *conn, void *user_data) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_NOTIFY);
+    atomic_set(&mouse_notify_in_flight, false);
+    k_work_submit_to_queue(hog_work_q, &hog_mouse_work);
+}
+
+static void send_mouse_report_callback(struct k_work *work) {
+    struct zmk_hid_mouse_report report;
+
+    if (atomic_get(&mouse_notify_in_flight)) {
+        return;
+    }
+
+    struct bt_conn *conn = report_connection();
+    if (conn == NULL) {
+        return;
+    }
+
+    if (!zmk_hid_mouse_take_report(&report)) {
+        bt_conn_unref(conn);
+        return;
+    }
+
+    struct bt_gatt_notify_params notify_params = {
+        .attr = &hog_svc.attrs[13],
+        .data = &report.body,
+        .len = sizeof(report.body),
+        .func = mouse_report_notified,
+    };
+
+    atomic_set(&mouse_notify_in_flight, true);
+
+    zmk_energy_stats_count(ZMK_ENERGY_HID_NOTIFY);
+    int err = bt_gatt_notify_cb(conn, &notify_params);
+    zmk_hot_path_trace(ZMK_HOT_PATH_HOG_SEND, NULL, err, 2);
+    if (err) {
+        LOG_DBG("Error notifying %d", err);
+        atomic_set(&mouse_notify_in_flight, false);
+
+        // Keep the pointer motion for the next report rather than losing it.
+        zmk_hid_mouse_movement_add(report.body.d_x, report.body.d_y);
+    }
+
+    bt_conn_unref(conn);
+}
+
+int zmk_hog_send_mouse_report() {
+    k_work_submit_to_queue(hog_work_q, &hog_mouse_work);
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
+
+#if CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS > 0
+static void hold_expiry_callback(struct k_work *work) {
+    struct zmk_hid_keyboard_report_body keyboard_report;
+
+    LOG_WRN("Host didn't reconnect in time, dropping held reports");
+
+    keyboard_report_held = false;
+    while (take_keyboard_report(&keyboard_report)) {
+    }
+
+    consumer_report_held = false;
+    k_msgq_purge(&zmk_hog_consumer_msgq);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(hold_expiry_callback)
+
+static void hog_security_changed(struct bt_conn *conn, bt_security_t level,
+                                 enum bt_security_err err) {
+    if (err) {
+        return;
+    }
+
+    // Send whatever was held while the host reconnected.
+    k_work_submit_to_queue(hog_work_q, &hog_keyboard_work);
+    k_work_submit_to_queue(hog_work_q, &hog_consumer_work);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+    .security_changed = hog_security_changed,
+};
+#endif /* CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS > 0 */
+
 int zmk_hog_init(const struct device *_arg) {
+#if IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
+    hog_work_q = zmk_ble_tx_work_q();
+#else
     static const struct k_work_queue_config queue_config = {.name = "HID Over GATT Send Work"};
-    k_work_queue_start(&hog_work_q, hog_q_stack, K_THREAD_STACK_SIZEOF(hog_q_stack),
+    k_work_queue_start(&hog_own_work_q, hog_q_stack, K_THREAD_STACK_SIZEOF(hog_q_stack),
                        CONFIG_ZMK_BLE_THREAD_PRIORITY, &queue_config);
+    hog_work_q = &hog_own_work_q;
+#endif
+
+#if CONFIG_ZMK_BLE_RECONNECT_REPORT_HOLD_MS > 0
+    k_work_init_delayable(&hold_expiry_work, ZMK_WORK_WATCHED(hold_expiry_callback));
+    bt_conn_cb_register(&conn_callbacks);
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_KEYBOARD_NOTIFY_PACING)
+    bt_conn_cb_register(&pacing_conn_callbacks);
+#endif
 
     return 0;
 }
 
-SYS_INIT(zmk_hog_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_hog_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <kernel.h>
+#include <shell/shell.h>
+#include <spinlock.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/hot_path_trace.h>
+
+#define NO_DEVICE UINT16_MAX
+
+static const char *const id_names[] = {
+    [ZMK_HOT_PATH_KSCAN] = "kscan",
+    [ZMK_HOT_PATH_KEYMAP_BINDING] = "keymap_binding",
+    [ZMK_HOT_PATH_BEHAVIOR_QUEUE] = "behavior_queue",
+    [ZMK_HOT_PATH_HOG_SEND] = "hog_send",
+    [ZMK_HOT_PATH_SPLIT_SEND] = "split_send",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(id_names) == ZMK_HOT_PATH_ID_COUNT, "Every hot path id needs a name");
+
+struct hot_path_record {
+    uint32_t cycles;
+    uint32_t arg;
+    uint16_t device;
+    uint8_t id;
+    uint8_t state;
+};
+
+static struct hot_path_record records[CONFIG_ZMK_HOT_PATH_TRACE_SIZE];
+// Free-running count of written records, record i is in slot (i % size).
+static uint32_t written;
+
+static struct k_spinlock lock;
+
+atomic_t zmk_hot_path_trace_enabled;
+
+static uint16_t device_index(const struct device *dev) {
+    const struct device *devices;
+    size_t count = z_device_get_all_static(&devices);
+
+    if (dev == NULL || dev < devices || dev >= devices + count) {
+        return NO_DEVICE;
+    }
+
+    return dev - devices;
+}
+
+void zmk_hot_path_trace_write(enum zmk_hot_path_id id, const struct device *dev, uint32_t arg,
+                              uint8_t state) {
+    struct hot_path_record record = {
+        .cycles = k_cycle_get_32(),
+        .arg = arg,
+        .device = device_index(dev),
+        .id = id,
+        .state = state,
+    };
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    records[written++ % ARRAY_SIZE(records)] = record;
+    k_spin_unlock(&lock, key);
+}
+
+static int cmd_on(const struct shell *sh, size_t argc, char **argv) {
+    atomic_set(&zmk_hot_path_trace_enabled, true);
+    shell_print(sh, "Hot path tracing on");
+    return 0;
+}
+
+static int cmd_off(const struct shell *sh, size_t argc, char **argv) {
+    atomic_set(&zmk_hot_path_trace_enabled, false);
+    shell_print(sh, "Hot path tracing off");
+    return 0;
+}
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    written = 0;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Hot path trace cleared");
+    return 0;
+}
+
+// Names are only looked up here, so tracing costs a copy of the fixed size record. Times are
+// relative to the oldest record shown.
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv) {
+    if (atomic_get(&zmk_hot_path_trace_enabled)) {
+        shell_error(sh, "Turn tracing off before dumping the trace");
+        return -EBUSY;
+    }
+
+    const struct device *devices;
+    z_device_get_all_static(&devices);
+
+    uint32_t start = written > ARRAY_SIZE(records) ? written - ARRAY_SIZE(records) : 0;
+    uint32_t first_cycles = records[start % ARRAY_SIZE(records)].cycles;
+
+    for (uint32_t i = start; i < written; i++) {
+        const struct hot_path_record *record = &records[i % ARRAY_SIZE(records)];
+
+        shell_print(sh, "t=%u id=%s dev=%s arg=0x%08x state=%u",
+                    k_cyc_to_us_floor32(record->cycles - first_cycles), id_names[record->id],
+                    record->device == NO_DEVICE ? "-" : devices[record->device].name, record->arg,
+                    record->state);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_hotpath, SHELL_CMD(on, NULL, "Start tracing", cmd_on),
+                               SHELL_CMD(off, NULL, "Stop tracing", cmd_off),
+                               SHELL_CMD(dump, NULL, "Print the trace", cmd_dump),
+                               SHELL_CMD(clear, NULL, "Clear the trace", cmd_clear),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(hotpath, &sub_hotpath, "ZMK key path trace commands", NULL);
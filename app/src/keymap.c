@@ -4,41 +4,126 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
 #include <sys/util.h>
+#include <init.h>
+#include <settings/settings.h>
 #include <bluetooth/bluetooth.h>
 #include <logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/matrix.h>
 #include <zmk/sensors.h>
 #include <zmk/keymap.h>
+#include <zmk/flight_recorder.h>
+#include <zmk/hot_path_trace.h>
+#include <zmk/settings.h>
 #include <drivers/behavior.h>
 #include <zmk/behavior.h>
 
 #include <zmk/ble.h>
 #if ZMK_BLE_IS_CENTRAL
 #include <zmk/split/bluetooth/central.h>
+#define SPLIT_PERIPHERAL_COUNT ZMK_BLE_SPLIT_PERIPHERAL_COUNT
+#define split_invoke_behavior zmk_split_bt_invoke_behavior
+#elif IS_ENABLED(CONFIG_ZMK_SPLIT_WIRED) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#include <zmk/split/wired/central.h>
+#define SPLIT_PERIPHERAL_COUNT ZMK_SPLIT_WIRED_PERIPHERAL_COUNT
+#define split_invoke_behavior zmk_split_wired_invoke_behavior
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_EVENT_SOURCE_BEHAVIORS)
+#include <zmk/split/event_source.h>
+
+// Peripherals run event source behaviors from the first profile, without knowing which is active.
+BUILD_ASSERT(ZMK_KEYMAP_PROFILES_LEN == 1,
+             "Keymap profiles can't be used with event source behaviors run on peripherals");
 #endif
 
 #include <zmk/event_manager.h>
 #include <zmk/events/position_state_changed.h>
 #include <zmk/events/layer_state_changed.h>
+#include <zmk/events/keymap_profile_changed.h>
 #include <zmk/events/sensor_event.h>
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_INLINE_CORE_BEHAVIORS)
+#include <zmk/events/keycode_state_changed.h>
+#endif
+
 static zmk_keymap_layers_state_t _zmk_keymap_layer_state = 0;
 static uint8_t _zmk_keymap_layer_default = 0;
 
 #define DT_DRV_COMPAT zmk_keymap
 
-#define LAYER_CHILD_LEN(node) 1 +
 #define ZMK_KEYMAP_NODE DT_DRV_INST(0)
-#define ZMK_KEYMAP_LAYERS_LEN (DT_INST_FOREACH_CHILD(0, LAYER_CHILD_LEN) 0)
 
 #define BINDING_WITH_COMMA(idx, drv_inst) ZMK_KEYMAP_EXTRACT_BINDING(idx, drv_inst),
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE)
+
+#if ZMK_KEYMAP_LEN > 256
+#error "CONFIG_ZMK_KEYMAP_SPARSE supports at most 256 key positions"
+#endif
+
+#define IS_TRANSPARENT_BINDING(idx, node)                                                          \
+    DT_NODE_HAS_COMPAT(DT_PHANDLE_BY_IDX(node, bindings, idx), zmk_behavior_transparent)
+
+#define SPARSE_BINDING(idx, node)                                                                  \
+    COND_CODE_1(IS_TRANSPARENT_BINDING(idx, node), (), (ZMK_KEYMAP_EXTRACT_BINDING(idx, node), ))
+
+#define SPARSE_PRESENT_BIT(idx, node, word)                                                        \
+    COND_CODE_1(IS_TRANSPARENT_BINDING(idx, node), (),                                             \
+                (| ((idx) / 32 == (word) ? BIT((idx) % 32) : 0)))
+
+#define SPARSE_WORD(node, word)                                                                    \
+    (0 UTIL_LISTIFY(DT_PROP_LEN(node, bindings), SPARSE_PRESENT_BIT, node, word))
+
+// The preprocessor can't count the words, so each length gets its own list.
+#define SPARSE_WORDS_1(node) SPARSE_WORD(node, 0)
+#define SPARSE_WORDS_2(node) SPARSE_WORDS_1(node), SPARSE_WORD(node, 1)
+#define SPARSE_WORDS_3(node) SPARSE_WORDS_2(node), SPARSE_WORD(node, 2)
+#define SPARSE_WORDS_4(node) SPARSE_WORDS_3(node), SPARSE_WORD(node, 3)
+#define SPARSE_WORDS_5(node) SPARSE_WORDS_4(node), SPARSE_WORD(node, 4)
+#define SPARSE_WORDS_6(node) SPARSE_WORDS_5(node), SPARSE_WORD(node, 5)
+#define SPARSE_WORDS_7(node) SPARSE_WORDS_6(node), SPARSE_WORD(node, 6)
+#define SPARSE_WORDS_8(node) SPARSE_WORDS_7(node), SPARSE_WORD(node, 7)
+
+#if ZMK_KEYMAP_LEN <= 32
+#define SPARSE_WORDS_LEN 1
+#elif ZMK_KEYMAP_LEN <= 64
+#define SPARSE_WORDS_LEN 2
+#elif ZMK_KEYMAP_LEN <= 96
+#define SPARSE_WORDS_LEN 3
+#elif ZMK_KEYMAP_LEN <= 128
+#define SPARSE_WORDS_LEN 4
+#elif ZMK_KEYMAP_LEN <= 160
+#define SPARSE_WORDS_LEN 5
+#elif ZMK_KEYMAP_LEN <= 192
+#define SPARSE_WORDS_LEN 6
+#elif ZMK_KEYMAP_LEN <= 224
+#define SPARSE_WORDS_LEN 7
+#else
+#define SPARSE_WORDS_LEN 8
+#endif
+
+#define LAYER_TABLES(node)                                                                         \
+    static const struct zmk_keymap_compact_binding UTIL_CAT(sparse_bindings_, node)[] = {          \
+        UTIL_LISTIFY(DT_PROP_LEN(node, bindings), SPARSE_BINDING, node)};
+
+#define TRANSFORMED_LAYER(node)                                                                    \
+    {.present = {UTIL_CAT(SPARSE_WORDS_, SPARSE_WORDS_LEN)(node)},                                 \
+     .bindings = UTIL_CAT(sparse_bindings_, node)},
+
+#else
+
+#define LAYER_TABLES(node)
+
 #define TRANSFORMED_LAYER(node)                                                                    \
     {UTIL_LISTIFY(DT_PROP_LEN(node, bindings), BINDING_WITH_COMMA, node)},
 
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE) */
+
 #if ZMK_KEYMAP_HAS_SENSORS
 #define _TRANSFORM_SENSOR_ENTRY(idx, layer)                                                        \
     {                                                                                              \
@@ -61,25 +146,752 @@ static uint8_t _zmk_keymap_layer_default = 0;
 
 // State
 
-// When a behavior handles a key position "down" event, we record the layer state
-// here so that even if that layer is deactivated before the "up", event, we
-// still send the release event to the behavior in that layer also.
-static uint32_t zmk_keymap_active_behavior_layer[ZMK_KEYMAP_LEN];
+// When a behavior handles a key position "down" event, we record the binding, with its params
+// already converted, and its layer here. The "up" event then goes straight to the same binding,
+// even if the layers or the keymap changed in between.
+static struct {
+    struct zmk_behavior_binding binding;
+    uint8_t layer;
+} zmk_keymap_pressed_bindings[ZMK_KEYMAP_LEN];
 
-static struct zmk_behavior_binding zmk_keymap[ZMK_KEYMAP_LAYERS_LEN][ZMK_KEYMAP_LEN] = {
-    DT_INST_FOREACH_CHILD(0, TRANSFORMED_LAYER)};
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_COMPACT)
 
-static const char *zmk_keymap_layer_names[ZMK_KEYMAP_LAYERS_LEN] = {
-    DT_INST_FOREACH_CHILD(0, LAYER_LABEL)};
+// The same as struct zmk_behavior_binding minus the resolved device, so the keymap can live in
+// flash. Devices are looked up through compact_behaviors instead.
+struct zmk_keymap_compact_binding {
+    char *behavior_dev;
+    uint32_t param1;
+    uint32_t param2;
+};
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE)
 
+// A layer without its &trans bindings, which are most of the bindings of many layers.
+struct zmk_keymap_sparse_layer {
+    // Bit (position % 32) of word (position / 32) is set for each position with a binding.
+    uint32_t present[SPARSE_WORDS_LEN];
+    // The bindings of the positions in present, in order.
+    const struct zmk_keymap_compact_binding *bindings;
+};
+
+typedef const struct zmk_keymap_sparse_layer keymap_layers_t[ZMK_KEYMAP_LAYERS_LEN];
+
+#else
+
+typedef const struct zmk_keymap_compact_binding keymap_layers_t[ZMK_KEYMAP_LAYERS_LEN]
+                                                                [ZMK_KEYMAP_LEN];
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE) */
+
+#else
+
+typedef struct zmk_behavior_binding keymap_layers_t[ZMK_KEYMAP_LAYERS_LEN][ZMK_KEYMAP_LEN];
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_COMPACT) */
+
+#if ZMK_KEYMAP_HAS_SENSORS
+typedef struct zmk_behavior_binding sensor_layers_t[ZMK_KEYMAP_LAYERS_LEN][ZMK_KEYMAP_SENSORS_LEN];
+#endif
+
+// A complete keymap. The first profile is the keymap node itself, and the ones in its `profiles`
+// property follow. They all have the same layers and positions, so switching profiles only swaps
+// active_profile and the layer state carries over.
+struct keymap_profile {
+    keymap_layers_t *layers;
+    const char *const *layer_names;
 #if ZMK_KEYMAP_HAS_SENSORS
+    sensor_layers_t *sensor_layers;
+#endif
+};
+
+DT_INST_FOREACH_CHILD(0, LAYER_TABLES)
 
-static struct zmk_behavior_binding zmk_sensor_keymap[ZMK_KEYMAP_LAYERS_LEN]
-                                                    [ZMK_KEYMAP_SENSORS_LEN] = {
-                                                        DT_INST_FOREACH_CHILD(0, SENSOR_LAYER)};
+static keymap_layers_t zmk_keymap = {DT_INST_FOREACH_CHILD(0, TRANSFORMED_LAYER)};
 
+static const char *const zmk_keymap_layer_names[ZMK_KEYMAP_LAYERS_LEN] = {
+    DT_INST_FOREACH_CHILD(0, LAYER_LABEL)};
+
+#if ZMK_KEYMAP_HAS_SENSORS
+static sensor_layers_t zmk_sensor_keymap = {DT_INST_FOREACH_CHILD(0, SENSOR_LAYER)};
+
+#define PROFILE_SENSOR_TABLE(node)                                                                 \
+    static sensor_layers_t UTIL_CAT(sensor_keymap_, node) = {DT_FOREACH_CHILD(node, SENSOR_LAYER)};
+#define PROFILE_SENSOR_LAYERS(node) .sensor_layers = &UTIL_CAT(sensor_keymap_, node),
+#else
+#define PROFILE_SENSOR_TABLE(node)
+#define PROFILE_SENSOR_LAYERS(node)
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
 
+#define PROFILE_TABLES(node)                                                                       \
+    BUILD_ASSERT((DT_FOREACH_CHILD(node, ZMK_KEYMAP_LAYER_CHILD_LEN) 0) == ZMK_KEYMAP_LAYERS_LEN,  \
+                 "Every keymap profile needs as many layers as the keymap");                       \
+    DT_FOREACH_CHILD(node, LAYER_TABLES)                                                           \
+    static keymap_layers_t UTIL_CAT(keymap_, node) = {DT_FOREACH_CHILD(node, TRANSFORMED_LAYER)};  \
+    static const char *const UTIL_CAT(layer_names_, node)[ZMK_KEYMAP_LAYERS_LEN] = {               \
+        DT_FOREACH_CHILD(node, LAYER_LABEL)};                                                      \
+    PROFILE_SENSOR_TABLE(node)
+
+DT_FOREACH_STATUS_OKAY(zmk_keymap_profile, PROFILE_TABLES)
+
+#define PROFILE_ENTRY(node)                                                                        \
+    {.layers = &UTIL_CAT(keymap_, node),                                                           \
+     .layer_names = UTIL_CAT(layer_names_, node),                                                  \
+     PROFILE_SENSOR_LAYERS(node)},
+
+#define PROFILE_ENTRY_BY_IDX(idx, node) PROFILE_ENTRY(DT_PHANDLE_BY_IDX(node, profiles, idx))
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(zmk_keymap_profile) == ZMK_KEYMAP_PROFILES_LEN - 1,
+             "Every keymap profile must be listed in the keymap's profiles property");
+
+static const struct keymap_profile keymap_profiles[ZMK_KEYMAP_PROFILES_LEN] = {
+    {.layers = &zmk_keymap,
+     .layer_names = zmk_keymap_layer_names,
+#if ZMK_KEYMAP_HAS_SENSORS
+     .sensor_layers = &zmk_sensor_keymap,
+#endif
+    },
+    UTIL_LISTIFY(DT_PROP_LEN_OR(ZMK_KEYMAP_NODE, profiles, 0), PROFILE_ENTRY_BY_IDX,
+                 ZMK_KEYMAP_NODE)};
+
+static const struct keymap_profile *active_profile = &keymap_profiles[0];
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_COMPACT)
+
+// Devices resolved for each distinct behavior label referenced by the keymap. Labels are string
+// literals from the devicetree, so entries are matched by pointer.
+static struct {
+    const char *label;
+    const struct device *behavior;
+} compact_behaviors[CONFIG_ZMK_KEYMAP_COMPACT_BEHAVIORS];
+static uint8_t compact_behaviors_len;
+
+static const struct device *compact_behavior_device(const char *label) {
+    if (label == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < compact_behaviors_len; i++) {
+        if (compact_behaviors[i].label == label) {
+            return compact_behaviors[i].behavior;
+        }
+    }
+
+    const struct device *behavior = device_get_binding(label);
+    if (behavior != NULL && compact_behaviors_len < ARRAY_SIZE(compact_behaviors)) {
+        compact_behaviors[compact_behaviors_len].label = label;
+        compact_behaviors[compact_behaviors_len].behavior = behavior;
+        compact_behaviors_len++;
+    }
+
+    return behavior;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE)
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zmk_behavior_transparent)
+static const struct zmk_keymap_compact_binding sparse_transparent_binding = {
+    .behavior_dev = DT_LABEL(DT_INST(0, zmk_behavior_transparent)),
+};
+#else
+static const struct zmk_keymap_compact_binding sparse_transparent_binding;
+#endif
+
+// Positions left out of a sparse layer are &trans, or past the end of its bindings.
+static const struct zmk_keymap_compact_binding *
+profile_compact_binding(const struct keymap_profile *profile, int layer, uint32_t position) {
+    const struct zmk_keymap_sparse_layer *sparse = &(*profile->layers)[layer];
+    uint32_t word = position / 32;
+    uint32_t bit = BIT(position % 32);
+
+    if (!(sparse->present[word] & bit)) {
+        return &sparse_transparent_binding;
+    }
+
+    int index = __builtin_popcount(sparse->present[word] & (bit - 1));
+    for (int i = 0; i < word; i++) {
+        index += __builtin_popcount(sparse->present[i]);
+    }
+
+    return &sparse->bindings[index];
+}
+
+#else
+
+static inline const struct zmk_keymap_compact_binding *
+profile_compact_binding(const struct keymap_profile *profile, int layer, uint32_t position) {
+    return &(*profile->layers)[layer][position];
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_SPARSE) */
+
+static struct zmk_behavior_binding keymap_base_binding(int layer, uint32_t position) {
+    const struct zmk_keymap_compact_binding *compact =
+        profile_compact_binding(active_profile, layer, position);
+
+    return (struct zmk_behavior_binding){
+        .behavior = compact_behavior_device(compact->behavior_dev),
+        .behavior_dev = compact->behavior_dev,
+        .param1 = compact->param1,
+        .param2 = compact->param2,
+    };
+}
+
+static const struct device *profile_binding_device(const struct keymap_profile *profile, int layer,
+                                                   uint32_t position) {
+    return compact_behavior_device(profile_compact_binding(profile, layer, position)->behavior_dev);
+}
+
+#else
+
+static struct zmk_behavior_binding keymap_base_binding(int layer, uint32_t position) {
+    struct zmk_behavior_binding *binding = &(*active_profile->layers)[layer][position];
+
+    behavior_get_binding_device(binding);
+    return *binding;
+}
+
+static const struct device *profile_binding_device(const struct keymap_profile *profile, int layer,
+                                                   uint32_t position) {
+    return behavior_get_binding_device(&(*profile->layers)[layer][position]);
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_COMPACT) */
+
+static inline const struct device *keymap_base_binding_device(int layer, uint32_t position) {
+    return profile_binding_device(active_profile, layer, position);
+}
+
+static inline uint8_t active_profile_index() { return active_profile - keymap_profiles; }
+
+#define ZMK_KEYMAP_LAYER_UNRESOLVED UINT8_MAX
+
+// For each position, the highest layer active in _zmk_keymap_layer_state whose binding isn't
+// statically transparent. Cleared whenever the layer state or a binding changes and refilled lazily
+// on presses.
+static uint8_t zmk_keymap_effective_layer[ZMK_KEYMAP_LEN];
+
+static inline void invalidate_effective_layers() {
+    memset(zmk_keymap_effective_layer, ZMK_KEYMAP_LAYER_UNRESOLVED,
+           sizeof(zmk_keymap_effective_layer));
+}
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_RUNTIME_EDITS)
+
+// A binding changed at runtime, replacing the devicetree binding for one layer and position of a
+// profile. This is also the format persisted to settings, so the behavior is stored by name.
+struct zmk_keymap_override {
+    uint8_t layer;
+    uint8_t profile;
+    uint16_t position;
+    uint32_t param1;
+    uint32_t param2;
+    char behavior_dev[ZMK_KEYMAP_BEHAVIOR_NAME_MAX];
+};
+
+static struct zmk_keymap_override overrides[CONFIG_ZMK_KEYMAP_RUNTIME_EDITS_MAX];
+static const struct device *override_devices[CONFIG_ZMK_KEYMAP_RUNTIME_EDITS_MAX];
+static uint8_t overrides_len;
+
+// Positions with an override on any layer of the active profile, so other positions skip
+// searching the overlay.
+static uint32_t overridden_positions[DIV_ROUND_UP(ZMK_KEYMAP_LEN, 32)];
+
+static void update_overridden_positions() {
+    memset(overridden_positions, 0, sizeof(overridden_positions));
+
+    for (int i = 0; i < overrides_len; i++) {
+        if (overrides[i].profile == active_profile_index()) {
+            overridden_positions[overrides[i].position / 32] |= BIT(overrides[i].position % 32);
+        }
+    }
+
+    invalidate_effective_layers();
+}
+
+static int find_override(int layer, uint32_t position) {
+    if ((overridden_positions[position / 32] & BIT(position % 32)) == 0) {
+        return -ENOENT;
+    }
+
+    for (int i = 0; i < overrides_len; i++) {
+        if (overrides[i].layer == layer && overrides[i].position == position &&
+            overrides[i].profile == active_profile_index()) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static struct zmk_behavior_binding keymap_binding(int layer, uint32_t position) {
+    int i = find_override(layer, position);
+    if (i < 0) {
+        return keymap_base_binding(layer, position);
+    }
+
+    // The label comes from the device, not the override, so a binding kept until the key is
+    // released still names the right behavior after the override moves or is removed.
+    return (struct zmk_behavior_binding){
+        .behavior = override_devices[i],
+        .behavior_dev = (char *)override_devices[i]->name,
+        .param1 = overrides[i].param1,
+        .param2 = overrides[i].param2,
+    };
+}
+
+static const struct device *keymap_binding_device(int layer, uint32_t position) {
+    int i = find_override(layer, position);
+    if (i < 0) {
+        return keymap_base_binding_device(layer, position);
+    }
+
+    return override_devices[i];
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static void keymap_save_overrides_work() {
+    int err;
+
+    if (overrides_len == 0) {
+        err = settings_delete("keymap/overrides");
+    } else {
+        err = settings_save_one("keymap/overrides", overrides, overrides_len * sizeof(*overrides));
+    }
+
+    if (err) {
+        LOG_ERR("Failed to save keymap overrides (err %d)", err);
+    }
+}
+
+ZMK_SETTINGS_SAVE_DEFINE(keymap_save, keymap_save_overrides_work);
+#endif
+
+static int keymap_save_overrides() {
+#if IS_ENABLED(CONFIG_SETTINGS)
+    return zmk_settings_save(&keymap_save);
+#else
+    return 0;
+#endif
+}
+
+static void remove_override(int i) {
+    overrides_len--;
+    overrides[i] = overrides[overrides_len];
+    override_devices[i] = override_devices[overrides_len];
+}
+
+int zmk_keymap_set_binding(uint8_t layer, uint32_t position,
+                           const struct zmk_behavior_binding *binding) {
+    if (layer >= ZMK_KEYMAP_LAYERS_LEN || position >= ZMK_KEYMAP_LEN) {
+        return -EINVAL;
+    }
+
+    if (binding->behavior_dev == NULL ||
+        strlen(binding->behavior_dev) >= ZMK_KEYMAP_BEHAVIOR_NAME_MAX) {
+        return -EINVAL;
+    }
+
+    const struct device *behavior = device_get_binding(binding->behavior_dev);
+    if (behavior == NULL) {
+        LOG_ERR("No behavior named %s", log_strdup(binding->behavior_dev));
+        return -ENODEV;
+    }
+
+    int i = find_override(layer, position);
+    if (i < 0) {
+        if (overrides_len >= ARRAY_SIZE(overrides)) {
+            LOG_ERR("No room for more keymap overrides");
+            return -ENOMEM;
+        }
+        i = overrides_len++;
+    }
+
+    overrides[i] = (struct zmk_keymap_override){
+        .layer = layer,
+        .profile = active_profile_index(),
+        .position = position,
+        .param1 = binding->param1,
+        .param2 = binding->param2,
+    };
+    strcpy(overrides[i].behavior_dev, binding->behavior_dev);
+    override_devices[i] = behavior;
+
+    update_overridden_positions();
+    return keymap_save_overrides();
+}
+
+int zmk_keymap_reset_binding(uint8_t layer, uint32_t position) {
+    if (layer >= ZMK_KEYMAP_LAYERS_LEN || position >= ZMK_KEYMAP_LEN) {
+        return -EINVAL;
+    }
+
+    int i = find_override(layer, position);
+    if (i < 0) {
+        return 0;
+    }
+
+    remove_override(i);
+    update_overridden_positions();
+    return keymap_save_overrides();
+}
+
+int zmk_keymap_reset_bindings() {
+    if (overrides_len == 0) {
+        return 0;
+    }
+
+    overrides_len = 0;
+    update_overridden_positions();
+    return keymap_save_overrides();
+}
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_STAGED_EDITS)
+
+// Only the staged bindings that differ from the devicetree become overrides, so a whole layer can
+// be staged in no more room than the overlay itself.
+static struct zmk_keymap_override staged[CONFIG_ZMK_KEYMAP_RUNTIME_EDITS_MAX];
+static const struct device *staged_devices[CONFIG_ZMK_KEYMAP_RUNTIME_EDITS_MAX];
+static uint8_t staged_len;
+static bool staging;
+static uint8_t staged_profile;
+static zmk_keymap_layers_state_t staged_layers;
+// Positions staged so far on each layer, since a commit must cover whole layers.
+static uint32_t staged_positions[ZMK_KEYMAP_LAYERS_LEN][DIV_ROUND_UP(ZMK_KEYMAP_LEN, 32)];
+
+static int find_staged(int layer, uint32_t position) {
+    for (int i = 0; i < staged_len; i++) {
+        if (staged[i].layer == layer && staged[i].position == position) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static void remove_staged(int i) {
+    staged_len--;
+    staged[i] = staged[staged_len];
+    staged_devices[i] = staged_devices[staged_len];
+}
+
+void zmk_keymap_stage_begin() {
+    staged_len = 0;
+    staged_layers = 0;
+    memset(staged_positions, 0, sizeof(staged_positions));
+    staged_profile = active_profile_index();
+    staging = true;
+}
+
+void zmk_keymap_stage_abort() { staging = false; }
+
+int zmk_keymap_stage_binding(uint8_t layer, uint32_t position,
+                             const struct zmk_behavior_binding *binding) {
+    if (!staging) {
+        return -EINVAL;
+    }
+
+    if (layer >= ZMK_KEYMAP_LAYERS_LEN || position >= ZMK_KEYMAP_LEN ||
+        binding->behavior_dev == NULL ||
+        strlen(binding->behavior_dev) >= ZMK_KEYMAP_BEHAVIOR_NAME_MAX) {
+        return -EINVAL;
+    }
+
+    const struct device *behavior = device_get_binding(binding->behavior_dev);
+    if (behavior == NULL) {
+        LOG_ERR("No behavior named %s", log_strdup(binding->behavior_dev));
+        return -ENODEV;
+    }
+
+    staged_layers |= ZMK_KEYMAP_LAYER_BIT(layer);
+    staged_positions[layer][position / 32] |= BIT(position % 32);
+
+    int i = find_staged(layer, position);
+    struct zmk_behavior_binding base = keymap_base_binding(layer, position);
+
+    if (behavior == keymap_base_binding_device(layer, position) &&
+        binding->param1 == base.param1 && binding->param2 == base.param2) {
+        if (i >= 0) {
+            remove_staged(i);
+        }
+        return 0;
+    }
+
+    if (i < 0) {
+        if (staged_len >= ARRAY_SIZE(staged)) {
+            LOG_ERR("Too many bindings differ from the keymap to stage them");
+            return -ENOMEM;
+        }
+        i = staged_len++;
+    }
+
+    staged[i] = (struct zmk_keymap_override){
+        .layer = layer,
+        .profile = staged_profile,
+        .position = position,
+        .param1 = binding->param1,
+        .param2 = binding->param2,
+    };
+    strcpy(staged[i].behavior_dev, binding->behavior_dev);
+    staged_devices[i] = behavior;
+
+    return 0;
+}
+
+static bool staged_layer_complete(int layer) {
+    for (int position = 0; position < ZMK_KEYMAP_LEN; position++) {
+        if ((staged_positions[layer][position / 32] & BIT(position % 32)) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool replaced_by_staged(const struct zmk_keymap_override *override) {
+    return override->profile == staged_profile &&
+           (staged_layers & ZMK_KEYMAP_LAYER_BIT(override->layer)) != 0;
+}
+
+int zmk_keymap_stage_commit() {
+    if (!staging) {
+        return -EINVAL;
+    }
+
+    // The staged bindings were compared to the profile active when staging began.
+    if (staged_profile != active_profile_index()) {
+        return -ESTALE;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < overrides_len; i++) {
+        if (!replaced_by_staged(&overrides[i])) {
+            kept++;
+        }
+    }
+
+    for (int layer = 0; layer < ZMK_KEYMAP_LAYERS_LEN; layer++) {
+        if ((staged_layers & ZMK_KEYMAP_LAYER_BIT(layer)) && !staged_layer_complete(layer)) {
+            LOG_ERR("Staged layer %d is missing bindings", layer);
+            return -EINVAL;
+        }
+    }
+
+    if (kept + staged_len > ARRAY_SIZE(overrides)) {
+        LOG_ERR("No room for the staged keymap overrides");
+        return -ENOMEM;
+    }
+
+    for (int i = overrides_len - 1; i >= 0; i--) {
+        if (replaced_by_staged(&overrides[i])) {
+            remove_override(i);
+        }
+    }
+
+    for (int i = 0; i < staged_len; i++) {
+        overrides[overrides_len] = staged[i];
+        override_devices[overrides_len] = staged_devices[i];
+        overrides_len++;
+    }
+    staging = false;
+
+    LOG_DBG("Committed %d staged keymap overrides", staged_len);
+
+    update_overridden_positions();
+    return keymap_save_overrides();
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_STAGED_EDITS) */
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+
+static int keymap_load_overrides(size_t len, settings_read_cb read_cb, void *cb_arg) {
+    if (len % sizeof(*overrides) != 0 || len > sizeof(overrides)) {
+        LOG_ERR("Invalid keymap overrides size (got %d)", len);
+        return -EINVAL;
+    }
+
+    int err = read_cb(cb_arg, overrides, len);
+    if (err <= 0) {
+        LOG_ERR("Failed to read keymap overrides from settings (err %d)", err);
+        overrides_len = 0;
+        return err;
+    }
+
+    overrides_len = len / sizeof(*overrides);
+
+    // Drop entries the current firmware can't apply, e.g. after the keymap shrank or a
+    // behavior was removed.
+    for (int i = overrides_len - 1; i >= 0; i--) {
+        overrides[i].behavior_dev[ZMK_KEYMAP_BEHAVIOR_NAME_MAX - 1] = '\0';
+        override_devices[i] = device_get_binding(overrides[i].behavior_dev);
+
+        if (overrides[i].layer >= ZMK_KEYMAP_LAYERS_LEN ||
+            overrides[i].profile >= ZMK_KEYMAP_PROFILES_LEN ||
+            overrides[i].position >= ZMK_KEYMAP_LEN || override_devices[i] == NULL) {
+            LOG_WRN("Dropping keymap override for %d on layer %d", overrides[i].position,
+                    overrides[i].layer);
+            remove_override(i);
+        }
+    }
+
+    update_overridden_positions();
+    return 0;
+}
+
+#endif /* IS_ENABLED(CONFIG_SETTINGS) */
+
+#else
+
+static inline struct zmk_behavior_binding keymap_binding(int layer, uint32_t position) {
+    return keymap_base_binding(layer, position);
+}
+
+static inline const struct device *keymap_binding_device(int layer, uint32_t position) {
+    return keymap_base_binding_device(layer, position);
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_RUNTIME_EDITS) */
+
+static void set_active_profile(uint8_t profile) {
+    active_profile = &keymap_profiles[profile];
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_RUNTIME_EDITS)
+    update_overridden_positions();
+#else
+    invalidate_effective_layers();
+#endif
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static void keymap_save_profile_work() {
+    uint8_t profile = active_profile_index();
+
+    int err = settings_save_one("keymap/profile", &profile, sizeof(profile));
+    if (err) {
+        LOG_ERR("Failed to save keymap profile (err %d)", err);
+    }
+}
+
+ZMK_SETTINGS_SAVE_DEFINE(profile_save, keymap_save_profile_work);
+
+static int keymap_handle_set(const char *name, size_t len, settings_read_cb read_cb,
+                             void *cb_arg) {
+    LOG_DBG("Setting keymap value %s", log_strdup(name));
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_RUNTIME_EDITS)
+    if (settings_name_steq(name, "overrides", NULL)) {
+        return keymap_load_overrides(len, read_cb, cb_arg);
+    }
+#endif
+
+    if (settings_name_steq(name, "profile", NULL)) {
+        uint8_t profile;
+
+        if (len != sizeof(profile)) {
+            return -EINVAL;
+        }
+
+        int err = read_cb(cb_arg, &profile, sizeof(profile));
+        if (err <= 0) {
+            LOG_ERR("Failed to read keymap profile from settings (err %d)", err);
+            return err;
+        }
+
+        // Profiles removed from the keymap since leave the first one active.
+        if (profile < ZMK_KEYMAP_PROFILES_LEN) {
+            set_active_profile(profile);
+        }
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(keymap, "keymap", NULL, keymap_handle_set, NULL, NULL);
+#endif /* IS_ENABLED(CONFIG_SETTINGS) */
+
+uint8_t zmk_keymap_profile() { return active_profile_index(); }
+
+int zmk_keymap_profile_select(uint8_t profile) {
+    if (profile >= ZMK_KEYMAP_PROFILES_LEN) {
+        return -EINVAL;
+    }
+
+    if (profile == active_profile_index()) {
+        return 0;
+    }
+
+    set_active_profile(profile);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+    zmk_settings_save(&profile_save);
+#endif
+
+    return raise_keymap_profile_changed(profile);
+}
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zmk_behavior_transparent)
+#define TRANSPARENT_BEHAVIOR DEVICE_DT_GET(DT_INST(0, zmk_behavior_transparent))
+#else
+#define TRANSPARENT_BEHAVIOR NULL
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_INLINE_CORE_BEHAVIORS)
+
+#define CORE_BEHAVIOR(compat)                                                                      \
+    COND_CODE_1(DT_HAS_COMPAT_STATUS_OKAY(compat), (DEVICE_DT_GET(DT_INST(0, compat))), (NULL))
+
+#define KEY_PRESS_BEHAVIOR CORE_BEHAVIOR(zmk_behavior_key_press)
+#define MOMENTARY_LAYER_BEHAVIOR CORE_BEHAVIOR(zmk_behavior_momentary_layer)
+#define NONE_BEHAVIOR CORE_BEHAVIOR(zmk_behavior_none)
+
+// Handles the behaviors most bindings use the same way their drivers do. They all run on the
+// central with their params as is, so neither the conversion, the locality nor the driver call is
+// needed. Returns true if `binding` is one of them, with its result in `ret`.
+static bool invoke_core_behavior(const struct zmk_behavior_binding *binding, bool pressed,
+                                 int64_t timestamp, int *ret) {
+    const struct device *behavior = binding->behavior;
+
+    if (behavior == KEY_PRESS_BEHAVIOR) {
+        *ret = ZMK_EVENT_RAISE(
+            zmk_keycode_state_changed_from_encoded(binding->param1, pressed, timestamp));
+    } else if (behavior == MOMENTARY_LAYER_BEHAVIOR) {
+        *ret = pressed ? zmk_keymap_layer_activate(binding->param1)
+                       : zmk_keymap_layer_deactivate(binding->param1);
+    } else if (behavior == NONE_BEHAVIOR) {
+        *ret = ZMK_BEHAVIOR_OPAQUE;
+    } else if (behavior == TRANSPARENT_BEHAVIOR) {
+        *ret = ZMK_BEHAVIOR_TRANSPARENT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_KEYMAP_INLINE_CORE_BEHAVIORS) */
+
+// Replaces the whole layer state at once, raising a single event for the change. `layer` and
+// `state` describe the change that caused it.
+static int set_layer_state_mask(zmk_keymap_layers_state_t layer_state, uint8_t layer, bool state) {
+    zmk_keymap_layers_state_t old_state = _zmk_keymap_layer_state;
+
+    // Default layer should *always* remain active
+    layer_state |= old_state & ZMK_KEYMAP_LAYER_BIT(_zmk_keymap_layer_default);
+
+    // Don't send state changes unless there was an actual change
+    if (old_state == layer_state) {
+        return 0;
+    }
+
+    _zmk_keymap_layer_state = layer_state;
+    invalidate_effective_layers();
+    LOG_DBG("layer_changed: layer %d state %d", layer, state);
+    zmk_flight_record(ZMK_FLIGHT_LAYER, layer, state);
+    raise_layer_state_changed(layer, state, old_state, layer_state);
+
+    return 0;
+}
+
 static inline int set_layer_state(uint8_t layer, bool state) {
     if (layer >= ZMK_KEYMAP_LAYERS_LEN) {
         return -EINVAL;
@@ -90,15 +902,13 @@ static inline int set_layer_state(uint8_t layer, bool state) {
         return 0;
     }
 
-    zmk_keymap_layers_state_t old_state = _zmk_keymap_layer_state;
-    WRITE_BIT(_zmk_keymap_layer_state, layer, state);
-    // Don't send state changes unless there was an actual change
-    if (old_state != _zmk_keymap_layer_state) {
-        LOG_DBG("layer_changed: layer %d state %d", layer, state);
-        ZMK_EVENT_RAISE(create_layer_state_changed(layer, state));
+    if (state) {
+        return set_layer_state_mask(_zmk_keymap_layer_state | ZMK_KEYMAP_LAYER_BIT(layer), layer,
+                                    state);
     }
 
-    return 0;
+    return set_layer_state_mask(_zmk_keymap_layer_state & ~ZMK_KEYMAP_LAYER_BIT(layer), layer,
+                                state);
 }
 
 uint8_t zmk_keymap_layer_default() { return _zmk_keymap_layer_default; }
@@ -108,20 +918,25 @@ zmk_keymap_layers_state_t zmk_keymap_layer_state() { return _zmk_keymap_layer_st
 bool zmk_keymap_layer_active_with_state(uint8_t layer, zmk_keymap_layers_state_t state_to_test) {
     // The default layer is assumed to be ALWAYS ACTIVE so we include an || here to ensure nobody
     // breaks up that assumption by accident
-    return (state_to_test & (BIT(layer))) == (BIT(layer)) || layer == _zmk_keymap_layer_default;
+    return (state_to_test & ZMK_KEYMAP_LAYER_BIT(layer)) != 0 || layer == _zmk_keymap_layer_default;
 };
 
+// The layers active in `layer_state`, including the default layer, from the default layer up to
+// and including `top`. Iterate them from the highest with zmk_keymap_layers_state_highest().
+static zmk_keymap_layers_state_t active_layers_up_to(uint8_t top,
+                                                     zmk_keymap_layers_state_t layer_state) {
+    zmk_keymap_layers_state_t below_default = ZMK_KEYMAP_LAYER_BIT(_zmk_keymap_layer_default) - 1;
+    return (layer_state | ZMK_KEYMAP_LAYER_BIT(_zmk_keymap_layer_default)) &
+           zmk_keymap_layers_at_or_below(top) & ~below_default;
+}
+
 bool zmk_keymap_layer_active(uint8_t layer) {
     return zmk_keymap_layer_active_with_state(layer, _zmk_keymap_layer_state);
 };
 
 uint8_t zmk_keymap_highest_layer_active() {
-    for (uint8_t layer = ZMK_KEYMAP_LAYERS_LEN - 1; layer > 0; layer--) {
-        if (zmk_keymap_layer_active(layer)) {
-            return layer;
-        }
-    }
-    return zmk_keymap_layer_default();
+    return zmk_keymap_layers_state_highest(_zmk_keymap_layer_state |
+                                           ZMK_KEYMAP_LAYER_BIT(_zmk_keymap_layer_default));
 }
 
 int zmk_keymap_layer_activate(uint8_t layer) { return set_layer_state(layer, true); };
@@ -137,17 +952,29 @@ int zmk_keymap_layer_toggle(uint8_t layer) {
 };
 
 int zmk_keymap_layer_to(uint8_t layer) {
-    for (int i = ZMK_KEYMAP_LAYERS_LEN - 1; i >= 0; i--) {
-        zmk_keymap_layer_deactivate(i);
+    if (layer >= ZMK_KEYMAP_LAYERS_LEN) {
+        return -EINVAL;
     }
 
-    zmk_keymap_layer_activate(layer);
+    return set_layer_state_mask(ZMK_KEYMAP_LAYER_BIT(layer), layer, true);
+}
 
-    return 0;
+int zmk_keymap_layer_state_set(zmk_keymap_layers_state_t layer_state) {
+    layer_state &= zmk_keymap_layers_at_or_below(ZMK_KEYMAP_LAYERS_LEN - 1);
+
+    zmk_keymap_layers_state_t changed = (layer_state ^ _zmk_keymap_layer_state) &
+                                        ~ZMK_KEYMAP_LAYER_BIT(_zmk_keymap_layer_default);
+    if (changed == 0) {
+        return 0;
+    }
+
+    uint8_t layer = zmk_keymap_layers_state_highest(changed);
+    return set_layer_state_mask(layer_state, layer,
+                                (layer_state & ZMK_KEYMAP_LAYER_BIT(layer)) != 0);
 }
 
 bool is_active_layer(uint8_t layer, zmk_keymap_layers_state_t layer_state) {
-    return (layer_state & BIT(layer)) == BIT(layer) || layer == _zmk_keymap_layer_default;
+    return (layer_state & ZMK_KEYMAP_LAYER_BIT(layer)) != 0 || layer == _zmk_keymap_layer_default;
 }
 
 const char *zmk_keymap_layer_label(uint8_t layer) {
@@ -155,7 +982,7 @@ const char *zmk_keymap_layer_label(uint8_t layer) {
         return NULL;
     }
 
-    return zmk_keymap_layer_names[layer];
+    return active_profile->layer_names[layer];
 }
 
 int invoke_locally(struct zmk_behavior_binding *binding, struct zmk_behavior_binding_event event,
@@ -171,8 +998,9 @@ int zmk_keymap_apply_position_state(uint8_t source, int layer, uint32_t position
                                     int64_t timestamp) {
     // We want to make a copy of this, since it may be converted from
     // relative to absolute before being invoked
-    struct zmk_behavior_binding binding = zmk_keymap[layer][position];
-    const struct device *behavior;
+    struct zmk_behavior_binding binding =
+        pressed ? keymap_binding(layer, position) : zmk_keymap_pressed_bindings[position].binding;
+    const struct device *behavior = binding.behavior;
     struct zmk_behavior_binding_event event = {
         .layer = layer,
         .position = position,
@@ -181,22 +1009,39 @@ int zmk_keymap_apply_position_state(uint8_t source, int layer, uint32_t position
 
     LOG_DBG("layer: %d position: %d, binding name: %s", layer, position,
             log_strdup(binding.behavior_dev));
-
-    behavior = device_get_binding(binding.behavior_dev);
+    zmk_hot_path_trace(ZMK_HOT_PATH_KEYMAP_BINDING, behavior, (layer << 16) | position, pressed);
 
     if (!behavior) {
         LOG_WRN("No behavior assigned to %d on layer %d", position, layer);
         return 1;
     }
 
-    int err = behavior_keymap_binding_convert_central_state_dependent_params(&binding, event);
-    if (err) {
-        LOG_ERR("Failed to convert relative to absolute behavior binding (err %d)", err);
-        return err;
+    // Only a few behaviors convert their params, so skip the call for the rest. Released bindings
+    // were converted when pressed.
+    const struct behavior_driver_api *api = (const struct behavior_driver_api *)behavior->api;
+    if (pressed && api->binding_convert_central_state_dependent_params != NULL) {
+        int err = behavior_keymap_binding_convert_central_state_dependent_params(&binding, event);
+        if (err) {
+            LOG_ERR("Failed to convert relative to absolute behavior binding (err %d)", err);
+            return err;
+        }
     }
 
+    if (pressed) {
+        zmk_keymap_pressed_bindings[position].binding = binding;
+        zmk_keymap_pressed_bindings[position].layer = layer;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_INLINE_CORE_BEHAVIORS)
+    int ret;
+    if (invoke_core_behavior(&binding, pressed, timestamp, &ret)) {
+        return ret;
+    }
+#endif
+
+#if defined(SPLIT_PERIPHERAL_COUNT)
     enum behavior_locality locality = BEHAVIOR_LOCALITY_CENTRAL;
-    err = behavior_get_locality(behavior, &locality);
+    int err = behavior_get_locality(behavior, &locality);
     if (err) {
         LOG_ERR("Failed to get behavior locality %d", err);
         return err;
@@ -206,70 +1051,124 @@ int zmk_keymap_apply_position_state(uint8_t source, int layer, uint32_t position
     case BEHAVIOR_LOCALITY_CENTRAL:
         return invoke_locally(&binding, event, pressed);
     case BEHAVIOR_LOCALITY_EVENT_SOURCE:
-#if ZMK_BLE_IS_CENTRAL
         if (source == ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL) {
             return invoke_locally(&binding, event, pressed);
-        } else {
-            return zmk_split_bt_invoke_behavior(source, &binding, event, pressed);
         }
-#else
-        return invoke_locally(&binding, event, pressed);
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_EVENT_SOURCE_BEHAVIORS)
+        // The peripheral already ran it when the key was pressed there.
+        if (zmk_split_event_source_runs_on_peripheral(position)) {
+            return ZMK_BEHAVIOR_OPAQUE;
+        }
 #endif
+        return split_invoke_behavior(source, &binding, event, pressed);
     case BEHAVIOR_LOCALITY_GLOBAL:
-#if ZMK_BLE_IS_CENTRAL
-        for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
-            zmk_split_bt_invoke_behavior(i, &binding, event, pressed);
+        for (int i = 0; i < SPLIT_PERIPHERAL_COUNT; i++) {
+            split_invoke_behavior(i, &binding, event, pressed);
         }
-#endif
         return invoke_locally(&binding, event, pressed);
     }
 
     return -ENOTSUP;
+#else
+    // Without peripherals every locality runs the behavior here.
+    return invoke_locally(&binding, event, pressed);
+#endif
+}
+
+// Bindings which always return ZMK_BEHAVIOR_TRANSPARENT, so the layer below can be tried right away
+static bool is_static_transparent(int layer, uint32_t position) {
+    const struct device *behavior = keymap_binding_device(layer, position);
+    return behavior == NULL || behavior == TRANSPARENT_BEHAVIOR;
+}
+
+static uint8_t find_effective_layer(uint32_t position, zmk_keymap_layers_state_t layer_state) {
+    zmk_keymap_layers_state_t layers = active_layers_up_to(ZMK_KEYMAP_LAYERS_LEN - 1, layer_state);
+
+    while (layers) {
+        uint8_t layer = zmk_keymap_layers_state_highest(layers);
+        if (layer == _zmk_keymap_layer_default || !is_static_transparent(layer, position)) {
+            return layer;
+        }
+        layers &= ~ZMK_KEYMAP_LAYER_BIT(layer);
+    }
+
+    return _zmk_keymap_layer_default;
+}
+
+static uint8_t effective_layer(uint32_t position) {
+    if (zmk_keymap_effective_layer[position] == ZMK_KEYMAP_LAYER_UNRESOLVED) {
+        zmk_keymap_effective_layer[position] =
+            find_effective_layer(position, _zmk_keymap_layer_state);
+    }
+
+    return zmk_keymap_effective_layer[position];
 }
 
 int zmk_keymap_position_state_changed(uint8_t source, uint32_t position, bool pressed,
                                       int64_t timestamp) {
-    if (pressed) {
-        zmk_keymap_active_behavior_layer[position] = _zmk_keymap_layer_state;
+    if (!pressed) {
+        if (zmk_keymap_pressed_bindings[position].binding.behavior == NULL) {
+            return -ENOTSUP;
+        }
+
+        int ret = zmk_keymap_apply_position_state(
+            source, zmk_keymap_pressed_bindings[position].layer, position, false, timestamp);
+        zmk_keymap_pressed_bindings[position].binding.behavior = NULL;
+        return ret;
     }
-    for (int layer = ZMK_KEYMAP_LAYERS_LEN - 1; layer >= _zmk_keymap_layer_default; layer--) {
-        if (zmk_keymap_layer_active_with_state(layer, zmk_keymap_active_behavior_layer[position])) {
-            int ret = zmk_keymap_apply_position_state(source, layer, position, pressed, timestamp);
-            if (ret > 0) {
-                LOG_DBG("behavior processing to continue to next layer");
-                continue;
-            } else if (ret < 0) {
-                LOG_DBG("Behavior returned error: %d", ret);
-                return ret;
-            } else {
-                return ret;
-            }
+
+    zmk_keymap_layers_state_t layers =
+        active_layers_up_to(effective_layer(position), _zmk_keymap_layer_state);
+
+    while (layers) {
+        uint8_t layer = zmk_keymap_layers_state_highest(layers);
+        layers &= ~ZMK_KEYMAP_LAYER_BIT(layer);
+
+        int ret = zmk_keymap_apply_position_state(source, layer, position, pressed, timestamp);
+        if (ret > 0) {
+            LOG_DBG("behavior processing to continue to next layer");
+            continue;
+        } else if (ret < 0) {
+            LOG_DBG("Behavior returned error: %d", ret);
+            return ret;
+        } else {
+            return ret;
         }
     }
 
+    // Every layer was transparent, so there is nothing to release.
+    zmk_keymap_pressed_bindings[position].binding.behavior = NULL;
     return -ENOTSUP;
 }
 
 #if ZMK_KEYMAP_HAS_SENSORS
 int zmk_keymap_sensor_triggered(uint8_t sensor_number, const struct device *sensor,
-                                int64_t timestamp) {
-    for (int layer = ZMK_KEYMAP_LAYERS_LEN - 1; layer >= _zmk_keymap_layer_default; layer--) {
-        if (zmk_keymap_layer_active(layer) && zmk_sensor_keymap[layer] != NULL) {
-            struct zmk_behavior_binding *binding = &zmk_sensor_keymap[layer][sensor_number];
+                                struct sensor_value value, int64_t timestamp) {
+    zmk_keymap_layers_state_t layers =
+        active_layers_up_to(ZMK_KEYMAP_LAYERS_LEN - 1, _zmk_keymap_layer_state);
+
+    while (layers) {
+        uint8_t layer = zmk_keymap_layers_state_highest(layers);
+        layers &= ~ZMK_KEYMAP_LAYER_BIT(layer);
+
+        if ((*active_profile->sensor_layers)[layer] != NULL) {
+            struct zmk_behavior_binding *binding =
+                &(*active_profile->sensor_layers)[layer][sensor_number];
             const struct device *behavior;
             int ret;
 
             LOG_DBG("layer: %d sensor_number: %d, binding name: %s", layer, sensor_number,
                     log_strdup(binding->behavior_dev));
 
-            behavior = device_get_binding(binding->behavior_dev);
+            behavior = behavior_get_binding_device(binding);
 
             if (!behavior) {
                 LOG_DBG("No behavior assigned to %d on layer %d", sensor_number, layer);
                 continue;
             }
 
-            ret = behavior_sensor_keymap_binding_triggered(binding, sensor, timestamp);
+            ret = behavior_sensor_keymap_binding_triggered(binding, sensor_number, sensor, value,
+                                                           timestamp);
 
             if (ret > 0) {
                 LOG_DBG("behavior processing to continue to next layer");
@@ -299,7 +1198,7 @@ int keymap_listener(const zmk_event_t *eh) {
     const struct zmk_sensor_event *sensor_ev;
     if ((sensor_ev = as_zmk_sensor_event(eh)) != NULL) {
         return zmk_keymap_sensor_triggered(sensor_ev->sensor_number, sensor_ev->sensor,
-                                           sensor_ev->timestamp);
+                                           sensor_ev->value, sensor_ev->timestamp);
     }
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
 
@@ -312,3 +1211,29 @@ ZMK_SUBSCRIPTION(keymap, zmk_position_state_changed);
 #if ZMK_KEYMAP_HAS_SENSORS
 ZMK_SUBSCRIPTION(keymap, zmk_sensor_event);
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
+
+static int zmk_keymap_init(const struct device *_arg) {
+    invalidate_effective_layers();
+
+    // Behaviors are initialized by now, so resolve every binding of every profile once up front
+    // instead of looking the behavior up by label on each key event.
+    for (int p = 0; p < ZMK_KEYMAP_PROFILES_LEN; p++) {
+        const struct keymap_profile *profile = &keymap_profiles[p];
+
+        for (int layer = 0; layer < ZMK_KEYMAP_LAYERS_LEN; layer++) {
+            for (int position = 0; position < ZMK_KEYMAP_LEN; position++) {
+                profile_binding_device(profile, layer, position);
+            }
+
+#if ZMK_KEYMAP_HAS_SENSORS
+            for (int sensor = 0; sensor < ZMK_KEYMAP_SENSORS_LEN; sensor++) {
+                behavior_get_binding_device(&(*profile->sensor_layers)[layer][sensor]);
+            }
+#endif /* ZMK_KEYMAP_HAS_SENSORS */
+        }
+    }
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_keymap_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
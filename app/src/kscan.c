@@ -8,54 +8,419 @@
 #include <device.h>
 #include <bluetooth/addr.h>
 #include <drivers/kscan.h>
+#include <drivers/kscan_frame.h>
+#include <init.h>
 #include <logging/log.h>
+#include <string.h>
+#include <sys/atomic.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
+#include <zmk/kscan.h>
+#include <zmk/matrix.h>
 #include <zmk/matrix_transform.h>
 #include <zmk/event_manager.h>
+#include <zmk/flight_recorder.h>
+#include <zmk/hot_path_trace.h>
+#include <zmk/latency_benchmark.h>
+#include <zmk/memory_stats.h>
+#include <zmk/pipeline_stats.h>
 #include <zmk/events/position_state_changed.h>
+#include <zmk/trace_pins.h>
+#include <zmk/trace_recorder.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_FRAME_BATCHING)
+#include <zmk/endpoints.h>
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_WAKE_CAPTURE)
+#include <drivers/hwinfo.h>
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#include <zmk/ble.h>
+#define PERIPHERAL_QUEUE_COUNT ZMK_BLE_SPLIT_PERIPHERAL_COUNT
+#else
+#define PERIPHERAL_QUEUE_COUNT 0
+#endif
 
 #define ZMK_KSCAN_EVENT_STATE_PRESSED 0
 #define ZMK_KSCAN_EVENT_STATE_RELEASED 1
 
+// A key transition, from the local matrix or a split peripheral.
 struct zmk_kscan_event {
-    uint32_t row;
-    uint32_t column;
-    uint32_t state;
+    union {
+        // Local transitions are on the matrix.
+        struct {
+            uint32_t row;
+            uint32_t column;
+        };
+        // Peripherals send transitions that are already on a position.
+        uint32_t position;
+    };
+    uint8_t source;
+    uint8_t state;
+    int64_t timestamp;
 };
 
 struct zmk_kscan_msg_processor {
     struct k_work work;
 } msg_processor;
 
-K_MSGQ_DEFINE(zmk_kscan_msgq, sizeof(struct zmk_kscan_event), CONFIG_ZMK_KSCAN_EVENT_QUEUE_SIZE, 4);
+K_MSGQ_DEFINE(zmk_kscan_msgq, sizeof(struct zmk_kscan_event), CONFIG_ZMK_KSCAN_EVENT_QUEUE_SIZE, 8);
+
+#if PERIPHERAL_QUEUE_COUNT > 0
+// Each peripheral queues its transitions separately, so one sending a burst can't crowd out the
+// local matrix or another peripheral. The processor merges all of them by their timestamps.
+#define PERIPHERAL_MSGQ_BUF_SIZE                                                                   \
+    (CONFIG_ZMK_SPLIT_BLE_CENTRAL_POSITION_QUEUE_SIZE * sizeof(struct zmk_kscan_event))
+
+static struct k_msgq peripheral_msgqs[PERIPHERAL_QUEUE_COUNT];
+static char __aligned(8) peripheral_msgq_bufs[PERIPHERAL_QUEUE_COUNT][PERIPHERAL_MSGQ_BUF_SIZE];
+#endif
+
+// The local queue, then one for each peripheral.
+#define EVENT_QUEUE_COUNT (1 + PERIPHERAL_QUEUE_COUNT)
+
+static struct k_msgq *event_queue(int i) {
+#if PERIPHERAL_QUEUE_COUNT > 0
+    if (i > 0) {
+        return &peripheral_msgqs[i - 1];
+    }
+#endif
+    return &zmk_kscan_msgq;
+}
+
+#define USE_FRAMES                                                                                 \
+    (IS_ENABLED(CONFIG_ZMK_KSCAN_FRAMES) && KSCAN_FRAME_SUPPORTED(ZMK_MATRIX_NODE_ID))
+
+#if USE_FRAMES
+#define FRAME_WORDS DIV_ROUND_UP(ZMK_MATRIX_ROWS * ZMK_MATRIX_COLS, 32)
+
+// A copy of a driver's kscan_frame, queued once per scan instead of once per key.
+struct zmk_kscan_frame_msg {
+    uint32_t changed[FRAME_WORDS];
+    uint32_t pressed[FRAME_WORDS];
+    uint16_t words;
+    uint16_t rows;
+    int64_t timestamp;
+};
+
+K_MSGQ_DEFINE(zmk_kscan_frame_msgq, sizeof(struct zmk_kscan_frame_msg),
+              CONFIG_ZMK_KSCAN_EVENT_QUEUE_SIZE, 8);
+#endif
+
+// Transitions stay queued until the keymap is up, which is only earlier if scanning was started
+// early to capture the wake key.
+static atomic_t msgq_processing;
+static bool kscan_started;
+
+#define MATRIX_STATE_LEN (ZMK_MATRIX_ROWS * ZMK_MATRIX_COLS)
+
+// If the queue fills up, transitions stop being queued until it is drained. The processor then
+// raises whatever differs between the latest state reported by the driver and the state it
+// delivered, so no transition is lost however small the queue is.
+static ATOMIC_DEFINE(reported_state, MATRIX_STATE_LEN);
+static ATOMIC_DEFINE(delivered_state, MATRIX_STATE_LEN);
+static atomic_t msgq_overflowed;
+
+static int matrix_state_index(uint32_t row, uint32_t column) {
+    if (row >= ZMK_MATRIX_ROWS || column >= ZMK_MATRIX_COLS) {
+        return -ERANGE;
+    }
+    return row * ZMK_MATRIX_COLS + column;
+}
+
+// Records a transition in the reported state. Returns false if the key is outside the matrix, so
+// a resync can't recover the transition.
+static bool report_state(uint32_t row, uint32_t column, bool pressed) {
+    int index = matrix_state_index(row, column);
+    if (index < 0) {
+        return false;
+    }
+
+    // Set before checking the overflow flag, so a resync started after this sees the change.
+    atomic_set_bit_to(reported_state, index, pressed);
+    return true;
+}
+
+static void queue_transitions(struct k_msgq *msgq, const void *msg, bool tracked) {
+    if (tracked && atomic_get(&msgq_overflowed)) {
+        // The resync after draining the queue picks up these transitions.
+    } else if (k_msgq_put(msgq, msg, K_NO_WAIT) == 0) {
+        zmk_pipeline_stats_queued(ZMK_PIPELINE_KSCAN_QUEUE, k_msgq_num_used_get(msgq));
+        zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_KSCAN, msgq);
+    } else if (tracked) {
+        LOG_WRN("KSCAN event queue full, resyncing the matrix state once it is drained");
+        atomic_set(&msgq_overflowed, true);
+    } else {
+        zmk_pipeline_stats_dropped(ZMK_PIPELINE_KSCAN_QUEUE);
+    }
+
+    if (atomic_get(&msgq_processing)) {
+        k_work_submit_to_queue(zmk_input_work_q(), &msg_processor.work);
+    }
+}
 
 static void zmk_kscan_callback(const struct device *dev, uint32_t row, uint32_t column,
                                bool pressed) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_KSCAN);
+
     struct zmk_kscan_event ev = {
         .row = row,
         .column = column,
-        .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED)};
+        .source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+        .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED),
+        // Stamp the transition when the driver reports it, not when the queue is drained, so a
+        // busy work queue doesn't skew tapping term and combo timeout decisions.
+        .timestamp = k_uptime_get()};
+
+    queue_transitions(&zmk_kscan_msgq, &ev, report_state(row, column, pressed));
+}
+
+#if PERIPHERAL_QUEUE_COUNT > 0
+void zmk_kscan_queue_peripheral_position(uint8_t source, uint32_t position, bool pressed,
+                                         int64_t timestamp) {
+    if (source >= PERIPHERAL_QUEUE_COUNT) {
+        LOG_ERR("Invalid peripheral source %d", source);
+        return;
+    }
+
+    struct k_msgq *msgq = &peripheral_msgqs[source];
+    struct zmk_kscan_event ev = {
+        .position = position,
+        .source = source,
+        .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED),
+        .timestamp = timestamp};
+
+    if (k_msgq_put(msgq, &ev, K_NO_WAIT) == 0) {
+        zmk_pipeline_stats_queued(ZMK_PIPELINE_SPLIT_QUEUE, k_msgq_num_used_get(msgq));
+        zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_POSITION, msgq);
+    } else {
+        LOG_WRN("Position queue for peripheral %d full, dropping a transition", source);
+        zmk_pipeline_stats_dropped(ZMK_PIPELINE_SPLIT_QUEUE);
+    }
+
+    if (atomic_get(&msgq_processing)) {
+        k_work_submit_to_queue(zmk_input_work_q(), &msg_processor.work);
+    }
+}
+
+uint32_t zmk_kscan_queued_peripheral_positions(uint8_t source) {
+    if (source >= PERIPHERAL_QUEUE_COUNT) {
+        return 0;
+    }
+    return k_msgq_num_used_get(&peripheral_msgqs[source]);
+}
+
+static int zmk_kscan_peripheral_queues_init(const struct device *_arg) {
+    for (int i = 0; i < PERIPHERAL_QUEUE_COUNT; i++) {
+        k_msgq_init(&peripheral_msgqs[i], peripheral_msgq_bufs[i], sizeof(struct zmk_kscan_event),
+                    CONFIG_ZMK_SPLIT_BLE_CENTRAL_POSITION_QUEUE_SIZE);
+    }
+    return 0;
+}
+
+// Before the split central starts, so the queues are ready for the first notification.
+ZMK_SYS_INIT(zmk_kscan_peripheral_queues_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+#endif /* PERIPHERAL_QUEUE_COUNT > 0 */
+
+#if USE_FRAMES
+static void zmk_kscan_frame_callback(const struct device *dev, const struct kscan_frame *frame) {
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_KSCAN);
+
+    if (frame->words > FRAME_WORDS) {
+        LOG_ERR("KSCAN frame of %d words is larger than the matrix", frame->words);
+        zmk_pipeline_stats_dropped(ZMK_PIPELINE_KSCAN_QUEUE);
+        return;
+    }
+
+    struct zmk_kscan_frame_msg msg = {
+        .words = frame->words,
+        .rows = frame->rows,
+        .timestamp = frame->timestamp,
+    };
+    bool tracked = true;
+
+    memcpy(msg.changed, frame->changed, frame->words * sizeof(msg.changed[0]));
+    memcpy(msg.pressed, frame->pressed, frame->words * sizeof(msg.pressed[0]));
+
+    for (int w = 0; w < msg.words; w++) {
+        for (uint32_t changed = msg.changed[w]; changed; changed &= changed - 1) {
+            const int i = w * 32 + __builtin_ctz(changed);
+
+            tracked = report_state(i % msg.rows, i / msg.rows, msg.pressed[w] & BIT(i % 32)) &&
+                      tracked;
+        }
+    }
+
+    queue_transitions(&zmk_kscan_frame_msgq, &msg, tracked);
+}
+#endif
+
+static void process_peripheral_event(const struct zmk_kscan_event *ev) {
+    bool pressed = (ev->state == ZMK_KSCAN_EVENT_STATE_PRESSED);
+
+    LOG_DBG("Peripheral %d position: %d, pressed: %s", ev->source, ev->position,
+            (pressed ? "true" : "false"));
+    ZMK_EVENT_RAISE(new_zmk_position_state_changed(
+        (struct zmk_position_state_changed){.source = ev->source,
+                                            .state = pressed,
+                                            .position = ev->position,
+                                            .timestamp = ev->timestamp}));
+}
+
+static void process_event(const struct zmk_kscan_event *ev) {
+    bool pressed = (ev->state == ZMK_KSCAN_EVENT_STATE_PRESSED);
+
+    if (ev->source != ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL) {
+        process_peripheral_event(ev);
+        return;
+    }
+
+    int index = matrix_state_index(ev->row, ev->column);
+    if (index >= 0) {
+        if (atomic_test_bit(delivered_state, index) == pressed) {
+            // Already delivered by a resync.
+            return;
+        }
+        atomic_set_bit_to(delivered_state, index, pressed);
+    }
+
+    uint32_t position = zmk_matrix_transform_row_column_to_position(ev->row, ev->column);
+    LOG_DBG("Row: %d, col: %d, position: %d, pressed: %s", ev->row, ev->column, position,
+            (pressed ? "true" : "false"));
+    zmk_hot_path_trace(ZMK_HOT_PATH_KSCAN, NULL, position, pressed);
+    zmk_flight_record(ZMK_FLIGHT_POSITION, position, pressed);
+    zmk_trace_recorder_record(ev->row, ev->column, pressed, ev->timestamp);
+    zmk_latency_benchmark_position(position, pressed);
+    zmk_trace_pin_toggle(ZMK_TRACE_PIN_POSITION);
+    ZMK_EVENT_RAISE(new_zmk_position_state_changed(
+        (struct zmk_position_state_changed){.source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+                                            .state = pressed,
+                                            .position = position,
+                                            .timestamp = ev->timestamp}));
+    zmk_pipeline_stats_processed(ev->timestamp);
+}
+
+static void resync_matrix_state() {
+    int64_t now = k_uptime_get();
 
-    k_msgq_put(&zmk_kscan_msgq, &ev, K_NO_WAIT);
-    k_work_submit(&msg_processor.work);
+    for (int i = 0; i < MATRIX_STATE_LEN; i++) {
+        bool pressed = atomic_test_bit(reported_state, i);
+        if (atomic_test_bit(delivered_state, i) == pressed) {
+            continue;
+        }
+
+        struct zmk_kscan_event ev = {
+            .row = i / ZMK_MATRIX_COLS,
+            .column = i % ZMK_MATRIX_COLS,
+            .source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+            .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED),
+            .timestamp = now};
+        process_event(&ev);
+    }
 }
 
+#if USE_FRAMES
+static void process_frame(const struct zmk_kscan_frame_msg *frame) {
+    // Skip the words without changes, and only look at the set bits of the rest.
+    for (int w = 0; w < frame->words; w++) {
+        for (uint32_t changed = frame->changed[w]; changed; changed &= changed - 1) {
+            const int bit = __builtin_ctz(changed);
+            const int i = w * 32 + bit;
+
+            struct zmk_kscan_event ev = {
+                .row = i % frame->rows,
+                .column = i / frame->rows,
+                .source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+                .state = (frame->pressed[w] & BIT(bit)) ? ZMK_KSCAN_EVENT_STATE_PRESSED
+                                                        : ZMK_KSCAN_EVENT_STATE_RELEASED,
+                .timestamp = frame->timestamp};
+            process_event(&ev);
+        }
+    }
+}
+#endif
+
 void zmk_kscan_process_msgq(struct k_work *item) {
-    struct zmk_kscan_event ev;
+    struct zmk_kscan_event evs[EVENT_QUEUE_COUNT];
+    bool have_event[EVENT_QUEUE_COUNT];
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_FRAME_BATCHING)
+    /*
+     * The driver queues every transition of a scan before this work item runs, so draining the
+     * queue processes one frame at a time.
+     */
+    zmk_endpoints_batch_begin();
+#endif
+
+    for (int i = 0; i < EVENT_QUEUE_COUNT; i++) {
+        have_event[i] = k_msgq_get(event_queue(i), &evs[i], K_NO_WAIT) == 0;
+    }
+
+#if USE_FRAMES
+    struct zmk_kscan_frame_msg frame;
+    bool have_frame = k_msgq_get(&zmk_kscan_frame_msgq, &frame, K_NO_WAIT) == 0;
+#endif
+
+    // The local and peripheral transitions are merged by their timestamps. Each queue is already
+    // in order, so only the oldest transition of each needs to be compared.
+    while (true) {
+        int next = -1;
+        for (int i = 0; i < EVENT_QUEUE_COUNT; i++) {
+            if (have_event[i] && (next < 0 || evs[i].timestamp < evs[next].timestamp)) {
+                next = i;
+            }
+        }
+
+#if USE_FRAMES
+        if (have_frame && (next < 0 || frame.timestamp < evs[next].timestamp)) {
+            process_frame(&frame);
+            have_frame = k_msgq_get(&zmk_kscan_frame_msgq, &frame, K_NO_WAIT) == 0;
+            continue;
+        }
+#endif
+
+        if (next < 0) {
+            break;
+        }
+
+        process_event(&evs[next]);
+        have_event[next] = k_msgq_get(event_queue(next), &evs[next], K_NO_WAIT) == 0;
+    }
+
+    // Transitions queued after the flag is cleared may also be found by the resync. Those are
+    // skipped when they are dequeued, since they no longer change the delivered state.
+    if (atomic_cas(&msgq_overflowed, true, false)) {
+        resync_matrix_state();
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_FRAME_BATCHING)
+    zmk_endpoints_batch_end();
+#endif
+}
+
+ZMK_WORK_WATCHDOG_WRAP(zmk_kscan_process_msgq)
+
+static int zmk_kscan_start(const struct device *dev) {
+    k_work_init(&msg_processor.work, ZMK_WORK_WATCHED(zmk_kscan_process_msgq));
 
-    while (k_msgq_get(&zmk_kscan_msgq, &ev, K_NO_WAIT) == 0) {
-        bool pressed = (ev.state == ZMK_KSCAN_EVENT_STATE_PRESSED);
-        uint32_t position = zmk_matrix_transform_row_column_to_position(ev.row, ev.column);
-        LOG_DBG("Row: %d, col: %d, position: %d, pressed: %s", ev.row, ev.column, position,
-                (pressed ? "true" : "false"));
-        ZMK_EVENT_RAISE(new_zmk_position_state_changed(
-            (struct zmk_position_state_changed){.source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
-                                                .state = pressed,
-                                                .position = position,
-                                                .timestamp = k_uptime_get()}));
+#if USE_FRAMES
+    if (kscan_frame_config(dev, zmk_kscan_frame_callback) != 0) {
+        LOG_WRN("KSCAN driver can't report frames, falling back to one callback per key");
+        kscan_config(dev, zmk_kscan_callback);
     }
+#else
+    kscan_config(dev, zmk_kscan_callback);
+#endif
+    kscan_enable_callback(dev);
+
+    kscan_started = true;
+    return 0;
 }
 
 int zmk_kscan_init(char *name) {
@@ -65,10 +430,44 @@ int zmk_kscan_init(char *name) {
         return -EINVAL;
     }
 
-    k_work_init(&msg_processor.work, zmk_kscan_process_msgq);
+    if (!kscan_started) {
+        zmk_kscan_start(dev);
+    }
 
-    kscan_config(dev, zmk_kscan_callback);
-    kscan_enable_callback(dev);
+    // Replay anything captured since the wake now that the keymap can handle it.
+    atomic_set(&msgq_processing, true);
+    k_work_submit_to_queue(zmk_input_work_q(), &msg_processor.work);
 
     return 0;
 }
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_WAKE_CAPTURE)
+static int zmk_kscan_wake_capture_init(const struct device *_arg) {
+    uint32_t cause = 0;
+
+    int err = hwinfo_get_reset_cause(&cause);
+    if (err) {
+        LOG_WRN("Failed to get the reset cause (err %d)", err);
+        return 0;
+    }
+
+    // The reset cause accumulates until cleared, so clear it for the next boot to read.
+    hwinfo_clear_reset_cause();
+
+    if (!(cause & RESET_LOW_POWER_WAKE)) {
+        return 0;
+    }
+
+    const struct device *dev = device_get_binding(DT_LABEL(ZMK_MATRIX_NODE_ID));
+    if (dev == NULL) {
+        LOG_ERR("Failed to get the KSCAN device");
+        return -EINVAL;
+    }
+
+    LOG_DBG("Woke from deep sleep, scanning early to capture the wake key");
+    return zmk_kscan_start(dev);
+}
+
+// Kscan drivers initialize at POST_KERNEL, so this is as early as they can be used.
+ZMK_SYS_INIT(zmk_kscan_wake_capture_init, APPLICATION, 0);
+#endif /* IS_ENABLED(CONFIG_ZMK_KSCAN_WAKE_CAPTURE) */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/latency_benchmark.h>
+
+// Key events are handled on the input work queue. Events raised by other threads, such as battery
+// updates, are counted as well, so the counts are only exact for scripted runs like the tests.
+static struct {
+    uint32_t position;
+    bool pressed;
+    bool started;
+    uint32_t start_cycles;
+    uint32_t dispatches;
+    uint32_t allocs;
+    uint32_t heap_allocs;
+} current;
+
+void zmk_latency_benchmark_position(uint32_t position, bool pressed) {
+    current.position = position;
+    current.pressed = pressed;
+    current.started = true;
+    current.dispatches = 0;
+    current.allocs = 0;
+    current.heap_allocs = 0;
+    current.start_cycles = k_cycle_get_32();
+}
+
+void zmk_latency_benchmark_dispatch() { current.dispatches++; }
+
+void zmk_latency_benchmark_alloc(bool heap) {
+    current.allocs++;
+    if (heap) {
+        current.heap_allocs++;
+    }
+}
+
+// One line of space separated key=value pairs per report, so benchmark logs can be parsed by
+// scripts. The counts are totals since the position event, which may lead to several reports.
+void zmk_latency_benchmark_report(uint16_t usage_page) {
+    if (!current.started) {
+        return;
+    }
+
+    uint32_t cycles = k_cycle_get_32() - current.start_cycles;
+
+    LOG_INF("latency: position=%d pressed=%d usage_page=0x%02X us=%u events=%u allocs=%u "
+            "heap=%u",
+            current.position, current.pressed, usage_page, k_cyc_to_us_floor32(cycles),
+            current.dispatches, current.allocs, current.heap_allocs);
+}
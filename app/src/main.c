@@ -12,6 +12,7 @@
 #include <logging/log.h>
 LOG_MODULE_REGISTER(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/matrix.h>
 #include <zmk/kscan.h>
 #include <zmk/display.h>
@@ -22,11 +23,19 @@ LOG_MODULE_REGISTER(zmk, CONFIG_ZMK_LOG_LEVEL);
 void main(void) {
     LOG_INF("Welcome to ZMK!\n");
 
-    if (zmk_kscan_init(ZMK_KSCAN_DEV) != 0) {
+    uint32_t start = zmk_boot_profile_start();
+    int err = zmk_kscan_init(ZMK_KSCAN_DEV);
+    zmk_boot_profile_record("zmk_kscan_init", start, err);
+    if (err != 0) {
+        zmk_boot_profile_log();
         return;
     }
 
 #ifdef CONFIG_ZMK_DISPLAY
-    zmk_display_init();
+    start = zmk_boot_profile_start();
+    err = zmk_display_init();
+    zmk_boot_profile_record("zmk_display_init", start, err);
 #endif /* CONFIG_ZMK_DISPLAY */
+
+    zmk_boot_profile_log();
 }
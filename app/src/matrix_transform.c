@@ -5,36 +5,60 @@
  */
 
 #include <zephyr.h>
+#include <errno.h>
 #include <zmk/matrix_transform.h>
 #include <zmk/matrix.h>
 #include <dt-bindings/zmk/matrix_transform.h>
 
 #ifdef ZMK_KEYMAP_TRANSFORM_NODE
 
+#define ROW_OFFSET DT_PROP_OR(ZMK_KEYMAP_TRANSFORM_NODE, row_offset, 0)
+#define COL_OFFSET DT_PROP_OR(ZMK_KEYMAP_TRANSFORM_NODE, col_offset, 0)
+
 #define _TRANSFORM_ENTRY(i, _)                                                                     \
     [(KT_ROW(DT_PROP_BY_IDX(ZMK_KEYMAP_TRANSFORM_NODE, map, i)) * ZMK_MATRIX_COLS) +               \
         KT_COL(DT_PROP_BY_IDX(ZMK_KEYMAP_TRANSFORM_NODE, map, i))] = i,
 
 static uint32_t transform[] = {UTIL_LISTIFY(ZMK_KEYMAP_LEN, _TRANSFORM_ENTRY, 0)};
 
-#endif
+// The offsets only move where this side's matrix starts in the table, so they are folded into the
+// base of the lookup instead of being added to each row and column.
+static uint32_t *const transform_base = &transform[ROW_OFFSET * ZMK_MATRIX_COLS + COL_OFFSET];
 
-uint32_t zmk_matrix_transform_row_column_to_position(uint32_t row, uint32_t column) {
-    uint32_t matrix_index;
+// The RC() value of each position, which is just the map itself.
+static const uint16_t positions[] = DT_PROP(ZMK_KEYMAP_TRANSFORM_NODE, map);
 
-#if DT_NODE_HAS_PROP(ZMK_KEYMAP_TRANSFORM_NODE, col_offset)
-    column += DT_PROP(ZMK_KEYMAP_TRANSFORM_NODE, col_offset);
 #endif
 
-#if DT_NODE_HAS_PROP(ZMK_KEYMAP_TRANSFORM_NODE, row_offset)
-    row += DT_PROP(ZMK_KEYMAP_TRANSFORM_NODE, row_offset);
-#endif
-
-    matrix_index = (row * ZMK_MATRIX_COLS) + column;
+uint32_t zmk_matrix_transform_row_column_to_position(uint32_t row, uint32_t column) {
+    uint32_t matrix_index = (row * ZMK_MATRIX_COLS) + column;
 
 #ifdef ZMK_KEYMAP_TRANSFORM_NODE
-    return transform[matrix_index];
+    return transform_base[matrix_index];
 #else
     return matrix_index;
 #endif /* ZMK_KEYMAP_TRANSFORM_NODE */
 };
+
+int zmk_matrix_transform_position_to_row_column(uint32_t position, uint32_t *row,
+                                                uint32_t *column) {
+    if (position >= ZMK_KEYMAP_LEN) {
+        return -EINVAL;
+    }
+
+#ifdef ZMK_KEYMAP_TRANSFORM_NODE
+    uint32_t rc = positions[position];
+
+    if (KT_ROW(rc) < ROW_OFFSET || KT_COL(rc) < COL_OFFSET) {
+        return -EINVAL;
+    }
+
+    *row = KT_ROW(rc) - ROW_OFFSET;
+    *column = KT_COL(rc) - COL_OFFSET;
+#else
+    *row = position / ZMK_MATRIX_COLS;
+    *column = position % ZMK_MATRIX_COLS;
+#endif /* ZMK_KEYMAP_TRANSFORM_NODE */
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <shell/shell.h>
+#include <sys/atomic.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/memory_stats.h>
+
+static const char *const queue_names[] = {
+    [ZMK_MEMORY_QUEUE_KSCAN] = "kscan",
+    [ZMK_MEMORY_QUEUE_BEHAVIORS] = "behaviors",
+    [ZMK_MEMORY_QUEUE_HOG_KEYBOARD] = "hog_keyboard",
+    [ZMK_MEMORY_QUEUE_HOG_CONSUMER] = "hog_consumer",
+    [ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_POSITION] = "split_central_position",
+    [ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_RUN] = "split_central_run",
+    [ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_STATE] = "split_peripheral_position_state",
+    [ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_EVENT] = "split_peripheral_position_event",
+    [ZMK_MEMORY_QUEUE_SPLIT_WIRED_TX] = "split_wired_tx",
+    [ZMK_MEMORY_QUEUE_SPLIT_WIRED_RX] = "split_wired_rx",
+    [ZMK_MEMORY_QUEUE_DEFERRED_EVENTS] = "deferred_events",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(queue_names) == ZMK_MEMORY_QUEUE_COUNT, "Every queue needs a name");
+
+struct queue_stats {
+    atomic_t peak_used;
+    // Only known once the queue was used, since some queues are set up at runtime.
+    atomic_t capacity;
+};
+
+static struct queue_stats queues[ZMK_MEMORY_QUEUE_COUNT];
+
+static atomic_t heap_used;
+static atomic_t peak_heap_used;
+
+// Raises `peak` to `value` if it's higher, without losing a higher value stored concurrently.
+static void update_peak(atomic_t *peak, atomic_val_t value) {
+    atomic_val_t current;
+
+    do {
+        current = atomic_get(peak);
+        if (value <= current) {
+            return;
+        }
+    } while (!atomic_cas(peak, current, value));
+}
+
+void zmk_memory_stats_queue_used(enum zmk_memory_queue queue, uint32_t used, uint32_t capacity) {
+    atomic_set(&queues[queue].capacity, capacity);
+    update_peak(&queues[queue].peak_used, used);
+}
+
+void zmk_memory_stats_heap_allocated(size_t size) {
+    update_peak(&peak_heap_used, atomic_add(&heap_used, size) + size);
+}
+
+void zmk_memory_stats_heap_freed(size_t size) { atomic_sub(&heap_used, size); }
+
+static void print_stack(const struct k_thread *thread, void *user_data) {
+    const struct shell *sh = user_data;
+    const char *name = k_thread_name_get((k_tid_t)thread);
+    size_t unused;
+
+    if (k_thread_stack_space_get(thread, &unused) != 0) {
+        return;
+    }
+
+    shell_print(sh, "  %-32s %6zu of %6zu bytes unused", name && name[0] ? name : "?", unused,
+                thread->stack_info.size);
+}
+
+static int cmd_show(const struct shell *sh, size_t argc, char **argv) {
+    shell_print(sh, "Queues (peak used of capacity):");
+    for (int i = 0; i < ZMK_MEMORY_QUEUE_COUNT; i++) {
+        if (atomic_get(&queues[i].capacity) == 0) {
+            continue;
+        }
+
+        shell_print(sh, "  %-32s %4ld of %4ld", queue_names[i], atomic_get(&queues[i].peak_used),
+                    atomic_get(&queues[i].capacity));
+    }
+
+    // Events are the only thing allocated from the heap while typing. The count excludes the
+    // allocator's own overhead per block.
+    shell_print(sh, "Heap: %ld bytes of events in use, peak %ld of %d", atomic_get(&heap_used),
+                atomic_get(&peak_heap_used), CONFIG_HEAP_MEM_POOL_SIZE);
+
+    shell_print(sh, "Thread stacks:");
+    k_thread_foreach(print_stack, (void *)sh);
+
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ZMK_MEMORY_QUEUE_COUNT; i++) {
+        atomic_set(&queues[i].peak_used, 0);
+    }
+
+    atomic_set(&peak_heap_used, atomic_get(&heap_used));
+
+    shell_print(sh, "Memory peaks reset, stack usage can't be reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_memory,
+                               SHELL_CMD(show, NULL, "Print peak queue, heap and stack usage",
+                                         cmd_show),
+                               SHELL_CMD(reset, NULL, "Reset the queue and heap peaks", cmd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(memory, &sub_memory, "ZMK memory usage commands", NULL);
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <init.h>
+#include <kernel.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <dt-bindings/zmk/keys.h>
+#include <zmk/boot_profile.h>
+#include <zmk/hid.h>
+#include <zmk/micro_benchmark.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+#include <zmk/events/position_state_changed.h>
+
+#if IS_ENABLED(CONFIG_BOARD_NATIVE_POSIX) || IS_ENABLED(CONFIG_BOARD_NATIVE_POSIX_64BIT)
+#include <native_rtc.h>
+
+// native_posix runs in virtual time, where the kernel clock stands still while code runs, so the
+// benchmarks are timed with the host's clock instead.
+static uint64_t start_time() { return native_rtc_gettime_us(RTC_CLOCK_REALTIME); }
+
+static uint64_t elapsed_ns(uint64_t start) {
+    return (native_rtc_gettime_us(RTC_CLOCK_REALTIME) - start) * NSEC_PER_USEC;
+}
+#else
+// The cycle counter wraps, so each benchmark must take less than one wrap.
+static uint64_t start_time() { return k_cycle_get_32(); }
+
+static uint64_t elapsed_ns(uint64_t start) {
+    return k_cyc_to_ns_floor64((uint32_t)(k_cycle_get_32() - (uint32_t)start));
+}
+#endif
+
+static uint32_t allocs;
+
+void zmk_micro_benchmark_alloc() { allocs++; }
+
+// One line of space separated key=value pairs per benchmark, like the latency benchmark, so the
+// results can be parsed by scripts.
+void zmk_micro_benchmark_run(const char *name, void (*op)(uint32_t i), uint32_t iterations) {
+    allocs = 0;
+
+    uint64_t start = start_time();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        op(i);
+    }
+
+    uint64_t elapsed = elapsed_ns(start);
+    uint32_t allocs_x100 = (uint32_t)((uint64_t)allocs * 100 / iterations);
+
+    LOG_INF("bench: name=%s ns_per_op=%u iterations=%u allocs_per_op=%u.%02u", name,
+            (uint32_t)(elapsed / iterations), iterations, allocs_x100 / 100, allocs_x100 % 100);
+}
+
+#define HELD_KEYS 5
+
+// Five keys held, so the sixth fills the last slot of a boot report.
+static void hid_press_release(uint32_t i) {
+    zmk_hid_press(ZMK_HID_USAGE(HID_USAGE_KEY, HID_USAGE_KEY_KEYBOARD_F));
+    zmk_hid_release(ZMK_HID_USAGE(HID_USAGE_KEY, HID_USAGE_KEY_KEYBOARD_F));
+}
+
+static void position_state_changed(uint32_t i) {
+    for (int pressed = 1; pressed >= 0; pressed--) {
+        ZMK_EVENT_RAISE(new_zmk_position_state_changed(
+            (struct zmk_position_state_changed){.source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+                                                .state = pressed,
+                                                .position = CONFIG_ZMK_MICRO_BENCHMARK_POSITION,
+                                                .timestamp = k_uptime_get()}));
+    }
+}
+
+static void micro_benchmark_work_handler(struct k_work *work) {
+    const uint32_t iterations = CONFIG_ZMK_MICRO_BENCHMARK_ITERATIONS;
+
+    for (int i = 0; i < HELD_KEYS; i++) {
+        zmk_hid_press(ZMK_HID_USAGE(HID_USAGE_KEY, HID_USAGE_KEY_KEYBOARD_A + i));
+    }
+    zmk_micro_benchmark_run("hid_press_release", hid_press_release, iterations);
+    zmk_hid_keyboard_clear();
+
+    zmk_micro_benchmark_run("position_state_changed", position_state_changed, iterations);
+
+    zmk_micro_benchmark_debounce(iterations);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(micro_benchmark_work_handler)
+static K_WORK_DELAYABLE_DEFINE(micro_benchmark_work,
+                               ZMK_WORK_WATCHED(micro_benchmark_work_handler));
+
+// The benchmarks run on the input work queue, like the code they measure, once anything the test
+// keymap sets up first has been handled.
+static int zmk_micro_benchmark_init(const struct device *_arg) {
+    k_work_schedule_for_queue(zmk_input_work_q(), &micro_benchmark_work,
+                              K_MSEC(CONFIG_ZMK_MICRO_BENCHMARK_DELAY));
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_micro_benchmark_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
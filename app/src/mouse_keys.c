@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/behavior_timer.h>
+#include <zmk/endpoints.h>
+#include <zmk/hid.h>
+#include <zmk/mouse_keys.h>
+
+// Speed factors and distances are fixed point numbers with this many fractional bits.
+#define FRACTION_BITS 16
+#define FIXED_ONE BIT(FRACTION_BITS)
+
+#define AXIS_X 0
+#define AXIS_Y 1
+
+struct held_mouse_key {
+    bool active;
+    uint32_t position;
+    enum zmk_mouse_keys_type type;
+    int16_t speed[2];
+    const struct zmk_mouse_keys_curve *curve;
+    int64_t timestamp;
+};
+
+// Everything here runs on the input work queue, with the behaviors and the tick timer.
+static struct held_mouse_key held_keys[CONFIG_ZMK_MOUSE_KEYS_MAX_HELD];
+static int held_count;
+
+// Uptime of the last tick. Keys pressed since then only move for the time they were held.
+static int64_t last_tick;
+
+// Distance moved but not yet added to the mouse report, in pixels or 1/16 wheel detents. The
+// fractions carry over so slow keys still add up to whole steps.
+static int64_t pending_distance[2][2];
+
+static void mouse_keys_tick(struct zmk_behavior_timer *timer);
+
+static struct zmk_behavior_timer tick_timer = ZMK_BEHAVIOR_TIMER_INITIALIZER(mouse_keys_tick);
+
+// The fraction of full speed reached `held_ms` after the press, from 0 to FIXED_ONE.
+static uint32_t speed_factor(const struct zmk_mouse_keys_curve *curve, int64_t held_ms) {
+    if (curve->acceleration_exponent == 0 || held_ms >= curve->time_to_max_speed_ms) {
+        return FIXED_ONE;
+    }
+
+    const uint32_t progress = (MAX(held_ms, 0) << FRACTION_BITS) / curve->time_to_max_speed_ms;
+    uint32_t factor = FIXED_ONE;
+
+    for (int i = 0; i < curve->acceleration_exponent; i++) {
+        factor = ((uint64_t)factor * progress) >> FRACTION_BITS;
+    }
+
+    return factor;
+}
+
+// Takes the whole steps out of a pending distance, leaving the fraction.
+static int32_t take_whole_steps(int64_t *distance) {
+    const int32_t steps = *distance / FIXED_ONE;
+
+    *distance -= (int64_t)steps * FIXED_ONE;
+    return steps;
+}
+
+static void mouse_keys_tick(struct zmk_behavior_timer *timer) {
+    const int64_t now = k_uptime_get();
+
+    for (int i = 0; i < ARRAY_SIZE(held_keys); i++) {
+        const struct held_mouse_key *key = &held_keys[i];
+
+        if (!key->active) {
+            continue;
+        }
+
+        const int64_t from = MAX(key->timestamp, last_tick);
+        if (now <= from) {
+            continue;
+        }
+
+        // Sampling the curve halfway through the interval follows it closely even as it bends.
+        const uint32_t factor = speed_factor(key->curve, (from + now) / 2 - key->timestamp);
+        const int32_t unit =
+            key->type == ZMK_MOUSE_KEYS_SCROLL ? ZMK_HID_MOUSE_SCROLL_RESOLUTION : 1;
+
+        for (int axis = AXIS_X; axis <= AXIS_Y; axis++) {
+            pending_distance[key->type][axis] +=
+                (int64_t)key->speed[axis] * unit * factor * (now - from) / MSEC_PER_SEC;
+        }
+    }
+
+    last_tick = now;
+
+    const int32_t move_x = take_whole_steps(&pending_distance[ZMK_MOUSE_KEYS_MOVE][AXIS_X]);
+    const int32_t move_y = take_whole_steps(&pending_distance[ZMK_MOUSE_KEYS_MOVE][AXIS_Y]);
+    const int32_t scroll_x = take_whole_steps(&pending_distance[ZMK_MOUSE_KEYS_SCROLL][AXIS_X]);
+    const int32_t scroll_y = take_whole_steps(&pending_distance[ZMK_MOUSE_KEYS_SCROLL][AXIS_Y]);
+
+    // One report per tick carries the motion of every held key.
+    if (move_x || move_y || scroll_x || scroll_y) {
+        LOG_DBG("move %d,%d scroll %d,%d", move_x, move_y, scroll_x, scroll_y);
+
+        zmk_hid_mouse_movement_add(move_x, move_y);
+        zmk_hid_mouse_scroll_add(scroll_y, scroll_x);
+        zmk_endpoints_send_mouse_report();
+    }
+
+    if (held_count > 0) {
+        zmk_behavior_timer_schedule(&tick_timer, now + CONFIG_ZMK_MOUSE_KEYS_TICK_MS);
+    }
+}
+
+int zmk_mouse_keys_start(uint32_t position, enum zmk_mouse_keys_type type, int16_t x, int16_t y,
+                         const struct zmk_mouse_keys_curve *curve, int64_t timestamp) {
+    for (int i = 0; i < ARRAY_SIZE(held_keys); i++) {
+        struct held_mouse_key *key = &held_keys[i];
+
+        if (key->active) {
+            continue;
+        }
+
+        *key = (struct held_mouse_key){
+            .active = true,
+            .position = position,
+            .type = type,
+            .speed = {x, y},
+            .curve = curve,
+            .timestamp = timestamp,
+        };
+
+        // The first key starts the tick, without fractions left over from the last keys.
+        if (held_count++ == 0) {
+            last_tick = timestamp;
+            memset(pending_distance, 0, sizeof(pending_distance));
+            zmk_behavior_timer_schedule(&tick_timer,
+                                        k_uptime_get() + CONFIG_ZMK_MOUSE_KEYS_TICK_MS);
+        }
+
+        return 0;
+    }
+
+    LOG_WRN("Too many mouse keys held, ignoring the one at position %d", position);
+    return -ENOMEM;
+}
+
+int zmk_mouse_keys_stop(uint32_t position, enum zmk_mouse_keys_type type) {
+    for (int i = 0; i < ARRAY_SIZE(held_keys); i++) {
+        struct held_mouse_key *key = &held_keys[i];
+
+        if (!key->active || key->position != position || key->type != type) {
+            continue;
+        }
+
+        key->active = false;
+
+        // The tick stops by itself once it finds no keys held.
+        held_count--;
+
+        return 0;
+    }
+
+    return -ENOENT;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <sys/atomic.h>
+
+#include <dt-bindings/zmk/hid_usage_pages.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/pipeline_stats.h>
+
+static const char *const queue_names[] = {
+    [ZMK_PIPELINE_KSCAN_QUEUE] = "kscan",
+    [ZMK_PIPELINE_SPLIT_QUEUE] = "split",
+    [ZMK_PIPELINE_CAPTURE_QUEUE] = "capture",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(queue_names) == ZMK_PIPELINE_QUEUE_COUNT,
+             "Every pipeline queue needs a name");
+
+struct queue_stats {
+    atomic_t peak_depth;
+    atomic_t dropped;
+};
+
+static struct queue_stats queues[ZMK_PIPELINE_QUEUE_COUNT];
+
+// Events are the only thing allocated from the heap while typing.
+static atomic_t heap_events;
+static atomic_t peak_heap_events;
+static atomic_t alloc_failures;
+
+static atomic_t worst_latency_ms;
+
+// Presses minus releases of each keyboard page keycode sent to the host. Only the thread handling
+// keycode events updates them.
+static int16_t keycode_balance[256];
+static uint32_t unmatched_releases;
+
+// Raises `peak` to `value` if it's higher, without losing a higher value stored concurrently.
+static void update_peak(atomic_t *peak, atomic_val_t value) {
+    atomic_val_t current;
+
+    do {
+        current = atomic_get(peak);
+        if (value <= current) {
+            return;
+        }
+    } while (!atomic_cas(peak, current, value));
+}
+
+void zmk_pipeline_stats_queued(enum zmk_pipeline_queue queue, uint32_t depth) {
+    update_peak(&queues[queue].peak_depth, depth);
+}
+
+void zmk_pipeline_stats_dropped(enum zmk_pipeline_queue queue) {
+    atomic_inc(&queues[queue].dropped);
+}
+
+void zmk_pipeline_stats_event_allocated(bool heap) {
+    if (heap) {
+        update_peak(&peak_heap_events, atomic_inc(&heap_events) + 1);
+    }
+}
+
+void zmk_pipeline_stats_event_freed(bool heap) {
+    if (heap) {
+        atomic_dec(&heap_events);
+    }
+}
+
+void zmk_pipeline_stats_event_alloc_failed() { atomic_inc(&alloc_failures); }
+
+void zmk_pipeline_stats_processed(int64_t timestamp) {
+    update_peak(&worst_latency_ms, MAX(k_uptime_get() - timestamp, 0));
+}
+
+void zmk_pipeline_stats_keycode(uint16_t usage_page, uint32_t keycode, bool pressed) {
+    if (usage_page != HID_USAGE_KEY || keycode >= ARRAY_SIZE(keycode_balance)) {
+        return;
+    }
+
+    if (pressed) {
+        keycode_balance[keycode]++;
+    } else if (keycode_balance[keycode]-- <= 0) {
+        unmatched_releases++;
+    }
+}
+
+void zmk_pipeline_stats_get(struct zmk_pipeline_stats *stats) {
+    for (int i = 0; i < ZMK_PIPELINE_QUEUE_COUNT; i++) {
+        stats->peak_depth[i] = atomic_get(&queues[i].peak_depth);
+        stats->dropped[i] = atomic_get(&queues[i].dropped);
+    }
+
+    stats->peak_heap_events = atomic_get(&peak_heap_events);
+    stats->alloc_failures = atomic_get(&alloc_failures);
+    stats->worst_latency_ms = atomic_get(&worst_latency_ms);
+}
+
+// One line of space separated key=value pairs per queue and one for the rest, so stress test
+// logs can be parsed by scripts.
+void zmk_pipeline_stats_log() {
+    for (int i = 0; i < ZMK_PIPELINE_QUEUE_COUNT; i++) {
+        LOG_INF("pipeline: queue=%s peak_depth=%ld dropped=%ld", queue_names[i],
+                atomic_get(&queues[i].peak_depth), atomic_get(&queues[i].dropped));
+    }
+
+    LOG_INF("pipeline: peak_heap_events=%ld alloc_failures=%ld worst_latency_ms=%ld",
+            atomic_get(&peak_heap_events), atomic_get(&alloc_failures),
+            atomic_get(&worst_latency_ms));
+
+    int unreleased = 0;
+    for (int i = 0; i < ARRAY_SIZE(keycode_balance); i++) {
+        if (keycode_balance[i] > 0) {
+            unreleased++;
+        }
+    }
+
+    LOG_INF("pipeline: unreleased_keycodes=%d unmatched_releases=%u", unreleased,
+            unmatched_releases);
+}
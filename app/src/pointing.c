@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define DT_DRV_COMPAT zmk_pointing
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/sensor.h>
+#include <init.h>
+#include <kernel.h>
+#include <sys/atomic.h>
+#include <sys/util.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/pointing.h>
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT) && !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#define POINTING_FORWARD_TO_CENTRAL 1
+#include <zmk/split/bluetooth/service.h>
+#else
+#define POINTING_FORWARD_TO_CENTRAL 0
+#include <zmk/endpoints.h>
+#include <zmk/hid.h>
+#include <zmk/keymap.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+#endif
+
+// Scales value by numerator / denominator. What the division drops is carried into the next call,
+// so slow motion adds up to whole steps instead of being rounded away.
+static int32_t scale_motion(int32_t value, int32_t numerator, int32_t denominator,
+                            int32_t *remainder) {
+    const int32_t scaled = value * numerator + *remainder;
+
+    *remainder = scaled % denominator;
+    return scaled / denominator;
+}
+
+struct pointing_device {
+    const struct device *dev;
+    struct sensor_trigger trigger;
+    int16_t multiplier;
+    int16_t divisor;
+    bool swap_xy;
+    bool invert_x;
+    bool invert_y;
+    int32_t remainder_x;
+    int32_t remainder_y;
+};
+
+#define POINTING_DEVICE(node)                                                                      \
+    {                                                                                              \
+        .dev = DEVICE_DT_GET(DT_PHANDLE(node, device)),                                            \
+        .trigger = {.type = SENSOR_TRIG_DATA_READY, .chan = SENSOR_CHAN_ALL},                      \
+        .multiplier = DT_PROP(node, scale_multiplier),                                             \
+        .divisor = DT_PROP(node, scale_divisor),                                                   \
+        .swap_xy = DT_PROP(node, swap_xy),                                                         \
+        .invert_x = DT_PROP(node, invert_x),                                                       \
+        .invert_y = DT_PROP(node, invert_y),                                                       \
+    },
+
+static struct pointing_device pointing_devices[] = {DT_INST_FOREACH_CHILD(0, POINTING_DEVICE)};
+
+#if !POINTING_FORWARD_TO_CENTRAL
+
+#define LAYER_BIT(i, prop) ZMK_KEYMAP_LAYER_BIT(DT_INST_PROP_BY_IDX(0, prop, i)) |
+#define LAYERS_MASK(prop) (UTIL_LISTIFY(DT_INST_PROP_LEN_OR(0, prop, 0), LAYER_BIT, prop) 0)
+
+static const zmk_keymap_layers_state_t scroll_layers = LAYERS_MASK(scroll_layers);
+static const zmk_keymap_layers_state_t precision_layers = LAYERS_MASK(precision_layers);
+
+BUILD_ASSERT(DT_INST_PROP(0, scroll_divisor) > 0, "scroll-divisor must be positive");
+BUILD_ASSERT(DT_INST_PROP(0, precision_divisor) > 0, "precision-divisor must be positive");
+
+enum pointing_mode {
+    POINTING_MODE_MOVE,
+    POINTING_MODE_SCROLL,
+    POINTING_MODE_PRECISION,
+};
+
+// Motion received but not yet added to the mouse report. Samples arriving while the work item is
+// pending are applied together.
+static atomic_t pending_dx;
+static atomic_t pending_dy;
+
+static enum pointing_mode last_mode;
+static int32_t mode_remainder_x;
+static int32_t mode_remainder_y;
+
+static enum pointing_mode current_mode() {
+    const zmk_keymap_layers_state_t state = zmk_keymap_layer_state();
+
+    if (state & scroll_layers) {
+        return POINTING_MODE_SCROLL;
+    }
+
+    if (state & precision_layers) {
+        return POINTING_MODE_PRECISION;
+    }
+
+    return POINTING_MODE_MOVE;
+}
+
+static void pointing_motion_work_cb(struct k_work *work) {
+    const int32_t dx = atomic_clear(&pending_dx);
+    const int32_t dy = atomic_clear(&pending_dy);
+
+    if (dx == 0 && dy == 0) {
+        return;
+    }
+
+    const enum pointing_mode mode = current_mode();
+
+    // Partial steps from the old mode mean nothing in the new one.
+    if (mode != last_mode) {
+        last_mode = mode;
+        mode_remainder_x = 0;
+        mode_remainder_y = 0;
+    }
+
+    switch (mode) {
+    case POINTING_MODE_SCROLL:
+        // Moving up scrolls up, which is a positive wheel value, and moving right pans right.
+        zmk_hid_mouse_scroll_add(scale_motion(-dy, ZMK_HID_MOUSE_SCROLL_RESOLUTION,
+                                              DT_INST_PROP(0, scroll_divisor), &mode_remainder_y),
+                                 scale_motion(dx, ZMK_HID_MOUSE_SCROLL_RESOLUTION,
+                                              DT_INST_PROP(0, scroll_divisor), &mode_remainder_x));
+        break;
+    case POINTING_MODE_PRECISION:
+        zmk_hid_mouse_movement_add(
+            scale_motion(dx, 1, DT_INST_PROP(0, precision_divisor), &mode_remainder_x),
+            scale_motion(dy, 1, DT_INST_PROP(0, precision_divisor), &mode_remainder_y));
+        break;
+    default:
+        zmk_hid_mouse_movement_add(dx, dy);
+        break;
+    }
+
+    zmk_endpoints_send_mouse_report();
+}
+
+ZMK_WORK_WATCHDOG_WRAP(pointing_motion_work_cb)
+K_WORK_DEFINE(pointing_motion_work, ZMK_WORK_WATCHED(pointing_motion_work_cb));
+
+void zmk_pointing_motion_received(int16_t dx, int16_t dy) {
+    atomic_add(&pending_dx, dx);
+    atomic_add(&pending_dy, dy);
+
+    k_work_submit_to_queue(zmk_input_work_q(), &pointing_motion_work);
+}
+
+#endif /* !POINTING_FORWARD_TO_CENTRAL */
+
+static void pointing_trigger_handler(const struct device *dev, struct sensor_trigger *trigger) {
+    struct pointing_device *device = CONTAINER_OF(trigger, struct pointing_device, trigger);
+    struct sensor_value dx, dy;
+
+    int err = sensor_sample_fetch(dev);
+    if (err) {
+        LOG_WRN("Failed to fetch sample from pointing device %d", err);
+        return;
+    }
+
+    err = sensor_channel_get(dev, SENSOR_CHAN_POS_DX, &dx);
+    if (!err) {
+        err = sensor_channel_get(dev, SENSOR_CHAN_POS_DY, &dy);
+    }
+
+    if (err) {
+        LOG_WRN("Failed to get motion from pointing device %d", err);
+        return;
+    }
+
+    int32_t x = device->swap_xy ? dy.val1 : dx.val1;
+    int32_t y = device->swap_xy ? dx.val1 : dy.val1;
+
+    x = scale_motion(device->invert_x ? -x : x, device->multiplier, device->divisor,
+                     &device->remainder_x);
+    y = scale_motion(device->invert_y ? -y : y, device->multiplier, device->divisor,
+                     &device->remainder_y);
+
+    if (x == 0 && y == 0) {
+        return;
+    }
+
+    x = CLAMP(x, INT16_MIN, INT16_MAX);
+    y = CLAMP(y, INT16_MIN, INT16_MAX);
+
+#if POINTING_FORWARD_TO_CENTRAL
+    zmk_split_bt_pointing_motion(x, y);
+#else
+    zmk_pointing_motion_received(x, y);
+#endif
+}
+
+static int zmk_pointing_init(const struct device *_arg) {
+    for (int i = 0; i < ARRAY_SIZE(pointing_devices); i++) {
+        struct pointing_device *device = &pointing_devices[i];
+
+        if (device->divisor <= 0) {
+            LOG_ERR("Pointing device %s has an invalid scale divisor", device->dev->name);
+            continue;
+        }
+
+        if (!device_is_ready(device->dev)) {
+            LOG_WRN("Pointing device %s is not ready", device->dev->name);
+            continue;
+        }
+
+        int err = sensor_trigger_set(device->dev, &device->trigger, pointing_trigger_handler);
+        if (err) {
+            LOG_ERR("Failed to set the trigger for pointing device %s: %d", device->dev->name,
+                    err);
+        }
+    }
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_pointing_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -9,21 +9,34 @@
 #include <kernel.h>
 #include <settings/settings.h>
 
-#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SIMD32) && __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
 
 #include <logging/log.h>
 
 #include <drivers/led_strip.h>
 #include <drivers/ext_power.h>
+#include <sys/atomic.h>
 
+#include <zmk/boot_profile.h>
+#include <zmk/energy_stats.h>
+#include <zmk/ext_power.h>
 #include <zmk/rgb_underglow.h>
+#include <zmk/settings.h>
 
 #include <zmk/activity.h>
 #include <zmk/usb.h>
 #include <zmk/event_manager.h>
+#include <zmk/keymap.h>
 #include <zmk/events/activity_state_changed.h>
+#include <zmk/events/layer_state_changed.h>
+#include <zmk/events/position_state_changed.h>
 #include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/work_watchdog.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -34,6 +47,14 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #define SAT_MAX 100
 #define BRT_MAX 100
 
+#define TICK_MS 50
+
+#define HAS_KEYMAP (!IS_ENABLED(CONFIG_ZMK_SPLIT) || IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL))
+
+#if DT_HAS_CHOSEN(zmk_underglow_key_leds)
+#define KEY_LEDS_NODE DT_CHOSEN(zmk_underglow_key_leds)
+#endif
+
 BUILD_ASSERT(CONFIG_ZMK_RGB_UNDERGLOW_BRT_MIN <= CONFIG_ZMK_RGB_UNDERGLOW_BRT_MAX,
              "ERROR: RGB underglow maximum brightness is less than minimum brightness");
 
@@ -42,6 +63,11 @@ enum rgb_underglow_effect {
     UNDERGLOW_EFFECT_BREATHE,
     UNDERGLOW_EFFECT_SPECTRUM,
     UNDERGLOW_EFFECT_SWIRL,
+    UNDERGLOW_EFFECT_LAYER,
+#if defined(KEY_LEDS_NODE)
+    UNDERGLOW_EFFECT_REACTIVE,
+    UNDERGLOW_EFFECT_HEATMAP,
+#endif
     UNDERGLOW_EFFECT_NUMBER // Used to track number of underglow effects
 };
 
@@ -56,6 +82,29 @@ struct rgb_underglow_state {
 static const struct device *led_strip;
 
 static struct led_rgb pixels[STRIP_NUM_PIXELS];
+// Set when pixels no longer matches what the strip shows.
+static bool pixels_changed = true;
+
+#if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_TRANSFER_THREAD)
+K_THREAD_STACK_DEFINE(underglow_transfer_stack_area,
+                      CONFIG_ZMK_RGB_UNDERGLOW_TRANSFER_THREAD_STACK_SIZE);
+
+static struct k_work_q underglow_transfer_q;
+
+// Frame copies handed to the strip driver, since some drivers convert them to their wire format in
+// place. One is being sent while the tick fills the other, and only the newest frame is sent.
+static struct led_rgb strip_frames[2][STRIP_NUM_PIXELS];
+static uint8_t strip_back_frame;
+static bool strip_back_ready;
+static struct k_spinlock strip_frames_lock;
+#else
+// The copy handed to the strip driver, since some drivers convert it to their wire format in place.
+static struct led_rgb strip_pixels[STRIP_NUM_PIXELS];
+#endif
+
+// Animations advance with the time since the last tick, so late or skipped ticks don't slow them.
+static int64_t last_animation_time;
+static uint32_t animation_remainder;
 
 static struct rgb_underglow_state state;
 
@@ -74,104 +123,364 @@ static struct zmk_led_hsb hsb_scale_zero_max(struct zmk_led_hsb hsb) {
     return hsb;
 }
 
+// Brightness percentage to channel value, so the conversion below only needs integer math.
+#define BRT_TO_CHANNEL(i, _) ((i)*255 / BRT_MAX),
+
+static const uint8_t brt_to_channel[BRT_MAX + 1] = {UTIL_LISTIFY(BRT_MAX + 1, BRT_TO_CHANNEL)};
+
 static struct led_rgb hsb_to_rgb(struct zmk_led_hsb hsb) {
-    double r, g, b;
+    // The position within the 60 degree hue sector times the saturation, out of 60 * SAT_MAX.
+    const uint32_t scale = 60 * SAT_MAX;
+    const uint32_t f = hsb.h % 60;
+    const uint32_t s = MIN(hsb.s, SAT_MAX);
+    const uint32_t v = brt_to_channel[MIN(hsb.b, BRT_MAX)];
 
-    uint8_t i = hsb.h / 60;
-    double v = hsb.b / ((float)BRT_MAX);
-    double s = hsb.s / ((float)SAT_MAX);
-    double f = hsb.h / ((float)HUE_MAX) * 6 - i;
-    double p = v * (1 - s);
-    double q = v * (1 - f * s);
-    double t = v * (1 - (1 - f) * s);
+    const uint8_t p = v * (SAT_MAX - s) / SAT_MAX;
+    const uint8_t q = v * (scale - f * s) / scale;
+    const uint8_t t = v * (scale - (60 - f) * s) / scale;
 
-    switch (i % 6) {
+    switch ((hsb.h / 60) % 6) {
     case 0:
-        r = v;
-        g = t;
-        b = p;
-        break;
+        return (struct led_rgb){r : v, g : t, b : p};
     case 1:
-        r = q;
-        g = v;
-        b = p;
-        break;
+        return (struct led_rgb){r : q, g : v, b : p};
     case 2:
-        r = p;
-        g = v;
-        b = t;
-        break;
+        return (struct led_rgb){r : p, g : v, b : t};
     case 3:
-        r = p;
-        g = q;
-        b = v;
-        break;
+        return (struct led_rgb){r : p, g : q, b : v};
     case 4:
-        r = t;
-        g = p;
-        b = v;
-        break;
-    case 5:
-        r = v;
-        g = p;
-        b = q;
-        break;
+        return (struct led_rgb){r : t, g : p, b : v};
+    default:
+        return (struct led_rgb){r : v, g : p, b : q};
     }
+}
+
+#if CONFIG_ZMK_RGB_UNDERGLOW_CURRENT_LIMIT_MA > 0
+// The sum of every channel of every pixel, kept up to date as pixels are set.
+static uint32_t pixels_sum;
+#endif
 
-    struct led_rgb rgb = {r : r * 255, g : g * 255, b : b * 255};
+static void set_pixel(int i, struct led_rgb rgb) {
+    if (pixels[i].r == rgb.r && pixels[i].g == rgb.g && pixels[i].b == rgb.b) {
+        return;
+    }
+
+#if CONFIG_ZMK_RGB_UNDERGLOW_CURRENT_LIMIT_MA > 0
+    pixels_sum += rgb.r + rgb.g + rgb.b;
+    pixels_sum -= pixels[i].r + pixels[i].g + pixels[i].b;
+#endif
 
-    return rgb;
+    pixels[i] = rgb;
+    pixels_changed = true;
 }
 
-static void zmk_rgb_underglow_effect_solid() {
+static void fill_pixels(struct led_rgb rgb) {
     for (int i = 0; i < STRIP_NUM_PIXELS; i++) {
-        pixels[i] = hsb_to_rgb(hsb_scale_min_max(state.color));
+        set_pixel(i, rgb);
     }
 }
 
+static void zmk_rgb_underglow_reset_animation() {
+    state.animation_step = 0;
+    last_animation_time = k_uptime_get();
+    animation_remainder = 0;
+}
+
+// Returns how far to advance an animation that moves steps_per_tick every TICK_MS.
+static uint32_t zmk_rgb_underglow_animation_steps(uint32_t steps_per_tick) {
+    const int64_t now = k_uptime_get();
+    // Capped so a long stall can't overflow. The animations repeat well within that.
+    const uint32_t elapsed = MIN(now - last_animation_time, 60 * MSEC_PER_SEC);
+    const uint32_t total = elapsed * steps_per_tick + animation_remainder;
+
+    last_animation_time = now;
+    animation_remainder = total % TICK_MS;
+
+    return total / TICK_MS;
+}
+
+static void zmk_rgb_underglow_effect_solid() {
+    fill_pixels(hsb_to_rgb(hsb_scale_min_max(state.color)));
+}
+
 static void zmk_rgb_underglow_effect_breathe() {
+    struct zmk_led_hsb hsb = state.color;
+    hsb.b = abs(state.animation_step - 1200) / 12;
+
+    fill_pixels(hsb_to_rgb(hsb_scale_zero_max(hsb)));
+
+    state.animation_step =
+        (state.animation_step + zmk_rgb_underglow_animation_steps(state.animation_speed * 10)) %
+        2400;
+}
+
+static void zmk_rgb_underglow_effect_spectrum() {
+    struct zmk_led_hsb hsb = state.color;
+    hsb.h = state.animation_step;
+
+    fill_pixels(hsb_to_rgb(hsb_scale_min_max(hsb)));
+
+    state.animation_step =
+        (state.animation_step + zmk_rgb_underglow_animation_steps(state.animation_speed)) % HUE_MAX;
+}
+
+static void zmk_rgb_underglow_effect_swirl() {
     for (int i = 0; i < STRIP_NUM_PIXELS; i++) {
         struct zmk_led_hsb hsb = state.color;
-        hsb.b = abs(state.animation_step - 1200) / 12;
+        hsb.h = (HUE_MAX / STRIP_NUM_PIXELS * i + state.animation_step) % HUE_MAX;
+
+        set_pixel(i, hsb_to_rgb(hsb_scale_min_max(hsb)));
+    }
+
+    state.animation_step =
+        (state.animation_step + zmk_rgb_underglow_animation_steps(state.animation_speed * 2)) %
+        HUE_MAX;
+}
+
+#if HAS_KEYMAP
+// The highest active layer.
+static atomic_t active_layer;
+#endif
 
-        pixels[i] = hsb_to_rgb(hsb_scale_zero_max(hsb));
+// Split peripherals don't track layers, so they always show the base layer color.
+static void zmk_rgb_underglow_effect_layer() {
+    struct zmk_led_hsb hsb = state.color;
+#if HAS_KEYMAP
+    hsb.h = (hsb.h + atomic_get(&active_layer) * HUE_MAX / ZMK_KEYMAP_LAYERS_LEN) % HUE_MAX;
+#endif
+
+    fill_pixels(hsb_to_rgb(hsb_scale_min_max(hsb)));
+}
+
+#if defined(KEY_LEDS_NODE)
+// How much each press heats a key in the heatmap effect, out of UINT8_MAX.
+#define HEAT_PER_PRESS 32
+
+// The LED under each key position.
+static const uint16_t key_leds[] = DT_PROP(KEY_LEDS_NODE, leds);
+
+// LEDs whose key was pressed since the last tick. Set from the input path, cleared by the tick.
+static ATOMIC_DEFINE(pressed_leds, STRIP_NUM_PIXELS);
+
+// How lit each LED is in the per-key effects. Only the tick touches these. Padded to whole words,
+// since the tick works on four LEDs at a time.
+#define LED_LEVEL_WORDS DIV_ROUND_UP(STRIP_NUM_PIXELS, 4)
+static uint8_t led_levels[LED_LEVEL_WORDS * 4] __aligned(4);
+static bool leds_lit;
+// Set when the color or effect changed, so every LED has to be drawn again.
+static bool leds_repaint = true;
+
+static struct led_rgb key_led_color(uint8_t level, bool heatmap) {
+    struct zmk_led_hsb hsb = state.color;
+
+    if (level == 0) {
+        return (struct led_rgb){r : 0, g : 0, b : 0};
+    }
+
+    if (heatmap) {
+        // Blue for the coldest keys through to red for the most used ones.
+        hsb.h = 240 - 240 * level / UINT8_MAX;
+        return hsb_to_rgb(hsb_scale_min_max(hsb));
+    }
+
+    hsb.b = hsb.b * level / UINT8_MAX;
+    return hsb_to_rgb(hsb_scale_zero_max(hsb));
+}
+
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+             "Per-key levels are packed with the first LED in the low byte");
+
+// Saturating add and subtract of four packed levels. Cores with the DSP extension do each in one
+// instruction, everything else byte by byte.
+#if defined(__ARM_FEATURE_SIMD32) && __ARM_FEATURE_SIMD32
+static inline uint32_t levels_add(uint32_t a, uint32_t b) { return __uqadd8(a, b); }
+
+static inline uint32_t levels_sub(uint32_t a, uint32_t b) { return __uqsub8(a, b); }
+#else
+static inline uint32_t levels_add(uint32_t a, uint32_t b) {
+    uint32_t sum = 0;
+    for (int i = 0; i < 32; i += 8) {
+        sum |= MIN(((a >> i) & 0xFF) + ((b >> i) & 0xFF), UINT8_MAX) << i;
     }
+    return sum;
+}
 
-    state.animation_step += state.animation_speed * 10;
+static inline uint32_t levels_sub(uint32_t a, uint32_t b) {
+    uint32_t diff = 0;
+    for (int i = 0; i < 32; i += 8) {
+        uint32_t x = (a >> i) & 0xFF, y = (b >> i) & 0xFF;
+        diff |= (x > y ? x - y : 0) << i;
+    }
+    return diff;
+}
+#endif
 
-    if (state.animation_step > 2400) {
-        state.animation_step = 0;
+// A level in every byte whose bit is set in four bits of pressed_leds.
+static inline uint32_t levels_masked(uint32_t pressed, uint8_t level) {
+    uint32_t levels = 0;
+    for (int i = 0; i < 4; i++) {
+        if (pressed & BIT(i)) {
+            levels |= (uint32_t)level << (i * 8);
+        }
     }
+    return levels;
 }
 
-static void zmk_rgb_underglow_effect_spectrum() {
-    for (int i = 0; i < STRIP_NUM_PIXELS; i++) {
-        struct zmk_led_hsb hsb = state.color;
-        hsb.h = state.animation_step;
+// Only LEDs whose level changed are converted, and the tick stops once every LED is dark. Levels
+// are updated four at a time, and groups of dark LEDs with no new press are skipped whole.
+static void zmk_rgb_underglow_effect_keys() {
+    const bool heatmap = state.current_effect == UNDERGLOW_EFFECT_HEATMAP;
+    const uint32_t decay = MIN(
+        zmk_rgb_underglow_animation_steps(state.animation_speed * (heatmap ? 1 : 12)), UINT8_MAX);
+    const uint32_t decays = decay * 0x01010101;
+    atomic_val_t pressed[ATOMIC_BITMAP_SIZE(STRIP_NUM_PIXELS)];
+
+    // One atomic swap per word of presses, rather than one per LED.
+    for (int i = 0; i < ARRAY_SIZE(pressed); i++) {
+        pressed[i] = atomic_clear(&pressed_leds[i]);
+    }
+
+    leds_lit = false;
 
-        pixels[i] = hsb_to_rgb(hsb_scale_min_max(hsb));
+    for (int w = 0; w < LED_LEVEL_WORDS; w++) {
+        const int first = w * 4;
+        const uint32_t presses = (pressed[first / ATOMIC_BITS] >> (first % ATOMIC_BITS)) & 0xF;
+        uint32_t old, levels;
+
+        memcpy(&old, &led_levels[first], sizeof(old));
+        if (old == 0 && presses == 0 && !leds_repaint) {
+            continue;
+        }
+
+        levels = levels_sub(old, decays);
+        if (presses) {
+            levels = heatmap ? levels_add(levels, levels_masked(presses, HEAT_PER_PRESS))
+                             : levels | levels_masked(presses, UINT8_MAX);
+        }
+
+        memcpy(&led_levels[first], &levels, sizeof(levels));
+        leds_lit = leds_lit || levels != 0;
+
+        for (int i = 0; i < 4 && first + i < STRIP_NUM_PIXELS; i++) {
+            const uint8_t level = levels >> (i * 8);
+            if (level != (uint8_t)(old >> (i * 8)) || leds_repaint) {
+                set_pixel(first + i, key_led_color(level, heatmap));
+            }
+        }
     }
 
-    state.animation_step += state.animation_speed;
-    state.animation_step = state.animation_step % HUE_MAX;
+    leds_repaint = false;
 }
 
-static void zmk_rgb_underglow_effect_swirl() {
+static void zmk_rgb_underglow_reset_keys() {
+    memset(led_levels, 0, sizeof(led_levels));
+    atomic_clear(pressed_leds);
+    leds_repaint = true;
+}
+#endif
+
+// Dims a copy of pixels about to be sent if the strip would draw more than the current limit.
+static void zmk_rgb_underglow_limit_current(struct led_rgb *frame) {
+#if CONFIG_ZMK_RGB_UNDERGLOW_CURRENT_LIMIT_MA > 0
+    const uint64_t idle_ua = (uint64_t)STRIP_NUM_PIXELS * CONFIG_ZMK_RGB_UNDERGLOW_IDLE_CURRENT_UA;
+    const uint64_t limit_ua = (uint64_t)CONFIG_ZMK_RGB_UNDERGLOW_CURRENT_LIMIT_MA * 1000;
+    // What the channels may draw, and what they would, both in uA times UINT8_MAX.
+    const uint64_t budget = (limit_ua - MIN(idle_ua, limit_ua)) * UINT8_MAX;
+    const uint64_t channels = (uint64_t)pixels_sum * CONFIG_ZMK_RGB_UNDERGLOW_CHANNEL_CURRENT_UA;
+
+    if (channels <= budget) {
+        return;
+    }
+
+    // Out of 256, so scaling a channel is a multiply and a shift.
+    const uint32_t scale = budget * 256 / channels;
+
     for (int i = 0; i < STRIP_NUM_PIXELS; i++) {
-        struct zmk_led_hsb hsb = state.color;
-        hsb.h = (HUE_MAX / STRIP_NUM_PIXELS * i + state.animation_step) % HUE_MAX;
+        frame[i].r = frame[i].r * scale >> 8;
+        frame[i].g = frame[i].g * scale >> 8;
+        frame[i].b = frame[i].b * scale >> 8;
+    }
+#endif
+}
+
+#if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_TRANSFER_THREAD)
+static void zmk_rgb_underglow_transfer(struct k_work *work) {
+    k_spinlock_key_t key = k_spin_lock(&strip_frames_lock);
+
+    if (!strip_back_ready) {
+        k_spin_unlock(&strip_frames_lock, key);
+        return;
+    }
+
+    struct led_rgb *frame = strip_frames[strip_back_frame];
+    strip_back_frame = !strip_back_frame;
+    strip_back_ready = false;
+
+    k_spin_unlock(&strip_frames_lock, key);
+
+    zmk_energy_stats_count(ZMK_ENERGY_LED_STRIP_UPDATE);
+    int err = led_strip_update_rgb(led_strip, frame, STRIP_NUM_PIXELS);
+    if (err) {
+        LOG_ERR("Failed to update the LED strip (err %d)", err);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(zmk_rgb_underglow_transfer)
+static K_WORK_DEFINE(underglow_transfer_work, ZMK_WORK_WATCHED(zmk_rgb_underglow_transfer));
+
+static void zmk_rgb_underglow_update_strip() {
+    if (!pixels_changed) {
+        return;
+    }
 
-        pixels[i] = hsb_to_rgb(hsb_scale_min_max(hsb));
+    // The back frame is never the one being sent, so only the swap needs to wait for the copy.
+    k_spinlock_key_t key = k_spin_lock(&strip_frames_lock);
+
+    memcpy(strip_frames[strip_back_frame], pixels, sizeof(pixels));
+    zmk_rgb_underglow_limit_current(strip_frames[strip_back_frame]);
+    strip_back_ready = true;
+    pixels_changed = false;
+
+    k_spin_unlock(&strip_frames_lock, key);
+
+    k_work_submit_to_queue(&underglow_transfer_q, &underglow_transfer_work);
+}
+#else
+static void zmk_rgb_underglow_update_strip() {
+    if (!pixels_changed) {
+        return;
     }
 
-    state.animation_step += state.animation_speed * 2;
-    state.animation_step = state.animation_step % HUE_MAX;
+    memcpy(strip_pixels, pixels, sizeof(pixels));
+    zmk_rgb_underglow_limit_current(strip_pixels);
+    pixels_changed = false;
+
+    zmk_energy_stats_count(ZMK_ENERGY_LED_STRIP_UPDATE);
+    int err = led_strip_update_rgb(led_strip, strip_pixels, STRIP_NUM_PIXELS);
+    if (err) {
+        LOG_ERR("Failed to update the LED strip (err %d)", err);
+        pixels_changed = true;
+    }
 }
+#endif
+
+static void zmk_rgb_underglow_tick(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(zmk_rgb_underglow_tick)
+static K_WORK_DELAYABLE_DEFINE(underglow_work, ZMK_WORK_WATCHED(zmk_rgb_underglow_tick));
 
 static void zmk_rgb_underglow_tick(struct k_work *work) {
+    if (!state.on) {
+        return;
+    }
+
+    // Static effects don't change until the state does, which redraws them immediately.
+    bool animated = true;
+
     switch (state.current_effect) {
     case UNDERGLOW_EFFECT_SOLID:
         zmk_rgb_underglow_effect_solid();
+        animated = false;
         break;
     case UNDERGLOW_EFFECT_BREATHE:
         zmk_rgb_underglow_effect_breathe();
@@ -182,25 +491,40 @@ static void zmk_rgb_underglow_tick(struct k_work *work) {
     case UNDERGLOW_EFFECT_SWIRL:
         zmk_rgb_underglow_effect_swirl();
         break;
+    case UNDERGLOW_EFFECT_LAYER:
+        zmk_rgb_underglow_effect_layer();
+        animated = false;
+        break;
+#if defined(KEY_LEDS_NODE)
+    case UNDERGLOW_EFFECT_REACTIVE:
+    case UNDERGLOW_EFFECT_HEATMAP:
+        zmk_rgb_underglow_effect_keys();
+        animated = leds_lit;
+        break;
+#endif
     }
 
-    led_strip_update_rgb(led_strip, pixels, STRIP_NUM_PIXELS);
+    zmk_rgb_underglow_update_strip();
+
+    if (animated) {
+        k_work_schedule(&underglow_work, K_MSEC(TICK_MS));
+    }
 }
 
-K_WORK_DEFINE(underglow_work, zmk_rgb_underglow_tick);
+// Draw the current state now rather than waiting for the next tick, which may never come.
+static void zmk_rgb_underglow_redraw() {
+#if defined(KEY_LEDS_NODE)
+    leds_repaint = true;
+#endif
 
-static void zmk_rgb_underglow_tick_handler(struct k_timer *timer) {
-    if (!state.on) {
-        return;
+    if (state.on) {
+        k_work_reschedule(&underglow_work, K_NO_WAIT);
     }
-
-    k_work_submit(&underglow_work);
 }
 
-K_TIMER_DEFINE(underglow_tick, zmk_rgb_underglow_tick_handler, NULL);
-
 #if IS_ENABLED(CONFIG_SETTINGS)
-static int rgb_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg) {
+static int rgb_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg,
+                            void *param) {
     const char *next;
     int rc;
 
@@ -220,13 +544,25 @@ static int rgb_settings_set(const char *name, size_t len, settings_read_cb read_
     return -ENOENT;
 }
 
-struct settings_handler rgb_conf = {.name = "rgb/underglow", .h_set = rgb_settings_set};
-
 static void zmk_rgb_underglow_save_state_work() {
     settings_save_one("rgb/underglow/state", &state, sizeof(state));
 }
 
-static struct k_work_delayable underglow_save_work;
+ZMK_SETTINGS_SAVE_DEFINE(underglow_save, zmk_rgb_underglow_save_state_work);
+#endif
+
+static void zmk_rgb_underglow_apply_loaded_state() {
+#if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_AUTO_OFF_USB)
+    state.on = zmk_usb_is_powered();
+#endif
+
+    zmk_ext_power_claim(ZMK_EXT_POWER_CONSUMER_UNDERGLOW, state.on);
+    zmk_rgb_underglow_redraw();
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+ZMK_SETTINGS_DEFERRED_LOAD_DEFINE(underglow_load, "rgb/underglow", rgb_settings_set,
+                                  zmk_rgb_underglow_apply_loaded_state);
 #endif
 
 static int zmk_rgb_underglow_init(const struct device *_arg) {
@@ -238,6 +574,13 @@ static int zmk_rgb_underglow_init(const struct device *_arg) {
         return -EINVAL;
     }
 
+#if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_TRANSFER_THREAD)
+    static const struct k_work_queue_config queue_config = {.name = "ZMK Underglow Transfer"};
+    k_work_queue_start(&underglow_transfer_q, underglow_transfer_stack_area,
+                       K_THREAD_STACK_SIZEOF(underglow_transfer_stack_area),
+                       CONFIG_ZMK_RGB_UNDERGLOW_TRANSFER_THREAD_PRIORITY, &queue_config);
+#endif
+
 #if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_EXT_POWER)
     ext_power = device_get_binding("EXT_POWER");
     if (ext_power == NULL) {
@@ -258,34 +601,18 @@ static int zmk_rgb_underglow_init(const struct device *_arg) {
     };
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-    settings_subsys_init();
-
-    int err = settings_register(&rgb_conf);
-    if (err) {
-        LOG_ERR("Failed to register the ext_power settings handler (err %d)", err);
-        return err;
-    }
-
-    k_work_init_delayable(&underglow_save_work, zmk_rgb_underglow_save_state_work);
-
-    settings_load_subtree("rgb/underglow");
-#endif
-
-#if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_AUTO_OFF_USB)
-    state.on = zmk_usb_is_powered();
+    // The underglow stays dark until its saved state is loaded, after everything needed to type.
+    zmk_settings_load_deferred(&underglow_load);
+#else
+    zmk_rgb_underglow_apply_loaded_state();
 #endif
 
-    if (state.on) {
-        k_timer_start(&underglow_tick, K_NO_WAIT, K_MSEC(50));
-    }
-
     return 0;
 }
 
 int zmk_rgb_underglow_save_state() {
 #if IS_ENABLED(CONFIG_SETTINGS)
-    int ret = k_work_reschedule(&underglow_save_work, K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
-    return MIN(ret, 0);
+    return zmk_settings_save(&underglow_save);
 #else
     return 0;
 #endif
@@ -303,6 +630,8 @@ int zmk_rgb_underglow_on() {
     if (!led_strip)
         return -ENODEV;
 
+    zmk_ext_power_claim(ZMK_EXT_POWER_CONSUMER_UNDERGLOW, true);
+
 #if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_EXT_POWER)
     if (ext_power != NULL) {
         int rc = ext_power_enable(ext_power);
@@ -313,8 +642,10 @@ int zmk_rgb_underglow_on() {
 #endif
 
     state.on = true;
-    state.animation_step = 0;
-    k_timer_start(&underglow_tick, K_NO_WAIT, K_MSEC(50));
+    zmk_rgb_underglow_reset_animation();
+    // The strip may have lost its colors while it was unpowered.
+    pixels_changed = true;
+    zmk_rgb_underglow_redraw();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -323,6 +654,8 @@ int zmk_rgb_underglow_off() {
     if (!led_strip)
         return -ENODEV;
 
+    zmk_ext_power_claim(ZMK_EXT_POWER_CONSUMER_UNDERGLOW, false);
+
 #if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_EXT_POWER)
     if (ext_power != NULL) {
         int rc = ext_power_disable(ext_power);
@@ -332,14 +665,11 @@ int zmk_rgb_underglow_off() {
     }
 #endif
 
-    for (int i = 0; i < STRIP_NUM_PIXELS; i++) {
-        pixels[i] = (struct led_rgb){r : 0, g : 0, b : 0};
-    }
-
-    led_strip_update_rgb(led_strip, pixels, STRIP_NUM_PIXELS);
-
-    k_timer_stop(&underglow_tick);
     state.on = false;
+    k_work_cancel_delayable(&underglow_work);
+
+    fill_pixels((struct led_rgb){r : 0, g : 0, b : 0});
+    zmk_rgb_underglow_update_strip();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -357,7 +687,11 @@ int zmk_rgb_underglow_select_effect(int effect) {
     }
 
     state.current_effect = effect;
-    state.animation_step = 0;
+    zmk_rgb_underglow_reset_animation();
+#if defined(KEY_LEDS_NODE)
+    zmk_rgb_underglow_reset_keys();
+#endif
+    zmk_rgb_underglow_redraw();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -376,6 +710,7 @@ int zmk_rgb_underglow_set_hsb(struct zmk_led_hsb color) {
     }
 
     state.color = color;
+    zmk_rgb_underglow_redraw();
 
     return 0;
 }
@@ -417,6 +752,7 @@ int zmk_rgb_underglow_change_hue(int direction) {
         return -ENODEV;
 
     state.color = zmk_rgb_underglow_calc_hue(direction);
+    zmk_rgb_underglow_redraw();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -426,6 +762,7 @@ int zmk_rgb_underglow_change_sat(int direction) {
         return -ENODEV;
 
     state.color = zmk_rgb_underglow_calc_sat(direction);
+    zmk_rgb_underglow_redraw();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -435,6 +772,7 @@ int zmk_rgb_underglow_change_brt(int direction) {
         return -ENODEV;
 
     state.color = zmk_rgb_underglow_calc_brt(direction);
+    zmk_rgb_underglow_redraw();
 
     return zmk_rgb_underglow_save_state();
 }
@@ -456,6 +794,55 @@ int zmk_rgb_underglow_change_spd(int direction) {
     return zmk_rgb_underglow_save_state();
 }
 
+#define SYNC_BRT_SHIFT 0
+#define SYNC_SAT_SHIFT 7
+#define SYNC_HUE_SHIFT 14
+#define SYNC_EFFECT_SHIFT 23
+#define SYNC_SPEED_SHIFT 27
+
+BUILD_ASSERT(UNDERGLOW_EFFECT_NUMBER <= BIT(4), "Too many underglow effects for the sync state");
+
+uint32_t zmk_rgb_underglow_get_sync_state() {
+    return (state.color.b << SYNC_BRT_SHIFT) | (state.color.s << SYNC_SAT_SHIFT) |
+           (state.color.h << SYNC_HUE_SHIFT) | (state.current_effect << SYNC_EFFECT_SHIFT) |
+           (state.animation_speed << SYNC_SPEED_SHIFT);
+}
+
+int zmk_rgb_underglow_apply_sync_state(uint32_t sync_state) {
+    if (!led_strip)
+        return -ENODEV;
+
+    struct zmk_led_hsb color = {
+        .h = (sync_state >> SYNC_HUE_SHIFT) & BIT_MASK(9),
+        .s = (sync_state >> SYNC_SAT_SHIFT) & BIT_MASK(7),
+        .b = (sync_state >> SYNC_BRT_SHIFT) & BIT_MASK(7),
+    };
+    uint8_t effect = (sync_state >> SYNC_EFFECT_SHIFT) & BIT_MASK(4);
+    uint8_t speed = (sync_state >> SYNC_SPEED_SHIFT) & BIT_MASK(3);
+
+    if (effect >= UNDERGLOW_EFFECT_NUMBER || speed < 1 || speed > 5) {
+        return -EINVAL;
+    }
+
+    // Only restart the animation if the effect actually changed.
+    if (effect != state.current_effect) {
+        state.current_effect = effect;
+        zmk_rgb_underglow_reset_animation();
+#if defined(KEY_LEDS_NODE)
+        zmk_rgb_underglow_reset_keys();
+#endif
+    }
+
+    state.animation_speed = speed;
+
+    int err = zmk_rgb_underglow_set_hsb(color);
+    if (err) {
+        return err;
+    }
+
+    return zmk_rgb_underglow_save_state();
+}
+
 #if IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_AUTO_OFF_IDLE) ||                                          \
     IS_ENABLED(CONFIG_ZMK_RGB_UNDERGLOW_AUTO_OFF_USB)
 static int rgb_underglow_auto_state(bool *prev_state, bool new_state) {
@@ -505,4 +892,45 @@ ZMK_SUBSCRIPTION(rgb_underglow, zmk_activity_state_changed);
 ZMK_SUBSCRIPTION(rgb_underglow, zmk_usb_conn_state_changed);
 #endif
 
-SYS_INIT(zmk_rgb_underglow_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#if HAS_KEYMAP || defined(KEY_LEDS_NODE)
+static int rgb_underglow_keymap_listener(const zmk_event_t *eh) {
+#if HAS_KEYMAP
+    if (as_zmk_layer_state_changed(eh)) {
+        atomic_set(&active_layer, zmk_keymap_highest_layer_active());
+
+        if (state.current_effect == UNDERGLOW_EFFECT_LAYER) {
+            zmk_rgb_underglow_redraw();
+        }
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+#endif
+
+#if defined(KEY_LEDS_NODE)
+    const struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
+    if (ev && ev->state && ev->position < ARRAY_SIZE(key_leds) &&
+        key_leds[ev->position] < STRIP_NUM_PIXELS) {
+        atomic_set_bit(pressed_leds, key_leds[ev->position]);
+
+        // Rendering is left to the underglow work, so the input path only sets a bit.
+        if (state.on && (state.current_effect == UNDERGLOW_EFFECT_REACTIVE ||
+                         state.current_effect == UNDERGLOW_EFFECT_HEATMAP)) {
+            k_work_reschedule(&underglow_work, K_NO_WAIT);
+        }
+    }
+#endif
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(rgb_underglow_keymap, rgb_underglow_keymap_listener);
+#endif
+
+#if HAS_KEYMAP
+ZMK_SUBSCRIPTION_DEFERRED(rgb_underglow_keymap, zmk_layer_state_changed);
+#endif
+
+#if defined(KEY_LEDS_NODE)
+ZMK_SUBSCRIPTION(rgb_underglow_keymap, zmk_position_state_changed);
+#endif
+
+ZMK_SYS_INIT(zmk_rgb_underglow_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -12,6 +12,7 @@
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/sensors.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/sensor_event.h>
@@ -35,6 +36,7 @@ static struct sensors_data_item sensors[] = {UTIL_LISTIFY(ZMK_KEYMAP_SENSORS_LEN
 static void zmk_sensors_trigger_handler(const struct device *dev, struct sensor_trigger *trigger) {
     int err;
     struct sensors_data_item *item = CONTAINER_OF(trigger, struct sensors_data_item, trigger);
+    struct sensor_value value;
 
     LOG_DBG("sensor %d", item->sensor_number);
 
@@ -44,8 +46,17 @@ static void zmk_sensors_trigger_handler(const struct device *dev, struct sensor_
         return;
     }
 
-    ZMK_EVENT_RAISE(new_zmk_sensor_event((struct zmk_sensor_event){
-        .sensor_number = item->sensor_number, .sensor = dev, .timestamp = k_uptime_get()}));
+    // Read the value once here so consumers don't have to go back to the device.
+    err = sensor_channel_get(dev, trigger->chan, &value);
+    if (err) {
+        LOG_WRN("Failed to get sensor channel value from device %d", err);
+        return;
+    }
+
+    raise_zmk_sensor_event((struct zmk_sensor_event){.sensor_number = item->sensor_number,
+                                                     .sensor = dev,
+                                                     .value = value,
+                                                     .timestamp = k_uptime_get()});
 }
 
 static void zmk_sensors_init_item(const char *node, uint8_t i, uint8_t abs_i) {
@@ -75,6 +86,6 @@ static int zmk_sensors_init(const struct device *_arg) {
     return 0;
 }
 
-SYS_INIT(zmk_sensors_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_sensors_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
 
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
\ No newline at end of file
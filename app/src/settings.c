@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <init.h>
+#include <kernel.h>
+#include <settings/settings.h>
+#include <sys/atomic.h>
+#include <sys/slist.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/settings.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+#include <zmk/activity.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+#endif
+
+K_THREAD_STACK_DEFINE(settings_save_stack_area, CONFIG_ZMK_SETTINGS_SAVE_THREAD_STACK_SIZE);
+
+static struct k_work_q settings_save_work_q;
+
+static sys_slist_t pending_saves = SYS_SLIST_STATIC_INIT(&pending_saves);
+static struct k_spinlock pending_lock;
+
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+// When the oldest change that still has to be written was made.
+static int64_t oldest_pending_save;
+// Set while the pending saves wait for the keyboard to go idle.
+static atomic_t waiting_for_idle;
+#endif
+
+static struct zmk_settings_save *next_pending_save() {
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+    sys_snode_t *node = sys_slist_get(&pending_saves);
+    struct zmk_settings_save *entry = SYS_SLIST_CONTAINER(node, entry, node);
+    if (entry) {
+        // Cleared before writing so a change made during the write marks the entry again.
+        entry->pending = false;
+    }
+
+    k_spin_unlock(&pending_lock, key);
+    return entry;
+}
+
+static void settings_save_work_handler(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(settings_save_work_handler)
+static K_WORK_DELAYABLE_DEFINE(settings_save_work, ZMK_WORK_WATCHED(settings_save_work_handler));
+
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+// Writing to flash, and the garbage collection it may set off, stalls the CPU for a while, so the
+// write waits for typing to pause, though no longer than the maximum delay.
+static bool defer_until_idle() {
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    int64_t deadline = oldest_pending_save + CONFIG_ZMK_SETTINGS_SAVE_IDLE_MAX_DELAY;
+    k_spin_unlock(&pending_lock, key);
+
+    // Set before checking the state, so the keyboard going idle in between still moves the write.
+    atomic_set(&waiting_for_idle, true);
+
+    int64_t now = k_uptime_get();
+    if (zmk_activity_get_state() != ZMK_ACTIVITY_ACTIVE || now >= deadline) {
+        atomic_set(&waiting_for_idle, false);
+        return false;
+    }
+
+    LOG_DBG("Deferring settings write until idle");
+    k_work_schedule_for_queue(&settings_save_work_q, &settings_save_work, K_MSEC(deadline - now));
+    return true;
+}
+#endif
+
+// Zephyr's settings have no batched write, so the best we can do is to write everything that
+// changed back to back and let the storage backend see a single burst.
+static void settings_save_work_handler(struct k_work *work) {
+    struct zmk_settings_save *entry;
+    int count = 0;
+
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+    if (defer_until_idle()) {
+        return;
+    }
+#endif
+
+    while ((entry = next_pending_save()) != NULL) {
+        entry->save();
+        count++;
+    }
+
+    LOG_DBG("Saved %d settings groups", count);
+}
+
+int zmk_settings_save(struct zmk_settings_save *entry) {
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+
+    if (!entry->pending) {
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+        if (sys_slist_is_empty(&pending_saves)) {
+            oldest_pending_save = k_uptime_get();
+        }
+#endif
+        entry->pending = true;
+        sys_slist_append(&pending_saves, &entry->node);
+    }
+
+    k_spin_unlock(&pending_lock, key);
+
+    // Scheduling doesn't move a write that is already scheduled, so a steady stream of changes
+    // can't postpone it indefinitely.
+    int ret = k_work_schedule_for_queue(&settings_save_work_q, &settings_save_work,
+                                        K_MSEC(CONFIG_ZMK_SETTINGS_SAVE_DEBOUNCE));
+    return MIN(ret, 0);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE)
+static int settings_activity_listener(const zmk_event_t *eh) {
+    const struct zmk_activity_state_changed *ev = as_zmk_activity_state_changed(eh);
+    if (ev == NULL || ev->state == ZMK_ACTIVITY_ACTIVE) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    if (ev->state == ZMK_ACTIVITY_SLEEP) {
+        // Changes not written before powering off would be lost, so write them right away and
+        // wait for the write to finish.
+        struct k_work_sync sync;
+        atomic_set(&waiting_for_idle, false);
+        k_work_flush_delayable(&settings_save_work, &sync);
+    } else if (atomic_cas(&waiting_for_idle, true, false)) {
+        k_work_reschedule_for_queue(&settings_save_work_q, &settings_save_work, K_NO_WAIT);
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(settings, settings_activity_listener);
+ZMK_SUBSCRIPTION(settings, zmk_activity_state_changed);
+#endif /* IS_ENABLED(CONFIG_ZMK_SETTINGS_SAVE_WHEN_IDLE) */
+
+static sys_slist_t deferred_loads = SYS_SLIST_STATIC_INIT(&deferred_loads);
+static atomic_t settings_loaded;
+
+static void deferred_load_work_handler(struct k_work *work) {
+    sys_snode_t *node;
+
+    for (;;) {
+        k_spinlock_key_t key = k_spin_lock(&pending_lock);
+        node = sys_slist_get(&deferred_loads);
+        k_spin_unlock(&pending_lock, key);
+
+        if (node == NULL) {
+            return;
+        }
+
+        struct zmk_settings_deferred_load *entry =
+            CONTAINER_OF(node, struct zmk_settings_deferred_load, node);
+
+        int err = settings_load_subtree_direct(entry->subtree, entry->set, NULL);
+        if (err) {
+            LOG_ERR("Failed to load %s settings (err %d)", log_strdup(entry->subtree), err);
+        }
+
+        entry->loaded();
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(deferred_load_work_handler)
+static K_WORK_DEFINE(deferred_load_work, ZMK_WORK_WATCHED(deferred_load_work_handler));
+
+void zmk_settings_load_deferred(struct zmk_settings_deferred_load *entry) {
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    sys_slist_append(&deferred_loads, &entry->node);
+    k_spin_unlock(&pending_lock, key);
+
+    // The save thread has the lowest priority, so this only runs once initialization is done and
+    // the input path is idle.
+    if (atomic_get(&settings_loaded)) {
+        k_work_submit_to_queue(&settings_save_work_q, &deferred_load_work);
+    }
+}
+
+int zmk_settings_load() {
+    if (atomic_set(&settings_loaded, true)) {
+        return 0;
+    }
+
+    int err = settings_subsys_init();
+    if (err) {
+        LOG_ERR("Failed to initialize settings (err %d)", err);
+        return err;
+    }
+
+    // Each load walks all of storage, so every handler that is needed at boot is registered
+    // statically and loaded in a single pass.
+    err = settings_load();
+    if (err) {
+        LOG_ERR("Failed to load settings (err %d)", err);
+    }
+
+    k_work_submit_to_queue(&settings_save_work_q, &deferred_load_work);
+
+    return err;
+}
+
+static int zmk_settings_save_init(const struct device *_arg) {
+    static const struct k_work_queue_config queue_config = {.name = "ZMK Settings Save"};
+    k_work_queue_start(&settings_save_work_q, settings_save_stack_area,
+                       K_THREAD_STACK_SIZEOF(settings_save_stack_area),
+                       CONFIG_ZMK_SETTINGS_SAVE_THREAD_PRIORITY, &queue_config);
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_settings_save_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+#if !IS_ENABLED(CONFIG_BT)
+// Bluetooth has to be enabled before its settings are loaded, so with Bluetooth the BLE code loads
+// them instead.
+static int zmk_settings_load_init(const struct device *_arg) { return zmk_settings_load(); }
+
+ZMK_SYS_INIT(zmk_settings_load_init, APPLICATION, CONFIG_ZMK_SETTINGS_LOAD_INIT_PRIORITY);
+#endif
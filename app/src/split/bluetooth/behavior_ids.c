@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <devicetree.h>
+#include <init.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include <zmk/boot_profile.h>
+#include <zmk/split/bluetooth/behavior_ids.h>
+
+#define BEHAVIOR_LABEL(node) COND_CODE_1(DT_NODE_HAS_PROP(node, label), (DT_LABEL(node), ), ())
+
+#define BEHAVIOR_LABELS(path)                                                                      \
+    COND_CODE_1(DT_NODE_EXISTS(DT_PATH(path)),                                                     \
+                (DT_FOREACH_CHILD_STATUS_OKAY(DT_PATH(path), BEHAVIOR_LABEL)), ())
+
+static const char *const behavior_labels[] = {BEHAVIOR_LABELS(behaviors) BEHAVIOR_LABELS(macros)};
+
+BUILD_ASSERT(ARRAY_SIZE(behavior_labels) < ZMK_SPLIT_BEHAVIOR_ID_NONE,
+             "Too many behaviors for one byte behavior ids");
+
+static uint32_t behavior_table_hash;
+
+uint8_t zmk_split_bt_behavior_id(const char *label) {
+    for (int i = 0; i < ARRAY_SIZE(behavior_labels); i++) {
+        if (strcmp(behavior_labels[i], label) == 0) {
+            return i;
+        }
+    }
+
+    return ZMK_SPLIT_BEHAVIOR_ID_NONE;
+}
+
+const char *zmk_split_bt_behavior_label(uint8_t id) {
+    if (id >= ARRAY_SIZE(behavior_labels)) {
+        return NULL;
+    }
+
+    return behavior_labels[id];
+}
+
+uint32_t zmk_split_bt_behavior_table_hash() { return behavior_table_hash; }
+
+// FNV-1a over every label, including its terminator so that the boundaries between labels count.
+static int behavior_ids_init(const struct device *_arg) {
+    uint32_t hash = 2166136261U;
+
+    for (int i = 0; i < ARRAY_SIZE(behavior_labels); i++) {
+        const char *label = behavior_labels[i];
+
+        do {
+            hash = (hash ^ (uint8_t)*label) * 16777619U;
+        } while (*label++ != '\0');
+    }
+
+    behavior_table_hash = hash;
+    return 0;
+}
+
+ZMK_SYS_INIT(behavior_ids_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -5,6 +5,7 @@
  */
 
 #include <zephyr/types.h>
+#include <string.h>
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/conn.h>
@@ -17,18 +18,44 @@
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/stdlib.h>
 #include <zmk/ble.h>
 #include <zmk/behavior.h>
 #include <zmk/split/bluetooth/uuid.h>
 #include <zmk/split/bluetooth/service.h>
+#include <zmk/split/bluetooth/behavior_ids.h>
+#include <zmk/split/bluetooth/central.h>
 #include <zmk/event_manager.h>
+#include <zmk/hot_path_trace.h>
+#include <zmk/kscan.h>
+#include <zmk/memory_stats.h>
+#include <zmk/position_set.h>
+#include <zmk/events/peripheral_battery_state_changed.h>
 #include <zmk/events/position_state_changed.h>
+#include <zmk/events/sensor_event.h>
+#include <zmk/events/split_link_stats_changed.h>
+#include <zmk/pipeline_stats.h>
+#include <zmk/pointing.h>
+#include <zmk/sensors.h>
+#include <zmk/settings.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
 #include <init.h>
 
 static int start_scan(void);
 
-#define POSITION_STATE_DATA_LEN 16
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+// Whether the current scan only reports the bonded peripheral's address.
+static bool known_peripheral_scan;
+// Set when the known peripheral didn't show up in time, until a peripheral connects again.
+static bool known_peripheral_scan_timed_out;
+
+static void known_peripheral_scan_timeout(struct k_work *work);
+ZMK_WORK_WATCHDOG_WRAP(known_peripheral_scan_timeout)
+static K_WORK_DELAYABLE_DEFINE(known_peripheral_scan_timeout_work,
+                               ZMK_WORK_WATCHED(known_peripheral_scan_timeout));
+#endif
 
 enum peripheral_slot_state {
     PERIPHERAL_SLOT_STATE_OPEN,
@@ -42,27 +69,200 @@ struct peripheral_slot {
     struct bt_gatt_discover_params discover_params;
     struct bt_gatt_subscribe_params subscribe_params;
     struct bt_gatt_discover_params sub_discover_params;
+    struct bt_gatt_read_params resync_params;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+    struct bt_gatt_read_params rtt_params;
+    uint32_t rtt_start_cycles;
+    bool rtt_pending;
+#endif
+    bool resync_pending;
+    uint16_t position_state_handle;
+    uint16_t position_events_handle;
     uint16_t run_behavior_handle;
-    uint8_t position_state[POSITION_STATE_DATA_LEN];
-    uint8_t changed_positions[POSITION_STATE_DATA_LEN];
+    uint16_t run_behavior_ids_handle;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    uint16_t pointing_motion_handle;
+    struct bt_gatt_subscribe_params pointing_subscribe_params;
+    struct bt_gatt_discover_params pointing_sub_discover_params;
+#endif
+    struct bt_gatt_read_params behavior_table_params;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_CACHE_HANDLES)
+    struct bt_gatt_read_params db_hash_params;
+    // The peripheral's GATT database hash, if it has one, to save with the discovered handles.
+    uint8_t db_hash[16];
+    bool db_hash_valid;
+    // Whether the handles came from the cache instead of discovery on this connection.
+    bool handles_cached;
+#endif
+    // Whether the peripheral numbers behaviors the same way, so run behavior writes can use ids.
+    bool behavior_ids_match;
+    // Run behavior writes that may still be handed to the stack before one completes.
+    atomic_t write_credits;
+    struct bt_gatt_exchange_params mtu_exchange_params;
+    struct zmk_position_set position_state;
 };
 
 static struct peripheral_slot peripherals[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
 
 static const struct bt_uuid_128 split_service_uuid = BT_UUID_INIT_128(ZMK_SPLIT_BT_SERVICE_UUID);
 
-K_MSGQ_DEFINE(peripheral_event_msgq, sizeof(struct zmk_position_state_changed),
-              CONFIG_ZMK_SPLIT_BLE_CENTRAL_POSITION_QUEUE_SIZE, 4);
+// Position changes go into the peripheral's own kscan queue, to be raised in order with the local
+// ones. Sensor triggers likewise have their own queue for each peripheral, so one sending a burst
+// of them (e.g. from an encoder) can't crowd out another's.
+#define PERIPHERAL_SENSOR_MSGQ_BUF_SIZE                                                            \
+    (CONFIG_ZMK_SPLIT_BLE_CENTRAL_POSITION_QUEUE_SIZE * sizeof(struct zmk_sensor_event))
+
+static struct k_msgq peripheral_sensor_msgqs[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
+static char __aligned(4)
+    peripheral_sensor_msgq_bufs[ZMK_BLE_SPLIT_PERIPHERAL_COUNT][PERIPHERAL_SENSOR_MSGQ_BUF_SIZE];
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+
+static struct zmk_split_bt_link_stats link_stats[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
+
+const struct zmk_split_bt_link_stats *zmk_split_bt_link_stats(uint8_t source) {
+    if (source >= ZMK_BLE_SPLIT_PERIPHERAL_COUNT) {
+        return NULL;
+    }
+
+    return &link_stats[source];
+}
+
+void zmk_split_bt_link_stats_reset() { memset(link_stats, 0, sizeof(link_stats)); }
+
+static void link_stats_record_event(const struct zmk_position_state_changed *ev) {
+    if (ev->source >= ZMK_BLE_SPLIT_PERIPHERAL_COUNT) {
+        return;
+    }
+
+    struct zmk_split_bt_link_stats *stats = &link_stats[ev->source];
+    uint32_t age = MAX(k_uptime_get() - ev->timestamp, 0);
+
+    stats->event_count++;
+    stats->event_age_total_ms += age;
+    stats->event_age_max_ms = MAX(stats->event_age_max_ms, age);
+}
+
+// Peripheral positions are raised by the kscan processing, so their age is taken as they go by.
+static int link_stats_listener(const zmk_event_t *eh) {
+    const struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
+    if (ev != NULL) {
+        link_stats_record_event(ev);
+    }
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(split_central_link_stats, link_stats_listener);
+ZMK_SUBSCRIPTION(split_central_link_stats, zmk_position_state_changed);
 
-void peripheral_event_work_callback(struct k_work *work) {
-    struct zmk_position_state_changed ev;
-    while (k_msgq_get(&peripheral_event_msgq, &ev, K_NO_WAIT) == 0) {
-        LOG_DBG("Trigger key position state change for %d", ev.position);
-        ZMK_EVENT_RAISE(new_zmk_position_state_changed(ev));
+static void link_stats_record_queue_depth(int source) {
+    if (source < 0 || source >= ZMK_BLE_SPLIT_PERIPHERAL_COUNT) {
+        return;
     }
+
+    link_stats[source].queue_depth_max =
+        MAX(link_stats[source].queue_depth_max, zmk_kscan_queued_peripheral_positions(source));
 }
 
-K_WORK_DEFINE(peripheral_event_work, peripheral_event_work_callback);
+#else
+
+#define link_stats_record_queue_depth(source)
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS) */
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY)
+
+// The host's battery service belongs to the central, and Zephyr's only supports one instance, so
+// the peripheral gets a battery service of its own.
+BUILD_ASSERT(ZMK_BLE_SPLIT_PERIPHERAL_COUNT == 1,
+             "The peripheral battery service only describes one peripheral");
+
+static uint8_t peripheral_battery_levels[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
+
+uint8_t zmk_split_bt_peripheral_battery_level(uint8_t source) {
+    if (source >= ZMK_BLE_SPLIT_PERIPHERAL_COUNT) {
+        return 0;
+    }
+
+    return peripheral_battery_levels[source];
+}
+
+static ssize_t peripheral_bas_read_level(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                         void *buf, uint16_t len, uint16_t offset) {
+    uint8_t level = peripheral_battery_levels[0];
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &level, sizeof(level));
+}
+
+BT_GATT_SERVICE_DEFINE(peripheral_bas, BT_GATT_PRIMARY_SERVICE(BT_UUID_BAS),
+                       BT_GATT_CHARACTERISTIC(BT_UUID_BAS_BATTERY_LEVEL,
+                                              BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_READ, peripheral_bas_read_level, NULL,
+                                              NULL),
+                       BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+                       BT_GATT_CUD("Peripheral", BT_GATT_PERM_READ));
+
+static void set_peripheral_battery_level(int source, int8_t value) {
+    uint8_t level = CLAMP(value, 0, 100);
+
+    if (source < 0 || peripheral_battery_levels[source] == level) {
+        return;
+    }
+
+    LOG_DBG("Peripheral %d battery level %d", source, level);
+    peripheral_battery_levels[source] = level;
+
+    int err = bt_gatt_notify(NULL, &peripheral_bas.attrs[1], &level, sizeof(level));
+    if (err && err != -ENOTCONN) {
+        LOG_WRN("Failed to notify the peripheral battery level (err %d)", err);
+    }
+
+    raise_zmk_peripheral_battery_state_changed(
+        (struct zmk_peripheral_battery_state_changed){.source = source, .state_of_charge = level});
+}
+
+#else
+
+#define set_peripheral_battery_level(source, value)
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERAL_BATTERY) */
+
+// Raises one event from each peripheral's queue in turn, until they are all empty.
+void peripheral_sensor_work_callback(struct k_work *work) {
+    struct zmk_sensor_event ev;
+    bool raised;
+
+    do {
+        raised = false;
+
+        for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+            if (k_msgq_get(&peripheral_sensor_msgqs[i], &ev, K_NO_WAIT) != 0) {
+                continue;
+            }
+
+            raised = true;
+
+            LOG_DBG("Trigger sensor %d", ev.sensor_number);
+            ZMK_EVENT_RAISE(new_zmk_sensor_event(ev));
+        }
+    } while (raised);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(peripheral_sensor_work_callback)
+K_WORK_DEFINE(peripheral_sensor_work, ZMK_WORK_WATCHED(peripheral_sensor_work_callback));
+
+static void enqueue_peripheral_sensor_event(int source, const struct zmk_sensor_event *ev) {
+    struct k_msgq *msgq = &peripheral_sensor_msgqs[source];
+
+    if (k_msgq_put(msgq, ev, K_NO_WAIT) == 0) {
+        zmk_pipeline_stats_queued(ZMK_PIPELINE_SPLIT_QUEUE, k_msgq_num_used_get(msgq));
+        zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_POSITION, msgq);
+    } else {
+        zmk_pipeline_stats_dropped(ZMK_PIPELINE_SPLIT_QUEUE);
+    }
+
+    k_work_submit_to_queue(zmk_input_work_q(), &peripheral_sensor_work);
+}
 
 int peripheral_slot_index_for_conn(struct bt_conn *conn) {
     for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
@@ -103,29 +303,39 @@ int release_peripheral_slot(int index) {
     slot->state = PERIPHERAL_SLOT_STATE_OPEN;
 
     // Raise events releasing any active positions from this peripheral
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (slot->position_state[i] & BIT(j)) {
-                uint32_t position = (i * 8) + j;
-                struct zmk_position_state_changed ev = {.source = index,
-                                                        .position = position,
-                                                        .state = false,
-                                                        .timestamp = k_uptime_get()};
-
-                k_msgq_put(&peripheral_event_msgq, &ev, K_NO_WAIT);
-                k_work_submit(&peripheral_event_work);
-            }
+    for (int i = 0; i < ZMK_POSITION_SET_WORDS; i++) {
+        for (uint32_t pressed = slot->position_state.words[i]; pressed; pressed &= pressed - 1) {
+            zmk_kscan_queue_peripheral_position(index, i * 32 + __builtin_ctz(pressed), false,
+                                                k_uptime_get());
         }
     }
 
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        slot->position_state[i] = 0U;
-        slot->changed_positions[i] = 0U;
-    }
+    zmk_position_set_clear(&slot->position_state);
+
+    // A disconnected peripheral's level would only go stale.
+    set_peripheral_battery_level(index, 0);
 
     // Clean up previously discovered handles;
     slot->subscribe_params.value_handle = 0;
+    slot->subscribe_params.ccc_handle = 0;
+    slot->position_state_handle = 0;
+    slot->position_events_handle = 0;
     slot->run_behavior_handle = 0;
+    slot->run_behavior_ids_handle = 0;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    slot->pointing_subscribe_params.value_handle = 0;
+    slot->pointing_subscribe_params.ccc_handle = 0;
+    slot->pointing_motion_handle = 0;
+#endif
+    slot->behavior_ids_match = false;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_CACHE_HANDLES)
+    slot->db_hash_valid = false;
+    slot->handles_cached = false;
+#endif
+    slot->resync_pending = false;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+    slot->rtt_pending = false;
+#endif
 
     return 0;
 }
@@ -136,6 +346,8 @@ int reserve_peripheral_slot() {
             // Be sure the slot is fully reinitialized.
             release_peripheral_slot(i);
             peripherals[i].state = PERIPHERAL_SLOT_STATE_CONNECTING;
+            atomic_set(&peripherals[i].write_credits,
+                       CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_WRITES_IN_FLIGHT);
             return i;
         }
     }
@@ -162,6 +374,75 @@ int confirm_peripheral_slot_conn(struct bt_conn *conn) {
     return 0;
 }
 
+// A single copy into the kscan queue, straight from the Bluetooth receive thread.
+static void queue_peripheral_event(int source, uint32_t position, bool pressed,
+                                   int64_t timestamp) {
+    if (source < 0) {
+        return;
+    }
+
+    zmk_kscan_queue_peripheral_position(source, position, pressed, timestamp);
+    link_stats_record_queue_depth(source);
+}
+
+// Sensor events from a peripheral have no local device, only the value it fetched.
+static void queue_peripheral_sensor_event(int source,
+                                          const struct zmk_split_position_event *event,
+                                          int64_t timestamp) {
+    uint8_t sensor_number = event->flags >> ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT;
+
+    if (source < 0) {
+        return;
+    }
+
+#if ZMK_KEYMAP_HAS_SENSORS
+    if (sensor_number >= ZMK_KEYMAP_SENSORS_LEN) {
+        LOG_ERR("Invalid sensor %d from peripheral", sensor_number);
+        return;
+    }
+
+    struct zmk_sensor_event ev = {
+        .sensor_number = sensor_number,
+        .sensor = NULL,
+        .value = {.val1 = event->sensor_value.val1, .val2 = event->sensor_value.val2},
+        .timestamp = timestamp};
+
+    enqueue_peripheral_sensor_event(source, &ev);
+#else
+    LOG_ERR("Sensor %d from peripheral, but the keymap has no sensors", sensor_number);
+#endif
+}
+
+// Raises a position change for every position that differs between the slot's state and data,
+// the peripheral's position state bitmap. Each half sizes the bitmap for its own keymap, so bytes
+// missing from data are released positions and bits past the central's keymap are ignored.
+static void split_central_apply_position_state(struct bt_conn *conn, struct peripheral_slot *slot,
+                                               const uint8_t *data, uint16_t length,
+                                               int64_t timestamp) {
+    int source = peripheral_slot_index_for_conn(conn);
+
+    for (int i = 0; i < ZMK_POSITION_SET_WORDS; i++) {
+        uint32_t word = 0;
+
+        for (int j = 0; j < 4 && i * 4 + j < length; j++) {
+            word |= (uint32_t)data[i * 4 + j] << (j * 8);
+        }
+
+        if (i == ZMK_POSITION_SET_WORDS - 1 && ZMK_KEYMAP_LEN % 32 != 0) {
+            word &= BIT_MASK(ZMK_KEYMAP_LEN % 32);
+        }
+
+        uint32_t changed = word ^ slot->position_state.words[i];
+        slot->position_state.words[i] = word;
+
+        for (; changed; changed &= changed - 1) {
+            int bit = __builtin_ctz(changed);
+
+            queue_peripheral_event(source, i * 32 + bit, word & BIT(bit), timestamp);
+        }
+    }
+}
+
 static uint8_t split_central_notify_func(struct bt_conn *conn,
                                          struct bt_gatt_subscribe_params *params, const void *data,
                                          uint16_t length) {
@@ -180,32 +461,214 @@ static uint8_t split_central_notify_func(struct bt_conn *conn,
 
     LOG_DBG("[NOTIFICATION] data %p length %u", data, length);
 
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        slot->changed_positions[i] = ((uint8_t *)data)[i] ^ slot->position_state[i];
-        slot->position_state[i] = ((uint8_t *)data)[i];
-        LOG_DBG("data: %d", slot->position_state[i]);
-    }
-
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (slot->changed_positions[i] & BIT(j)) {
-                uint32_t position = (i * 8) + j;
-                bool pressed = slot->position_state[i] & BIT(j);
-                struct zmk_position_state_changed ev = {.source =
-                                                            peripheral_slot_index_for_conn(conn),
-                                                        .position = position,
-                                                        .state = pressed,
-                                                        .timestamp = k_uptime_get()};
-
-                k_msgq_put(&peripheral_event_msgq, &ev, K_NO_WAIT);
-                k_work_submit(&peripheral_event_work);
-            }
+    // All transitions in one notification come from the same peripheral scan, so stamp them
+    // together on arrival rather than when the central work queue drains them.
+    split_central_apply_position_state(conn, slot, data, length, k_uptime_get());
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t split_central_resync_func(struct bt_conn *conn, uint8_t err,
+                                         struct bt_gatt_read_params *params, const void *data,
+                                         uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (slot == NULL) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    slot->resync_pending = false;
+
+    if (err) {
+        LOG_ERR("Failed to read the position state (err %d)", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (data == NULL) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("[RESYNC] data %p length %u", data, length);
+
+    split_central_apply_position_state(conn, slot, data, length, k_uptime_get());
+
+    return BT_GATT_ITER_STOP;
+}
+
+// Reads the whole position state, to catch up with changes the position events didn't carry.
+static void split_central_resync(struct bt_conn *conn, struct peripheral_slot *slot) {
+    if (slot->resync_pending) {
+        // The pending read already returns the state after every event sent so far.
+        return;
+    }
+
+    slot->resync_params.func = split_central_resync_func;
+    slot->resync_params.handle_count = 1;
+    slot->resync_params.single.handle = slot->position_state_handle;
+    slot->resync_params.single.offset = 0;
+
+    int err = bt_gatt_read(conn, &slot->resync_params);
+    if (err) {
+        LOG_ERR("Failed to start reading the position state (err %d)", err);
+        return;
+    }
+
+    slot->resync_pending = true;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+
+static uint8_t split_central_rtt_func(struct bt_conn *conn, uint8_t err,
+                                      struct bt_gatt_read_params *params, const void *data,
+                                      uint16_t length) {
+    int source = peripheral_slot_index_for_conn(conn);
+
+    if (source < 0) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    struct peripheral_slot *slot = &peripherals[source];
+    struct zmk_split_bt_link_stats *stats = &link_stats[source];
+
+    slot->rtt_pending = false;
+
+    if (err) {
+        LOG_WRN("Round trip read failed (err %d)", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    uint32_t rtt = k_cyc_to_us_floor32(k_cycle_get_32() - slot->rtt_start_cycles);
+
+    stats->rtt_last_us = rtt;
+    stats->rtt_min_us = stats->rtt_count == 0 ? rtt : MIN(stats->rtt_min_us, rtt);
+    stats->rtt_max_us = MAX(stats->rtt_max_us, rtt);
+    stats->rtt_total_us += rtt;
+    stats->rtt_count++;
+
+    LOG_DBG("Split link round trip %u us", rtt);
+
+    raise_zmk_split_link_stats_changed(
+        (struct zmk_split_link_stats_changed){.source = source, .rtt_us = rtt});
+
+    // Only the first read response carries the timing, skip the rest of a long read.
+    return BT_GATT_ITER_STOP;
+}
+
+static void split_central_rtt_probe(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(split_central_rtt_probe)
+static K_WORK_DELAYABLE_DEFINE(split_central_rtt_work, ZMK_WORK_WATCHED(split_central_rtt_probe));
+
+// Times a read of the position state. The read request and its response make the same trip over
+// the air a position notification and a run behavior write do, including the connection events
+// each waits for.
+static void split_central_rtt_probe(struct k_work *work) {
+    for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+        struct peripheral_slot *slot = &peripherals[i];
+
+        if (slot->state != PERIPHERAL_SLOT_STATE_CONNECTED || !slot->position_state_handle ||
+            slot->rtt_pending) {
+            continue;
         }
+
+        slot->rtt_params.func = split_central_rtt_func;
+        slot->rtt_params.handle_count = 1;
+        slot->rtt_params.single.handle = slot->position_state_handle;
+        slot->rtt_params.single.offset = 0;
+        slot->rtt_start_cycles = k_cycle_get_32();
+
+        int err = bt_gatt_read(slot->conn, &slot->rtt_params);
+        if (err) {
+            LOG_WRN("Failed to start round trip read (err %d)", err);
+            continue;
+        }
+
+        slot->rtt_pending = true;
+    }
+
+    k_work_schedule(&split_central_rtt_work,
+                    K_MSEC(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS_RTT_INTERVAL));
+}
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS) */
+
+static uint8_t split_central_position_events_notify_func(struct bt_conn *conn,
+                                                         struct bt_gatt_subscribe_params *params,
+                                                         const void *data, uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (slot == NULL) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    if (!data) {
+        LOG_DBG("[UNSUBSCRIBED]");
+        params->value_handle = 0U;
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("[NOTIFICATION] data %p length %u", data, length);
+
+    const struct zmk_split_position_event *events = data;
+    int64_t now = k_uptime_get();
+    int source = peripheral_slot_index_for_conn(conn);
+
+    for (int i = 0; i < length / sizeof(struct zmk_split_position_event); i++) {
+        const struct zmk_split_position_event *event = &events[i];
+
+        if (event->flags & ZMK_SPLIT_POSITION_EVENT_RESYNC) {
+            LOG_WRN("Peripheral dropped position events, resyncing");
+            split_central_resync(conn, slot);
+            continue;
+        }
+
+        if (event->position == ZMK_SPLIT_POSITION_EVENT_SENSOR &&
+            event->flags >> ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT == ZMK_SPLIT_SENSOR_EVENT_BATTERY) {
+            set_peripheral_battery_level(source, event->sensor_value.val1);
+            continue;
+        }
+
+        if (event->position == ZMK_SPLIT_POSITION_EVENT_SENSOR) {
+            // Sensor events carry their value in place of the age, so stamp them on arrival.
+            queue_peripheral_sensor_event(source, event, now);
+            continue;
+        }
+
+        if (event->position >= ZMK_KEYMAP_LEN) {
+            LOG_ERR("Invalid position %d from peripheral", event->position);
+            continue;
+        }
+
+        bool pressed = event->flags & ZMK_SPLIT_POSITION_EVENT_PRESSED;
+
+        // A resync may already have applied this change.
+        if (zmk_position_set_test(&slot->position_state, event->position) == pressed) {
+            continue;
+        }
+
+        if (pressed) {
+            zmk_position_set_add(&slot->position_state, event->position);
+        } else {
+            zmk_position_set_remove(&slot->position_state, event->position);
+        }
+
+        // The events are in the order the peripheral saw them, so stamp each one with when it
+        // happened there.
+        queue_peripheral_event(source, event->position, pressed, now - event->age);
     }
 
     return BT_GATT_ITER_CONTINUE;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_CACHE_HANDLES)
+static void split_central_subscribed(struct bt_conn *conn, uint8_t err,
+                                     struct bt_gatt_subscribe_params *params);
+#else
+#define split_central_subscribed NULL
+#endif
+
 static void split_central_subscribe(struct bt_conn *conn) {
     struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
     if (slot == NULL) {
@@ -225,88 +688,459 @@ static void split_central_subscribe(struct bt_conn *conn) {
         LOG_ERR("Subscribe failed (err %d)", err);
         break;
     }
-}
+}
+
+// Subscribes to position events if the peripheral has them, or else to the position state.
+static void split_central_subscribe_positions(struct bt_conn *conn, struct peripheral_slot *slot) {
+    if (slot->subscribe_params.value_handle) {
+        return;
+    }
+
+    if (slot->position_events_handle) {
+        slot->subscribe_params.value_handle = slot->position_events_handle;
+        slot->subscribe_params.notify = split_central_position_events_notify_func;
+    } else if (slot->position_state_handle) {
+        slot->subscribe_params.value_handle = slot->position_state_handle;
+        slot->subscribe_params.notify = split_central_notify_func;
+    } else {
+        LOG_ERR("No position characteristic found");
+        return;
+    }
+
+    slot->subscribe_params.disc_params = &slot->sub_discover_params;
+    slot->subscribe_params.end_handle = slot->discover_params.end_handle;
+    slot->subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    slot->subscribe_params.subscribe = split_central_subscribed;
+    split_central_subscribe(conn);
+
+    // Events only carry changes, so catch up with keys already held on the peripheral.
+    if (slot->position_events_handle && slot->position_state_handle) {
+        split_central_resync(conn, slot);
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+static uint8_t split_central_pointing_notify_func(struct bt_conn *conn,
+                                                  struct bt_gatt_subscribe_params *params,
+                                                  const void *data, uint16_t length) {
+    if (!data) {
+        LOG_DBG("[UNSUBSCRIBED]");
+        params->value_handle = 0U;
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (length != sizeof(struct zmk_split_pointing_motion)) {
+        LOG_ERR("Invalid pointing motion length %u from peripheral", length);
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    const struct zmk_split_pointing_motion *motion = data;
+
+    zmk_pointing_motion_received(motion->dx, motion->dy);
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+// Peripherals without pointing devices, or running older firmware, don't have pointing motion.
+static void split_central_subscribe_pointing(struct bt_conn *conn, struct peripheral_slot *slot) {
+    if (slot->pointing_subscribe_params.value_handle || !slot->pointing_motion_handle) {
+        return;
+    }
+
+    slot->pointing_subscribe_params.value_handle = slot->pointing_motion_handle;
+    slot->pointing_subscribe_params.notify = split_central_pointing_notify_func;
+    slot->pointing_subscribe_params.disc_params = &slot->pointing_sub_discover_params;
+    slot->pointing_subscribe_params.end_handle = slot->discover_params.end_handle;
+    slot->pointing_subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    slot->pointing_subscribe_params.subscribe = split_central_subscribed;
+
+    int err = bt_gatt_subscribe(conn, &slot->pointing_subscribe_params);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Subscribe to pointing motion failed (err %d)", err);
+    }
+}
+#else
+#define split_central_subscribe_pointing(conn, slot)
+#endif /* IS_ENABLED(CONFIG_ZMK_POINTING) */
+
+static uint8_t split_central_behavior_table_func(struct bt_conn *conn, uint8_t err,
+                                                struct bt_gatt_read_params *params,
+                                                const void *data, uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (slot == NULL || data == NULL) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (err) {
+        LOG_ERR("Failed to read the peripheral behavior table hash (err %d)", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    uint32_t hash;
+    if (length != sizeof(hash)) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    memcpy(&hash, data, sizeof(hash));
+    slot->behavior_ids_match = (hash == zmk_split_bt_behavior_table_hash());
+
+    if (!slot->behavior_ids_match) {
+        LOG_WRN("Peripheral has different behaviors, invoking them by label");
+    }
+
+    return BT_GATT_ITER_STOP;
+}
+
+// Reads the peripheral's behavior table hash, to learn whether behavior ids can be used.
+static void split_central_check_behavior_ids(struct bt_conn *conn, struct peripheral_slot *slot) {
+    if (!slot->run_behavior_ids_handle) {
+        return;
+    }
+
+    slot->behavior_table_params.func = split_central_behavior_table_func;
+    slot->behavior_table_params.handle_count = 1;
+    slot->behavior_table_params.single.handle = slot->run_behavior_ids_handle;
+    slot->behavior_table_params.single.offset = 0;
+
+    int err = bt_gatt_read(conn, &slot->behavior_table_params);
+    if (err) {
+        LOG_ERR("Failed to start reading the peripheral behavior table hash (err %d)", err);
+    }
+}
+
+static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
+                                                 const struct bt_gatt_attr *attr,
+                                                 struct bt_gatt_discover_params *params) {
+    if (!attr) {
+        LOG_DBG("Discover complete");
+
+        // Peripherals running older firmware don't have position events.
+        struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+        if (slot != NULL) {
+            split_central_subscribe_positions(conn, slot);
+            split_central_subscribe_pointing(conn, slot);
+            split_central_check_behavior_ids(conn, slot);
+        }
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (!attr->user_data) {
+        LOG_ERR("Required user data not passed to discovery");
+        return BT_GATT_ITER_STOP;
+    }
+
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+    if (slot == NULL) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("[ATTRIBUTE] handle %u", attr->handle);
+
+    if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                     BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_STATE_UUID))) {
+        LOG_DBG("Found position state characteristic");
+        slot->position_state_handle = bt_gatt_attr_value_handle(attr);
+    } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                            BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_EVENTS_UUID))) {
+        LOG_DBG("Found position events characteristic");
+        slot->position_events_handle = bt_gatt_attr_value_handle(attr);
+    } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                            BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_UUID))) {
+        LOG_DBG("Found run behavior handle");
+        slot->run_behavior_handle = bt_gatt_attr_value_handle(attr);
+    } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                            BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_IDS_UUID))) {
+        LOG_DBG("Found run behavior ids handle");
+        slot->run_behavior_ids_handle = bt_gatt_attr_value_handle(attr);
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                            BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POINTING_MOTION_UUID))) {
+        LOG_DBG("Found pointing motion handle");
+        slot->pointing_motion_handle = bt_gatt_attr_value_handle(attr);
+#endif
+    }
+
+    bool found_all = (slot->run_behavior_handle && slot->position_state_handle &&
+                      slot->position_events_handle && slot->run_behavior_ids_handle);
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    found_all = found_all && slot->pointing_motion_handle;
+#endif
+    if (!found_all) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    split_central_subscribe_positions(conn, slot);
+    split_central_subscribe_pointing(conn, slot);
+    split_central_check_behavior_ids(conn, slot);
+    return BT_GATT_ITER_STOP;
+}
+
+static uint8_t split_central_service_discovery_func(struct bt_conn *conn,
+                                                    const struct bt_gatt_attr *attr,
+                                                    struct bt_gatt_discover_params *params) {
+    if (!attr) {
+        LOG_DBG("Discover complete");
+        (void)memset(params, 0, sizeof(*params));
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("[ATTRIBUTE] handle %u", attr->handle);
+
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+    if (slot == NULL) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (bt_uuid_cmp(slot->discover_params.uuid, BT_UUID_DECLARE_128(ZMK_SPLIT_BT_SERVICE_UUID))) {
+        LOG_DBG("Found other service");
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    LOG_DBG("Found split service");
+    slot->discover_params.uuid = NULL;
+    slot->discover_params.func = split_central_chrc_discovery_func;
+    slot->discover_params.start_handle = attr->handle + 1;
+    slot->discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    int err = bt_gatt_discover(conn, &slot->discover_params);
+    if (err) {
+        LOG_ERR("Failed to start discovering split service characteristics (err %d)", err);
+    }
+    return BT_GATT_ITER_STOP;
+}
+
+static void split_central_discover(struct bt_conn *conn, struct peripheral_slot *slot) {
+    slot->discover_params.uuid = &split_service_uuid.uuid;
+    slot->discover_params.func = split_central_service_discovery_func;
+    slot->discover_params.start_handle = 0x0001;
+    slot->discover_params.end_handle = 0xffff;
+    slot->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
+
+    int err = bt_gatt_discover(conn, &slot->discover_params);
+    if (err) {
+        LOG_ERR("Discover failed(err %d)", err);
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_CACHE_HANDLES)
+
+// Handles of a bonded peripheral's split service, so reconnecting doesn't need discovery. This is
+// also the format persisted to settings, so it doesn't depend on which features are enabled.
+struct handle_cache_entry {
+    bt_addr_le_t addr;
+    // GATT database hash of the peripheral when the handles were discovered.
+    uint8_t db_hash[16];
+    uint16_t position_state_handle;
+    uint16_t position_events_handle;
+    uint16_t position_ccc_handle;
+    uint16_t run_behavior_handle;
+    uint16_t run_behavior_ids_handle;
+    uint16_t pointing_motion_handle;
+    uint16_t pointing_ccc_handle;
+};
+
+static struct handle_cache_entry handle_cache[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
+
+static void handle_cache_save_work() {
+    int err = settings_save_one("split/handles", handle_cache, sizeof(handle_cache));
+    if (err) {
+        LOG_ERR("Failed to save split peripheral handles (err %d)", err);
+    }
+}
+
+ZMK_SETTINGS_SAVE_DEFINE(handle_cache_save, handle_cache_save_work);
+
+static int handle_cache_handle_set(const char *name, size_t len, settings_read_cb read_cb,
+                                   void *cb_arg) {
+    if (!settings_name_steq(name, "handles", NULL)) {
+        return 0;
+    }
+
+    // Entries for a different number of peripherals are just discovered again.
+    if (len != sizeof(handle_cache)) {
+        LOG_WRN("Ignoring saved split peripheral handles of a different size (got %d)", len);
+        return 0;
+    }
+
+    int err = read_cb(cb_arg, handle_cache, len);
+    if (err <= 0) {
+        LOG_ERR("Failed to read split peripheral handles from settings (err %d)", err);
+        memset(handle_cache, 0, sizeof(handle_cache));
+        return err;
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(split_handles, "split", NULL, handle_cache_handle_set, NULL, NULL);
+
+static struct handle_cache_entry *handle_cache_find(const bt_addr_le_t *addr) {
+    for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+        if (bt_addr_le_cmp(&handle_cache[i].addr, addr) == 0) {
+            return &handle_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Saves the handles once a discovered subscription is confirmed, since that is when the CCC
+// handle is known.
+static void handle_cache_store(struct bt_conn *conn, struct peripheral_slot *slot) {
+    if (!slot->db_hash_valid) {
+        return;
+    }
+
+    const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+    struct handle_cache_entry *entry = handle_cache_find(addr);
+    if (entry == NULL) {
+        entry = handle_cache_find(BT_ADDR_LE_ANY);
+    }
+    if (entry == NULL) {
+        entry = &handle_cache[peripheral_slot_index_for_conn(conn)];
+    }
 
-static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
-                                                 const struct bt_gatt_attr *attr,
-                                                 struct bt_gatt_discover_params *params) {
-    if (!attr) {
-        LOG_DBG("Discover complete");
-        return BT_GATT_ITER_STOP;
+    struct handle_cache_entry updated = {
+        .position_state_handle = slot->position_state_handle,
+        .position_events_handle = slot->position_events_handle,
+        .position_ccc_handle = slot->subscribe_params.ccc_handle,
+        .run_behavior_handle = slot->run_behavior_handle,
+        .run_behavior_ids_handle = slot->run_behavior_ids_handle,
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+        .pointing_motion_handle = slot->pointing_motion_handle,
+        .pointing_ccc_handle = slot->pointing_subscribe_params.ccc_handle,
+#endif
+    };
+    bt_addr_le_copy(&updated.addr, addr);
+    memcpy(updated.db_hash, slot->db_hash, sizeof(updated.db_hash));
+
+    if (memcmp(entry, &updated, sizeof(updated)) == 0) {
+        return;
     }
 
-    if (!attr->user_data) {
-        LOG_ERR("Required user data not passed to discovery");
-        return BT_GATT_ITER_STOP;
+    *entry = updated;
+    zmk_settings_save(&handle_cache_save);
+}
+
+static void handle_cache_drop(const bt_addr_le_t *addr) {
+    struct handle_cache_entry *entry = handle_cache_find(addr);
+    if (entry != NULL) {
+        memset(entry, 0, sizeof(*entry));
+        zmk_settings_save(&handle_cache_save);
     }
+}
 
+static void split_central_subscribed(struct bt_conn *conn, uint8_t err,
+                                     struct bt_gatt_subscribe_params *params) {
     struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
     if (slot == NULL) {
-        LOG_ERR("No peripheral state found for connection");
-        return BT_GATT_ITER_STOP;
+        return;
     }
 
-    LOG_DBG("[ATTRIBUTE] handle %u", attr->handle);
-
-    if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
-                     BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_STATE_UUID))) {
-        LOG_DBG("Found position state characteristic");
-        slot->discover_params.uuid = NULL;
-        slot->discover_params.start_handle = attr->handle + 2;
-        slot->discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+    if (!err) {
+        if (!slot->handles_cached) {
+            handle_cache_store(conn, slot);
+        }
+        return;
+    }
 
-        slot->subscribe_params.disc_params = &slot->sub_discover_params;
-        slot->subscribe_params.end_handle = slot->discover_params.end_handle;
-        slot->subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
-        slot->subscribe_params.notify = split_central_notify_func;
-        slot->subscribe_params.value = BT_GATT_CCC_NOTIFY;
-        split_central_subscribe(conn);
-    } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
-                            BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_UUID))) {
-        LOG_DBG("Found run behavior handle");
-        slot->run_behavior_handle = bt_gatt_attr_value_handle(attr);
+    if (!slot->handles_cached) {
+        return;
     }
 
-    bool subscribed = (slot->run_behavior_handle && slot->subscribe_params.value_handle);
+    // The database hash matched, but the peripheral still refused a cached handle, so forget
+    // them and find the real ones.
+    LOG_WRN("Subscribing with cached handles failed (err %u), discovering again", err);
+    handle_cache_drop(bt_conn_get_dst(conn));
+    slot->handles_cached = false;
+    slot->subscribe_params.value_handle = 0;
+    slot->subscribe_params.ccc_handle = 0;
+    slot->position_state_handle = 0;
+    slot->position_events_handle = 0;
+    slot->run_behavior_handle = 0;
+    slot->run_behavior_ids_handle = 0;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    slot->pointing_subscribe_params.value_handle = 0;
+    slot->pointing_subscribe_params.ccc_handle = 0;
+    slot->pointing_motion_handle = 0;
+#endif
+    split_central_discover(conn, slot);
+}
 
-    return subscribed ? BT_GATT_ITER_STOP : BT_GATT_ITER_CONTINUE;
+static void split_central_use_cached_handles(struct bt_conn *conn, struct peripheral_slot *slot,
+                                             const struct handle_cache_entry *entry) {
+    LOG_DBG("Using cached split service handles");
+
+    slot->handles_cached = true;
+    slot->position_state_handle = entry->position_state_handle;
+    slot->position_events_handle = entry->position_events_handle;
+    slot->run_behavior_handle = entry->run_behavior_handle;
+    slot->run_behavior_ids_handle = entry->run_behavior_ids_handle;
+    slot->subscribe_params.ccc_handle = entry->position_ccc_handle;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    slot->pointing_motion_handle = entry->pointing_motion_handle;
+    slot->pointing_subscribe_params.ccc_handle = entry->pointing_ccc_handle;
+#endif
+    // Only used to find a CCC that wasn't cached.
+    slot->discover_params.end_handle = 0xffff;
+
+    split_central_subscribe_positions(conn, slot);
+    split_central_subscribe_pointing(conn, slot);
+    split_central_check_behavior_ids(conn, slot);
 }
 
-static uint8_t split_central_service_discovery_func(struct bt_conn *conn,
-                                                    const struct bt_gatt_attr *attr,
-                                                    struct bt_gatt_discover_params *params) {
-    if (!attr) {
-        LOG_DBG("Discover complete");
-        (void)memset(params, 0, sizeof(*params));
+static uint8_t split_central_db_hash_func(struct bt_conn *conn, uint8_t err,
+                                          struct bt_gatt_read_params *params, const void *data,
+                                          uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+    if (slot == NULL) {
         return BT_GATT_ITER_STOP;
     }
 
-    LOG_DBG("[ATTRIBUTE] handle %u", attr->handle);
-
-    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
-    if (slot == NULL) {
-        LOG_ERR("No peripheral state found for connection");
+    // Peripherals built without GATT caching have no hash, so their handles aren't cached.
+    if (err || data == NULL || length != sizeof(slot->db_hash)) {
+        LOG_DBG("No GATT database hash from peripheral (err %u)", err);
+        split_central_discover(conn, slot);
         return BT_GATT_ITER_STOP;
     }
 
-    if (bt_uuid_cmp(slot->discover_params.uuid, BT_UUID_DECLARE_128(ZMK_SPLIT_BT_SERVICE_UUID))) {
-        LOG_DBG("Found other service");
-        return BT_GATT_ITER_CONTINUE;
+    memcpy(slot->db_hash, data, sizeof(slot->db_hash));
+    slot->db_hash_valid = true;
+
+    const struct handle_cache_entry *entry = handle_cache_find(bt_conn_get_dst(conn));
+    if (entry != NULL && memcmp(entry->db_hash, slot->db_hash, sizeof(slot->db_hash)) == 0) {
+        split_central_use_cached_handles(conn, slot, entry);
+    } else {
+        // A changed hash means the peripheral's services changed, e.g. with new firmware.
+        split_central_discover(conn, slot);
     }
 
-    LOG_DBG("Found split service");
-    slot->discover_params.uuid = NULL;
-    slot->discover_params.func = split_central_chrc_discovery_func;
-    slot->discover_params.start_handle = attr->handle + 1;
-    slot->discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+    return BT_GATT_ITER_STOP;
+}
 
-    int err = bt_gatt_discover(conn, &slot->discover_params);
+// Reads the peripheral's GATT database hash, which tells whether cached handles are still valid
+// in a single round trip, before either using them or discovering the service.
+static void split_central_find_handles(struct bt_conn *conn, struct peripheral_slot *slot) {
+    slot->db_hash_params.func = split_central_db_hash_func;
+    slot->db_hash_params.handle_count = 0;
+    slot->db_hash_params.by_uuid.start_handle = 0x0001;
+    slot->db_hash_params.by_uuid.end_handle = 0xffff;
+    slot->db_hash_params.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+
+    int err = bt_gatt_read(conn, &slot->db_hash_params);
     if (err) {
-        LOG_ERR("Failed to start discovering split service characteristics (err %d)", err);
+        LOG_ERR("Failed to start reading the GATT database hash (err %d)", err);
+        split_central_discover(conn, slot);
     }
-    return BT_GATT_ITER_STOP;
 }
 
+#else
+#define split_central_find_handles split_central_discover
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_CACHE_HANDLES) */
+
 static void split_central_process_connection(struct bt_conn *conn) {
     int err;
 
@@ -325,17 +1159,7 @@ static void split_central_process_connection(struct bt_conn *conn) {
     }
 
     if (!slot->subscribe_params.value_handle) {
-        slot->discover_params.uuid = &split_service_uuid.uuid;
-        slot->discover_params.func = split_central_service_discovery_func;
-        slot->discover_params.start_handle = 0x0001;
-        slot->discover_params.end_handle = 0xffff;
-        slot->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
-
-        err = bt_gatt_discover(slot->conn, &slot->discover_params);
-        if (err) {
-            LOG_ERR("Discover failed(err %d)", err);
-            return;
-        }
+        split_central_find_handles(slot->conn, slot);
     }
 
     struct bt_conn_info info;
@@ -346,6 +1170,54 @@ static void split_central_process_connection(struct bt_conn *conn) {
             info.le.latency, info.le.phy->rx_phy);
 }
 
+// Stops scanning and connects to the peripheral at addr. Returns an error if scanning couldn't be
+// stopped or no peripheral slot is free, in which case scanning carries on.
+static int split_central_connect(bt_addr_le_t *addr) {
+    struct bt_le_conn_param *param;
+    int err;
+
+    err = bt_le_scan_stop();
+    if (err) {
+        LOG_ERR("Stop LE scan failed (err %d)", err);
+        return err;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+    k_work_cancel_delayable(&known_peripheral_scan_timeout_work);
+#endif
+
+    int slot_idx = reserve_peripheral_slot();
+    if (slot_idx < 0) {
+        LOG_ERR("Faild to reserve peripheral slot (err %d)", slot_idx);
+        return slot_idx;
+    }
+
+    struct peripheral_slot *slot = &peripherals[slot_idx];
+
+    slot->conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+    if (slot->conn) {
+        LOG_DBG("Found existing connection");
+        split_central_process_connection(slot->conn);
+        err = bt_conn_le_phy_update(slot->conn, BT_CONN_LE_PHY_PARAM_2M);
+        if (err) {
+            LOG_ERR("Update phy conn failed (err %d)", err);
+        }
+    } else {
+        param = BT_LE_CONN_PARAM(0x0006, 0x0006, 30, 400);
+
+        LOG_DBG("Initiating new connnection");
+
+        err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, param, &slot->conn);
+        if (err) {
+            LOG_ERR("Create conn failed (err %d) (create conn? 0x%04x)", err,
+                    BT_HCI_OP_LE_CREATE_CONN);
+            start_scan();
+        }
+    }
+
+    return 0;
+}
+
 static bool split_central_eir_found(struct bt_data *data, void *user_data) {
     bt_addr_le_t *addr = user_data;
     int i;
@@ -361,9 +1233,7 @@ static bool split_central_eir_found(struct bt_data *data, void *user_data) {
         }
 
         for (i = 0; i < data->data_len; i += 16) {
-            struct bt_le_conn_param *param;
             struct bt_uuid_128 uuid;
-            int err;
 
             if (!bt_uuid_create(&uuid.uuid, &data->data[i], 16)) {
                 LOG_ERR("Unable to load UUID");
@@ -386,41 +1256,10 @@ static bool split_central_eir_found(struct bt_data *data, void *user_data) {
 
             zmk_ble_set_peripheral_addr(addr);
 
-            err = bt_le_scan_stop();
-            if (err) {
-                LOG_ERR("Stop LE scan failed (err %d)", err);
-                continue;
-            }
-
-            uint8_t slot_idx = reserve_peripheral_slot();
-            if (slot_idx < 0) {
-                LOG_ERR("Faild to reserve peripheral slot (err %d)", slot_idx);
+            if (split_central_connect(addr) < 0) {
                 continue;
             }
 
-            struct peripheral_slot *slot = &peripherals[slot_idx];
-
-            slot->conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
-            if (slot->conn) {
-                LOG_DBG("Found existing connection");
-                split_central_process_connection(slot->conn);
-                err = bt_conn_le_phy_update(slot->conn, BT_CONN_LE_PHY_PARAM_2M);
-                if (err) {
-                    LOG_ERR("Update phy conn failed (err %d)", err);
-                }
-            } else {
-                param = BT_LE_CONN_PARAM(0x0006, 0x0006, 30, 400);
-
-                LOG_DBG("Initiating new connnection");
-
-                err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, param, &slot->conn);
-                if (err) {
-                    LOG_ERR("Create conn failed (err %d) (create conn? 0x%04x)", err,
-                            BT_HCI_OP_LE_CREATE_CONN);
-                    start_scan();
-                }
-            }
-
             return false;
         }
     }
@@ -437,14 +1276,91 @@ static void split_central_device_found(const bt_addr_le_t *addr, int8_t rssi, ui
             rssi);
 
     /* We're only interested in connectable events */
-    if (type == BT_GAP_ADV_TYPE_ADV_IND || type == BT_GAP_ADV_TYPE_ADV_DIRECT_IND) {
-        bt_data_parse(ad, split_central_eir_found, (void *)addr);
+    if (type != BT_GAP_ADV_TYPE_ADV_IND && type != BT_GAP_ADV_TYPE_ADV_DIRECT_IND) {
+        return;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+    // The controller only reports the known peripheral's adverts, so there's nothing to look for.
+    if (known_peripheral_scan) {
+        split_central_connect((bt_addr_le_t *)addr);
+        return;
+    }
+#endif
+
+    bt_data_parse(ad, split_central_eir_found, (void *)addr);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+// Scans for the bonded peripheral only, letting the controller drop every other device's adverts.
+static int start_known_peripheral_scan(void) {
+    bt_addr_le_t *addr = zmk_ble_peripheral_addr();
+    int err;
+
+    if (!bt_addr_le_cmp(addr, BT_ADDR_LE_ANY)) {
+        return -ENOENT;
+    }
+
+    bt_le_filter_accept_list_clear();
+
+    err = bt_le_filter_accept_list_add(addr);
+    if (err) {
+        LOG_WRN("Failed to add the peripheral to the filter accept list (err %d)", err);
+        return err;
+    }
+
+    err = bt_le_scan_start(BT_LE_SCAN_PARAM(BT_LE_SCAN_TYPE_PASSIVE,
+                                            BT_LE_SCAN_OPT_FILTER_DUPLICATE |
+                                                BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST,
+                                            BT_GAP_SCAN_FAST_INTERVAL, BT_GAP_SCAN_FAST_WINDOW),
+                           split_central_device_found);
+    if (err) {
+        LOG_WRN("Filtered scanning failed to start (err %d)", err);
+        return err;
+    }
+
+    known_peripheral_scan = true;
+    k_work_schedule(&known_peripheral_scan_timeout_work,
+                    K_MSEC(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN_TIMEOUT));
+
+    LOG_DBG("Scanning for the known peripheral");
+    return 0;
+}
+
+// The known peripheral didn't show up, perhaps because this half is now paired with a different
+// one. Go back to looking for any device with the split service until a peripheral connects.
+static void known_peripheral_scan_timeout(struct k_work *work) {
+    int err;
+
+    if (!known_peripheral_scan) {
+        return;
+    }
+
+    LOG_DBG("Known peripheral not found, scanning for any peripheral");
+
+    known_peripheral_scan_timed_out = true;
+
+    err = bt_le_scan_stop();
+    if (err) {
+        LOG_ERR("Stop LE scan failed (err %d)", err);
+        return;
     }
+
+    start_scan();
 }
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN) */
 
 static int start_scan(void) {
     int err;
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+    known_peripheral_scan = false;
+
+    if (!known_peripheral_scan_timed_out && start_known_peripheral_scan() == 0) {
+        return 0;
+    }
+#endif
+
     err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, split_central_device_found);
     if (err) {
         LOG_ERR("Scanning failed to start (err %d)", err);
@@ -455,6 +1371,32 @@ static int start_scan(void) {
     return 0;
 }
 
+static void split_central_mtu_exchanged(struct bt_conn *conn, uint8_t err,
+                                        struct bt_gatt_exchange_params *params) {
+    if (err) {
+        LOG_WRN("Failed to exchange the ATT MTU (err %d)", err);
+        return;
+    }
+
+    LOG_DBG("ATT MTU %d", bt_gatt_get_mtu(conn));
+}
+
+// The default ATT MTU only fits the position state of 160 keys in a notification, and fewer run
+// behavior invocations or position events than the links can carry.
+static void split_central_exchange_mtu(struct bt_conn *conn) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+    if (slot == NULL) {
+        return;
+    }
+
+    slot->mtu_exchange_params.func = split_central_mtu_exchanged;
+
+    int err = bt_gatt_exchange_mtu(conn, &slot->mtu_exchange_params);
+    if (err) {
+        LOG_WRN("Failed to start the ATT MTU exchange (err %d)", err);
+    }
+}
+
 static void split_central_connected(struct bt_conn *conn, uint8_t conn_err) {
     char addr[BT_ADDR_LE_STR_LEN];
     struct bt_conn_info info;
@@ -479,7 +1421,12 @@ static void split_central_connected(struct bt_conn *conn, uint8_t conn_err) {
 
     LOG_DBG("Connected: %s", log_strdup(addr));
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_KNOWN_PERIPHERAL_SCAN)
+    known_peripheral_scan_timed_out = false;
+#endif
+
     confirm_peripheral_slot_conn(conn);
+    split_central_exchange_mtu(conn);
     split_central_process_connection(conn);
 }
 
@@ -505,55 +1452,255 @@ static struct bt_conn_cb conn_callbacks = {
     .disconnected = split_central_disconnected,
 };
 
+#if !IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
 K_THREAD_STACK_DEFINE(split_central_split_run_q_stack,
                       CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_STACK_SIZE);
 
-struct k_work_q split_central_split_run_q;
+static struct k_work_q split_central_own_split_run_q;
+#endif
+
+static struct k_work_q *split_central_split_run_q;
 
 struct zmk_split_run_behavior_payload_wrapper {
     uint8_t source;
+    // Looked up from the full label, since the payload may only have room for a truncated one.
+    uint8_t behavior_id;
     struct zmk_split_run_behavior_payload payload;
 };
 
-K_MSGQ_DEFINE(zmk_split_central_split_run_msgq,
-              sizeof(struct zmk_split_run_behavior_payload_wrapper),
-              CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_QUEUE_SIZE, 4);
+// Invocations waiting to go out to one peripheral. Each peripheral has its own queue, so one
+// that's slow to accept writes, or has a burst of invocations queued, doesn't hold up the others.
+// Only used from the split run work queue, apart from the message queue.
+struct run_queue {
+    struct k_msgq msgq;
+    // An invocation that couldn't be written because the link was busy. It goes out before
+    // anything still in the message queue.
+    struct zmk_split_run_behavior_payload_wrapper held;
+    bool has_held;
+    // Invocations by id waiting to go out in a single write.
+    uint8_t batch_count;
+    struct zmk_split_run_behavior_id_data batch[ZMK_SPLIT_RUN_BEHAVIOR_IDS_PER_WRITE];
+};
+
+#define RUN_QUEUE_BUF_SIZE                                                                         \
+    (CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_QUEUE_SIZE *                                           \
+     sizeof(struct zmk_split_run_behavior_payload_wrapper))
 
-void split_central_split_run_callback(struct k_work *work) {
-    struct zmk_split_run_behavior_payload_wrapper payload_wrapper;
+static struct run_queue run_queues[ZMK_BLE_SPLIT_PERIPHERAL_COUNT];
+static char __aligned(4) run_queue_bufs[ZMK_BLE_SPLIT_PERIPHERAL_COUNT][RUN_QUEUE_BUF_SIZE];
 
-    LOG_DBG("");
+static void split_central_split_run_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(split_central_split_run_callback)
+static K_WORK_DELAYABLE_DEFINE(split_central_split_run_work,
+                               ZMK_WORK_WATCHED(split_central_split_run_callback));
+
+// Writes without response only use a TX buffer until the controller has sent them, so each slot
+// allows a few in flight and the completion callbacks hand the credits back.
+static void split_central_write_complete(struct bt_conn *conn, void *user_data) {
+    struct peripheral_slot *slot = user_data;
+
+    atomic_inc(&slot->write_credits);
+    k_work_reschedule_for_queue(split_central_split_run_q, &split_central_split_run_work,
+                                K_NO_WAIT);
+}
+
+// Errors that only mean the link is busy, so the write should be tried again later.
+static bool is_write_busy(int err) { return err == -EAGAIN || err == -ENOMEM || err == -ENOBUFS; }
+
+static int write_run_behavior(struct peripheral_slot *slot, uint16_t handle, const void *data,
+                              uint16_t length) {
+    // Credits are only taken from the split run work queue, so this can't go negative.
+    if (atomic_get(&slot->write_credits) <= 0) {
+        return -EAGAIN;
+    }
+
+    atomic_dec(&slot->write_credits);
+
+    int err = bt_gatt_write_without_response_cb(slot->conn, handle, data, length, true,
+                                                split_central_write_complete, slot);
+    zmk_hot_path_trace(ZMK_HOT_PATH_SPLIT_SEND, NULL, err ? err : length,
+                       ZMK_HOT_PATH_SPLIT_RUN_BEHAVIOR);
+    if (err) {
+        atomic_inc(&slot->write_credits);
+    }
+
+    return err;
+}
+
+// Sends the peripheral's batch. If the link is busy, the batch is kept and the error returned.
+static int flush_run_batch(int index) {
+    struct run_queue *queue = &run_queues[index];
+    struct peripheral_slot *slot = &peripherals[index];
+
+    if (queue->batch_count == 0) {
+        return 0;
+    }
+
+    if (slot->state != PERIPHERAL_SLOT_STATE_CONNECTED) {
+        queue->batch_count = 0;
+        return 0;
+    }
+
+    int err = write_run_behavior(slot, slot->run_behavior_ids_handle, queue->batch,
+                                 queue->batch_count * sizeof(queue->batch[0]));
+    if (is_write_busy(err)) {
+        return err;
+    }
+
+    if (err) {
+        LOG_ERR("Failed to write the behavior ids characteristic (err %d)", err);
+    }
+
+    queue->batch_count = 0;
+    return 0;
+}
+
+// Adds the invocation to the peripheral's batch if it can take it by id, returning -ENOTSUP if it
+// can't. A full batch, for the ATT MTU, is sent first.
+static int batch_run_behavior(const struct zmk_split_run_behavior_payload_wrapper *wrapper) {
+    struct run_queue *queue = &run_queues[wrapper->source];
+    struct peripheral_slot *slot = &peripherals[wrapper->source];
+
+    if (!slot->behavior_ids_match || wrapper->behavior_id == ZMK_SPLIT_BEHAVIOR_ID_NONE) {
+        return -ENOTSUP;
+    }
+
+    size_t max_count = MIN(ARRAY_SIZE(queue->batch),
+                           (bt_gatt_get_mtu(slot->conn) - 3) / sizeof(queue->batch[0]));
+
+    if (queue->batch_count >= max_count) {
+        int err = flush_run_batch(wrapper->source);
+        if (err) {
+            return err;
+        }
+    }
 
-    while (k_msgq_get(&zmk_split_central_split_run_msgq, &payload_wrapper, K_NO_WAIT) == 0) {
-        if (peripherals[payload_wrapper.source].state != PERIPHERAL_SLOT_STATE_CONNECTED) {
+    queue->batch[queue->batch_count++] = (struct zmk_split_run_behavior_id_data){
+        .behavior_id = wrapper->behavior_id,
+        .data = wrapper->payload.data,
+    };
+
+    return 0;
+}
+
+static int
+write_run_behavior_payload(const struct zmk_split_run_behavior_payload_wrapper *wrapper) {
+    struct peripheral_slot *slot = &peripherals[wrapper->source];
+
+    // Send the batch first, so the invocations stay in order.
+    int err = flush_run_batch(wrapper->source);
+    if (err) {
+        return err;
+    }
+
+    err = write_run_behavior(slot, slot->run_behavior_handle, &wrapper->payload,
+                             sizeof(struct zmk_split_run_behavior_payload));
+    if (err && !is_write_busy(err)) {
+        LOG_ERR("Failed to write the behavior characteristic (err %d)", err);
+        return 0;
+    }
+
+    return err;
+}
+
+static bool take_payload_wrapper(struct run_queue *queue,
+                                 struct zmk_split_run_behavior_payload_wrapper *wrapper) {
+    if (queue->has_held) {
+        *wrapper = queue->held;
+        queue->has_held = false;
+        return true;
+    }
+
+    return k_msgq_get(&queue->msgq, wrapper, K_NO_WAIT) == 0;
+}
+
+// Sends up to one write's worth of the invocations queued for the peripheral. Returns how many
+// went out, or an error if the link is busy, in which case the rest is kept for later.
+static int run_queued_behaviors(int index) {
+    struct run_queue *queue = &run_queues[index];
+    struct zmk_split_run_behavior_payload_wrapper payload_wrapper;
+    int count = 0;
+
+    while (count < ZMK_SPLIT_RUN_BEHAVIOR_IDS_PER_WRITE &&
+           take_payload_wrapper(queue, &payload_wrapper)) {
+        if (peripherals[index].state != PERIPHERAL_SLOT_STATE_CONNECTED) {
             LOG_ERR("Source not connected");
             continue;
         }
 
-        int err = bt_gatt_write_without_response(
-            peripherals[payload_wrapper.source].conn,
-            peripherals[payload_wrapper.source].run_behavior_handle, &payload_wrapper.payload,
-            sizeof(struct zmk_split_run_behavior_payload), true);
+        int err = batch_run_behavior(&payload_wrapper);
+        if (err == -ENOTSUP) {
+            err = write_run_behavior_payload(&payload_wrapper);
+        }
 
         if (err) {
-            LOG_ERR("Failed to write the behavior characteristic (err %d)", err);
+            queue->held = payload_wrapper;
+            queue->has_held = true;
+            return err;
         }
+
+        count++;
+    }
+
+    int err = flush_run_batch(index);
+    if (err) {
+        return err;
     }
+
+    return count;
 }
 
-K_WORK_DEFINE(split_central_split_run_work, split_central_split_run_callback);
+// Takes turns between the peripherals, one write each, until every queue is empty or waiting for
+// its link.
+static void split_central_split_run_callback(struct k_work *work) {
+    bool busy[ZMK_BLE_SPLIT_PERIPHERAL_COUNT] = {};
+    bool any_busy = false;
+    bool progress;
+
+    LOG_DBG("");
+
+    do {
+        progress = false;
+
+        for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+            if (busy[i]) {
+                continue;
+            }
+
+            int ret = run_queued_behaviors(i);
+            if (ret < 0) {
+                LOG_DBG("Link to peripheral %d busy (err %d)", i, ret);
+                busy[i] = true;
+                any_busy = true;
+            } else if (ret > 0) {
+                progress = true;
+            }
+        }
+    } while (progress);
+
+    if (any_busy) {
+        // A completed write retries right away. The timeout covers running out of buffers that
+        // other traffic was holding.
+        k_work_schedule_for_queue(split_central_split_run_q, &split_central_split_run_work,
+                                  K_MSEC(CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_RETRY_MS));
+    }
+}
 
 static int
 split_bt_invoke_behavior_payload(struct zmk_split_run_behavior_payload_wrapper payload_wrapper) {
+    struct k_msgq *msgq = &run_queues[payload_wrapper.source].msgq;
+
     LOG_DBG("");
 
-    int err = k_msgq_put(&zmk_split_central_split_run_msgq, &payload_wrapper, K_MSEC(100));
+    // Invoking a behavior never waits for the queue, it runs from the keymap's event handling.
+    int err = k_msgq_put(msgq, &payload_wrapper, K_NO_WAIT);
     if (err) {
         switch (err) {
-        case -EAGAIN: {
-            LOG_WRN("Consumer message queue full, popping first message and queueing again");
+        case -ENOMSG: {
+            LOG_WRN("Behavior message queue full, popping first message and queueing again");
             struct zmk_split_run_behavior_payload_wrapper discarded_report;
-            k_msgq_get(&zmk_split_central_split_run_msgq, &discarded_report, K_NO_WAIT);
+            k_msgq_get(msgq, &discarded_report, K_NO_WAIT);
             return split_bt_invoke_behavior_payload(payload_wrapper);
         }
         default:
@@ -562,13 +1709,20 @@ split_bt_invoke_behavior_payload(struct zmk_split_run_behavior_payload_wrapper p
         }
     }
 
-    k_work_submit_to_queue(&split_central_split_run_q, &split_central_split_run_work);
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_CENTRAL_RUN, msgq);
+
+    k_work_schedule_for_queue(split_central_split_run_q, &split_central_split_run_work,
+                              K_NO_WAIT);
 
     return 0;
 };
 
 int zmk_split_bt_invoke_behavior(uint8_t source, struct zmk_behavior_binding *binding,
                                  struct zmk_behavior_binding_event event, bool state) {
+    if (source >= ZMK_BLE_SPLIT_PERIPHERAL_COUNT) {
+        return -EINVAL;
+    }
+
     struct zmk_split_run_behavior_payload payload = {.data = {
                                                          .param1 = binding->param1,
                                                          .param2 = binding->param2,
@@ -582,17 +1736,86 @@ int zmk_split_bt_invoke_behavior(uint8_t source, struct zmk_behavior_binding *bi
                 log_strdup(binding->behavior_dev), log_strdup(payload.behavior_dev));
     }
 
-    struct zmk_split_run_behavior_payload_wrapper wrapper = {.source = source, .payload = payload};
+    struct zmk_split_run_behavior_payload_wrapper wrapper = {
+        .source = source,
+        .behavior_id = zmk_split_bt_behavior_id(binding->behavior_dev),
+        .payload = payload,
+    };
     return split_bt_invoke_behavior_payload(wrapper);
 }
 
 int zmk_split_bt_central_init(const struct device *_arg) {
-    k_work_queue_start(&split_central_split_run_q, split_central_split_run_q_stack,
+    for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+        k_msgq_init(&peripheral_sensor_msgqs[i], peripheral_sensor_msgq_bufs[i],
+                    sizeof(struct zmk_sensor_event),
+                    CONFIG_ZMK_SPLIT_BLE_CENTRAL_POSITION_QUEUE_SIZE);
+        k_msgq_init(&run_queues[i].msgq, run_queue_bufs[i],
+                    sizeof(struct zmk_split_run_behavior_payload_wrapper),
+                    CONFIG_ZMK_BLE_SPLIT_CENTRAL_SPLIT_RUN_QUEUE_SIZE);
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
+    split_central_split_run_q = zmk_ble_tx_work_q();
+#else
+    static const struct k_work_queue_config queue_config = {.name = "Split Central Run Queue"};
+    k_work_queue_start(&split_central_own_split_run_q, split_central_split_run_q_stack,
                        K_THREAD_STACK_SIZEOF(split_central_split_run_q_stack),
-                       CONFIG_ZMK_BLE_THREAD_PRIORITY, NULL);
+                       CONFIG_ZMK_BLE_THREAD_PRIORITY, &queue_config);
+    split_central_split_run_q = &split_central_own_split_run_q;
+#endif
     bt_conn_cb_register(&conn_callbacks);
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS)
+    k_work_schedule(&split_central_rtt_work,
+                    K_MSEC(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS_RTT_INTERVAL));
+#endif
+
     return start_scan();
 }
 
-SYS_INIT(zmk_split_bt_central_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_split_bt_central_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS) && IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ZMK_BLE_SPLIT_PERIPHERAL_COUNT; i++) {
+        const struct zmk_split_bt_link_stats *stats = &link_stats[i];
+
+        shell_print(sh, "Peripheral %d (%s):", i,
+                    peripherals[i].state == PERIPHERAL_SLOT_STATE_CONNECTED ? "connected"
+                                                                            : "disconnected");
+        shell_print(sh, "  %-16s %u", "rtt count", stats->rtt_count);
+        if (stats->rtt_count > 0) {
+            shell_print(sh, "  %-16s last %u min %u avg %u max %u", "rtt us", stats->rtt_last_us,
+                        stats->rtt_min_us, (uint32_t)(stats->rtt_total_us / stats->rtt_count),
+                        stats->rtt_max_us);
+        }
+        shell_print(sh, "  %-16s %u", "events", stats->event_count);
+        if (stats->event_count > 0) {
+            shell_print(sh, "  %-16s avg %u max %u", "event age ms",
+                        (uint32_t)(stats->event_age_total_ms / stats->event_count),
+                        stats->event_age_max_ms);
+        }
+        shell_print(sh, "  %-16s now %u max %u", "queue depth",
+                    zmk_kscan_queued_peripheral_positions(i), stats->queue_depth_max);
+    }
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    zmk_split_bt_link_stats_reset();
+    shell_print(sh, "Split link statistics reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_split,
+                               SHELL_CMD(stats, NULL, "Show split link latency statistics",
+                                         cmd_stats),
+                               SHELL_CMD(reset, NULL, "Reset split link statistics", cmd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(split, &sub_split, "ZMK split commands", NULL);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_LINK_STATS) && IS_ENABLED(CONFIG_SHELL) */
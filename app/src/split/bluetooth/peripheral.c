@@ -30,10 +30,19 @@
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/boot_profile.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/split_peripheral_status_changed.h>
 #include <zmk/ble.h>
+#include <zmk/ble/adv_tiers.h>
+#include <zmk/settings.h>
 #include <zmk/split/bluetooth/uuid.h>
+#include <zmk/work_watchdog.h>
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS) || IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+#include <zmk/activity.h>
+#include <zmk/events/activity_state_changed.h>
+#endif
 
 static const struct bt_data zmk_ble_ad[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -43,15 +52,145 @@ static const struct bt_data zmk_ble_ad[] = {
 
 static bool is_connected = false;
 
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+
+static enum zmk_ble_adv_tier adv_tier;
+
+static void adv_tier_timeout(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(adv_tier_timeout)
+static K_WORK_DELAYABLE_DEFINE(adv_tier_work, ZMK_WORK_WATCHED(adv_tier_timeout));
+
+// Advertising isn't one time, so Zephyr resumes it with the parameters it was last started with
+// once the central disconnects. Starting it while connected only stores them for then.
+static int start_advertising() {
+    struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE, 0, 0, NULL);
+    k_timeout_t duration = zmk_ble_adv_tier_param(adv_tier, &param);
+
+    if (!is_connected && !K_TIMEOUT_EQ(duration, K_FOREVER)) {
+        k_work_reschedule(&adv_tier_work, duration);
+    }
+
+    return bt_le_adv_start(&param, zmk_ble_ad, ARRAY_SIZE(zmk_ble_ad), NULL, 0);
+}
+
+static void set_adv_tier(enum zmk_ble_adv_tier tier) {
+    adv_tier = tier;
+
+    int err = bt_le_adv_stop();
+    if (err) {
+        LOG_ERR("Failed to stop advertising (err %d)", err);
+        return;
+    }
+
+    err = start_advertising();
+    if (err) {
+        LOG_ERR("Advertising failed to start (err %d)", err);
+    }
+}
+
+static void adv_tier_timeout(struct k_work *work) {
+    if (is_connected || adv_tier == ZMK_BLE_ADV_TIER_SLOW) {
+        return;
+    }
+
+    LOG_DBG("Central not connected, slowing advertising down to tier %d", adv_tier + 1);
+    set_adv_tier(adv_tier + 1);
+}
+
+// Puts the fastest parameters in place for the next disconnect.
+static void reset_adv_tier_callback(struct k_work *work) { set_adv_tier(ZMK_BLE_ADV_TIER_FAST); }
+
+ZMK_WORK_WATCHDOG_WRAP(reset_adv_tier_callback)
+K_WORK_DEFINE(reset_adv_tier_work, ZMK_WORK_WATCHED(reset_adv_tier_callback));
+
+static int split_peripheral_adv_tiers_listener(const zmk_event_t *eh) {
+    if (!is_connected && adv_tier != ZMK_BLE_ADV_TIER_FAST &&
+        zmk_activity_get_state() == ZMK_ACTIVITY_ACTIVE) {
+        set_adv_tier(ZMK_BLE_ADV_TIER_FAST);
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(split_peripheral_adv_tiers, split_peripheral_adv_tiers_listener);
+ZMK_SUBSCRIPTION(split_peripheral_adv_tiers, zmk_activity_state_changed);
+
+#else
+
 static int start_advertising() {
     return bt_le_adv_start(BT_LE_ADV_CONN, zmk_ble_ad, ARRAY_SIZE(zmk_ble_ad), NULL, 0);
 };
 
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS) */
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+
+static struct bt_conn *central_conn;
+
+static const struct bt_le_conn_param active_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ZMK_BLE_ACTIVE_CONN_INTERVAL, CONFIG_ZMK_BLE_ACTIVE_CONN_INTERVAL,
+    CONFIG_ZMK_BLE_ACTIVE_CONN_LATENCY, CONFIG_ZMK_BLE_CONN_TIMEOUT);
+
+static const struct bt_le_conn_param idle_conn_param = BT_LE_CONN_PARAM_INIT(
+    CONFIG_ZMK_BLE_IDLE_CONN_INTERVAL, CONFIG_ZMK_BLE_IDLE_CONN_INTERVAL,
+    CONFIG_ZMK_BLE_IDLE_CONN_LATENCY, CONFIG_ZMK_BLE_CONN_TIMEOUT);
+
+// Asks the central for the connection parameters matching this half's activity state.
+static void update_central_conn_params() {
+    const struct bt_le_conn_param *param;
+    int err;
+
+    if (central_conn == NULL) {
+        return;
+    }
+
+    switch (zmk_activity_get_state()) {
+    case ZMK_ACTIVITY_ACTIVE:
+        param = &active_conn_param;
+        break;
+    case ZMK_ACTIVITY_IDLE:
+        param = &idle_conn_param;
+        break;
+    default:
+        return;
+    }
+
+    err = bt_conn_le_param_update(central_conn, param);
+    if (err && err != -EALREADY) {
+        LOG_WRN("Failed to request connection parameters (err %d)", err);
+    }
+}
+
+static int split_peripheral_conn_params_listener(const zmk_event_t *eh) {
+    update_central_conn_params();
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(split_peripheral_conn_params, split_peripheral_conn_params_listener);
+ZMK_SUBSCRIPTION(split_peripheral_conn_params, zmk_activity_state_changed);
+
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS) */
+
 static void connected(struct bt_conn *conn, uint8_t err) {
     is_connected = (err == 0);
 
-    ZMK_EVENT_RAISE(new_zmk_split_peripheral_status_changed(
-        (struct zmk_split_peripheral_status_changed){.connected = is_connected}));
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+    if (is_connected) {
+        k_work_cancel_delayable(&adv_tier_work);
+        k_work_submit(&reset_adv_tier_work);
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+    if (is_connected) {
+        central_conn = bt_conn_ref(conn);
+        update_central_conn_params();
+    }
+#endif
+
+    raise_zmk_split_peripheral_status_changed(
+        (struct zmk_split_peripheral_status_changed){.connected = is_connected});
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason) {
@@ -63,8 +202,20 @@ static void disconnected(struct bt_conn *conn, uint8_t reason) {
 
     is_connected = false;
 
-    ZMK_EVENT_RAISE(new_zmk_split_peripheral_status_changed(
-        (struct zmk_split_peripheral_status_changed){.connected = is_connected}));
+#if IS_ENABLED(CONFIG_ZMK_BLE_ADV_TIERS)
+    // Advertising resumes at the fastest tier, which then lasts from now.
+    k_work_reschedule(&adv_tier_work, K_MSEC(CONFIG_ZMK_BLE_ADV_FAST_DURATION_MS));
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_ACTIVITY_CONN_PARAMS)
+    if (central_conn != NULL) {
+        bt_conn_unref(central_conn);
+        central_conn = NULL;
+    }
+#endif
+
+    raise_zmk_split_peripheral_status_changed(
+        (struct zmk_split_peripheral_status_changed){.connected = is_connected});
 }
 
 static void security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err) {
@@ -106,10 +257,7 @@ static int zmk_peripheral_ble_init(const struct device *_arg) {
     }
 
 #if IS_ENABLED(CONFIG_SETTINGS)
-    settings_subsys_init();
-
-    settings_load_subtree("ble");
-    settings_load_subtree("bt");
+    zmk_settings_load();
 #endif
 
 #if IS_ENABLED(CONFIG_ZMK_BLE_CLEAR_BONDS_ON_START)
@@ -125,4 +273,4 @@ static int zmk_peripheral_ble_init(const struct device *_arg) {
     return 0;
 }
 
-SYS_INIT(zmk_peripheral_ble_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_peripheral_ble_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
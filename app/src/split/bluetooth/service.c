@@ -5,6 +5,7 @@
  */
 
 #include <zephyr/types.h>
+#include <sys/atomic.h>
 #include <sys/util.h>
 #include <init.h>
 
@@ -16,24 +17,64 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <bluetooth/uuid.h>
 
 #include <drivers/behavior.h>
+#include <drivers/sensor.h>
+#include <zmk/battery.h>
+#include <zmk/boot_profile.h>
+#include <zmk/hot_path_trace.h>
+#include <zmk/memory_stats.h>
+#include <zmk/energy_stats.h>
 #include <zmk/behavior.h>
 #include <zmk/matrix.h>
 #include <zmk/split/bluetooth/uuid.h>
 #include <zmk/split/bluetooth/service.h>
+#include <zmk/split/bluetooth/behavior_ids.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
 
-#define POS_STATE_LEN 16
+// One bit per key position. Never shorter than the 16 bytes older centrals expect.
+#define POS_STATE_LEN MAX(16, DIV_ROUND_UP(ZMK_KEYMAP_LEN, 8))
+
+// Positions go over the air as one byte, and the count in the number of digitals descriptor too.
+BUILD_ASSERT(ZMK_KEYMAP_LEN <= UINT8_MAX, "Split keyboards support at most 255 key positions");
 
 static uint8_t num_of_positions = ZMK_KEYMAP_LEN;
 static uint8_t position_state[POS_STATE_LEN];
 
 static struct zmk_split_run_behavior_payload behavior_run_payload;
 
+// Which notifications the central subscribed to. A central that knows about position events only
+// reads the position state to resync, older ones get the whole state on every change.
+static bool position_state_subscribed;
+static bool position_events_subscribed;
+
 static ssize_t split_svc_pos_state(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
                                    void *buf, uint16_t len, uint16_t offset) {
     return bt_gatt_attr_read(conn, attrs, buf, len, offset, &position_state,
                              sizeof(position_state));
 }
 
+static void run_behavior(const char *behavior_dev, const struct zmk_split_run_behavior_data *data) {
+    struct zmk_behavior_binding binding = {
+        .param1 = data->param1,
+        .param2 = data->param2,
+        .behavior_dev = (char *)behavior_dev,
+    };
+    LOG_DBG("%s with params %d %d: pressed? %d", log_strdup(binding.behavior_dev), binding.param1,
+            binding.param2, data->state);
+    struct zmk_behavior_binding_event event = {.position = data->position,
+                                               .timestamp = k_uptime_get()};
+    int err;
+    if (data->state > 0) {
+        err = behavior_keymap_binding_pressed(&binding, event);
+    } else {
+        err = behavior_keymap_binding_released(&binding, event);
+    }
+
+    if (err) {
+        LOG_ERR("Failed to invoke behavior %s: %d", log_strdup(binding.behavior_dev), err);
+    }
+}
+
 static ssize_t split_svc_run_behavior(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
                                       const void *buf, uint16_t len, uint16_t offset,
                                       uint8_t flags) {
@@ -55,25 +96,43 @@ static ssize_t split_svc_run_behavior(struct bt_conn *conn, const struct bt_gatt
         offsetof(struct zmk_split_run_behavior_payload, behavior_dev);
     if ((end_addr > sizeof(struct zmk_split_run_behavior_data)) &&
         payload->behavior_dev[end_addr - behavior_dev_offset - 1] == '\0') {
-        struct zmk_behavior_binding binding = {
-            .param1 = payload->data.param1,
-            .param2 = payload->data.param2,
-            .behavior_dev = payload->behavior_dev,
-        };
-        LOG_DBG("%s with params %d %d: pressed? %d", log_strdup(binding.behavior_dev),
-                binding.param1, binding.param2, payload->data.state);
-        struct zmk_behavior_binding_event event = {.position = payload->data.position,
-                                                   .timestamp = k_uptime_get()};
-        int err;
-        if (payload->data.state > 0) {
-            err = behavior_keymap_binding_pressed(&binding, event);
-        } else {
-            err = behavior_keymap_binding_released(&binding, event);
-        }
+        run_behavior(payload->behavior_dev, &payload->data);
+    }
 
-        if (err) {
-            LOG_ERR("Failed to invoke behavior %s: %d", log_strdup(binding.behavior_dev), err);
+    return len;
+}
+
+static ssize_t split_svc_behavior_table_hash(struct bt_conn *conn,
+                                             const struct bt_gatt_attr *attrs, void *buf,
+                                             uint16_t len, uint16_t offset) {
+    uint32_t hash = zmk_split_bt_behavior_table_hash();
+
+    return bt_gatt_attr_read(conn, attrs, buf, len, offset, &hash, sizeof(hash));
+}
+
+static ssize_t split_svc_run_behavior_ids(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
+                                          const void *buf, uint16_t len, uint16_t offset,
+                                          uint8_t flags) {
+    const struct zmk_split_run_behavior_id_data *invocations = buf;
+
+    // Every invocation fits in one write, so there's nothing to reassemble.
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    if (len % sizeof(struct zmk_split_run_behavior_id_data) != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    for (int i = 0; i < len / sizeof(struct zmk_split_run_behavior_id_data); i++) {
+        const char *behavior_dev = zmk_split_bt_behavior_label(invocations[i].behavior_id);
+
+        if (behavior_dev == NULL) {
+            LOG_ERR("Unknown behavior id %d", invocations[i].behavior_id);
+            continue;
         }
+
+        run_behavior(behavior_dev, &invocations[i].data);
     }
 
     return len;
@@ -86,8 +145,43 @@ static ssize_t split_svc_num_of_positions(struct bt_conn *conn, const struct bt_
 
 static void split_svc_pos_state_ccc(const struct bt_gatt_attr *attr, uint16_t value) {
     LOG_DBG("value %d", value);
+    position_state_subscribed = (value == BT_GATT_CCC_NOTIFY);
+}
+
+static void split_svc_pos_events_ccc(const struct bt_gatt_attr *attr, uint16_t value) {
+    LOG_DBG("value %d", value);
+    position_events_subscribed = (value == BT_GATT_CCC_NOTIFY);
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+    // Levels are only sent when they change, so a central that just connected needs this one.
+    if (position_events_subscribed) {
+        zmk_split_bt_battery_level(zmk_battery_state_of_charge());
+    }
+#endif
 }
 
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+static bool pointing_subscribed;
+
+// Motion not yet sent to the central. With one notification in flight at a time, a sensor
+// reporting faster than the connection interval is sent as one notification per interval instead
+// of filling the controller's buffers.
+static atomic_t pointing_dx;
+static atomic_t pointing_dy;
+static atomic_t pointing_notify_in_flight;
+
+static void split_svc_pointing_ccc(const struct bt_gatt_attr *attr, uint16_t value) {
+    LOG_DBG("value %d", value);
+    pointing_subscribed = (value == BT_GATT_CCC_NOTIFY);
+
+    // Motion from before the central went away is stale, and a notification sent as it went away
+    // may never complete.
+    atomic_clear(&pointing_dx);
+    atomic_clear(&pointing_dy);
+    atomic_set(&pointing_notify_in_flight, false);
+}
+#endif
+
 BT_GATT_SERVICE_DEFINE(
     split_svc, BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_SERVICE_UUID)),
     BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_STATE_UUID),
@@ -98,11 +192,29 @@ BT_GATT_SERVICE_DEFINE(
                            BT_GATT_CHRC_WRITE_WITHOUT_RESP, BT_GATT_PERM_WRITE_ENCRYPT, NULL,
                            split_svc_run_behavior, &behavior_run_payload),
     BT_GATT_DESCRIPTOR(BT_UUID_NUM_OF_DIGITALS, BT_GATT_PERM_READ, split_svc_num_of_positions, NULL,
-                       &num_of_positions), );
-
+                       &num_of_positions),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_EVENTS_UUID),
+                           BT_GATT_CHRC_NOTIFY, BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(split_svc_pos_events_ccc,
+                BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_IDS_UUID),
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT,
+                           split_svc_behavior_table_hash, split_svc_run_behavior_ids, NULL),
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POINTING_MOTION_UUID),
+                           BT_GATT_CHRC_NOTIFY, BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(split_svc_pointing_ccc, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+#endif
+);
+
+#if !IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
 K_THREAD_STACK_DEFINE(service_q_stack, CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_STACK_SIZE);
 
-struct k_work_q service_work_q;
+static struct k_work_q service_own_work_q;
+#endif
+
+static struct k_work_q *service_work_q;
 
 K_MSGQ_DEFINE(position_state_msgq, sizeof(char[POS_STATE_LEN]),
               CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_POSITION_QUEUE_SIZE, 4);
@@ -111,14 +223,18 @@ void send_position_state_callback(struct k_work *work) {
     uint8_t state[POS_STATE_LEN];
 
     while (k_msgq_get(&position_state_msgq, &state, K_NO_WAIT) == 0) {
+        zmk_energy_stats_count(ZMK_ENERGY_SPLIT_NOTIFY);
         int err = bt_gatt_notify(NULL, &split_svc.attrs[1], &state, sizeof(state));
+        zmk_hot_path_trace(ZMK_HOT_PATH_SPLIT_SEND, NULL, err ? err : sizeof(state),
+                           ZMK_HOT_PATH_SPLIT_POSITION_STATE);
         if (err) {
             LOG_DBG("Error notifying %d", err);
         }
     }
 };
 
-K_WORK_DEFINE(service_position_notify_work, send_position_state_callback);
+ZMK_WORK_WATCHDOG_WRAP(send_position_state_callback)
+K_WORK_DEFINE(service_position_notify_work, ZMK_WORK_WATCHED(send_position_state_callback));
 
 int send_position_state() {
     int err = k_msgq_put(&position_state_msgq, position_state, K_MSEC(100));
@@ -136,28 +252,262 @@ int send_position_state() {
         }
     }
 
-    k_work_submit_to_queue(&service_work_q, &service_position_notify_work);
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_STATE, &position_state_msgq);
+
+    k_work_submit_to_queue(service_work_q, &service_position_notify_work);
 
     return 0;
 }
 
+struct position_event {
+    int64_t timestamp;
+    // ZMK_SPLIT_POSITION_EVENT_SENSOR for sensor events
+    uint8_t position;
+    bool pressed;
+    uint8_t sensor_number;
+    int8_t val1;
+    int8_t val2;
+};
+
+K_MSGQ_DEFINE(position_event_msgq, sizeof(struct position_event),
+              CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_POSITION_QUEUE_SIZE, 4);
+
+// Set when a queued event had to be dropped, until the central has been asked to resync.
+static atomic_t position_events_lost;
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+// The battery state of charge + 1 waiting for the next position events notification, or 0.
+static atomic_t pending_battery_level;
+#endif
+
+void send_position_events_callback(struct k_work *work) {
+    struct zmk_split_position_event events[ZMK_SPLIT_POSITION_EVENTS_PER_NOTIFY];
+    struct position_event ev;
+    size_t count = 0;
+
+    if (atomic_clear(&position_events_lost)) {
+        events[count++] = (struct zmk_split_position_event){
+            .flags = ZMK_SPLIT_POSITION_EVENT_RESYNC,
+        };
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+    atomic_val_t battery_level = atomic_clear(&pending_battery_level);
+    if (battery_level > 0) {
+        events[count++] = (struct zmk_split_position_event){
+            .position = ZMK_SPLIT_POSITION_EVENT_SENSOR,
+            .flags = ZMK_SPLIT_SENSOR_EVENT_BATTERY << ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT,
+            .sensor_value = {.val1 = battery_level - 1},
+        };
+    }
+#endif
+
+    // Pack every waiting change into as few notifications as possible, oldest first.
+    while (count > 0 || k_msgq_num_used_get(&position_event_msgq) > 0) {
+        int64_t now = k_uptime_get();
+
+        while (count < ARRAY_SIZE(events) &&
+               k_msgq_get(&position_event_msgq, &ev, K_NO_WAIT) == 0) {
+            if (ev.position == ZMK_SPLIT_POSITION_EVENT_SENSOR) {
+                events[count++] = (struct zmk_split_position_event){
+                    .position = ZMK_SPLIT_POSITION_EVENT_SENSOR,
+                    .flags = ev.sensor_number << ZMK_SPLIT_SENSOR_EVENT_NUMBER_SHIFT,
+                    .sensor_value = {.val1 = ev.val1, .val2 = ev.val2},
+                };
+                continue;
+            }
+
+            events[count++] = (struct zmk_split_position_event){
+                .position = ev.position,
+                .flags = ev.pressed ? ZMK_SPLIT_POSITION_EVENT_PRESSED : 0,
+                .age = MIN(now - ev.timestamp, UINT16_MAX),
+            };
+        }
+
+        zmk_energy_stats_count(ZMK_ENERGY_SPLIT_NOTIFY);
+        int err = bt_gatt_notify(NULL, &split_svc.attrs[7], events, count * sizeof(events[0]));
+        zmk_hot_path_trace(ZMK_HOT_PATH_SPLIT_SEND, NULL, err ? err : count * sizeof(events[0]),
+                           ZMK_HOT_PATH_SPLIT_POSITION_EVENT);
+        if (err) {
+            LOG_DBG("Error notifying %d", err);
+        }
+
+        count = 0;
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(send_position_events_callback)
+K_WORK_DEFINE(service_position_events_notify_work, ZMK_WORK_WATCHED(send_position_events_callback));
+
+static int queue_position_event(const struct position_event *ev) {
+    while (k_msgq_put(&position_event_msgq, ev, K_NO_WAIT) != 0) {
+        struct position_event discarded_event;
+
+        LOG_WRN("Position event queue full, dropping the oldest event");
+        k_msgq_get(&position_event_msgq, &discarded_event, K_NO_WAIT);
+        atomic_set(&position_events_lost, true);
+    }
+
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_PERIPHERAL_POSITION_EVENT, &position_event_msgq);
+
+    k_work_submit_to_queue(service_work_q, &service_position_events_notify_work);
+
+    return 0;
+}
+
+static int send_position_event(uint8_t position, bool pressed) {
+    struct position_event ev = {
+        .timestamp = k_uptime_get(),
+        .position = position,
+        .pressed = pressed,
+    };
+
+    return queue_position_event(&ev);
+}
+
+static int send_position_change(uint8_t position, bool pressed) {
+    if (position_events_subscribed && !position_state_subscribed) {
+        return send_position_event(position, pressed);
+    }
+
+    return send_position_state();
+}
+
 int zmk_split_bt_position_pressed(uint8_t position) {
     WRITE_BIT(position_state[position / 8], position % 8, true);
-    return send_position_state();
+    return send_position_change(position, true);
 }
 
 int zmk_split_bt_position_released(uint8_t position) {
     WRITE_BIT(position_state[position / 8], position % 8, false);
-    return send_position_state();
+    return send_position_change(position, false);
+}
+
+// Sensor events share the position events queue, so the central sees them in order with the key
+// changes around them, packed into the same notifications.
+int zmk_split_bt_sensor_triggered(uint8_t sensor_number, const struct sensor_value *value) {
+    if (!position_events_subscribed || position_state_subscribed) {
+        // Nothing in the position state carries sensor events.
+        LOG_DBG("Central does not support sensor events, dropping sensor %d", sensor_number);
+        return 0;
+    }
+
+    if (sensor_number > ZMK_SPLIT_SENSOR_EVENT_MAX_NUMBER) {
+        LOG_WRN("Sensor %d can't be sent to the central", sensor_number);
+        return -EINVAL;
+    }
+
+    struct position_event ev = {
+        .timestamp = k_uptime_get(),
+        .position = ZMK_SPLIT_POSITION_EVENT_SENSOR,
+        .sensor_number = sensor_number,
+        .val1 = CLAMP(value->val1, INT8_MIN, INT8_MAX),
+        .val2 = CLAMP(value->val2, INT8_MIN, INT8_MAX),
+    };
+
+    return queue_position_event(&ev);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+static void send_battery_level_callback(struct k_work *work) {
+    // Does nothing if a position event already took the level along.
+    k_work_submit_to_queue(service_work_q, &service_position_events_notify_work);
+}
+
+ZMK_WORK_WATCHDOG_WRAP(send_battery_level_callback)
+K_WORK_DELAYABLE_DEFINE(service_battery_level_work, ZMK_WORK_WATCHED(send_battery_level_callback));
+
+int zmk_split_bt_battery_level(uint8_t state_of_charge) {
+    if (!position_events_subscribed || position_state_subscribed) {
+        LOG_DBG("Central does not support position events, not sending the battery level");
+        return 0;
+    }
+
+    atomic_set(&pending_battery_level, MIN(state_of_charge, INT8_MAX) + 1);
+
+    // Scheduling again doesn't postpone a pending send, so the delay counts from the oldest change.
+    k_work_schedule_for_queue(service_work_q, &service_battery_level_work,
+                              K_MSEC(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY_MAX_DELAY));
+
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY) */
+
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+static void send_pointing_motion_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(send_pointing_motion_callback)
+K_WORK_DEFINE(service_pointing_notify_work, ZMK_WORK_WATCHED(send_pointing_motion_callback));
+
+static void pointing_motion_notified(struct bt_conn *conn, void *user_data) {
+    atomic_set(&pointing_notify_in_flight, false);
+    k_work_submit_to_queue(service_work_q, &service_pointing_notify_work);
+}
+
+static void send_pointing_motion_callback(struct k_work *work) {
+    if (atomic_get(&pointing_notify_in_flight)) {
+        return;
+    }
+
+    const int32_t dx = atomic_clear(&pointing_dx);
+    const int32_t dy = atomic_clear(&pointing_dy);
+
+    if (dx == 0 && dy == 0) {
+        return;
+    }
+
+    struct zmk_split_pointing_motion motion = {
+        .dx = CLAMP(dx, INT16_MIN, INT16_MAX),
+        .dy = CLAMP(dy, INT16_MIN, INT16_MAX),
+    };
+
+    // Whatever didn't fit goes in the next notification.
+    atomic_add(&pointing_dx, dx - motion.dx);
+    atomic_add(&pointing_dy, dy - motion.dy);
+
+    struct bt_gatt_notify_params notify_params = {
+        .attr = &split_svc.attrs[12],
+        .data = &motion,
+        .len = sizeof(motion),
+        .func = pointing_motion_notified,
+    };
+
+    atomic_set(&pointing_notify_in_flight, true);
+
+    zmk_energy_stats_count(ZMK_ENERGY_SPLIT_NOTIFY);
+    int err = bt_gatt_notify_cb(NULL, &notify_params);
+    if (err) {
+        LOG_DBG("Error notifying %d", err);
+        atomic_set(&pointing_notify_in_flight, false);
+    }
+}
+
+int zmk_split_bt_pointing_motion(int16_t dx, int16_t dy) {
+    if (!pointing_subscribed) {
+        return 0;
+    }
+
+    atomic_add(&pointing_dx, dx);
+    atomic_add(&pointing_dy, dy);
+
+    k_work_submit_to_queue(service_work_q, &service_pointing_notify_work);
+
+    return 0;
 }
+#endif /* IS_ENABLED(CONFIG_ZMK_POINTING) */
 
 int service_init(const struct device *_arg) {
+#if IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
+    service_work_q = zmk_ble_tx_work_q();
+#else
     static const struct k_work_queue_config queue_config = {
         .name = "Split Peripheral Notification Queue"};
-    k_work_queue_start(&service_work_q, service_q_stack, K_THREAD_STACK_SIZEOF(service_q_stack),
+    k_work_queue_start(&service_own_work_q, service_q_stack, K_THREAD_STACK_SIZEOF(service_q_stack),
                        CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_PRIORITY, &queue_config);
+    service_work_q = &service_own_work_q;
+#endif
 
     return 0;
 }
 
-SYS_INIT(service_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
+ZMK_SYS_INIT(service_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
@@ -12,7 +12,9 @@
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zmk/event_manager.h>
+#include <zmk/events/battery_state_changed.h>
 #include <zmk/events/position_state_changed.h>
+#include <zmk/events/sensor_event.h>
 #include <zmk/hid.h>
 #include <zmk/endpoints.h>
 
@@ -26,8 +28,25 @@ int split_listener(const zmk_event_t *eh) {
             return zmk_split_bt_position_released(ev->position);
         }
     }
+
+    const struct zmk_sensor_event *sensor_ev = as_zmk_sensor_event(eh);
+    if (sensor_ev != NULL) {
+        return zmk_split_bt_sensor_triggered(sensor_ev->sensor_number, &sensor_ev->value);
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+    const struct zmk_battery_state_changed *battery_ev = as_zmk_battery_state_changed(eh);
+    if (battery_ev != NULL) {
+        return zmk_split_bt_battery_level(battery_ev->state_of_charge);
+    }
+#endif
+
     return ZMK_EV_EVENT_BUBBLE;
 }
 
 ZMK_LISTENER(split_listener, split_listener);
-ZMK_SUBSCRIPTION(split_listener, zmk_position_state_changed);
\ No newline at end of file
+ZMK_SUBSCRIPTION(split_listener, zmk_position_state_changed);
+ZMK_SUBSCRIPTION(split_listener, zmk_sensor_event);
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_BATTERY)
+ZMK_SUBSCRIPTION(split_listener, zmk_battery_state_changed);
+#endif
\ No newline at end of file
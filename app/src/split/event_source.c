@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <devicetree.h>
+#include <init.h>
+#include <sys/atomic.h>
+#include <sys/util.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <drivers/behavior.h>
+#include <zmk/behavior.h>
+#include <zmk/boot_profile.h>
+#include <zmk/keymap.h>
+#include <zmk/matrix.h>
+#include <zmk/split/event_source.h>
+
+#define COMBOS_NODE DT_INST(0, zmk_combos)
+
+#if DT_NODE_HAS_STATUS(COMBOS_NODE, okay)
+#define COMBO_POSITION(idx, node) DT_PROP_BY_IDX(node, key_positions, idx),
+#define COMBO_POSITIONS(node) UTIL_LISTIFY(DT_PROP_LEN(node, key_positions), COMBO_POSITION, node)
+
+static const uint32_t combo_positions[] = {DT_FOREACH_CHILD(COMBOS_NODE, COMBO_POSITIONS)};
+#else
+static const uint32_t combo_positions[] = {};
+#endif
+
+bool zmk_split_event_source_runs_on_peripheral(uint32_t position) {
+    for (int i = 0; i < ARRAY_SIZE(combo_positions); i++) {
+        if (combo_positions[i] == position) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#if !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+
+#include <zmk/event_manager.h>
+#include <zmk/events/position_state_changed.h>
+
+// The devicetree keymap, which the peripheral is built with as well. Whether a binding is
+// transparent is taken from the devicetree, since the peripheral has no &trans device.
+struct peripheral_binding {
+    char *behavior_dev;
+    uint32_t param1;
+    uint32_t param2;
+    bool transparent;
+};
+
+#define PERIPHERAL_BINDING(idx, node)                                                              \
+    {                                                                                              \
+        .behavior_dev = DT_LABEL(DT_PHANDLE_BY_IDX(node, bindings, idx)),                          \
+        .param1 = COND_CODE_0(DT_PHA_HAS_CELL_AT_IDX(node, bindings, idx, param1), (0),            \
+                              (DT_PHA_BY_IDX(node, bindings, idx, param1))),                       \
+        .param2 = COND_CODE_0(DT_PHA_HAS_CELL_AT_IDX(node, bindings, idx, param2), (0),            \
+                              (DT_PHA_BY_IDX(node, bindings, idx, param2))),                       \
+        .transparent =                                                                             \
+            DT_NODE_HAS_COMPAT(DT_PHANDLE_BY_IDX(node, bindings, idx), zmk_behavior_transparent),  \
+    },
+
+#define PERIPHERAL_LAYER(node)                                                                     \
+    {UTIL_LISTIFY(DT_PROP_LEN(node, bindings), PERIPHERAL_BINDING, node)},
+
+static const struct peripheral_binding keymap[ZMK_KEYMAP_LAYERS_LEN][ZMK_KEYMAP_LEN] = {
+    DT_FOREACH_CHILD(DT_INST(0, zmk_keymap), PERIPHERAL_LAYER)};
+
+// Bindings of each layer whose behavior exists on this half and runs where its event came from.
+static ATOMIC_DEFINE(event_source_bindings, ZMK_KEYMAP_LAYERS_LEN * ZMK_KEYMAP_LEN);
+
+// The layer + 1 of the binding run for each pressed position, or 0 if the central handles it.
+static uint8_t pressed_layers[ZMK_KEYMAP_LEN];
+
+// Until the central sends its state, only the first layer is assumed active.
+static atomic_t layer_state = ATOMIC_INIT(BIT(0));
+
+void zmk_split_event_source_set_layer_state(uint32_t state) {
+    LOG_DBG("Central layer state 0x%08x", state);
+    atomic_set(&layer_state, state);
+}
+
+static void invoke_binding(uint8_t layer, uint32_t position, bool pressed, int64_t timestamp) {
+    const struct peripheral_binding *entry = &keymap[layer][position];
+    struct zmk_behavior_binding binding = {
+        .behavior_dev = entry->behavior_dev,
+        .param1 = entry->param1,
+        .param2 = entry->param2,
+    };
+    struct zmk_behavior_binding_event event = {
+        .layer = layer,
+        .position = position,
+        .timestamp = timestamp,
+    };
+
+    int err = pressed ? behavior_keymap_binding_pressed(&binding, event)
+                      : behavior_keymap_binding_released(&binding, event);
+    if (err < 0 && err != -ENOTSUP) {
+        LOG_ERR("Failed to invoke %s on position %d (err %d)", log_strdup(binding.behavior_dev),
+                position, err);
+    }
+}
+
+// Finds the binding the central would resolve for the pressed position, the same way the keymap
+// does: the highest active layer whose binding isn't transparent.
+static int find_event_source_layer(uint32_t position) {
+    uint32_t state = atomic_get(&layer_state);
+
+    while (state != 0) {
+        uint8_t layer = zmk_keymap_layers_state_highest(state);
+
+        if (!keymap[layer][position].transparent) {
+            return atomic_test_bit(event_source_bindings, layer * ZMK_KEYMAP_LEN + position)
+                       ? layer
+                       : -ENOENT;
+        }
+
+        state &= ~BIT(layer);
+    }
+
+    return -ENOENT;
+}
+
+static int event_source_listener(const zmk_event_t *eh) {
+    const struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
+    if (ev == NULL || ev->position >= ZMK_KEYMAP_LEN) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    // The event still goes to the central, which skips the bindings run here.
+    if (ev->state) {
+        int layer = find_event_source_layer(ev->position);
+        if (layer >= 0) {
+            pressed_layers[ev->position] = layer + 1;
+            invoke_binding(layer, ev->position, true, ev->timestamp);
+        }
+    } else if (pressed_layers[ev->position] != 0) {
+        uint8_t layer = pressed_layers[ev->position] - 1;
+
+        pressed_layers[ev->position] = 0;
+        invoke_binding(layer, ev->position, false, ev->timestamp);
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(split_event_source, event_source_listener);
+ZMK_SUBSCRIPTION(split_event_source, zmk_position_state_changed);
+
+static int event_source_init(const struct device *_arg) {
+    int count = 0;
+
+    for (int position = 0; position < ZMK_KEYMAP_LEN; position++) {
+        if (!zmk_split_event_source_runs_on_peripheral(position)) {
+            continue;
+        }
+
+        for (int layer = 0; layer < ZMK_KEYMAP_LAYERS_LEN; layer++) {
+            const struct peripheral_binding *entry = &keymap[layer][position];
+            const struct device *behavior = device_get_binding(entry->behavior_dev);
+            enum behavior_locality locality;
+
+            // Most behaviors only exist on the central.
+            if (behavior == NULL || behavior_get_locality(behavior, &locality) != 0 ||
+                locality != BEHAVIOR_LOCALITY_EVENT_SOURCE) {
+                continue;
+            }
+
+            atomic_set_bit(event_source_bindings, layer * ZMK_KEYMAP_LEN + position);
+            count++;
+        }
+    }
+
+    LOG_DBG("%d event source bindings run on this half", count);
+
+    return 0;
+}
+
+ZMK_SYS_INIT(event_source_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif /* !IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL) */
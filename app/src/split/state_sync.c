@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/behavior.h>
+#include <zmk/ble.h>
+#include <zmk/split/state_sync.h>
+
+#if ZMK_BLE_IS_CENTRAL
+#include <zmk/split/bluetooth/central.h>
+#define SPLIT_PERIPHERAL_COUNT ZMK_BLE_SPLIT_PERIPHERAL_COUNT
+#define split_invoke_behavior zmk_split_bt_invoke_behavior
+#elif IS_ENABLED(CONFIG_ZMK_SPLIT_WIRED)
+#include <zmk/split/wired/central.h>
+#define SPLIT_PERIPHERAL_COUNT ZMK_SPLIT_WIRED_PERIPHERAL_COUNT
+#define split_invoke_behavior zmk_split_wired_invoke_behavior
+#endif
+
+void zmk_split_state_sync_work_handler(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct zmk_split_state_sync *sync = CONTAINER_OF(dwork, struct zmk_split_state_sync, work);
+
+    // Taken when the work runs, so it includes every change since it was scheduled.
+    struct zmk_behavior_binding binding = {
+        .behavior_dev = sync->behavior_dev,
+        .param1 = sync->command,
+        .param2 = sync->get_state(),
+    };
+    struct zmk_behavior_binding_event event = {.timestamp = k_uptime_get()};
+
+    sync->last_sync = event.timestamp;
+
+    LOG_DBG("Syncing %s state 0x%08x", log_strdup(binding.behavior_dev), binding.param2);
+
+#if defined(SPLIT_PERIPHERAL_COUNT)
+    for (int i = 0; i < SPLIT_PERIPHERAL_COUNT; i++) {
+        int err = split_invoke_behavior(i, &binding, event, true);
+        if (err) {
+            LOG_WRN("Failed to sync %s state to peripheral %d (err %d)",
+                    log_strdup(binding.behavior_dev), i, err);
+        }
+    }
+#endif
+}
+
+void zmk_split_state_sync_changed(struct zmk_split_state_sync *sync) {
+    // The first change goes out right away. Later ones wait out the interval, and anything
+    // changing meanwhile is picked up by the pending work rather than scheduling more.
+    int64_t delay = sync->last_sync + CONFIG_ZMK_SPLIT_STATE_SYNC_INTERVAL_MS - k_uptime_get();
+
+    k_work_schedule(&sync->work, K_MSEC(MAX(delay, 0)));
+}
+
+void zmk_split_state_sync_now(struct zmk_split_state_sync *sync) {
+    k_work_reschedule(&sync->work, K_NO_WAIT);
+}
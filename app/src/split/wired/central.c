@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <init.h>
+#include <kernel.h>
+#include <string.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/behavior.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/position_state_changed.h>
+#include <zmk/position_set.h>
+#include <zmk/split/wired/central.h>
+#include <zmk/split/wired/link.h>
+#include <zmk/workqueue.h>
+#include <zmk/work_watchdog.h>
+
+// Positions the peripheral reported as pressed, so they can be released if the link goes down.
+static struct zmk_position_set position_state;
+static bool peripheral_connected;
+
+static void link_timeout_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(link_timeout_callback)
+static K_WORK_DELAYABLE_DEFINE(link_timeout_work, ZMK_WORK_WATCHED(link_timeout_callback));
+
+static void raise_position_change(uint32_t position, bool pressed) {
+    ZMK_EVENT_RAISE(new_zmk_position_state_changed((struct zmk_position_state_changed){
+        .source = 0, .position = position, .state = pressed, .timestamp = k_uptime_get()}));
+}
+
+static void set_position_state(uint32_t position, bool pressed) {
+    if (zmk_position_set_test(&position_state, position) == pressed) {
+        return;
+    }
+
+    if (pressed) {
+        zmk_position_set_add(&position_state, position);
+    } else {
+        zmk_position_set_remove(&position_state, position);
+    }
+
+    raise_position_change(position, pressed);
+}
+
+// The peripheral stopped sending, most likely because the cable was unplugged. Release its keys
+// rather than leaving them held.
+static void link_timeout_callback(struct k_work *work) {
+    LOG_WRN("Wired split peripheral disconnected");
+
+    peripheral_connected = false;
+
+    for (int i = 0; i < ZMK_POSITION_SET_WORDS; i++) {
+        for (uint32_t pressed = position_state.words[i]; pressed; pressed &= pressed - 1) {
+            raise_position_change(i * 32 + __builtin_ctz(pressed), false);
+        }
+    }
+
+    zmk_position_set_clear(&position_state);
+}
+
+static void apply_position_state(const uint8_t *data, uint8_t length) {
+    for (uint32_t position = 0; position < ZMK_KEYMAP_LEN; position++) {
+        bool pressed = position / 8 < length && (data[position / 8] & BIT(position % 8));
+
+        set_position_state(position, pressed);
+    }
+}
+
+// Runs on the input work queue, like the rest of the position event handling.
+static void handle_msg(const struct zmk_split_wired_msg *msg) {
+    if (!peripheral_connected) {
+        LOG_INF("Wired split peripheral connected");
+        peripheral_connected = true;
+    }
+
+    k_work_reschedule(&link_timeout_work, K_MSEC(CONFIG_ZMK_SPLIT_WIRED_LINK_TIMEOUT_MS));
+
+    switch (msg->type) {
+    case ZMK_SPLIT_WIRED_MSG_POSITION_EVENT: {
+        if (msg->len != sizeof(struct zmk_split_wired_position_event)) {
+            break;
+        }
+
+        const struct zmk_split_wired_position_event *ev = (const void *)msg->payload;
+        if (ev->position >= ZMK_KEYMAP_LEN) {
+            LOG_ERR("Invalid position %d from peripheral", ev->position);
+            break;
+        }
+
+        set_position_state(ev->position, ev->pressed);
+        break;
+    }
+    case ZMK_SPLIT_WIRED_MSG_POSITION_STATE:
+        apply_position_state(msg->payload, msg->len);
+        break;
+    default:
+        LOG_WRN("Unexpected split message type %d", msg->type);
+        break;
+    }
+}
+
+int zmk_split_wired_invoke_behavior(uint8_t source, struct zmk_behavior_binding *binding,
+                                    struct zmk_behavior_binding_event event, bool state) {
+    struct zmk_split_wired_run_behavior payload = {
+        .position = event.position,
+        .state = state ? 1 : 0,
+        .param1 = binding->param1,
+        .param2 = binding->param2,
+    };
+
+    if (source >= ZMK_SPLIT_WIRED_PERIPHERAL_COUNT) {
+        return -EINVAL;
+    }
+
+    if (strlcpy(payload.behavior_dev, binding->behavior_dev, sizeof(payload.behavior_dev)) >=
+        sizeof(payload.behavior_dev)) {
+        LOG_ERR("Truncated behavior label %s to %s before invoking peripheral behavior",
+                log_strdup(binding->behavior_dev), log_strdup(payload.behavior_dev));
+    }
+
+    return zmk_split_wired_send(ZMK_SPLIT_WIRED_MSG_RUN_BEHAVIOR, &payload, sizeof(payload));
+}
+
+static int zmk_split_wired_central_init(const struct device *_arg) {
+    return zmk_split_wired_link_init(zmk_input_work_q(), handle_msg);
+}
+
+ZMK_SYS_INIT(zmk_split_wired_central_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/uart.h>
+#include <kernel.h>
+#include <string.h>
+#include <sys/crc.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/hot_path_trace.h>
+#include <zmk/memory_stats.h>
+#include <zmk/pipeline_stats.h>
+#include <zmk/split/wired/link.h>
+#include <zmk/tx_queue.h>
+#include <zmk/work_watchdog.h>
+
+#define SYNC_BYTE 0xA5
+#define CRC_SEED 0xFFFF
+
+// Sync byte, type, length, payload and CRC.
+#define FRAME_OVERHEAD 5
+#define MAX_FRAME_LEN (ZMK_SPLIT_WIRED_MAX_PAYLOAD + FRAME_OVERHEAD)
+
+BUILD_ASSERT(ZMK_SPLIT_WIRED_MSG_POSITION_EVENT == ZMK_HOT_PATH_SPLIT_POSITION_EVENT &&
+                 ZMK_SPLIT_WIRED_MSG_POSITION_STATE == ZMK_HOT_PATH_SPLIT_POSITION_STATE &&
+                 ZMK_SPLIT_WIRED_MSG_RUN_BEHAVIOR == ZMK_HOT_PATH_SPLIT_RUN_BEHAVIOR,
+             "Hot path trace split message types must match the wired ones");
+
+// How long the line has to be idle before the UART hands over what it received so far.
+#define RX_TIMEOUT_US 50
+
+static const struct device *const uart = DEVICE_DT_GET(DT_CHOSEN(zmk_split_uart));
+
+static struct k_work_q *rx_work_q;
+static zmk_split_wired_rx_cb rx_callback;
+
+struct tx_frame {
+    uint8_t len;
+    uint8_t data[MAX_FRAME_LEN];
+};
+
+K_MSGQ_DEFINE(tx_msgq, sizeof(struct tx_frame), CONFIG_ZMK_SPLIT_WIRED_TX_QUEUE_SIZE, 4);
+K_MSGQ_DEFINE(rx_msgq, sizeof(struct zmk_split_wired_msg), CONFIG_ZMK_SPLIT_WIRED_RX_QUEUE_SIZE,
+              4);
+
+// The frame being sent. The UART reads from it until UART_TX_DONE.
+static struct tx_frame tx_frame;
+
+static uint8_t rx_bufs[2][MAX_FRAME_LEN * 2];
+static uint8_t rx_buf_next;
+
+static int start_tx_frame(const void *msg) {
+    const struct tx_frame *frame = msg;
+
+    int err = uart_tx(uart, frame->data, frame->len, SYS_FOREVER_US);
+    if (err) {
+        LOG_ERR("Failed to send split frame (err %d)", err);
+    }
+    return err;
+}
+
+static struct zmk_tx_queue tx_queue = ZMK_TX_QUEUE_INITIALIZER(&tx_msgq, &tx_frame, start_tx_frame);
+
+int zmk_split_wired_send(uint8_t type, const void *payload, uint8_t len) {
+    struct tx_frame frame;
+
+    if (len > ZMK_SPLIT_WIRED_MAX_PAYLOAD) {
+        return -EINVAL;
+    }
+
+    frame.data[0] = SYNC_BYTE;
+    frame.data[1] = type;
+    frame.data[2] = len;
+    memcpy(&frame.data[3], payload, len);
+
+    uint16_t crc = crc16_ccitt(CRC_SEED, &frame.data[1], len + 2);
+    frame.data[len + 3] = crc & 0xFF;
+    frame.data[len + 4] = crc >> 8;
+    frame.len = len + FRAME_OVERHEAD;
+
+    int err = k_msgq_put(&tx_msgq, &frame, K_NO_WAIT);
+    // Wired message types are recorded as is, since the trace uses the same numbers.
+    zmk_hot_path_trace(ZMK_HOT_PATH_SPLIT_SEND, NULL, err ? err : len, type);
+    if (err) {
+        LOG_WRN("Split transmit queue full, dropping message");
+        return err;
+    }
+
+    zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_WIRED_TX, &tx_msgq);
+
+    zmk_tx_queue_send_next(&tx_queue);
+
+    return 0;
+}
+
+static void rx_work_callback(struct k_work *work) {
+    struct zmk_split_wired_msg msg;
+
+    while (k_msgq_get(&rx_msgq, &msg, K_NO_WAIT) == 0) {
+        rx_callback(&msg);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(rx_work_callback)
+K_WORK_DEFINE(rx_work, ZMK_WORK_WATCHED(rx_work_callback));
+
+enum rx_state {
+    RX_STATE_SYNC,
+    RX_STATE_TYPE,
+    RX_STATE_LEN,
+    RX_STATE_PAYLOAD,
+    RX_STATE_CRC_LOW,
+    RX_STATE_CRC_HIGH,
+};
+
+static struct {
+    enum rx_state state;
+    struct zmk_split_wired_msg msg;
+    uint8_t received;
+    uint16_t crc;
+} rx;
+
+// Runs in the UART interrupt, one byte at a time, so frames may span any number of RX buffers.
+static void rx_byte(uint8_t byte) {
+    switch (rx.state) {
+    case RX_STATE_SYNC:
+        if (byte == SYNC_BYTE) {
+            rx.state = RX_STATE_TYPE;
+        }
+        break;
+    case RX_STATE_TYPE:
+        rx.msg.type = byte;
+        rx.state = RX_STATE_LEN;
+        break;
+    case RX_STATE_LEN:
+        if (byte > ZMK_SPLIT_WIRED_MAX_PAYLOAD) {
+            rx.state = RX_STATE_SYNC;
+            break;
+        }
+
+        rx.msg.len = byte;
+        rx.received = 0;
+        rx.state = byte > 0 ? RX_STATE_PAYLOAD : RX_STATE_CRC_LOW;
+        break;
+    case RX_STATE_PAYLOAD:
+        rx.msg.payload[rx.received++] = byte;
+        if (rx.received == rx.msg.len) {
+            rx.state = RX_STATE_CRC_LOW;
+        }
+        break;
+    case RX_STATE_CRC_LOW:
+        rx.crc = byte;
+        rx.state = RX_STATE_CRC_HIGH;
+        break;
+    case RX_STATE_CRC_HIGH: {
+        rx.crc |= byte << 8;
+        rx.state = RX_STATE_SYNC;
+
+        uint8_t header[] = {rx.msg.type, rx.msg.len};
+        uint16_t crc = crc16_ccitt(CRC_SEED, header, sizeof(header));
+        crc = crc16_ccitt(crc, rx.msg.payload, rx.msg.len);
+        if (crc != rx.crc) {
+            LOG_WRN("Dropping split frame with a bad CRC");
+            break;
+        }
+
+        if (k_msgq_put(&rx_msgq, &rx.msg, K_NO_WAIT) != 0) {
+            LOG_WRN("Split receive queue full, dropping message");
+            zmk_pipeline_stats_dropped(ZMK_PIPELINE_SPLIT_QUEUE);
+            break;
+        }
+
+        zmk_pipeline_stats_queued(ZMK_PIPELINE_SPLIT_QUEUE, k_msgq_num_used_get(&rx_msgq));
+        zmk_memory_stats_msgq(ZMK_MEMORY_QUEUE_SPLIT_WIRED_RX, &rx_msgq);
+
+        k_work_submit_to_queue(rx_work_q, &rx_work);
+        break;
+    }
+    }
+}
+
+static void uart_callback(const struct device *dev, struct uart_event *evt, void *user_data) {
+    switch (evt->type) {
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        zmk_tx_queue_done(&tx_queue);
+        break;
+    case UART_RX_RDY:
+        for (size_t i = 0; i < evt->data.rx.len; i++) {
+            rx_byte(evt->data.rx.buf[evt->data.rx.offset + i]);
+        }
+        break;
+    case UART_RX_BUF_REQUEST:
+        uart_rx_buf_rsp(dev, rx_bufs[rx_buf_next], sizeof(rx_bufs[0]));
+        rx_buf_next = !rx_buf_next;
+        break;
+    case UART_RX_STOPPED:
+        LOG_WRN("Split UART receive stopped (reason %d)", evt->data.rx_stop.reason);
+        rx.state = RX_STATE_SYNC;
+        break;
+    case UART_RX_DISABLED:
+        // Receiving stops after errors such as a break while the other half is unplugged.
+        rx_buf_next = 1;
+        uart_rx_enable(dev, rx_bufs[0], sizeof(rx_bufs[0]), RX_TIMEOUT_US);
+        break;
+    default:
+        break;
+    }
+}
+
+int zmk_split_wired_link_init(struct k_work_q *rx_queue, zmk_split_wired_rx_cb rx_cb) {
+    if (!device_is_ready(uart)) {
+        LOG_ERR("Split UART device is not ready");
+        return -ENODEV;
+    }
+
+    rx_work_q = rx_queue;
+    rx_callback = rx_cb;
+
+    int err = uart_callback_set(uart, uart_callback, NULL);
+    if (err) {
+        LOG_ERR("Failed to set the split UART callback (err %d)", err);
+        return err;
+    }
+
+    rx_buf_next = 1;
+    err = uart_rx_enable(uart, rx_bufs[0], sizeof(rx_bufs[0]), RX_TIMEOUT_US);
+    if (err) {
+        LOG_ERR("Failed to start receiving on the split UART (err %d)", err);
+        return err;
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <init.h>
+#include <kernel.h>
+#include <string.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <drivers/behavior.h>
+#include <zmk/boot_profile.h>
+#include <zmk/behavior.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/position_state_changed.h>
+#include <zmk/matrix.h>
+#include <zmk/split/wired/link.h>
+#include <zmk/work_watchdog.h>
+
+#define POS_STATE_LEN DIV_ROUND_UP(ZMK_KEYMAP_LEN, 8)
+
+BUILD_ASSERT(POS_STATE_LEN <= ZMK_SPLIT_WIRED_MAX_PAYLOAD,
+             "Too many key positions for the wired split position state");
+
+static uint8_t position_state[POS_STATE_LEN];
+
+static void send_position_state() {
+    zmk_split_wired_send(ZMK_SPLIT_WIRED_MSG_POSITION_STATE, position_state,
+                         sizeof(position_state));
+}
+
+// The periodic state lets the central recover from corrupted frames and notice the cable being
+// unplugged.
+static void heartbeat_callback(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(heartbeat_callback)
+static K_WORK_DELAYABLE_DEFINE(heartbeat_work, ZMK_WORK_WATCHED(heartbeat_callback));
+
+static void heartbeat_callback(struct k_work *work) {
+    send_position_state();
+    k_work_schedule(&heartbeat_work, K_MSEC(CONFIG_ZMK_SPLIT_WIRED_HEARTBEAT_MS));
+}
+
+static int split_wired_listener(const zmk_event_t *eh) {
+    const struct zmk_position_state_changed *ev = as_zmk_position_state_changed(eh);
+    if (ev == NULL || ev->position >= ZMK_KEYMAP_LEN) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    WRITE_BIT(position_state[ev->position / 8], ev->position % 8, ev->state);
+
+    struct zmk_split_wired_position_event msg = {.position = ev->position, .pressed = ev->state};
+    return zmk_split_wired_send(ZMK_SPLIT_WIRED_MSG_POSITION_EVENT, &msg, sizeof(msg));
+}
+
+ZMK_LISTENER(split_wired_listener, split_wired_listener);
+ZMK_SUBSCRIPTION(split_wired_listener, zmk_position_state_changed);
+
+static void run_behavior(const struct zmk_split_wired_run_behavior *payload) {
+    char behavior_dev[ZMK_SPLIT_WIRED_BEHAVIOR_DEV_LEN + 1];
+
+    // The label only fills the field when it was truncated, so terminate it here.
+    memcpy(behavior_dev, payload->behavior_dev, sizeof(payload->behavior_dev));
+    behavior_dev[sizeof(behavior_dev) - 1] = '\0';
+
+    struct zmk_behavior_binding binding = {
+        .param1 = payload->param1,
+        .param2 = payload->param2,
+        .behavior_dev = behavior_dev,
+    };
+    struct zmk_behavior_binding_event event = {.position = payload->position,
+                                               .timestamp = k_uptime_get()};
+    int err;
+
+    LOG_DBG("%s with params %d %d: pressed? %d", log_strdup(binding.behavior_dev), binding.param1,
+            binding.param2, payload->state);
+
+    if (payload->state > 0) {
+        err = behavior_keymap_binding_pressed(&binding, event);
+    } else {
+        err = behavior_keymap_binding_released(&binding, event);
+    }
+
+    if (err) {
+        LOG_ERR("Failed to invoke behavior %s: %d", log_strdup(binding.behavior_dev), err);
+    }
+}
+
+static void handle_msg(const struct zmk_split_wired_msg *msg) {
+    switch (msg->type) {
+    case ZMK_SPLIT_WIRED_MSG_RUN_BEHAVIOR:
+        if (msg->len != sizeof(struct zmk_split_wired_run_behavior)) {
+            break;
+        }
+
+        run_behavior((const void *)msg->payload);
+        break;
+    default:
+        LOG_WRN("Unexpected split message type %d", msg->type);
+        break;
+    }
+}
+
+static int zmk_split_wired_peripheral_init(const struct device *_arg) {
+    int err = zmk_split_wired_link_init(&k_sys_work_q, handle_msg);
+    if (err) {
+        return err;
+    }
+
+    k_work_schedule(&heartbeat_work, K_NO_WAIT);
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_split_wired_peripheral_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
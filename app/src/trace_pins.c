@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <devicetree.h>
+#include <drivers/gpio.h>
+#include <init.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/boot_profile.h>
+#include <zmk/trace_pins.h>
+
+#define TRACE_PINS_NODE DT_CHOSEN(zmk_trace_pins)
+
+#define TRACE_PIN(prop) GPIO_DT_SPEC_GET_OR(TRACE_PINS_NODE, prop, {0})
+
+static const struct gpio_dt_spec pins[] = {
+    [ZMK_TRACE_PIN_KSCAN] = TRACE_PIN(kscan_gpios),
+    [ZMK_TRACE_PIN_POSITION] = TRACE_PIN(position_gpios),
+    [ZMK_TRACE_PIN_REPORT] = TRACE_PIN(report_gpios),
+    [ZMK_TRACE_PIN_NOTIFY] = TRACE_PIN(notify_gpios),
+};
+
+BUILD_ASSERT(ARRAY_SIZE(pins) == ZMK_TRACE_PIN_COUNT, "Every trace point needs a pin");
+
+void zmk_trace_pin_toggle(enum zmk_trace_pin pin) {
+    // Toggling rather than pulsing gives an edge per event without a second port write.
+    if (pins[pin].port != NULL) {
+        gpio_pin_toggle_dt(&pins[pin]);
+    }
+}
+
+static int zmk_trace_pins_init(const struct device *_arg) {
+    for (int i = 0; i < ARRAY_SIZE(pins); i++) {
+        if (pins[i].port == NULL) {
+            continue;
+        }
+
+        if (!device_is_ready(pins[i].port)) {
+            LOG_ERR("GPIO is not ready: %s", pins[i].port->name);
+            return -ENODEV;
+        }
+
+        int err = gpio_pin_configure_dt(&pins[i], GPIO_OUTPUT_INACTIVE);
+        if (err) {
+            LOG_ERR("Unable to configure trace pin %u on %s (err %d)", pins[i].pin,
+                    pins[i].port->name, err);
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_trace_pins_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <shell/shell.h>
+#include <spinlock.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <dt-bindings/zmk/kscan_mock.h>
+#include <zmk/trace_recorder.h>
+
+// The largest delay a kscan-mock event can hold.
+#define MAX_DELAY_MS ZMK_MOCK_MSEC(UINT32_MAX)
+
+// Delay after the last event of a dump, long enough for the timeouts it started to run out.
+#define LAST_DELAY_MS 1000
+
+struct trace_entry {
+    uint32_t timestamp;
+    uint8_t row;
+    uint8_t column;
+    bool pressed;
+};
+
+static struct trace_entry entries[CONFIG_ZMK_TRACE_RECORDER_SIZE];
+// Free-running count of recorded entries, entry i is in slot (i % size).
+static uint32_t recorded;
+static bool recording;
+
+static struct k_spinlock lock;
+
+void zmk_trace_recorder_record(uint32_t row, uint32_t column, bool pressed, int64_t timestamp) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (recording) {
+        entries[recorded++ % ARRAY_SIZE(entries)] = (struct trace_entry){
+            .timestamp = (uint32_t)timestamp,
+            .row = row,
+            .column = column,
+            .pressed = pressed,
+        };
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+static int cmd_start(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    recording = true;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Recording key transitions");
+    return 0;
+}
+
+static int cmd_stop(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    recording = false;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Stopped recording, %u key transitions recorded",
+                (uint32_t)MIN(recorded, ARRAY_SIZE(entries)));
+    return 0;
+}
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    recorded = 0;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Recorded trace cleared");
+    return 0;
+}
+
+// Prints the trace as kscan-mock events, ready to paste into the events of a test keymap. The mock
+// waits for the delay of an event after sending it, so each delay is the time until the next
+// transition.
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv) {
+    if (recording) {
+        shell_error(sh, "Stop recording before dumping the trace");
+        return -EBUSY;
+    }
+
+    uint32_t start = recorded > ARRAY_SIZE(entries) ? recorded - ARRAY_SIZE(entries) : 0;
+
+    for (uint32_t i = start; i < recorded; i++) {
+        const struct trace_entry *entry = &entries[i % ARRAY_SIZE(entries)];
+        uint32_t delay = LAST_DELAY_MS;
+
+        if (i + 1 < recorded) {
+            delay = entries[(i + 1) % ARRAY_SIZE(entries)].timestamp - entry->timestamp;
+        }
+
+        shell_print(sh, "ZMK_MOCK_%s(%u,%u,%u)", entry->pressed ? "PRESS" : "RELEASE", entry->row,
+                    entry->column, MIN(delay, MAX_DELAY_MS));
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+                               SHELL_CMD(start, NULL, "Start recording key transitions",
+                                         cmd_start),
+                               SHELL_CMD(stop, NULL, "Stop recording key transitions", cmd_stop),
+                               SHELL_CMD(dump, NULL, "Print the trace as kscan-mock events",
+                                         cmd_dump),
+                               SHELL_CMD(clear, NULL, "Clear the recorded trace", cmd_clear),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(trace, &sub_trace, "ZMK typing trace recorder commands", NULL);
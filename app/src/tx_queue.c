@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <sys/atomic.h>
+
+#include <zmk/tx_queue.h>
+
+void zmk_tx_queue_send_next(struct zmk_tx_queue *queue) {
+    while (atomic_cas(&queue->busy, false, true)) {
+        if (k_msgq_get(queue->msgq, queue->msg, K_NO_WAIT) == 0 && queue->start(queue->msg) == 0) {
+            return;
+        }
+
+        atomic_set(&queue->busy, false);
+
+        // A message queued after the queue was found empty, but before the flag was cleared,
+        // would otherwise wait for the next one.
+        if (k_msgq_num_used_get(queue->msgq) == 0) {
+            return;
+        }
+    }
+}
+
+void zmk_tx_queue_done(struct zmk_tx_queue *queue) {
+    atomic_set(&queue->busy, false);
+    zmk_tx_queue_send_next(queue);
+}
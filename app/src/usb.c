@@ -10,21 +10,25 @@
 #include <usb/usb_device.h>
 #include <usb/class/usb_hid.h>
 
+#include <zmk/boot_profile.h>
 #include <zmk/hid.h>
+#include <zmk/usb_hid.h>
 #include <zmk/keymap.h>
 #include <zmk/event_manager.h>
 #include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/work_watchdog.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static enum usb_dc_status_code usb_status = USB_DC_UNKNOWN;
 
 static void raise_usb_status_changed_event(struct k_work *_work) {
-    ZMK_EVENT_RAISE(new_zmk_usb_conn_state_changed(
-        (struct zmk_usb_conn_state_changed){.conn_state = zmk_usb_get_conn_state()}));
+    raise_zmk_usb_conn_state_changed(
+        (struct zmk_usb_conn_state_changed){.conn_state = zmk_usb_get_conn_state()});
 }
 
-K_WORK_DEFINE(usb_status_notifier_work, raise_usb_status_changed_event);
+ZMK_WORK_WATCHDOG_WRAP(raise_usb_status_changed_event)
+K_WORK_DEFINE(usb_status_notifier_work, ZMK_WORK_WATCHED(raise_usb_status_changed_event));
 
 enum usb_dc_status_code zmk_usb_get_status() { return usb_status; }
 
@@ -48,6 +52,27 @@ enum zmk_usb_conn_state zmk_usb_get_conn_state() {
 
 void usb_status_cb(enum usb_dc_status_code status, const uint8_t *params) {
     usb_status = status;
+
+#if IS_ENABLED(CONFIG_ZMK_USB)
+    switch (status) {
+    case USB_DC_ERROR:
+    case USB_DC_RESET:
+    case USB_DC_CONFIGURED:
+    case USB_DC_DISCONNECTED:
+        // Any transfer in flight was aborted, so its completion won't send the queued reports.
+        zmk_usb_hid_reset_queue();
+        break;
+    case USB_DC_SUSPEND:
+        zmk_usb_hid_set_suspended(true);
+        break;
+    case USB_DC_RESUME:
+        zmk_usb_hid_set_suspended(false);
+        break;
+    default:
+        break;
+    }
+#endif
+
     k_work_submit(&usb_status_notifier_work);
 };
 
@@ -64,4 +89,4 @@ static int zmk_usb_init(const struct device *_arg) {
     return 0;
 }
 
-SYS_INIT(zmk_usb_init, APPLICATION, CONFIG_ZMK_USB_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_usb_init, APPLICATION, CONFIG_ZMK_USB_INIT_PRIORITY);
@@ -6,59 +6,561 @@
 
 #include <device.h>
 #include <init.h>
+#include <string.h>
+#include <sys/atomic.h>
 
 #include <usb/usb_device.h>
 #include <usb/class/usb_hid.h>
 
+#include <zmk/boot_profile.h>
+#include <zmk/endpoints.h>
 #include <zmk/usb.h>
+#include <zmk/usb_hid.h>
 #include <zmk/hid.h>
 #include <zmk/keymap.h>
 #include <zmk/event_manager.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
-static const struct device *hid_dev;
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+#define MAX_REPORT_LEN                                                                             \
+    MAX(MAX(sizeof(struct zmk_hid_keyboard_report), sizeof(struct zmk_hid_consumer_report)),       \
+        sizeof(struct zmk_hid_mouse_report))
+#else
+#define MAX_REPORT_LEN                                                                             \
+    MAX(sizeof(struct zmk_hid_keyboard_report), sizeof(struct zmk_hid_consumer_report))
+#endif
 
-static K_SEM_DEFINE(hid_sem, 1, 1);
+struct queued_report {
+    uint8_t len;
+    uint8_t data[MAX_REPORT_LEN];
+};
+
+// With separate interfaces, each report type has its own HID device and IN endpoint, so a report
+// never waits for the transfer of another type.
+#if IS_ENABLED(CONFIG_ZMK_USB_HID_SEPARATE_INTERFACES)
+enum hid_interface_id {
+    HID_INTERFACE_KEYBOARD,
+    HID_INTERFACE_CONSUMER,
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    HID_INTERFACE_MOUSE,
+#endif
+    HID_INTERFACE_COUNT,
+};
+#else
+enum hid_interface_id {
+    HID_INTERFACE_KEYBOARD,
+    HID_INTERFACE_COUNT,
+};
+#define HID_INTERFACE_CONSUMER HID_INTERFACE_KEYBOARD
+#define HID_INTERFACE_MOUSE HID_INTERFACE_KEYBOARD
+#endif
+
+struct hid_interface {
+    const struct device *dev;
+    // Reports waiting for the IN transfer in flight to complete. The completion callback sends the
+    // next one, so callers never wait for the host.
+    struct queued_report queue[CONFIG_ZMK_USB_HID_REPORT_QUEUE_SIZE];
+    uint8_t queue_head;
+    uint8_t queue_len;
+    // The keyboard report taken from the queue last, which the host already has or is about to
+    // get.
+    struct zmk_hid_keyboard_report last_keyboard_report;
+    bool transfer_in_flight;
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    // Mouse reports aren't queued. The report is only built from the accumulated motion once the
+    // endpoint is free, so motion arriving between two polls goes out as one report.
+    bool mouse_report_pending;
+#endif
+};
+
+static struct hid_interface interfaces[HID_INTERFACE_COUNT];
+
+// While the host has suspended the bus, reports wait in the queues until it resumes.
+static bool host_suspended;
+static atomic_t wakeup_requested;
+
+static struct k_spinlock lock;
+
+static struct hid_interface *interface_for_report(const uint8_t *report) {
+#if IS_ENABLED(CONFIG_ZMK_USB_HID_SEPARATE_INTERFACES)
+    switch (report[0]) {
+    case ZMK_HID_REPORT_ID_CONSUMER:
+        return &interfaces[HID_INTERFACE_CONSUMER];
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    case ZMK_HID_REPORT_ID_MOUSE:
+        return &interfaces[HID_INTERFACE_MOUSE];
+#endif
+    }
+#endif
+
+    return &interfaces[HID_INTERFACE_KEYBOARD];
+}
+
+static struct hid_interface *interface_for_dev(const struct device *dev) {
+    for (int i = 0; i < HID_INTERFACE_COUNT; i++) {
+        if (interfaces[i].dev == dev) {
+            return &interfaces[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Must be called with the lock held.
+static void clear_queues() {
+    for (int i = 0; i < HID_INTERFACE_COUNT; i++) {
+        interfaces[i].queue_len = 0;
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+        interfaces[i].mouse_report_pending = false;
+#endif
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+static uint8_t hid_protocol = HID_PROTOCOL_REPORT;
+
+static bool is_boot_protocol() { return hid_protocol == HID_PROTOCOL_BOOT; }
+
+// Boot reports have no ID to tell them apart, so the host gets nothing but keyboard reports.
+static void protocol_change_cb(const struct device *dev, uint8_t protocol) {
+    LOG_DBG("USB HID protocol set to %s", protocol == HID_PROTOCOL_BOOT ? "boot" : "report");
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    hid_protocol = protocol;
+    // Reports queued for the other protocol would mean nothing to the host.
+    interfaces[HID_INTERFACE_KEYBOARD].queue_len = 0;
+    k_spin_unlock(&lock, key);
+}
+#else
+#define is_boot_protocol() false
+#endif
+
+static struct queued_report *queue_at(struct hid_interface *iface, uint8_t index) {
+    return &iface->queue[(iface->queue_head + index) % CONFIG_ZMK_USB_HID_REPORT_QUEUE_SIZE];
+}
+
+// Boot reports have no ID and a layout of their own, so they are never merged.
+static bool is_keyboard_report(const uint8_t *data, size_t len) {
+    return !is_boot_protocol() && len == sizeof(struct zmk_hid_keyboard_report) &&
+           data[0] == ZMK_HID_REPORT_ID_KEYBOARD;
+}
+
+static const struct zmk_hid_keyboard_report_body *keyboard_report_body(const uint8_t *data) {
+    return &((const struct zmk_hid_keyboard_report *)data)->body;
+}
+
+// Must be called with the lock held.
+static void pop_report(struct hid_interface *iface, struct queued_report *report) {
+    *report = *queue_at(iface, 0);
+    if (is_keyboard_report(report->data, report->len)) {
+        memcpy(&iface->last_keyboard_report, report->data, report->len);
+    }
+
+    iface->queue_head = (iface->queue_head + 1) % CONFIG_ZMK_USB_HID_REPORT_QUEUE_SIZE;
+    iface->queue_len--;
+}
+
+// Must be called with the lock held. A keyboard report can replace the newest queued report if
+// that is a keyboard report too, and skipping the state in between loses no press or release.
+static bool merge_report(struct hid_interface *iface, const uint8_t *report, size_t len) {
+    if (iface->queue_len == 0 || !is_keyboard_report(report, len)) {
+        return false;
+    }
+
+    struct queued_report *queued = queue_at(iface, iface->queue_len - 1);
+    if (!is_keyboard_report(queued->data, queued->len)) {
+        return false;
+    }
+
+    const struct zmk_hid_keyboard_report_body *before = &iface->last_keyboard_report.body;
+    for (int i = iface->queue_len - 2; i >= 0; i--) {
+        if (is_keyboard_report(queue_at(iface, i)->data, queue_at(iface, i)->len)) {
+            before = keyboard_report_body(queue_at(iface, i)->data);
+            break;
+        }
+    }
+
+    if (!zmk_hid_keyboard_report_can_skip(before, keyboard_report_body(queued->data),
+                                          keyboard_report_body(report))) {
+        return false;
+    }
+
+    memcpy(queued->data, report, len);
+    return true;
+}
+
+// Must be called with the lock held.
+static void enqueue_report(struct hid_interface *iface, const uint8_t *report, size_t len) {
+    if (iface->queue_len == CONFIG_ZMK_USB_HID_REPORT_QUEUE_SIZE) {
+        if (merge_report(iface, report, len)) {
+            return;
+        }
+
+        struct queued_report discarded_report;
+        LOG_WRN("USB HID report queue full, dropping the oldest report");
+        pop_report(iface, &discarded_report);
+    }
+
+    struct queued_report *slot = queue_at(iface, iface->queue_len++);
+    slot->len = len;
+    memcpy(slot->data, report, len);
+}
+
+// Must be called with the lock held. Queued reports go first, the mouse report after them.
+static bool take_next_report(struct hid_interface *iface, struct queued_report *report) {
+    if (iface->queue_len > 0) {
+        pop_report(iface, report);
+        return true;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    if (iface->mouse_report_pending) {
+        struct zmk_hid_mouse_report mouse_report;
+
+        // Stays pending after sending a report, so motion that didn't fit it goes out with the
+        // next poll.
+        iface->mouse_report_pending = zmk_hid_mouse_take_report(&mouse_report);
+        if (iface->mouse_report_pending) {
+            report->len = sizeof(mouse_report);
+            memcpy(report->data, &mouse_report, sizeof(mouse_report));
+            return true;
+        }
+    }
+#endif
+
+    return false;
+}
+
+// Must be called with the lock held and a transfer marked in flight. Unlocks while writing.
+static void write_queued_reports(struct hid_interface *iface, k_spinlock_key_t key) {
+    struct queued_report report;
+
+    while (take_next_report(iface, &report)) {
+        k_spin_unlock(&lock, key);
+
+        int err = hid_int_ep_write(iface->dev, report.data, report.len, NULL);
+
+        key = k_spin_lock(&lock);
+        if (err == 0) {
+            k_spin_unlock(&lock, key);
+            return;
+        }
+
+        LOG_ERR("Failed to send queued USB HID report (err %d)", err);
+    }
+
+    iface->transfer_in_flight = false;
+    k_spin_unlock(&lock, key);
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    zmk_endpoints_reports_delivered();
+#endif
+}
+
+static void in_ready_cb(const struct device *dev) {
+    struct hid_interface *iface = interface_for_dev(dev);
+    if (iface == NULL) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    write_queued_reports(iface, key);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+#define REPORT_TYPE_FEATURE 0x03
+
+// The only report the host reads or writes through the control endpoint is the mouse's
+// resolution multiplier feature.
+static bool is_mouse_feature_report(const struct usb_setup_packet *setup) {
+    return (setup->wValue >> 8) == REPORT_TYPE_FEATURE &&
+           (setup->wValue & 0xFF) == ZMK_HID_REPORT_ID_MOUSE;
+}
+
+static int get_report_cb(const struct device *dev, struct usb_setup_packet *setup, int32_t *len,
+                         uint8_t **data) {
+    static uint8_t feature_report[2];
+
+    if (!is_mouse_feature_report(setup)) {
+        return -ENOTSUP;
+    }
+
+    feature_report[0] = ZMK_HID_REPORT_ID_MOUSE;
+    feature_report[1] = zmk_hid_mouse_get_resolution_multipliers();
+    *data = feature_report;
+    *len = sizeof(feature_report);
+    return 0;
+}
 
-static void in_ready_cb(const struct device *dev) { k_sem_give(&hid_sem); }
+static int set_report_cb(const struct device *dev, struct usb_setup_packet *setup, int32_t *len,
+                         uint8_t **data) {
+    if (!is_mouse_feature_report(setup) || *len != 2) {
+        return -ENOTSUP;
+    }
+
+    zmk_hid_mouse_set_resolution_multipliers((*data)[1]);
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
 
 static const struct hid_ops ops = {
     .int_in_ready = in_ready_cb,
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+    .protocol_change = protocol_change_cb,
+#endif
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+    .get_report = get_report_cb,
+    .set_report = set_report_cb,
+#endif
 };
 
-int zmk_usb_hid_send_report(const uint8_t *report, size_t len) {
+void zmk_usb_hid_reset_queue() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    for (int i = 0; i < HID_INTERFACE_COUNT; i++) {
+        interfaces[i].queue_len = 0;
+        interfaces[i].transfer_in_flight = false;
+        memset(&interfaces[i].last_keyboard_report, 0, sizeof(struct zmk_hid_keyboard_report));
+    }
+    host_suspended = false;
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+    hid_protocol = HID_PROTOCOL_REPORT;
+#endif
+    k_spin_unlock(&lock, key);
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+    zmk_endpoints_reports_delivered();
+#endif
+}
+
+#if IS_ENABLED(CONFIG_ZMK_MACRO_PACING)
+// Must be called with the lock held.
+static bool interface_busy(const struct hid_interface *iface) {
+    return iface->transfer_in_flight || iface->queue_len > 0;
+}
+
+// With separate interfaces, mouse reports don't count, since the motion keeps coming and would hold
+// up the macros waiting for the keyboard.
+bool zmk_usb_hid_reports_pending() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool pending = interface_busy(&interfaces[HID_INTERFACE_KEYBOARD]) ||
+                   interface_busy(&interfaces[HID_INTERFACE_CONSUMER]);
+    k_spin_unlock(&lock, key);
+    return pending;
+}
+#endif
+
+void zmk_usb_hid_set_suspended(bool suspended) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    host_suspended = suspended;
+    atomic_set(&wakeup_requested, false);
+    k_spin_unlock(&lock, key);
+
+    if (suspended) {
+        return;
+    }
+
+    for (int i = 0; i < HID_INTERFACE_COUNT; i++) {
+        struct hid_interface *iface = &interfaces[i];
+
+        key = k_spin_lock(&lock);
+        bool pending = iface->queue_len > 0;
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+        pending = pending || iface->mouse_report_pending;
+#endif
+
+        if (iface->transfer_in_flight || !pending) {
+            k_spin_unlock(&lock, key);
+            continue;
+        }
+
+        iface->transfer_in_flight = true;
+        write_queued_reports(iface, key);
+    }
+}
+
+// Asks the suspended host to resume the bus, once per suspend. If it doesn't allow remote wakeup,
+// the queued reports are dropped, so they aren't typed long after the keys were pressed.
+static int wake_host() {
+    if (atomic_set(&wakeup_requested, true)) {
+        return 0;
+    }
+
+    int err = usb_wakeup_request();
+    if (err) {
+        LOG_WRN("Unable to wake the USB host (err %d)", err);
+
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        clear_queues();
+        k_spin_unlock(&lock, key);
+    }
+
+    return err;
+}
+
+static int check_usb_status() {
     switch (zmk_usb_get_status()) {
-    case USB_DC_SUSPEND:
-        return usb_wakeup_request();
     case USB_DC_ERROR:
     case USB_DC_RESET:
     case USB_DC_DISCONNECTED:
     case USB_DC_UNKNOWN:
         return -ENODEV;
     default:
-        k_sem_take(&hid_sem, K_MSEC(30));
-        int err = hid_int_ep_write(hid_dev, report, len, NULL);
+        return 0;
+    }
+}
 
-        if (err) {
-            k_sem_give(&hid_sem);
-        }
+#if IS_ENABLED(CONFIG_ZMK_MOUSE)
+int zmk_usb_hid_send_mouse_report() {
+    int err = check_usb_status();
+    if (err) {
+        return err;
+    }
+
+    if (is_boot_protocol()) {
+        // Drop the motion rather than sending it once the host returns to the report protocol.
+        struct zmk_hid_mouse_report discarded_report;
+        zmk_hid_mouse_take_report(&discarded_report);
+        return 0;
+    }
+
+    struct hid_interface *iface = &interfaces[HID_INTERFACE_MOUSE];
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    iface->mouse_report_pending = true;
+    if (host_suspended) {
+        k_spin_unlock(&lock, key);
+        return wake_host();
+    }
+
+    if (iface->transfer_in_flight) {
+        k_spin_unlock(&lock, key);
+        return 0;
+    }
 
+    iface->transfer_in_flight = true;
+    write_queued_reports(iface, key);
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_MOUSE) */
+
+static int send_report(struct hid_interface *iface, const uint8_t *report, size_t len) {
+    int err = check_usb_status();
+    if (err) {
         return err;
     }
+
+    if (len > MAX_REPORT_LEN) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (host_suspended) {
+        enqueue_report(iface, report, len);
+        k_spin_unlock(&lock, key);
+        return wake_host();
+    }
+
+    if (iface->transfer_in_flight) {
+        enqueue_report(iface, report, len);
+        k_spin_unlock(&lock, key);
+        return 0;
+    }
+
+    iface->transfer_in_flight = true;
+    k_spin_unlock(&lock, key);
+
+    err = hid_int_ep_write(iface->dev, report, len, NULL);
+    if (err) {
+        // Reports queued meanwhile still need to go out.
+        key = k_spin_lock(&lock);
+        write_queued_reports(iface, key);
+    }
+
+    return err;
 }
 
-static int zmk_usb_hid_init(const struct device *_arg) {
-    hid_dev = device_get_binding("HID_0");
-    if (hid_dev == NULL) {
+int zmk_usb_hid_send_report(const uint8_t *report, size_t len) {
+    if (is_boot_protocol()) {
+        return 0;
+    }
+
+    return send_report(interface_for_report(report), report, len);
+}
+
+int zmk_usb_hid_send_keyboard_report(const struct zmk_hid_keyboard_report *report) {
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+    if (is_boot_protocol()) {
+        return send_report(&interfaces[HID_INTERFACE_KEYBOARD],
+                           (const uint8_t *)zmk_hid_get_boot_report(),
+                           sizeof(struct zmk_hid_boot_report));
+    }
+#endif
+
+    return send_report(&interfaces[HID_INTERFACE_KEYBOARD], (const uint8_t *)report,
+                       sizeof(*report));
+}
+
+#if IS_ENABLED(CONFIG_ZMK_USB_HID_SEPARATE_INTERFACES)
+static const char *const interface_dev_names[] = {"HID_0", "HID_1", "HID_2"};
+
+// Each interface gets one top level collection of the report descriptor, which has them in the
+// same order as the interfaces. Only short items are used, so the items can be skipped by size.
+static int register_interfaces() {
+    size_t start = 0;
+    int depth = 0;
+    int found = 0;
+
+    for (size_t i = 0; i < sizeof(zmk_hid_report_desc) && found < HID_INTERFACE_COUNT;) {
+        uint8_t prefix = zmk_hid_report_desc[i];
+        uint8_t size = (prefix & 0x03) == 0x03 ? 4 : (prefix & 0x03);
+
+        i += 1 + size;
+
+        if ((prefix & 0xFC) == HID_MI_COLLECTION) {
+            depth++;
+        } else if ((prefix & 0xFC) == HID_MI_COLLECTION_END && --depth == 0) {
+            struct hid_interface *iface = &interfaces[found];
+
+            iface->dev = device_get_binding(interface_dev_names[found]);
+            if (iface->dev == NULL) {
+                LOG_ERR("Unable to locate HID device %s", interface_dev_names[found]);
+                return -EINVAL;
+            }
+
+            usb_hid_register_device(iface->dev, &zmk_hid_report_desc[start], i - start, &ops);
+            found++;
+            start = i;
+        }
+    }
+
+    return found == HID_INTERFACE_COUNT ? 0 : -EINVAL;
+}
+#else
+static int register_interfaces() {
+    interfaces[HID_INTERFACE_KEYBOARD].dev = device_get_binding("HID_0");
+    if (interfaces[HID_INTERFACE_KEYBOARD].dev == NULL) {
         LOG_ERR("Unable to locate HID device");
         return -EINVAL;
     }
 
-    usb_hid_register_device(hid_dev, zmk_hid_report_desc, sizeof(zmk_hid_report_desc), &ops);
-    usb_hid_init(hid_dev);
+    usb_hid_register_device(interfaces[HID_INTERFACE_KEYBOARD].dev, zmk_hid_report_desc,
+                            sizeof(zmk_hid_report_desc), &ops);
+    return 0;
+}
+#endif /* IS_ENABLED(CONFIG_ZMK_USB_HID_SEPARATE_INTERFACES) */
+
+static int zmk_usb_hid_init(const struct device *_arg) {
+    int err = register_interfaces();
+    if (err) {
+        return err;
+    }
+
+    for (int i = 0; i < HID_INTERFACE_COUNT; i++) {
+        usb_hid_init(interfaces[i].dev);
+    }
 
     return 0;
 }
 
-SYS_INIT(zmk_usb_hid_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+ZMK_SYS_INIT(zmk_usb_hid_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
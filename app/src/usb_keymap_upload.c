@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <init.h>
+#include <kernel.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include <usb/usb_device.h>
+#include <usb/class/usb_hid.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <drivers/behavior.h>
+#include <zmk/behavior.h>
+#include <zmk/boot_profile.h>
+#include <zmk/hid.h>
+#include <zmk/keymap.h>
+#include <zmk/tx_queue.h>
+#include <zmk/usb_keymap_upload.h>
+#include <zmk/work_watchdog.h>
+#include <zmk/workqueue.h>
+
+// A vendor defined collection with one output report for requests and one input report for
+// responses, without report IDs.
+static const uint8_t upload_report_desc[] = {
+    ZMK_HID_USAGE_PAGE16(ZMK_USB_KEYMAP_UPLOAD_USAGE_PAGE),
+    HID_USAGE(ZMK_USB_KEYMAP_UPLOAD_USAGE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+    HID_USAGE(ZMK_USB_KEYMAP_UPLOAD_USAGE),
+    HID_LOGICAL_MIN8(0x00),
+    HID_LOGICAL_MAX16(0xFF, 0x00),
+    HID_REPORT_SIZE(0x08),
+    HID_REPORT_COUNT(sizeof(struct zmk_usb_keymap_upload_request)),
+    /* OUTPUT (Data,Var,Abs) */
+    HID_OUTPUT(0x02),
+    HID_USAGE(ZMK_USB_KEYMAP_UPLOAD_USAGE),
+    HID_REPORT_COUNT(sizeof(struct zmk_usb_keymap_upload_response)),
+    /* INPUT (Data,Var,Abs) */
+    HID_INPUT(0x02),
+    HID_END_COLLECTION,
+};
+
+static const char *const interface_dev_names[] = {"HID_0", "HID_1", "HID_2", "HID_3", "HID_4"};
+
+BUILD_ASSERT(CONFIG_USB_HID_DEVICE_COUNT <= ARRAY_SIZE(interface_dev_names),
+             "The keymap upload interface needs a HID device name");
+
+static const struct device *hid_dev;
+
+K_MSGQ_DEFINE(request_msgq, sizeof(struct zmk_usb_keymap_upload_request),
+              CONFIG_ZMK_USB_KEYMAP_UPLOAD_QUEUE_SIZE, 4);
+K_MSGQ_DEFINE(response_msgq, sizeof(struct zmk_usb_keymap_upload_response),
+              CONFIG_ZMK_USB_KEYMAP_UPLOAD_QUEUE_SIZE, 4);
+
+// The response being sent. The endpoint reads from it until it's ready again.
+static struct zmk_usb_keymap_upload_response response;
+
+static int start_response(const void *msg) {
+    int err = hid_int_ep_write(hid_dev, msg, sizeof(response), NULL);
+    if (err) {
+        LOG_DBG("Failed to send keymap upload response (err %d)", err);
+    }
+    return err;
+}
+
+static struct zmk_tx_queue response_tx =
+    ZMK_TX_QUEUE_INITIALIZER(&response_msgq, &response, start_response);
+
+static char behavior_names[CONFIG_ZMK_USB_KEYMAP_UPLOAD_MAX_BEHAVIORS]
+                          [ZMK_KEYMAP_BEHAVIOR_NAME_MAX];
+
+static int handle_behavior(const struct zmk_usb_keymap_upload_request *request) {
+    uint8_t index = request->behavior.index;
+    size_t len = strnlen(request->behavior.name, sizeof(request->behavior.name));
+
+    if (index >= ARRAY_SIZE(behavior_names) || len >= ZMK_KEYMAP_BEHAVIOR_NAME_MAX) {
+        return -EINVAL;
+    }
+
+    memcpy(behavior_names[index], request->behavior.name, len);
+    behavior_names[index][len] = '\0';
+
+    // Checked here so an unknown behavior fails the request that named it.
+    return device_get_binding(behavior_names[index]) == NULL ? -ENODEV : 0;
+}
+
+static int handle_bindings(const struct zmk_usb_keymap_upload_request *request) {
+    uint16_t position = sys_le16_to_cpu(request->bindings.position);
+
+    if (request->bindings.count > ZMK_USB_KEYMAP_UPLOAD_BINDINGS_MAX) {
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < request->bindings.count; i++) {
+        const struct zmk_usb_keymap_upload_binding *binding = &request->bindings.bindings[i];
+
+        if (binding->behavior >= ARRAY_SIZE(behavior_names) ||
+            behavior_names[binding->behavior][0] == '\0') {
+            return -EINVAL;
+        }
+
+        int err = zmk_keymap_stage_binding(request->bindings.layer, position + i,
+                                           &(struct zmk_behavior_binding){
+                                               .behavior_dev = behavior_names[binding->behavior],
+                                               .param1 = sys_le32_to_cpu(binding->param1),
+                                               .param2 = sys_le32_to_cpu(binding->param2),
+                                           });
+        if (err) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+static int handle_request(const struct zmk_usb_keymap_upload_request *request) {
+    switch (request->command) {
+    case ZMK_USB_KEYMAP_UPLOAD_BEGIN:
+        memset(behavior_names, 0, sizeof(behavior_names));
+        zmk_keymap_stage_begin();
+        return 0;
+    case ZMK_USB_KEYMAP_UPLOAD_BEHAVIOR:
+        return handle_behavior(request);
+    case ZMK_USB_KEYMAP_UPLOAD_BINDINGS:
+        return handle_bindings(request);
+    case ZMK_USB_KEYMAP_UPLOAD_COMMIT:
+        return zmk_keymap_stage_commit();
+    case ZMK_USB_KEYMAP_UPLOAD_ABORT:
+        zmk_keymap_stage_abort();
+        return 0;
+    default:
+        return -ENOTSUP;
+    }
+}
+
+// Runs on the input work queue, so a commit never swaps bindings while a key is being processed.
+static void request_work_cb(struct k_work *work) {
+    struct zmk_usb_keymap_upload_request request;
+
+    while (k_msgq_get(&request_msgq, &request, K_NO_WAIT) == 0) {
+        int err = handle_request(&request);
+        if (err) {
+            LOG_WRN("Keymap upload command %d failed (err %d)", request.command, err);
+            zmk_keymap_stage_abort();
+        }
+
+        struct zmk_usb_keymap_upload_response result = {
+            .command = request.command,
+            .sequence = request.sequence,
+            .status = sys_cpu_to_le16(err),
+        };
+
+        if (k_msgq_put(&response_msgq, &result, K_NO_WAIT) != 0) {
+            LOG_WRN("Keymap upload response queue full, dropping response");
+        }
+
+        zmk_tx_queue_send_next(&response_tx);
+    }
+}
+
+ZMK_WORK_WATCHDOG_WRAP(request_work_cb)
+K_WORK_DEFINE(request_work, ZMK_WORK_WATCHED(request_work_cb));
+
+static int set_report_cb(const struct device *dev, struct usb_setup_packet *setup, int32_t *len,
+                         uint8_t **data) {
+    if (*len != sizeof(struct zmk_usb_keymap_upload_request)) {
+        return -ENOTSUP;
+    }
+
+    // A full queue fails the transfer, so the host knows to send it again.
+    int err = k_msgq_put(&request_msgq, *data, K_NO_WAIT);
+    if (err) {
+        return err;
+    }
+
+    k_work_submit_to_queue(zmk_input_work_q(), &request_work);
+    return 0;
+}
+
+static void in_ready_cb(const struct device *dev) {
+    zmk_tx_queue_done(&response_tx);
+}
+
+static const struct hid_ops ops = {
+    .int_in_ready = in_ready_cb,
+    .set_report = set_report_cb,
+};
+
+static int zmk_usb_keymap_upload_init(const struct device *_arg) {
+    // The last HID device, after the report and telemetry interfaces.
+    hid_dev = device_get_binding(interface_dev_names[CONFIG_USB_HID_DEVICE_COUNT - 1]);
+    if (hid_dev == NULL) {
+        LOG_ERR("Unable to locate the USB keymap upload HID device");
+        return -EINVAL;
+    }
+
+    usb_hid_register_device(hid_dev, upload_report_desc, sizeof(upload_report_desc), &ops);
+    return usb_hid_init(hid_dev);
+}
+
+ZMK_SYS_INIT(zmk_usb_keymap_upload_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <device.h>
+#include <init.h>
+#include <kernel.h>
+#include <sys/atomic.h>
+#include <sys/byteorder.h>
+
+#include <usb/usb_device.h>
+#include <usb/class/usb_hid.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/battery.h>
+#include <zmk/boot_profile.h>
+#include <zmk/event_manager.h>
+#include <zmk/hid.h>
+#include <zmk/pipeline_stats.h>
+#include <zmk/usb.h>
+#include <zmk/usb_telemetry.h>
+#include <zmk/events/usb_conn_state_changed.h>
+#include <zmk/work_watchdog.h>
+
+// A vendor defined collection with a single input report and no report ID, so the host reads the
+// raw record.
+static const uint8_t telemetry_report_desc[] = {
+    ZMK_HID_USAGE_PAGE16(ZMK_USB_TELEMETRY_USAGE_PAGE),
+    HID_USAGE(ZMK_USB_TELEMETRY_USAGE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+    HID_USAGE(ZMK_USB_TELEMETRY_USAGE),
+    HID_LOGICAL_MIN8(0x00),
+    HID_LOGICAL_MAX16(0xFF, 0x00),
+    HID_REPORT_SIZE(0x08),
+    HID_REPORT_COUNT(sizeof(struct zmk_usb_telemetry_record)),
+    /* INPUT (Data,Var,Abs) */
+    HID_INPUT(0x02),
+    HID_END_COLLECTION,
+};
+
+// Full speed interrupt endpoints carry at most 64 bytes per transfer.
+BUILD_ASSERT(sizeof(struct zmk_usb_telemetry_record) <= 64,
+             "The telemetry record must fit in one transfer");
+
+static const char *const interface_dev_names[] = {"HID_0", "HID_1", "HID_2", "HID_3", "HID_4"};
+
+BUILD_ASSERT(CONFIG_USB_HID_DEVICE_COUNT <= ARRAY_SIZE(interface_dev_names),
+             "The telemetry interface needs a HID device name");
+
+static const struct device *hid_dev;
+
+// Only the record being sent is buffered. The keyboard reports never share it or wait for it.
+static struct zmk_usb_telemetry_record record;
+static atomic_t transfer_in_flight;
+static uint16_t sequence;
+
+static void in_ready_cb(const struct device *dev) { atomic_set(&transfer_in_flight, false); }
+
+static const struct hid_ops ops = {
+    .int_in_ready = in_ready_cb,
+};
+
+static uint16_t saturate(uint32_t value) { return MIN(value, UINT16_MAX); }
+
+static void fill_record() {
+    struct zmk_pipeline_stats stats;
+
+    zmk_pipeline_stats_get(&stats);
+
+    record.version = ZMK_USB_TELEMETRY_VERSION;
+#if IS_ENABLED(CONFIG_ZMK_BLE)
+    record.battery = zmk_battery_state_of_charge();
+#else
+    record.battery = UINT8_MAX;
+#endif
+    record.sequence = sys_cpu_to_le16(sequence++);
+    record.uptime_ms = sys_cpu_to_le32(k_uptime_get_32());
+    record.worst_latency_ms = sys_cpu_to_le16(saturate(stats.worst_latency_ms));
+    record.peak_heap_events = sys_cpu_to_le16(saturate(stats.peak_heap_events));
+    record.alloc_failures = sys_cpu_to_le16(saturate(stats.alloc_failures));
+
+    for (int i = 0; i < ZMK_PIPELINE_QUEUE_COUNT; i++) {
+        record.peak_depth[i] = sys_cpu_to_le16(saturate(stats.peak_depth[i]));
+        record.dropped[i] = sys_cpu_to_le16(saturate(stats.dropped[i]));
+    }
+}
+
+static void telemetry_work_cb(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(telemetry_work_cb)
+K_WORK_DELAYABLE_DEFINE(telemetry_work, ZMK_WORK_WATCHED(telemetry_work_cb));
+
+// A record due while the previous one is still waiting for the host is skipped, and the sequence
+// number shows the gap.
+static void telemetry_work_cb(struct k_work *work) {
+    k_work_schedule(&telemetry_work, K_MSEC(CONFIG_ZMK_USB_TELEMETRY_INTERVAL_MS));
+
+    if (!atomic_cas(&transfer_in_flight, false, true)) {
+        sequence++;
+        return;
+    }
+
+    fill_record();
+
+    int err = hid_int_ep_write(hid_dev, (const uint8_t *)&record, sizeof(record), NULL);
+    if (err) {
+        LOG_DBG("Failed to send USB telemetry (err %d)", err);
+        atomic_set(&transfer_in_flight, false);
+    }
+}
+
+static int telemetry_listener(const zmk_event_t *eh) {
+    // A transfer cut off by the host going away never completes.
+    atomic_set(&transfer_in_flight, false);
+
+    if (zmk_usb_is_hid_ready()) {
+        k_work_schedule(&telemetry_work, K_NO_WAIT);
+    } else {
+        k_work_cancel_delayable(&telemetry_work);
+    }
+
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(usb_telemetry, telemetry_listener);
+ZMK_SUBSCRIPTION(usb_telemetry, zmk_usb_conn_state_changed);
+
+static int zmk_usb_telemetry_init(const struct device *_arg) {
+    // After the ones used for reports, and before the keymap upload interface.
+    hid_dev = device_get_binding(
+        interface_dev_names[CONFIG_USB_HID_DEVICE_COUNT - 1 -
+                            IS_ENABLED(CONFIG_ZMK_USB_KEYMAP_UPLOAD)]);
+    if (hid_dev == NULL) {
+        LOG_ERR("Unable to locate the USB telemetry HID device");
+        return -EINVAL;
+    }
+
+    usb_hid_register_device(hid_dev, telemetry_report_desc, sizeof(telemetry_report_desc), &ops);
+    return usb_hid_init(hid_dev);
+}
+
+ZMK_SYS_INIT(zmk_usb_telemetry_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
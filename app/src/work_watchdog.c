@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <string.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/flight_recorder.h>
+#include <zmk/work_watchdog.h>
+
+#define THRESHOLD_US (CONFIG_ZMK_WORK_WATCHDOG_THRESHOLD_MS * USEC_PER_MSEC)
+
+struct slow_handler {
+    k_work_handler_t handler;
+    uint32_t runs;
+    uint32_t worst_us;
+};
+
+// The handlers that ran for too long so far, in the order they were first seen.
+static struct slow_handler slow_handlers[CONFIG_ZMK_WORK_WATCHDOG_MAX_HANDLERS];
+// Slow runs of handlers that didn't fit in the table.
+static uint32_t untracked_runs;
+static struct k_spinlock lock;
+
+static void record_slow_run(k_work_handler_t handler, uint32_t us) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    struct slow_handler *slot = NULL;
+    for (int i = 0; i < ARRAY_SIZE(slow_handlers) && slot == NULL; i++) {
+        if (slow_handlers[i].handler == handler || slow_handlers[i].handler == NULL) {
+            slot = &slow_handlers[i];
+        }
+    }
+
+    if (slot == NULL) {
+        untracked_runs++;
+    } else {
+        slot->handler = handler;
+        slot->runs++;
+        slot->worst_us = MAX(slot->worst_us, us);
+    }
+
+    k_spin_unlock(&lock, key);
+}
+
+static const char *current_thread_name() {
+    const char *name = IS_ENABLED(CONFIG_THREAD_NAME) ? k_thread_name_get(k_current_get()) : NULL;
+    return name != NULL && name[0] != '\0' ? name : "?";
+}
+
+// The time includes being preempted by higher priority threads, since everything queued behind the
+// handler waits for that as well.
+void zmk_work_watchdog_run(k_work_handler_t handler, struct k_work *work) {
+    uint32_t start = k_cycle_get_32();
+
+    handler(work);
+
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    if (us < THRESHOLD_US) {
+        return;
+    }
+
+    record_slow_run(handler, us);
+    zmk_flight_record(ZMK_FLIGHT_WORK_STALL, MIN(us / USEC_PER_MSEC, UINT16_MAX), 0);
+    LOG_WRN("Work handler %p on %s ran for %u us", (void *)handler,
+            log_strdup(current_thread_name()), us);
+}
+
+#if IS_ENABLED(CONFIG_SHELL)
+
+#include <shell/shell.h>
+
+static int cmd_stalls(const struct shell *sh, size_t argc, char **argv) {
+    struct slow_handler handlers[ARRAY_SIZE(slow_handlers)];
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memcpy(handlers, slow_handlers, sizeof(handlers));
+    uint32_t untracked = untracked_runs;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Work handlers running for %d ms or more:",
+                CONFIG_ZMK_WORK_WATCHDOG_THRESHOLD_MS);
+    for (int i = 0; i < ARRAY_SIZE(handlers) && handlers[i].handler != NULL; i++) {
+        shell_print(sh, "  %p %6u runs, worst %8u us", (void *)handlers[i].handler,
+                    handlers[i].runs, handlers[i].worst_us);
+    }
+
+    if (untracked > 0) {
+        shell_print(sh, "  %u runs of other handlers", untracked);
+    }
+
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memset(slow_handlers, 0, sizeof(slow_handlers));
+    untracked_runs = 0;
+    k_spin_unlock(&lock, key);
+
+    shell_print(sh, "Work stalls reset");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_work,
+                               SHELL_CMD(stalls, NULL, "Show the work handlers that ran too long",
+                                         cmd_stalls),
+                               SHELL_CMD(reset, NULL, "Reset the work stalls", cmd_reset),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(work, &sub_work, "ZMK work queue commands", NULL);
+
+#endif /* IS_ENABLED(CONFIG_SHELL) */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <kernel.h>
+#include <init.h>
+
+#include <zmk/boot_profile.h>
+#include <zmk/workqueue.h>
+
+#if IS_ENABLED(CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED)
+
+K_THREAD_STACK_DEFINE(input_work_stack_area, CONFIG_ZMK_INPUT_DEDICATED_THREAD_STACK_SIZE);
+
+static struct k_work_q input_work_q;
+
+#endif
+
+struct k_work_q *zmk_input_work_q() {
+#if IS_ENABLED(CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED)
+    return &input_work_q;
+#else
+    return &k_sys_work_q;
+#endif
+}
+
+#if IS_ENABLED(CONFIG_ZMK_INPUT_WORK_QUEUE_DEDICATED)
+static int zmk_input_work_q_init(const struct device *_arg) {
+    static const struct k_work_queue_config queue_config = {.name = "ZMK Input Work"};
+    k_work_queue_start(&input_work_q, input_work_stack_area,
+                       K_THREAD_STACK_SIZEOF(input_work_stack_area),
+                       CONFIG_ZMK_INPUT_DEDICATED_THREAD_PRIORITY, &queue_config);
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_input_work_q_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE)
+
+K_THREAD_STACK_DEFINE(ble_tx_work_stack_area, CONFIG_ZMK_BLE_SHARED_TX_THREAD_STACK_SIZE);
+
+static struct k_work_q ble_tx_work_q;
+
+struct k_work_q *zmk_ble_tx_work_q() { return &ble_tx_work_q; }
+
+static int zmk_ble_tx_work_q_init(const struct device *_arg) {
+    static const struct k_work_queue_config queue_config = {.name = "ZMK BLE TX Work"};
+    k_work_queue_start(&ble_tx_work_q, ble_tx_work_stack_area,
+                       K_THREAD_STACK_SIZEOF(ble_tx_work_stack_area),
+                       CONFIG_ZMK_BLE_THREAD_PRIORITY, &queue_config);
+
+    return 0;
+}
+
+ZMK_SYS_INIT(zmk_ble_tx_work_q_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+#endif /* IS_ENABLED(CONFIG_ZMK_BLE_SHARED_TX_WORK_QUEUE) */
@@ -5,8 +5,8 @@
  */
 
 #include <device.h>
-#include <init.h>
 #include <kernel.h>
+#include <sys/atomic.h>
 
 #include <logging/log.h>
 
@@ -17,70 +17,71 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/events/keycode_state_changed.h>
 
 #include <zmk/wpm.h>
+#include <zmk/work_watchdog.h>
 
-#define WPM_UPDATE_INTERVAL_SECONDS 1
-#define WPM_RESET_INTERVAL_SECONDS 5
+// Keystrokes are counted per second over a sliding window of this many seconds.
+#define WPM_WINDOW_SECONDS 5
 
 // See https://en.wikipedia.org/wiki/Words_per_minute
 // "Since the length or duration of words is clearly variable, for the purpose of measurement of
 // text entry, the definition of each "word" is often standardized to be five characters or
 // keystrokes long in English"
-#define CHARS_PER_WORD 5.0
+#define CHARS_PER_WORD 5
 
-static uint8_t wpm_state = -1;
-static uint8_t last_wpm_state;
-static uint8_t wpm_update_counter;
-static uint32_t key_pressed_count;
+static uint8_t wpm_state;
+
+// Key releases since the last update. The listener and the update run on different work queues.
+static atomic_t keys_this_second;
+
+static uint8_t window_counts[WPM_WINDOW_SECONDS];
+static uint8_t window_index;
+static uint16_t window_total;
 
 int zmk_wpm_get_state() { return wpm_state; }
 
+void wpm_work_handler(struct k_work *work);
+
+ZMK_WORK_WATCHDOG_WRAP(wpm_work_handler)
+static K_WORK_DELAYABLE_DEFINE(wpm_work, ZMK_WORK_WATCHED(wpm_work_handler));
+
 int wpm_event_listener(const zmk_event_t *eh) {
     const struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
     if (ev) {
         // count only key up events
         if (!ev->state) {
-            key_pressed_count++;
-            LOG_DBG("key_pressed_count %d keycode %d", key_pressed_count, ev->keycode);
+            atomic_inc(&keys_this_second);
+            LOG_DBG("keycode %d released", ev->keycode);
+
+            // Does nothing while updates are already running.
+            k_work_schedule(&wpm_work, K_SECONDS(1));
         }
     }
     return 0;
 }
 
 void wpm_work_handler(struct k_work *work) {
-    wpm_update_counter++;
-    wpm_state = (key_pressed_count / CHARS_PER_WORD) /
-                (wpm_update_counter * WPM_UPDATE_INTERVAL_SECONDS / 60.0);
+    uint8_t count = MIN(atomic_clear(&keys_this_second), UINT8_MAX);
 
-    if (last_wpm_state != wpm_state) {
-        LOG_DBG("Raised WPM state changed %d wpm_update_counter %d", wpm_state, wpm_update_counter);
+    window_total += count - window_counts[window_index];
+    window_counts[window_index] = count;
+    window_index = (window_index + 1) % WPM_WINDOW_SECONDS;
 
-        ZMK_EVENT_RAISE(
-            new_zmk_wpm_state_changed((struct zmk_wpm_state_changed){.state = wpm_state}));
+    // Rounded to the nearest word per minute.
+    const uint32_t divisor = CHARS_PER_WORD * WPM_WINDOW_SECONDS;
+    uint8_t new_state = MIN((window_total * 60 + divisor / 2) / divisor, UINT8_MAX);
 
-        last_wpm_state = wpm_state;
-    }
+    if (new_state != wpm_state) {
+        LOG_DBG("Raised WPM state changed %d", new_state);
 
-    if (wpm_update_counter >= WPM_RESET_INTERVAL_SECONDS) {
-        wpm_update_counter = 0;
-        key_pressed_count = 0;
+        wpm_state = new_state;
+        raise_zmk_wpm_state_changed((struct zmk_wpm_state_changed){.state = wpm_state});
     }
-}
 
-K_WORK_DEFINE(wpm_work, wpm_work_handler);
-
-void wpm_expiry_function() { k_work_submit(&wpm_work); }
-
-K_TIMER_DEFINE(wpm_timer, wpm_expiry_function, NULL);
-
-int wpm_init() {
-    wpm_state = 0;
-    wpm_update_counter = 0;
-    k_timer_start(&wpm_timer, K_SECONDS(WPM_UPDATE_INTERVAL_SECONDS),
-                  K_SECONDS(WPM_UPDATE_INTERVAL_SECONDS));
-    return 0;
+    // Once a whole window passes without typing, stop until the next key release.
+    if (window_total > 0) {
+        k_work_schedule(&wpm_work, K_SECONDS(1));
+    }
 }
 
 ZMK_LISTENER(wpm, wpm_event_listener);
 ZMK_SUBSCRIPTION(wpm, zmk_keycode_state_changed);
-
-SYS_INIT(wpm_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -34,6 +34,7 @@ module.exports = {
       "behaviors/tap-dance",
       "behaviors/caps-word",
       "behaviors/key-repeat",
+      "behaviors/mouse-emulation",
       "behaviors/reset",
       "behaviors/bluetooth",
       "behaviors/outputs",
@@ -62,6 +63,7 @@ module.exports = {
       "config/encoders",
       "config/keymap",
       "config/kscan",
+      "config/pointing",
       "config/power",
       "config/underglow",
       "config/system",